@@ -82,6 +82,8 @@ struct AnyPointer {
     friend struct AnyPointer;
     friend class Orphanage;
     friend class CapReaderContext;
+    template <typename T, Kind K>
+    friend struct _::PointerHelpers;
   };
 
   class Builder {
@@ -181,6 +183,8 @@ struct AnyPointer {
     _::PointerBuilder builder;
     friend class Orphanage;
     friend class CapBuilderContext;
+    template <typename T, Kind K>
+    friend struct _::PointerHelpers;
   };
 
   class Pipeline {
@@ -452,6 +456,22 @@ inline Orphan<AnyPointer> Orphan<AnyPointer>::releaseAs() {
   return kj::mv(*this);
 }
 
+namespace _ {  // private
+
+template <>
+struct PointerHelpers<AnyPointer, Kind::UNKNOWN> {
+  // Only the internal accessors; AnyPointer's own get/set methods are specialized above.
+
+  static inline PointerReader getInternalReader(const AnyPointer::Reader& reader) {
+    return reader.reader;
+  }
+  static inline PointerBuilder getInternalBuilder(AnyPointer::Builder&& builder) {
+    return builder.builder;
+  }
+};
+
+}  // namespace _ (private)
+
 }  // namespace capnp
 
 #endif  // CAPNP_ANY_H_
@@ -52,7 +52,10 @@ void ReadLimiter::unread(WordCount64 amount) {
 ReaderArena::ReaderArena(MessageReader* message)
     : message(message),
       readLimiter(message->getOptions().traversalLimitInWords * WORDS),
-      segment0(this, SegmentId(0), message->getSegment(0), &readLimiter) {}
+      segment0(this, SegmentId(0), message->getSegment(0), &readLimiter),
+      moreSegments(kj::heapArray<kj::Lazy<SegmentReader>>(
+          kj::max(message->getSegmentCount(), 1u) - 1)),
+      fetchLock(message) {}
 
 ReaderArena::~ReaderArena() noexcept(false) {}
 
@@ -65,33 +68,15 @@ SegmentReader* ReaderArena::tryGetSegment(SegmentId id) {
     }
   }
 
-  auto lock = moreSegments.lockExclusive();
-
-  SegmentMap* segments = nullptr;
-  KJ_IF_MAYBE(s, *lock) {
-    auto iter = s->get()->find(id.value);
-    if (iter != s->get()->end()) {
-      return iter->second;
-    }
-    segments = *s;
-  }
-
-  kj::ArrayPtr<const word> newSegment = message->getSegment(id.value);
-  if (newSegment == nullptr) {
+  uint index = id.value - 1;
+  if (index >= moreSegments.size()) {
     return nullptr;
   }
 
-  if (*lock == nullptr) {
-    // OK, the segment exists, so allocate the map.
-    auto s = kj::heap<SegmentMap>();
-    segments = s;
-    *lock = kj::mv(s);
-  }
-
-  auto segment = kj::heap<SegmentReader>(this, id, newSegment, &readLimiter);
-  SegmentReader* result = segment;
-  segments->insert(std::make_pair(id.value, mv(segment)));
-  return result;
+  return &moreSegments[index].get([&](kj::SpaceFor<SegmentReader>& space) {
+    kj::ArrayPtr<const word> segment = (*fetchLock.lockExclusive())->getSegment(id.value);
+    return space.construct(this, id, segment, &readLimiter);
+  });
 }
 
 void ReaderArena::reportReadLimitReached() {
@@ -108,6 +93,13 @@ kj::Maybe<kj::Own<ClientHook>> ReaderArena::extractCap(uint index) {
   }
 }
 
+void SegmentBuilder::throwNotWritable() {
+  KJ_FAIL_REQUIRE(
+      "Tried to form a Builder to an external data segment referenced by the MessageBuilder.  "
+      "When you use Orphanage::reference*(), you are not allowed to obtain Builders to the "
+      "referenced data, only Readers, because that data is const.");
+}
+
 // =======================================================================================
 
 BuilderArena::BuilderArena(MessageBuilder* message)
@@ -128,10 +120,12 @@ SegmentBuilder* BuilderArena::getSegment(SegmentId id) {
   }
 }
 
-BuilderArena::AllocateResult BuilderArena::allocate(WordCount amount) {
+BuilderArena::AllocateResult BuilderArena::allocate(WordCount amount, WordCount reserve) {
+  WordCount needed = amount + reserve;
+
   if (segment0.getArena() == nullptr) {
     // We're allocating the first segment.
-    kj::ArrayPtr<word> ptr = message->allocateSegment(amount / WORDS);
+    kj::ArrayPtr<word> ptr = message->allocateSegment(needed / WORDS);
 
     // Re-allocate segment0 in-place.  This is a bit of a hack, but we have not returned any
     // pointers to this segment yet, so it should be fine.
@@ -140,9 +134,8 @@ BuilderArena::AllocateResult BuilderArena::allocate(WordCount amount) {
     return AllocateResult { &segment0, segment0.allocate(amount) };
   } else {
     // Check if there is space in the first segment.
-    word* attempt = segment0.allocate(amount);
-    if (attempt != nullptr) {
-      return AllocateResult { &segment0, attempt };
+    if (segment0.available() >= needed) {
+      return AllocateResult { &segment0, segment0.allocate(amount) };
     }
 
     // Need to fall back to additional segments.
@@ -156,20 +149,23 @@ BuilderArena::AllocateResult BuilderArena::allocate(WordCount amount) {
       //   on the last-known available size, and then re-check the size when we pop segments off it
       //   and shove them to the back of the queue if they have become too small.
 
-      attempt = s->get()->builders.back()->allocate(amount);
-      if (attempt != nullptr) {
-        return AllocateResult { s->get()->builders.back().get(), attempt };
+      SegmentBuilder* last = s->get()->builders.back().get();
+      if (last->available() >= needed) {
+        return AllocateResult { last, last->allocate(amount) };
       }
       segmentState = *s;
     } else {
       auto newSegmentState = kj::heap<MultiSegmentState>();
+      // allocateSegment() below may call getSegmentsForOutput() (StreamingMessageBuilder does), so
+      // forOutput must already have room for segment 0.
+      newSegmentState->forOutput.resize(1);
       segmentState = newSegmentState;
       moreSegments = kj::mv(newSegmentState);
     }
 
     kj::Own<SegmentBuilder> newBuilder = kj::heap<SegmentBuilder>(
         this, SegmentId(segmentState->builders.size() + 1),
-        message->allocateSegment(amount / WORDS), &this->dummyLimiter);
+        message->allocateSegment(needed / WORDS), &this->dummyLimiter);
     SegmentBuilder* result = newBuilder.get();
     segmentState->builders.add(kj::mv(newBuilder));
 
@@ -248,6 +244,34 @@ kj::Maybe<kj::Own<ClientHook>> BuilderArena::extractCap(uint index) {
   }
 }
 
+SegmentBuilder* BuilderArena::addExternalSegment(kj::ArrayPtr<const word> content) {
+  // This check should never fail in practice, since you can't get an Orphanage without allocating
+  // the root segment.
+  KJ_REQUIRE(segment0.getArena() != nullptr,
+      "Can't allocate external segments before allocating the root segment.");
+
+  MultiSegmentState* segmentState;
+  KJ_IF_MAYBE(s, moreSegments) {
+    segmentState = *s;
+  } else {
+    auto newSegmentState = kj::heap<MultiSegmentState>();
+    segmentState = newSegmentState;
+    moreSegments = kj::mv(newSegmentState);
+  }
+
+  kj::Own<SegmentBuilder> newBuilder = kj::heap<SegmentBuilder>(
+      this, SegmentId(segmentState->builders.size() + 1),
+      content.begin(), content.size() * WORDS, &this->dummyLimiter);
+  SegmentBuilder* result = newBuilder.get();
+  segmentState->builders.add(kj::mv(newBuilder));
+
+  // Keep forOutput the right size so that we don't have to re-allocate during
+  // getSegmentsForOutput(), which callers might reasonably expect is a thread-safe method.
+  segmentState->forOutput.resize(segmentState->builders.size() + 1);
+
+  return result;
+}
+
 uint BuilderArena::injectCap(kj::Own<ClientHook>&& cap) {
   // TODO(perf):  Detect if the cap is already on the table and reuse the index?  Perhaps this
   //   doesn't happen enough to be worth the effort.
@@ -28,7 +28,6 @@
 #error "This header is only meant to be included by Cap'n Proto's own source code."
 #endif
 
-#include <unordered_map>
 #include <kj/common.h>
 #include <kj/mutex.h>
 #include <kj/exception.h>
@@ -135,21 +134,46 @@ class SegmentBuilder: public SegmentReader {
 public:
   inline SegmentBuilder(BuilderArena* arena, SegmentId id, kj::ArrayPtr<word> ptr,
                         ReadLimiter* readLimiter);
+  inline SegmentBuilder(BuilderArena* arena, SegmentId id, const word* ptr, WordCount size,
+                        ReadLimiter* readLimiter);
+  // The second form constructs a read-only segment wrapping external data; see
+  // BuilderArena::addExternalSegment().
 
   KJ_ALWAYS_INLINE(word* allocate(WordCount amount));
   inline word* getPtrUnchecked(WordCount offset);
 
+  inline WordCount available();
+  // Number of words that can still be allocated from this segment.
+
   inline BuilderArena* getArena();
 
   inline kj::ArrayPtr<const word> currentlyAllocated();
 
+  inline bool tryTruncate(word* from, word* to);
+  // If `from` is the end of the most recent allocation in this segment, moves the allocation
+  // point back to `to` and returns true, so that the space can be allocated again.  The caller
+  // must already have zeroed [to, from).
+
   inline void reset();
 
+  inline bool isWritable() { return !readOnly; }
+  // False for external segments, which must never be written or zeroed.
+
+  KJ_ALWAYS_INLINE(void checkWritable()) {
+    if (KJ_UNLIKELY(readOnly)) throwNotWritable();
+  }
+  // Throws if this is an external segment.  Called whenever a Builder is about to be formed
+  // pointing into the segment.
+
 private:
   word* pos;
   // Pointer to a pointer to the current end point of the segment, i.e. the location where the
   // next object should be allocated.
 
+  bool readOnly;
+
+  void throwNotWritable();
+
   KJ_DISALLOW_COPY(SegmentBuilder);
 };
 
@@ -175,7 +199,7 @@ public:
   ~ReaderArena() noexcept(false);
   KJ_DISALLOW_COPY(ReaderArena);
 
-  inline void initCapTable(kj::Array<kj::Maybe<kj::Own<ClientHook>>> capTable) {
+  inline void initCapTable(CapTable&& capTable) {
     // Imbues the arena with a capability table.  This is not passed to the constructor because the
     // table itself may be built based on some other part of the message (as is the case with the
     // RPC protocol).
@@ -190,20 +214,21 @@ public:
 private:
   MessageReader* message;
   ReadLimiter readLimiter;
-  kj::Array<kj::Maybe<kj::Own<ClientHook>>> capTable;
+  CapTable capTable;
 
   // Optimize for single-segment messages so that small messages are handled quickly.
   SegmentReader segment0;
 
-  typedef std::unordered_map<uint, kj::Own<SegmentReader>> SegmentMap;
-  kj::MutexGuarded<kj::Maybe<kj::Own<SegmentMap>>> moreSegments;
-  // We need to mutex-guard the segment map because we lazily initialize segments when they are
-  // first requested, but a Reader is allowed to be used concurrently in multiple threads.  Luckily
-  // this only applies to large messages.
-  //
-  // TODO(perf):  Thread-local thing instead?  Some kind of lockless map?  Or do sharing of data
-  //   in a different way, where you have to construct a new MessageReader in each thread (but
-  //   possibly backed by the same data)?
+  kj::Array<kj::Lazy<SegmentReader>> moreSegments;
+  // Segments 1 and up, indexed by ID - 1, sized from MessageReader::getSegmentCount().  Each
+  // segment is fetched from the MessageReader the first time it is requested; kj::Lazy
+  // synchronizes that one-time initialization, so afterwards a lookup is a single acquire load
+  // plus an array index and many threads can traverse the same large message without contending
+  // on a lock.
+
+  kj::MutexGuarded<MessageReader*> fetchLock;
+  // Serializes calls to MessageReader::getSegment(), which need not be thread-safe (e.g.
+  // InputStreamMessageReader reads lazily from its stream).  Only taken on a segment's first use.
 };
 
 class BuilderArena final: public Arena {
@@ -232,11 +257,27 @@ public:
     word* words;
   };
 
-  AllocateResult allocate(WordCount amount);
+  AllocateResult allocate(WordCount amount, WordCount reserve = 0 * WORDS);
   // Find a segment with at least the given amount of space available and allocate the space.
   // Note that allocating directly from a particular segment is much faster, but allocating from
   // the arena is guaranteed to succeed.  Therefore callers should try to allocate from a specific
   // segment first if there is one, then fall back to the arena.
+  //
+  // If `reserve` is non-zero, the chosen segment will also have at least `reserve` words left
+  // over after the allocation, so that the caller can follow up with that much more allocation
+  // from the same segment.  This is used when deep-copying an object whose total size is known,
+  // so that the whole copy lands in one segment.
+
+  SegmentBuilder* addExternalSegment(kj::ArrayPtr<const word> content);
+  // Add a new segment to the arena which points to some existing memory region.  The segment is
+  // assumed to be completely full; the arena will never allocate from it.  In fact, the segment
+  // is considered read-only.  Any attempt to get a Builder pointing into this segment will throw
+  // an exception.  Readers are allowed, however.
+  //
+  // This can be used to inject some external data into a message without a copy, e.g. embedding a
+  // large mmap'd file into a message as `Data` without forcing that data to actually be read in
+  // from disk (until the message itself is written out).  `Orphanage` provides the public API for
+  // this feature.
 
   uint injectCap(kj::Own<ClientHook>&& cap);
   // Add the capability to the message and return its index.  If the same ClientHook is injected
@@ -254,7 +295,7 @@ public:
 private:
   MessageBuilder* message;
   ReadLimiter dummyLimiter;
-  kj::Vector<kj::Maybe<kj::Own<ClientHook>>> capTable;
+  CapTable capTable;
 
   SegmentBuilder segment0;
   kj::ArrayPtr<const word> segment0ForOutput;
@@ -316,7 +357,14 @@ inline void SegmentReader::unread(WordCount64 amount) { readLimiter->unread(amou
 
 inline SegmentBuilder::SegmentBuilder(
     BuilderArena* arena, SegmentId id, kj::ArrayPtr<word> ptr, ReadLimiter* readLimiter)
-    : SegmentReader(arena, id, ptr, readLimiter), pos(ptr.begin()) {}
+    : SegmentReader(arena, id, ptr, readLimiter), pos(ptr.begin()), readOnly(false) {}
+inline SegmentBuilder::SegmentBuilder(
+    BuilderArena* arena, SegmentId id, const word* ptr, WordCount size, ReadLimiter* readLimiter)
+    : SegmentReader(arena, id, kj::arrayPtr(ptr, size / WORDS), readLimiter),
+      // const_cast is safe here because the member won't ever be dereferenced because it appears
+      // to point to the end of the segment anyway.
+      pos(const_cast<word*>(ptr + size)),
+      readOnly(true) {}
 
 inline word* SegmentBuilder::allocate(WordCount amount) {
   if (intervalLength(pos, ptr.end()) < amount) {
@@ -342,6 +390,19 @@ inline BuilderArena* SegmentBuilder::getArena() {
   return static_cast<BuilderArena*>(arena);
 }
 
+inline WordCount SegmentBuilder::available() {
+  return intervalLength(pos, ptr.end());
+}
+
+inline bool SegmentBuilder::tryTruncate(word* from, word* to) {
+  if (pos == from) {
+    pos = to;
+    return true;
+  } else {
+    return false;
+  }
+}
+
 inline kj::ArrayPtr<const word> SegmentBuilder::currentlyAllocated() {
   return kj::arrayPtr(ptr.begin(), pos - ptr.begin());
 }
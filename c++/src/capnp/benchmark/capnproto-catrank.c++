@@ -21,123 +21,9 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "catrank.capnp.h"
-#include "capnproto-common.h"
-
-namespace capnp {
-namespace benchmark {
-namespace capnp {
-
-struct ScoredResult {
-  double score;
-  SearchResult::Reader result;
-
-  ScoredResult() = default;
-  ScoredResult(double score, SearchResult::Reader result): score(score), result(result) {}
-
-  inline bool operator<(const ScoredResult& other) const { return score > other.score; }
-};
-
-class CatRankTestCase {
-public:
-  typedef SearchResultList Request;
-  typedef SearchResultList Response;
-  typedef int Expectation;
-
-  static int setupRequest(SearchResultList::Builder request) {
-    int count = fastRand(1000);
-    int goodCount = 0;
-
-    auto list = request.initResults(count);
-
-    for (int i = 0; i < count; i++) {
-      SearchResult::Builder result = list[i];
-      result.setScore(1000 - i);
-      int urlSize = fastRand(100);
-
-      static const char URL_PREFIX[] = "http://example.com/";
-      size_t urlPrefixLength = strlen(URL_PREFIX);
-      auto url = result.initUrl(urlSize + urlPrefixLength);
-
-      strcpy(url.begin(), URL_PREFIX);
-      char* pos = url.begin() + urlPrefixLength;
-      for (int j = 0; j < urlSize; j++) {
-        *pos++ = 'a' + fastRand(26);
-      }
-
-      bool isCat = fastRand(8) == 0;
-      bool isDog = fastRand(8) == 0;
-      goodCount += isCat && !isDog;
-
-      static std::string snippet;
-      snippet.clear();
-      snippet.push_back(' ');
-
-      int prefix = fastRand(20);
-      for (int j = 0; j < prefix; j++) {
-        snippet.append(WORDS[fastRand(WORDS_COUNT)]);
-      }
-
-      if (isCat) snippet.append("cat ");
-      if (isDog) snippet.append("dog ");
-
-      int suffix = fastRand(20);
-      for (int j = 0; j < suffix; j++) {
-        snippet.append(WORDS[fastRand(WORDS_COUNT)]);
-      }
-
-      result.setSnippet(Text::Reader(snippet.c_str(), snippet.size()));
-    }
-
-    return goodCount;
-  }
-
-  static void handleRequest(SearchResultList::Reader request, SearchResultList::Builder response) {
-    std::vector<ScoredResult> scoredResults;
-
-    for (auto result: request.getResults()) {
-      double score = result.getScore();
-      if (strstr(result.getSnippet().cStr(), " cat ") != nullptr) {
-        score *= 10000;
-      }
-      if (strstr(result.getSnippet().cStr(), " dog ") != nullptr) {
-        score /= 10000;
-      }
-      scoredResults.emplace_back(score, result);
-    }
-
-    std::sort(scoredResults.begin(), scoredResults.end());
-
-    auto list = response.initResults(scoredResults.size());
-    auto iter = list.begin();
-    for (auto result: scoredResults) {
-      iter->setScore(result.score);
-      iter->setUrl(result.result.getUrl());
-      iter->setSnippet(result.result.getSnippet());
-      ++iter;
-    }
-  }
-
-  static bool checkResponse(SearchResultList::Reader response, int expectedGoodCount) {
-    int goodCount = 0;
-    for (auto result: response.getResults()) {
-      if (result.getScore() > 1001) {
-        ++goodCount;
-      } else {
-        break;
-      }
-    }
-
-    return goodCount == expectedGoodCount;
-  }
-};
-
-}  // namespace capnp
-}  // namespace benchmark
-}  // namespace capnp
+#include "capnproto-catrank.h"
 
 int main(int argc, char* argv[]) {
-  return capnp::benchmark::benchmarkMain<
-      capnp::benchmark::capnp::BenchmarkTypes,
+  return capnp::benchmark::capnp::benchmarkMainWithThreads<
       capnp::benchmark::capnp::CatRankTestCase>(argc, argv);
 }
@@ -32,6 +32,7 @@
 #include <capnp/serialize-snappy.h>
 #endif  // HAVE_SNAPPY
 #include <thread>
+#include <atomic>
 
 namespace capnp {
 namespace benchmark {
@@ -173,7 +174,10 @@ struct NoScratch {
 
 constexpr size_t SCRATCH_SIZE = 128 * 1024;
 word scratchSpace[6 * SCRATCH_SIZE];
-int scratchCounter = 0;
+thread_local word* threadScratchSpace = scratchSpace;
+thread_local int scratchCounter = 0;
+// The main thread uses the static `scratchSpace`; threads started by runThreads() allocate their
+// own and point `threadScratchSpace` at it.
 
 struct UseScratch {
   struct ScratchSpace {
@@ -181,7 +185,7 @@ struct UseScratch {
 
     ScratchSpace() {
       KJ_REQUIRE(scratchCounter < 6, "Too many scratch spaces needed at once.");
-      words = scratchSpace + scratchCounter++ * SCRATCH_SIZE;
+      words = threadScratchSpace + scratchCounter++ * SCRATCH_SIZE;
     }
     ~ScratchSpace() noexcept {
       --scratchCounter;
@@ -236,6 +240,29 @@ struct UseScratch {
 
 // =======================================================================================
 
+template <typename RequestType, typename ResponseType>
+struct GeneratedTestCase {
+  // Base class for test cases written against generated code.  BenchmarkMethods gets at message
+  // roots through these, so that test cases using the dynamic API -- which need a schema to do
+  // so -- can supply their own.
+
+  typedef RequestType Request;
+  typedef ResponseType Response;
+
+  static inline typename Request::Builder initRequest(MessageBuilder& message) {
+    return message.initRoot<Request>();
+  }
+  static inline typename Request::Reader getRequest(MessageReader& message) {
+    return message.getRoot<Request>();
+  }
+  static inline typename Response::Builder initResponse(MessageBuilder& message) {
+    return message.initRoot<Response>();
+  }
+  static inline typename Response::Reader getResponse(MessageReader& message) {
+    return message.getRoot<Response>();
+  }
+};
+
 template <typename TestCase, typename ReuseStrategy, typename Compression>
 struct BenchmarkMethods {
   static uint64_t syncClient(int inputFd, int outputFd, uint64_t iters) {
@@ -251,7 +278,7 @@ struct BenchmarkMethods {
       {
         typename ReuseStrategy::MessageBuilder builder(builderScratch);
         expected = TestCase::setupRequest(
-            builder.template initRoot<typename TestCase::Request>());
+            TestCase::initRequest(builder));
         Compression::write(output, builder);
       }
 
@@ -259,7 +286,7 @@ struct BenchmarkMethods {
         typename ReuseStrategy::template MessageReader<Compression> reader(
             bufferedInput, readerScratch);
         if (!TestCase::checkResponse(
-            reader.template getRoot<typename TestCase::Response>(), expected)) {
+            TestCase::getResponse(reader), expected)) {
           throw std::logic_error("Incorrect response.");
         }
       }
@@ -277,7 +304,7 @@ struct BenchmarkMethods {
     for (; iters > 0; --iters) {
       typename ReuseStrategy::MessageBuilder builder(scratch);
       expectations->post(TestCase::setupRequest(
-          builder.template initRoot<typename TestCase::Request>()));
+          TestCase::initRequest(builder)));
       Compression::write(output, builder);
     }
 
@@ -296,7 +323,7 @@ struct BenchmarkMethods {
       typename TestCase::Expectation expected = expectations->next();
       typename ReuseStrategy::template MessageReader<Compression> reader(bufferedInput, scratch);
       if (!TestCase::checkResponse(
-          reader.template getRoot<typename TestCase::Response>(), expected)) {
+          TestCase::getResponse(reader), expected)) {
         throw std::logic_error("Incorrect response.");
       }
     }
@@ -322,8 +349,8 @@ struct BenchmarkMethods {
       typename ReuseStrategy::MessageBuilder builder(builderScratch);
       typename ReuseStrategy::template MessageReader<Compression> reader(
           bufferedInput, readerScratch);
-      TestCase::handleRequest(reader.template getRoot<typename TestCase::Request>(),
-                              builder.template initRoot<typename TestCase::Response>());
+      TestCase::handleRequest(TestCase::getRequest(reader),
+                              TestCase::initResponse(builder));
       Compression::write(output, builder);
     }
 
@@ -336,13 +363,14 @@ struct BenchmarkMethods {
 
     typename ReuseStrategy::ObjectSizeCounter counter(iters);
 
+    IterationTimer timer;
     for (; iters > 0; --iters) {
       typename ReuseStrategy::MessageBuilder requestMessage(requestScratch);
-      auto request = requestMessage.template initRoot<typename TestCase::Request>();
+      auto request = TestCase::initRequest(requestMessage);
       typename TestCase::Expectation expected = TestCase::setupRequest(request);
 
       typename ReuseStrategy::MessageBuilder responseMessage(responseScratch);
-      auto response = responseMessage.template initRoot<typename TestCase::Response>();
+      auto response = TestCase::initResponse(responseMessage);
       TestCase::handleRequest(request.asReader(), response);
 
       if (!TestCase::checkResponse(response.asReader(), expected)) {
@@ -352,6 +380,8 @@ struct BenchmarkMethods {
       if (countObjectSize) {
         counter.add(requestMessage, responseMessage);
       }
+
+      timer.lap();
     }
 
     return counter.get();
@@ -366,10 +396,11 @@ struct BenchmarkMethods {
     UseScratch::ScratchSpace responseBytesScratch;
     typename ReuseStrategy::ScratchSpace clientResponseScratch;
 
+    IterationTimer timer;
     for (; iters > 0; --iters) {
       typename ReuseStrategy::MessageBuilder requestBuilder(clientRequestScratch);
       typename TestCase::Expectation expected = TestCase::setupRequest(
-          requestBuilder.template initRoot<typename TestCase::Request>());
+          TestCase::initRequest(requestBuilder));
 
       kj::ArrayOutputStream requestOutput(kj::arrayPtr(
           reinterpret_cast<byte*>(requestBytesScratch.words), SCRATCH_SIZE * sizeof(word)));
@@ -379,8 +410,8 @@ struct BenchmarkMethods {
           requestOutput.getArray(), serverRequestScratch);
 
       typename ReuseStrategy::MessageBuilder responseBuilder(serverResponseScratch);
-      TestCase::handleRequest(requestReader.template getRoot<typename TestCase::Request>(),
-                              responseBuilder.template initRoot<typename TestCase::Response>());
+      TestCase::handleRequest(TestCase::getRequest(requestReader),
+                              TestCase::initResponse(responseBuilder));
 
       kj::ArrayOutputStream responseOutput(
           kj::arrayPtr(reinterpret_cast<byte*>(responseBytesScratch.words),
@@ -391,9 +422,11 @@ struct BenchmarkMethods {
           responseOutput.getArray(), clientResponseScratch);
 
       if (!TestCase::checkResponse(
-          responseReader.template getRoot<typename TestCase::Response>(), expected)) {
+          TestCase::getResponse(responseReader), expected)) {
         throw std::logic_error("Incorrect response.");
       }
+
+      timer.lap();
      }
 
     return throughput;
@@ -414,6 +447,168 @@ struct BenchmarkTypes {
   struct BenchmarkMethods: public capnp::BenchmarkMethods<TestCase, ReuseStrategy, Compression> {};
 };
 
+// =======================================================================================
+// Multi-threaded modes.  These are only implemented for Cap'n Proto, and are used to see how
+// building and reading scale across cores.  Each thread performs the full iteration count, so
+// perfect scaling means constant wall time as the thread count grows.
+
+template <typename Func>
+uint64_t runThreads(uint threadCount, Func&& func) {
+  // Runs `func` on `threadCount` new threads at once, and returns the wall time in nanoseconds
+  // from releasing them until the last one finishes.  Thread startup and scratch allocation happen
+  // before the clock starts.
+
+  std::atomic<uint> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount);
+
+  for (uint i = 0; i < threadCount; i++) {
+    threads.emplace_back([&]() {
+      auto scratch = kj::heapArray<word>(6 * SCRATCH_SIZE);
+      threadScratchSpace = scratch.begin();
+      ready.fetch_add(1, std::memory_order_acq_rel);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      func();
+    });
+  }
+
+  while (ready.load(std::memory_order_acquire) < threadCount) {
+    std::this_thread::yield();
+  }
+  uint64_t start = monotonicNanos();
+  go.store(true, std::memory_order_release);
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  return monotonicNanos() - start;
+}
+
+constexpr uint SHARED_MESSAGE_SEGMENT_WORDS = 256;
+// Segment size for the message shared by "threads-shared-reader".  Kept small so that larger
+// test cases span many segments and readers exercise ReaderArena's segment lookup.
+
+template <typename TestCase, typename ReuseStrategy, typename Compression>
+struct ThreadedBenchmarkMethods {
+  typedef capnp::BenchmarkMethods<TestCase, ReuseStrategy, Compression> Methods;
+
+  static uint64_t perThreadObjects(uint64_t iters, uint threadCount) {
+    // Every thread builds and reads its own messages.
+    return runThreads(threadCount, [iters]() {
+      Methods::passByObject(iters, false);
+    });
+  }
+
+  static uint64_t perThreadBytes(uint64_t iters, uint threadCount) {
+    // Every thread serializes and parses its own messages.
+    return runThreads(threadCount, [iters]() {
+      Methods::passByBytes(iters);
+    });
+  }
+
+  static uint64_t sharedReader(uint64_t iters, uint threadCount) {
+    // All threads traverse the same request through one shared FlatArrayMessageReader, each
+    // building responses into its own messages.  Besides memory bandwidth, this measures sharing
+    // of the reader's ReadLimiter and segment table.
+
+    MallocMessageBuilder requestMessage(
+        SHARED_MESSAGE_SEGMENT_WORDS, AllocationStrategy::FIXED_SIZE);
+    typename TestCase::Expectation expected =
+        TestCase::setupRequest(TestCase::initRequest(requestMessage));
+    kj::Array<word> words = messageToFlatArray(requestMessage);
+
+    ReaderOptions options;
+    options.traversalLimitInWords = std::numeric_limits<uint64_t>::max();
+    FlatArrayMessageReader reader(words, options);
+
+    return runThreads(threadCount, [&]() {
+      typename ReuseStrategy::ScratchSpace responseScratch;
+      for (uint64_t i = 0; i < iters; i++) {
+        typename ReuseStrategy::MessageBuilder responseMessage(responseScratch);
+        auto response = TestCase::initResponse(responseMessage);
+        TestCase::handleRequest(TestCase::getRequest(reader), response);
+        if (!TestCase::checkResponse(response.asReader(), expected)) {
+          throw std::logic_error("Incorrect response.");
+        }
+      }
+    });
+  }
+};
+
+template <typename TestCase, typename ReuseStrategy, typename Compression>
+uint64_t doThreadedBenchmark(const std::string& mode, uint64_t iters, uint threadCount) {
+  typedef ThreadedBenchmarkMethods<TestCase, ReuseStrategy, Compression> Methods;
+  if (mode == "threads-object") {
+    return Methods::perThreadObjects(iters, threadCount);
+  } else if (mode == "threads-bytes") {
+    return Methods::perThreadBytes(iters, threadCount);
+  } else if (mode == "threads-shared-reader") {
+    return Methods::sharedReader(iters, threadCount);
+  } else {
+    fprintf(stderr, "Unknown mode: %s\n", mode.c_str());
+    exit(1);
+  }
+}
+
+template <typename TestCase, typename ReuseStrategy>
+uint64_t doThreadedBenchmark2(const std::string& mode, const std::string& compression,
+                              uint64_t iters, uint threadCount) {
+  if (compression == "none") {
+    return doThreadedBenchmark<TestCase, ReuseStrategy, Uncompressed>(mode, iters, threadCount);
+  } else if (compression == "packed") {
+    return doThreadedBenchmark<TestCase, ReuseStrategy, Packed>(mode, iters, threadCount);
+#if HAVE_SNAPPY
+  } else if (compression == "snappy") {
+    return doThreadedBenchmark<TestCase, ReuseStrategy, SnappyCompressed>(
+        mode, iters, threadCount);
+#endif  // HAVE_SNAPPY
+  } else {
+    fprintf(stderr, "Unknown compression mode: %s\n", compression.c_str());
+    exit(1);
+  }
+}
+
+template <typename TestCase>
+int benchmarkMainWithThreads(int argc, char* argv[]) {
+  // Like benchmarkMain(), but also accepts the "threads-*" modes, which take the thread count
+  // as an extra argument and print the total iteration count and the wall time of the parallel
+  // section in nanoseconds.
+
+  if (argc < 2 || strncmp(argv[1], "threads-", 8) != 0) {
+    return benchmark::benchmarkMain<BenchmarkTypes, TestCase>(argc, argv);
+  }
+
+  if (argc != 6) {
+    fprintf(stderr, "USAGE:  %s MODE REUSE COMPRESSION ITERATION_COUNT THREAD_COUNT\n", argv[0]);
+    return 1;
+  }
+
+  std::string mode = argv[1];
+  std::string reuse = argv[2];
+  uint64_t iters = strtoull(argv[4], nullptr, 0);
+  uint threadCount = strtoul(argv[5], nullptr, 0);
+  if (threadCount == 0) {
+    fprintf(stderr, "Thread count must be positive.\n");
+    return 1;
+  }
+
+  uint64_t wallNs;
+  if (reuse == "reuse") {
+    wallNs = doThreadedBenchmark2<TestCase, UseScratch>(mode, argv[3], iters, threadCount);
+  } else if (reuse == "no-reuse") {
+    wallNs = doThreadedBenchmark2<TestCase, NoScratch>(mode, argv[3], iters, threadCount);
+  } else {
+    fprintf(stderr, "Unknown reuse mode: %s\n", reuse.c_str());
+    return 1;
+  }
+
+  fprintf(stdout, "%llu %llu\n", (long long unsigned int)(iters * threadCount),
+          (long long unsigned int)wallNs);
+  return 0;
+}
+
 }  // namespace capnp
 }  // namespace benchmark
 }  // namespace capnp
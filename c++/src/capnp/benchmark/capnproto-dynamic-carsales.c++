@@ -0,0 +1,146 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "carsales.capnp.h"
+#include "capnproto-dynamic-common.h"
+
+namespace capnp {
+namespace benchmark {
+namespace capnp {
+
+uint64_t carValue(DynamicStruct::Reader car) {
+  // Do not think too hard about realism.
+
+  uint64_t result = 0;
+
+  result += car.get("seats").as<uint64_t>() * 200;
+  result += car.get("doors").as<uint64_t>() * 350;
+  for (auto wheelValue: car.get("wheels").as<DynamicList>()) {
+    auto wheel = wheelValue.as<DynamicStruct>();
+    uint64_t diameter = wheel.get("diameter").as<uint64_t>();
+    result += diameter * diameter;
+    result += wheel.get("snowTires").as<bool>() ? 100 : 0;
+  }
+
+  result += car.get("length").as<uint64_t>() * car.get("width").as<uint64_t>() *
+            car.get("height").as<uint64_t>() / 50;
+
+  auto engine = car.get("engine").as<DynamicStruct>();
+  result += engine.get("horsepower").as<uint64_t>() * 40;
+  if (engine.get("usesElectric").as<bool>()) {
+    if (engine.get("usesGas").as<bool>()) {
+      // hybrid
+      result += 5000;
+    } else {
+      result += 3000;
+    }
+  }
+
+  result += car.get("hasPowerWindows").as<bool>() ? 100 : 0;
+  result += car.get("hasPowerSteering").as<bool>() ? 200 : 0;
+  result += car.get("hasCruiseControl").as<bool>() ? 400 : 0;
+  result += car.get("hasNavSystem").as<bool>() ? 2000 : 0;
+
+  result += car.get("cupHolders").as<uint64_t>() * 25;
+
+  return result;
+}
+
+void randomCar(DynamicStruct::Builder car) {
+  // Do not think too hard about realism.
+
+  static const char* const MAKES[] = { "Toyota", "GM", "Ford", "Honda", "Tesla" };
+  static const char* const MODELS[] = { "Camry", "Prius", "Volt", "Accord", "Leaf", "Model S" };
+
+  car.set("make", MAKES[fastRand(sizeof(MAKES) / sizeof(MAKES[0]))]);
+  car.set("model", MODELS[fastRand(sizeof(MODELS) / sizeof(MODELS[0]))]);
+
+  car.set("color", fastRand((uint)Color::SILVER + 1));
+  car.set("seats", 2 + fastRand(6));
+  car.set("doors", 2 + fastRand(3));
+
+  for (auto wheelValue: car.init("wheels", 4).as<DynamicList>()) {
+    auto wheel = wheelValue.as<DynamicStruct>();
+    wheel.set("diameter", 25 + fastRand(15));
+    wheel.set("airPressure", 30 + fastRandDouble(20));
+    wheel.set("snowTires", fastRand(16) == 0);
+  }
+
+  uint32_t length = 170 + fastRand(150);
+  uint32_t width = 48 + fastRand(36);
+  uint32_t height = 54 + fastRand(48);
+  car.set("length", length);
+  car.set("width", width);
+  car.set("height", height);
+  car.set("weight", length * width * height / 200);
+
+  auto engine = car.init("engine").as<DynamicStruct>();
+  engine.set("horsepower", 100 * fastRand(400));
+  engine.set("cylinders", 4 + 2 * fastRand(3));
+  engine.set("cc", 800 + fastRand(10000));
+  engine.set("usesGas", true);
+  engine.set("usesElectric", fastRand(2) != 0);
+
+  float fuelCapacity = 10.0 + fastRandDouble(30.0);
+  car.set("fuelCapacity", fuelCapacity);
+  car.set("fuelLevel", fastRandDouble(fuelCapacity));
+  car.set("hasPowerWindows", fastRand(2) != 0);
+  car.set("hasPowerSteering", fastRand(2) != 0);
+  car.set("hasCruiseControl", fastRand(2) != 0);
+  car.set("cupHolders", fastRand(12));
+  car.set("hasNavSystem", fastRand(2) != 0);
+}
+
+class DynamicCarSalesTestCase: public DynamicTestCase<ParkingLot, TotalValue> {
+public:
+  typedef uint64_t Expectation;
+
+  static uint64_t setupRequest(DynamicStruct::Builder request) {
+    uint64_t result = 0;
+    for (auto element: request.init("cars", fastRand(200)).as<DynamicList>()) {
+      auto car = element.as<DynamicStruct>();
+      randomCar(car);
+      result += carValue(car.asReader());
+    }
+    return result;
+  }
+  static void handleRequest(DynamicStruct::Reader request, DynamicStruct::Builder response) {
+    uint64_t result = 0;
+    for (auto car: request.get("cars").as<DynamicList>()) {
+      result += carValue(car.as<DynamicStruct>());
+    }
+    response.set("amount", result);
+  }
+  static inline bool checkResponse(DynamicStruct::Reader response, uint64_t expected) {
+    return response.get("amount").as<uint64_t>() == expected;
+  }
+};
+
+}  // namespace capnp
+}  // namespace benchmark
+}  // namespace capnp
+
+int main(int argc, char* argv[]) {
+  return capnp::benchmark::capnp::benchmarkMainWithThreads<
+      capnp::benchmark::capnp::DynamicCarSalesTestCase>(argc, argv);
+}
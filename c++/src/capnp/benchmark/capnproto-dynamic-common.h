@@ -0,0 +1,81 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CAPNP_BENCHMARK_CAPNP_DYNAMIC_COMMON_H_
+#define CAPNP_BENCHMARK_CAPNP_DYNAMIC_COMMON_H_
+
+#include "capnproto-common.h"
+#include <capnp/dynamic.h>
+#include <capnp/schema-loader.h>
+
+namespace capnp {
+namespace benchmark {
+namespace capnp {
+
+template <typename RequestType, typename ResponseType>
+class DynamicTestCase {
+  // Base class for test cases written against the dynamic API, the way code that only learns its
+  // types at runtime (e.g. a gateway) would be.  The schemas come from a SchemaLoader and are
+  // looked up by ID; the generated types are only used to find the compiled-in schema nodes to
+  // load.  All field access in the subclasses goes through DynamicStruct by name.
+
+public:
+  static inline DynamicStruct::Builder initRequest(MessageBuilder& message) {
+    return message.initRoot<DynamicStruct>(schemas().request);
+  }
+  static inline DynamicStruct::Reader getRequest(MessageReader& message) {
+    return message.getRoot<DynamicStruct>(schemas().request);
+  }
+  static inline DynamicStruct::Builder initResponse(MessageBuilder& message) {
+    return message.initRoot<DynamicStruct>(schemas().response);
+  }
+  static inline DynamicStruct::Reader getResponse(MessageReader& message) {
+    return message.getRoot<DynamicStruct>(schemas().response);
+  }
+
+private:
+  struct Schemas {
+    SchemaLoader loader;
+    StructSchema request;
+    StructSchema response;
+
+    Schemas() {
+      loader.loadCompiledTypeAndDependencies<RequestType>();
+      loader.loadCompiledTypeAndDependencies<ResponseType>();
+      request = loader.get(typeId<RequestType>()).asStruct();
+      response = loader.get(typeId<ResponseType>()).asStruct();
+    }
+  };
+
+  static const Schemas& schemas() {
+    // Loaded on first use, before any timing starts.
+    static const Schemas instance;
+    return instance;
+  }
+};
+
+}  // namespace capnp
+}  // namespace benchmark
+}  // namespace capnp
+
+#endif  // CAPNP_BENCHMARK_CAPNP_DYNAMIC_COMMON_H_
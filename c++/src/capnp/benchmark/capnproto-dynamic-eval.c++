@@ -0,0 +1,114 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "eval.capnp.h"
+#include "capnproto-dynamic-common.h"
+
+namespace capnp {
+namespace benchmark {
+namespace capnp {
+
+int32_t applyOperation(Operation op, int32_t left, int32_t right) {
+  switch (op) {
+    case Operation::ADD:
+      return left + right;
+    case Operation::SUBTRACT:
+      return left - right;
+    case Operation::MULTIPLY:
+      return left * right;
+    case Operation::DIVIDE:
+      return div(left, right);
+    case Operation::MODULUS:
+      return mod(left, right);
+  }
+  throw std::logic_error("Can't get here.");
+}
+
+int32_t makeExpression(DynamicStruct::Builder exp, uint depth) {
+  Operation op = (Operation)(fastRand((int)Operation::MODULUS + 1));
+  exp.set("op", (uint16_t)op);
+
+  uint32_t left, right;
+
+  auto leftGroup = exp.get("left").as<DynamicStruct>();
+  if (fastRand(8) < depth) {
+    left = fastRand(128) + 1;
+    leftGroup.set("value", left);
+  } else {
+    left = makeExpression(leftGroup.init("expression").as<DynamicStruct>(), depth + 1);
+  }
+
+  auto rightGroup = exp.get("right").as<DynamicStruct>();
+  if (fastRand(8) < depth) {
+    right = fastRand(128) + 1;
+    rightGroup.set("value", right);
+  } else {
+    right = makeExpression(rightGroup.init("expression").as<DynamicStruct>(), depth + 1);
+  }
+
+  return applyOperation(op, left, right);
+}
+
+int32_t evaluateExpression(DynamicStruct::Reader exp);
+
+int32_t evaluateOperand(DynamicStruct::Reader operand) {
+  KJ_IF_MAYBE(field, operand.which()) {
+    if (field->getProto().getName() == "value") {
+      return operand.get(*field).as<int32_t>();
+    } else {
+      return evaluateExpression(operand.get(*field).as<DynamicStruct>());
+    }
+  }
+  throw std::logic_error("Unknown operand.");
+}
+
+int32_t evaluateExpression(DynamicStruct::Reader exp) {
+  int32_t left = evaluateOperand(exp.get("left").as<DynamicStruct>());
+  int32_t right = evaluateOperand(exp.get("right").as<DynamicStruct>());
+  return applyOperation((Operation)exp.get("op").as<DynamicEnum>().getRaw(), left, right);
+}
+
+class DynamicExpressionTestCase: public DynamicTestCase<Expression, EvaluationResult> {
+public:
+  typedef int32_t Expectation;
+
+  static inline int32_t setupRequest(DynamicStruct::Builder request) {
+    return makeExpression(request, 0);
+  }
+  static inline void handleRequest(DynamicStruct::Reader request,
+                                   DynamicStruct::Builder response) {
+    response.set("value", evaluateExpression(request));
+  }
+  static inline bool checkResponse(DynamicStruct::Reader response, int32_t expected) {
+    return response.get("value").as<int32_t>() == expected;
+  }
+};
+
+}  // namespace capnp
+}  // namespace benchmark
+}  // namespace capnp
+
+int main(int argc, char* argv[]) {
+  return capnp::benchmark::capnp::benchmarkMainWithThreads<
+      capnp::benchmark::capnp::DynamicExpressionTestCase>(argc, argv);
+}
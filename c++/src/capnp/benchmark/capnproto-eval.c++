@@ -21,106 +21,9 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "eval.capnp.h"
-#include "capnproto-common.h"
-
-namespace capnp {
-namespace benchmark {
-namespace capnp {
-
-int32_t makeExpression(Expression::Builder exp, uint depth) {
-  exp.setOp((Operation)(fastRand((int)Operation::MODULUS + 1)));
-
-  uint32_t left, right;
-
-  if (fastRand(8) < depth) {
-    left = fastRand(128) + 1;
-    exp.getLeft().setValue(left);
-  } else {
-    left = makeExpression(exp.getLeft().initExpression(), depth + 1);
-  }
-
-  if (fastRand(8) < depth) {
-    right = fastRand(128) + 1;
-    exp.getRight().setValue(right);
-  } else {
-    right = makeExpression(exp.getRight().initExpression(), depth + 1);
-  }
-
-  switch (exp.getOp()) {
-    case Operation::ADD:
-      return left + right;
-    case Operation::SUBTRACT:
-      return left - right;
-    case Operation::MULTIPLY:
-      return left * right;
-    case Operation::DIVIDE:
-      return div(left, right);
-    case Operation::MODULUS:
-      return mod(left, right);
-  }
-  throw std::logic_error("Can't get here.");
-}
-
-int32_t evaluateExpression(Expression::Reader exp) {
-  int32_t left = 0, right = 0;
-
-  switch (exp.getLeft().which()) {
-    case Expression::Left::VALUE:
-      left = exp.getLeft().getValue();
-      break;
-    case Expression::Left::EXPRESSION:
-      left = evaluateExpression(exp.getLeft().getExpression());
-      break;
-  }
-
-  switch (exp.getRight().which()) {
-    case Expression::Right::VALUE:
-      right = exp.getRight().getValue();
-      break;
-    case Expression::Right::EXPRESSION:
-      right = evaluateExpression(exp.getRight().getExpression());
-      break;
-  }
-
-  switch (exp.getOp()) {
-    case Operation::ADD:
-      return left + right;
-    case Operation::SUBTRACT:
-      return left - right;
-    case Operation::MULTIPLY:
-      return left * right;
-    case Operation::DIVIDE:
-      return div(left, right);
-    case Operation::MODULUS:
-      return mod(left, right);
-  }
-  throw std::logic_error("Can't get here.");
-}
-
-class ExpressionTestCase {
-public:
-  typedef Expression Request;
-  typedef EvaluationResult Response;
-  typedef int32_t Expectation;
-
-  static inline int32_t setupRequest(Expression::Builder request) {
-    return makeExpression(request, 0);
-  }
-  static inline void handleRequest(Expression::Reader request, EvaluationResult::Builder response) {
-    response.setValue(evaluateExpression(request));
-  }
-  static inline bool checkResponse(EvaluationResult::Reader response, int32_t expected) {
-    return response.getValue() == expected;
-  }
-};
-
-}  // namespace capnp
-}  // namespace benchmark
-}  // namespace capnp
+#include "capnproto-eval.h"
 
 int main(int argc, char* argv[]) {
-  return capnp::benchmark::benchmarkMain<
-      capnp::benchmark::capnp::BenchmarkTypes,
+  return capnp::benchmark::capnp::benchmarkMainWithThreads<
       capnp::benchmark::capnp::ExpressionTestCase>(argc, argv);
 }
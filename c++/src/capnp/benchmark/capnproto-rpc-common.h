@@ -0,0 +1,296 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CAPNP_BENCHMARK_CAPNP_RPC_COMMON_H_
+#define CAPNP_BENCHMARK_CAPNP_RPC_COMMON_H_
+
+// Harness for running the benchmark test cases as RPC calls.  Each `capnproto-rpc-*` program
+// includes this header together with the header for its test case, exactly once per binary
+// (like `capnproto-common.h`, this header defines non-inline globals).
+
+#include "capnproto-common.h"
+#include "rpc.capnp.h"
+#include <capnp/ez-rpc.h>
+#include <capnp/rpc-twoparty.h>
+#include <capnp/rpc.capnp.h>
+#include <kj/async-io.h>
+#include <atomic>
+#include <new>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+namespace capnp {
+namespace benchmark {
+namespace capnp {
+
+std::atomic<uint64_t> allocationCount(0);
+// Number of calls to the global operator new (replaced below) since the process started.  Note
+// that message segments allocated by MallocMessageBuilder come from calloc() and are not counted.
+
+}  // namespace capnp
+}  // namespace benchmark
+}  // namespace capnp
+
+void* operator new(size_t size) {
+  capnp::benchmark::capnp::allocationCount.fetch_add(1, std::memory_order_relaxed);
+  void* result = malloc(size);
+  if (result == nullptr) throw std::bad_alloc();
+  return result;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+namespace capnp {
+namespace benchmark {
+namespace capnp {
+
+static constexpr uint RPC_PIPELINE_DEPTH = 64;
+// Number of calls kept in flight by the pipelined modes.
+
+struct RpcStats {
+  LatencyHistogram latency;
+  // Round-trip time of each call, in nanoseconds, measured from send() until the response
+  // arrives.
+
+  uint64_t startAllocations = 0;
+  uint64_t endAllocations = 0;
+  uint64_t startTime = 0;
+  uint64_t endTime = 0;
+
+  void start() {
+    startAllocations = allocationCount.load(std::memory_order_relaxed);
+    startTime = monotonicNanos();
+  }
+
+  void finish() {
+    endTime = monotonicNanos();
+    endAllocations = allocationCount.load(std::memory_order_relaxed);
+  }
+
+  void report(FILE* out) {
+    // Parsed by the runner:  "CALLS WALL_NS ALLOCATIONS" followed by the latency histogram.
+    fprintf(out, "%llu %llu %llu\n",
+            (long long unsigned int)latency.count(),
+            (long long unsigned int)(endTime - startTime),
+            (long long unsigned int)(endAllocations - startAllocations));
+    latency.write(out);
+  }
+};
+
+template <typename TestCase, typename Service>
+class ServiceImpl final: public Service::Server {
+public:
+  kj::Promise<void> handle(typename Service::Server::HandleContext context) override {
+    TestCase::handleRequest(context.getParams().getRequest(),
+                            context.getResults().initResponse());
+    return kj::READY_NOW;
+  }
+};
+
+class SingleCapRestorer final: public SturdyRefRestorer<Text> {
+  // Serves the same capability for every object ID.
+
+public:
+  explicit SingleCapRestorer(Capability::Client cap): cap(kj::mv(cap)) {}
+
+  Capability::Client restore(Text::Reader name) override {
+    return cap;
+  }
+
+private:
+  Capability::Client cap;
+};
+
+template <typename TestCase, typename Service>
+class RpcClientLoop {
+  // Issues `iters` calls, keeping up to `depth` of them in flight.  With depth 1 each call waits
+  // for the previous response, like the "pipe" mode; larger depths are like "pipe-async".
+
+public:
+  RpcClientLoop(typename Service::Client service, uint64_t iters, RpcStats& stats)
+      : service(kj::mv(service)), remaining(iters), stats(stats) {}
+
+  void run(uint depth, kj::WaitScope& waitScope) {
+    auto promises = kj::heapArrayBuilder<kj::Promise<void>>(depth);
+    for (uint i = 0; i < depth; i++) {
+      promises.add(sendNext());
+    }
+    for (auto& promise: promises) {
+      promise.wait(waitScope);
+    }
+  }
+
+private:
+  typename Service::Client service;
+  uint64_t remaining;
+  RpcStats& stats;
+
+  kj::Promise<void> sendNext() {
+    if (remaining == 0) return kj::READY_NOW;
+    --remaining;
+
+    auto request = service.handleRequest();
+    typename TestCase::Expectation expected = TestCase::setupRequest(request.initRequest());
+    uint64_t start = monotonicNanos();
+    return request.send().then(
+        [this,expected,start](Response<typename Service::HandleResults>&& response) {
+      stats.latency.record(monotonicNanos() - start);
+      if (!TestCase::checkResponse(response.getResponse(), expected)) {
+        throw std::logic_error("Incorrect response.");
+      }
+      return sendNext();
+    });
+  }
+};
+
+template <typename TestCase, typename Service>
+void runRpcLocal(uint64_t iters, uint depth, TwoPartyVatNetwork::Encoding encoding,
+                 RpcStats& stats) {
+  // Client and server are two TwoPartyVatNetworks joined by an in-process pipe, sharing one
+  // thread and event loop.
+
+  auto ioContext = kj::setupAsyncIo();
+  auto pipe = ioContext.provider->newTwoWayPipe();
+
+  SingleCapRestorer restorer(kj::heap<ServiceImpl<TestCase, Service>>());
+  TwoPartyVatNetwork serverNetwork(*pipe.ends[0], rpc::twoparty::Side::SERVER,
+                                   ReaderOptions(), encoding);
+  auto server = makeRpcServer(serverNetwork, restorer);
+
+  TwoPartyVatNetwork clientNetwork(*pipe.ends[1], rpc::twoparty::Side::CLIENT,
+                                   ReaderOptions(), encoding);
+  auto client = makeRpcClient(clientNetwork);
+
+  MallocMessageBuilder refMessage;
+  auto ref = refMessage.initRoot<rpc::SturdyRef>();
+  ref.getHostId().initAs<rpc::twoparty::SturdyRefHostId>()
+     .setSide(rpc::twoparty::Side::SERVER);
+  ref.getObjectId().setAs<Text>("service");
+  auto service = client.restore(ref.getHostId().getAs<rpc::twoparty::SturdyRefHostId>(),
+                                ref.getObjectId()).template castAs<Service>();
+
+  RpcClientLoop<TestCase, Service> loop(kj::mv(service), iters, stats);
+  stats.start();
+  loop.run(depth, ioContext.waitScope);
+  stats.finish();
+}
+
+template <typename TestCase, typename Service>
+void runRpcEz(uint64_t iters, uint depth, RpcStats& stats) {
+  // EzRpcServer in a child process, EzRpcClient in this one, over loopback TCP.  Allocations are
+  // only counted on the client side.
+
+  int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd < 0) throw OsException(errno);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addrLen = sizeof(addr);
+  if (bind(listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(listenFd, 1) < 0 ||
+      getsockname(listenFd, reinterpret_cast<struct sockaddr*>(&addr), &addrLen) < 0) {
+    throw OsException(errno);
+  }
+  uint port = ntohs(addr.sin_port);
+
+  // Fork before either side creates an event loop.
+  pid_t child = fork();
+  if (child < 0) throw OsException(errno);
+  if (child == 0) {
+    EzRpcServer server(listenFd, port);
+    server.exportCap("service", kj::heap<ServiceImpl<TestCase, Service>>());
+    kj::NEVER_DONE.wait(server.getWaitScope());
+  }
+  close(listenFd);
+
+  {
+    EzRpcClient client("127.0.0.1", port);
+    RpcClientLoop<TestCase, Service> loop(
+        client.importCap<Service>("service"), iters, stats);
+    stats.start();
+    loop.run(depth, client.getWaitScope());
+    stats.finish();
+  }
+
+  kill(child, SIGTERM);
+  int status;
+  if (waitpid(child, &status, 0) != child) {
+    throw OsException(errno);
+  }
+}
+
+template <typename TestCase, typename Service>
+int rpcBenchmarkMain(int argc, char* argv[]) {
+  // Takes the same arguments as benchmarkMain() so that the runner can invoke both the same way.
+  // REUSE is accepted but ignored:  RPC messages are never reused.
+
+  if (argc != 5) {
+    fprintf(stderr, "USAGE:  %s MODE REUSE COMPRESSION ITERATION_COUNT\n", argv[0]);
+    return 1;
+  }
+
+  std::string mode = argv[1];
+  std::string compression = argv[3];
+  uint64_t iters = strtoull(argv[4], nullptr, 0);
+
+  TwoPartyVatNetwork::Encoding encoding;
+  if (compression == "none") {
+    encoding = TwoPartyVatNetwork::Encoding::UNPACKED;
+  } else if (compression == "packed") {
+    encoding = TwoPartyVatNetwork::Encoding::PACKED;
+  } else {
+    fprintf(stderr, "Unsupported compression mode for RPC: %s\n", compression.c_str());
+    return 1;
+  }
+
+  RpcStats stats;
+  if (mode == "rpc-local") {
+    runRpcLocal<TestCase, Service>(iters, 1, encoding, stats);
+  } else if (mode == "rpc-local-pipelined") {
+    runRpcLocal<TestCase, Service>(iters, RPC_PIPELINE_DEPTH, encoding, stats);
+  } else if (mode == "rpc-ez" || mode == "rpc-ez-pipelined") {
+    if (encoding != TwoPartyVatNetwork::Encoding::UNPACKED) {
+      fprintf(stderr, "EzRpc does not support packed encoding.\n");
+      return 1;
+    }
+    runRpcEz<TestCase, Service>(iters, mode == "rpc-ez" ? 1 : RPC_PIPELINE_DEPTH, stats);
+  } else {
+    fprintf(stderr, "Unknown mode: %s\n", mode.c_str());
+    return 1;
+  }
+
+  stats.report(stdout);
+  return 0;
+}
+
+}  // namespace capnp
+}  // namespace benchmark
+}  // namespace capnp
+
+#endif  // CAPNP_BENCHMARK_CAPNP_RPC_COMMON_H_
@@ -24,6 +24,7 @@
 #ifndef CAPNP_BENCHMARK_COMMON_H_
 #define CAPNP_BENCHMARK_COMMON_H_
 
+#include "histogram.h"
 #include <unistd.h>
 #include <limits>
 #include <errno.h>
@@ -46,7 +47,7 @@ namespace benchmark {
 static inline uint32_t nextFastRand() {
   static constexpr uint32_t A = 1664525;
   static constexpr uint32_t C = 1013904223;
-  static uint32_t state = C;
+  static thread_local uint32_t state = C;
   state = A * state + C;
   return state;
 }
@@ -83,6 +84,32 @@ static const char* const WORDS[] = {
 };
 constexpr size_t WORDS_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
 
+static LatencyHistogram* iterationLatency = nullptr;
+// If non-null, the in-process benchmark loops record the time taken by each iteration here.
+// Set by benchmarkMain() when the "latency" argument is given.
+
+class IterationTimer {
+  // Times consecutive iterations of a benchmark loop into `iterationLatency`.  Costs a single
+  // branch per iteration when latency recording is off.
+
+public:
+  IterationTimer()
+      : histogram(iterationLatency),
+        last(histogram == nullptr ? 0 : monotonicNanos()) {}
+
+  inline void lap() {
+    if (histogram != nullptr) {
+      uint64_t now = monotonicNanos();
+      histogram->record(now - last);
+      last = now;
+    }
+  }
+
+private:
+  LatencyHistogram* histogram;
+  uint64_t last;
+};
+
 template <typename T>
 class ProducerConsumerQueue {
 public:
@@ -269,14 +296,24 @@ uint64_t doBenchmark3(const std::string& mode, const std::string& reuse,
 
 template <typename BenchmarkTypes, typename TestCase>
 int benchmarkMain(int argc, char* argv[]) {
-  if (argc != 5) {
-    fprintf(stderr, "USAGE:  %s MODE REUSE COMPRESSION ITERATION_COUNT\n", argv[0]);
+  if ((argc != 5 && argc != 6) || (argc == 6 && strcmp(argv[5], "latency") != 0)) {
+    fprintf(stderr, "USAGE:  %s MODE REUSE COMPRESSION ITERATION_COUNT [latency]\n", argv[0]);
     return 1;
   }
 
+  // Per-iteration latency is only recorded by the "object" and "bytes" modes; the pipe modes
+  // run their client in a separate process.
+  LatencyHistogram latency;
+  if (argc == 6) {
+    iterationLatency = &latency;
+  }
+
   uint64_t iters = strtoull(argv[4], nullptr, 0);
   uint64_t throughput = doBenchmark3<BenchmarkTypes, TestCase>(argv[1], argv[2], argv[3], iters);
   fprintf(stdout, "%llu\n", (long long unsigned int)throughput);
+  if (argc == 6) {
+    latency.write(stdout);
+  }
 
   return 0;
 }
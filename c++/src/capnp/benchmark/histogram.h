@@ -0,0 +1,164 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CAPNP_BENCHMARK_HISTOGRAM_H_
+#define CAPNP_BENCHMARK_HISTOGRAM_H_
+
+// Latency histogram shared by the benchmark programs, which record into it, and the runner,
+// which merges and reports it.  Deliberately depends on nothing but libc so the runner can stay
+// free of Cap'n Proto and protobuf.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace capnp {
+namespace benchmark {
+
+class LatencyHistogram {
+  // HDR-style histogram of durations in nanoseconds.  Values below 32 get exact buckets; above
+  // that, each power of two is split into 16 linear buckets, so every recorded value is known to
+  // within 1/16 (6.25%) of its true value.  The table has a fixed size, so record() never
+  // allocates and costs only a bit scan and an increment.
+
+public:
+  enum {
+    LINEAR_BUCKETS = 32,
+    SUB_BUCKET_BITS = 4,
+    SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+    BUCKET_COUNT = LINEAR_BUCKETS + (64 - 5) * SUB_BUCKETS
+  };
+
+  LatencyHistogram() { clear(); }
+
+  void clear() {
+    memset(counts, 0, sizeof(counts));
+    total = 0;
+  }
+
+  inline void record(uint64_t value) {
+    ++counts[bucketIndex(value)];
+    ++total;
+  }
+
+  void merge(const LatencyHistogram& other) {
+    for (uint i = 0; i < BUCKET_COUNT; i++) {
+      counts[i] += other.counts[i];
+    }
+    total += other.total;
+  }
+
+  uint64_t count() const { return total; }
+
+  uint64_t percentile(double fraction) const {
+    // Returns the highest value that falls in the same bucket as the requested percentile, or
+    // zero if nothing has been recorded.
+
+    if (total == 0) return 0;
+    uint64_t rank = fraction * total;
+    if (rank >= total) rank = total - 1;
+    uint64_t seen = 0;
+    for (uint i = 0; i < BUCKET_COUNT; i++) {
+      seen += counts[i];
+      if (seen > rank) return bucketMax(i);
+    }
+    return bucketMax(BUCKET_COUNT - 1);
+  }
+
+  uint64_t max() const {
+    for (uint i = BUCKET_COUNT; i > 0; i--) {
+      if (counts[i - 1] != 0) return bucketMax(i - 1);
+    }
+    return 0;
+  }
+
+  void write(FILE* out) const {
+    // Writes a single line of the form "latency INDEX:COUNT INDEX:COUNT ...", listing non-empty
+    // buckets only.
+
+    fputs("latency", out);
+    for (uint i = 0; i < BUCKET_COUNT; i++) {
+      if (counts[i] != 0) {
+        fprintf(out, " %u:%llu", i, (long long unsigned int)counts[i]);
+      }
+    }
+    fputc('\n', out);
+  }
+
+  bool parse(const char* line) {
+    // Merges in a line produced by write().  Returns false if `line` is not such a line.
+
+    if (strncmp(line, "latency", 7) != 0) return false;
+    const char* pos = line + 7;
+    for (;;) {
+      char* end;
+      unsigned long index = strtoul(pos, &end, 10);
+      if (end == pos || *end != ':') break;
+      pos = end + 1;
+      unsigned long long count = strtoull(pos, &end, 10);
+      if (end == pos || index >= BUCKET_COUNT) return false;
+      pos = end;
+      counts[index] += count;
+      total += count;
+    }
+    return true;
+  }
+
+  static inline uint bucketIndex(uint64_t value) {
+    if (value < LINEAR_BUCKETS) return value;
+    uint msb = 63 - __builtin_clzll(value);
+    uint shift = msb - SUB_BUCKET_BITS;
+    uint sub = (value >> shift) - SUB_BUCKETS;
+    return LINEAR_BUCKETS + (msb - 5) * SUB_BUCKETS + sub;
+  }
+
+  static inline uint64_t bucketMin(uint index) {
+    if (index < LINEAR_BUCKETS) return index;
+    uint msb = (index - LINEAR_BUCKETS) / SUB_BUCKETS + 5;
+    uint64_t sub = (index - LINEAR_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS;
+    return sub << (msb - SUB_BUCKET_BITS);
+  }
+
+  static inline uint64_t bucketMax(uint index) {
+    if (index < LINEAR_BUCKETS) return index;
+    uint msb = (index - LINEAR_BUCKETS) / SUB_BUCKETS + 5;
+    return bucketMin(index) + ((uint64_t)1 << (msb - SUB_BUCKET_BITS)) - 1;
+  }
+
+private:
+  uint64_t counts[BUCKET_COUNT];
+  uint64_t total;
+};
+
+static inline uint64_t monotonicNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace benchmark
+}  // namespace capnp
+
+#endif  // CAPNP_BENCHMARK_HISTOGRAM_H_
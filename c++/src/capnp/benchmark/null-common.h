@@ -133,6 +133,7 @@ struct BenchmarkMethods {
   static uint64_t passByObject(uint64_t iters, bool countObjectSize) {
     typename ReuseStrategy::ObjectSizeCounter sizeCounter(iters);
 
+    IterationTimer timer;
     for (; iters > 0; --iters) {
       arenaPos = arena;
 
@@ -146,6 +147,8 @@ struct BenchmarkMethods {
       }
 
       sizeCounter.add((arenaPos - arena) * sizeof(arena[0]));
+
+      timer.lap();
     }
 
     return sizeCounter.get();
@@ -277,6 +277,7 @@ struct BenchmarkMethods {
     REUSABLE(Request) reusableRequest;
     REUSABLE(Response) reusableResponse;
 
+    IterationTimer timer;
     for (; iters > 0; --iters) {
       SINGLE_USE(Request) request(reusableRequest);
       typename TestCase::Expectation expected = TestCase::setupRequest(&request);
@@ -293,6 +294,8 @@ struct BenchmarkMethods {
         throughput += request.SpaceUsed();
         throughput += response.SpaceUsed();
       }
+
+      timer.lap();
     }
 
     return throughput;
@@ -307,6 +310,7 @@ struct BenchmarkMethods {
     REUSABLE(Response) reusableClientResponse;
     typename ReuseStrategy::ReusableString reusableRequestString, reusableResponseString;
 
+    IterationTimer timer;
     for (; iters > 0; --iters) {
       SINGLE_USE(Request) clientRequest(reusableClientRequest);
       typename TestCase::Expectation expected = TestCase::setupRequest(&clientRequest);
@@ -335,6 +339,8 @@ struct BenchmarkMethods {
         throw std::logic_error("Incorrect response.");
       }
       ReuseStrategy::doneWith(clientResponse);
+
+      timer.lap();
     }
 
     return throughput;
@@ -21,6 +21,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "histogram.h"
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -33,6 +34,8 @@
 #include <string.h>
 #include <iostream>
 #include <iomanip>
+#include <math.h>
+#include <vector>
 
 using namespace std;
 
@@ -77,14 +80,121 @@ Times currentTimes() {
   return result;
 }
 
+class TimesStats {
+  // Accumulates the Times from repeated runs of one test.
+
+public:
+  void add(const Times& times) {
+    samples.push_back(times);
+  }
+
+  Times mean() const {
+    Times result = {0, 0, 0};
+    if (samples.empty()) return result;
+    for (auto& sample: samples) {
+      result.real += sample.real;
+      result.user += sample.user;
+      result.sys += sample.sys;
+    }
+    result.real /= samples.size();
+    result.user /= samples.size();
+    result.sys /= samples.size();
+    return result;
+  }
+
+  Times stddev() const {
+    // Sample standard deviation; zero when there is only one run.
+    Times result = {0, 0, 0};
+    if (samples.size() < 2) return result;
+    Times m = mean();
+    double real = 0, user = 0, sys = 0;
+    for (auto& sample: samples) {
+      real += square((double)sample.real - m.real);
+      user += square((double)sample.user - m.user);
+      sys += square((double)sample.sys - m.sys);
+    }
+    size_t n = samples.size() - 1;
+    result.real = sqrt(real / n);
+    result.user = sqrt(user / n);
+    result.sys = sqrt(sys / n);
+    return result;
+  }
+
+private:
+  std::vector<Times> samples;
+
+  static double square(double x) { return x * x; }
+};
+
 struct TestResult {
   uint64_t objectSize;
   uint64_t messageSize;
+  Times time;     // mean over repeats
+  Times stddev;   // across repeats
+  LatencyHistogram latency;  // per-iteration, merged over repeats; empty unless requested
+};
+
+struct RpcResult {
+  uint64_t calls;
+  uint64_t wallNs;      // as measured by the client, excluding setup
+  uint64_t allocations;
   Times time;
+  Times stddev;
+  LatencyHistogram latency;  // per-call round trip
+};
+
+// Options affecting every test run.
+uint repeatCount = 1;
+bool recordLatency = false;
+
+enum class OutputFormat {
+  TEXT,
+  JSON,
+  CSV
 };
 
+struct Record {
+  // One row of machine-readable output.
+
+  string name;
+  uint64_t iters;       // iterations or calls
+  uint64_t objectSize;
+  uint64_t messageSize;
+  Times time;
+  Times stddev;
+  double allocationsPerCall;
+  bool hasAllocations;
+  uint64_t latencyCount;
+  uint64_t p50, p90, p99, p999, max;
+};
+
+vector<Record> records;
+
+void addRecord(const char* name, uint64_t iters, uint64_t objectSize, uint64_t messageSize,
+               const Times& time, const Times& stddev, const LatencyHistogram& latency,
+               bool hasAllocations, double allocationsPerCall) {
+  Record record;
+  record.name = name;
+  record.iters = iters;
+  record.objectSize = objectSize;
+  record.messageSize = messageSize;
+  record.time = time;
+  record.stddev = stddev;
+  record.hasAllocations = hasAllocations;
+  record.allocationsPerCall = allocationsPerCall;
+  record.latencyCount = latency.count();
+  record.p50 = latency.percentile(0.5);
+  record.p90 = latency.percentile(0.9);
+  record.p99 = latency.percentile(0.99);
+  record.p999 = latency.percentile(0.999);
+  record.max = latency.max();
+  records.push_back(record);
+}
+
 enum class Product {
   CAPNPROTO,
+  CAPNPROTO_DYNAMIC,
+  CAPNPROTO_RPC,
   PROTOBUF,
   NULLCASE
 };
@@ -113,7 +223,14 @@ enum class Mode {
   OBJECT_SIZE,
   BYTES,
   PIPE_SYNC,
-  PIPE_ASYNC
+  PIPE_ASYNC,
+  RPC_LOCAL,
+  RPC_LOCAL_PIPELINED,
+  RPC_EZ,
+  RPC_EZ_PIPELINED,
+  THREADS_OBJECT,
+  THREADS_BYTES,
+  THREADS_SHARED_READER
 };
 
 enum class Reuse {
@@ -127,9 +244,14 @@ enum class Compression {
   SNAPPY
 };
 
-TestResult runTest(Product product, TestCase testCase, Mode mode, Reuse reuse,
-                   Compression compression, uint64_t iters) {
-  char* argv[6];
+template <typename Func>
+Times runChild(Product product, TestCase testCase, Mode mode, Reuse reuse,
+               Compression compression, uint64_t iters, uint threadCount, Func&& readOutput) {
+  // Runs the benchmark program for `product` and `testCase`, passing its stdout to
+  // `readOutput(FILE*)`, and returns the child's resource usage.  `threadCount` is only passed
+  // for the THREADS_* modes.
+
+  char* argv[7];
 
   string progName;
 
@@ -137,6 +259,12 @@ TestResult runTest(Product product, TestCase testCase, Mode mode, Reuse reuse,
     case Product::CAPNPROTO:
       progName = "capnproto-";
       break;
+    case Product::CAPNPROTO_DYNAMIC:
+      progName = "capnproto-dynamic-";
+      break;
+    case Product::CAPNPROTO_RPC:
+      progName = "capnproto-rpc-";
+      break;
     case Product::PROTOBUF:
       progName = "protobuf-";
       break;
@@ -164,6 +292,27 @@ TestResult runTest(Product product, TestCase testCase, Mode mode, Reuse reuse,
     case Mode::PIPE_ASYNC:
       argv[1] = strdup("pipe-async");
       break;
+    case Mode::RPC_LOCAL:
+      argv[1] = strdup("rpc-local");
+      break;
+    case Mode::RPC_LOCAL_PIPELINED:
+      argv[1] = strdup("rpc-local-pipelined");
+      break;
+    case Mode::RPC_EZ:
+      argv[1] = strdup("rpc-ez");
+      break;
+    case Mode::RPC_EZ_PIPELINED:
+      argv[1] = strdup("rpc-ez-pipelined");
+      break;
+    case Mode::THREADS_OBJECT:
+      argv[1] = strdup("threads-object");
+      break;
+    case Mode::THREADS_BYTES:
+      argv[1] = strdup("threads-bytes");
+      break;
+    case Mode::THREADS_SHARED_READER:
+      argv[1] = strdup("threads-shared-reader");
+      break;
   }
 
   switch (reuse) {
@@ -191,7 +340,16 @@ TestResult runTest(Product product, TestCase testCase, Mode mode, Reuse reuse,
   sprintf(itersStr, "%llu", (long long unsigned int)iters);
   argv[4] = itersStr;
 
-  argv[5] = nullptr;
+  // The RPC programs always report latency; the threaded modes never do.
+  if (threadCount > 0) {
+    argv[5] = strdup(to_string(threadCount).c_str());
+    argv[6] = nullptr;
+  } else if (recordLatency && product != Product::CAPNPROTO_RPC) {
+    argv[5] = strdup("latency");
+    argv[6] = nullptr;
+  } else {
+    argv[5] = nullptr;
+  }
 
   // Make pipe for child to write throughput.
   int childPipe[2];
@@ -216,13 +374,10 @@ TestResult runTest(Product product, TestCase testCase, Mode mode, Reuse reuse,
   for (int i = 0; i < 4; i++) {
     free(argv[i]);
   }
+  free(argv[5]);
 
-  // Read throughput number written to child's stdout.
   FILE* input = fdopen(childPipe[0], "r");
-  long long unsigned int throughput;
-  if (fscanf(input, "%lld", &throughput) != 1) {
-    fprintf(stderr, "Child didn't write throughput to stdout.");
-  }
+  readOutput(input);
   char buffer[1024];
   while (fgets(buffer, sizeof(buffer), input) != nullptr) {
     // Loop until EOF.
@@ -235,37 +390,121 @@ TestResult runTest(Product product, TestCase testCase, Mode mode, Reuse reuse,
   wait4(child, &status, 0, &usage);
   gettimeofday(&end, nullptr);
 
-  // Calculate results.
+  Times result;
+  result.real = asNanosecs(end) - asNanosecs(start);
+  result.user = asNanosecs(usage.ru_utime);
+  result.sys = asNanosecs(usage.ru_stime);
+  return result;
+}
 
+void readLatency(FILE* input, LatencyHistogram& latency) {
+  // Merges any latency lines remaining in the child's output into `latency`.
+  char buffer[65536];
+  while (fgets(buffer, sizeof(buffer), input) != nullptr) {
+    latency.parse(buffer);
+  }
+}
+
+TestResult runTest(Product product, TestCase testCase, Mode mode, Reuse reuse,
+                   Compression compression, uint64_t iters) {
   TestResult result;
-  result.objectSize = mode == Mode::OBJECT_SIZE ? throughput : 0;
-  result.messageSize = mode == Mode::OBJECT_SIZE ? 0 : throughput;
-  result.time.real = asNanosecs(end) - asNanosecs(start);
-  result.time.user = asNanosecs(usage.ru_utime);
-  result.time.sys = asNanosecs(usage.ru_stime);
+  TimesStats times;
+
+  for (uint i = 0; i < repeatCount; i++) {
+    // Read throughput number written to child's stdout.
+    long long unsigned int throughput = 0;
+    times.add(runChild(product, testCase, mode, reuse, compression, iters, 0, [&](FILE* input) {
+      if (fscanf(input, "%lld", &throughput) != 1) {
+        fprintf(stderr, "Child didn't write throughput to stdout.");
+      }
+      readLatency(input, result.latency);
+    }));
+
+    // Calculate results.  Sizes are deterministic, so the last run's are as good as any.
+    result.objectSize = mode == Mode::OBJECT_SIZE ? throughput : 0;
+    result.messageSize = mode == Mode::OBJECT_SIZE ? 0 : throughput;
+  }
+
+  result.time = times.mean();
+  result.stddev = times.stddev();
+
+  return result;
+}
+
+RpcResult runRpcTest(TestCase testCase, Mode mode, Compression compression, uint64_t iters) {
+  RpcResult result;
+  result.calls = 0;
+  result.wallNs = 0;
+  result.allocations = 0;
+  TimesStats times;
+
+  for (uint i = 0; i < repeatCount; i++) {
+    times.add(runChild(Product::CAPNPROTO_RPC, testCase, mode, Reuse::YES, compression, iters, 0,
+                       [&](FILE* input) {
+      long long unsigned int calls, wallNs, allocations;
+      if (fscanf(input, "%llu %llu %llu", &calls, &wallNs, &allocations) != 3) {
+        fprintf(stderr, "Child didn't write RPC statistics to stdout.");
+        return;
+      }
+      result.calls += calls;
+      result.wallNs += wallNs;
+      result.allocations += allocations;
+      readLatency(input, result.latency);
+    }));
+  }
 
+  result.time = times.mean();
+  result.stddev = times.stddev();
   return result;
 }
 
 void reportTableHeader() {
+  int width = 90;
   cout << setw(40) << left << "Test"
        << setw(10) << right << "obj size"
        << setw(10) << right << "I/O bytes"
        << setw(10) << right << "wall ns"
        << setw(10) << right << "user ns"
-       << setw(10) << right << "sys ns"
-       << endl;
-  cout << setfill('=') << setw(90) << "" << setfill(' ') << endl;
+       << setw(10) << right << "sys ns";
+  if (repeatCount > 1) {
+    cout << setw(10) << right << "+/- wall";
+    width += 10;
+  }
+  if (recordLatency) {
+    cout << setw(10) << right << "p50 ns"
+         << setw(10) << right << "p99 ns"
+         << setw(10) << right << "p999 ns";
+    width += 30;
+  }
+  cout << endl;
+  cout << setfill('=') << setw(width) << "" << setfill(' ') << endl;
+}
+
+void reportVariance(const Times& time, const Times& stddev) {
+  // Relative standard deviation of wall time across repeats.
+  if (repeatCount > 1) {
+    double percent = time.real == 0 ? 0 : stddev.real * 100.0 / time.real;
+    cout << setw(9) << right << fixed << setprecision(1) << percent << "%";
+  }
 }
 
 void reportResults(const char* name, uint64_t iters, TestResult results) {
+  addRecord(name, iters, results.objectSize / iters, results.messageSize / iters,
+            results.time, results.stddev, results.latency, false, 0);
+
   cout << setw(40) << left << name
        << setw(10) << right << (results.objectSize / iters)
        << setw(10) << right << (results.messageSize / iters)
        << setw(10) << right << (results.time.real / iters)
        << setw(10) << right << (results.time.user / iters)
-       << setw(10) << right << (results.time.sys / iters)
-       << endl;
+       << setw(10) << right << (results.time.sys / iters);
+  reportVariance(results.time, results.stddev);
+  if (recordLatency) {
+    cout << setw(10) << right << results.latency.percentile(0.5)
+         << setw(10) << right << results.latency.percentile(0.99)
+         << setw(10) << right << results.latency.percentile(0.999);
+  }
+  cout << endl;
 }
 
 void reportComparisonHeader() {
@@ -277,6 +516,17 @@ void reportComparisonHeader() {
   cout << setfill('=') << setw(85) << "" << setfill(' ') << endl;
 }
 
+void reportDynamicComparisonHeader() {
+  // For reportComparison() with the dynamic API in the "protobuf" slot, so that the last column
+  // is how many times slower it is than generated code.
+  cout << setw(40) << left << "Measure"
+       << setw(15) << right << "Dynamic"
+       << setw(15) << right << "Generated"
+       << setw(15) << right << "Slowdown"
+       << endl;
+  cout << setfill('=') << setw(85) << "" << setfill(' ') << endl;
+}
+
 void reportOldNewComparisonHeader() {
   cout << setw(40) << left << "Measure"
        << setw(15) << right << "Old"
@@ -339,6 +589,254 @@ void reportIntComparison(const char* name, const char* unit, uint64_t protobuf,
   cout << setw(14) << right << Gain(capnproto, protobuf) << endl;
 }
 
+void reportRpcTableHeader() {
+  int width = 102;
+  cout << setw(40) << left << "Test"
+       << setw(12) << right << "calls/sec"
+       << setw(10) << right << "p50 us"
+       << setw(10) << right << "p99 us"
+       << setw(10) << right << "p999 us"
+       << setw(10) << right << "allocs"
+       << setw(10) << right << "cpu ns";
+  if (repeatCount > 1) {
+    cout << setw(10) << right << "+/- wall";
+    width += 10;
+  }
+  cout << endl;
+  cout << setfill('=') << setw(width) << "" << setfill(' ') << endl;
+}
+
+void reportRpcResults(const char* name, RpcResult results) {
+  // `results.calls` and `results.allocations` are summed over repeats; `results.time` is the
+  // per-run mean.
+  uint64_t calls = results.calls == 0 ? 1 : results.calls;
+  uint64_t callsPerRun = calls / repeatCount;
+  uint64_t callsPerSec = results.wallNs == 0 ? 0 : results.calls * 1e9 / results.wallNs;
+
+  double allocationsPerCall = (double)results.allocations / calls;
+
+  addRecord(name, callsPerRun, 0, 0, results.time, results.stddev, results.latency,
+            true, allocationsPerCall);
+
+  cout << setw(40) << left << name
+       << setw(12) << right << callsPerSec
+       << setw(10) << right << fixed << setprecision(1)
+       << (results.latency.percentile(0.5) / 1000.0)
+       << setw(10) << right << fixed << setprecision(1)
+       << (results.latency.percentile(0.99) / 1000.0)
+       << setw(10) << right << fixed << setprecision(1)
+       << (results.latency.percentile(0.999) / 1000.0)
+       << setw(10) << right << fixed << setprecision(1) << allocationsPerCall
+       << setw(10) << right << (results.time.cpu() / (callsPerRun == 0 ? 1 : callsPerRun));
+  reportVariance(results.time, results.stddev);
+  cout << endl;
+}
+
+int runRpcBenchmarks(TestCase testCase, Compression compression, uint64_t iters) {
+  // The in-process modes honor `compression`; EzRpc always uses the unpacked encoding.
+
+  if (compression == Compression::SNAPPY) {
+    fprintf(stderr, "Snappy compression is not supported for RPC.\n");
+    return 1;
+  }
+
+  cout << "* RPC calls" << endl;
+  cout << "  * in-process: client and server TwoPartyVatNetworks joined by a pipe, one thread"
+       << endl;
+  cout << "  * EzRpc: EzRpcClient and EzRpcServer in separate processes, over loopback TCP"
+       << endl;
+  cout << "  * pipelined: client keeps many calls in flight instead of waiting for each" << endl;
+  cout << "* allocations are operator new calls per RPC, counted in the client process"
+       << endl;
+  cout << (compression == Compression::PACKED ? "* packed" : "* unpacked")
+       << " encoding for in-process connections" << endl;
+  cout << endl;
+
+  reportRpcTableHeader();
+
+  reportRpcResults("Cap'n Proto RPC in-process",
+      runRpcTest(testCase, Mode::RPC_LOCAL, compression, iters));
+  reportRpcResults("Cap'n Proto RPC in-process pipelined",
+      runRpcTest(testCase, Mode::RPC_LOCAL_PIPELINED, compression, iters));
+  reportRpcResults("Cap'n Proto EzRpc",
+      runRpcTest(testCase, Mode::RPC_EZ, Compression::NONE, iters));
+  reportRpcResults("Cap'n Proto EzRpc pipelined",
+      runRpcTest(testCase, Mode::RPC_EZ_PIPELINED, Compression::NONE, iters));
+
+  return 0;
+}
+
+struct ThreadResult {
+  uint64_t iterations;  // summed over threads and repeats
+  uint64_t wallNs;      // parallel section only, summed over repeats
+  Times time;
+  Times stddev;
+};
+
+ThreadResult runThreadTest(TestCase testCase, Mode mode, Reuse reuse, Compression compression,
+                           uint64_t iters, uint threadCount) {
+  ThreadResult result;
+  result.iterations = 0;
+  result.wallNs = 0;
+  TimesStats times;
+
+  for (uint i = 0; i < repeatCount; i++) {
+    times.add(runChild(Product::CAPNPROTO, testCase, mode, reuse, compression, iters,
+                       threadCount, [&](FILE* input) {
+      long long unsigned int iterations, wallNs;
+      if (fscanf(input, "%llu %llu", &iterations, &wallNs) != 2) {
+        fprintf(stderr, "Child didn't write thread statistics to stdout.");
+        return;
+      }
+      result.iterations += iterations;
+      result.wallNs += wallNs;
+    }));
+  }
+
+  result.time = times.mean();
+  result.stddev = times.stddev();
+  return result;
+}
+
+int runThreadBenchmarks(TestCase testCase, Compression compression, uint64_t iters,
+                        uint maxThreads) {
+  // For each mode, runs 1, 2, 4, ... threads up to `maxThreads`.  Each thread does `iters`
+  // iterations, so with perfect scaling the per-thread rate stays constant.
+
+  cout << "* Cap'n Proto only, " << iters << " iterations per thread" << endl;
+  cout << "  * per-thread objects: each thread builds and reads its own messages" << endl;
+  cout << "  * per-thread bytes: each thread also serializes and parses them" << endl;
+  cout << "  * shared reader: all threads read one request through one MessageReader" << endl;
+  cout << "* scaling is per-thread throughput relative to one thread" << endl;
+  cout << endl;
+
+  cout << setw(40) << left << "Test"
+       << setw(10) << right << "threads"
+       << setw(14) << right << "iters/sec"
+       << setw(14) << right << "per thread"
+       << setw(10) << right << "scaling";
+  int width = 88;
+  if (repeatCount > 1) {
+    cout << setw(10) << right << "+/- wall";
+    width += 10;
+  }
+  cout << endl;
+  cout << setfill('=') << setw(width) << "" << setfill(' ') << endl;
+
+  struct {
+    Mode mode;
+    const char* name;
+  } modes[] = {
+    { Mode::THREADS_OBJECT, "Cap'n Proto per-thread objects" },
+    { Mode::THREADS_BYTES, "Cap'n Proto per-thread bytes" },
+    { Mode::THREADS_SHARED_READER, "Cap'n Proto shared reader" },
+  };
+
+  vector<uint> threadCounts;
+  for (uint n = 1; n < maxThreads; n *= 2) {
+    threadCounts.push_back(n);
+  }
+  threadCounts.push_back(maxThreads);
+
+  for (auto& mode: modes) {
+    double baseline = 0;
+    for (uint threadCount: threadCounts) {
+      ThreadResult result = runThreadTest(
+          testCase, mode.mode, Reuse::YES, compression, iters, threadCount);
+      double rate = result.wallNs == 0 ? 0 : result.iterations * 1e9 / result.wallNs;
+      double perThread = rate / threadCount;
+      if (threadCount == 1) baseline = perThread;
+
+      string name = string(mode.name) + " x" + to_string(threadCount);
+      // Report the wall time of the parallel section rather than of the whole process.
+      Times time = result.time;
+      time.real = result.wallNs / repeatCount;
+      LatencyHistogram noLatency;
+      addRecord(name.c_str(), iters * threadCount, 0, 0, time, result.stddev,
+                noLatency, false, 0);
+
+      cout << setw(40) << left << name
+           << setw(10) << right << threadCount
+           << setw(14) << right << (uint64_t)rate
+           << setw(14) << right << (uint64_t)perThread
+           << setw(9) << right << fixed << setprecision(2)
+           << (baseline == 0 ? 0 : perThread / baseline) << "x";
+      reportVariance(result.time, result.stddev);
+      cout << endl;
+    }
+  }
+
+  return 0;
+}
+
+string jsonString(const string& text) {
+  string result = "\"";
+  for (char c: text) {
+    if (c == '"' || c == '\\') result += '\\';
+    result += c;
+  }
+  result += '"';
+  return result;
+}
+
+void writeRecords(ostream& out, OutputFormat format, TestCase testCase) {
+  // Values are per iteration (per call for RPC), except `repeats` and `latency_count`.
+
+  out.unsetf(ios::floatfield);
+  out << setprecision(6);
+
+  switch (format) {
+    case OutputFormat::TEXT:
+      break;
+
+    case OutputFormat::CSV:
+      out << "test_case,name,iterations,repeats,object_bytes,message_bytes,"
+          << "wall_ns,wall_ns_stddev,user_ns,user_ns_stddev,sys_ns,sys_ns_stddev,"
+          << "allocations,latency_count,p50_ns,p90_ns,p99_ns,p999_ns,max_ns" << endl;
+      for (auto& r: records) {
+        out << testCaseName(testCase) << ',' << '"' << r.name << '"' << ','
+            << r.iters << ',' << repeatCount << ',' << r.objectSize << ',' << r.messageSize << ','
+            << r.time.real / r.iters << ',' << r.stddev.real / r.iters << ','
+            << r.time.user / r.iters << ',' << r.stddev.user / r.iters << ','
+            << r.time.sys / r.iters << ',' << r.stddev.sys / r.iters << ',';
+        if (r.hasAllocations) out << r.allocationsPerCall;
+        out << ',' << r.latencyCount << ',' << r.p50 << ',' << r.p90 << ',' << r.p99 << ','
+            << r.p999 << ',' << r.max << endl;
+      }
+      break;
+
+    case OutputFormat::JSON:
+      out << "{\"test_case\": " << jsonString(testCaseName(testCase))
+          << ", \"repeats\": " << repeatCount << ", \"results\": [";
+      for (size_t i = 0; i < records.size(); i++) {
+        auto& r = records[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "  {\"name\": " << jsonString(r.name)
+            << ", \"iterations\": " << r.iters
+            << ", \"object_bytes\": " << r.objectSize
+            << ", \"message_bytes\": " << r.messageSize
+            << ", \"wall_ns\": " << r.time.real / r.iters
+            << ", \"wall_ns_stddev\": " << r.stddev.real / r.iters
+            << ", \"user_ns\": " << r.time.user / r.iters
+            << ", \"user_ns_stddev\": " << r.stddev.user / r.iters
+            << ", \"sys_ns\": " << r.time.sys / r.iters
+            << ", \"sys_ns_stddev\": " << r.stddev.sys / r.iters
+            << ", \"allocations\": ";
+        if (r.hasAllocations) {
+          out << r.allocationsPerCall;
+        } else {
+          out << "null";
+        }
+        out << ", \"latency\": {\"count\": " << r.latencyCount
+            << ", \"p50_ns\": " << r.p50 << ", \"p90_ns\": " << r.p90
+            << ", \"p99_ns\": " << r.p99 << ", \"p999_ns\": " << r.p999
+            << ", \"max_ns\": " << r.max << "}}";
+      }
+      out << "\n]}" << endl;
+      break;
+  }
+}
+
 size_t fileSize(const std::string& name) {
   struct stat stats;
   if (stat(name.c_str(), &stats) < 0) {
@@ -371,6 +869,9 @@ int main(int argc, char* argv[]) {
   Compression compression = Compression::NONE;
   uint64_t iters = 1;
   const char* oldDir = nullptr;
+  bool rpc = false;
+  uint maxThreads = 0;  // zero means not running the thread scaling suite
+  OutputFormat format = OutputFormat::TEXT;
 
   for (int i = 1; i < argc; i++) {
     string arg = argv[i];
@@ -386,6 +887,35 @@ int main(int argc, char* argv[]) {
       testCase = TestCase::CARSALES;
     } else if (arg == "snappy") {
       compression = Compression::SNAPPY;
+    } else if (arg == "packed") {
+      compression = Compression::PACKED;
+    } else if (arg == "rpc") {
+      rpc = true;
+    } else if (arg == "threads") {
+      if (maxThreads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        maxThreads = cpus > 0 ? cpus : 1;
+      }
+    } else if (arg == "-t") {
+      ++i;
+      if (i == argc || !isdigit(argv[i][0]) || strtoul(argv[i], nullptr, 0) == 0) {
+        fprintf(stderr, "-t requires a positive thread count.\n");
+        return 1;
+      }
+      maxThreads = strtoul(argv[i], nullptr, 0);
+    } else if (arg == "latency") {
+      recordLatency = true;
+    } else if (arg == "json") {
+      format = OutputFormat::JSON;
+    } else if (arg == "csv") {
+      format = OutputFormat::CSV;
+    } else if (arg == "-r") {
+      ++i;
+      if (i == argc || !isdigit(argv[i][0]) || strtoul(argv[i], nullptr, 0) == 0) {
+        fprintf(stderr, "-r requires a positive repeat count.\n");
+        return 1;
+      }
+      repeatCount = strtoul(argv[i], nullptr, 0);
     } else if (arg == "-c") {
       ++i;
       if (i == argc) {
@@ -412,6 +942,13 @@ int main(int argc, char* argv[]) {
       break;
   }
 
+  // With machine-readable output, the human-readable report goes to stderr so that stdout
+  // contains only the records.
+  std::streambuf* stdoutBuffer = cout.rdbuf();
+  if (format != OutputFormat::TEXT) {
+    cout.rdbuf(cerr.rdbuf());
+  }
+
   cout << "Running " << iters << " iterations of ";
   switch (testCase) {
     case TestCase::EVAL:
@@ -427,9 +964,24 @@ int main(int argc, char* argv[]) {
 
   cout << " example case with:" << endl;
 
+  if (rpc || maxThreads > 0) {
+    int result = rpc ? runRpcBenchmarks(testCase, compression, iters)
+                     : runThreadBenchmarks(testCase, compression, iters, maxThreads);
+    cout.rdbuf(stdoutBuffer);
+    writeRecords(cout, format, testCase);
+    return result;
+  }
+
   switch (mode) {
     case Mode::OBJECTS:
     case Mode::OBJECT_SIZE:
+    case Mode::RPC_LOCAL:
+    case Mode::RPC_LOCAL_PIPELINED:
+    case Mode::RPC_EZ:
+    case Mode::RPC_EZ_PIPELINED:
+    case Mode::THREADS_OBJECT:
+    case Mode::THREADS_BYTES:
+    case Mode::THREADS_SHARED_READER:
       // Can't happen.
       break;
     case Mode::BYTES:
@@ -480,6 +1032,11 @@ int main(int argc, char* argv[]) {
       Product::CAPNPROTO, testCase, Mode::OBJECT_SIZE, Reuse::YES, compression, iters).objectSize;
   reportResults("Cap'n Proto pass-by-object", iters, capnpBase);
 
+  TestResult dynamicBase = runTest(
+      Product::CAPNPROTO_DYNAMIC, testCase, Mode::OBJECTS, Reuse::YES, compression, iters);
+  dynamicBase.objectSize = capnpBase.objectSize;
+  reportResults("Cap'n Proto dynamic pass-by-object", iters, dynamicBase);
+
   TestResult nullCaseNoReuse = runTest(
       Product::NULLCASE, testCase, Mode::OBJECT_SIZE, Reuse::NO, compression, iters);
   reportResults("Theoretical best w/o object reuse", iters, nullCaseNoReuse);
@@ -496,6 +1053,11 @@ int main(int argc, char* argv[]) {
       Product::CAPNPROTO, testCase, Mode::OBJECT_SIZE, Reuse::NO, compression, iters).objectSize;
   reportResults("Cap'n Proto w/o object reuse", iters, capnpNoReuse);
 
+  TestResult dynamicNoReuse = runTest(
+      Product::CAPNPROTO_DYNAMIC, testCase, Mode::OBJECTS, Reuse::NO, compression, iters);
+  dynamicNoReuse.objectSize = capnpNoReuse.objectSize;
+  reportResults("Cap'n Proto dynamic w/o object reuse", iters, dynamicNoReuse);
+
   TestResult protobuf = runTest(
       Product::PROTOBUF, testCase, mode, Reuse::YES, compression, iters);
   protobuf.objectSize = protobufBase.objectSize;
@@ -509,6 +1071,10 @@ int main(int argc, char* argv[]) {
       Product::CAPNPROTO, testCase, mode, Reuse::YES, Compression::PACKED, iters);
   capnpPacked.objectSize = capnpBase.objectSize;
   reportResults("Cap'n Proto packed I/O", iters, capnpPacked);
+  TestResult dynamic = runTest(
+      Product::CAPNPROTO_DYNAMIC, testCase, mode, Reuse::YES, compression, iters);
+  dynamic.objectSize = capnpBase.objectSize;
+  reportResults("Cap'n Proto dynamic I/O", iters, dynamic);
 
   size_t protobufBinarySize = fileSize("protobuf-" + std::string(testCaseName(testCase)));
   size_t capnpBinarySize = fileSize("capnproto-" + std::string(testCaseName(testCase)));
@@ -605,6 +1171,18 @@ int main(int argc, char* argv[]) {
   reportComparison("generated obj size (KiB)", "",
       protobufObjSize / 1024.0, capnpObjSize / 1024.0, 1);
 
+  // The dynamic programs build the same messages, so the difference is all in field access.
+  cout << endl;
+  reportDynamicComparisonHeader();
+  reportComparison("object manipulation time (us)", "",
+      ((int64_t)dynamicBase.time.user - (int64_t)nullCase.time.user) / 1000.0,
+      ((int64_t)capnpBase.time.user - (int64_t)nullCase.time.user) / 1000.0, iters);
+  reportComparison("object manipulation time w/o reuse (us)", "",
+      ((int64_t)dynamicNoReuse.time.user - (int64_t)nullCaseNoReuse.time.user) / 1000.0,
+      ((int64_t)capnpNoReuse.time.user - (int64_t)nullCaseNoReuse.time.user) / 1000.0, iters);
+  reportComparison("total time with I/O (us)", "",
+      dynamic.time.user / 1000.0, capnp.time.user / 1000.0, iters);
+
   if (oldDir != nullptr) {
     cout << endl;
     reportOldNewComparisonHeader();
@@ -638,6 +1216,9 @@ int main(int argc, char* argv[]) {
         oldCapnpObjSize / 1024.0, capnpObjSize / 1024.0, 1);
   }
 
+  cout.rdbuf(stdoutBuffer);
+  writeRecords(cout, format, testCase);
+
   return 0;
 }
 
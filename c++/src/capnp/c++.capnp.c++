@@ -28,7 +28,8 @@ static const ::capnp::_::AlignedData<19> b_b9c6f99ebf805f2c = {
 };
 const ::capnp::_::RawSchema s_b9c6f99ebf805f2c = {
   0xb9c6f99ebf805f2c, b_b9c6f99ebf805f2c.words, 19, nullptr, nullptr,
-  0, 0, nullptr, nullptr, nullptr
+  0, 0, nullptr, nullptr, nullptr,
+  nullptr, nullptr, nullptr
 };
 }  // namespace schemas
 namespace _ {  // private
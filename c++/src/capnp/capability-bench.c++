@@ -0,0 +1,86 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Benchmarks for calls on local capabilities.  Run them with the capnp-bench program.
+
+#include "capability.h"
+#include <kj/benchmark.h>
+#include <capnp/test.capnp.h>
+
+namespace capnp {
+namespace _ {  // private
+namespace {
+
+using ::capnproto_test::capnp::test::TestCallOrder;
+
+class CallOrderServer final: public TestCallOrder::Server {
+public:
+  explicit CallOrderServer(bool direct): direct(direct) {}
+
+  bool allowDirectDispatch() override { return direct; }
+
+  kj::Promise<void> getCallSequence(GetCallSequenceContext context) override {
+    context.getResults().setN(count++);
+    return kj::READY_NOW;
+  }
+
+private:
+  bool direct;
+  uint count = 0;
+};
+
+void callInBatches(uint64_t iterations, bool direct) {
+  // Per iteration: one call on a local capability.  Calls are sent in batches of 64 and then
+  // waited on, so this measures throughput rather than the latency of a single round trip.
+  constexpr uint BATCH_SIZE = 64;
+
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+  TestCallOrder::Client client(kj::heap<CallOrderServer>(direct));
+  kj::Benchmark::resetTimer();
+
+  for (uint64_t done = 0; done < iterations; done += BATCH_SIZE) {
+    uint count = kj::min(iterations - done, uint64_t(BATCH_SIZE));
+    auto promises = kj::heapArrayBuilder<RemotePromise<TestCallOrder::GetCallSequenceResults>>(
+        count);
+    for (uint i = 0; i < count; i++) {
+      promises.add(client.getCallSequenceRequest().send());
+    }
+    for (auto& promise: promises) {
+      kj::doNotOptimize(promise.wait(waitScope).getN());
+    }
+  }
+}
+
+KJ_BENCHMARK(LocalClient::call (queued)) {
+  callInBatches(iterations, false);
+}
+
+KJ_BENCHMARK(LocalClient::call (direct)) {
+  callInBatches(iterations, true);
+}
+
+}  // namespace
+}  // namespace _ (private)
+}  // namespace capnp
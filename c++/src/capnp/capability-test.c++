@@ -221,6 +221,57 @@ TEST(Capability, AsyncCancelation) {
 
 // =======================================================================================
 
+class DirectCallOrderImpl final: public test::TestCallOrder::Server {
+public:
+  bool direct = true;
+  uint count = 0;
+
+  bool allowDirectDispatch() override { return direct; }
+
+  kj::Promise<void> getCallSequence(GetCallSequenceContext context) override {
+    context.getResults().setN(count++);
+    return kj::READY_NOW;
+  }
+};
+
+TEST(Capability, DirectDispatch) {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  auto server = kj::heap<DirectCallOrderImpl>();
+  auto& serverRef = *server;
+  test::TestCallOrder::Client client(kj::mv(server));
+
+  // Opted in:  calls run before send() returns.
+  auto promise1 = client.getCallSequenceRequest().send();
+  EXPECT_EQ(1u, serverRef.count);
+  auto promise2 = client.getCallSequenceRequest().send();
+  EXPECT_EQ(2u, serverRef.count);
+  EXPECT_EQ(0u, promise1.wait(waitScope).getN());
+  EXPECT_EQ(1u, promise2.wait(waitScope).getN());
+
+  // A queued call must not be overtaken by a later direct one.
+  serverRef.direct = false;
+  auto promise3 = client.getCallSequenceRequest().send();
+  serverRef.direct = true;
+  auto promise4 = client.getCallSequenceRequest().send();
+  EXPECT_EQ(2u, serverRef.count);
+  EXPECT_EQ(2u, promise3.wait(waitScope).getN());
+  EXPECT_EQ(3u, promise4.wait(waitScope).getN());
+
+  // Once the queue drains, calls are direct again.
+  client.getCallSequenceRequest().send();
+  EXPECT_EQ(5u, serverRef.count);
+
+  // Calls forwarded by a promise capability when it resolves are still queued.
+  auto paf = kj::newPromiseAndFulfiller<test::TestCallOrder::Client>();
+  test::TestCallOrder::Client promiseClient(kj::mv(paf.promise));
+  auto promise6 = promiseClient.getCallSequenceRequest().send();
+  paf.fulfiller->fulfill(kj::cp(client));
+  EXPECT_EQ(5u, promise6.wait(waitScope).getN());
+  EXPECT_EQ(6u, serverRef.count);
+}
+
 TEST(Capability, DynamicClient) {
   kj::EventLoop loop;
   kj::WaitScope waitScope(loop);
@@ -57,11 +57,19 @@ ClientHook::ClientHook() {
   setGlobalBrokenCapFactoryForLayoutCpp(brokenCapFactory);
 }
 
-void MessageReader::initCapTable(kj::Array<kj::Maybe<kj::Own<ClientHook>>> capTable) {
+void MessageReader::initCapTable(CapTable&& capTable) {
   setGlobalBrokenCapFactoryForLayoutCpp(brokenCapFactory);
   arena()->initCapTable(kj::mv(capTable));
 }
 
+void MessageReader::initCapTable(kj::Array<kj::Maybe<kj::Own<ClientHook>>> capTable) {
+  CapTable table;
+  for (auto& cap: capTable) {
+    table.add(kj::mv(cap));
+  }
+  initCapTable(kj::mv(table));
+}
+
 // =======================================================================================
 
 Capability::Client::Client(decltype(nullptr))
@@ -70,6 +78,10 @@ Capability::Client::Client(decltype(nullptr))
 Capability::Client::Client(kj::Exception&& exception)
     : hook(newBrokenCap(kj::mv(exception))) {}
 
+bool Capability::Server::allowDirectDispatch() {
+  return false;
+}
+
 kj::Promise<void> Capability::Server::internalUnimplemented(
     const char* actualInterfaceName, uint64_t requestedTypeId) {
   KJ_FAIL_REQUIRE("Requested interface not implemented.", actualInterfaceName, requestedTypeId) {
@@ -114,6 +126,10 @@ kj::Promise<void> ClientHook::whenResolved() {
   }
 }
 
+kj::Promise<void> ClientHook::whenWritable() {
+  return kj::READY_NOW;
+}
+
 // =======================================================================================
 
 static inline uint firstSegmentSize(kj::Maybe<MessageSize> sizeHint) {
@@ -256,6 +272,10 @@ private:
 // These classes handle pipelining in the case where calls need to be queued in-memory until some
 // local operation completes.
 
+static __thread uint callForwardingDepth = 0;
+// Non-zero while QueuedClient is forwarding queued calls to its resolution.  LocalClient never
+// dispatches those directly; see LocalClient::call().
+
 class QueuedPipeline final: public PipelineHook, public kj::Refcounted {
   // A PipelineHook which simply queues calls while waiting for a PipelineHook to which to forward
   // them.
@@ -348,6 +368,8 @@ public:
     kj::ForkedPromise<kj::Own<CallResultHolder>> callResultPromise =
         promiseForCallForwarding.addBranch().then(kj::mvCapture(context,
         [=](kj::Own<CallContextHook>&& context, kj::Own<ClientHook>&& client){
+          ++callForwardingDepth;
+          KJ_DEFER(--callForwardingDepth);
           return kj::refcounted<CallResultHolder>(
               client->call(interfaceId, methodId, kj::mv(context)));
         })).fork();
@@ -470,18 +492,33 @@ public:
                               kj::Own<CallContextHook>&& context) override {
     auto contextPtr = context.get();
 
-    // We don't want to actually dispatch the call synchronously, because we don't want the callee
-    // to have any side effects before the promise is returned to the caller.  This helps avoid
-    // race conditions.
-    //
-    // So, we do an evalLater() here.
-    //
-    // Note also that QueuedClient depends on this evalLater() to ensure that pipelined calls don't
-    // complete before 'whenMoreResolved()' promises resolve.
-    auto promise = kj::evalLater([this,interfaceId,methodId,contextPtr]() {
-      return server->dispatchCall(interfaceId, methodId,
-                                  CallContext<AnyPointer, AnyPointer>(*contextPtr));
-    }).attach(kj::addRef(*this));
+    kj::Promise<void> promise = nullptr;
+    if (queuedCalls == 0 && callForwardingDepth == 0 && server->allowDirectDispatch()) {
+      // The server opted in to direct dispatch, and there's no queued call for this one to
+      // overtake.
+      KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+        promise = server->dispatchCall(interfaceId, methodId,
+                                       CallContext<AnyPointer, AnyPointer>(*contextPtr));
+      })) {
+        promise = kj::mv(*exception);
+      }
+      promise = promise.attach(kj::addRef(*this));
+    } else {
+      // We don't want to actually dispatch the call synchronously, because we don't want the
+      // callee to have any side effects before the promise is returned to the caller.  This helps
+      // avoid race conditions.
+      //
+      // So, we do an evalLater() here.
+      //
+      // Note also that QueuedClient depends on this evalLater() to ensure that pipelined calls
+      // don't complete before 'whenMoreResolved()' promises resolve.
+      promise = kj::evalLater(kj::mvCapture(QueuedCall(*this),
+          [this,interfaceId,methodId,contextPtr](QueuedCall&& queuedCall) {
+        queuedCall.start();
+        return server->dispatchCall(interfaceId, methodId,
+                                    CallContext<AnyPointer, AnyPointer>(*contextPtr));
+      })).attach(kj::addRef(*this));
+    }
 
     // We have to fork this promise for the pipeline to receive a copy of the answer.
     auto forked = promise.fork();
@@ -523,6 +560,30 @@ public:
 
 private:
   kj::Own<Capability::Server> server;
+
+  uint queuedCalls = 0;
+  // Number of calls waiting in evalLater() to be dispatched.  Direct dispatch is only allowed when
+  // this is zero, so that it cannot overtake them.
+
+  class QueuedCall {
+    // Counts a call in `queuedCalls` from creation until it is dispatched or canceled.
+
+  public:
+    explicit QueuedCall(LocalClient& client): client(&client) { ++client.queuedCalls; }
+    QueuedCall(QueuedCall&& other): client(other.client) { other.client = nullptr; }
+    KJ_DISALLOW_COPY(QueuedCall);
+    ~QueuedCall() { start(); }
+
+    void start() {
+      if (client != nullptr) {
+        --client->queuedCalls;
+        client = nullptr;
+      }
+    }
+
+  private:
+    LocalClient* client;
+  };
 };
 
 kj::Own<ClientHook> Capability::Client::makeLocalClient(kj::Own<Capability::Server>&& server) {
@@ -574,7 +635,7 @@ public:
   BrokenClient(const kj::Exception& exception): exception(exception) {}
   BrokenClient(const kj::StringPtr description)
       : exception(kj::Exception::Nature::PRECONDITION, kj::Exception::Durability::PERMANENT,
-                  "", 0, kj::str(description)) {}
+                  "", 0, kj::str(description), kj::Exception::NoTrace()) {}
 
   Request<AnyPointer, AnyPointer> newCall(
       uint64_t interfaceId, uint16_t methodId, kj::Maybe<MessageSize> sizeHint) override {
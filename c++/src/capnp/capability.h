@@ -159,6 +159,13 @@ public:
   // where no calls are being made.  There is no reason to wait for this before making calls; if
   // the capability does not resolve, the call results will propagate the error.
 
+  kj::Promise<void> whenWritable();
+  // Resolves when the RPC connection this capability's calls travel over has room in its flow
+  // control window (see `RpcSystem::setFlowControlWindow()`).  A producer streaming many calls
+  // should wait on this before sending each one, so that calls don't pile up in memory faster
+  // than the peer can handle them.  Resolves immediately for local capabilities and for
+  // connections with no window set.
+
   // TODO(someday):  method(s) for Join
 
 protected:
@@ -280,6 +287,18 @@ public:
   // is no longer needed.  `context` may be used to allocate the output struct and deal with
   // cancellation.
 
+  virtual bool allowDirectDispatch();
+  // Override to return true if in-process calls to this object may be dispatched synchronously,
+  // i.e. if `dispatchCall()` may run before `send()` returns to the caller rather than on a later
+  // turn of the event loop.  This saves an event queue round trip and a few promise nodes per
+  // call, which adds up for local services called at a very high rate.
+  //
+  // Direct dispatch means the caller observes the method's side effects before `send()` returns,
+  // and a method which calls back into its caller does so re-entrantly.  Only opt in if both are
+  // fine.  Calls are still queued as usual whenever an earlier call to the same object is still
+  // queued (so calls are always delivered in order), and when they are being forwarded from a
+  // promise capability which just resolved.  The default implementation returns false.
+
   // TODO(someday):  Method which can optionally be overridden to implement Join when the object is
   //   a proxy.
 
@@ -382,6 +401,10 @@ public:
   // Returns a void* that identifies who made this client.  This can be used by an RPC adapter to
   // discover when a capability it needs to marshal is one that it created in the first place, and
   // therefore it can transfer the capability without proxying.
+
+  virtual kj::Promise<void> whenWritable();
+  // Implements `Capability::Client::whenWritable()`.  The default implementation returns a
+  // resolved promise, which is right for anything not subject to flow control.
 };
 
 class CallContextHook {
@@ -586,6 +609,9 @@ inline typename T::Client Capability::Client::castAs() {
 inline kj::Promise<void> Capability::Client::whenResolved() {
   return hook->whenResolved();
 }
+inline kj::Promise<void> Capability::Client::whenWritable() {
+  return hook->whenWritable();
+}
 template <typename Params, typename Results>
 inline Request<Params, Results> Capability::Client::newCall(
     uint64_t interfaceId, uint16_t methodId, kj::Maybe<MessageSize> sizeHint) {
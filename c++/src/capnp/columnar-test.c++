@@ -0,0 +1,216 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "columnar.h"
+#include "message.h"
+#include <kj/debug.h>
+#include <gtest/gtest.h>
+#include "test-util.h"
+
+namespace capnp {
+namespace _ {  // private
+namespace {
+
+void initRecords(List<TestAllTypes>::Builder list) {
+  for (uint i = 0; i < list.size(); i++) {
+    auto element = list[i];
+    element.setBoolField(i % 2 == 0);
+    element.setInt32Field(-100 * i);
+    element.setUInt64Field(1000000000000ull * i);
+    element.setFloat64Field(i * 0.5);
+    element.setEnumField(static_cast<TestEnum>(i % 3));
+    element.setTextField(kj::str("text", i));
+    if (i % 2 == 1) {
+      element.setDataField(data(kj::str("data", i).cStr()));
+    }
+    if (i != 2) {
+      element.initStructField().setUInt16Field(7 * i);
+    }
+  }
+}
+
+TEST(Columnar, ExtractAndWrite) {
+  MallocMessageBuilder builder;
+  auto list = builder.initRoot<TestAllTypes>().initStructList(5);
+  initRecords(list);
+
+  kj::StringPtr paths[] = {
+    "boolField", "int32Field", "uInt64Field", "float64Field", "enumField",
+    "textField", "dataField", "structField.uInt16Field"
+  };
+  auto columns = extractColumns(list.asReader(), paths);
+  ASSERT_EQ(8u, columns.size());
+
+  for (auto& column: columns) {
+    EXPECT_EQ(5u, column.size());
+  }
+  EXPECT_EQ(schema::Type::INT32, columns[1].getType());
+  ASSERT_EQ(2u, columns[7].getPath().size());
+  EXPECT_EQ("uInt16Field", columns[7].getPath()[1].getProto().getName());
+
+  auto bools = columns[0].asArray<bool>();
+  auto int32s = columns[1].asArray<int32_t>();
+  auto uint64s = columns[2].asArray<uint64_t>();
+  auto float64s = columns[3].asArray<double>();
+  auto enums = columns[4].asArray<uint16_t>();
+  auto nested = columns[7].asArray<uint16_t>();
+  for (uint i = 0; i < 5; i++) {
+    EXPECT_EQ(i % 2 == 0, bools[i]);
+    EXPECT_EQ(-100 * (int)i, int32s[i]);
+    EXPECT_EQ(1000000000000ull * i, uint64s[i]);
+    EXPECT_EQ(i * 0.5, float64s[i]);
+    EXPECT_EQ(i % 3, enums[i]);
+    EXPECT_EQ(kj::str("text", i), columns[5].getText(i));
+    if (i % 2 == 1) {
+      EXPECT_EQ(data(kj::str("data", i).cStr()), columns[6].getData(i));
+    } else {
+      EXPECT_EQ(0u, columns[6].getData(i).size());
+    }
+    EXPECT_EQ(i == 2 ? 0 : 7 * i, nested[i]);
+  }
+  EXPECT_EQ(6u, columns[6].getOffsets().size());
+
+  EXPECT_ANY_THROW(columns[1].asArray<uint32_t>());
+  EXPECT_ANY_THROW(columns[1].getText(0));
+
+  // Write the columns to a fresh list and check that we get the same data back.
+  MallocMessageBuilder builder2;
+  auto list2 = builder2.initRoot<TestAllTypes>().initStructList(5);
+  writeColumns(list2, columns);
+
+  for (uint i = 0; i < 5; i++) {
+    auto a = list[i].asReader();
+    auto b = list2[i].asReader();
+    EXPECT_EQ(a.getBoolField(), b.getBoolField());
+    EXPECT_EQ(a.getInt32Field(), b.getInt32Field());
+    EXPECT_EQ(a.getUInt64Field(), b.getUInt64Field());
+    EXPECT_EQ(a.getFloat64Field(), b.getFloat64Field());
+    EXPECT_EQ(a.getEnumField(), b.getEnumField());
+    EXPECT_EQ(a.getTextField(), b.getTextField());
+    EXPECT_EQ(a.getDataField(), b.getDataField());
+    EXPECT_EQ(a.getStructField().getUInt16Field(), b.getStructField().getUInt16Field());
+  }
+
+  // Mismatched size.
+  MallocMessageBuilder builder3;
+  EXPECT_ANY_THROW(writeColumns(builder3.initRoot<TestAllTypes>().initStructList(4), columns));
+}
+
+TEST(Columnar, BadPaths) {
+  MallocMessageBuilder builder;
+  auto list = builder.initRoot<TestAllTypes>().initStructList(1);
+
+  kj::StringPtr noSuchField[] = {"noSuchField"};
+  EXPECT_ANY_THROW(extractColumns(list.asReader(), noSuchField));
+  kj::StringPtr notAColumn[] = {"structField"};
+  EXPECT_ANY_THROW(extractColumns(list.asReader(), notAColumn));
+  kj::StringPtr notAStruct[] = {"int32Field.foo"};
+  EXPECT_ANY_THROW(extractColumns(list.asReader(), notAStruct));
+  kj::StringPtr listField[] = {"int32List"};
+  EXPECT_ANY_THROW(extractColumns(list.asReader(), listField));
+
+  MallocMessageBuilder builder2;
+  auto int32List = builder2.initRoot<TestAllTypes>().initInt32List(1);
+  kj::StringPtr valid[] = {"int32Field"};
+  EXPECT_ANY_THROW(extractColumns(int32List.asReader(), valid));
+}
+
+TEST(Columnar, Unions) {
+  MallocMessageBuilder builder;
+  auto list = builder.initRoot<test::TestAnyPointer>().getAnyPointerField()
+      .initAs<List<test::TestUnnamedUnion>>(3);
+  list[0].setFoo(12);
+  list[1].setBar(34);
+  list[2].setFoo(56);
+  for (auto element: list) {
+    element.setMiddle(9);
+  }
+
+  kj::StringPtr paths[] = {"foo", "bar", "middle"};
+  auto columns = extractColumns(list.asReader(), paths);
+
+  // Inactive members read as zero.
+  auto foo = columns[0].asArray<uint16_t>();
+  auto bar = columns[1].asArray<uint32_t>();
+  EXPECT_EQ(12, foo[0]);
+  EXPECT_EQ(0, foo[1]);
+  EXPECT_EQ(56, foo[2]);
+  EXPECT_EQ(0u, bar[0]);
+  EXPECT_EQ(34u, bar[1]);
+  EXPECT_EQ(0u, bar[2]);
+  EXPECT_EQ(9, columns[2].asArray<uint16_t>()[1]);
+
+  // Writing a union member's column activates it.
+  MallocMessageBuilder builder2;
+  auto list2 = builder2.initRoot<test::TestAnyPointer>().getAnyPointerField()
+      .initAs<List<test::TestUnnamedUnion>>(3);
+  writeColumns(list2, columns.slice(1, 2));
+  for (auto element: list2) {
+    EXPECT_EQ(test::TestUnnamedUnion::BAR, element.which());
+  }
+  EXPECT_EQ(34u, list2[1].getBar());
+}
+
+TEST(Columnar, Groups) {
+  MallocMessageBuilder builder;
+  auto list = builder.initRoot<test::TestAnyPointer>().getAnyPointerField()
+      .initAs<List<test::TestGroups>>(2);
+  list[0].getGroups().initBar().setCorge(123);
+  list[1].getGroups().initFoo().setCorge(456);
+
+  kj::StringPtr paths[] = {"groups.bar.corge", "groups.foo.corge"};
+  auto columns = extractColumns(list.asReader(), paths);
+  EXPECT_EQ(123, columns[0].asArray<int32_t>()[0]);
+  EXPECT_EQ(0, columns[0].asArray<int32_t>()[1]);
+  EXPECT_EQ(0, columns[1].asArray<int32_t>()[0]);
+  EXPECT_EQ(456, columns[1].asArray<int32_t>()[1]);
+}
+
+TEST(Columnar, CompiledFastPath) {
+  MallocMessageBuilder builder;
+  auto list = builder.initRoot<TestAllTypes>().initStructList(4);
+  initRecords(list);
+
+  auto ids = extractColumn<TestAllTypes>(list.asReader(),
+      [](TestAllTypes::Reader r) { return r.getInt32Field(); });
+  ASSERT_EQ(4u, ids.size());
+  for (uint i = 0; i < 4; i++) {
+    EXPECT_EQ(-100 * (int)i, ids[i]);
+  }
+
+  auto texts = extractColumn<TestAllTypes>(list.asReader(),
+      [](TestAllTypes::Reader r) { return r.getTextField(); });
+  EXPECT_EQ("text3", texts[3]);
+
+  MallocMessageBuilder builder2;
+  auto list2 = builder2.initRoot<TestAllTypes>().initStructList(4);
+  writeColumn<TestAllTypes>(list2, ids.asPtr(),
+      [](TestAllTypes::Builder b, int32_t value) { b.setInt32Field(value); });
+  for (uint i = 0; i < 4; i++) {
+    EXPECT_EQ(-100 * (int)i, list2[i].getInt32Field());
+  }
+}
+
+}  // namespace
+}  // namespace _ (private)
+}  // namespace capnp
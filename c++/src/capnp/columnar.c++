@@ -0,0 +1,333 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "columnar.h"
+#include <kj/debug.h>
+#include <kj/vector.h>
+#include <string.h>
+
+namespace capnp {
+
+namespace {
+
+bool isColumnType(schema::Type::Which type) {
+  switch (type) {
+    case schema::Type::BOOL:
+    case schema::Type::INT8:
+    case schema::Type::INT16:
+    case schema::Type::INT32:
+    case schema::Type::INT64:
+    case schema::Type::UINT8:
+    case schema::Type::UINT16:
+    case schema::Type::UINT32:
+    case schema::Type::UINT64:
+    case schema::Type::FLOAT32:
+    case schema::Type::FLOAT64:
+    case schema::Type::ENUM:
+    case schema::Type::TEXT:
+    case schema::Type::DATA:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+kj::Array<StructSchema::Field> resolvePath(StructSchema schema, kj::StringPtr path) {
+  kj::Vector<StructSchema::Field> result;
+
+  for (;;) {
+    kj::String name;
+    kj::StringPtr rest;
+    KJ_IF_MAYBE(dot, path.findFirst('.')) {
+      name = kj::heapString(path.slice(0, *dot));
+      rest = path.slice(*dot + 1);
+    } else {
+      name = kj::heapString(path);
+    }
+
+    KJ_IF_MAYBE(field, schema.findFieldByName(name)) {
+      result.add(*field);
+    } else {
+      KJ_FAIL_REQUIRE("struct has no such field", schema.getProto().getDisplayName(), name);
+    }
+
+    auto proto = result.back().getProto();
+    if (rest == nullptr) {
+      KJ_REQUIRE(proto.isSlot() && isColumnType(proto.getSlot().getType().which()),
+                 "column must be a primitive, enum, Text, or Data field", name);
+      break;
+    }
+
+    switch (proto.which()) {
+      case schema::Field::SLOT: {
+        auto type = proto.getSlot().getType();
+        KJ_REQUIRE(type.isStruct(), "can only descend into struct and group fields", name);
+        schema = schema.getDependency(type.getStruct().getTypeId()).asStruct();
+        break;
+      }
+      case schema::Field::GROUP:
+        schema = schema.getDependency(proto.getGroup().getTypeId()).asStruct();
+        break;
+    }
+
+    path = rest;
+  }
+
+  return result.releaseAsArray();
+}
+
+template <typename Struct>
+inline bool isActive(Struct& s, StructSchema::Field field) {
+  if (field.getProto().getDiscriminantValue() == schema::Field::NO_DISCRIMINANT) {
+    return true;
+  }
+  KJ_IF_MAYBE(active, s.which()) {
+    return *active == field;
+  } else {
+    return false;
+  }
+}
+
+struct ResolvedPath {
+  // A field path plus, for each step, whether it is a union member, so that the per-element walk
+  // only has to check the discriminant where it matters.
+
+  kj::Array<StructSchema::Field> fields;
+  kj::Array<bool> inUnion;
+
+  explicit ResolvedPath(kj::Array<StructSchema::Field> fieldsParam)
+      : fields(kj::mv(fieldsParam)),
+        inUnion(KJ_MAP(field, fields) {
+          return field.getProto().getDiscriminantValue() != schema::Field::NO_DISCRIMINANT;
+        }) {}
+
+  kj::Maybe<DynamicValue::Reader> read(DynamicStruct::Reader s) const {
+    uint last = fields.size() - 1;
+    for (uint i = 0; i < last; i++) {
+      if (inUnion[i] && !isActive(s, fields[i])) return nullptr;
+      s = s.get(fields[i]).as<DynamicStruct>();
+    }
+    if (inUnion[last] && !isActive(s, fields[last])) return nullptr;
+    return s.get(fields[last]);
+  }
+
+  void write(DynamicStruct::Builder s, const DynamicValue::Reader& value) const {
+    uint last = fields.size() - 1;
+    for (uint i = 0; i < last; i++) {
+      if (inUnion[i] && !isActive(s, fields[i])) {
+        s = s.init(fields[i]).as<DynamicStruct>();
+      } else {
+        s = s.get(fields[i]).as<DynamicStruct>();
+      }
+    }
+    s.set(fields[last], value);
+  }
+};
+
+template <typename T>
+kj::Array<byte> extractPrimitive(DynamicList::Reader list, const ResolvedPath& path) {
+  auto result = kj::heapArray<byte>(list.size() * sizeof(T));
+  T* values = reinterpret_cast<T*>(result.begin());
+  for (uint i = 0; i < list.size(); i++) {
+    KJ_IF_MAYBE(value, path.read(list[i].as<DynamicStruct>())) {
+      values[i] = value->as<T>();
+    } else {
+      values[i] = T();
+    }
+  }
+  return result;
+}
+
+kj::Array<byte> extractEnum(DynamicList::Reader list, const ResolvedPath& path) {
+  auto result = kj::heapArray<byte>(list.size() * sizeof(uint16_t));
+  uint16_t* values = reinterpret_cast<uint16_t*>(result.begin());
+  for (uint i = 0; i < list.size(); i++) {
+    KJ_IF_MAYBE(value, path.read(list[i].as<DynamicStruct>())) {
+      values[i] = value->as<DynamicEnum>().getRaw();
+    } else {
+      values[i] = 0;
+    }
+  }
+  return result;
+}
+
+template <typename T>
+kj::Array<byte> extractBlobs(DynamicList::Reader list, const ResolvedPath& path,
+                             kj::Array<uint32_t>& offsets, size_t terminator) {
+  // Text values keep their NUL terminators (terminator = 1) so that Column::getText() can return
+  // them as-is.
+
+  kj::Vector<byte> bytes;
+  offsets = kj::heapArray<uint32_t>(list.size() + 1);
+  offsets[0] = 0;
+  for (uint i = 0; i < list.size(); i++) {
+    KJ_IF_MAYBE(value, path.read(list[i].as<DynamicStruct>())) {
+      auto blob = value->as<T>();
+      auto begin = reinterpret_cast<const byte*>(blob.begin());
+      bytes.addAll(begin, begin + blob.size() + terminator);
+    } else if (terminator) {
+      bytes.add(0);
+    }
+    KJ_REQUIRE(bytes.size() <= 0xffffffffu, "column too large; must be less than 4 GiB");
+    offsets[i + 1] = bytes.size();
+  }
+  return bytes.releaseAsArray();
+}
+
+template <typename T>
+void writePrimitive(DynamicList::Builder list, const ResolvedPath& path,
+                    kj::ArrayPtr<const byte> bytes) {
+  const T* values = reinterpret_cast<const T*>(bytes.begin());
+  for (uint i = 0; i < list.size(); i++) {
+    path.write(list[i].as<DynamicStruct>(), values[i]);
+  }
+}
+
+}  // namespace
+
+void Column::requireType(bool matches) const {
+  KJ_REQUIRE(matches, "column value type doesn't match the field's type", (uint)type);
+}
+
+Text::Reader Column::getText(uint index) const {
+  requireType(type == schema::Type::TEXT);
+  KJ_REQUIRE(index < count, "column index out of bounds");
+  return Text::Reader(reinterpret_cast<const char*>(bytes.begin()) + offsets[index],
+                      offsets[index + 1] - offsets[index] - 1);
+}
+
+Data::Reader Column::getData(uint index) const {
+  requireType(type == schema::Type::DATA);
+  KJ_REQUIRE(index < count, "column index out of bounds");
+  return Data::Reader(bytes.begin() + offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+kj::Array<Column> extractColumns(
+    DynamicList::Reader list, kj::ArrayPtr<const kj::StringPtr> fieldPaths) {
+  ListSchema listSchema = list.getSchema();
+  KJ_REQUIRE(listSchema.whichElementType() == schema::Type::STRUCT,
+             "can only extract columns from a list of structs");
+  StructSchema schema = listSchema.getStructElementType();
+
+  return KJ_MAP(fieldPath, fieldPaths) {
+    ResolvedPath path(resolvePath(schema, fieldPath));
+
+    Column column;
+    column.type = path.fields.back().getProto().getSlot().getType().which();
+    column.count = list.size();
+
+    switch (column.type) {
+#define HANDLE_TYPE(discrim, type) \
+      case schema::Type::discrim: \
+        column.bytes = extractPrimitive<type>(list, path); \
+        break;
+
+      HANDLE_TYPE(BOOL, bool)
+      HANDLE_TYPE(INT8, int8_t)
+      HANDLE_TYPE(INT16, int16_t)
+      HANDLE_TYPE(INT32, int32_t)
+      HANDLE_TYPE(INT64, int64_t)
+      HANDLE_TYPE(UINT8, uint8_t)
+      HANDLE_TYPE(UINT16, uint16_t)
+      HANDLE_TYPE(UINT32, uint32_t)
+      HANDLE_TYPE(UINT64, uint64_t)
+      HANDLE_TYPE(FLOAT32, float)
+      HANDLE_TYPE(FLOAT64, double)
+#undef HANDLE_TYPE
+
+      case schema::Type::ENUM:
+        column.bytes = extractEnum(list, path);
+        break;
+      case schema::Type::TEXT:
+        column.bytes = extractBlobs<Text>(list, path, column.offsets, 1);
+        break;
+      case schema::Type::DATA:
+        column.bytes = extractBlobs<Data>(list, path, column.offsets, 0);
+        break;
+      default:
+        KJ_UNREACHABLE;
+    }
+
+    column.path = kj::mv(path.fields);
+    return column;
+  };
+}
+
+void writeColumns(DynamicList::Builder list, kj::ArrayPtr<const Column> columns) {
+  ListSchema listSchema = list.getSchema();
+  KJ_REQUIRE(listSchema.whichElementType() == schema::Type::STRUCT,
+             "can only write columns to a list of structs");
+  StructSchema schema = listSchema.getStructElementType();
+
+  for (auto& column: columns) {
+    KJ_REQUIRE(column.getPath().size() > 0 &&
+               column.getPath()[0].getContainingStruct() == schema,
+               "column was not extracted from this struct type") {
+      continue;
+    }
+    KJ_REQUIRE(column.size() == list.size(), "column size doesn't match list size",
+               column.size(), list.size()) {
+      continue;
+    }
+
+    ResolvedPath path(kj::heapArray(column.getPath()));
+
+    switch (column.getType()) {
+#define HANDLE_TYPE(discrim, type) \
+      case schema::Type::discrim: \
+        writePrimitive<type>(list, path, column.getBytes()); \
+        break;
+
+      HANDLE_TYPE(BOOL, bool)
+      HANDLE_TYPE(INT8, int8_t)
+      HANDLE_TYPE(INT16, int16_t)
+      HANDLE_TYPE(INT32, int32_t)
+      HANDLE_TYPE(INT64, int64_t)
+      HANDLE_TYPE(UINT8, uint8_t)
+      HANDLE_TYPE(UINT16, uint16_t)
+      HANDLE_TYPE(UINT32, uint32_t)
+      HANDLE_TYPE(UINT64, uint64_t)
+      HANDLE_TYPE(FLOAT32, float)
+      HANDLE_TYPE(FLOAT64, double)
+      HANDLE_TYPE(ENUM, uint16_t)
+#undef HANDLE_TYPE
+
+      case schema::Type::TEXT:
+        for (uint i = 0; i < list.size(); i++) {
+          path.write(list[i].as<DynamicStruct>(), column.getText(i));
+        }
+        break;
+      case schema::Type::DATA:
+        for (uint i = 0; i < list.size(); i++) {
+          path.write(list[i].as<DynamicStruct>(), column.getData(i));
+        }
+        break;
+      default:
+        KJ_FAIL_REQUIRE("not a valid column type", (uint)column.getType());
+        break;
+    }
+  }
+}
+
+}  // namespace capnp
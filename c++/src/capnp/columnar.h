@@ -0,0 +1,176 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CAPNP_COLUMNAR_H_
+#define CAPNP_COLUMNAR_H_
+
+#include "dynamic.h"
+#include <kj/array.h>
+
+namespace capnp {
+
+class Column {
+  // The values of one field across all elements of a struct list, stored contiguously so that
+  // scanning them touches only the bytes of interest.  Built by extractColumns(); written back by
+  // writeColumns().
+  //
+  // Primitive and enum fields are stored as a plain array of the field's C++ type (enums as their
+  // raw uint16_t value).  Text and Data fields are stored as one byte array holding all of the
+  // values back-to-back, plus size() + 1 offsets into it.  Each text value is followed by a NUL
+  // terminator in the byte array (not counted in its size).
+
+public:
+  Column() = default;
+  Column(Column&&) = default;
+  Column& operator=(Column&&) = default;
+  KJ_DISALLOW_COPY(Column);
+
+  inline kj::ArrayPtr<const StructSchema::Field> getPath() const { return path; }
+  // The fields leading to the column's field, outermost first.  The last one is the column's
+  // field itself.
+
+  inline schema::Type::Which getType() const { return type; }
+  inline uint size() const { return count; }
+
+  template <typename T>
+  kj::ArrayPtr<const T> asArray() const;
+  // Get the values of a primitive or enum column.  T must be the field's C++ type, or uint16_t
+  // for enums.
+
+  Text::Reader getText(uint index) const;
+  Data::Reader getData(uint index) const;
+  // Get one value of a Text or Data column.
+
+  inline kj::ArrayPtr<const byte> getBytes() const { return bytes; }
+  inline kj::ArrayPtr<const uint32_t> getOffsets() const { return offsets; }
+  // Raw storage.  For primitive columns, `getBytes()` is the value array and `getOffsets()` is
+  // empty.  For blob columns, value `i` occupies bytes [offsets[i], offsets[i + 1]), including
+  // the NUL terminator for text.
+
+private:
+  kj::Array<StructSchema::Field> path;
+  schema::Type::Which type = schema::Type::VOID;
+  uint count = 0;
+  kj::Array<byte> bytes;
+  kj::Array<uint32_t> offsets;
+
+  void requireType(bool matches) const;
+
+  friend kj::Array<Column> extractColumns(
+      DynamicList::Reader list, kj::ArrayPtr<const kj::StringPtr> fieldPaths);
+};
+
+kj::Array<Column> extractColumns(
+    DynamicList::Reader list, kj::ArrayPtr<const kj::StringPtr> fieldPaths);
+// Copy the given fields out of every element of `list`, which must be a list of structs, into one
+// Column per field path.  A path names a field of the element type; use "." to descend into
+// groups and struct fields (e.g. "structField.int32Field").  Each path must end at a primitive,
+// enum, Text, or Data field.
+//
+// Fields are resolved once up front, then each column is filled with a single pass over the list.
+// Unset struct fields along a path read as their defaults, as usual.  If some element doesn't
+// have a union member along the path active, its value in the column is zero (or empty) rather
+// than an error.
+
+void writeColumns(DynamicList::Builder list, kj::ArrayPtr<const Column> columns);
+// The reverse of extractColumns():  set each column's field in each element of `list` to the
+// column's value.  `list` must have the same element type as the list the columns were extracted
+// from, and the same size.  Struct fields along each path are initialized as needed, and union
+// members along each path are made active.
+
+template <typename T, typename Func>
+auto extractColumn(typename List<T>::Reader list, Func&& getField)
+    -> kj::Array<kj::Decay<decltype(getField(list[0]))>>;
+// Fast path for compiled-in types:  call `getField` with each element of `list` and gather the
+// results into an array.  Since generated accessors inline, this compiles down to a strided load
+// loop, e.g.:
+//
+//     auto ids = extractColumn<Record>(records, [](Record::Reader r) { return r.getId(); });
+//
+// Note that Text and Data results point into the original message.
+
+template <typename T, typename Value, typename Func>
+void writeColumn(typename List<T>::Builder list, kj::ArrayPtr<Value> values,
+                 Func&& setField);
+// Fast path for compiled-in types:  call `setField(list[i], values[i])` for each element.
+// `values` must have the same size as `list`.
+
+// =======================================================================================
+// inline implementation details
+
+namespace _ {  // private
+
+template <typename T> struct ColumnType_;
+// Maps a primitive C++ type to its schema type.
+
+#define CAPNP_DECLARE_COLUMN_TYPE(type, discrim) \
+  template <> struct ColumnType_<type> { \
+    static constexpr schema::Type::Which value = schema::Type::discrim; \
+  }
+
+CAPNP_DECLARE_COLUMN_TYPE(bool, BOOL);
+CAPNP_DECLARE_COLUMN_TYPE(int8_t, INT8);
+CAPNP_DECLARE_COLUMN_TYPE(int16_t, INT16);
+CAPNP_DECLARE_COLUMN_TYPE(int32_t, INT32);
+CAPNP_DECLARE_COLUMN_TYPE(int64_t, INT64);
+CAPNP_DECLARE_COLUMN_TYPE(uint8_t, UINT8);
+CAPNP_DECLARE_COLUMN_TYPE(uint16_t, UINT16);
+CAPNP_DECLARE_COLUMN_TYPE(uint32_t, UINT32);
+CAPNP_DECLARE_COLUMN_TYPE(uint64_t, UINT64);
+CAPNP_DECLARE_COLUMN_TYPE(float, FLOAT32);
+CAPNP_DECLARE_COLUMN_TYPE(double, FLOAT64);
+
+#undef CAPNP_DECLARE_COLUMN_TYPE
+
+}  // namespace _ (private)
+
+template <typename T>
+kj::ArrayPtr<const T> Column::asArray() const {
+  requireType(type == _::ColumnType_<T>::value ||
+              (type == schema::Type::ENUM && _::ColumnType_<T>::value == schema::Type::UINT16));
+  return kj::arrayPtr(reinterpret_cast<const T*>(bytes.begin()), count);
+}
+
+template <typename T, typename Func>
+auto extractColumn(typename List<T>::Reader list, Func&& getField)
+    -> kj::Array<kj::Decay<decltype(getField(list[0]))>> {
+  auto result = kj::heapArray<kj::Decay<decltype(getField(list[0]))>>(list.size());
+  for (uint i = 0; i < result.size(); i++) {
+    result[i] = getField(list[i]);
+  }
+  return result;
+}
+
+template <typename T, typename Value, typename Func>
+void writeColumn(typename List<T>::Builder list, kj::ArrayPtr<Value> values,
+                 Func&& setField) {
+  KJ_IREQUIRE(values.size() == list.size(), "Column size doesn't match list size.");
+  uint count = kj::min(values.size(), list.size());
+  for (uint i = 0; i < count; i++) {
+    setField(list[i], values[i]);
+  }
+}
+
+}  // namespace capnp
+
+#endif  // CAPNP_COLUMNAR_H_
@@ -65,5 +65,19 @@ test_eval globalPrintableStruct '(someText = "foo")'
 test_eval TestConstants.enumConst corge
 test_eval 'TestListDefaults.lists.int32ListList[2][0]' 12341234
 
+# The parse cache must not change the generated code, whether it is cold or warm.
+CACHE_DIR=`mktemp -d`
+trap 'rm -rf "$CACHE_DIR"' EXIT
+$CAPNP compile -o/bin/cat $SCHEMA > "$CACHE_DIR/expected" || fail compile
+$CAPNP compile --cache-dir="$CACHE_DIR" -o/bin/cat $SCHEMA |
+    cmp "$CACHE_DIR/expected" - || fail compile cold cache
+ls "$CACHE_DIR"/*.parsed > /dev/null 2>&1 || fail compile cache not populated
+$CAPNP compile --cache-dir="$CACHE_DIR" -o/bin/cat $SCHEMA |
+    cmp "$CACHE_DIR/expected" - || fail compile warm cache
+$CAPNP compile --threads=4 -o/bin/cat $SCHEMA |
+    cmp "$CACHE_DIR/expected" - || fail compile threads
+
 $CAPNP compile -ofoo $TESTDATA/errors.capnp.nobuild 2>&1 | sed -e "s,^.*/errors[.]capnp[.]nobuild,file,g" |
     cmp $TESTDATA/errors.txt - || fail error output
+$CAPNP compile --threads=4 -ofoo $TESTDATA/errors.capnp.nobuild 2>&1 | sed -e "s,^.*/errors[.]capnp[.]nobuild,file,g" |
+    cmp $TESTDATA/errors.txt - || fail error output threads
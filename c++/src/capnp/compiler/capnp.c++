@@ -35,12 +35,16 @@
 #include "../message.h"
 #include <iostream>
 #include <kj/main.h>
+#include <kj/thread.h>
 #include <kj/parse/char.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include <capnp/serialize.h>
 #include <capnp/serialize-packed.h>
+#include <capnp/schema-bundle.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <stdlib.h>
 
@@ -57,6 +61,22 @@ namespace compiler {
 
 static const char VERSION_STRING[] = "Cap'n Proto version " VERSION;
 
+class VectorOutputStream final: public kj::OutputStream {
+  // Collects output in memory, for work done on another thread which must be written out in order
+  // later.
+
+public:
+  void write(const void* buffer, size_t size) override {
+    auto bytes = reinterpret_cast<const byte*>(buffer);
+    data.addAll(bytes, bytes + size);
+  }
+
+  kj::Array<byte> releaseArray() { return data.releaseAsArray(); }
+
+private:
+  kj::Vector<byte> data;
+};
+
 class CompilerMain final: public GlobalErrorReporter {
 public:
   explicit CompilerMain(kj::ProcessContext& context)
@@ -135,6 +155,12 @@ public:
                       "Do not print warning messages about the input being in the wrong format.  "
                       "Use this if you find the warnings are wrong (but also let us know so "
                       "we can improve them).")
+           .addOptionWithArg({"threads"}, KJ_BIND_METHOD(*this, setThreads), "<n>",
+                             "Decode using <n> threads in parallel.  Consecutive messages are "
+                             "printed concurrently (a single large message has its large lists "
+                             "printed concurrently instead).  Output is the same, and in the same "
+                             "order, either way.  When the input is a regular file (and not "
+                             "--packed), it is mapped into memory and read in place.")
            .expectArg("<schema-file>", KJ_BIND_METHOD(*this, addSource))
            .expectArg("<type>", KJ_BIND_METHOD(*this, setRootType))
            .callAfterParsing(KJ_BIND_METHOD(*this, decode));
@@ -174,6 +200,11 @@ public:
                              "words and turns off heuristic growth.  This flag is mainly useful "
                              "for testing.  Without it, each message will be written as a single "
                              "segment.")
+           .addOptionWithArg({"threads"}, KJ_BIND_METHOD(*this, setThreads), "<n>",
+                             "Encode using <n> threads in parallel.  The input is split into "
+                             "chunks at line breaks which are encoded concurrently, so with this "
+                             "option no value may span more than one line.  Output is the same, "
+                             "and in the same order, either way.")
            .expectArg("<schema-file>", KJ_BIND_METHOD(*this, addSource))
            .expectArg("<type>", KJ_BIND_METHOD(*this, setRootType))
            .callAfterParsing(KJ_BIND_METHOD(*this, encode));
@@ -240,14 +271,26 @@ public:
                              "to use.  If <lang> is a simple word, the compiler for a plugin "
                              "called 'capnpc-<lang>' in $PATH.  If <lang> is a file path "
                              "containing slashes, it is interpreted as the exact plugin "
-                             "executable file name, and $PATH is not searched.")
+                             "executable file name, and $PATH is not searched.  The special "
+                             "<lang> 'bundle' runs no plugin but writes every compiled node, "
+                             "imports included, to one '<source>.bundle' file named after the "
+                             "first source, for loading with SchemaLoader::loadBundle().")
            .addOptionWithArg({"src-prefix"}, KJ_BIND_METHOD(*this, addSourcePrefix), "<prefix>",
                              "If a file specified for compilation starts with <prefix>, remove "
                              "the prefix for the purpose of deciding the names of output files.  "
                              "For example, the following command:\n"
                              "    capnp --src-prefix=foo/bar -oc++:corge foo/bar/baz/qux.capnp\n"
                              "would generate the files corge/baz/qux.capnp.{h,c++}.")
-           .expectOneOrMoreArgs("<source>", KJ_BIND_METHOD(*this, addSource))
+           .addOptionWithArg({"cache-dir"}, KJ_BIND_METHOD(*this, setCacheDir), "<dir>",
+                             "Cache the parse trees of all source and imported files in <dir>, "
+                             "keyed by a hash of each file's content, so that later runs can "
+                             "skip parsing files which have not changed.  The cache may be "
+                             "shared by concurrent runs and deleted at any time.")
+           .addOptionWithArg({"threads"}, KJ_BIND_METHOD(*this, setThreads), "<n>",
+                             "Parse the source files and their imports using <n> threads in "
+                             "parallel.  Output, including any error messages, is the same "
+                             "either way.")
+           .expectOneOrMoreArgs("<source>", KJ_BIND_METHOD(*this, addCompileSource))
            .callAfterParsing(KJ_BIND_METHOD(*this, generateOutput));
   }
 
@@ -265,6 +308,29 @@ public:
   }
 
   kj::MainBuilder::Validity addSource(kj::StringPtr file) {
+    KJ_IF_MAYBE(module, loadSource(file)) {
+      compileSource(*module);
+    } else {
+      return "no such file";
+    }
+
+    return true;
+  }
+
+  kj::MainBuilder::Validity addCompileSource(kj::StringPtr file) {
+    // Like addSource(), but compilation is deferred until all sources are known, so that
+    // compileSources() can parse them in parallel.
+    KJ_IF_MAYBE(module, loadSource(file)) {
+      pendingSources.add(&*module);
+    } else {
+      return "no such file";
+    }
+
+    return true;
+  }
+
+private:
+  kj::Maybe<Module&> loadSource(kj::StringPtr file) {
     // Strip redundant "./" prefixes to make src-prefix matching more lenient.
     while (file.startsWith("./")) {
       file = file.slice(2);
@@ -286,18 +352,25 @@ public:
       addStandardImportPaths = false;
     }
 
-    KJ_IF_MAYBE(module, loadModule(file)) {
-      uint64_t id = compiler->add(*module);
-      compiler->eagerlyCompile(id, compileEagerness);
-      sourceFiles.add(SourceFile { id, module->getSourceName(), &*module });
-    } else {
-      return "no such file";
-    }
+    return loadModule(file);
+  }
 
-    return true;
+  void compileSource(Module& module) {
+    uint64_t id = compiler->add(module);
+    compiler->eagerlyCompile(id, compileEagerness);
+    sourceFiles.add(SourceFile { id, module.getSourceName(), &module });
+  }
+
+  void compileSources() {
+    if (threads > 1) {
+      loader.parseAll(pendingSources, threads);
+    }
+    for (Module* module: pendingSources) {
+      compileSource(*module);
+    }
+    pendingSources.resize(0);
   }
 
-private:
   kj::Maybe<Module&> loadModule(kj::StringPtr file) {
     size_t longestPrefix = 0;
 
@@ -338,6 +411,15 @@ public:
     return true;
   }
 
+  kj::MainBuilder::Validity setCacheDir(kj::StringPtr dir) {
+    struct stat stats;
+    if (stat(dir.cStr(), &stats) < 0 || !S_ISDIR(stats.st_mode)) {
+      return "cache location is inaccessible or is not a directory";
+    }
+    loader.setCacheDir(kj::heapString(dir));
+    return true;
+  }
+
   kj::MainBuilder::Validity addSourcePrefix(kj::StringPtr prefix) {
     // Strip redundant "./" prefixes to make src-prefix matching more lenient.
     while (prefix.startsWith("./")) {
@@ -358,6 +440,8 @@ public:
   }
 
   kj::MainBuilder::Validity generateOutput() {
+    compileSources();
+
     if (hadErrors()) {
       // Skip output if we had any errors.
       return true;
@@ -390,6 +474,11 @@ public:
     }
 
     for (auto& output: outputs) {
+      if (output.name == kj::StringPtr("bundle").asArray()) {
+        writeBundle(output.dir, request);
+        continue;
+      }
+
       int pipeFds[2];
       KJ_SYSCALL(pipe(pipeFds));
 
@@ -462,6 +551,20 @@ public:
     return true;
   }
 
+  void writeBundle(kj::StringPtr dir, schema::CodeGeneratorRequest::Reader request) {
+    kj::StringPtr name = sourceFiles[0].name;
+    KJ_IF_MAYBE(slash, name.findLast('/')) {
+      name = name.slice(*slash + 1);
+    }
+
+    kj::String path = dir == nullptr ? kj::str(name, ".bundle")
+                                     : kj::str(dir, '/', name, ".bundle");
+    int fd;
+    KJ_SYSCALL(fd = open(path.cStr(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666), path);
+    kj::FdOutputStream output((kj::AutoCloseFd(fd)));
+    writeSchemaBundle(output, request);
+  }
+
   // =====================================================================================
   // "decode" command
 
@@ -491,6 +594,17 @@ public:
     quiet = true;
     return true;
   }
+  kj::MainBuilder::Validity setThreads(kj::StringPtr count) {
+    char* end;
+    threads = strtol(count.cStr(), &end, 0);
+    if (count.size() == 0 || *end != '\0') {
+      return "not an integer";
+    }
+    if (threads == 0) {
+      return "must be at least 1";
+    }
+    return true;
+  }
   kj::MainBuilder::Validity setSegmentSize(kj::StringPtr size) {
     if (flat) return "cannot be used with --flat";
     char* end;
@@ -540,6 +654,29 @@ private:
 
 public:
   kj::MainBuilder::Validity decode() {
+    if (threads > 1 && !flat) {
+      // Compile everything the printers could need up front, so that worker threads don't end up
+      // taking turns holding the compiler's lock.
+      compiler->eagerlyCompile(rootType.getProto().getId(),
+          Compiler::NODE | Compiler::DEPENDENCIES | Compiler::DEPENDENCY_DEPENDENCIES);
+
+      if (!packed) {
+        KJ_IF_MAYBE(mapping, tryMapStdin()) {
+          auto bytes = kj::arrayPtr(reinterpret_cast<const byte*>(mapping->begin()),
+                                    mapping->size() * sizeof(word));
+          if (!quiet) {
+            auto result = checkPlausibility(bytes.slice(0, kj::min(bytes.size(), size_t(8192))));
+            if (result.getError() != nullptr) {
+              return kj::mv(result);
+            }
+          }
+
+          decodeMappedInParallel(*mapping);
+          context.exit();
+        }
+      }
+    }
+
     kj::FdInputStream rawInput(STDIN_FILENO);
     kj::BufferedInputStreamWrapper input(rawInput);
 
@@ -573,6 +710,8 @@ public:
 
       kj::ArrayPtr<const word> segments = words;
       decodeInner<SegmentArrayMessageReader>(arrayPtr(&segments, 1));
+    } else if (threads > 1) {
+      decodeStreamInParallel(input);
     } else {
       while (input.tryGetReadBuffer().size() > 0) {
         if (packed) {
@@ -607,39 +746,191 @@ private:
     kj::Maybe<kj::Exception> exception;
   };
 
-  template <typename MessageReaderType, typename Input>
-  void decodeInner(Input&& input) {
+  static ReaderOptions decodeReaderOptions() {
     // Since this is a debug tool, lift the usual security limits.  Worse case is the process
     // crashes or has to be killed.
     ReaderOptions options;
     options.nestingLimit = kj::maxValue;
     options.traversalLimitInWords = kj::maxValue;
+    return options;
+  }
 
-    MessageReaderType reader(input, options);
-    kj::String text;
+  template <typename MessageReaderType, typename Input>
+  void decodeInner(Input&& input) {
+    MessageReaderType reader(input, decodeReaderOptions());
+    decodeMessage(reader);
+  }
+
+  void decodeMessage(MessageReader& reader) {
     kj::Maybe<kj::Exception> exception;
 
     {
+      // Stream the text out as we go, rather than building it all in memory, since messages
+      // being debugged can be huge.
+      kj::FdOutputStream output(STDOUT_FILENO);
+      PrettyPrintOptions printOptions;
+      printOptions.indent = pretty;
+      printOptions.threads = threads;
+
       ParseErrorCatcher catcher;
-      auto root = reader.template getRoot<DynamicStruct>(rootType);
-      if (pretty) {
-        text = kj::str(prettyPrint(root), '\n');
-      } else {
-        text = kj::str(root, '\n');
-      }
+      auto root = reader.getRoot<DynamicStruct>(rootType);
+      prettyPrint(output, root, printOptions);
+      output.write("\n", 1);
       exception = kj::mv(catcher.exception);
     }
 
-    kj::FdOutputStream(STDOUT_FILENO).write(text.begin(), text.size());
-
     KJ_IF_MAYBE(e, exception) {
-      context.error(kj::str(
-          "*** ERROR DECODING PREVIOUS MESSAGE ***\n"
-          "The following error occurred while decoding the message above.\n"
-          "This probably means the input data is invalid/corrupted.\n",
-          "Exception description: ", e->getDescription(), "\n"
-          "Code location: ", e->getFile(), ":", e->getLine(), "\n"
-          "*** END ERROR ***"));
+      reportDecodeError(*e);
+    }
+  }
+
+  void reportDecodeError(kj::Exception& e) {
+    context.error(kj::str(
+        "*** ERROR DECODING PREVIOUS MESSAGE ***\n"
+        "The following error occurred while decoding the message above.\n"
+        "This probably means the input data is invalid/corrupted.\n",
+        "Exception description: ", e.getDescription(), "\n"
+        "Code location: ", e.getFile(), ":", e.getLine(), "\n"
+        "*** END ERROR ***"));
+  }
+
+  template <typename Func>
+  void parallelFor(size_t count, Func&& func) {
+    // Calls `func(i)` for each `i` in [0, count) on up to `threads` threads, returning once all
+    // calls are done.  Workers claim indexes in order, so early items finish first.
+
+    size_t next = 0;
+    auto workers = kj::heapArrayBuilder<kj::Own<kj::Thread>>(kj::min(threads, count));
+    while (!workers.isFull()) {
+      workers.add(kj::heap<kj::Thread>([&]() {
+        for (;;) {
+          size_t i = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED);
+          if (i >= count) break;
+          func(i);
+        }
+      }));
+    }
+  }
+
+  // With --threads, messages are decoded a window at a time: the main thread reads a run of
+  // messages, worker threads print them to memory, and then the main thread writes the text out
+  // in order.  A window is bounded both in message count and in input size, so that memory use
+  // doesn't grow with the input.
+
+  static constexpr uint DECODE_WINDOW_MESSAGES_PER_THREAD = 64;
+  static constexpr size_t DECODE_WINDOW_WORDS = 1u << 24;  // 128MiB
+
+  struct DecodeItem {
+    kj::Own<MessageReader> reader;
+    kj::Array<byte> text;
+    kj::Maybe<kj::Exception> exception;
+  };
+
+  bool decodeWindowHasRoom(uint messageCount, size_t wordCount) {
+    return messageCount < threads * DECODE_WINDOW_MESSAGES_PER_THREAD &&
+           wordCount < DECODE_WINDOW_WORDS;
+  }
+
+  kj::Maybe<kj::Array<const word>> tryMapStdin() {
+    // If standard input is a regular file consisting of a whole number of words, map it so that
+    // messages can be read in place.  Returns null if the input has to be streamed instead.
+
+    struct stat stats;
+    KJ_SYSCALL(fstat(STDIN_FILENO, &stats));
+    if (!S_ISREG(stats.st_mode) || stats.st_size == 0 || stats.st_size % sizeof(word) != 0 ||
+        lseek(STDIN_FILENO, 0, SEEK_CUR) != 0) {
+      return nullptr;
+    }
+
+    void* mapping = mmap(nullptr, stats.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+    if (mapping == MAP_FAILED) {
+      return nullptr;
+    }
+    return kj::Array<const word>(reinterpret_cast<const word*>(mapping),
+                                 stats.st_size / sizeof(word), kj::MmapDisposer::instance);
+  }
+
+  void decodeMappedInParallel(kj::ArrayPtr<const word> input) {
+    while (input.size() > 0) {
+      kj::Vector<DecodeItem> window;
+      size_t windowWords = 0;
+
+      // If the input is truncated, still print the messages before the bad one.
+      auto exception = kj::runCatchingExceptions([&]() {
+        while (input.size() > 0 && decodeWindowHasRoom(window.size(), windowWords)) {
+          auto reader = kj::heap<FlatArrayMessageReader>(input, decodeReaderOptions());
+          windowWords += reader->getEnd() - input.begin();
+          input = kj::arrayPtr(reader->getEnd(), input.end());
+          window.add(DecodeItem { kj::mv(reader), nullptr, nullptr });
+        }
+      });
+
+      decodeWindow(window);
+      KJ_IF_MAYBE(e, exception) {
+        kj::throwFatalException(kj::mv(*e));
+      }
+    }
+  }
+
+  void decodeStreamInParallel(kj::BufferedInputStream& input) {
+    while (input.tryGetReadBuffer().size() > 0) {
+      kj::Vector<DecodeItem> window;
+      size_t windowWords = 0;
+
+      auto exception = kj::runCatchingExceptions([&]() {
+        while (input.tryGetReadBuffer().size() > 0 &&
+               decodeWindowHasRoom(window.size(), windowWords)) {
+          kj::Own<MessageReader> reader;
+          if (packed) {
+            reader = kj::heap<PackedMessageReader>(input, decodeReaderOptions());
+          } else {
+            reader = kj::heap<InputStreamMessageReader>(input, decodeReaderOptions());
+          }
+
+          // Force any lazily-read segments in now; the workers must not touch `input`.
+          for (uint i = 0, count = reader->getSegmentCount(); i < count; i++) {
+            windowWords += reader->getSegment(i).size();
+          }
+
+          window.add(DecodeItem { kj::mv(reader), nullptr, nullptr });
+        }
+      });
+
+      decodeWindow(window);
+      KJ_IF_MAYBE(e, exception) {
+        kj::throwFatalException(kj::mv(*e));
+      }
+    }
+  }
+
+  void decodeWindow(kj::ArrayPtr<DecodeItem> window) {
+    if (window.size() == 1) {
+      // Nothing to spread across messages, so let the printer parallelize within the message.
+      decodeMessage(*window[0].reader);
+      return;
+    }
+
+    PrettyPrintOptions printOptions;
+    printOptions.indent = pretty;
+
+    parallelFor(window.size(), [&](size_t i) {
+      auto& item = window[i];
+
+      VectorOutputStream text;
+      ParseErrorCatcher catcher;
+      auto root = item.reader->getRoot<DynamicStruct>(rootType);
+      prettyPrint(text, root, printOptions);
+      text.write("\n", 1);
+      item.text = text.releaseArray();
+      item.exception = kj::mv(catcher.exception);
+    });
+
+    kj::FdOutputStream output(STDOUT_FILENO);
+    for (auto& item: window) {
+      output.write(item.text.begin(), item.text.size());
+      KJ_IF_MAYBE(e, item.exception) {
+        reportDecodeError(*e);
+      }
     }
   }
 
@@ -991,11 +1282,49 @@ public:
     }
 
     EncoderErrorReporter errorReporter(*this, allText);
+
+    if (threads > 1) {
+      encodeInParallel(allText, errorReporter);
+      context.exit();
+    }
+
+    // Set up output stream.
+    kj::FdOutputStream rawOutput(STDOUT_FILENO);
+    kj::BufferedOutputStreamWrapper output(rawOutput);
+
+    switch (encodeText(allText, errorReporter, output)) {
+      case ENCODE_OK:
+        break;
+      case ENCODE_PARSE_ERROR:
+        context.exit();
+        break;
+      case ENCODE_PREMATURE_EOF:
+        context.exitError("Premature EOF.");
+    }
+
+    output.flush();
+    context.exit();
+    KJ_CLANG_KNOWS_THIS_IS_UNREACHABLE_BUT_GCC_DOESNT;
+  }
+
+private:
+  enum EncodeResult {
+    ENCODE_OK,
+    ENCODE_PARSE_ERROR,
+    // Already reported to the ErrorReporter.
+    ENCODE_PREMATURE_EOF
+  };
+
+  EncodeResult encodeText(kj::ArrayPtr<const char> text, ErrorReporter& errorReporter,
+                          kj::BufferedOutputStream& output) {
+    // Encodes each value in `text` to `output`, stopping at the first one that doesn't parse.
+    // Translation errors are reported and the offending value is skipped.
+
     MallocMessageBuilder arena;
 
     // Lex the input.
     auto lexedTokens = arena.initRoot<LexedTokens>();
-    lex(allText, lexedTokens, errorReporter);
+    lex(text, lexedTokens, errorReporter);
 
     // Set up the parser.
     CapnpParser parser(arena.getOrphanage(), errorReporter);
@@ -1007,10 +1336,6 @@ public:
     auto type = arena.getOrphanage().newOrphan<schema::Type>();
     type.get().initStruct().setTypeId(rootType.getProto().getId());
 
-    // Set up output stream.
-    kj::FdOutputStream rawOutput(STDOUT_FILENO);
-    kj::BufferedOutputStreamWrapper output(rawOutput);
-
     while (parserInput.getPosition() != tokens.end()) {
       KJ_IF_MAYBE(expression, parser.getParsers().parenthesizedValueExpression(parserInput)) {
         MallocMessageBuilder item(
@@ -1035,19 +1360,110 @@ public:
       } else {
         auto best = parserInput.getBest();
         if (best == tokens.end()) {
-          context.exitError("Premature EOF.");
+          return ENCODE_PREMATURE_EOF;
         } else {
           errorReporter.addErrorOn(*best, "Parse error.");
-          context.exit();
+          return ENCODE_PARSE_ERROR;
         }
       }
     }
 
-    output.flush();
-    context.exit();
-    KJ_CLANG_KNOWS_THIS_IS_UNREACHABLE_BUT_GCC_DOESNT;
+    return ENCODE_OK;
+  }
+
+  // With --threads, encode splits the input into chunks at line breaks and hands them to worker
+  // threads a window at a time, each chunk being lexed, parsed, and encoded to memory
+  // independently.  The main thread then writes each chunk's output and reports its errors, in
+  // input order.
+
+  static constexpr size_t ENCODE_CHUNK_BYTES = 1u << 20;
+  static constexpr uint ENCODE_WINDOW_CHUNKS_PER_THREAD = 4;
+
+  class ChunkErrorReporter final: public ErrorReporter {
+    // Collects the errors found in one chunk of input, so that they can be reported in order once
+    // the chunk is done.
+  public:
+    explicit ChunkErrorReporter(uint32_t offset): offset(offset) {}
+
+    void addError(uint32_t startByte, uint32_t endByte, kj::StringPtr message) override {
+      errors.add(Error { offset + startByte, offset + endByte, kj::heapString(message) });
+    }
+
+    bool hadErrors() override {
+      return errors.size() > 0;
+    }
+
+    void replay(ErrorReporter& target) {
+      for (auto& error: errors) {
+        target.addError(error.startByte, error.endByte, error.message);
+      }
+    }
+
+  private:
+    struct Error {
+      uint32_t startByte;
+      uint32_t endByte;
+      kj::String message;
+    };
+
+    uint32_t offset;
+    kj::Vector<Error> errors;
+  };
+
+  struct EncodeChunk {
+    kj::ArrayPtr<const char> text;
+    ChunkErrorReporter errors;
+    kj::Array<byte> output;
+    EncodeResult result = ENCODE_OK;
+
+    EncodeChunk(kj::ArrayPtr<const char> text, uint32_t offset): text(text), errors(offset) {}
+  };
+
+  void encodeInParallel(kj::ArrayPtr<const char> text, ErrorReporter& errorReporter) {
+    // Compile everything the translators could need up front, as in decode().
+    compiler->eagerlyCompile(rootType.getProto().getId(),
+        Compiler::NODE | Compiler::DEPENDENCIES | Compiler::DEPENDENCY_DEPENDENCIES);
+
+    kj::FdOutputStream output(STDOUT_FILENO);
+    const char* pos = text.begin();
+
+    while (pos < text.end()) {
+      kj::Vector<EncodeChunk> window;
+      while (pos < text.end() && window.size() < threads * ENCODE_WINDOW_CHUNKS_PER_THREAD) {
+        const char* end = pos + kj::min(ENCODE_CHUNK_BYTES, size_t(text.end() - pos));
+        while (end < text.end() && end[-1] != '\n') ++end;
+        window.add(kj::arrayPtr(pos, end), pos - text.begin());
+        pos = end;
+      }
+
+      parallelFor(window.size(), [&](size_t i) {
+        auto& chunk = window[i];
+        VectorOutputStream rawChunkOutput;
+        {
+          kj::BufferedOutputStreamWrapper chunkOutput(rawChunkOutput);
+          chunk.result = encodeText(chunk.text, chunk.errors, chunkOutput);
+          chunkOutput.flush();
+        }
+        chunk.output = rawChunkOutput.releaseArray();
+      });
+
+      for (auto& chunk: window) {
+        output.write(chunk.output.begin(), chunk.output.size());
+        chunk.errors.replay(errorReporter);
+        switch (chunk.result) {
+          case ENCODE_OK:
+            break;
+          case ENCODE_PARSE_ERROR:
+            context.exit();
+            break;
+          case ENCODE_PREMATURE_EOF:
+            context.exitError("Premature EOF.");
+        }
+      }
+    }
   }
 
+public:
   kj::MainBuilder::Validity evalConst(kj::StringPtr name) {
     KJ_ASSERT(sourceFiles.size() == 1);
 
@@ -1319,6 +1735,7 @@ private:
   bool packed = false;
   bool pretty = true;
   bool quiet = false;
+  uint threads = 1;
   uint segmentSize = 0;
   StructSchema rootType;
   // For the "decode" and "encode" commands.
@@ -1331,6 +1748,9 @@ private:
 
   kj::Vector<SourceFile> sourceFiles;
 
+  kj::Vector<Module*> pendingSources;
+  // For the "compile" command, sources which have been loaded but not yet compiled.
+
   struct OutputDirective {
     kj::ArrayPtr<const char> name;
     kj::StringPtr dir;
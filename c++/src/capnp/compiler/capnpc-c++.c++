@@ -131,6 +131,25 @@ kj::Array<uint> makeMembersByName(MemberList&& members) {
   return KJ_MAP(member, sorted) { return member.getIndex(); };
 }
 
+template <typename MemberList>
+kj::Array<uint16_t> makeMemberHash(MemberList&& members) {
+  auto keys = KJ_MAP(member, members) {
+    return capnp::_::hashMemberName(member.getProto().getName());
+  };
+  auto values = KJ_MAP(member, members) { return static_cast<uint16_t>(member.getIndex()); };
+  return capnp::_::buildPerfectHash(keys, values);
+}
+
+kj::Array<uint16_t> makeDependencyHash(const std::set<uint64_t>& deps) {
+  auto keys = KJ_MAP(dep, deps) { return dep; };
+  auto values = KJ_MAP(i, kj::range<uint>(0, keys.size())) { return static_cast<uint16_t>(i); };
+  return capnp::_::buildPerfectHash(keys, values);
+}
+
+kj::StringTree hashTableLiteral(kj::ArrayPtr<const uint16_t> table) {
+  return kj::StringTree(KJ_MAP(value, table) { return kj::strTree(value); }, ", ");
+}
+
 kj::StringPtr baseName(kj::StringPtr path) {
   KJ_IF_MAYBE(slashPos, path.findLast('/')) {
     return path.slice(*slashPos + 1);
@@ -1039,7 +1058,8 @@ private:
   };
 
   kj::StringTree makeReaderDef(kj::StringPtr fullName, kj::StringPtr unqualifiedParentType,
-                               bool isUnion, kj::Array<kj::StringTree>&& methodDecls) {
+                               bool isUnion, uint fieldCount,
+                               kj::Array<kj::StringTree>&& methodDecls) {
     return kj::strTree(
         "class ", fullName, "::Reader {\n"
         "public:\n"
@@ -1051,6 +1071,8 @@ private:
         "  inline ::capnp::MessageSize totalSize() const {\n"
         "    return _reader.totalSize().asPublic();\n"
         "  }\n"
+        "\n"
+        "  inline ::capnp::FieldPresence<", fieldCount, "> presenceMask() const;\n"
         "\n",
         isUnion ? kj::strTree("  inline Which which() const;\n") : kj::strTree(),
         kj::mv(methodDecls),
@@ -1074,7 +1096,8 @@ private:
   }
 
   kj::StringTree makeBuilderDef(kj::StringPtr fullName, kj::StringPtr unqualifiedParentType,
-                                bool isUnion, kj::Array<kj::StringTree>&& methodDecls) {
+                                bool isUnion, bool isGroup,
+                                kj::Array<kj::StringTree>&& methodDecls) {
     return kj::strTree(
         "class ", fullName, "::Builder {\n"
         "public:\n"
@@ -1089,6 +1112,9 @@ private:
         "\n"
         "  inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }\n"
         "\n",
+        isGroup ? kj::strTree() : kj::strTree(
+            "  inline void copyFrom(Reader other);\n"
+            "\n"),
         isUnion ? kj::strTree("  inline Which which();\n") : kj::strTree(),
         kj::mv(methodDecls),
         "private:\n"
@@ -1125,6 +1151,121 @@ private:
         "\n");
   }
 
+  kj::StringTree makeCopyFromDef(kj::StringPtr fullName, StructSchema schema) {
+    // Builder::copyFrom() copies the whole data section at once, then each pointer according to
+    // the schema.  Text, Data and struct fields outside of unions get typed copies (struct fields
+    // recursing into their own copyFrom()); the remaining pointers -- lists, capabilities,
+    // AnyPointers, and slots shared between union members -- are copied generically.
+
+    auto structNode = schema.getProto().getStruct();
+    auto pointerTypes = kj::heapArray<kj::String>(structNode.getPointerCount());
+
+    for (auto field: schema.getFields()) {
+      auto proto = field.getProto();
+      if (proto.which() != schema::Field::SLOT || hasDiscriminantValue(proto)) continue;
+      auto slot = proto.getSlot();
+      switch (slot.getType().which()) {
+        case schema::Type::TEXT:
+        case schema::Type::DATA:
+        case schema::Type::STRUCT:
+          pointerTypes[slot.getOffset()] = typeName(slot.getType()).flatten();
+          break;
+        default:
+          break;
+      }
+    }
+
+    kj::Vector<kj::StringTree> pointerCopies(pointerTypes.size());
+    for (auto i: kj::indices(pointerTypes)) {
+      if (pointerTypes[i] == nullptr) {
+        pointerCopies.add(kj::strTree(
+            "  _builder.getPointerField(", i, " * ::capnp::POINTERS).copyFrom(\n"
+            "      _other.getPointerField(", i, " * ::capnp::POINTERS));\n"));
+      } else {
+        pointerCopies.add(kj::strTree(
+            "  ::capnp::_::PointerHelpers<", pointerTypes[i], ">::copy(\n"
+            "      _builder.getPointerField(", i, " * ::capnp::POINTERS),\n"
+            "      _other.getPointerField(", i, " * ::capnp::POINTERS));\n"));
+      }
+    }
+
+    return kj::strTree(
+        "inline void ", fullName, "::Builder::copyFrom(Reader other) {\n"
+        "  ::capnp::_::StructReader _other =\n"
+        "      ::capnp::_::PointerHelpers<", fullName, ">::getInternalReader(other);\n",
+        pointerCopies.size() == 0 ? kj::strTree("  _builder.copyDataFrom(_other);\n") :
+            kj::strTree("  if (!_builder.copyDataFrom(_other)) return;\n",
+                        pointerCopies.releaseAsArray()),
+        "}\n"
+        "\n");
+  }
+
+  kj::StringTree makePresenceMaskDef(kj::StringPtr fullName, StructSchema schema) {
+    // Reader::presenceMask() gets all the non-null pointers from a single scan of the pointer
+    // section, then tests each data field directly.
+
+    auto structNode = schema.getProto().getStruct();
+    auto fields = schema.getFields();
+    uint pointerWords = (structNode.getPointerCount() + 63) / 64;
+    bool anyPointers = false;
+
+    auto bits = KJ_MAP(field, fields) -> kj::StringTree {
+      auto proto = field.getProto();
+      kj::String active;
+      if (hasDiscriminantValue(proto)) {
+        active = kj::str("which() == ", fullName, "::", toUpperCase(proto.getName()));
+      }
+
+      kj::String test;
+      switch (proto.which()) {
+        case schema::Field::SLOT: {
+          auto slot = proto.getSlot();
+          auto whichType = slot.getType().which();
+          switch (sectionFor(whichType)) {
+            case Section::NONE:
+              break;
+            case Section::DATA:
+              test = kj::str("_reader.hasDataField<", maskType(whichType), ">(",
+                             slot.getOffset(), " * ::capnp::ELEMENTS)");
+              break;
+            case Section::POINTERS:
+              anyPointers = true;
+              test = kj::str("(_pointers[", slot.getOffset() / 64, "] >> ",
+                             slot.getOffset() % 64, ") & 1");
+              break;
+          }
+          break;
+        }
+        case schema::Field::GROUP:
+          break;
+      }
+
+      if (active == nullptr && test == nullptr) {
+        return kj::strTree("  _result.set(", field.getIndex(), ", true);\n");
+      } else if (active == nullptr) {
+        return kj::strTree("  _result.set(", field.getIndex(), ", ", test, ");\n");
+      } else if (test == nullptr) {
+        return kj::strTree("  _result.set(", field.getIndex(), ", ", active, ");\n");
+      } else {
+        return kj::strTree(
+            "  _result.set(", field.getIndex(), ", ", active, " && (", test, "));\n");
+      }
+    };
+
+    return kj::strTree(
+        "inline ::capnp::FieldPresence<", fields.size(), "> ",
+            fullName, "::Reader::presenceMask() const {\n",
+        anyPointers ? kj::strTree(
+            "  uint64_t _pointers[", pointerWords, "];\n"
+            "  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, ", pointerWords, "));\n")
+            : kj::strTree(),
+        "  ::capnp::FieldPresence<", fields.size(), "> _result;\n",
+        kj::mv(bits),
+        "  return _result;\n"
+        "}\n"
+        "\n");
+  }
+
   StructText makeStructText(kj::StringPtr scope, kj::StringPtr name, StructSchema schema,
                             kj::Array<kj::StringTree> nestedTypeDecls) {
     auto proto = schema.getProto();
@@ -1162,8 +1303,10 @@ private:
 
       kj::strTree(
           makeReaderDef(fullName, name, structNode.getDiscriminantCount() != 0,
+                        schema.getFields().size(),
                         KJ_MAP(f, fieldTexts) { return kj::mv(f.readerMethodDecls); }),
           makeBuilderDef(fullName, name, structNode.getDiscriminantCount() != 0,
+                         structNode.getIsGroup(),
                          KJ_MAP(f, fieldTexts) { return kj::mv(f.builderMethodDecls); }),
           makePipelineDef(fullName, name, structNode.getDiscriminantCount() != 0,
                           KJ_MAP(f, fieldTexts) { return kj::mv(f.pipelineMethodDecls); })),
@@ -1177,6 +1320,8 @@ private:
               "  return _builder.getDataField<Which>(", discrimOffset, " * ::capnp::ELEMENTS);\n"
               "}\n"
               "\n"),
+          makePresenceMaskDef(fullName, schema),
+          structNode.getIsGroup() ? kj::strTree() : makeCopyFromDef(fullName, schema),
           KJ_MAP(f, fieldTexts) { return kj::mv(f.inlineMethodDefs); })
     };
   }
@@ -1571,11 +1716,13 @@ private:
     enumerateDeps(proto, deps);
 
     kj::Array<uint> membersByName;
+    kj::Array<uint16_t> memberHash;
     kj::Array<uint> membersByDiscrim;
     switch (proto.which()) {
       case schema::Node::STRUCT: {
         auto structSchema = schema.asStruct();
         membersByName = makeMembersByName(structSchema.getFields());
+        memberHash = makeMemberHash(structSchema.getFields());
         auto builder = kj::heapArrayBuilder<uint>(structSchema.getFields().size());
         for (auto field: structSchema.getUnionFields()) {
           builder.add(field.getIndex());
@@ -1588,14 +1735,18 @@ private:
       }
       case schema::Node::ENUM:
         membersByName = makeMembersByName(schema.asEnum().getEnumerants());
+        memberHash = makeMemberHash(schema.asEnum().getEnumerants());
         break;
       case schema::Node::INTERFACE:
         membersByName = makeMembersByName(schema.asInterface().getMethods());
+        memberHash = makeMemberHash(schema.asInterface().getMethods());
         break;
       default:
         break;
     }
 
+    auto dependencyHash = makeDependencyHash(deps);
+
     auto schemaDef = kj::strTree(
         "static const ::capnp::_::AlignedData<", rawSchema.size(), "> b_", hexId, " = {\n"
         "  {", kj::mv(schemaLiteral), " }\n"
@@ -1614,13 +1765,21 @@ private:
             "static const uint16_t i_", hexId, "[] = {",
             kj::StringTree(KJ_MAP(index, membersByDiscrim) { return kj::strTree(index); }, ", "),
             "};\n"),
+        memberHash.size() == 0 ? kj::strTree() : kj::strTree(
+            "static const uint16_t mh_", hexId, "[] = {", hashTableLiteral(memberHash), "};\n"),
+        dependencyHash.size() == 0 ? kj::strTree() : kj::strTree(
+            "static const uint16_t dh_", hexId, "[] = {", hashTableLiteral(dependencyHash),
+            "};\n"),
         "const ::capnp::_::RawSchema s_", hexId, " = {\n"
         "  0x", hexId, ", b_", hexId, ".words, ", rawSchema.size(), ", ",
         deps.size() == 0 ? kj::strTree("nullptr") : kj::strTree("d_", hexId), ", ",
         membersByName.size() == 0 ? kj::strTree("nullptr") : kj::strTree("m_", hexId), ",\n",
         "  ", deps.size(), ", ", membersByName.size(), ", ",
         membersByDiscrim.size() == 0 ? kj::strTree("nullptr") : kj::strTree("i_", hexId),
-        ", nullptr, nullptr\n"
+        ", nullptr, nullptr,\n  ",
+        memberHash.size() == 0 ? kj::strTree("nullptr") : kj::strTree("mh_", hexId), ", ",
+        dependencyHash.size() == 0 ? kj::strTree("nullptr") : kj::strTree("dh_", hexId),
+        ", nullptr\n"  // structLayout:  built at run time, on first use.
         "};\n");
 
     NodeTextNoSchema top = makeNodeTextWithoutNested(
@@ -1949,11 +2108,7 @@ private:
     int fd;
     KJ_SYSCALL(fd = open(filename.cStr(), O_CREAT | O_WRONLY | O_TRUNC, 0666), filename);
     kj::FdOutputStream out((kj::AutoCloseFd(fd)));
-
-    text.visit(
-        [&](kj::ArrayPtr<const char> text) {
-          out.write(text.begin(), text.size());
-        });
+    text.writeTo(out);
   }
 
   kj::MainBuilder::Validity run() {
@@ -550,14 +550,10 @@ private:
       schemaLoader.load(node);
     }
 
-    kj::FdOutputStream rawOut(STDOUT_FILENO);
-    kj::BufferedOutputStreamWrapper out(rawOut);
+    kj::FdOutputStream out(STDOUT_FILENO);
 
     for (auto requestedFile: request.getRequestedFiles()) {
-      genFile(schemaLoader.get(requestedFile.getId())).visit(
-          [&](kj::ArrayPtr<const char> text) {
-            out.write(text.begin(), text.size());
-          });
+      genFile(schemaLoader.get(requestedFile.getId())).writeTo(out);
     }
 
     return true;
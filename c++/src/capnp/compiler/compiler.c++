@@ -22,14 +22,13 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "compiler.h"
-#include "parser.h"      // only for generateChildId()
+#include "parser.h"      // only for generateChildId() and findImports()
 #include <kj/mutex.h>
 #include <kj/arena.h>
 #include <kj/vector.h>
 #include <kj/debug.h>
 #include <capnp/message.h>
 #include <map>
-#include <set>
 #include <unordered_map>
 #include "node-translator.h"
 #include "md5.h"
@@ -892,82 +891,9 @@ kj::Maybe<Compiler::CompiledModule&> Compiler::CompiledModule::importRelative(
       });
 }
 
-static void findImports(DeclName::Reader name, std::set<kj::StringPtr>& output) {
-  if (name.getBase().isImportName()) {
-    output.insert(name.getBase().getImportName().getValue());
-  }
-}
-
-static void findImports(TypeExpression::Reader type, std::set<kj::StringPtr>& output) {
-  findImports(type.getName(), output);
-  for (auto param: type.getParams()) {
-    findImports(param, output);
-  }
-}
-
-static void findImports(Declaration::Reader decl, std::set<kj::StringPtr>& output) {
-  switch (decl.which()) {
-    case Declaration::USING:
-      findImports(decl.getUsing().getTarget(), output);
-      break;
-    case Declaration::CONST:
-      findImports(decl.getConst().getType(), output);
-      break;
-    case Declaration::FIELD:
-      findImports(decl.getField().getType(), output);
-      break;
-    case Declaration::INTERFACE:
-      for (auto extend: decl.getInterface().getExtends()) {
-        findImports(extend, output);
-      }
-      break;
-    case Declaration::METHOD: {
-      auto method = decl.getMethod();
-
-      auto params = method.getParams();
-      if (params.isNamedList()) {
-        for (auto param: params.getNamedList()) {
-          findImports(param.getType(), output);
-          for (auto ann: param.getAnnotations()) {
-            findImports(ann.getName(), output);
-          }
-        }
-      } else {
-        findImports(params.getType(), output);
-      }
-
-      if (method.getResults().isExplicit()) {
-        auto results = method.getResults().getExplicit();
-        if (results.isNamedList()) {
-          for (auto param: results.getNamedList()) {
-            findImports(param.getType(), output);
-            for (auto ann: param.getAnnotations()) {
-              findImports(ann.getName(), output);
-            }
-          }
-        } else {
-          findImports(results.getType(), output);
-        }
-      }
-      break;
-    }
-    default:
-      break;
-  }
-
-  for (auto ann: decl.getAnnotations()) {
-    findImports(ann.getName(), output);
-  }
-
-  for (auto nested: decl.getNestedDecls()) {
-    findImports(nested, output);
-  }
-}
-
 Orphan<List<schema::CodeGeneratorRequest::RequestedFile::Import>>
     Compiler::CompiledModule::getFileImportTable(Orphanage orphanage) {
-  std::set<kj::StringPtr> importNames;
-  findImports(content.getReader().getRoot(), importNames);
+  auto importNames = findImports(content.getReader().getRoot());
 
   auto result = orphanage.newOrphan<List<schema::CodeGeneratorRequest::RequestedFile::Import>>(
       importNames.size());
@@ -71,9 +71,11 @@ static const ::capnp::_::AlignedData<62> b_e75816b56529d464 = {
 };
 static const uint16_t m_e75816b56529d464[] = {2, 1, 0};
 static const uint16_t i_e75816b56529d464[] = {0, 1, 2};
+static const uint16_t mh_e75816b56529d464[] = {1, 4, 0, 2, 65535, 0, 1};
 const ::capnp::_::RawSchema s_e75816b56529d464 = {
   0xe75816b56529d464, b_e75816b56529d464.words, 62, nullptr, m_e75816b56529d464,
-  0, 3, i_e75816b56529d464, nullptr, nullptr
+  0, 3, i_e75816b56529d464, nullptr, nullptr,
+  mh_e75816b56529d464, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<62> b_991c7a3693d62cf2 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -141,9 +143,11 @@ static const ::capnp::_::AlignedData<62> b_991c7a3693d62cf2 = {
 };
 static const uint16_t m_991c7a3693d62cf2[] = {2, 1, 0};
 static const uint16_t i_991c7a3693d62cf2[] = {0, 1, 2};
+static const uint16_t mh_991c7a3693d62cf2[] = {1, 4, 0, 2, 65535, 0, 1};
 const ::capnp::_::RawSchema s_991c7a3693d62cf2 = {
   0x991c7a3693d62cf2, b_991c7a3693d62cf2.words, 62, nullptr, m_991c7a3693d62cf2,
-  0, 3, i_991c7a3693d62cf2, nullptr, nullptr
+  0, 3, i_991c7a3693d62cf2, nullptr, nullptr,
+  mh_991c7a3693d62cf2, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<62> b_90f2a60678fd2367 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -211,9 +215,11 @@ static const ::capnp::_::AlignedData<62> b_90f2a60678fd2367 = {
 };
 static const uint16_t m_90f2a60678fd2367[] = {2, 1, 0};
 static const uint16_t i_90f2a60678fd2367[] = {0, 1, 2};
+static const uint16_t mh_90f2a60678fd2367[] = {1, 4, 0, 2, 65535, 0, 1};
 const ::capnp::_::RawSchema s_90f2a60678fd2367 = {
   0x90f2a60678fd2367, b_90f2a60678fd2367.words, 62, nullptr, m_90f2a60678fd2367,
-  0, 3, i_90f2a60678fd2367, nullptr, nullptr
+  0, 3, i_90f2a60678fd2367, nullptr, nullptr,
+  mh_90f2a60678fd2367, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<73> b_ce5c2afd239fe34e = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -296,9 +302,12 @@ static const ::capnp::_::RawSchema* const d_ce5c2afd239fe34e[] = {
 };
 static const uint16_t m_ce5c2afd239fe34e[] = {0, 3, 1, 2};
 static const uint16_t i_ce5c2afd239fe34e[] = {0, 1, 2, 3};
+static const uint16_t mh_ce5c2afd239fe34e[] = {2, 6, 2, 0, 2, 0, 65535, 3, 1, 65535};
+static const uint16_t dh_ce5c2afd239fe34e[] = {1, 3, 3, 1, 65535, 0};
 const ::capnp::_::RawSchema s_ce5c2afd239fe34e = {
   0xce5c2afd239fe34e, b_ce5c2afd239fe34e.words, 73, d_ce5c2afd239fe34e, m_ce5c2afd239fe34e,
-  2, 4, i_ce5c2afd239fe34e, nullptr, nullptr
+  2, 4, i_ce5c2afd239fe34e, nullptr, nullptr,
+  mh_ce5c2afd239fe34e, dh_ce5c2afd239fe34e, nullptr
 };
 static const ::capnp::_::AlignedData<63> b_c42df56830922111 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -371,9 +380,12 @@ static const ::capnp::_::RawSchema* const d_c42df56830922111[] = {
 };
 static const uint16_t m_c42df56830922111[] = {0, 2, 1};
 static const uint16_t i_c42df56830922111[] = {0, 1, 2};
+static const uint16_t mh_c42df56830922111[] = {1, 4, 7, 65535, 0, 1, 2};
+static const uint16_t dh_c42df56830922111[] = {1, 3, 0, 1, 65535, 0};
 const ::capnp::_::RawSchema s_c42df56830922111 = {
   0xc42df56830922111, b_c42df56830922111.words, 63, d_c42df56830922111, m_c42df56830922111,
-  2, 3, i_c42df56830922111, nullptr, nullptr
+  2, 3, i_c42df56830922111, nullptr, nullptr,
+  mh_c42df56830922111, dh_c42df56830922111, nullptr
 };
 static const ::capnp::_::AlignedData<79> b_8751968764a2e298 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -462,9 +474,12 @@ static const ::capnp::_::RawSchema* const d_8751968764a2e298[] = {
 };
 static const uint16_t m_8751968764a2e298[] = {3, 0, 1, 2};
 static const uint16_t i_8751968764a2e298[] = {0, 1, 2, 3};
+static const uint16_t mh_8751968764a2e298[] = {2, 6, 0, 2, 65535, 0, 3, 2, 1, 65535};
+static const uint16_t dh_8751968764a2e298[] = {1, 3, 0, 65535, 0, 1};
 const ::capnp::_::RawSchema s_8751968764a2e298 = {
   0x8751968764a2e298, b_8751968764a2e298.words, 79, d_8751968764a2e298, m_8751968764a2e298,
-  2, 4, i_8751968764a2e298, nullptr, nullptr
+  2, 4, i_8751968764a2e298, nullptr, nullptr,
+  mh_8751968764a2e298, dh_8751968764a2e298, nullptr
 };
 static const ::capnp::_::AlignedData<172> b_9ca8b2acb16fc545 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -647,9 +662,12 @@ static const ::capnp::_::RawSchema* const d_9ca8b2acb16fc545[] = {
 };
 static const uint16_t m_9ca8b2acb16fc545[] = {9, 3, 6, 5, 2, 1, 8, 4, 7, 0};
 static const uint16_t i_9ca8b2acb16fc545[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+static const uint16_t mh_9ca8b2acb16fc545[] = {3, 13, 3, 29, 0, 8, 6, 0, 4, 9, 65535, 1, 5, 7, 2, 3, 65535, 65535};
+static const uint16_t dh_9ca8b2acb16fc545[] = {1, 4, 4, 1, 2, 0, 65535};
 const ::capnp::_::RawSchema s_9ca8b2acb16fc545 = {
   0x9ca8b2acb16fc545, b_9ca8b2acb16fc545.words, 172, d_9ca8b2acb16fc545, m_9ca8b2acb16fc545,
-  3, 10, i_9ca8b2acb16fc545, nullptr, nullptr
+  3, 10, i_9ca8b2acb16fc545, nullptr, nullptr,
+  mh_9ca8b2acb16fc545, dh_9ca8b2acb16fc545, nullptr
 };
 static const ::capnp::_::AlignedData<50> b_b6b57cf8b27fba0e = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -709,9 +727,12 @@ static const ::capnp::_::RawSchema* const d_b6b57cf8b27fba0e[] = {
 };
 static const uint16_t m_b6b57cf8b27fba0e[] = {0, 1};
 static const uint16_t i_b6b57cf8b27fba0e[] = {0, 1};
+static const uint16_t mh_b6b57cf8b27fba0e[] = {1, 3, 1, 0, 65535, 1};
+static const uint16_t dh_b6b57cf8b27fba0e[] = {1, 3, 1, 0, 65535, 1};
 const ::capnp::_::RawSchema s_b6b57cf8b27fba0e = {
   0xb6b57cf8b27fba0e, b_b6b57cf8b27fba0e.words, 50, d_b6b57cf8b27fba0e, m_b6b57cf8b27fba0e,
-  2, 2, i_b6b57cf8b27fba0e, nullptr, nullptr
+  2, 2, i_b6b57cf8b27fba0e, nullptr, nullptr,
+  mh_b6b57cf8b27fba0e, dh_b6b57cf8b27fba0e, nullptr
 };
 static const ::capnp::_::AlignedData<553> b_96efe787c17e83bb = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1283,9 +1304,12 @@ static const ::capnp::_::RawSchema* const d_96efe787c17e83bb[] = {
 };
 static const uint16_t m_96efe787c17e83bb[] = {18, 3, 37, 22, 34, 31, 32, 24, 25, 26, 23, 35, 36, 33, 28, 29, 30, 27, 21, 9, 6, 5, 10, 11, 13, 7, 15, 1, 16, 17, 20, 19, 0, 2, 4, 12, 14, 8};
 static const uint16_t i_96efe787c17e83bb[] = {7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 0, 1, 2, 3, 4, 5, 6};
+static const uint16_t mh_96efe787c17e83bb[] = {10, 48, 9, 4, 8, 27, 0, 1, 13, 0, 2, 5, 3, 35, 15, 4, 12, 0, 10, 31, 65535, 2, 26, 14, 65535, 17, 25, 65535, 20, 65535, 1, 65535, 65535, 29, 22, 21, 65535, 11, 9, 7, 18, 6, 8, 65535, 34, 5, 24, 27, 16, 28, 30, 33, 65535, 65535, 13, 19, 37, 36, 32, 23};
+static const uint16_t dh_96efe787c17e83bb[] = {3, 14, 1, 5, 54, 65535, 5, 3, 0, 10, 8, 6, 4, 65535, 7, 2, 65535, 9, 1};
 const ::capnp::_::RawSchema s_96efe787c17e83bb = {
   0x96efe787c17e83bb, b_96efe787c17e83bb.words, 553, d_96efe787c17e83bb, m_96efe787c17e83bb,
-  11, 38, i_96efe787c17e83bb, nullptr, nullptr
+  11, 38, i_96efe787c17e83bb, nullptr, nullptr,
+  mh_96efe787c17e83bb, dh_96efe787c17e83bb, nullptr
 };
 static const ::capnp::_::AlignedData<43> b_d00489d473826290 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1338,9 +1362,12 @@ static const ::capnp::_::RawSchema* const d_d00489d473826290[] = {
 };
 static const uint16_t m_d00489d473826290[] = {0, 1};
 static const uint16_t i_d00489d473826290[] = {0, 1};
+static const uint16_t mh_d00489d473826290[] = {1, 3, 0, 0, 65535, 1};
+static const uint16_t dh_d00489d473826290[] = {1, 3, 0, 65535, 1, 0};
 const ::capnp::_::RawSchema s_d00489d473826290 = {
   0xd00489d473826290, b_d00489d473826290.words, 43, d_d00489d473826290, m_d00489d473826290,
-  2, 2, i_d00489d473826290, nullptr, nullptr
+  2, 2, i_d00489d473826290, nullptr, nullptr,
+  mh_d00489d473826290, dh_d00489d473826290, nullptr
 };
 static const ::capnp::_::AlignedData<50> b_fb5aeed95cdf6af9 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1400,9 +1427,12 @@ static const ::capnp::_::RawSchema* const d_fb5aeed95cdf6af9[] = {
 };
 static const uint16_t m_fb5aeed95cdf6af9[] = {1, 0};
 static const uint16_t i_fb5aeed95cdf6af9[] = {0, 1};
+static const uint16_t mh_fb5aeed95cdf6af9[] = {1, 3, 0, 1, 0, 65535};
+static const uint16_t dh_fb5aeed95cdf6af9[] = {1, 3, 0, 0, 1, 65535};
 const ::capnp::_::RawSchema s_fb5aeed95cdf6af9 = {
   0xfb5aeed95cdf6af9, b_fb5aeed95cdf6af9.words, 50, d_fb5aeed95cdf6af9, m_fb5aeed95cdf6af9,
-  2, 2, i_fb5aeed95cdf6af9, nullptr, nullptr
+  2, 2, i_fb5aeed95cdf6af9, nullptr, nullptr,
+  mh_fb5aeed95cdf6af9, dh_fb5aeed95cdf6af9, nullptr
 };
 static const ::capnp::_::AlignedData<81> b_b3f66e7a79d81bcd = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1493,9 +1523,12 @@ static const ::capnp::_::RawSchema* const d_b3f66e7a79d81bcd[] = {
 };
 static const uint16_t m_b3f66e7a79d81bcd[] = {3, 0, 2, 1};
 static const uint16_t i_b3f66e7a79d81bcd[] = {0, 1, 2, 3};
+static const uint16_t mh_b3f66e7a79d81bcd[] = {2, 6, 2, 0, 2, 0, 1, 3, 65535, 65535};
+static const uint16_t dh_b3f66e7a79d81bcd[] = {1, 3, 0, 1, 65535, 0};
 const ::capnp::_::RawSchema s_b3f66e7a79d81bcd = {
   0xb3f66e7a79d81bcd, b_b3f66e7a79d81bcd.words, 81, d_b3f66e7a79d81bcd, m_b3f66e7a79d81bcd,
-  2, 4, i_b3f66e7a79d81bcd, nullptr, nullptr
+  2, 4, i_b3f66e7a79d81bcd, nullptr, nullptr,
+  mh_b3f66e7a79d81bcd, dh_b3f66e7a79d81bcd, nullptr
 };
 static const ::capnp::_::AlignedData<103> b_fffe08a9a697d2a5 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1610,9 +1643,12 @@ static const ::capnp::_::RawSchema* const d_fffe08a9a697d2a5[] = {
 };
 static const uint16_t m_fffe08a9a697d2a5[] = {2, 3, 5, 0, 4, 1};
 static const uint16_t i_fffe08a9a697d2a5[] = {0, 1, 2, 3, 4, 5};
+static const uint16_t mh_fffe08a9a697d2a5[] = {2, 8, 1, 2, 4, 0, 3, 5, 65535, 1, 65535, 2};
+static const uint16_t dh_fffe08a9a697d2a5[] = {2, 6, 0, 1, 3, 0, 65535, 1, 65535, 2};
 const ::capnp::_::RawSchema s_fffe08a9a697d2a5 = {
   0xfffe08a9a697d2a5, b_fffe08a9a697d2a5.words, 103, d_fffe08a9a697d2a5, m_fffe08a9a697d2a5,
-  4, 6, i_fffe08a9a697d2a5, nullptr, nullptr
+  4, 6, i_fffe08a9a697d2a5, nullptr, nullptr,
+  mh_fffe08a9a697d2a5, dh_fffe08a9a697d2a5, nullptr
 };
 static const ::capnp::_::AlignedData<48> b_e5104515fd88ea47 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1670,9 +1706,12 @@ static const ::capnp::_::RawSchema* const d_e5104515fd88ea47[] = {
 };
 static const uint16_t m_e5104515fd88ea47[] = {0, 1};
 static const uint16_t i_e5104515fd88ea47[] = {0, 1};
+static const uint16_t mh_e5104515fd88ea47[] = {1, 3, 0, 65535, 0, 1};
+static const uint16_t dh_e5104515fd88ea47[] = {1, 3, 1, 0, 1, 65535};
 const ::capnp::_::RawSchema s_e5104515fd88ea47 = {
   0xe5104515fd88ea47, b_e5104515fd88ea47.words, 48, d_e5104515fd88ea47, m_e5104515fd88ea47,
-  2, 2, i_e5104515fd88ea47, nullptr, nullptr
+  2, 2, i_e5104515fd88ea47, nullptr, nullptr,
+  mh_e5104515fd88ea47, dh_e5104515fd88ea47, nullptr
 };
 static const ::capnp::_::AlignedData<61> b_89f0c973c103ae96 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1743,9 +1782,12 @@ static const ::capnp::_::RawSchema* const d_89f0c973c103ae96[] = {
 };
 static const uint16_t m_89f0c973c103ae96[] = {2, 1, 0};
 static const uint16_t i_89f0c973c103ae96[] = {0, 1, 2};
+static const uint16_t mh_89f0c973c103ae96[] = {1, 4, 0, 2, 65535, 1, 0};
+static const uint16_t dh_89f0c973c103ae96[] = {1, 3, 0, 0, 1, 65535};
 const ::capnp::_::RawSchema s_89f0c973c103ae96 = {
   0x89f0c973c103ae96, b_89f0c973c103ae96.words, 61, d_89f0c973c103ae96, m_89f0c973c103ae96,
-  2, 3, i_89f0c973c103ae96, nullptr, nullptr
+  2, 3, i_89f0c973c103ae96, nullptr, nullptr,
+  mh_89f0c973c103ae96, dh_89f0c973c103ae96, nullptr
 };
 static const ::capnp::_::AlignedData<32> b_e93164a80bfe2ccf = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1787,9 +1829,12 @@ static const ::capnp::_::RawSchema* const d_e93164a80bfe2ccf[] = {
 };
 static const uint16_t m_e93164a80bfe2ccf[] = {0};
 static const uint16_t i_e93164a80bfe2ccf[] = {0};
+static const uint16_t mh_e93164a80bfe2ccf[] = {1, 2, 0, 0, 65535};
+static const uint16_t dh_e93164a80bfe2ccf[] = {1, 3, 0, 0, 65535, 1};
 const ::capnp::_::RawSchema s_e93164a80bfe2ccf = {
   0xe93164a80bfe2ccf, b_e93164a80bfe2ccf.words, 32, d_e93164a80bfe2ccf, m_e93164a80bfe2ccf,
-  2, 1, i_e93164a80bfe2ccf, nullptr, nullptr
+  2, 1, i_e93164a80bfe2ccf, nullptr, nullptr,
+  mh_e93164a80bfe2ccf, dh_e93164a80bfe2ccf, nullptr
 };
 static const ::capnp::_::AlignedData<46> b_b348322a8dcf0d0c = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1846,9 +1891,12 @@ static const ::capnp::_::RawSchema* const d_b348322a8dcf0d0c[] = {
 };
 static const uint16_t m_b348322a8dcf0d0c[] = {0, 1};
 static const uint16_t i_b348322a8dcf0d0c[] = {0, 1};
+static const uint16_t mh_b348322a8dcf0d0c[] = {1, 3, 0, 65535, 0, 1};
+static const uint16_t dh_b348322a8dcf0d0c[] = {1, 4, 3, 2, 0, 65535, 1};
 const ::capnp::_::RawSchema s_b348322a8dcf0d0c = {
   0xb348322a8dcf0d0c, b_b348322a8dcf0d0c.words, 46, d_b348322a8dcf0d0c, m_b348322a8dcf0d0c,
-  3, 2, i_b348322a8dcf0d0c, nullptr, nullptr
+  3, 2, i_b348322a8dcf0d0c, nullptr, nullptr,
+  mh_b348322a8dcf0d0c, dh_b348322a8dcf0d0c, nullptr
 };
 static const ::capnp::_::AlignedData<41> b_8f2622208fb358c8 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1900,9 +1948,12 @@ static const ::capnp::_::RawSchema* const d_8f2622208fb358c8[] = {
 };
 static const uint16_t m_8f2622208fb358c8[] = {1, 0};
 static const uint16_t i_8f2622208fb358c8[] = {0, 1};
+static const uint16_t mh_8f2622208fb358c8[] = {1, 3, 0, 65535, 0, 1};
+static const uint16_t dh_8f2622208fb358c8[] = {1, 4, 0, 65535, 0, 2, 1};
 const ::capnp::_::RawSchema s_8f2622208fb358c8 = {
   0x8f2622208fb358c8, b_8f2622208fb358c8.words, 41, d_8f2622208fb358c8, m_8f2622208fb358c8,
-  3, 2, i_8f2622208fb358c8, nullptr, nullptr
+  3, 2, i_8f2622208fb358c8, nullptr, nullptr,
+  mh_8f2622208fb358c8, dh_8f2622208fb358c8, nullptr
 };
 static const ::capnp::_::AlignedData<48> b_d0d1a21de617951f = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1960,9 +2011,12 @@ static const ::capnp::_::RawSchema* const d_d0d1a21de617951f[] = {
 };
 static const uint16_t m_d0d1a21de617951f[] = {0, 1};
 static const uint16_t i_d0d1a21de617951f[] = {0, 1};
+static const uint16_t mh_d0d1a21de617951f[] = {1, 3, 0, 65535, 0, 1};
+static const uint16_t dh_d0d1a21de617951f[] = {1, 3, 1, 1, 0, 65535};
 const ::capnp::_::RawSchema s_d0d1a21de617951f = {
   0xd0d1a21de617951f, b_d0d1a21de617951f.words, 48, d_d0d1a21de617951f, m_d0d1a21de617951f,
-  2, 2, i_d0d1a21de617951f, nullptr, nullptr
+  2, 2, i_d0d1a21de617951f, nullptr, nullptr,
+  mh_d0d1a21de617951f, dh_d0d1a21de617951f, nullptr
 };
 static const ::capnp::_::AlignedData<36> b_992a90eaf30235d3 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2008,9 +2062,12 @@ static const ::capnp::_::RawSchema* const d_992a90eaf30235d3[] = {
 };
 static const uint16_t m_992a90eaf30235d3[] = {0};
 static const uint16_t i_992a90eaf30235d3[] = {0};
+static const uint16_t mh_992a90eaf30235d3[] = {1, 2, 0, 65535, 0};
+static const uint16_t dh_992a90eaf30235d3[] = {1, 3, 0, 0, 65535, 1};
 const ::capnp::_::RawSchema s_992a90eaf30235d3 = {
   0x992a90eaf30235d3, b_992a90eaf30235d3.words, 36, d_992a90eaf30235d3, m_992a90eaf30235d3,
-  2, 1, i_992a90eaf30235d3, nullptr, nullptr
+  2, 1, i_992a90eaf30235d3, nullptr, nullptr,
+  mh_992a90eaf30235d3, dh_992a90eaf30235d3, nullptr
 };
 static const ::capnp::_::AlignedData<40> b_eb971847d617c0b9 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2061,9 +2118,12 @@ static const ::capnp::_::RawSchema* const d_eb971847d617c0b9[] = {
 };
 static const uint16_t m_eb971847d617c0b9[] = {0, 1};
 static const uint16_t i_eb971847d617c0b9[] = {0, 1};
+static const uint16_t mh_eb971847d617c0b9[] = {1, 3, 0, 65535, 0, 1};
+static const uint16_t dh_eb971847d617c0b9[] = {1, 4, 0, 65535, 1, 2, 0};
 const ::capnp::_::RawSchema s_eb971847d617c0b9 = {
   0xeb971847d617c0b9, b_eb971847d617c0b9.words, 40, d_eb971847d617c0b9, m_eb971847d617c0b9,
-  3, 2, i_eb971847d617c0b9, nullptr, nullptr
+  3, 2, i_eb971847d617c0b9, nullptr, nullptr,
+  mh_eb971847d617c0b9, dh_eb971847d617c0b9, nullptr
 };
 static const ::capnp::_::AlignedData<48> b_c6238c7d62d65173 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2121,9 +2181,12 @@ static const ::capnp::_::RawSchema* const d_c6238c7d62d65173[] = {
 };
 static const uint16_t m_c6238c7d62d65173[] = {1, 0};
 static const uint16_t i_c6238c7d62d65173[] = {0, 1};
+static const uint16_t mh_c6238c7d62d65173[] = {1, 3, 0, 1, 0, 65535};
+static const uint16_t dh_c6238c7d62d65173[] = {1, 3, 0, 0, 65535, 1};
 const ::capnp::_::RawSchema s_c6238c7d62d65173 = {
   0xc6238c7d62d65173, b_c6238c7d62d65173.words, 48, d_c6238c7d62d65173, m_c6238c7d62d65173,
-  2, 2, i_c6238c7d62d65173, nullptr, nullptr
+  2, 2, i_c6238c7d62d65173, nullptr, nullptr,
+  mh_c6238c7d62d65173, dh_c6238c7d62d65173, nullptr
 };
 static const ::capnp::_::AlignedData<216> b_9cb9e86e3198037f = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2349,9 +2412,12 @@ static const ::capnp::_::RawSchema* const d_9cb9e86e3198037f[] = {
 };
 static const uint16_t m_9cb9e86e3198037f[] = {12, 2, 3, 4, 6, 1, 8, 9, 10, 11, 5, 7, 0};
 static const uint16_t i_9cb9e86e3198037f[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+static const uint16_t mh_9cb9e86e3198037f[] = {4, 17, 2, 1, 0, 1, 65535, 4, 65535, 11, 1, 8, 3, 12, 65535, 9, 6, 65535, 2, 7, 0, 5, 10};
+static const uint16_t dh_9cb9e86e3198037f[] = {1, 3, 0, 1, 0, 65535};
 const ::capnp::_::RawSchema s_9cb9e86e3198037f = {
   0x9cb9e86e3198037f, b_9cb9e86e3198037f.words, 216, d_9cb9e86e3198037f, m_9cb9e86e3198037f,
-  2, 13, i_9cb9e86e3198037f, nullptr, nullptr
+  2, 13, i_9cb9e86e3198037f, nullptr, nullptr,
+  mh_9cb9e86e3198037f, dh_9cb9e86e3198037f, nullptr
 };
 static const ::capnp::_::AlignedData<32> b_84e4f3f5a807605c = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2392,9 +2458,12 @@ static const ::capnp::_::RawSchema* const d_84e4f3f5a807605c[] = {
 };
 static const uint16_t m_84e4f3f5a807605c[] = {0};
 static const uint16_t i_84e4f3f5a807605c[] = {0};
+static const uint16_t mh_84e4f3f5a807605c[] = {1, 2, 0, 0, 65535};
+static const uint16_t dh_84e4f3f5a807605c[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_84e4f3f5a807605c = {
   0x84e4f3f5a807605c, b_84e4f3f5a807605c.words, 32, d_84e4f3f5a807605c, m_84e4f3f5a807605c,
-  1, 1, i_84e4f3f5a807605c, nullptr, nullptr
+  1, 1, i_84e4f3f5a807605c, nullptr, nullptr,
+  mh_84e4f3f5a807605c, dh_84e4f3f5a807605c, nullptr
 };
 }  // namespace schemas
 namespace _ {  // private
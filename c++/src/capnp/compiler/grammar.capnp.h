@@ -423,6 +423,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline bool hasValue() const;
   inline  ::capnp::Text::Reader getValue() const;
 
@@ -460,6 +462,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasValue();
   inline  ::capnp::Text::Builder getValue();
   inline void setValue( ::capnp::Text::Reader value);
@@ -510,6 +514,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline  ::uint64_t getValue() const;
 
   inline  ::uint32_t getStartByte() const;
@@ -546,6 +552,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint64_t getValue();
   inline void setValue( ::uint64_t value);
 
@@ -592,6 +600,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline double getValue() const;
 
   inline  ::uint32_t getStartByte() const;
@@ -628,6 +638,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline double getValue();
   inline void setValue(double value);
 
@@ -674,6 +686,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<4> presenceMask() const;
+
   inline Base::Reader getBase() const;
 
   inline bool hasMemberPath() const;
@@ -713,6 +727,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Base::Builder getBase();
   inline Base::Builder initBase();
 
@@ -767,6 +783,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline Which which() const;
   inline bool isAbsoluteName() const;
   inline bool hasAbsoluteName() const;
@@ -872,6 +890,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<4> presenceMask() const;
+
   inline bool hasName() const;
   inline  ::capnp::compiler::DeclName::Reader getName() const;
 
@@ -912,6 +932,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasName();
   inline  ::capnp::compiler::DeclName::Builder getName();
   inline void setName( ::capnp::compiler::DeclName::Reader value);
@@ -970,6 +992,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<10> presenceMask() const;
+
   inline Which which() const;
   inline bool isUnknown() const;
   inline  ::capnp::Void getUnknown() const;
@@ -1033,6 +1057,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isUnknown();
   inline  ::capnp::Void getUnknown();
@@ -1125,6 +1151,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasFieldName() const;
   inline  ::capnp::compiler::LocatedText::Reader getFieldName() const;
 
@@ -1161,6 +1189,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasFieldName();
   inline  ::capnp::compiler::LocatedText::Builder getFieldName();
   inline void setFieldName( ::capnp::compiler::LocatedText::Reader value);
@@ -1214,6 +1244,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<38> presenceMask() const;
+
   inline Which which() const;
   inline bool hasName() const;
   inline  ::capnp::compiler::LocatedText::Reader getName() const;
@@ -1358,6 +1390,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool hasName();
   inline  ::capnp::compiler::LocatedText::Builder getName();
@@ -1567,6 +1601,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasName() const;
   inline  ::capnp::compiler::DeclName::Reader getName() const;
 
@@ -1602,6 +1638,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasName();
   inline  ::capnp::compiler::DeclName::Builder getName();
   inline void setName( ::capnp::compiler::DeclName::Reader value);
@@ -1651,6 +1689,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline Which which() const;
   inline bool isNone() const;
   inline  ::capnp::Void getNone() const;
@@ -1739,6 +1779,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<4> presenceMask() const;
+
   inline Which which() const;
   inline bool isNamedList() const;
   inline bool hasNamedList() const;
@@ -1782,6 +1824,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isNamedList();
   inline bool hasNamedList();
@@ -1842,6 +1886,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<6> presenceMask() const;
+
   inline bool hasName() const;
   inline  ::capnp::compiler::LocatedText::Reader getName() const;
 
@@ -1887,6 +1933,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasName();
   inline  ::capnp::compiler::LocatedText::Builder getName();
   inline void setName( ::capnp::compiler::LocatedText::Reader value);
@@ -1957,6 +2005,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline Which which() const;
   inline bool isNone() const;
   inline  ::capnp::Void getNone() const;
@@ -2045,6 +2095,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline Which which() const;
   inline bool isUnspecified() const;
   inline  ::capnp::Void getUnspecified() const;
@@ -2145,6 +2197,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline bool hasTarget() const;
   inline  ::capnp::compiler::DeclName::Reader getTarget() const;
 
@@ -2223,6 +2277,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasType() const;
   inline  ::capnp::compiler::TypeExpression::Reader getType() const;
 
@@ -2312,6 +2368,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasType() const;
   inline  ::capnp::compiler::TypeExpression::Reader getType() const;
 
@@ -2396,6 +2454,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline Which which() const;
   inline bool isNone() const;
   inline  ::capnp::Void getNone() const;
@@ -2484,6 +2544,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline bool hasExtends() const;
   inline  ::capnp::List< ::capnp::compiler::DeclName>::Reader getExtends() const;
 
@@ -2561,6 +2623,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasParams() const;
   inline  ::capnp::compiler::Declaration::ParamList::Reader getParams() const;
 
@@ -2645,6 +2709,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline Which which() const;
   inline bool isNone() const;
   inline  ::capnp::Void getNone() const;
@@ -2733,6 +2799,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<13> presenceMask() const;
+
   inline bool hasType() const;
   inline  ::capnp::compiler::TypeExpression::Reader getType() const;
 
@@ -2871,6 +2939,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline bool hasRoot() const;
   inline  ::capnp::compiler::Declaration::Reader getRoot() const;
 
@@ -2904,6 +2974,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasRoot();
   inline  ::capnp::compiler::Declaration::Builder getRoot();
   inline void setRoot( ::capnp::compiler::Declaration::Reader value);
@@ -2940,6 +3012,25 @@ private:
 
 // =======================================================================================
 
+inline ::capnp::FieldPresence<3> LocatedText::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void LocatedText::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<LocatedText>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool LocatedText::Reader::hasValue() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -3000,6 +3091,20 @@ inline void LocatedText::Builder::setEndByte( ::uint32_t value) {
       1 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<3> LocatedInteger::Reader::presenceMask() const {
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, _reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField< ::uint32_t>(3 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void LocatedInteger::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<LocatedInteger>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
 inline  ::uint64_t LocatedInteger::Reader::getValue() const {
   return _reader.getDataField< ::uint64_t>(
       0 * ::capnp::ELEMENTS);
@@ -3042,6 +3147,20 @@ inline void LocatedInteger::Builder::setEndByte( ::uint32_t value) {
       3 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<3> LocatedFloat::Reader::presenceMask() const {
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, _reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField< ::uint32_t>(3 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void LocatedFloat::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<LocatedFloat>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
 inline double LocatedFloat::Reader::getValue() const {
   return _reader.getDataField<double>(
       0 * ::capnp::ELEMENTS);
@@ -3084,6 +3203,27 @@ inline void LocatedFloat::Builder::setEndByte( ::uint32_t value) {
       3 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<4> DeclName::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<4> _result;
+  _result.set(0, true);
+  _result.set(1, (_pointers[0] >> 1) & 1);
+  _result.set(2, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void DeclName::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<DeclName>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline DeclName::Base::Reader DeclName::Reader::getBase() const {
   return DeclName::Base::Reader(_reader);
 }
@@ -3165,6 +3305,16 @@ inline DeclName::Base::Which DeclName::Base::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<3> DeclName::Base::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, which() == DeclName::Base::ABSOLUTE_NAME && ((_pointers[0] >> 0) & 1));
+  _result.set(1, which() == DeclName::Base::RELATIVE_NAME && ((_pointers[0] >> 0) & 1));
+  _result.set(2, which() == DeclName::Base::IMPORT_NAME && ((_pointers[0] >> 0) & 1));
+  return _result;
+}
+
 inline bool DeclName::Base::Reader::isAbsoluteName() const {
   return which() == DeclName::Base::ABSOLUTE_NAME;
 }
@@ -3321,6 +3471,28 @@ inline ::capnp::Orphan< ::capnp::compiler::LocatedText> DeclName::Base::Builder:
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<4> TypeExpression::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<4> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, (_pointers[0] >> 1) & 1);
+  _result.set(2, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void TypeExpression::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<TypeExpression>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::compiler::DeclName>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline bool TypeExpression::Reader::hasName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -3423,6 +3595,31 @@ inline ValueExpression::Which ValueExpression::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<10> ValueExpression::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<10> _result;
+  _result.set(0, which() == ValueExpression::UNKNOWN);
+  _result.set(1, which() == ValueExpression::POSITIVE_INT && (_reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(2, which() == ValueExpression::NEGATIVE_INT && (_reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(3, which() == ValueExpression::FLOAT && (_reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(4, which() == ValueExpression::STRING && ((_pointers[0] >> 0) & 1));
+  _result.set(5, which() == ValueExpression::NAME && ((_pointers[0] >> 0) & 1));
+  _result.set(6, which() == ValueExpression::LIST && ((_pointers[0] >> 0) & 1));
+  _result.set(7, which() == ValueExpression::STRUCT && ((_pointers[0] >> 0) & 1));
+  _result.set(8, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  _result.set(9, _reader.hasDataField< ::uint32_t>(4 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void ValueExpression::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<ValueExpression>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool ValueExpression::Reader::isUnknown() const {
   return which() == ValueExpression::UNKNOWN;
 }
@@ -3763,6 +3960,27 @@ inline void ValueExpression::Builder::setEndByte( ::uint32_t value) {
       4 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<2> ValueExpression::FieldAssignment::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void ValueExpression::FieldAssignment::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<ValueExpression::FieldAssignment>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::compiler::LocatedText>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  ::capnp::_::PointerHelpers< ::capnp::compiler::ValueExpression>::copy(
+      _builder.getPointerField(1 * ::capnp::POINTERS),
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline bool ValueExpression::FieldAssignment::Reader::hasFieldName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -3840,6 +4058,73 @@ inline Declaration::Which Declaration::Builder::which() {
   return _builder.getDataField<Which>(1 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<38> Declaration::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<38> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, true);
+  _result.set(2, (_pointers[0] >> 2) & 1);
+  _result.set(3, (_pointers[0] >> 3) & 1);
+  _result.set(4, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  _result.set(5, _reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS));
+  _result.set(6, (_pointers[0] >> 4) & 1);
+  _result.set(7, which() == Declaration::FILE);
+  _result.set(8, which() == Declaration::USING);
+  _result.set(9, which() == Declaration::CONST);
+  _result.set(10, which() == Declaration::ENUM);
+  _result.set(11, which() == Declaration::ENUMERANT);
+  _result.set(12, which() == Declaration::STRUCT);
+  _result.set(13, which() == Declaration::FIELD);
+  _result.set(14, which() == Declaration::UNION);
+  _result.set(15, which() == Declaration::GROUP);
+  _result.set(16, which() == Declaration::INTERFACE);
+  _result.set(17, which() == Declaration::METHOD);
+  _result.set(18, which() == Declaration::ANNOTATION);
+  _result.set(19, which() == Declaration::NAKED_ID && ((_pointers[0] >> 5) & 1));
+  _result.set(20, which() == Declaration::NAKED_ANNOTATION && ((_pointers[0] >> 5) & 1));
+  _result.set(21, which() == Declaration::BUILTIN_VOID);
+  _result.set(22, which() == Declaration::BUILTIN_BOOL);
+  _result.set(23, which() == Declaration::BUILTIN_INT8);
+  _result.set(24, which() == Declaration::BUILTIN_INT16);
+  _result.set(25, which() == Declaration::BUILTIN_INT32);
+  _result.set(26, which() == Declaration::BUILTIN_INT64);
+  _result.set(27, which() == Declaration::BUILTIN_U_INT8);
+  _result.set(28, which() == Declaration::BUILTIN_U_INT16);
+  _result.set(29, which() == Declaration::BUILTIN_U_INT32);
+  _result.set(30, which() == Declaration::BUILTIN_U_INT64);
+  _result.set(31, which() == Declaration::BUILTIN_FLOAT32);
+  _result.set(32, which() == Declaration::BUILTIN_FLOAT64);
+  _result.set(33, which() == Declaration::BUILTIN_TEXT);
+  _result.set(34, which() == Declaration::BUILTIN_DATA);
+  _result.set(35, which() == Declaration::BUILTIN_LIST);
+  _result.set(36, which() == Declaration::BUILTIN_OBJECT);
+  _result.set(37, which() == Declaration::BUILTIN_ANY_POINTER);
+  return _result;
+}
+
+inline void Declaration::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Declaration>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::compiler::LocatedText>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+  _builder.getPointerField(2 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(2 * ::capnp::POINTERS));
+  _builder.getPointerField(3 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(3 * ::capnp::POINTERS));
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(4 * ::capnp::POINTERS),
+      _other.getPointerField(4 * ::capnp::POINTERS));
+  _builder.getPointerField(5 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(5 * ::capnp::POINTERS));
+  _builder.getPointerField(6 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(6 * ::capnp::POINTERS));
+}
+
 inline bool Declaration::Reader::hasName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -4864,6 +5149,26 @@ inline void Declaration::Builder::setBuiltinAnyPointer( ::capnp::Void value) {
       0 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<2> Declaration::AnnotationApplication::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, true);
+  return _result;
+}
+
+inline void Declaration::AnnotationApplication::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Declaration::AnnotationApplication>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::compiler::DeclName>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline bool Declaration::AnnotationApplication::Reader::hasName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -4920,6 +5225,15 @@ inline Declaration::AnnotationApplication::Value::Which Declaration::AnnotationA
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<2> Declaration::AnnotationApplication::Value::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, which() == Declaration::AnnotationApplication::Value::NONE);
+  _result.set(1, which() == Declaration::AnnotationApplication::Value::EXPRESSION && ((_pointers[0] >> 1) & 1));
+  return _result;
+}
+
 inline bool Declaration::AnnotationApplication::Value::Reader::isNone() const {
   return which() == Declaration::AnnotationApplication::Value::NONE;
 }
@@ -5005,6 +5319,25 @@ inline Declaration::ParamList::Which Declaration::ParamList::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<4> Declaration::ParamList::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<4> _result;
+  _result.set(0, which() == Declaration::ParamList::NAMED_LIST && ((_pointers[0] >> 0) & 1));
+  _result.set(1, which() == Declaration::ParamList::TYPE && ((_pointers[0] >> 0) & 1));
+  _result.set(2, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Declaration::ParamList::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Declaration::ParamList>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool Declaration::ParamList::Reader::isNamedList() const {
   return which() == Declaration::ParamList::NAMED_LIST;
 }
@@ -5137,6 +5470,35 @@ inline void Declaration::ParamList::Builder::setEndByte( ::uint32_t value) {
       2 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<6> Declaration::Param::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<6> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, (_pointers[0] >> 1) & 1);
+  _result.set(2, (_pointers[0] >> 2) & 1);
+  _result.set(3, true);
+  _result.set(4, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  _result.set(5, _reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Declaration::Param::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Declaration::Param>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::compiler::LocatedText>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  ::capnp::_::PointerHelpers< ::capnp::compiler::TypeExpression>::copy(
+      _builder.getPointerField(1 * ::capnp::POINTERS),
+      _other.getPointerField(1 * ::capnp::POINTERS));
+  _builder.getPointerField(2 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(2 * ::capnp::POINTERS));
+  _builder.getPointerField(3 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(3 * ::capnp::POINTERS));
+}
+
 inline bool Declaration::Param::Reader::hasName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -5288,6 +5650,15 @@ inline Declaration::Param::DefaultValue::Which Declaration::Param::DefaultValue:
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<2> Declaration::Param::DefaultValue::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, which() == Declaration::Param::DefaultValue::NONE);
+  _result.set(1, which() == Declaration::Param::DefaultValue::VALUE && ((_pointers[0] >> 3) & 1));
+  return _result;
+}
+
 inline bool Declaration::Param::DefaultValue::Reader::isNone() const {
   return which() == Declaration::Param::DefaultValue::NONE;
 }
@@ -5373,6 +5744,16 @@ inline Declaration::Id::Which Declaration::Id::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<3> Declaration::Id::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, which() == Declaration::Id::UNSPECIFIED);
+  _result.set(1, which() == Declaration::Id::UID && ((_pointers[0] >> 1) & 1));
+  _result.set(2, which() == Declaration::Id::ORDINAL && ((_pointers[0] >> 1) & 1));
+  return _result;
+}
+
 inline bool Declaration::Id::Reader::isUnspecified() const {
   return which() == Declaration::Id::UNSPECIFIED;
 }
@@ -5503,6 +5884,14 @@ inline ::capnp::Orphan< ::capnp::compiler::LocatedInteger> Declaration::Id::Buil
       _builder.getPointerField(1 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<1> Declaration::Using::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, (_pointers[0] >> 5) & 1);
+  return _result;
+}
+
 inline bool Declaration::Using::Reader::hasTarget() const {
   return !_reader.getPointerField(5 * ::capnp::POINTERS).isNull();
 }
@@ -5538,6 +5927,15 @@ inline ::capnp::Orphan< ::capnp::compiler::DeclName> Declaration::Using::Builder
       _builder.getPointerField(5 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> Declaration::Const::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 5) & 1);
+  _result.set(1, (_pointers[0] >> 6) & 1);
+  return _result;
+}
+
 inline bool Declaration::Const::Reader::hasType() const {
   return !_reader.getPointerField(5 * ::capnp::POINTERS).isNull();
 }
@@ -5608,6 +6006,15 @@ inline ::capnp::Orphan< ::capnp::compiler::ValueExpression> Declaration::Const::
       _builder.getPointerField(6 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> Declaration::Field::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 5) & 1);
+  _result.set(1, true);
+  return _result;
+}
+
 inline bool Declaration::Field::Reader::hasType() const {
   return !_reader.getPointerField(5 * ::capnp::POINTERS).isNull();
 }
@@ -5664,6 +6071,15 @@ inline Declaration::Field::DefaultValue::Which Declaration::Field::DefaultValue:
   return _builder.getDataField<Which>(6 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<2> Declaration::Field::DefaultValue::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, which() == Declaration::Field::DefaultValue::NONE);
+  _result.set(1, which() == Declaration::Field::DefaultValue::VALUE && ((_pointers[0] >> 6) & 1));
+  return _result;
+}
+
 inline bool Declaration::Field::DefaultValue::Reader::isNone() const {
   return which() == Declaration::Field::DefaultValue::NONE;
 }
@@ -5742,6 +6158,14 @@ inline ::capnp::Orphan< ::capnp::compiler::ValueExpression> Declaration::Field::
       _builder.getPointerField(6 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<1> Declaration::Interface::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, (_pointers[0] >> 5) & 1);
+  return _result;
+}
+
 inline bool Declaration::Interface::Reader::hasExtends() const {
   return !_reader.getPointerField(5 * ::capnp::POINTERS).isNull();
 }
@@ -5774,6 +6198,15 @@ inline ::capnp::Orphan< ::capnp::List< ::capnp::compiler::DeclName>> Declaration
       _builder.getPointerField(5 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> Declaration::Method::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 5) & 1);
+  _result.set(1, true);
+  return _result;
+}
+
 inline bool Declaration::Method::Reader::hasParams() const {
   return !_reader.getPointerField(5 * ::capnp::POINTERS).isNull();
 }
@@ -5830,6 +6263,15 @@ inline Declaration::Method::Results::Which Declaration::Method::Results::Builder
   return _builder.getDataField<Which>(6 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<2> Declaration::Method::Results::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, which() == Declaration::Method::Results::NONE);
+  _result.set(1, which() == Declaration::Method::Results::EXPLICIT && ((_pointers[0] >> 6) & 1));
+  return _result;
+}
+
 inline bool Declaration::Method::Results::Reader::isNone() const {
   return which() == Declaration::Method::Results::NONE;
 }
@@ -5908,6 +6350,26 @@ inline ::capnp::Orphan< ::capnp::compiler::Declaration::ParamList> Declaration::
       _builder.getPointerField(6 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<13> Declaration::Annotation::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<13> _result;
+  _result.set(0, (_pointers[0] >> 5) & 1);
+  _result.set(1, _reader.hasDataField<bool>(96 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField<bool>(97 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField<bool>(98 * ::capnp::ELEMENTS));
+  _result.set(4, _reader.hasDataField<bool>(99 * ::capnp::ELEMENTS));
+  _result.set(5, _reader.hasDataField<bool>(100 * ::capnp::ELEMENTS));
+  _result.set(6, _reader.hasDataField<bool>(101 * ::capnp::ELEMENTS));
+  _result.set(7, _reader.hasDataField<bool>(102 * ::capnp::ELEMENTS));
+  _result.set(8, _reader.hasDataField<bool>(103 * ::capnp::ELEMENTS));
+  _result.set(9, _reader.hasDataField<bool>(104 * ::capnp::ELEMENTS));
+  _result.set(10, _reader.hasDataField<bool>(105 * ::capnp::ELEMENTS));
+  _result.set(11, _reader.hasDataField<bool>(106 * ::capnp::ELEMENTS));
+  _result.set(12, _reader.hasDataField<bool>(107 * ::capnp::ELEMENTS));
+  return _result;
+}
+
 inline bool Declaration::Annotation::Reader::hasType() const {
   return !_reader.getPointerField(5 * ::capnp::POINTERS).isNull();
 }
@@ -6111,6 +6573,23 @@ inline void Declaration::Annotation::Builder::setTargetsAnnotation(bool value) {
       107 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<1> ParsedFile::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void ParsedFile::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<ParsedFile>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::compiler::Declaration>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool ParsedFile::Reader::hasRoot() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -0,0 +1,91 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Benchmarks for the schema lexer.  Run them with the capnp-bench program.
+
+#include "lexer.h"
+#include "../message.h"
+#include <kj/benchmark.h>
+#include <kj/debug.h>
+#include <kj/vector.h>
+
+namespace capnp {
+namespace compiler {
+namespace {
+
+class NullErrorReporter: public ErrorReporter {
+public:
+  void addError(uint32_t startByte, uint32_t endByte, kj::StringPtr message) override {
+    KJ_FAIL_ASSERT("unexpected lexer error", message);
+  }
+
+  bool hadErrors() override {
+    return false;
+  }
+};
+
+kj::String makeLargeSchema() {
+  // Shaped like the large generated schemas that motivated the lexer's fast path:  tens of
+  // thousands of documented, annotated enumerants.
+
+  kj::Vector<kj::String> parts;
+  parts.add(kj::str("@0xe5d4eb6fa10b5e3c;\n\nenum Big {\n  # A big generated enum.\n\n"));
+  for (uint i = 0; i < 20000; i++) {
+    parts.add(kj::str("  value", i, " @", i, " $annotation(\"v", i, "\", [1, 2.5]);  "
+                      "# Generated value number ", i, ".\n"));
+  }
+  parts.add(kj::str("}\n"));
+  return kj::strArray(parts, "");
+}
+
+KJ_BENCHMARK(lex (20k enumerants)) {
+  kj::String text = makeLargeSchema();
+  NullErrorReporter errorReporter;
+  kj::Benchmark::resetTimer();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    MallocMessageBuilder message;
+    KJ_ASSERT(lex(text, message.initRoot<LexedStatements>(), errorReporter));
+  }
+}
+
+KJ_BENCHMARK(Lexer grammar (20k enumerants)) {
+  // The same input through the combinator grammar alone, which the fast path falls back to.
+  kj::String text = makeLargeSchema();
+  NullErrorReporter errorReporter;
+  kj::Benchmark::resetTimer();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    MallocMessageBuilder message;
+    Lexer lexer(Orphanage::getForMessageContaining(message.initRoot<LexedStatements>()),
+                errorReporter);
+    auto parser = kj::parse::sequence(lexer.getParsers().statementSequence, kj::parse::endOfInput);
+    Lexer::ParserInput input(text.begin(), text.end());
+    KJ_ASSERT(parser(input) != nullptr);
+  }
+}
+
+}  // namespace
+}  // namespace compiler
+}  // namespace capnp
@@ -23,6 +23,7 @@
 
 #include "lexer.h"
 #include "../message.h"
+#include <kj/vector.h>
 #include <gtest/gtest.h>
 
 namespace capnp {
@@ -347,6 +348,160 @@ TEST(Lexer, DocComments) {
       doLex<LexedStatements>("foo {bar; baz;}\n# late comment\nqux;").cStr());
 }
 
+
+// =======================================================================================
+// lex() takes a hand-written fast path for valid input and falls back to the combinator grammar
+// (which also remains the specification) otherwise.  The tests below check the two against each
+// other.
+
+class RecordingErrorReporter: public ErrorReporter {
+public:
+  void addError(uint32_t startByte, uint32_t endByte, kj::StringPtr message) override {
+    errors.add(kj::str("error at ", startByte, "-", endByte, ": ", message));
+  }
+
+  bool hadErrors() override {
+    return errors.size() > 0;
+  }
+
+  kj::Vector<kj::String> errors;
+};
+
+template <typename LexResult>
+kj::String lexOrError(kj::StringPtr text) {
+  MallocMessageBuilder message;
+  auto file = message.initRoot<LexResult>();
+  RecordingErrorReporter errorReporter;
+  if (lex(text, file, errorReporter)) {
+    EXPECT_EQ(0u, errorReporter.errors.size());
+    return kj::str(file);
+  } else {
+    return kj::strArray(errorReporter.errors, "\n");
+  }
+}
+
+bool grammarLex(kj::StringPtr text, LexedStatements::Builder file, uint32_t& errorPos) {
+  // Like lex(), but using only the combinator grammar.
+
+  RecordingErrorReporter errorReporter;
+  Lexer lexer(Orphanage::getForMessageContaining(file), errorReporter);
+  auto parser = kj::parse::sequence(lexer.getParsers().statementSequence, kj::parse::endOfInput);
+
+  Lexer::ParserInput input(text.begin(), text.end());
+  KJ_IF_MAYBE(output, parser(input)) {
+    auto list = file.initStatements(output->size());
+    for (uint i = 0; i < output->size(); i++) {
+      list.adoptWithCaveats(i, kj::mv((*output)[i]));
+    }
+    return true;
+  } else {
+    errorPos = input.getBest();
+    return false;
+  }
+}
+
+bool grammarLex(kj::StringPtr text, LexedTokens::Builder file, uint32_t& errorPos) {
+  RecordingErrorReporter errorReporter;
+  Lexer lexer(Orphanage::getForMessageContaining(file), errorReporter);
+  auto parser = kj::parse::sequence(lexer.getParsers().tokenSequence, kj::parse::endOfInput);
+
+  Lexer::ParserInput input(text.begin(), text.end());
+  KJ_IF_MAYBE(output, parser(input)) {
+    auto list = file.initTokens(output->size());
+    for (uint i = 0; i < output->size(); i++) {
+      list.adoptWithCaveats(i, kj::mv((*output)[i]));
+    }
+    return true;
+  } else {
+    errorPos = input.getBest();
+    return false;
+  }
+}
+
+template <typename LexResult>
+kj::String grammarLexOrError(kj::StringPtr text) {
+  MallocMessageBuilder message;
+  auto file = message.initRoot<LexResult>();
+  uint32_t errorPos = 0;
+  if (grammarLex(text, file, errorPos)) {
+    return kj::str(file);
+  } else {
+    return kj::str("error at ", errorPos, "-", errorPos, ": Parse error.");
+  }
+}
+
+TEST(Lexer, FastPathMatchesGrammar) {
+  const char* const tokenInputs[] = {
+    "", "   \n\t", "# only a comment", "foo bar", "foo # comment\n bar # trailing",
+    "_foo9 Bar_ x",
+    "0 00 017 09 0x 0x1F 0xffffffffffffffff 18446744073709551617 123",
+    "1.5 1. 1e 1e+ 1E-3 00.5 .5 1.e5 0.0 6e4",
+    "\"\" \"a\\x41\\101\\7\\0z\\n\\?\\'\\\"\" \"tab\there\"",
+    "\"\xc3\xa9\" # \xff\xfe\n",
+    "() [] ( ) (,) (a,) (,a) [a, (b, [c]), d] ( # c\n a )",
+    "a.b->c :: @0x1234 $foo(bar = 1) !$%&*+-./:<=>?@^|~",
+  };
+
+  for (auto input: tokenInputs) {
+    SCOPED_TRACE(input);
+    EXPECT_EQ(grammarLexOrError<LexedTokens>(input), lexOrError<LexedTokens>(input));
+  }
+
+  const char* const statementInputs[] = {
+    "", ";", "{}", "foo;", "foo { bar; { baz; } }\n", "foo bar = (1, 2) {} qux;",
+    "foo; # blah", "foo; #\n", "foo;\r\n# crlf comment\r\nbar;", "foo;\r# cr comment\nbar;",
+    "foo; # a\n  #b\n\n#c\nbar;", "foo {# early\n} # late\n", "foo {\n} # late only\n",
+    "foo {bar;} baz; # x", "# leading\nfoo;\n# only comment at end",
+    "struct Foo @0x1234 {\n  bar @0 :Text = \"x\\ty\";  # The bar.\n  baz @1 :List(Int32);\n}\n",
+  };
+
+  for (auto input: statementInputs) {
+    SCOPED_TRACE(input);
+    EXPECT_EQ(grammarLexOrError<LexedStatements>(input), lexOrError<LexedStatements>(input));
+  }
+}
+
+TEST(Lexer, ErrorsMatchGrammar) {
+  const char* const inputs[] = {
+    "foo", "foo bar", "\"unterminated", "\"bad \\q escape\";", "\"line\nbreak\";",
+    "\"\\x4\";", "0x1g;", "0X1;", "1.2.3;", "1e5x;", "9_;", "(a, b;", "[a);", "{ foo; ",
+    "foo; }", "\x01;", "a[;", "foo {bar} baz;", "foo; {",
+  };
+
+  for (auto input: inputs) {
+    SCOPED_TRACE(input);
+    EXPECT_EQ(grammarLexOrError<LexedStatements>(input), lexOrError<LexedStatements>(input));
+    EXPECT_EQ(grammarLexOrError<LexedTokens>(input), lexOrError<LexedTokens>(input));
+  }
+}
+
+TEST(Lexer, LargeInput) {
+  // A schema shaped like the large generated ones that motivated the fast path (many documented
+  // enumerants) must lex the same both ways.  Its speed is measured by capnp-bench.
+
+  kj::Vector<kj::String> parts;
+  parts.add(kj::str("@0xe5d4eb6fa10b5e3c;\n\nenum Big {\n  # A big generated enum.\n\n"));
+  for (uint i = 0; i < 2000; i++) {
+    parts.add(kj::str("  value", i, " @", i, " $annotation(\"v", i, "\", [1, 2.5]);  "
+                      "# Generated value number ", i, ".\n"));
+  }
+  parts.add(kj::str("}\n"));
+  kj::String text = kj::strArray(parts, "");
+
+  MallocMessageBuilder fastMessage;
+  auto fast = fastMessage.initRoot<LexedStatements>();
+  RecordingErrorReporter errorReporter;
+  MallocMessageBuilder grammarMessage;
+  auto grammar = grammarMessage.initRoot<LexedStatements>();
+  uint32_t errorPos = 0;
+
+  EXPECT_TRUE(lex(text, fast, errorReporter));
+  EXPECT_TRUE(grammarLex(text, grammar, errorPos));
+
+  EXPECT_EQ(2000u, fast.getStatements()[1].getBlock().size());
+  EXPECT_TRUE(kj::str(fast) == kj::str(grammar));
+}
+
 }  // namespace
 }  // namespace compiler
 }  // namespace capnp
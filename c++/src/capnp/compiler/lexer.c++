@@ -24,14 +24,470 @@
 #include "lexer.h"
 #include <kj/parse/char.h>
 #include <kj/debug.h>
+#include <stdlib.h>
 
 namespace capnp {
 namespace compiler {
 
 namespace p = kj::parse;
 
+namespace {
+
+constexpr auto operatorChar = p::anyOfChars("!$%&*+-./:<=>?@^|~");
+constexpr auto lineWhitespaceChar = p::whitespaceChar.invert().orAny("\r\n").invert();
+constexpr auto numberTerminator = p::alpha.orAny("_.");
+// Characters which may not immediately follow an integer or float literal.
+
+class FastLexer {
+  // A hand-written recognizer for exactly the language accepted by the combinator grammar built in
+  // Lexer's constructor, which remains the specification.  The combinators backtrack freely and
+  // allocate a kj::Array, kj::String, or orphan for nearly everything they match; lexing a large
+  // generated schema spends most of its time there.  FastLexer instead makes a single pass that
+  // records tokens, list items, and statements in flat arrays (pointing back into the input where
+  // possible), then builds the output with exact sizes.
+  //
+  // FastLexer only handles valid input:  as soon as it sees anything the grammar would reject it
+  // gives up, without having touched the output, and lex() re-runs the combinator parser to
+  // report the error in exactly the same place it always has.
+
+public:
+  explicit FastLexer(kj::ArrayPtr<const char> input)
+      : begin(input.begin()), pos(input.begin()), end(input.end()) {}
+
+  bool lexStatements(LexedStatements::Builder result) {
+    Range range;
+    if (!lexStatementSequence(range) || pos != end) return false;
+    buildStatements(range, result.initStatements(range.count));
+    return true;
+  }
+
+  bool lexTokens(LexedTokens::Builder result) {
+    Range range;
+    if (!lexTokenSequence(range) || pos != end) return false;
+    buildTokens(range, result.initTokens(range.count));
+    return true;
+  }
+
+private:
+  struct Range {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  struct TokenInfo {
+    Token::Which type;
+    uint32_t startByte;
+    uint32_t endByte;
+    Range content;
+    // IDENTIFIER, OPERATOR:  byte range in the input.
+    // STRING_LITERAL:  byte range in `strings`.
+    // PARENTHESIZED_LIST, BRACKETED_LIST:  range in `items`.
+    union {
+      uint64_t integer;
+      double number;
+    };
+  };
+
+  struct StatementInfo {
+    Range tokens;
+    bool isBlock;
+    Range block;       // range in `statements`, if isBlock.
+    Range docComment;  // range in `commentLines`.
+    uint32_t startByte;
+    uint32_t endByte;
+  };
+
+  const char* begin;
+  const char* pos;
+  const char* end;
+
+  // Each sequence is accumulated on a stack and moved to the matching output array once complete,
+  // so that the elements of every sequence end up contiguous even though nested sequences finish
+  // first.
+  kj::Vector<TokenInfo> tokenStack;
+  kj::Vector<TokenInfo> tokens;
+  kj::Vector<Range> itemStack;
+  kj::Vector<Range> items;
+  kj::Vector<StatementInfo> statementStack;
+  kj::Vector<StatementInfo> statements;
+
+  kj::Vector<char> strings;
+  kj::Vector<kj::ArrayPtr<const char>> commentLines;
+
+  template <typename T>
+  static Range commit(kj::Vector<T>& stack, size_t mark, kj::Vector<T>& output) {
+    Range range = { static_cast<uint32_t>(output.size()),
+                    static_cast<uint32_t>(stack.size() - mark) };
+    output.addAll(stack.begin() + mark, stack.end());
+    stack.resize(mark);
+    return range;
+  }
+
+  inline uint32_t offset(const char* ptr) { return ptr - begin; }
+
+  // -------------------------------------------------------------------
+  // Pass 1:  recognize.  All of these return false to give up.
+
+  void skipCommentsAndWhitespace() {
+    for (;;) {
+      while (pos != end && p::whitespaceChar.contains(*pos)) ++pos;
+      if (pos == end || *pos != '#') return;
+      while (pos != end && *pos != '\n') ++pos;
+      if (pos != end) ++pos;
+    }
+  }
+
+  Range lexDocComment() {
+    // Matches `docComment` in the grammar.  Consumes nothing unless there is at least one line.
+
+    Range result = { static_cast<uint32_t>(commentLines.size()), 0 };
+
+    const char* scan = pos;
+    while (scan != end && lineWhitespaceChar.contains(*scan)) ++scan;
+    if (scan != end && *scan == '\n') {
+      ++scan;
+    } else if (scan != end && *scan == '\r') {
+      ++scan;
+      if (scan != end && *scan == '\n') ++scan;
+    }
+
+    while (scan != end) {
+      const char* q = scan;
+      while (q != end && lineWhitespaceChar.contains(*q)) ++q;
+      if (q == end || *q != '#') break;
+      ++q;
+      if (q != end && *q == ' ') ++q;
+      const char* lineStart = q;
+      while (q != end && *q != '\n') ++q;
+      commentLines.add(lineStart, q - lineStart);
+      if (q != end) ++q;
+      scan = q;
+      ++result.count;
+    }
+
+    if (result.count > 0) pos = scan;
+    return result;
+  }
+
+  bool lexTokenSequence(Range& result) {
+    skipCommentsAndWhitespace();
+    size_t mark = tokenStack.size();
+    while (pos != end) {
+      bool matched;
+      if (!lexToken(matched)) return false;
+      if (!matched) break;
+      skipCommentsAndWhitespace();
+    }
+    result = commit(tokenStack, mark, tokens);
+    return true;
+  }
+
+  bool lexToken(bool& matched) {
+    // Sets `matched` to false if the next character cannot start a token at all.  Otherwise,
+    // failing to match a token means the input is invalid:  the only characters that may follow a
+    // token sequence are delimiters, and none of them can start a token.
+
+    const char* start = pos;
+    char c = *pos;
+    matched = true;
+
+    if (p::nameStart.contains(c)) {
+      do { ++pos; } while (pos != end && p::nameChar.contains(*pos));
+      addText(Token::IDENTIFIER, start);
+      return true;
+    } else if (c == '\"') {
+      return lexString();
+    } else if (p::digit.contains(c)) {
+      return lexNumber();
+    } else if (operatorChar.contains(c)) {
+      do { ++pos; } while (pos != end && operatorChar.contains(*pos));
+      addText(Token::OPERATOR, start);
+      return true;
+    } else if (c == '(') {
+      return lexList(Token::PARENTHESIZED_LIST, ')');
+    } else if (c == '[') {
+      return lexList(Token::BRACKETED_LIST, ']');
+    } else {
+      matched = false;
+      return true;
+    }
+  }
+
+  void addText(Token::Which type, const char* start) {
+    TokenInfo info;
+    info.type = type;
+    info.startByte = offset(start);
+    info.endByte = offset(pos);
+    info.content = { offset(start), static_cast<uint32_t>(pos - start) };
+    tokenStack.add(info);
+  }
+
+  bool lexString() {
+    const char* start = pos++;
+    uint32_t stringStart = strings.size();
+
+    for (;;) {
+      if (pos == end) return false;
+      char c = *pos++;
+      if (c == '\"') {
+        break;
+      } else if (c == '\n') {
+        return false;
+      } else if (c != '\\') {
+        strings.add(c);
+        continue;
+      }
+
+      // Escape sequence.
+      if (pos == end) return false;
+      c = *pos++;
+      switch (c) {
+        case 'a': strings.add('\a'); break;
+        case 'b': strings.add('\b'); break;
+        case 'f': strings.add('\f'); break;
+        case 'n': strings.add('\n'); break;
+        case 'r': strings.add('\r'); break;
+        case 't': strings.add('\t'); break;
+        case 'v': strings.add('\v'); break;
+        case '\'': case '\"': case '\\': case '\?': strings.add(c); break;
+        case 'x':
+          if (end - pos < 2 || !p::hexDigit.contains(pos[0]) || !p::hexDigit.contains(pos[1])) {
+            return false;
+          }
+          strings.add((p::_::parseDigit(pos[0]) << 4) | p::_::parseDigit(pos[1]));
+          pos += 2;
+          break;
+        default: {
+          if (!p::octDigit.contains(c)) return false;
+          char value = c - '0';
+          for (uint i = 0; i < 2 && pos != end && p::octDigit.contains(*pos); i++) {
+            value = (value << 3) | (*pos++ - '0');
+          }
+          strings.add(value);
+          break;
+        }
+      }
+    }
+
+    TokenInfo info;
+    info.type = Token::STRING_LITERAL;
+    info.startByte = offset(start);
+    info.endByte = offset(pos);
+    info.content = { stringStart, static_cast<uint32_t>(strings.size() - stringStart) };
+    tokenStack.add(info);
+    return true;
+  }
+
+  bool lexNumber() {
+    // The grammar tries `integer` and then `number`, and neither backtracks into its alternatives
+    // once the literal has been scanned, hence e.g. "09" lexing as the two integers 0 and 9.
+
+    const char* start = pos;
+    const char* scan = pos;
+    uint64_t value = 0;
+    if (*scan == '0' && end - scan >= 2 && scan[1] == 'x') {
+      for (scan += 2; scan != end && p::hexDigit.contains(*scan); ++scan) {
+        value = value * 16 + p::_::parseDigit(*scan);
+      }
+    } else if (*scan == '0') {
+      for (++scan; scan != end && p::octDigit.contains(*scan); ++scan) {
+        value = value * 8 + (*scan - '0');
+      }
+    } else {
+      for (; scan != end && p::digit.contains(*scan); ++scan) {
+        value = value * 10 + (*scan - '0');
+      }
+    }
+
+    TokenInfo info;
+    info.startByte = offset(start);
+    if (scan == end || !numberTerminator.contains(*scan)) {
+      pos = scan;
+      info.type = Token::INTEGER_LITERAL;
+      info.integer = value;
+    } else {
+      scan = start;
+      while (scan != end && p::digit.contains(*scan)) ++scan;
+      if (scan != end && *scan == '.') {
+        for (++scan; scan != end && p::digit.contains(*scan); ++scan) {}
+      }
+      if (scan != end && (*scan == 'e' || *scan == 'E')) {
+        ++scan;
+        if (scan != end && (*scan == '+' || *scan == '-')) ++scan;
+        while (scan != end && p::digit.contains(*scan)) ++scan;
+      }
+      if (scan != end && numberTerminator.contains(*scan)) return false;
+
+      pos = scan;
+      KJ_STACK_ARRAY(char, buffer, pos - start + 1, 64, 256);
+      memcpy(buffer.begin(), start, pos - start);
+      buffer[pos - start] = '\0';
+      info.type = Token::FLOAT_LITERAL;
+      info.number = strtod(buffer.begin(), nullptr);
+    }
+    info.endByte = offset(pos);
+    tokenStack.add(info);
+    return true;
+  }
+
+  bool lexList(Token::Which type, char close) {
+    const char* start = pos++;
+    size_t mark = itemStack.size();
+
+    Range first;
+    if (!lexTokenSequence(first)) return false;
+    itemStack.add(first);
+    while (pos != end && *pos == ',') {
+      ++pos;
+      Range item;
+      if (!lexTokenSequence(item)) return false;
+      itemStack.add(item);
+    }
+    if (pos == end || *pos != close) return false;
+    ++pos;
+
+    if (itemStack.size() == mark + 1 && first.count == 0) {
+      // The grammar treats a completely empty list as having no items, not one empty item.
+      itemStack.resize(mark);
+    }
+
+    TokenInfo info;
+    info.type = type;
+    info.startByte = offset(start);
+    info.endByte = offset(pos);
+    info.content = commit(itemStack, mark, items);
+    tokenStack.add(info);
+    return true;
+  }
+
+  bool lexStatementSequence(Range& result) {
+    skipCommentsAndWhitespace();
+    size_t mark = statementStack.size();
+    while (pos != end) {
+      const char* start = pos;
+
+      StatementInfo info;
+      if (!lexTokenSequence(info.tokens)) return false;
+
+      if (pos != end && *pos == ';') {
+        ++pos;
+        info.isBlock = false;
+        info.block = { 0, 0 };
+        info.docComment = lexDocComment();
+      } else if (pos != end && *pos == '{') {
+        ++pos;
+        info.isBlock = true;
+        info.docComment = lexDocComment();
+        if (!lexStatementSequence(info.block)) return false;
+        if (pos == end || *pos != '}') return false;
+        ++pos;
+        Range lateComment = lexDocComment();
+        if (info.docComment.count == 0) info.docComment = lateComment;
+      } else if (info.tokens.count == 0) {
+        // Not a statement; probably the end of the enclosing block.  Nothing was consumed.
+        break;
+      } else {
+        return false;
+      }
+
+      info.startByte = offset(start);
+      info.endByte = offset(pos);
+      statementStack.add(info);
+      skipCommentsAndWhitespace();
+    }
+    result = commit(statementStack, mark, statements);
+    return true;
+  }
+
+  // -------------------------------------------------------------------
+  // Pass 2:  build.
+
+  static void setText(Text::Builder builder, const char* text) {
+    memcpy(builder.begin(), text, builder.size());
+  }
+
+  void buildTokens(Range range, List<Token>::Builder builder) {
+    for (uint i = 0; i < range.count; i++) {
+      const TokenInfo& info = tokens[range.first + i];
+      auto token = builder[i];
+      token.setStartByte(info.startByte);
+      token.setEndByte(info.endByte);
+
+      switch (info.type) {
+        case Token::IDENTIFIER:
+          setText(token.initIdentifier(info.content.count), begin + info.content.first);
+          break;
+        case Token::STRING_LITERAL:
+          setText(token.initStringLiteral(info.content.count),
+                  strings.begin() + info.content.first);
+          break;
+        case Token::INTEGER_LITERAL:
+          token.setIntegerLiteral(info.integer);
+          break;
+        case Token::FLOAT_LITERAL:
+          token.setFloatLiteral(info.number);
+          break;
+        case Token::OPERATOR:
+          setText(token.initOperator(info.content.count), begin + info.content.first);
+          break;
+        case Token::PARENTHESIZED_LIST:
+          buildItems(info.content, token.initParenthesizedList(info.content.count));
+          break;
+        case Token::BRACKETED_LIST:
+          buildItems(info.content, token.initBracketedList(info.content.count));
+          break;
+      }
+    }
+  }
+
+  void buildItems(Range range, List<List<Token>>::Builder builder) {
+    for (uint i = 0; i < range.count; i++) {
+      Range item = items[range.first + i];
+      buildTokens(item, builder.init(i, item.count));
+    }
+  }
+
+  void buildStatements(Range range, List<Statement>::Builder builder) {
+    for (uint i = 0; i < range.count; i++) {
+      const StatementInfo& info = statements[range.first + i];
+      auto statement = builder[i];
+      statement.setStartByte(info.startByte);
+      statement.setEndByte(info.endByte);
+      buildTokens(info.tokens, statement.initTokens(info.tokens.count));
+
+      if (info.isBlock) {
+        buildStatements(info.block, statement.initBlock(info.block.count));
+      } else {
+        statement.setLine();
+      }
+
+      if (info.docComment.count > 0) {
+        auto lines = commentLines.asPtr().slice(
+            info.docComment.first, info.docComment.first + info.docComment.count);
+        size_t size = 0;
+        for (auto& line: lines) {
+          size += line.size() + 1;  // include newline
+        }
+        char* out = statement.initDocComment(size).begin();
+        for (auto& line: lines) {
+          memcpy(out, line.begin(), line.size());
+          out += line.size();
+          *out++ = '\n';
+        }
+      }
+    }
+  }
+};
+
+}  // namespace
+
 bool lex(kj::ArrayPtr<const char> input, LexedStatements::Builder result,
          ErrorReporter& errorReporter) {
+  if (FastLexer(input).lexStatements(result)) {
+    return true;
+  }
+
+  // The input is invalid (or FastLexer has a bug).  Either way, the grammar has the final say.
   Lexer lexer(Orphanage::getForMessageContaining(result), errorReporter);
 
   auto parser = p::sequence(lexer.getParsers().statementSequence, p::endOfInput);
@@ -54,6 +510,10 @@ bool lex(kj::ArrayPtr<const char> input, LexedStatements::Builder result,
 
 bool lex(kj::ArrayPtr<const char> input, LexedTokens::Builder result,
          ErrorReporter& errorReporter) {
+  if (FastLexer(input).lexTokens(result)) {
+    return true;
+  }
+
   Lexer lexer(Orphanage::getForMessageContaining(result), errorReporter);
 
   auto parser = p::sequence(lexer.getParsers().tokenSequence, p::endOfInput);
@@ -123,8 +583,7 @@ constexpr auto commentsAndWhitespace =
     sequence(p::discardWhitespace,
              p::discard(p::many(sequence(discardComment, p::discardWhitespace))));
 
-constexpr auto discardLineWhitespace =
-    p::discard(p::many(p::discard(p::whitespaceChar.invert().orAny("\r\n").invert())));
+constexpr auto discardLineWhitespace = p::discard(p::many(p::discard(lineWhitespaceChar)));
 constexpr auto newline = p::oneOf(
     p::exactChar<'\n'>(),
     sequence(p::exactChar<'\r'>(), p::discard(p::optional(p::exactChar<'\n'>()))));
@@ -188,7 +647,7 @@ Lexer::Lexer(Orphanage orphanageParam, ErrorReporter& errorReporterParam)
             return t;
           }),
       p::transformWithLocation(
-          p::charsToString(p::oneOrMore(p::anyOfChars("!$%&*+-./:<=>?@^|~"))),
+          p::charsToString(p::oneOrMore(operatorChar)),
           [this](Location loc, kj::String text) -> Orphan<Token> {
             auto t = orphanage.newOrphan<Token>();
             initTok(t, loc).setOperator(text);
@@ -177,9 +177,12 @@ static const ::capnp::_::RawSchema* const d_91cc55cd57de5419[] = {
 };
 static const uint16_t m_91cc55cd57de5419[] = {6, 8, 3, 0, 2, 4, 5, 7, 1};
 static const uint16_t i_91cc55cd57de5419[] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+static const uint16_t mh_91cc55cd57de5419[] = {3, 12, 0, 0, 5, 6, 7, 0, 65535, 8, 65535, 2, 65535, 1, 4, 5, 3};
+static const uint16_t dh_91cc55cd57de5419[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_91cc55cd57de5419 = {
   0x91cc55cd57de5419, b_91cc55cd57de5419.words, 165, d_91cc55cd57de5419, m_91cc55cd57de5419,
-  1, 9, i_91cc55cd57de5419, nullptr, nullptr
+  1, 9, i_91cc55cd57de5419, nullptr, nullptr,
+  mh_91cc55cd57de5419, dh_91cc55cd57de5419, nullptr
 };
 static const ::capnp::_::AlignedData<110> b_c6725e678d60fa37 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -299,9 +302,12 @@ static const ::capnp::_::RawSchema* const d_c6725e678d60fa37[] = {
 };
 static const uint16_t m_c6725e678d60fa37[] = {2, 3, 5, 1, 4, 0};
 static const uint16_t i_c6725e678d60fa37[] = {1, 2, 0, 3, 4, 5};
+static const uint16_t mh_c6725e678d60fa37[] = {2, 8, 0, 1, 5, 3, 1, 4, 65535, 0, 65535, 2};
+static const uint16_t dh_c6725e678d60fa37[] = {1, 3, 0, 1, 0, 65535};
 const ::capnp::_::RawSchema s_c6725e678d60fa37 = {
   0xc6725e678d60fa37, b_c6725e678d60fa37.words, 110, d_c6725e678d60fa37, m_c6725e678d60fa37,
-  2, 6, i_c6725e678d60fa37, nullptr, nullptr
+  2, 6, i_c6725e678d60fa37, nullptr, nullptr,
+  mh_c6725e678d60fa37, dh_c6725e678d60fa37, nullptr
 };
 static const ::capnp::_::AlignedData<35> b_9e69a92512b19d18 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -345,9 +351,12 @@ static const ::capnp::_::RawSchema* const d_9e69a92512b19d18[] = {
 };
 static const uint16_t m_9e69a92512b19d18[] = {0};
 static const uint16_t i_9e69a92512b19d18[] = {0};
+static const uint16_t mh_9e69a92512b19d18[] = {1, 2, 0, 65535, 0};
+static const uint16_t dh_9e69a92512b19d18[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_9e69a92512b19d18 = {
   0x9e69a92512b19d18, b_9e69a92512b19d18.words, 35, d_9e69a92512b19d18, m_9e69a92512b19d18,
-  1, 1, i_9e69a92512b19d18, nullptr, nullptr
+  1, 1, i_9e69a92512b19d18, nullptr, nullptr,
+  mh_9e69a92512b19d18, dh_9e69a92512b19d18, nullptr
 };
 static const ::capnp::_::AlignedData<37> b_a11f97b9d6c73dd4 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -393,9 +402,12 @@ static const ::capnp::_::RawSchema* const d_a11f97b9d6c73dd4[] = {
 };
 static const uint16_t m_a11f97b9d6c73dd4[] = {0};
 static const uint16_t i_a11f97b9d6c73dd4[] = {0};
+static const uint16_t mh_a11f97b9d6c73dd4[] = {1, 2, 0, 65535, 0};
+static const uint16_t dh_a11f97b9d6c73dd4[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_a11f97b9d6c73dd4 = {
   0xa11f97b9d6c73dd4, b_a11f97b9d6c73dd4.words, 37, d_a11f97b9d6c73dd4, m_a11f97b9d6c73dd4,
-  1, 1, i_a11f97b9d6c73dd4, nullptr, nullptr
+  1, 1, i_a11f97b9d6c73dd4, nullptr, nullptr,
+  mh_a11f97b9d6c73dd4, dh_a11f97b9d6c73dd4, nullptr
 };
 }  // namespace schemas
 namespace _ {  // private
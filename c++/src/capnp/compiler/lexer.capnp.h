@@ -107,6 +107,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<9> presenceMask() const;
+
   inline Which which() const;
   inline bool isIdentifier() const;
   inline bool hasIdentifier() const;
@@ -168,6 +170,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isIdentifier();
   inline bool hasIdentifier();
@@ -262,6 +266,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<6> presenceMask() const;
+
   inline Which which() const;
   inline bool hasTokens() const;
   inline  ::capnp::List< ::capnp::compiler::Token>::Reader getTokens() const;
@@ -310,6 +316,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool hasTokens();
   inline  ::capnp::List< ::capnp::compiler::Token>::Builder getTokens();
@@ -380,6 +388,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline bool hasTokens() const;
   inline  ::capnp::List< ::capnp::compiler::Token>::Reader getTokens() const;
 
@@ -413,6 +423,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasTokens();
   inline  ::capnp::List< ::capnp::compiler::Token>::Builder getTokens();
   inline void setTokens( ::capnp::List< ::capnp::compiler::Token>::Reader value);
@@ -457,6 +469,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline bool hasStatements() const;
   inline  ::capnp::List< ::capnp::compiler::Statement>::Reader getStatements() const;
 
@@ -490,6 +504,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasStatements();
   inline  ::capnp::List< ::capnp::compiler::Statement>::Builder getStatements();
   inline void setStatements( ::capnp::List< ::capnp::compiler::Statement>::Reader value);
@@ -532,6 +548,30 @@ inline Token::Which Token::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<9> Token::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<9> _result;
+  _result.set(0, which() == Token::IDENTIFIER && ((_pointers[0] >> 0) & 1));
+  _result.set(1, which() == Token::STRING_LITERAL && ((_pointers[0] >> 0) & 1));
+  _result.set(2, which() == Token::INTEGER_LITERAL && (_reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(3, which() == Token::FLOAT_LITERAL && (_reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(4, which() == Token::OPERATOR && ((_pointers[0] >> 0) & 1));
+  _result.set(5, which() == Token::PARENTHESIZED_LIST && ((_pointers[0] >> 0) & 1));
+  _result.set(6, which() == Token::BRACKETED_LIST && ((_pointers[0] >> 0) & 1));
+  _result.set(7, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  _result.set(8, _reader.hasDataField< ::uint32_t>(4 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Token::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Token>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool Token::Reader::isIdentifier() const {
   return which() == Token::IDENTIFIER;
 }
@@ -891,6 +931,32 @@ inline Statement::Which Statement::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<6> Statement::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<6> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, which() == Statement::LINE);
+  _result.set(2, which() == Statement::BLOCK && ((_pointers[0] >> 1) & 1));
+  _result.set(3, (_pointers[0] >> 2) & 1);
+  _result.set(4, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  _result.set(5, _reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Statement::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Statement>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(2 * ::capnp::POINTERS),
+      _other.getPointerField(2 * ::capnp::POINTERS));
+}
+
 inline bool Statement::Reader::hasTokens() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -1061,6 +1127,22 @@ inline void Statement::Builder::setEndByte( ::uint32_t value) {
       2 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<1> LexedTokens::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void LexedTokens::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<LexedTokens>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool LexedTokens::Reader::hasTokens() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -1093,6 +1175,22 @@ inline ::capnp::Orphan< ::capnp::List< ::capnp::compiler::Token>> LexedTokens::B
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<1> LexedStatements::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void LexedStatements::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<LexedStatements>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool LexedStatements::Reader::hasStatements() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -24,18 +24,24 @@
 #include "module-loader.h"
 #include "lexer.h"
 #include "parser.h"
+#include "md5.h"
 #include <kj/vector.h>
 #include <kj/mutex.h>
 #include <kj/debug.h>
 #include <kj/io.h>
+#include <kj/thread.h>
 #include <capnp/message.h>
+#include <capnp/serialize.h>
+#include <atomic>
 #include <map>
+#include <set>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <stdio.h>
 
 namespace capnp {
 namespace compiler {
@@ -193,6 +199,80 @@ kj::String catPath(kj::StringPtr base, kj::StringPtr add) {
   return kj::str(base.slice(0, pos - base.begin()), add);
 }
 
+constexpr const char PARSE_CACHE_TAG[] = "capnp-parse-cache-v1:";
+// Mixed into every cache key.  Bump it whenever the parser's output for a given input changes.
+
+kj::String parseCachePath(kj::StringPtr dir, kj::ArrayPtr<const char> content) {
+  Md5 md5;
+  md5.update(PARSE_CACHE_TAG);
+  kj::String header = kj::str(CAPNP_VERSION_MAJOR, '.', CAPNP_VERSION_MINOR, '.',
+                              CAPNP_VERSION_MICRO, ':', content.size(), ':');
+  md5.update(kj::StringPtr(header));
+  md5.update(content);
+  return kj::str(dir, '/', md5.finishAsHex(), ".parsed");
+}
+
+kj::Maybe<Orphan<ParsedFile>> readParseCache(kj::StringPtr path, Orphanage orphanage) {
+  int fd = open(path.cStr(), O_RDONLY);
+  if (fd < 0) {
+    // Not cached (yet).
+    return nullptr;
+  }
+  kj::AutoCloseFd closer(fd);
+
+  // A truncated or otherwise corrupt cache entry is simply treated as a miss; it will be
+  // overwritten once the file has been re-parsed.
+  kj::Maybe<Orphan<ParsedFile>> result;
+  KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+    struct stat stats;
+    KJ_SYSCALL(fstat(fd, &stats));
+    KJ_REQUIRE(stats.st_size % sizeof(word) == 0, "parse cache entry is truncated", path);
+
+    auto words = kj::heapArray<word>(stats.st_size / sizeof(word));
+    kj::FdInputStream(fd).read(words.begin(), words.size() * sizeof(word));
+
+    ReaderOptions options;
+    options.traversalLimitInWords = kj::maxValue;
+    options.nestingLimit = kj::maxValue;
+    FlatArrayMessageReader reader(words, options);
+    result = orphanage.newOrphanCopy(reader.getRoot<ParsedFile>());
+  })) {
+    return nullptr;
+  }
+  return kj::mv(result);
+}
+
+void writeParseCache(kj::StringPtr path, ParsedFile::Reader parsed) {
+  // Write to a temporary file and rename it into place so that concurrent compiler invocations
+  // sharing a cache never observe a partial entry.  Failure to populate the cache is not an error.
+  //
+  // The temporary name is unique to this call within the process, so threads pre-parsing identical
+  // files don't collide.  A file left under the same name by a crashed process that had our PID
+  // is simply overwritten.
+  static std::atomic<uint> tempCounter(0);
+  kj::String tempPath = kj::str(path, ".tmp.", getpid(), '.', tempCounter++);
+  int fd = open(tempPath.cStr(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    // E.g. the cache directory isn't writable.
+    return;
+  }
+
+  KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+    kj::AutoCloseFd closer(fd);
+
+    MallocMessageBuilder message;
+    message.setRoot(parsed);
+    writeMessageToFd(fd, message);
+  })) {
+    unlink(tempPath.cStr());
+    return;
+  }
+
+  if (rename(tempPath.cStr(), path.cStr()) < 0) {
+    unlink(tempPath.cStr());
+  }
+}
+
 }  // namespace
 
 
@@ -204,13 +284,27 @@ public:
     searchPath.add(kj::heapString(kj::mv(path)));
   }
 
+  void setCacheDir(kj::String path) {
+    cacheDir = kj::mv(path);
+  }
+
+  kj::Maybe<kj::StringPtr> getCacheDir() {
+    KJ_IF_MAYBE(dir, cacheDir) {
+      return kj::StringPtr(*dir);
+    } else {
+      return nullptr;
+    }
+  }
+
   kj::Maybe<Module&> loadModule(kj::StringPtr localName, kj::StringPtr sourceName);
   kj::Maybe<Module&> loadModuleFromSearchPath(kj::StringPtr sourceName);
+  void parseAll(kj::ArrayPtr<Module* const> modules, uint threadCount);
   GlobalErrorReporter& getErrorReporter() { return errorReporter; }
 
 private:
   GlobalErrorReporter& errorReporter;
   kj::Vector<kj::String> searchPath;
+  kj::Maybe<kj::String> cacheDir;
   std::map<kj::StringPtr, kj::Own<Module>> modules;
 };
 
@@ -228,18 +322,57 @@ public:
   }
 
   Orphan<ParsedFile> loadContent(Orphanage orphanage) override {
+    KJ_IF_MAYBE(pre, preparsed) {
+      // parseAll() already did the work; all that's left is to report its errors.
+      auto message = kj::mv(*pre);
+      preparsed = nullptr;
+      for (auto& error: pendingErrors) {
+        addError(error.startByte, error.endByte, error.message);
+      }
+      pendingErrors.resize(0);
+      return orphanage.newOrphanCopy(message->getRoot<ParsedFile>().asReader());
+    }
+
     kj::Array<const char> content = mmapForRead(localName);
 
     lineBreaks = nullptr;  // In case loadContent() is called multiple times.
     lineBreaks = lineBreaksSpace.construct(content);
 
-    MallocMessageBuilder lexedBuilder;
-    auto statements = lexedBuilder.initRoot<LexedStatements>();
-    lex(content, statements, *this);
+    KJ_IF_MAYBE(dir, loader.getCacheDir()) {
+      // The line break table is still built from the real content above, so errors found later
+      // during translation are reported at the right positions even on a cache hit.
+      kj::String cachePath = parseCachePath(*dir, content);
+      KJ_IF_MAYBE(cached, readParseCache(cachePath, orphanage)) {
+        return kj::mv(*cached);
+      }
 
-    auto parsed = orphanage.newOrphan<ParsedFile>();
-    parseFile(statements.getStatements(), parsed.get(), *this);
-    return parsed;
+      reportedErrors = false;
+      auto parsed = parse(content, orphanage);
+      if (!reportedErrors) {
+        writeParseCache(cachePath, parsed.getReader());
+      }
+      return parsed;
+    }
+
+    return parse(content, orphanage);
+  }
+
+  void preparse() {
+    // Does the work of loadContent() into `preparsed`, holding back any errors.  This touches no
+    // state outside of this module, so different modules may be pre-parsed concurrently.
+
+    KJ_REQUIRE(preparsed == nullptr, "File was already pre-parsed.");
+    auto message = kj::heap<MallocMessageBuilder>();
+    bufferErrors = true;
+    KJ_DEFER(bufferErrors = false);
+    message->adoptRoot(loadContent(message->getOrphanage()));
+    preparsed = kj::mv(message);
+  }
+
+  kj::Maybe<ParsedFile::Reader> getPreparsed() {
+    return preparsed.map([](kj::Own<MallocMessageBuilder>& message) {
+      return message->getRoot<ParsedFile>().asReader();
+    });
   }
 
   kj::Maybe<Module&> importRelative(kj::StringPtr importPath) override {
@@ -251,6 +384,12 @@ public:
   }
 
   void addError(uint32_t startByte, uint32_t endByte, kj::StringPtr message) override {
+    reportedErrors = true;
+    if (bufferErrors) {
+      pendingErrors.add(PendingError { startByte, endByte, kj::heapString(message) });
+      return;
+    }
+
     auto& lines = *KJ_REQUIRE_NONNULL(lineBreaks,
         "Can't report errors until loadContent() is called.");
 
@@ -269,6 +408,31 @@ private:
 
   kj::SpaceFor<LineBreakTable> lineBreaksSpace;
   kj::Maybe<kj::Own<LineBreakTable>> lineBreaks;
+
+  bool reportedErrors = false;
+  // Set whenever an error is reported against this file.  Used to keep files that failed to parse
+  // out of the parse cache.
+
+  struct PendingError {
+    uint32_t startByte;
+    uint32_t endByte;
+    kj::String message;
+  };
+
+  bool bufferErrors = false;
+  kj::Vector<PendingError> pendingErrors;
+  kj::Maybe<kj::Own<MallocMessageBuilder>> preparsed;
+  // Set by preparse() and consumed by the next loadContent().
+
+  Orphan<ParsedFile> parse(kj::ArrayPtr<const char> content, Orphanage orphanage) {
+    MallocMessageBuilder lexedBuilder;
+    auto statements = lexedBuilder.initRoot<LexedStatements>();
+    lex(content, statements, *this);
+
+    auto parsed = orphanage.newOrphan<ParsedFile>();
+    parseFile(statements.getStatements(), parsed.get(), *this);
+    return parsed;
+  }
 };
 
 // =======================================================================================
@@ -309,6 +473,50 @@ kj::Maybe<Module&> ModuleLoader::Impl::loadModuleFromSearchPath(kj::StringPtr so
   return nullptr;
 }
 
+void ModuleLoader::Impl::parseAll(kj::ArrayPtr<Module* const> roots, uint threadCount) {
+  // Parses the import graph breadth-first.  Each wave of newly-discovered files is parsed in
+  // parallel; imports are then resolved on this thread, since that mutates `modules`.
+
+  std::set<ModuleImpl*> seen;
+  kj::Vector<ModuleImpl*> wave;
+  for (Module* root: roots) {
+    auto& module = kj::downcast<ModuleImpl>(*root);
+    if (seen.insert(&module).second && module.getPreparsed() == nullptr) {
+      wave.add(&module);
+    }
+  }
+
+  while (wave.size() > 0) {
+    {
+      std::atomic<size_t> next(0);
+      uint workerCount = kj::min(threadCount, wave.size());
+      auto workers = kj::heapArrayBuilder<kj::Own<kj::Thread>>(workerCount);
+      for (uint i = 0; i < workerCount; i++) {
+        workers.add(kj::heap<kj::Thread>([&]() {
+          for (size_t j = next++; j < wave.size(); j = next++) {
+            wave[j]->preparse();
+          }
+        }));
+      }
+      // Destroying the workers joins them, rethrowing any fatal exceptions.
+    }
+
+    kj::Vector<ModuleImpl*> nextWave;
+    for (ModuleImpl* module: wave) {
+      for (auto name: findImports(KJ_ASSERT_NONNULL(module->getPreparsed()).getRoot())) {
+        // Imports that don't resolve are reported by the compiler when it gets to them.
+        KJ_IF_MAYBE(imported, module->importRelative(name)) {
+          auto& importedImpl = kj::downcast<ModuleImpl>(*imported);
+          if (seen.insert(&importedImpl).second && importedImpl.getPreparsed() == nullptr) {
+            nextWave.add(&importedImpl);
+          }
+        }
+      }
+    }
+    wave = kj::mv(nextWave);
+  }
+}
+
 // =======================================================================================
 
 ModuleLoader::ModuleLoader(GlobalErrorReporter& errorReporter)
@@ -316,6 +524,11 @@ ModuleLoader::ModuleLoader(GlobalErrorReporter& errorReporter)
 ModuleLoader::~ModuleLoader() noexcept(false) {}
 
 void ModuleLoader::addImportPath(kj::String path) { impl->addImportPath(kj::mv(path)); }
+void ModuleLoader::setCacheDir(kj::String path) { impl->setCacheDir(kj::mv(path)); }
+
+void ModuleLoader::parseAll(kj::ArrayPtr<Module* const> modules, uint threadCount) {
+  impl->parseAll(modules, threadCount);
+}
 
 kj::Maybe<Module&> ModuleLoader::loadModule(kj::StringPtr localName, kj::StringPtr sourceName) {
   return impl->loadModule(localName, sourceName);
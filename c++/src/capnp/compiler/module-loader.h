@@ -45,11 +45,23 @@ public:
   void addImportPath(kj::String path);
   // Add a directory to the list of paths that is searched for imports that start with a '/'.
 
+  void setCacheDir(kj::String path);
+  // Cache parsed files under the given directory, keyed by the MD5 of their content, so that
+  // unchanged files need not be lexed and parsed again on the next run.  Files that fail to parse
+  // are never cached.  The directory must already exist.
+
   kj::Maybe<Module&> loadModule(kj::StringPtr localName, kj::StringPtr sourceName);
   // Tries to load the module with the given filename.  `localName` is the path to the file on
   // disk (as you'd pass to open(2)), and `sourceName` is the canonical name it should be given
   // in the schema (this is used e.g. to decide output file locations).  Often, these are the same.
 
+  void parseAll(kj::ArrayPtr<Module* const> modules, uint threadCount);
+  // Lexes and parses the given modules -- which must have been returned by loadModule() -- and
+  // everything they transitively import, using up to `threadCount` threads.  The parse trees are
+  // held until the compiler asks for them through Module::loadContent(), and any errors found are
+  // reported at that point, so the compiler's output (including error messages and their order)
+  // is the same as if each file had been parsed on demand.
+
 private:
   class Impl;
   kj::Own<Impl> impl;
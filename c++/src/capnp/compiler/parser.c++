@@ -29,6 +29,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <set>
 
 namespace capnp {
 namespace compiler {
@@ -1074,5 +1075,96 @@ kj::Maybe<Orphan<Declaration>> CapnpParser::parseStatement(
   }
 }
 
+// =======================================================================================
+
+typedef std::set<kj::StringPtr, std::less<kj::StringPtr>, kj::ArenaAllocator<kj::StringPtr>>
+    ImportSet;
+// Allocated from the ThreadLocalArena set up by findImports(), so that walking a large file does
+// not cost a heap allocation per distinct import.
+
+static void findImports(DeclName::Reader name, ImportSet& output) {
+  if (name.getBase().isImportName()) {
+    output.insert(name.getBase().getImportName().getValue());
+  }
+}
+
+static void findImports(TypeExpression::Reader type, ImportSet& output) {
+  findImports(type.getName(), output);
+  for (auto param: type.getParams()) {
+    findImports(param, output);
+  }
+}
+
+static void findImports(Declaration::Reader decl, ImportSet& output) {
+  switch (decl.which()) {
+    case Declaration::USING:
+      findImports(decl.getUsing().getTarget(), output);
+      break;
+    case Declaration::CONST:
+      findImports(decl.getConst().getType(), output);
+      break;
+    case Declaration::FIELD:
+      findImports(decl.getField().getType(), output);
+      break;
+    case Declaration::INTERFACE:
+      for (auto extend: decl.getInterface().getExtends()) {
+        findImports(extend, output);
+      }
+      break;
+    case Declaration::METHOD: {
+      auto method = decl.getMethod();
+
+      auto params = method.getParams();
+      if (params.isNamedList()) {
+        for (auto param: params.getNamedList()) {
+          findImports(param.getType(), output);
+          for (auto ann: param.getAnnotations()) {
+            findImports(ann.getName(), output);
+          }
+        }
+      } else {
+        findImports(params.getType(), output);
+      }
+
+      if (method.getResults().isExplicit()) {
+        auto results = method.getResults().getExplicit();
+        if (results.isNamedList()) {
+          for (auto param: results.getNamedList()) {
+            findImports(param.getType(), output);
+            for (auto ann: param.getAnnotations()) {
+              findImports(ann.getName(), output);
+            }
+          }
+        } else {
+          findImports(results.getType(), output);
+        }
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  for (auto ann: decl.getAnnotations()) {
+    findImports(ann.getName(), output);
+  }
+
+  for (auto nested: decl.getNestedDecls()) {
+    findImports(nested, output);
+  }
+}
+
+kj::Array<kj::StringPtr> findImports(Declaration::Reader file) {
+  kj::ThreadLocalArena arena;
+  ImportSet names;
+  findImports(file, names);
+
+  auto result = kj::heapArrayBuilder<kj::StringPtr>(names.size());
+  for (auto name: names) {
+    result.add(name);
+  }
+  return result.finish();
+}
+
 }  // namespace compiler
 }  // namespace capnp
@@ -40,6 +40,10 @@ void parseFile(List<Statement>::Reader statements, ParsedFile::Builder result,
 // If any errors are reported, then the output is not usable.  However, it may be passed on through
 // later stages of compilation in order to detect additional errors.
 
+kj::Array<kj::StringPtr> findImports(Declaration::Reader file);
+// Returns the names of all files imported anywhere in `file`, sorted and without duplicates.  The
+// strings point into `file`.
+
 uint64_t generateRandomId();
 // Generate a new random unique ID.  This lives here mostly for lack of a better location.
 
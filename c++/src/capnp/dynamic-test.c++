@@ -467,6 +467,38 @@ TEST(DynamicApi, BuilderAssign) {
   listValue.set(0, 123);
 }
 
+TEST(DynamicApi, IterateListBuilder) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<DynamicStruct>(Schema::from<TestAllTypes>());
+
+  int32_t i = 0;
+  for (auto element: root.init("structList", 3).as<DynamicList>()) {
+    element.as<DynamicStruct>().set("int32Field", ++i);
+  }
+
+  auto list = root.asReader().get("structList").as<DynamicList>();
+  ASSERT_EQ(3u, list.size());
+  for (uint j = 0; j < list.size(); j++) {
+    EXPECT_EQ(j + 1, list[j].as<DynamicStruct>().get("int32Field").as<uint>());
+  }
+}
+
+TEST(DynamicApi, StructLayoutCached) {
+  StructSchema schema = Schema::from<TestAllTypes>();
+  auto& layout = _::getStructLayout(schema);
+  EXPECT_EQ(&layout, &_::getStructLayout(schema));
+
+  // Repeated access through the cached descriptors gives the same results as the first.
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<DynamicStruct>(schema);
+  initDynamicTestMessage(root);
+  for (uint i = 0; i < 3; i++) {
+    checkDynamicTestMessage(root.asReader());
+    checkDynamicTestMessage(root);
+  }
+  EXPECT_EQ(&layout, &_::getStructLayout(schema));
+}
+
 }  // namespace
 }  // namespace _ (private)
 }  // namespace capnp
@@ -97,12 +97,175 @@ _::FieldSize elementSizeFor(schema::Type::Which elementType) {
   return _::FieldSize::VOID;
 }
 
-inline _::StructSize structSizeFromSchema(StructSchema schema) {
-  auto node = schema.getProto().getStruct();
-  return _::StructSize(
+}  // namespace
+
+// =======================================================================================
+
+namespace _ {  // private
+
+struct FieldLayout {
+  // Everything the DynamicStruct accessors need to know about one field, decoded from its
+  // schema::Field once so that they don't walk the schema node on every call.
+
+  schema::Field::Which kind;
+  schema::Type::Which type;       // Slots only.
+  uint16_t discriminantValue;     // NO_DISCRIMINANT if not a union member.
+  uint32_t offset;                // Slot offset, in multiples of the slot's own size.
+  uint64_t typeId;                // Group, struct, enum, or interface type.
+  uint64_t defaultBits;           // Default of a primitive or enum slot, as written to the wire.
+  const word* defaultPointer;     // Default of a list or struct slot, as an unchecked pointer.
+  kj::ArrayPtr<const byte> defaultBlob;  // Default of a text or data slot.
+};
+
+struct RawStructLayout {
+  const word* encodedNode;
+  // The schema node these descriptors were decoded from.  SchemaLoader may later replace a
+  // RawSchema's node with a newer version, in which case the layout is rebuilt.
+
+  const RawStructLayout* superseded;
+  // The layout this one replaced.  Other threads may still be using it, so it lives as long as
+  // this one does.
+
+  StructSize structSize;
+  uint32_t discriminantOffset;
+  uint16_t discriminantCount;
+
+  kj::Array<FieldLayout> fields;
+  // Indexed like StructSchema::getFields().
+
+  RawStructLayout(const word* encodedNode, const RawStructLayout* superseded);
+};
+
+RawStructLayout::RawStructLayout(const word* encodedNode, const RawStructLayout* superseded)
+    : encodedNode(encodedNode), superseded(superseded) {
+  auto node = readMessageUnchecked<schema::Node>(encodedNode).getStruct();
+  structSize = StructSize(
       node.getDataWordCount() * WORDS,
       node.getPointerCount() * POINTERS,
-      static_cast<_::FieldSize>(node.getPreferredListEncoding()));
+      static_cast<FieldSize>(node.getPreferredListEncoding()));
+  discriminantOffset = node.getDiscriminantOffset();
+  discriminantCount = node.getDiscriminantCount();
+
+  auto protos = node.getFields();
+  fields = kj::heapArray<FieldLayout>(protos.size());
+  for (uint i = 0; i < protos.size(); i++) {
+    auto proto = protos[i];
+    FieldLayout& field = fields[i];
+    field = FieldLayout();
+    field.kind = proto.which();
+    field.discriminantValue = proto.getDiscriminantValue();
+
+    switch (proto.which()) {
+      case schema::Field::SLOT: {
+        auto slot = proto.getSlot();
+        auto type = slot.getType();
+        auto dval = slot.getDefaultValue();
+        field.type = type.which();
+        field.offset = slot.getOffset();
+
+        switch (type.which()) {
+          case schema::Type::VOID:
+          case schema::Type::ANY_POINTER:
+            break;
+
+#define HANDLE_TYPE(discrim, titleCase, type) \
+          case schema::Type::discrim: \
+            field.defaultBits = bitCast<Mask<type>>(dval.get##titleCase()); \
+            break;
+
+          HANDLE_TYPE(BOOL, Bool, bool)
+          HANDLE_TYPE(INT8, Int8, int8_t)
+          HANDLE_TYPE(INT16, Int16, int16_t)
+          HANDLE_TYPE(INT32, Int32, int32_t)
+          HANDLE_TYPE(INT64, Int64, int64_t)
+          HANDLE_TYPE(UINT8, Uint8, uint8_t)
+          HANDLE_TYPE(UINT16, Uint16, uint16_t)
+          HANDLE_TYPE(UINT32, Uint32, uint32_t)
+          HANDLE_TYPE(UINT64, Uint64, uint64_t)
+          HANDLE_TYPE(FLOAT32, Float32, float)
+          HANDLE_TYPE(FLOAT64, Float64, double)
+
+#undef HANDLE_TYPE
+
+          case schema::Type::ENUM:
+            field.typeId = type.getEnum().getTypeId();
+            field.defaultBits = dval.getEnum();
+            break;
+
+          case schema::Type::TEXT: {
+            Text::Reader text = dval.getText();
+            field.defaultBlob = kj::arrayPtr(reinterpret_cast<const byte*>(text.begin()),
+                                             text.size());
+            break;
+          }
+
+          case schema::Type::DATA:
+            field.defaultBlob = dval.getData();
+            break;
+
+          case schema::Type::LIST:
+            field.defaultPointer = dval.getList().getAs<UncheckedMessage>();
+            break;
+
+          case schema::Type::STRUCT:
+            field.typeId = type.getStruct().getTypeId();
+            field.defaultPointer = dval.getStruct().getAs<UncheckedMessage>();
+            break;
+
+          case schema::Type::INTERFACE:
+            field.typeId = type.getInterface().getTypeId();
+            break;
+        }
+        break;
+      }
+
+      case schema::Field::GROUP:
+        field.typeId = proto.getGroup().getTypeId();
+        break;
+    }
+  }
+}
+
+const RawStructLayout& getStructLayout(StructSchema schema) {
+  const RawSchema* raw = schema.raw;
+  const RawStructLayout* layout = __atomic_load_n(&raw->structLayout, __ATOMIC_ACQUIRE);
+
+  while (layout == nullptr || layout->encodedNode != raw->encodedNode) {
+    // First use, or SchemaLoader has since replaced the node.  Build a layout and try to publish
+    // it.  If another thread beats us to it, use theirs.
+    auto built = new RawStructLayout(raw->encodedNode, layout);
+    if (__atomic_compare_exchange_n(&raw->structLayout, &layout, built, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      return *built;
+    }
+    delete built;
+  }
+
+  return *layout;
+}
+
+void destroyStructLayout(const RawStructLayout* layout) {
+  while (layout != nullptr) {
+    const RawStructLayout* next = layout->superseded;
+    delete layout;
+    layout = next;
+  }
+}
+
+}  // namespace _ (private)
+
+namespace {
+
+inline _::StructSize structSizeFromSchema(StructSchema schema) {
+  return _::getStructLayout(schema).structSize;
+}
+
+template <typename StructReaderOrBuilder>
+inline bool isActiveInUnion(const _::RawStructLayout& layout, const _::FieldLayout& field,
+                            StructReaderOrBuilder& s) {
+  return field.discriminantValue == schema::Field::NO_DISCRIMINANT ||
+      s.template getDataField<uint16_t>(layout.discriminantOffset * ELEMENTS) ==
+          field.discriminantValue;
 }
 
 }  // namespace
@@ -130,14 +293,8 @@ uint16_t DynamicEnum::asImpl(uint64_t requestedTypeId) const {
 // =======================================================================================
 
 bool DynamicStruct::Reader::isSetInUnion(StructSchema::Field field) const {
-  auto proto = field.getProto();
-  if (hasDiscriminantValue(proto)) {
-    uint16_t discrim = reader.getDataField<uint16_t>(
-        schema.getProto().getStruct().getDiscriminantOffset() * ELEMENTS);
-    return discrim == proto.getDiscriminantValue();
-  } else {
-    return true;
-  }
+  auto& layout = _::getStructLayout(schema);
+  return isActiveInUnion(layout, layout.fields[field.getIndex()], reader);
 }
 
 void DynamicStruct::Reader::verifySetInUnion(StructSchema::Field field) const {
@@ -147,14 +304,8 @@ void DynamicStruct::Reader::verifySetInUnion(StructSchema::Field field) const {
 }
 
 bool DynamicStruct::Builder::isSetInUnion(StructSchema::Field field) {
-  auto proto = field.getProto();
-  if (hasDiscriminantValue(proto)) {
-    uint16_t discrim = builder.getDataField<uint16_t>(
-        schema.getProto().getStruct().getDiscriminantOffset() * ELEMENTS);
-    return discrim == proto.getDiscriminantValue();
-  } else {
-    return true;
-  }
+  auto& layout = _::getStructLayout(schema);
+  return isActiveInUnion(layout, layout.fields[field.getIndex()], builder);
 }
 
 void DynamicStruct::Builder::verifySetInUnion(StructSchema::Field field) {
@@ -165,100 +316,88 @@ void DynamicStruct::Builder::verifySetInUnion(StructSchema::Field field) {
 
 void DynamicStruct::Builder::setInUnion(StructSchema::Field field) {
   // If a union member, set the discriminant to match.
-  auto proto = field.getProto();
-  if (hasDiscriminantValue(proto)) {
+  auto& layout = _::getStructLayout(schema);
+  auto& fieldLayout = layout.fields[field.getIndex()];
+  if (fieldLayout.discriminantValue != schema::Field::NO_DISCRIMINANT) {
     builder.setDataField<uint16_t>(
-        schema.getProto().getStruct().getDiscriminantOffset() * ELEMENTS,
-        proto.getDiscriminantValue());
+        layout.discriminantOffset * ELEMENTS, fieldLayout.discriminantValue);
   }
 }
 
 DynamicValue::Reader DynamicStruct::Reader::get(StructSchema::Field field) const {
   KJ_REQUIRE(field.getContainingStruct() == schema, "`field` is not a field of this struct.");
-  verifySetInUnion(field);
 
-  auto proto = field.getProto();
-  switch (proto.which()) {
-    case schema::Field::SLOT: {
-      auto slot = proto.getSlot();
-      auto type = slot.getType();
-      auto dval = slot.getDefaultValue();
+  auto& layout = _::getStructLayout(schema);
+  auto& f = layout.fields[field.getIndex()];
+  KJ_REQUIRE(isActiveInUnion(layout, f, reader),
+      "Tried to get() a union member which is not currently initialized.",
+      field.getProto().getName(), schema.getProto().getDisplayName());
 
-      switch (type.which()) {
+  switch (f.kind) {
+    case schema::Field::SLOT: {
+      switch (f.type) {
         case schema::Type::VOID:
-          return reader.getDataField<Void>(slot.getOffset() * ELEMENTS);
+          return reader.getDataField<Void>(f.offset * ELEMENTS);
 
-#define HANDLE_TYPE(discrim, titleCase, type) \
+#define HANDLE_TYPE(discrim, type) \
         case schema::Type::discrim: \
           return reader.getDataField<type>( \
-              slot.getOffset() * ELEMENTS, \
-              bitCast<_::Mask<type>>(dval.get##titleCase()));
-
-        HANDLE_TYPE(BOOL, Bool, bool)
-        HANDLE_TYPE(INT8, Int8, int8_t)
-        HANDLE_TYPE(INT16, Int16, int16_t)
-        HANDLE_TYPE(INT32, Int32, int32_t)
-        HANDLE_TYPE(INT64, Int64, int64_t)
-        HANDLE_TYPE(UINT8, Uint8, uint8_t)
-        HANDLE_TYPE(UINT16, Uint16, uint16_t)
-        HANDLE_TYPE(UINT32, Uint32, uint32_t)
-        HANDLE_TYPE(UINT64, Uint64, uint64_t)
-        HANDLE_TYPE(FLOAT32, Float32, float)
-        HANDLE_TYPE(FLOAT64, Float64, double)
+              f.offset * ELEMENTS, static_cast<_::Mask<type>>(f.defaultBits));
+
+        HANDLE_TYPE(BOOL, bool)
+        HANDLE_TYPE(INT8, int8_t)
+        HANDLE_TYPE(INT16, int16_t)
+        HANDLE_TYPE(INT32, int32_t)
+        HANDLE_TYPE(INT64, int64_t)
+        HANDLE_TYPE(UINT8, uint8_t)
+        HANDLE_TYPE(UINT16, uint16_t)
+        HANDLE_TYPE(UINT32, uint32_t)
+        HANDLE_TYPE(UINT64, uint64_t)
+        HANDLE_TYPE(FLOAT32, float)
+        HANDLE_TYPE(FLOAT64, double)
 
 #undef HANDLE_TYPE
 
-        case schema::Type::ENUM: {
-          uint16_t typedDval;
-          typedDval = dval.getEnum();
+        case schema::Type::ENUM:
           return DynamicEnum(
-              field.getContainingStruct().getDependency(type.getEnum().getTypeId()).asEnum(),
-              reader.getDataField<uint16_t>(slot.getOffset() * ELEMENTS, typedDval));
-        }
+              schema.getDependency(f.typeId).asEnum(),
+              reader.getDataField<uint16_t>(f.offset * ELEMENTS, f.defaultBits));
 
-        case schema::Type::TEXT: {
-          Text::Reader typedDval = dval.getText();
-          return reader.getPointerField(slot.getOffset() * POINTERS)
-                       .getBlob<Text>(typedDval.begin(), typedDval.size() * BYTES);
-        }
+        case schema::Type::TEXT:
+          return reader.getPointerField(f.offset * POINTERS)
+                       .getBlob<Text>(f.defaultBlob.begin(), f.defaultBlob.size() * BYTES);
 
-        case schema::Type::DATA: {
-          Data::Reader typedDval = dval.getData();
-          return reader.getPointerField(slot.getOffset() * POINTERS)
-                       .getBlob<Data>(typedDval.begin(), typedDval.size() * BYTES);
-        }
+        case schema::Type::DATA:
+          return reader.getPointerField(f.offset * POINTERS)
+                       .getBlob<Data>(f.defaultBlob.begin(), f.defaultBlob.size() * BYTES);
 
         case schema::Type::LIST: {
-          auto elementType = type.getList().getElementType();
+          auto elementType = field.getProto().getSlot().getType().getList().getElementType();
           return DynamicList::Reader(
-              ListSchema::of(elementType, field.getContainingStruct()),
-              reader.getPointerField(slot.getOffset() * POINTERS)
-                    .getList(elementSizeFor(elementType.which()),
-                             dval.getList().getAs<_::UncheckedMessage>()));
+              ListSchema::of(elementType, schema),
+              reader.getPointerField(f.offset * POINTERS)
+                    .getList(elementSizeFor(elementType.which()), f.defaultPointer));
         }
 
         case schema::Type::STRUCT:
           return DynamicStruct::Reader(
-              field.getContainingStruct().getDependency(type.getStruct().getTypeId()).asStruct(),
-              reader.getPointerField(slot.getOffset() * POINTERS)
-                    .getStruct(dval.getStruct().getAs<_::UncheckedMessage>()));
+              schema.getDependency(f.typeId).asStruct(),
+              reader.getPointerField(f.offset * POINTERS).getStruct(f.defaultPointer));
 
         case schema::Type::ANY_POINTER:
-          return AnyPointer::Reader(reader.getPointerField(slot.getOffset() * POINTERS));
+          return AnyPointer::Reader(reader.getPointerField(f.offset * POINTERS));
 
         case schema::Type::INTERFACE:
           return DynamicCapability::Client(
-              field.getContainingStruct().getDependency(
-                  type.getInterface().getTypeId()).asInterface(),
-              reader.getPointerField(slot.getOffset() * POINTERS).getCapability());
+              schema.getDependency(f.typeId).asInterface(),
+              reader.getPointerField(f.offset * POINTERS).getCapability());
       }
 
       KJ_UNREACHABLE;
     }
 
     case schema::Field::GROUP:
-      return DynamicStruct::Reader(
-          schema.getDependency(proto.getGroup().getTypeId()).asStruct(), reader);
+      return DynamicStruct::Reader(schema.getDependency(f.typeId).asStruct(), reader);
   }
 
   KJ_UNREACHABLE;
@@ -266,100 +405,87 @@ DynamicValue::Reader DynamicStruct::Reader::get(StructSchema::Field field) const
 
 DynamicValue::Builder DynamicStruct::Builder::get(StructSchema::Field field) {
   KJ_REQUIRE(field.getContainingStruct() == schema, "`field` is not a field of this struct.");
-  verifySetInUnion(field);
 
-  auto proto = field.getProto();
-  switch (proto.which()) {
-    case schema::Field::SLOT: {
-      auto slot = proto.getSlot();
-      auto type = slot.getType();
-      auto dval = slot.getDefaultValue();
+  auto& layout = _::getStructLayout(schema);
+  auto& f = layout.fields[field.getIndex()];
+  KJ_REQUIRE(isActiveInUnion(layout, f, builder),
+      "Tried to get() a union member which is not currently initialized.",
+      field.getProto().getName(), schema.getProto().getDisplayName());
 
-      switch (type.which()) {
+  switch (f.kind) {
+    case schema::Field::SLOT: {
+      switch (f.type) {
         case schema::Type::VOID:
-          return builder.getDataField<Void>(slot.getOffset() * ELEMENTS);
+          return builder.getDataField<Void>(f.offset * ELEMENTS);
 
-#define HANDLE_TYPE(discrim, titleCase, type) \
+#define HANDLE_TYPE(discrim, type) \
         case schema::Type::discrim: \
           return builder.getDataField<type>( \
-              slot.getOffset() * ELEMENTS, \
-              bitCast<_::Mask<type>>(dval.get##titleCase()));
-
-        HANDLE_TYPE(BOOL, Bool, bool)
-        HANDLE_TYPE(INT8, Int8, int8_t)
-        HANDLE_TYPE(INT16, Int16, int16_t)
-        HANDLE_TYPE(INT32, Int32, int32_t)
-        HANDLE_TYPE(INT64, Int64, int64_t)
-        HANDLE_TYPE(UINT8, Uint8, uint8_t)
-        HANDLE_TYPE(UINT16, Uint16, uint16_t)
-        HANDLE_TYPE(UINT32, Uint32, uint32_t)
-        HANDLE_TYPE(UINT64, Uint64, uint64_t)
-        HANDLE_TYPE(FLOAT32, Float32, float)
-        HANDLE_TYPE(FLOAT64, Float64, double)
+              f.offset * ELEMENTS, static_cast<_::Mask<type>>(f.defaultBits));
+
+        HANDLE_TYPE(BOOL, bool)
+        HANDLE_TYPE(INT8, int8_t)
+        HANDLE_TYPE(INT16, int16_t)
+        HANDLE_TYPE(INT32, int32_t)
+        HANDLE_TYPE(INT64, int64_t)
+        HANDLE_TYPE(UINT8, uint8_t)
+        HANDLE_TYPE(UINT16, uint16_t)
+        HANDLE_TYPE(UINT32, uint32_t)
+        HANDLE_TYPE(UINT64, uint64_t)
+        HANDLE_TYPE(FLOAT32, float)
+        HANDLE_TYPE(FLOAT64, double)
 
 #undef HANDLE_TYPE
 
-        case schema::Type::ENUM: {
-          uint16_t typedDval;
-          typedDval = dval.getEnum();
+        case schema::Type::ENUM:
           return DynamicEnum(
-              field.getContainingStruct().getDependency(type.getEnum().getTypeId()).asEnum(),
-              builder.getDataField<uint16_t>(slot.getOffset() * ELEMENTS, typedDval));
-        }
+              schema.getDependency(f.typeId).asEnum(),
+              builder.getDataField<uint16_t>(f.offset * ELEMENTS, f.defaultBits));
 
-        case schema::Type::TEXT: {
-          Text::Reader typedDval = dval.getText();
-          return builder.getPointerField(slot.getOffset() * POINTERS)
-                        .getBlob<Text>(typedDval.begin(), typedDval.size() * BYTES);
-        }
+        case schema::Type::TEXT:
+          return builder.getPointerField(f.offset * POINTERS)
+                        .getBlob<Text>(f.defaultBlob.begin(), f.defaultBlob.size() * BYTES);
 
-        case schema::Type::DATA: {
-          Data::Reader typedDval = dval.getData();
-          return builder.getPointerField(slot.getOffset() * POINTERS)
-                        .getBlob<Data>(typedDval.begin(), typedDval.size() * BYTES);
-        }
+        case schema::Type::DATA:
+          return builder.getPointerField(f.offset * POINTERS)
+                        .getBlob<Data>(f.defaultBlob.begin(), f.defaultBlob.size() * BYTES);
 
         case schema::Type::LIST: {
-          ListSchema listType = ListSchema::of(type.getList().getElementType(),
-                                               field.getContainingStruct());
+          ListSchema listType = ListSchema::of(
+              field.getProto().getSlot().getType().getList().getElementType(), schema);
           if (listType.whichElementType() == schema::Type::STRUCT) {
             return DynamicList::Builder(listType,
-                builder.getPointerField(slot.getOffset() * POINTERS)
+                builder.getPointerField(f.offset * POINTERS)
                        .getStructList(structSizeFromSchema(listType.getStructElementType()),
-                                      dval.getList().getAs<_::UncheckedMessage>()));
+                                      f.defaultPointer));
           } else {
             return DynamicList::Builder(listType,
-                builder.getPointerField(slot.getOffset() * POINTERS)
-                       .getList(elementSizeFor(listType.whichElementType()),
-                                dval.getList().getAs<_::UncheckedMessage>()));
+                builder.getPointerField(f.offset * POINTERS)
+                       .getList(elementSizeFor(listType.whichElementType()), f.defaultPointer));
           }
         }
 
         case schema::Type::STRUCT: {
-          auto structSchema =
-              field.getContainingStruct().getDependency(type.getStruct().getTypeId()).asStruct();
+          auto structSchema = schema.getDependency(f.typeId).asStruct();
           return DynamicStruct::Builder(structSchema,
-              builder.getPointerField(slot.getOffset() * POINTERS)
-                     .getStruct(structSizeFromSchema(structSchema),
-                                dval.getStruct().getAs<_::UncheckedMessage>()));
+              builder.getPointerField(f.offset * POINTERS)
+                     .getStruct(structSizeFromSchema(structSchema), f.defaultPointer));
         }
 
         case schema::Type::ANY_POINTER:
-          return AnyPointer::Builder(builder.getPointerField(slot.getOffset() * POINTERS));
+          return AnyPointer::Builder(builder.getPointerField(f.offset * POINTERS));
 
         case schema::Type::INTERFACE:
           return DynamicCapability::Client(
-              field.getContainingStruct().getDependency(
-                  type.getInterface().getTypeId()).asInterface(),
-              builder.getPointerField(slot.getOffset() * POINTERS).getCapability());
+              schema.getDependency(f.typeId).asInterface(),
+              builder.getPointerField(f.offset * POINTERS).getCapability());
       }
 
       KJ_UNREACHABLE;
     }
 
     case schema::Field::GROUP:
-      return DynamicStruct::Builder(
-          schema.getDependency(proto.getGroup().getTypeId()).asStruct(), builder);
+      return DynamicStruct::Builder(schema.getDependency(f.typeId).asStruct(), builder);
   }
 
   KJ_UNREACHABLE;
@@ -406,17 +532,14 @@ DynamicValue::Pipeline DynamicStruct::Pipeline::get(StructSchema::Field field) {
 bool DynamicStruct::Reader::has(StructSchema::Field field) const {
   KJ_REQUIRE(field.getContainingStruct() == schema, "`field` is not a field of this struct.");
 
-  auto proto = field.getProto();
-  if (hasDiscriminantValue(proto)) {
-    uint16_t discrim = reader.getDataField<uint16_t>(
-        schema.getProto().getStruct().getDiscriminantOffset() * ELEMENTS);
-    if (discrim != proto.getDiscriminantValue()) {
-      // Field is not active in the union.
-      return false;
-    }
+  auto& layout = _::getStructLayout(schema);
+  auto& f = layout.fields[field.getIndex()];
+  if (!isActiveInUnion(layout, f, reader)) {
+    // Field is not active in the union.
+    return false;
   }
 
-  switch (proto.which()) {
+  switch (f.kind) {
     case schema::Field::SLOT:
       // Continue to below.
       break;
@@ -425,10 +548,7 @@ bool DynamicStruct::Reader::has(StructSchema::Field field) const {
       return true;
   }
 
-  auto slot = proto.getSlot();
-  auto type = slot.getType();
-
-  switch (type.which()) {
+  switch (f.type) {
     case schema::Type::VOID:
     case schema::Type::BOOL:
     case schema::Type::INT8:
@@ -451,7 +571,7 @@ bool DynamicStruct::Reader::has(StructSchema::Field field) const {
     case schema::Type::STRUCT:
     case schema::Type::ANY_POINTER:
     case schema::Type::INTERFACE:
-      return !reader.getPointerField(slot.getOffset() * POINTERS).isNull();
+      return !reader.getPointerField(f.offset * POINTERS).isNull();
   }
 
   // Unknown type.  As far as we know, it isn't set.
@@ -459,66 +579,65 @@ bool DynamicStruct::Reader::has(StructSchema::Field field) const {
 }
 
 kj::Maybe<StructSchema::Field> DynamicStruct::Reader::which() const {
-  auto structProto = schema.getProto().getStruct();
-  if (structProto.getDiscriminantCount() == 0) {
+  auto& layout = _::getStructLayout(schema);
+  if (layout.discriminantCount == 0) {
     return nullptr;
   }
 
-  uint16_t discrim = reader.getDataField<uint16_t>(structProto.getDiscriminantOffset() * ELEMENTS);
+  uint16_t discrim = reader.getDataField<uint16_t>(layout.discriminantOffset * ELEMENTS);
   return schema.getFieldByDiscriminant(discrim);
 }
 
 kj::Maybe<StructSchema::Field> DynamicStruct::Builder::which() {
-  auto structProto = schema.getProto().getStruct();
-  if (structProto.getDiscriminantCount() == 0) {
+  auto& layout = _::getStructLayout(schema);
+  if (layout.discriminantCount == 0) {
     return nullptr;
   }
 
-  uint16_t discrim = builder.getDataField<uint16_t>(structProto.getDiscriminantOffset() * ELEMENTS);
+  uint16_t discrim = builder.getDataField<uint16_t>(layout.discriminantOffset * ELEMENTS);
   return schema.getFieldByDiscriminant(discrim);
 }
 
 void DynamicStruct::Builder::set(StructSchema::Field field, const DynamicValue::Reader& value) {
   KJ_REQUIRE(field.getContainingStruct() == schema, "`field` is not a field of this struct.");
-  setInUnion(field);
 
-  auto proto = field.getProto();
-  switch (proto.which()) {
-    case schema::Field::SLOT: {
-      auto slot = proto.getSlot();
-      auto type = slot.getType();
-      auto dval = slot.getDefaultValue();
+  auto& layout = _::getStructLayout(schema);
+  auto& f = layout.fields[field.getIndex()];
+  if (f.discriminantValue != schema::Field::NO_DISCRIMINANT) {
+    builder.setDataField<uint16_t>(layout.discriminantOffset * ELEMENTS, f.discriminantValue);
+  }
 
-      switch (type.which()) {
+  switch (f.kind) {
+    case schema::Field::SLOT: {
+      switch (f.type) {
         case schema::Type::VOID:
-          builder.setDataField<Void>(slot.getOffset() * ELEMENTS, value.as<Void>());
+          builder.setDataField<Void>(f.offset * ELEMENTS, value.as<Void>());
           return;
 
-#define HANDLE_TYPE(discrim, titleCase, type) \
+#define HANDLE_TYPE(discrim, type) \
         case schema::Type::discrim: \
           builder.setDataField<type>( \
-              slot.getOffset() * ELEMENTS, value.as<type>(), \
-              bitCast<_::Mask<type> >(dval.get##titleCase())); \
+              f.offset * ELEMENTS, value.as<type>(), \
+              static_cast<_::Mask<type> >(f.defaultBits)); \
           return;
 
-        HANDLE_TYPE(BOOL, Bool, bool)
-        HANDLE_TYPE(INT8, Int8, int8_t)
-        HANDLE_TYPE(INT16, Int16, int16_t)
-        HANDLE_TYPE(INT32, Int32, int32_t)
-        HANDLE_TYPE(INT64, Int64, int64_t)
-        HANDLE_TYPE(UINT8, Uint8, uint8_t)
-        HANDLE_TYPE(UINT16, Uint16, uint16_t)
-        HANDLE_TYPE(UINT32, Uint32, uint32_t)
-        HANDLE_TYPE(UINT64, Uint64, uint64_t)
-        HANDLE_TYPE(FLOAT32, Float32, float)
-        HANDLE_TYPE(FLOAT64, Float64, double)
+        HANDLE_TYPE(BOOL, bool)
+        HANDLE_TYPE(INT8, int8_t)
+        HANDLE_TYPE(INT16, int16_t)
+        HANDLE_TYPE(INT32, int32_t)
+        HANDLE_TYPE(INT64, int64_t)
+        HANDLE_TYPE(UINT8, uint8_t)
+        HANDLE_TYPE(UINT16, uint16_t)
+        HANDLE_TYPE(UINT32, uint32_t)
+        HANDLE_TYPE(UINT64, uint64_t)
+        HANDLE_TYPE(FLOAT32, float)
+        HANDLE_TYPE(FLOAT64, double)
 
 #undef HANDLE_TYPE
 
         case schema::Type::ENUM: {
           uint16_t rawValue;
-          auto enumSchema = field.getContainingStruct()
-              .getDependency(type.getEnum().getTypeId()).asEnum();
+          auto enumSchema = schema.getDependency(f.typeId).asEnum();
           if (value.getType() == DynamicValue::TEXT) {
             // Convert from text.
             rawValue = enumSchema.getEnumerantByName(value.as<Text>()).getOrdinal();
@@ -531,51 +650,51 @@ void DynamicStruct::Builder::set(StructSchema::Field field, const DynamicValue::
             }
             rawValue = enumValue.getRaw();
           }
-          builder.setDataField<uint16_t>(slot.getOffset() * ELEMENTS, rawValue,
-                                         dval.getEnum());
+          builder.setDataField<uint16_t>(f.offset * ELEMENTS, rawValue, f.defaultBits);
           return;
         }
 
         case schema::Type::TEXT:
-          builder.getPointerField(slot.getOffset() * POINTERS).setBlob<Text>(value.as<Text>());
+          builder.getPointerField(f.offset * POINTERS).setBlob<Text>(value.as<Text>());
           return;
 
         case schema::Type::DATA:
-          builder.getPointerField(slot.getOffset() * POINTERS).setBlob<Data>(value.as<Data>());
+          builder.getPointerField(f.offset * POINTERS).setBlob<Data>(value.as<Data>());
           return;
 
         case schema::Type::LIST: {
-          ListSchema listType = ListSchema::of(type.getList().getElementType(), schema);
+          ListSchema listType = ListSchema::of(
+              field.getProto().getSlot().getType().getList().getElementType(), schema);
           auto listValue = value.as<DynamicList>();
           KJ_REQUIRE(listValue.getSchema() == listType, "Value type mismatch.") {
             return;
           }
-          builder.getPointerField(slot.getOffset() * POINTERS).setList(listValue.reader);
+          builder.getPointerField(f.offset * POINTERS).setList(listValue.reader);
           return;
         }
 
         case schema::Type::STRUCT: {
-          auto structType = schema.getDependency(type.getStruct().getTypeId()).asStruct();
+          auto structType = schema.getDependency(f.typeId).asStruct();
           auto structValue = value.as<DynamicStruct>();
           KJ_REQUIRE(structValue.getSchema() == structType, "Value type mismatch.") {
             return;
           }
-          builder.getPointerField(slot.getOffset() * POINTERS).setStruct(structValue.reader);
+          builder.getPointerField(f.offset * POINTERS).setStruct(structValue.reader);
           return;
         }
 
         case schema::Type::ANY_POINTER:
-          AnyPointer::Builder(builder.getPointerField(slot.getOffset() * POINTERS))
+          AnyPointer::Builder(builder.getPointerField(f.offset * POINTERS))
                  .set(value.as<AnyPointer>());
           return;
 
         case schema::Type::INTERFACE:
-          auto interfaceType = schema.getDependency(type.getInterface().getTypeId()).asInterface();
+          auto interfaceType = schema.getDependency(f.typeId).asInterface();
           auto capability = value.as<DynamicCapability>();
           KJ_REQUIRE(capability.getSchema().extends(interfaceType), "Value type mismatch.") {
             return;
           }
-          builder.getPointerField(slot.getOffset() * POINTERS).setCapability(
+          builder.getPointerField(f.offset * POINTERS).setCapability(
               kj::mv(capability.hook));
           return;
       }
@@ -858,20 +977,17 @@ void DynamicStruct::Builder::clear(StructSchema::Field field) {
   KJ_REQUIRE(field.getContainingStruct() == schema, "`field` is not a field of this struct.");
   setInUnion(field);
 
-  auto proto = field.getProto();
-  switch (proto.which()) {
+  auto& f = _::getStructLayout(schema).fields[field.getIndex()];
+  switch (f.kind) {
     case schema::Field::SLOT: {
-      auto slot = proto.getSlot();
-      auto type = slot.getType();
-
-      switch (type.which()) {
+      switch (f.type) {
         case schema::Type::VOID:
-          builder.setDataField<Void>(slot.getOffset() * ELEMENTS, VOID);
+          builder.setDataField<Void>(f.offset * ELEMENTS, VOID);
           return;
 
 #define HANDLE_TYPE(discrim, type) \
         case schema::Type::discrim: \
-          builder.setDataField<type>(slot.getOffset() * ELEMENTS, 0); \
+          builder.setDataField<type>(f.offset * ELEMENTS, 0); \
           return;
 
         HANDLE_TYPE(BOOL, bool)
@@ -895,7 +1011,7 @@ void DynamicStruct::Builder::clear(StructSchema::Field field) {
         case schema::Type::STRUCT:
         case schema::Type::ANY_POINTER:
         case schema::Type::INTERFACE:
-          builder.getPointerField(slot.getOffset() * POINTERS).clear();
+          builder.getPointerField(f.offset * POINTERS).clear();
           return;
       }
 
@@ -903,8 +1019,7 @@ void DynamicStruct::Builder::clear(StructSchema::Field field) {
     }
 
     case schema::Field::GROUP: {
-      DynamicStruct::Builder group(
-          schema.getDependency(proto.getGroup().getTypeId()).asStruct(), builder);
+      DynamicStruct::Builder group(schema.getDependency(f.typeId).asStruct(), builder);
 
       // We clear the union field with discriminant 0 rather than the one that is set because
       // we want the union to end up with its default field active.
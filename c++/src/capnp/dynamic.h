@@ -400,7 +400,7 @@ public:
   void adopt(uint index, Orphan<DynamicValue>&& orphan);
   Orphan<DynamicValue> disown(uint index);
 
-  typedef _::IndexingIterator<Builder, DynamicStruct::Builder> Iterator;
+  typedef _::IndexingIterator<Builder, DynamicValue::Builder> Iterator;
   inline Iterator begin() { return Iterator(this, 0); }
   inline Iterator end() { return Iterator(this, size()); }
 
@@ -1067,6 +1067,9 @@ struct PointerHelpers<DynamicStruct, Kind::UNKNOWN> {
   static inline Orphan<DynamicStruct> disown(PointerBuilder builder, StructSchema schema) {
     return Orphan<DynamicStruct>(schema, builder.disown());
   }
+  static inline StructReader getInternalReader(const DynamicStruct::Reader& reader) {
+    return reader.reader;
+  }
 };
 
 template <>
@@ -0,0 +1,214 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Benchmarks for the layout primitives behind generated accessors, and for packing.  Run them
+// with the capnp-bench program.
+
+#include "message.h"
+#include "serialize-packed.h"
+#include <kj/benchmark.h>
+#include <capnp/test.capnp.h>
+
+namespace capnp {
+namespace _ {  // private
+namespace {
+
+using ::capnproto_test::capnp::test::TestAllTypes;
+
+constexpr uint64_t RESET_INTERVAL = 1024;
+// Benchmarks that allocate in a message start a new one this often, so that it doesn't grow
+// without bound.  The reset's cost is amortized into the result.
+
+void initSampleMessage(TestAllTypes::Builder root) {
+  root.setBoolField(true);
+  root.setInt32Field(-12345678);
+  root.setUInt32Field(3456789012u);
+  root.setFloat64Field(-123e45);
+  root.setTextField("foo");
+  root.initStructField().setTextField("nested");
+  auto list = root.initInt32List(16);
+  for (uint i = 0; i < list.size(); i++) {
+    list.set(i, i * 1000);
+  }
+}
+
+KJ_BENCHMARK(StructReader::getDataField) {
+  MallocMessageBuilder message;
+  initSampleMessage(message.initRoot<TestAllTypes>());
+  auto root = message.getRoot<TestAllTypes>().asReader();
+
+  uint32_t sum = 0;
+  for (uint64_t i = 0; i < iterations; i++) {
+    sum += root.getUInt32Field();
+    kj::doNotOptimize(sum);
+  }
+}
+
+KJ_BENCHMARK(StructReader::getPointerField (struct)) {
+  MallocMessageBuilder message;
+  initSampleMessage(message.initRoot<TestAllTypes>());
+  auto root = message.getRoot<TestAllTypes>().asReader();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    kj::doNotOptimize(root.getStructField());
+  }
+}
+
+KJ_BENCHMARK(StructReader::getPointerField (text)) {
+  MallocMessageBuilder message;
+  initSampleMessage(message.initRoot<TestAllTypes>());
+  auto root = message.getRoot<TestAllTypes>().asReader();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    kj::doNotOptimize(root.getTextField());
+  }
+}
+
+KJ_BENCHMARK(StructBuilder::setDataField) {
+  MallocMessageBuilder message;
+  auto root = message.initRoot<TestAllTypes>();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    root.setInt32Field(i);
+    kj::doNotOptimize(root);
+  }
+}
+
+KJ_BENCHMARK(PointerBuilder::initStruct) {
+  MallocMessageBuilder message;
+  auto root = message.initRoot<TestAllTypes>();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    if (i % RESET_INTERVAL == 0) {
+      message.reset();
+      root = message.initRoot<TestAllTypes>();
+    }
+    kj::doNotOptimize(root.initStructField());
+  }
+}
+
+KJ_BENCHMARK(PointerBuilder::setBlob) {
+  MallocMessageBuilder message;
+  auto root = message.initRoot<TestAllTypes>();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    if (i % RESET_INTERVAL == 0) {
+      message.reset();
+      root = message.initRoot<TestAllTypes>();
+    }
+    root.setTextField("hello, world");
+  }
+}
+
+KJ_BENCHMARK(writePackedMessage) {
+  MallocMessageBuilder message;
+  initSampleMessage(message.initRoot<TestAllTypes>());
+  byte buffer[4096];
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    kj::ArrayOutputStream output(kj::arrayPtr(buffer, sizeof(buffer)));
+    writePackedMessage(output, message);
+    kj::doNotOptimize(buffer);
+  }
+}
+
+KJ_BENCHMARK(PackedMessageReader) {
+  MallocMessageBuilder message;
+  initSampleMessage(message.initRoot<TestAllTypes>());
+  byte buffer[4096];
+  kj::ArrayOutputStream output(kj::arrayPtr(buffer, sizeof(buffer)));
+  writePackedMessage(output, message);
+  auto packed = output.getArray();
+  word scratch[1024];
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    kj::ArrayInputStream input(packed);
+    PackedMessageReader reader(input, ReaderOptions(), kj::arrayPtr(scratch, 1024));
+    kj::doNotOptimize(reader.getRoot<TestAllTypes>().getUInt32Field());
+  }
+}
+
+constexpr uint PACKING_BLOCK_WORDS = 8192;
+
+kj::Array<word> packingInput() {
+  // Words shaped like typical message content:  small integers and pointers (mostly zero bytes),
+  // runs of zero words, and dense text.
+  auto result = kj::heapArray<word>(PACKING_BLOCK_WORDS);
+  auto bytes = kj::arrayPtr(reinterpret_cast<byte*>(result.begin()), result.size() * sizeof(word));
+  memset(bytes.begin(), 0, bytes.size());
+  for (uint i = 0; i < PACKING_BLOCK_WORDS; i++) {
+    byte* w = bytes.begin() + i * sizeof(word);
+    switch (i % 16) {
+      case 0: case 1: case 2: case 3:
+        break;
+      case 4: case 5: case 6:
+        for (uint j = 0; j < sizeof(word); j++) w[j] = 'a' + (i + j) % 26;
+        break;
+      default:
+        w[0] = i;
+        w[4] = i >> 8;
+        break;
+    }
+  }
+  return result;
+}
+
+KJ_BENCHMARK(pack (per word)) {
+  // PackedOutputStream alone, without message framing.  Whole blocks are packed at a time, so
+  // `iterations` is rounded up to a multiple of the block size.
+  auto input = packingInput();
+  auto buffer = kj::heapArray<byte>(input.size() * sizeof(word) * 2);
+  kj::Benchmark::resetTimer();
+
+  for (uint64_t done = 0; done < iterations; done += PACKING_BLOCK_WORDS) {
+    kj::ArrayOutputStream output(buffer);
+    PackedOutputStream packed(output);
+    packed.write(input.begin(), input.size() * sizeof(word));
+    kj::doNotOptimize(buffer[0]);
+  }
+}
+
+KJ_BENCHMARK(unpack (per word)) {
+  // PackedInputStream alone; see "pack (per word)".
+  auto input = packingInput();
+  auto buffer = kj::heapArray<byte>(input.size() * sizeof(word) * 2);
+  kj::ArrayOutputStream output(buffer);
+  {
+    PackedOutputStream packed(output);
+    packed.write(input.begin(), input.size() * sizeof(word));
+  }
+  auto packedBytes = output.getArray();
+  auto unpacked = kj::heapArray<word>(input.size());
+  kj::Benchmark::resetTimer();
+
+  for (uint64_t done = 0; done < iterations; done += PACKING_BLOCK_WORDS) {
+    kj::ArrayInputStream packedInput(packedBytes);
+    PackedInputStream packed(packedInput);
+    packed.read(unpacked.begin(), unpacked.size() * sizeof(word));
+    kj::doNotOptimize(unpacked[0]);
+  }
+}
+
+}  // namespace
+}  // namespace _ (private)
+}  // namespace capnp
@@ -1374,6 +1374,187 @@ TEST(Encoding, StructSetters) {
   }
 }
 
+TEST(Encoding, CopyFrom) {
+  MallocMessageBuilder builder;
+  auto root = builder.getRoot<TestAllTypes>();
+  initTestMessage(root);
+
+  MallocMessageBuilder builder2;
+  auto root2 = builder2.initRoot<TestAllTypes>();
+  root2.copyFrom(root);
+  checkTestMessage(root2);
+
+  // Copying over existing content replaces it.
+  root2.copyFrom(root);
+  checkTestMessage(root2);
+
+  // Copying onto itself leaves the content alone.
+  root2.copyFrom(root2);
+  checkTestMessage(root2);
+
+  // Null pointers in the source clear the target.
+  MallocMessageBuilder empty;
+  root2.copyFrom(empty.initRoot<TestAllTypes>());
+  EXPECT_FALSE(root2.hasTextField());
+  EXPECT_FALSE(root2.hasStructField());
+  EXPECT_FALSE(root2.hasInt32List());
+  EXPECT_EQ(0, root2.getInt32Field());
+}
+
+TEST(Encoding, CopyFromUnion) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<test::TestStructUnion>();
+  root.getUn().initStruct().setSomeText("foo");
+
+  MallocMessageBuilder builder2;
+  auto root2 = builder2.initRoot<test::TestStructUnion>();
+  root2.getUn().initObject();
+  root2.copyFrom(root);
+  ASSERT_EQ(test::TestStructUnion::Un::STRUCT, root2.getUn().which());
+  EXPECT_EQ("foo", root2.getUn().getStruct().getSomeText());
+}
+
+TEST(Encoding, CopyFromOtherVersion) {
+  // Structs written with a newer version of the schema must not lose fields when copied.
+
+  MallocMessageBuilder newBuilder;
+  auto newVersion = newBuilder.initRoot<test::TestNewVersion>();
+  newVersion.setOld1(123);
+  newVersion.setNew1(456);
+  newVersion.initOld3().setNew2("bar");
+
+  // The root has the old layout but its old3 field points at a new-version struct.
+  MallocMessageBuilder mixedBuilder;
+  auto mixed = mixedBuilder.initRoot<test::TestOldVersion>();
+  mixed.setOld1(321);
+  mixed.setOld3(newBuilder.getRoot<test::TestOldVersion>());
+
+  MallocMessageBuilder builder;
+  builder.initRoot<test::TestOldVersion>().copyFrom(mixed);
+  auto copy = builder.getRoot<test::TestNewVersion>();
+  EXPECT_EQ(321, copy.getOld1());
+  EXPECT_EQ(456, copy.getOld3().getNew1());
+  EXPECT_EQ("bar", copy.getOld3().getOld3().getNew2());
+
+  // Copying the new-version root itself into an old-version builder keeps what fits.
+  MallocMessageBuilder builder2;
+  auto old = builder2.initRoot<test::TestOldVersion>();
+  old.copyFrom(newBuilder.getRoot<test::TestOldVersion>());
+  EXPECT_EQ(123, old.getOld1());
+  EXPECT_EQ("bar", builder2.getRoot<test::TestNewVersion>().getOld3().getNew2());
+}
+
+TEST(Encoding, PresenceMask) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<TestAllTypes>();
+  auto schema = Schema::from<TestAllTypes>();
+
+  // Only the two Void fields count as present in an empty struct.
+  EXPECT_EQ(2u, root.asReader().presenceMask().count());
+  EXPECT_TRUE(root.asReader().presenceMask().has(schema.getFieldByName("voidField").getIndex()));
+
+  // initTestMessage() sets everything but interfaceList.
+  initTestMessage(root);
+  auto mask = root.asReader().presenceMask();
+  EXPECT_EQ(schema.getFields().size() - 1, mask.count());
+  EXPECT_FALSE(mask.has(schema.getFieldByName("interfaceList").getIndex()));
+
+  root.setInt32Field(0);
+  root.disownTextField();
+  root.disownStructList();
+  mask = root.asReader().presenceMask();
+  EXPECT_EQ(schema.getFields().size() - 4, mask.count());
+  EXPECT_FALSE(mask.has(schema.getFieldByName("int32Field").getIndex()));
+  EXPECT_FALSE(mask.has(schema.getFieldByName("textField").getIndex()));
+  EXPECT_FALSE(mask.has(schema.getFieldByName("structList").getIndex()));
+  EXPECT_TRUE(mask.has(schema.getFieldByName("dataField").getIndex()));
+
+  uint seen = 0;
+  mask.forEach([&](uint index) {
+    EXPECT_TRUE(mask.has(index));
+    ++seen;
+  });
+  EXPECT_EQ(mask.count(), seen);
+}
+
+TEST(Encoding, PresenceMaskDefaults) {
+  // Fields are present when they differ from their defaults, even if the default is non-zero.
+
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<test::TestDefaults>();
+  auto schema = Schema::from<test::TestDefaults>();
+
+  EXPECT_EQ(2u, root.asReader().presenceMask().count());  // The two Void fields.
+
+  root.setInt32Field(0);
+  root.setBoolField(false);
+  auto mask = root.asReader().presenceMask();
+  EXPECT_EQ(4u, mask.count());
+  EXPECT_TRUE(mask.has(schema.getFieldByName("int32Field").getIndex()));
+  EXPECT_TRUE(mask.has(schema.getFieldByName("boolField").getIndex()));
+}
+
+TEST(Encoding, PresenceMaskUnion) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<test::TestUnion>();
+  auto union0 = Schema::from<test::TestUnion::Union0>();
+
+  root.getUnion0().setU0f0s32(0);
+  EXPECT_FALSE(root.asReader().getUnion0().presenceMask().any());
+
+  root.getUnion0().setU0f0s32(5);
+  auto mask = root.asReader().getUnion0().presenceMask();
+  EXPECT_EQ(1u, mask.count());
+  EXPECT_TRUE(mask.has(union0.getFieldByName("u0f0s32").getIndex()));
+
+  root.getUnion0().setU0f1sp("foo");
+  mask = root.asReader().getUnion0().presenceMask();
+  EXPECT_EQ(1u, mask.count());
+  EXPECT_TRUE(mask.has(union0.getFieldByName("u0f1sp").getIndex()));
+
+  root.getUnion0().setU0f0s0();
+  mask = root.asReader().getUnion0().presenceMask();
+  EXPECT_EQ(1u, mask.count());
+  EXPECT_TRUE(mask.has(union0.getFieldByName("u0f0s0").getIndex()));
+}
+
+TEST(Encoding, PresenceMaskOldVersion) {
+  // Fields past the end of a struct written with an older schema are absent.
+
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<test::TestOldVersion>();
+  root.setOld1(123);
+  root.setOld2("foo");
+
+  auto schema = Schema::from<test::TestNewVersion>();
+  auto mask = builder.getRoot<test::TestNewVersion>().asReader().presenceMask();
+  EXPECT_EQ(2u, mask.count());
+  EXPECT_TRUE(mask.has(schema.getFieldByName("old1").getIndex()));
+  EXPECT_TRUE(mask.has(schema.getFieldByName("old2").getIndex()));
+}
+
+TEST(Encoding, GetNonNullPointers) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<TestAllTypes>();
+  root.setTextField("foo");
+  root.initInt32List(3);
+
+  auto reader = PointerHelpers<TestAllTypes>::getInternalReader(root.asReader());
+  uint64_t bits[3] = { 123, 456, 789 };
+  reader.getNonNullPointers(kj::arrayPtr(bits, 3));
+
+  uint64_t expected = 0;
+  for (auto field: Schema::from<TestAllTypes>().getFields()) {
+    auto name = field.getProto().getName();
+    if (name == "textField" || name == "int32List") {
+      expected |= uint64_t(1) << field.getProto().getSlot().getOffset();
+    }
+  }
+  EXPECT_EQ(expected, bits[0]);
+  EXPECT_EQ(0u, bits[1]);
+  EXPECT_EQ(0u, bits[2]);
+}
+
 TEST(Encoding, OneBitStructSetters) {
   // Test case of setting a 1-bit struct.
 
@@ -1651,6 +1832,118 @@ TEST(Encoding, HasEmptyStructList) {
   EXPECT_EQ(2, root.totalSize().wordCount);
 }
 
+TEST(Encoding, BulkPrimitiveListAccess) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<test::TestAllTypes>();
+
+  float values[] = {1.5f, -2.25f, 3.0f, 1e30f, 0.0f};
+  auto list = root.initFloat32List(5);
+  list.setFrom(values);
+  EXPECT_EQ(-2.25f, list[1]);
+  EXPECT_EQ(1e30f, list[3]);
+
+  float out[5];
+  root.asReader().getFloat32List().copyTo(out);
+  for (uint i = 0; i < 5; i++) {
+    EXPECT_EQ(values[i], out[i]);
+  }
+  memset(out, 0, sizeof(out));
+  list.copyTo(out);
+  EXPECT_EQ(3.0f, out[2]);
+
+  KJ_IF_MAYBE(view, root.asReader().getFloat32List().asArrayPtr()) {
+    // Wire format is native.
+    ASSERT_EQ(5u, view->size());
+    EXPECT_EQ(1e30f, (*view)[3]);
+  } else {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    ADD_FAILURE() << "Expected a direct view on a little-endian host.";
+#endif
+  }
+  KJ_IF_MAYBE(view, list.asArrayPtr()) {
+    (*view)[4] = 7.0f;
+    EXPECT_EQ(7.0f, list[4]);
+  }
+
+  // Byte lists are always directly viewable, empty lists trivially so.
+  root.initUInt8List(3).setFrom({1, 2, 3});
+  KJ_IF_MAYBE(view, root.asReader().getUInt8List().asArrayPtr()) {
+    EXPECT_EQ(2u, (*view)[1]);
+  } else {
+    ADD_FAILURE() << "Byte lists should always be viewable.";
+  }
+  EXPECT_TRUE(root.asReader().getInt64List().asArrayPtr() != nullptr);
+  root.asReader().getInt64List().copyTo(nullptr);
+
+  // Bool lists are bit-packed, so they can only be copied.
+  bool bits[] = {true, false, false, true, true, false, true, false, true};
+  auto boolList = root.initBoolList(9);
+  boolList.setFrom(bits);
+  EXPECT_TRUE(boolList.asArrayPtr() == nullptr);
+  bool bitsOut[9];
+  root.asReader().getBoolList().copyTo(bitsOut);
+  for (uint i = 0; i < 9; i++) {
+    EXPECT_EQ(bits[i], bitsOut[i]);
+  }
+}
+
+TEST(Encoding, BulkPrimitiveListAccessStrided) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<test::TestAnyPointer>();
+
+  // Reading a List(UInt16) as List(UInt8) yields elements spaced two bytes apart.
+  root.getAnyPointerField().setAs<List<uint16_t>>({12, 34, 56});
+  {
+    auto l = root.asReader().getAnyPointerField().getAs<List<uint8_t>>();
+    EXPECT_TRUE(l.asArrayPtr() == nullptr);
+    uint8_t out[3];
+    l.copyTo(out);
+    EXPECT_EQ(12u, out[0]);
+    EXPECT_EQ(34u, out[1]);
+    EXPECT_EQ(56u, out[2]);
+  }
+
+  // Likewise a struct list read as a list of its first field.
+  {
+    auto structs = root.getAnyPointerField().initAs<List<test::TestLists::Struct32c>>(3);
+    structs[0].setF(123);
+    structs[1].setF(456);
+    structs[2].setF(789);
+
+    auto l = root.getAnyPointerField().getAs<List<uint32_t>>();
+    EXPECT_TRUE(l.asArrayPtr() == nullptr);
+    uint32_t out[3];
+    l.asReader().copyTo(out);
+    EXPECT_EQ(123u, out[0]);
+    EXPECT_EQ(456u, out[1]);
+    EXPECT_EQ(789u, out[2]);
+
+    uint32_t in[3] = {1, 2, 3};
+    l.setFrom(in);
+    EXPECT_EQ(1u, structs[0].getF());
+    EXPECT_EQ(2u, structs[1].getF());
+    EXPECT_EQ(3u, structs[2].getF());
+  }
+}
+
+TEST(Encoding, BulkPrimitiveListAccessSizeMismatch) {
+  // The size check must hold in release builds too, or a short array would be overrun.
+  MallocMessageBuilder builder;
+  auto list = builder.initRoot<test::TestAllTypes>().initInt32List(4);
+
+  int32_t tooShort[3] = {1, 2, 3};
+  int32_t tooLong[5] = {1, 2, 3, 4, 5};
+  EXPECT_ANY_THROW(list.setFrom(tooShort));
+  EXPECT_ANY_THROW(list.setFrom(tooLong));
+  EXPECT_ANY_THROW(list.copyTo(tooShort));
+  EXPECT_ANY_THROW(list.asReader().copyTo(tooShort));
+  EXPECT_ANY_THROW(list.asReader().copyTo(tooLong));
+
+  // Nothing was written.
+  EXPECT_EQ(0, list[0]);
+  EXPECT_EQ(1, tooShort[0]);
+}
+
 }  // namespace
 }  // namespace _ (private)
 }  // namespace capnp
@@ -104,6 +104,24 @@ TEST(Endian, EightBytes) {
   EXPECT_EQ(0x23, bytes[7]);
 }
 
+TEST(Endian, Bulk) {
+  byte bytes[] = {0x12, 0x34, 0x56, 0x78};
+  uint16_t vals[2];
+
+  copyFromWire(vals, reinterpret_cast<WireValue<uint16_t>*>(bytes), 2);
+  uint16_t expected[] = {0x3412, 0x7856};
+  EXPECT_EQ(expected[0], vals[0]);
+  EXPECT_EQ(expected[1], vals[1]);
+
+  vals[0] = 0x2345;
+  vals[1] = 0x6789;
+  copyToWire(reinterpret_cast<WireValue<uint16_t>*>(bytes), vals, 2);
+  byte expectedBytes[] = {0x45, 0x23, 0x89, 0x67};
+  for (uint i = 0; i < 4; i++) {
+    EXPECT_EQ(expectedBytes[i], bytes[i]);
+  }
+}
+
 }  // namespace
 }  // namespace _ (private)
 }  // namespace capnp
@@ -22,8 +22,14 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ez-rpc.h"
+#include "rpc-twoparty.h"
 #include "test-util.h"
+#include <kj/async-io.h>
+#include <kj/async-unix.h>
+#include <kj/vector.h>
 #include <gtest/gtest.h>
+#include <string.h>
+#include <netinet/in.h>
 
 namespace capnp {
 namespace _ {
@@ -53,6 +59,302 @@ TEST(EzRpc, Basic) {
       .getCallSequenceRequest().send().wait(server.getWaitScope()).getN());
 }
 
+TEST(EzRpc, BusyPoll) {
+  EzRpcServer server("localhost");
+  int callCount = 0;
+  server.exportCap("cap1", kj::heap<TestInterfaceImpl>(callCount));
+
+  EzRpcClient client("localhost", server.getPort().wait(server.getWaitScope()));
+
+  // Client and server share this thread's event port.
+  kj::UnixEventPort::BusyPollOptions options;
+  options.spinTime = 1 * kj::MILLISECONDS;
+  options.socketBusyPollMicros = 50;
+  client.getUnixEventPort().setBusyPoll(options);
+  EXPECT_EQ(&client.getUnixEventPort(), &server.getUnixEventPort());
+
+  auto cap = client.importCap<test::TestInterface>("cap1");
+  for (int i = 0; i < 10; i++) {
+    auto request = cap.fooRequest();
+    request.setI(123);
+    request.setJ(true);
+    EXPECT_EQ("foo", request.send().wait(client.getWaitScope()).getX());
+  }
+  EXPECT_EQ(10, callCount);
+}
+
+TEST(EzRpc, MultiThread) {
+  constexpr uint THREAD_COUNT = 4;
+  int callCounts[THREAD_COUNT] = {0, 0, 0, 0};
+  uint setupCount = 0;
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+
+  uint port;
+  {
+    EzRpcMultiThreadServer server(reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr),
+                                  THREAD_COUNT, [&](EzRpcServer& threadServer) {
+      // Calls are serialized, so no need to synchronize setupCount.
+      threadServer.exportCap("cap1", kj::heap<TestInterfaceImpl>(callCounts[setupCount++]));
+    });
+    port = server.getPort();
+    EXPECT_NE(0u, port);
+
+    kj::Vector<kj::Own<EzRpcClient>> clients;
+    for (uint i = 0; i < 8; i++) {
+      clients.add(kj::heap<EzRpcClient>("127.0.0.1", port));
+    }
+
+    kj::Vector<kj::Promise<void>> promises;
+    for (auto& client: clients) {
+      auto request = client->importCap<test::TestInterface>("cap1").fooRequest();
+      request.setI(123);
+      request.setJ(true);
+      promises.add(request.send().then([](Response<test::TestInterface::FooResults>&& response) {
+        EXPECT_EQ("foo", response.getX());
+      }));
+    }
+    for (auto& promise: promises) {
+      promise.wait(clients[0]->getWaitScope());
+    }
+  }
+
+  // The destructor joined all workers, so their counters are now safe to read.
+  EXPECT_EQ(THREAD_COUNT, setupCount);
+  int total = 0;
+  for (int count: callCounts) total += count;
+  EXPECT_EQ(8, total);
+}
+
+class CountingServer final: public SturdyRefRestorer<Text>, private kj::TaskSet::ErrorHandler {
+  // A bare-bones stand-in for EzRpcServer on the loopback interface that counts the connections
+  // it accepts.  Every name restores to a TestInterfaceImpl.
+
+public:
+  CountingServer(kj::AsyncIoProvider& ioProvider, int& callCount, uint port = 0)
+      : callCount(callCount), tasks(*this) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    listener = ioProvider.getNetwork().getSockaddr(&addr, sizeof(addr))->listen();
+    acceptLoop();
+  }
+
+  uint getPort() { return listener->getPort(); }
+
+  uint connectionCount = 0;
+
+  Capability::Client restore(Text::Reader name) override {
+    return kj::heap<TestInterfaceImpl>(callCount);
+  }
+
+private:
+  struct Connection {
+    kj::Own<kj::AsyncIoStream> stream;
+    TwoPartyVatNetwork network;
+    RpcSystem<rpc::twoparty::SturdyRefHostId> rpcSystem;
+
+    Connection(kj::Own<kj::AsyncIoStream>&& stream, SturdyRefRestorer<Text>& restorer)
+        : stream(kj::mv(stream)),
+          network(*this->stream, rpc::twoparty::Side::SERVER),
+          rpcSystem(makeRpcServer(network, restorer)) {}
+  };
+
+  int& callCount;
+  kj::Own<kj::ConnectionReceiver> listener;
+  kj::TaskSet tasks;
+
+  void acceptLoop() {
+    tasks.add(listener->accept().then([this](kj::Own<kj::AsyncIoStream>&& stream) {
+      ++connectionCount;
+      acceptLoop();
+      auto connection = kj::heap<Connection>(kj::mv(stream), *this);
+      tasks.add(connection->network.onDisconnect().attach(kj::mv(connection)));
+    }));
+  }
+
+  void taskFailed(kj::Exception&& exception) override {
+    ADD_FAILURE() << kj::str(exception).cStr();
+  }
+};
+
+kj::String callFoo(EzRpcClient& client, kj::WaitScope& waitScope) {
+  auto request = client.importCap<test::TestInterface>("cap").fooRequest();
+  request.setI(123);
+  request.setJ(true);
+  return kj::heapString(request.send().wait(waitScope).getX());
+}
+
+TEST(EzRpc, Pooled) {
+  // Keeps the thread's event loop, and with it the pool, alive across the short-lived clients.
+  EzRpcServer anchor("127.0.0.1");
+  auto& waitScope = anchor.getWaitScope();
+
+  int callCount = 0;
+  CountingServer server(anchor.getIoProvider(), callCount);
+
+  EzRpcClientOptions options;
+  options.pooled = true;
+
+  for (uint i = 0; i < 5; i++) {
+    EzRpcClient client("127.0.0.1", server.getPort(), options);
+    EXPECT_EQ("foo", callFoo(client, waitScope));
+  }
+  EXPECT_EQ(5, callCount);
+  EXPECT_EQ(1u, server.connectionCount);
+
+  // Unpooled clients, and pooled clients with different options, get their own connections.
+  {
+    EzRpcClient client("127.0.0.1", server.getPort());
+    EXPECT_EQ("foo", callFoo(client, waitScope));
+  }
+  EXPECT_EQ(2u, server.connectionCount);
+
+  options.connectionCount = 2;
+  for (uint i = 0; i < 4; i++) {
+    EzRpcClient client("127.0.0.1", server.getPort(), options);
+    EXPECT_EQ("foo", callFoo(client, waitScope));
+  }
+  EXPECT_EQ(4u, server.connectionCount);
+
+  // Clients given the address as a sockaddr share a connection too, whatever the padding holds.
+  options.connectionCount = 1;
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(server.getPort());
+  {
+    EzRpcClient client(reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr), options);
+    EXPECT_EQ("foo", callFoo(client, waitScope));
+  }
+  memset(addr.sin_zero, 0xff, sizeof(addr.sin_zero));
+  {
+    EzRpcClient client(reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr), options);
+    EXPECT_EQ("foo", callFoo(client, waitScope));
+  }
+  EXPECT_EQ(5u, server.connectionCount);
+  EXPECT_EQ(12, callCount);
+}
+
+TEST(EzRpc, PooledServerRestart) {
+  // Without `reconnect`, a pooled connection that was lost must not be handed out again.
+
+  EzRpcServer anchor("127.0.0.1");
+  auto& waitScope = anchor.getWaitScope();
+
+  int callCount = 0;
+  auto server = kj::heap<CountingServer>(anchor.getIoProvider(), callCount);
+  uint port = server->getPort();
+
+  EzRpcClientOptions options;
+  options.pooled = true;
+  {
+    EzRpcClient client("127.0.0.1", port, options);
+    EXPECT_EQ("foo", callFoo(client, waitScope));
+  }
+
+  server = nullptr;
+  server = kj::heap<CountingServer>(anchor.getIoProvider(), callCount, port);
+
+  // The first client after the restart may still be handed the dead connection, if the loss
+  // hasn't been noticed yet, but later ones get a new connection.
+  bool recovered = false;
+  for (uint i = 0; i < 10 && !recovered; i++) {
+    EzRpcClient client("127.0.0.1", port, options);
+    recovered = kj::runCatchingExceptions([&]() {
+      EXPECT_EQ("foo", callFoo(client, waitScope));
+    }) == nullptr;
+  }
+  EXPECT_TRUE(recovered);
+  EXPECT_EQ(1u, server->connectionCount);
+  EXPECT_EQ(2, callCount);
+}
+
+TEST(EzRpc, MultipleConnections) {
+  EzRpcServer anchor("127.0.0.1");
+  auto& waitScope = anchor.getWaitScope();
+
+  int callCount = 0;
+  CountingServer server(anchor.getIoProvider(), callCount);
+
+  EzRpcClientOptions options;
+  options.connectionCount = 3;
+  EzRpcClient client("127.0.0.1", server.getPort(), options);
+
+  kj::Vector<kj::Promise<void>> promises;
+  for (uint i = 0; i < 6; i++) {
+    auto request = client.importCap<test::TestInterface>("cap").fooRequest();
+    request.setI(123);
+    request.setJ(true);
+    promises.add(request.send().then([](Response<test::TestInterface::FooResults>&& response) {
+      EXPECT_EQ("foo", response.getX());
+    }));
+  }
+  for (auto& promise: promises) {
+    promise.wait(waitScope);
+  }
+
+  EXPECT_EQ(6, callCount);
+  EXPECT_EQ(3u, server.connectionCount);
+}
+
+TEST(EzRpc, Reconnect) {
+  EzRpcServer anchor("127.0.0.1");
+  auto& waitScope = anchor.getWaitScope();
+  auto& timer = anchor.getIoProvider().getTimer();
+
+  int callCount = 0;
+  auto server = kj::heap<CountingServer>(anchor.getIoProvider(), callCount);
+  uint port = server->getPort();
+
+  EzRpcClientOptions options;
+  options.reconnect = true;
+  options.minReconnectDelay = 5 * kj::MILLISECONDS;
+  options.maxReconnectDelay = 20 * kj::MILLISECONDS;
+  EzRpcClient client("127.0.0.1", port, options);
+
+  auto cap = client.importCap<test::TestInterface>("cap");
+  {
+    auto request = cap.fooRequest();
+    request.setI(123);
+    request.setJ(true);
+    EXPECT_EQ("foo", request.send().wait(waitScope).getX());
+  }
+
+  // Take the server down.  The capability imported over the lost connection stays broken.
+  server = nullptr;
+  {
+    auto request = cap.fooRequest();
+    request.setI(123);
+    request.setJ(true);
+    EXPECT_ANY_THROW(request.send().wait(waitScope));
+  }
+
+  // Let a few reconnect attempts fail before bringing the server back up on the same port.
+  timer.afterDelay(30 * kj::MILLISECONDS).wait(waitScope);
+  server = kj::heap<CountingServer>(anchor.getIoProvider(), callCount, port);
+
+  bool recovered = false;
+  for (uint i = 0; i < 100 && !recovered; i++) {
+    recovered = kj::runCatchingExceptions([&]() {
+      EXPECT_EQ("foo", callFoo(client, waitScope));
+    }) == nullptr;
+    if (!recovered) {
+      timer.afterDelay(5 * kj::MILLISECONDS).wait(waitScope);
+    }
+  }
+  EXPECT_TRUE(recovered);
+  EXPECT_EQ(1u, server->connectionCount);
+  EXPECT_EQ(2, callCount);
+}
+
 }  // namespace
 }  // namespace _
 }  // namespace capnp
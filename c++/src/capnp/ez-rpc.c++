@@ -25,13 +25,162 @@
 #include "rpc-twoparty.h"
 #include <capnp/rpc.capnp.h>
 #include <kj/async-io.h>
+#include <kj/async-unix.h>
 #include <kj/debug.h>
+#include <kj/io.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
 #include <map>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 
 namespace capnp {
 
 static __thread EzRpcContext* threadEzContext = nullptr;
 
+class EzRpcClientBackend final: public kj::Refcounted, private kj::TaskSet::ErrorHandler {
+  // The connection(s) behind an EzRpcClient.  Owned by a single client, or shared through the
+  // thread's EzRpcContext when pooled.
+
+public:
+  typedef kj::Function<kj::Promise<kj::Own<kj::NetworkAddress>>()> Resolver;
+
+  EzRpcClientBackend(Resolver resolve, kj::Timer& timer, const EzRpcClientOptions& options)
+      : resolve(kj::mv(resolve)), timer(timer), options(options),
+        connections(kj::heapArray<Connection>(kj::max(options.connectionCount, 1u))),
+        tasks(*this) {
+    for (auto& connection: connections) {
+      connect(connection);
+    }
+  }
+
+  EzRpcClientBackend(kj::Own<kj::AsyncIoStream>&& stream, kj::Timer& timer)
+      : timer(timer), connections(kj::heapArray<Connection>(1)), tasks(*this) {
+    connections[0].client = kj::heap<ClientContext>(kj::mv(stream));
+  }
+
+  Capability::Client restore(kj::StringPtr name) {
+    Connection& connection = connections[next++ % connections.size()];
+
+    KJ_IF_MAYBE(client, connection.client) {
+      return client->get()->restore(name);
+    } else {
+      return connection.ready.addBranch().then(kj::mvCapture(kj::heapString(name),
+          [&connection](kj::String&& name) {
+        return KJ_ASSERT_NONNULL(connection.client)->restore(name);
+      }));
+    }
+  }
+
+  bool isBroken() const {
+    // True if a connection has failed or been lost and won't be re-established.  A broken pooled
+    // backend is replaced the next time a client asks for it.
+
+    for (auto& connection: connections) {
+      if (connection.broken) return true;
+    }
+    return false;
+  }
+
+private:
+  struct ClientContext {
+    kj::Own<kj::AsyncIoStream> stream;
+    TwoPartyVatNetwork network;
+    RpcSystem<rpc::twoparty::SturdyRefHostId> rpcSystem;
+
+    ClientContext(kj::Own<kj::AsyncIoStream>&& stream)
+        : stream(kj::mv(stream)),
+          network(*this->stream, rpc::twoparty::Side::CLIENT),
+          rpcSystem(makeRpcClient(network)) {}
+
+    Capability::Client restore(kj::StringPtr name) {
+      word scratch[64];
+      memset(scratch, 0, sizeof(scratch));
+      MallocMessageBuilder message(scratch);
+      auto root = message.getRoot<rpc::SturdyRef>();
+      auto hostId = root.getHostId().getAs<rpc::twoparty::SturdyRefHostId>();
+      hostId.setSide(rpc::twoparty::Side::SERVER);
+      root.getObjectId().setAs<Text>(name);
+      return rpcSystem.restore(hostId, root.getObjectId());
+    }
+  };
+
+  struct Connection {
+    kj::Maybe<kj::Own<ClientContext>> client;
+    // Filled in before `ready` resolves.
+
+    kj::ForkedPromise<void> ready = nullptr;
+    // The current connection attempt.
+
+    uint failures = 0;
+    // Consecutive failed connection attempts.
+
+    bool broken = false;
+    // Failed or disconnected without `reconnect`.
+  };
+
+  kj::Maybe<Resolver> resolve;
+  kj::Timer& timer;
+  EzRpcClientOptions options;
+  kj::Array<Connection> connections;
+  uint next = 0;
+
+  kj::TaskSet tasks;
+  // Waits for disconnects and reconnect delays.  Declared last so that it is destroyed before the
+  // connections its tasks refer to.
+
+  void connect(Connection& connection) {
+    connection.ready = KJ_ASSERT_NONNULL(resolve)()
+        .then([](kj::Own<kj::NetworkAddress>&& addr) {
+      // connect() may retry the address's other sockaddrs after a failure, so keep it alive.
+      auto promise = addr->connect();
+      return promise.attach(kj::mv(addr));
+    }).then([this,&connection](kj::Own<kj::AsyncIoStream>&& stream) {
+      connection.failures = 0;
+      auto client = kj::heap<ClientContext>(kj::mv(stream));
+      tasks.add(client->network.onDisconnect().then([this,&connection]() {
+        if (options.reconnect) {
+          reconnect(connection);
+        } else {
+          connection.broken = true;
+        }
+      }));
+      connection.client = kj::mv(client);
+    }, [this,&connection](kj::Exception&& exception) {
+      if (options.reconnect) {
+        tasks.add(timer.afterDelay(backoff(++connection.failures)).then([this,&connection]() {
+          connect(connection);
+        }));
+      } else {
+        connection.broken = true;
+      }
+      kj::throwFatalException(kj::mv(exception));
+    }).fork();
+  }
+
+  void reconnect(Connection& connection) {
+    KJ_IF_MAYBE(client, connection.client) {
+      // We may be running inside a callback of the dead connection, so destroy it later.
+      tasks.add(kj::evalLater(kj::mvCapture(*client, [](kj::Own<ClientContext>&&) {})));
+      connection.client = nullptr;
+    }
+    connect(connection);
+  }
+
+  kj::Duration backoff(uint failures) {
+    kj::Duration delay = options.minReconnectDelay;
+    for (uint i = 1; i < failures && delay < options.maxReconnectDelay; i++) {
+      delay = delay * 2;
+    }
+    return kj::min(delay, options.maxReconnectDelay);
+  }
+
+  void taskFailed(kj::Exception&& exception) override {
+    KJ_LOG(ERROR, exception);
+  }
+};
+
 class EzRpcContext: public kj::Refcounted {
 public:
   EzRpcContext(): ioContext(kj::setupAsyncIo()) {
@@ -58,6 +207,10 @@ public:
     return *ioContext.lowLevelProvider;
   }
 
+  kj::UnixEventPort& getUnixEventPort() {
+    return ioContext.unixEventPort;
+  }
+
   static kj::Own<EzRpcContext> getThreadLocal() {
     EzRpcContext* existing = threadEzContext;
     if (existing != nullptr) {
@@ -67,72 +220,117 @@ public:
     }
   }
 
+  kj::Own<EzRpcClientBackend> getClientBackend(
+      kj::StringPtr poolKey, EzRpcClientBackend::Resolver&& resolve,
+      const EzRpcClientOptions& options) {
+    // Returns the pooled backend for `poolKey` (which identifies the server address), creating it
+    // if necessary, or a fresh unshared backend if `options.pooled` is false.
+
+    if (!options.pooled) {
+      return kj::refcounted<EzRpcClientBackend>(kj::mv(resolve), getIoProvider().getTimer(),
+                                                options);
+    }
+
+    auto key = kj::str(poolKey, '/', options.connectionCount, options.reconnect ? "/r" : "");
+    auto iter = clientPool.find(key);
+    if (iter != clientPool.end()) {
+      if (!iter->second.backend->isBroken()) {
+        return kj::addRef(*iter->second.backend);
+      }
+
+      // Its connection is gone for good.  Clients still using it keep it alive; new ones get a
+      // fresh connection.
+      clientPool.erase(iter);
+    }
+
+    PooledBackend entry;
+    entry.key = kj::mv(key);
+    entry.backend = kj::refcounted<EzRpcClientBackend>(
+        kj::mv(resolve), getIoProvider().getTimer(), options);
+    auto result = kj::addRef(*entry.backend);
+    clientPool[entry.key] = kj::mv(entry);
+    return kj::mv(result);
+  }
+
 private:
   kj::AsyncIoContext ioContext;
+
+  struct PooledBackend {
+    kj::String key;
+    kj::Own<EzRpcClientBackend> backend;
+  };
+
+  std::map<kj::StringPtr, PooledBackend> clientPool;
+  // Declared after `ioContext` so that pooled connections are torn down before the event loop.
 };
 
 // =======================================================================================
 
 struct EzRpcClient::Impl {
   kj::Own<EzRpcContext> context;
+  kj::Own<EzRpcClientBackend> backend;
 
-  struct ClientContext {
-    kj::Own<kj::AsyncIoStream> stream;
-    TwoPartyVatNetwork network;
-    RpcSystem<rpc::twoparty::SturdyRefHostId> rpcSystem;
-
-    ClientContext(kj::Own<kj::AsyncIoStream>&& stream)
-        : stream(kj::mv(stream)),
-          network(*this->stream, rpc::twoparty::Side::CLIENT),
-          rpcSystem(makeRpcClient(network)) {}
+  struct ResolveName {
+    kj::Network& network;
+    kj::String address;
+    uint defaultPort;
 
-    Capability::Client restore(kj::StringPtr name) {
-      word scratch[64];
-      memset(scratch, 0, sizeof(scratch));
-      MallocMessageBuilder message(scratch);
-      auto root = message.getRoot<rpc::SturdyRef>();
-      auto hostId = root.getHostId().getAs<rpc::twoparty::SturdyRefHostId>();
-      hostId.setSide(rpc::twoparty::Side::SERVER);
-      root.getObjectId().setAs<Text>(name);
-      return rpcSystem.restore(hostId, root.getObjectId());
+    kj::Promise<kj::Own<kj::NetworkAddress>> operator()() {
+      return network.parseAddress(address, defaultPort);
     }
   };
 
-  kj::ForkedPromise<void> setupPromise;
+  struct ResolveSockaddr {
+    kj::Network& network;
+    kj::Array<byte> addr;
 
-  kj::Maybe<kj::Own<ClientContext>> clientContext;
-  // Filled in before `setupPromise` resolves.
+    kj::Promise<kj::Own<kj::NetworkAddress>> operator()() {
+      return network.getSockaddr(addr.begin(), addr.size());
+    }
+  };
 
-  Impl(kj::StringPtr serverAddress, uint defaultPort)
+  Impl(kj::StringPtr serverAddress, uint defaultPort, const EzRpcClientOptions& options)
       : context(EzRpcContext::getThreadLocal()),
-        setupPromise(context->getIoProvider().getNetwork()
-            .parseAddress(serverAddress, defaultPort)
-            .then([](kj::Own<kj::NetworkAddress>&& addr) {
-              return addr->connect();
-            }).then([this](kj::Own<kj::AsyncIoStream>&& stream) {
-              clientContext = kj::heap<ClientContext>(kj::mv(stream));
-            }).fork()) {}
-
-  Impl(struct sockaddr* serverAddress, uint addrSize)
+        backend(context->getClientBackend(kj::str(serverAddress, '/', defaultPort),
+            ResolveName { context->getIoProvider().getNetwork(),
+                          kj::heapString(serverAddress), defaultPort },
+            options)) {}
+
+  Impl(struct sockaddr* serverAddress, uint addrSize, const EzRpcClientOptions& options)
       : context(EzRpcContext::getThreadLocal()),
-        setupPromise(context->getIoProvider().getNetwork()
-            .getSockaddr(serverAddress, addrSize)->connect()
-            .then([this](kj::Own<kj::AsyncIoStream>&& stream) {
-              clientContext = kj::heap<ClientContext>(kj::mv(stream));
-            }).fork()) {}
+        backend(context->getClientBackend(
+            context->getIoProvider().getNetwork().getSockaddr(serverAddress, addrSize)
+                ->toString(),
+            ResolveSockaddr { context->getIoProvider().getNetwork(),
+                              copySockaddr(serverAddress, addrSize) },
+            options)) {}
 
   Impl(int socketFd)
       : context(EzRpcContext::getThreadLocal()),
-        setupPromise(kj::Promise<void>(kj::READY_NOW).fork()),
-        clientContext(kj::heap<ClientContext>(
-            context->getLowLevelIoProvider().wrapSocketFd(socketFd))) {}
+        backend(kj::refcounted<EzRpcClientBackend>(
+            context->getLowLevelIoProvider().wrapSocketFd(socketFd),
+            context->getIoProvider().getTimer())) {}
+
+  static kj::Array<byte> copySockaddr(struct sockaddr* addr, uint addrSize) {
+    auto result = kj::heapArray<byte>(addrSize);
+    memcpy(result.begin(), addr, addrSize);
+    return result;
+  }
 };
 
 EzRpcClient::EzRpcClient(kj::StringPtr serverAddress, uint defaultPort)
-    : impl(kj::heap<Impl>(serverAddress, defaultPort)) {}
+    : impl(kj::heap<Impl>(serverAddress, defaultPort, EzRpcClientOptions())) {}
+
+EzRpcClient::EzRpcClient(kj::StringPtr serverAddress, uint defaultPort,
+                         const EzRpcClientOptions& options)
+    : impl(kj::heap<Impl>(serverAddress, defaultPort, options)) {}
 
 EzRpcClient::EzRpcClient(struct sockaddr* serverAddress, uint addrSize)
-    : impl(kj::heap<Impl>(serverAddress, addrSize)) {}
+    : impl(kj::heap<Impl>(serverAddress, addrSize, EzRpcClientOptions())) {}
+
+EzRpcClient::EzRpcClient(struct sockaddr* serverAddress, uint addrSize,
+                         const EzRpcClientOptions& options)
+    : impl(kj::heap<Impl>(serverAddress, addrSize, options)) {}
 
 EzRpcClient::EzRpcClient(int socketFd)
     : impl(kj::heap<Impl>(socketFd)) {}
@@ -140,14 +338,7 @@ EzRpcClient::EzRpcClient(int socketFd)
 EzRpcClient::~EzRpcClient() noexcept(false) {}
 
 Capability::Client EzRpcClient::importCap(kj::StringPtr name) {
-  KJ_IF_MAYBE(client, impl->clientContext) {
-    return client->get()->restore(name);
-  } else {
-    return impl->setupPromise.addBranch().then(kj::mvCapture(kj::heapString(name),
-        [this](kj::String&& name) {
-      return KJ_ASSERT_NONNULL(impl->clientContext)->restore(name);
-    }));
-  }
+  return impl->backend->restore(name);
 }
 
 kj::WaitScope& EzRpcClient::getWaitScope() {
@@ -162,6 +353,10 @@ kj::LowLevelAsyncIoProvider& EzRpcClient::getLowLevelIoProvider() {
   return impl->context->getLowLevelIoProvider();
 }
 
+kj::UnixEventPort& EzRpcClient::getUnixEventPort() {
+  return impl->context->getUnixEventPort();
+}
+
 // =======================================================================================
 
 struct EzRpcServer::Impl final: public SturdyRefRestorer<Text>, public kj::TaskSet::ErrorHandler {
@@ -291,4 +486,110 @@ kj::LowLevelAsyncIoProvider& EzRpcServer::getLowLevelIoProvider() {
   return impl->context->getLowLevelIoProvider();
 }
 
+kj::UnixEventPort& EzRpcServer::getUnixEventPort() {
+  return impl->context->getUnixEventPort();
+}
+
+// =======================================================================================
+
+struct EzRpcMultiThreadServer::Impl {
+  kj::AutoCloseFd ownedSocket;
+  // Only if we created the listening socket ourselves.
+
+  int socketFd;
+  uint port;
+
+  kj::MutexGuarded<kj::Function<void(EzRpcServer&)>> setup;
+
+  kj::Maybe<kj::AutoCloseFd> stopWriteFd;
+  kj::AutoCloseFd stopReadFd;
+  // Workers wait for EOF on stopReadFd.  Closing stopWriteFd tells them all to shut down at once.
+
+  kj::Array<kj::Own<kj::Thread>> workers;
+
+  Impl(kj::AutoCloseFd ownedSocket, int socketFd, uint port, uint threadCount,
+       kj::Function<void(EzRpcServer&)> setup)
+      : ownedSocket(kj::mv(ownedSocket)), socketFd(socketFd), port(port),
+        setup(kj::mv(setup)), stopReadFd(makePipe(stopWriteFd)) {
+    KJ_REQUIRE(threadCount > 0, "EzRpcMultiThreadServer needs at least one thread.");
+
+    auto builder = kj::heapArrayBuilder<kj::Own<kj::Thread>>(threadCount);
+    for (uint i = 0; i < threadCount; i++) {
+      builder.add(kj::heap<kj::Thread>([this]() { runWorker(); }));
+    }
+    workers = builder.finish();
+  }
+
+  ~Impl() noexcept(false) {
+    stopWriteFd = nullptr;
+    workers = nullptr;  // joins
+  }
+
+  static kj::AutoCloseFd makePipe(kj::Maybe<kj::AutoCloseFd>& writeEnd) {
+    int fds[2];
+    KJ_SYSCALL(pipe(fds));
+    writeEnd = kj::AutoCloseFd(fds[1]);
+    return kj::AutoCloseFd(fds[0]);
+  }
+
+  void runWorker() {
+    EzRpcServer server(socketFd, port);
+    setup.lockExclusive()->operator()(server);
+
+    auto stop = server.getLowLevelIoProvider().wrapInputFd(stopReadFd);
+    byte dummy;
+    stop->tryRead(&dummy, 1, 1).wait(server.getWaitScope());
+  }
+
+  static kj::AutoCloseFd bindSocket(struct sockaddr* bindAddress, uint addrSize, uint& port) {
+    int fd;
+    KJ_SYSCALL(fd = socket(bindAddress->sa_family, SOCK_STREAM, 0));
+    kj::AutoCloseFd result(fd);
+
+    if (bindAddress->sa_family == AF_INET || bindAddress->sa_family == AF_INET6) {
+      int optval = 1;
+      KJ_SYSCALL(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)));
+    }
+
+    KJ_SYSCALL(bind(fd, bindAddress, addrSize));
+    KJ_SYSCALL(listen(fd, SOMAXCONN));
+
+    struct sockaddr_storage addr;
+    socklen_t addrLen = sizeof(addr);
+    KJ_SYSCALL(getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addrLen));
+    switch (addr.ss_family) {
+      case AF_INET:
+        port = ntohs(reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port);
+        break;
+      case AF_INET6:
+        port = ntohs(reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port);
+        break;
+      default:
+        port = 0;
+        break;
+    }
+
+    return kj::mv(result);
+  }
+};
+
+EzRpcMultiThreadServer::EzRpcMultiThreadServer(
+    struct sockaddr* bindAddress, uint addrSize, uint threadCount,
+    kj::Function<void(EzRpcServer& server)> setup) {
+  uint port;
+  auto fd = Impl::bindSocket(bindAddress, addrSize, port);
+  int rawFd = fd;
+  impl = kj::heap<Impl>(kj::mv(fd), rawFd, port, threadCount, kj::mv(setup));
+}
+
+EzRpcMultiThreadServer::EzRpcMultiThreadServer(
+    int socketFd, uint port, uint threadCount, kj::Function<void(EzRpcServer& server)> setup)
+    : impl(kj::heap<Impl>(nullptr, socketFd, port, threadCount, kj::mv(setup))) {}
+
+EzRpcMultiThreadServer::~EzRpcMultiThreadServer() noexcept(false) {}
+
+uint EzRpcMultiThreadServer::getPort() {
+  return impl->port;
+}
+
 }  // namespace capnp
@@ -25,13 +25,48 @@
 #define CAPNP_EZ_RPC_H_
 
 #include "rpc.h"
+#include <kj/function.h>
+#include <kj/time.h>
 
-namespace kj { class AsyncIoProvider; class LowLevelAsyncIoProvider; }
+struct sockaddr;
+namespace kj { class AsyncIoProvider; class LowLevelAsyncIoProvider; class UnixEventPort; }
 
 namespace capnp {
 
 class EzRpcContext;
 
+struct EzRpcClientOptions {
+  // Options for an `EzRpcClient` that connects to a server by address.
+
+  bool pooled = false;
+  // Share connections with every other pooled `EzRpcClient` in this thread that connects to the
+  // same address with the same `connectionCount` and `reconnect`, instead of opening a new socket
+  // and `RpcSystem` for each client.  Pooled connections stay open for as long as the thread's
+  // event loop lives, i.e. until the last `EzRpcClient` / `EzRpcServer` in the thread is
+  // destroyed, so keep one long-lived object around if you create short-lived clients.  If a
+  // pooled connection without `reconnect` fails or is lost, the next client to ask for it gets a
+  // new one; clients already using the old one keep it.
+  //
+  // Pooling is per-thread rather than per-process because capabilities belong to the event loop
+  // that created them.
+
+  uint connectionCount = 1;
+  // Number of connections to open to the server.  importCap() hands out capabilities on each
+  // connection in turn, so calls made through different capabilities are spread across them.
+
+  bool reconnect = false;
+  // If a connection is lost or cannot be established, keep trying to re-establish it in the
+  // background.  Capabilities imported over a lost connection stay broken; call importCap() again
+  // to get capabilities on the new connection.  While a connection attempt is in progress,
+  // importCap() waits for it; after one fails, importCap() fails until the next attempt.
+
+  kj::Duration minReconnectDelay = 100 * kj::MILLISECONDS;
+  kj::Duration maxReconnectDelay = 30 * kj::SECONDS;
+  // After a failed connection attempt, wait `minReconnectDelay` before the next one, doubling the
+  // delay on each further failure up to `maxReconnectDelay`.  A connection that drops after being
+  // established is retried immediately.
+};
+
 class EzRpcClient {
   // Super-simple interface for setting up a Cap'n Proto RPC client.  Example:
   //
@@ -102,8 +137,13 @@ public:
   // The address is parsed by `kj::Network` in `kj/async-io.h`.  See that interface for more info
   // on the address format, but basically it's what you'd expect.
 
+  EzRpcClient(kj::StringPtr serverAddress, uint defaultPort, const EzRpcClientOptions& options);
+  // Like the above constructor, but with pooling, multiple connections, or reconnection as
+  // configured by `options`.
+
   EzRpcClient(struct sockaddr* serverAddress, uint addrSize);
-  // Like the above constructor, but connects to an already-resolved socket address.  Any address
+  EzRpcClient(struct sockaddr* serverAddress, uint addrSize, const EzRpcClientOptions& options);
+  // Like the above constructors, but connects to an already-resolved socket address.  Any address
   // format supported by `kj::Network` in `kj/async-io.h` is accepted.
 
   explicit EzRpcClient(int socketFd);
@@ -129,6 +169,9 @@ public:
   // Get the underlying LowLevelAsyncIoProvider set up by the RPC system.  This is useful if you
   // want to do some non-RPC I/O in asynchronous fashion.
 
+  kj::UnixEventPort& getUnixEventPort();
+  // Get the underlying event port, e.g. to enable busy-polling with `setBusyPoll()`.
+
 private:
   struct Impl;
   kj::Own<Impl> impl;
@@ -187,6 +230,46 @@ public:
   // Get the underlying LowLevelAsyncIoProvider set up by the RPC system.  This is useful if you
   // want to do some non-RPC I/O in asynchronous fashion.
 
+  kj::UnixEventPort& getUnixEventPort();
+  // Get the underlying event port, e.g. to enable busy-polling with `setBusyPoll()`.
+
+private:
+  struct Impl;
+  kj::Own<Impl> impl;
+};
+
+class EzRpcMultiThreadServer {
+  // Like `EzRpcServer`, but spreads connections across several worker threads, each of which runs
+  // its own `kj::EventLoop`.  All workers accept from the same listening socket, so whichever
+  // thread is free picks up the next connection.
+  //
+  // Since capabilities belong to the event loop they were created in, exported capabilities
+  // cannot be shared between workers.  Instead, each worker thread calls `setup` on its own
+  // `EzRpcServer` once it starts, and `setup` should `exportCap()` a fresh set of capabilities
+  // there.  Calls to `setup` are serialized, but they come from different threads, so any state
+  // shared between the capability instances must be thread-safe.
+  //
+  // The constructor returns once the socket is listening; the workers start in the background.
+  // The destructor stops all workers and waits for them to finish.
+
+public:
+  EzRpcMultiThreadServer(struct sockaddr* bindAddress, uint addrSize, uint threadCount,
+                         kj::Function<void(EzRpcServer& server)> setup);
+  // Binds to the given address and starts `threadCount` workers.  If the address's port is zero,
+  // one is chosen automatically; call getPort() to find out which.
+
+  EzRpcMultiThreadServer(int socketFd, uint port, uint threadCount,
+                         kj::Function<void(EzRpcServer& server)> setup);
+  // Serves connections from an already-listening socket.  The caller keeps ownership of
+  // `socketFd`, which must stay open until the EzRpcMultiThreadServer is destroyed.  `port` is
+  // returned by `getPort()` -- it serves no other purpose.
+
+  ~EzRpcMultiThreadServer() noexcept(false);
+
+  uint getPort();
+  // Get the IP port number on which this server is listening, or zero if the address was not an
+  // IP address (e.g. it was a Unix domain socket).
+
 private:
   struct Impl;
   kj::Own<Impl> impl;
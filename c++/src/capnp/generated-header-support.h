@@ -45,6 +45,8 @@ struct DynamicStruct;  // So that it can be declared a friend.
 
 namespace _ {  // private
 
+struct RawStructLayout;  // Defined in dynamic.c++.
+
 struct RawSchema {
   // The generated code defines a constant RawSchema for every compiled declaration.
   //
@@ -61,13 +63,11 @@ struct RawSchema {
   const RawSchema* const* dependencies;
   // Pointers to other types on which this one depends, sorted by ID.  The schemas in this table
   // may be uninitialized -- you must call ensureInitialized() on the one you wish to use before
-  // using it.
-  //
-  // TODO(someday):  Make this a hashtable.
+  // using it.  See also `dependencyHash`.
 
   const uint16_t* membersByName;
-  // Indexes of members sorted by name.  Used to implement name lookup.
-  // TODO(someday):  Make this a hashtable.
+  // Indexes of members sorted by name.  Used to implement name lookup when `memberHash` is
+  // missing.
 
   uint32_t dependencyCount;
   uint32_t memberCount;
@@ -90,6 +90,22 @@ struct RawSchema {
   const Initializer* lazyInitializer;
   // Lazy initializer, invoked by ensureInitialized().
 
+  const uint16_t* memberHash;
+  // Perfect hash table (see buildPerfectHash()) mapping hashMemberName() of each member's name to
+  // the member's index.  Null if the code was generated by an older compiler, in which case name
+  // lookups binary-search `membersByName` instead.
+
+  const uint16_t* dependencyHash;
+  // Perfect hash table mapping each dependency's ID to its position in `dependencies`.  Null if
+  // absent, in which case lookups binary-search `dependencies`.
+
+  mutable const RawStructLayout* structLayout;
+  // Field descriptors for a struct, decoded from `encodedNode` the first time the dynamic API
+  // needs them and published atomically.  See getStructLayout() in schema.h.  Generated code never
+  // initializes this; it is always null until first use.
+  //
+  // The above three come last so that initializers emitted by older compilers leave them null.
+
   inline void ensureInitialized() const {
     // Lazy initialization support.  Invoke to ensure that initialization has taken place.  This
     // is required in particular when traversing the dependency list.  RawSchemas for compiled-in
@@ -100,6 +116,24 @@ struct RawSchema {
   }
 };
 
+uint64_t hashMemberName(kj::StringPtr name);
+// Hash of a member name, used as the key in `RawSchema::memberHash`.
+
+kj::Array<uint16_t> buildPerfectHash(kj::ArrayPtr<const uint64_t> keys,
+                                     kj::ArrayPtr<const uint16_t> values);
+// Builds a collision-free hash table mapping each of `keys` (which must be distinct) to the
+// corresponding element of `values` (which must be less than 0xffff), for use as
+// `RawSchema::memberHash` or `dependencyHash`.  The code generator runs this at compile time, and
+// SchemaLoader at load time, so both must produce the same format:  the bucket count B, the slot
+// count M, B displacements, then M slots.  Returns an empty array if no table could be built (for
+// example because there are too many keys), in which case lookups should fall back to binary
+// search.
+
+uint perfectHashLookup(const uint16_t* table, uint64_t key);
+// Looks up `key` in a table built by buildPerfectHash().  Returns the value stored for it, or
+// 0xffff if absent.  If `key` isn't one of the keys the table was built from, the result is
+// arbitrary, so the caller must verify it.
+
 template <typename T>
 struct RawSchema_;
 
@@ -228,6 +262,60 @@ inline constexpr uint sizeInWords() {
       _::structSize<T>().pointers * WORDS_PER_POINTER) / WORDS;
 }
 
+template <uint fieldCount>
+class FieldPresence {
+  // Bitset returned by the generated `presenceMask()` of a struct Reader.  Bit i refers to the
+  // struct's i'th field in code order, i.e. `StructSchema::getFields()[i]`.  A field is present
+  // if it is active in its union (if any) and its value is not the default:  pointer fields must
+  // be non-null and data fields must differ from their default.  Void fields and groups are
+  // present whenever they are active.  Intended for code that handles sparse, wide structs and
+  // wants to skip absent fields in bulk rather than calling each `hasFoo()` in turn.
+
+public:
+  inline FieldPresence(): words() {}
+
+  inline bool has(uint index) const {
+    return (words[index / 64] >> (index % 64)) & 1;
+  }
+  inline void set(uint index, bool value) {
+    words[index / 64] |= uint64_t(value) << (index % 64);
+  }
+
+  inline bool any() const {
+    for (uint64_t word: words) {
+      if (word != 0) return true;
+    }
+    return false;
+  }
+  inline uint count() const {
+    uint result = 0;
+    for (uint64_t word: words) {
+      result += __builtin_popcountll(word);
+    }
+    return result;
+  }
+
+  template <typename Func>
+  void forEach(Func&& func) const {
+    // Calls `func(index)` for each present field, in index order.
+    for (uint i = 0; i < WORD_COUNT; i++) {
+      uint64_t word = words[i];
+      while (word != 0) {
+        func(i * 64 + __builtin_ctzll(word));
+        word &= word - 1;
+      }
+    }
+  }
+
+  inline kj::ArrayPtr<const uint64_t> asWords() const {
+    return kj::arrayPtr(words, WORD_COUNT);
+  }
+
+private:
+  static constexpr uint WORD_COUNT = fieldCount == 0 ? 1 : (fieldCount + 63) / 64;
+  uint64_t words[WORD_COUNT];
+};
+
 }  // namespace capnp
 
 #define CAPNP_DECLARE_ENUM(type, id) \
@@ -0,0 +1,129 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Benchmarks comparing JsonCodec with the existing text output (stringify and prettyPrint).  Run
+// them with the capnp-bench program.
+
+#include "json.h"
+#include "message.h"
+#include "pretty-print.h"
+#include <kj/benchmark.h>
+#include <kj/io.h>
+#include <capnp/test.capnp.h>
+
+namespace capnp {
+namespace _ {  // private
+namespace {
+
+using ::capnproto_test::capnp::test::TestAllTypes;
+using ::capnproto_test::capnp::test::TestEnum;
+
+class DiscardingOutputStream: public kj::OutputStream {
+public:
+  void write(const void* buffer, size_t size) override {
+    kj::doNotOptimize(buffer);
+    bytes += size;
+  }
+
+  uint64_t bytes = 0;
+};
+
+void initSampleMessage(TestAllTypes::Builder root) {
+  // A record-like message: some scalars and strings, plus a list of small structs.
+
+  root.setBoolField(true);
+  root.setInt32Field(-12345678);
+  root.setUInt64Field(12345678901234567890ull);
+  root.setFloat64Field(-123e45);
+  root.setTextField("The quick brown fox jumps over the \"lazy\" dog.");
+  root.setEnumField(TestEnum::CORGE);
+
+  auto list = root.initStructList(16);
+  for (uint i = 0; i < list.size(); i++) {
+    list[i].setInt32Field(i * 1000);
+    list[i].setFloat64Field(i * 0.25);
+    list[i].setTextField("list item");
+  }
+
+  auto ints = root.initInt32List(32);
+  for (uint i = 0; i < ints.size(); i++) {
+    ints.set(i, i * i);
+  }
+}
+
+KJ_BENCHMARK(JsonCodec::encode) {
+  MallocMessageBuilder message;
+  initSampleMessage(message.initRoot<TestAllTypes>());
+  auto root = message.getRoot<TestAllTypes>().asReader();
+
+  JsonCodec json;
+  DiscardingOutputStream output;
+  for (uint64_t i = 0; i < iterations; i++) {
+    json.encode(root, output);
+  }
+}
+
+KJ_BENCHMARK(prettyPrint (unindented, streaming)) {
+  MallocMessageBuilder message;
+  initSampleMessage(message.initRoot<TestAllTypes>());
+  auto root = message.getRoot<TestAllTypes>().asReader();
+
+  PrettyPrintOptions options;
+  options.indent = false;
+  DiscardingOutputStream output;
+  for (uint64_t i = 0; i < iterations; i++) {
+    prettyPrint(output, root, options);
+  }
+}
+
+KJ_BENCHMARK(kj::str(DynamicStruct)) {
+  MallocMessageBuilder message;
+  initSampleMessage(message.initRoot<TestAllTypes>());
+  auto root = message.getRoot<TestAllTypes>().asReader();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    kj::doNotOptimize(kj::str(root));
+  }
+}
+
+KJ_BENCHMARK(JsonCodec::decode) {
+  JsonCodec json;
+  kj::String text;
+  {
+    MallocMessageBuilder message;
+    initSampleMessage(message.initRoot<TestAllTypes>());
+    text = json.encode(message.getRoot<TestAllTypes>().asReader());
+  }
+  Benchmark::resetTimer();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    MallocMessageBuilder message;
+    json.decode(text, message.initRoot<TestAllTypes>());
+    kj::doNotOptimize(message);
+  }
+}
+
+}  // namespace
+}  // namespace _ (private)
+}  // namespace capnp
@@ -0,0 +1,245 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "json.h"
+#include "message.h"
+#include <kj/debug.h>
+#include <kj/io.h>
+#include <kj/vector.h>
+#include <gtest/gtest.h>
+#include "test-util.h"
+
+namespace kj {
+  inline std::ostream& operator<<(std::ostream& os, const kj::String& s) {
+    return os.write(s.begin(), s.size());
+  }
+}
+
+namespace capnp {
+namespace _ {  // private
+namespace {
+
+class StringOutputStream: public kj::OutputStream {
+public:
+  void write(const void* buffer, size_t size) override {
+    chars.addAll(reinterpret_cast<const char*>(buffer),
+                 reinterpret_cast<const char*>(buffer) + size);
+  }
+
+  kj::String str() { return kj::heapString(chars.begin(), chars.size()); }
+
+private:
+  kj::Vector<char> chars;
+};
+
+TEST(Json, EncodeDefaults) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<TestAllTypes>();
+
+  JsonCodec json;
+  EXPECT_EQ("{"
+      "\"voidField\":null,"
+      "\"boolField\":false,"
+      "\"int8Field\":0,"
+      "\"int16Field\":0,"
+      "\"int32Field\":0,"
+      "\"int64Field\":\"0\","
+      "\"uInt8Field\":0,"
+      "\"uInt16Field\":0,"
+      "\"uInt32Field\":0,"
+      "\"uInt64Field\":\"0\","
+      "\"float32Field\":0,"
+      "\"float64Field\":0,"
+      "\"enumField\":\"foo\","
+      "\"interfaceField\":null"
+      "}", json.encode(root.asReader()));
+}
+
+TEST(Json, EncodeValues) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<TestAllTypes>();
+  initTestMessage(root);
+
+  JsonCodec json;
+  auto text = json.encode(root.asReader());
+
+  EXPECT_TRUE(strstr(text.cStr(), "\"int64Field\":\"-123456789012345\"") != nullptr) << text;
+  EXPECT_TRUE(strstr(text.cStr(), "\"uInt64Field\":\"12345678901234567890\"") != nullptr) << text;
+  EXPECT_TRUE(strstr(text.cStr(), "\"textField\":\"foo\"") != nullptr) << text;
+  EXPECT_TRUE(strstr(text.cStr(), "\"dataField\":[98,97,114]") != nullptr) << text;
+  EXPECT_TRUE(strstr(text.cStr(), "\"enumField\":\"corge\"") != nullptr) << text;
+  EXPECT_TRUE(strstr(text.cStr(),
+      "\"float32List\":[5555.5,\"Infinity\",\"-Infinity\",\"NaN\"]") != nullptr) << text;
+
+  // Streaming gives the same text.
+  StringOutputStream output;
+  json.encode(root.asReader(), output);
+  EXPECT_EQ(text, output.str());
+}
+
+TEST(Json, RoundTrip) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<TestAllTypes>();
+  initTestMessage(root);
+
+  JsonCodec json;
+  auto text = json.encode(root.asReader());
+
+  MallocMessageBuilder builder2;
+  json.decode(text, builder2.initRoot<TestAllTypes>());
+  checkTestMessage(builder2.getRoot<TestAllTypes>().asReader());
+
+  EXPECT_EQ(text, json.encode(builder2.getRoot<TestAllTypes>().asReader()));
+}
+
+TEST(Json, Strings) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<TestAllTypes>();
+  root.setTextField("quote\" backslash\\ tab\t newline\n bell\a caf\xc3\xa9");
+
+  JsonCodec json;
+  auto text = json.encode(root.asReader());
+  EXPECT_TRUE(strstr(text.cStr(),
+      "\"textField\":\"quote\\\" backslash\\\\ tab\\t newline\\n bell\\u0007 caf\xc3\xa9\"") !=
+      nullptr) << text;
+
+  MallocMessageBuilder builder2;
+  json.decode(text, builder2.initRoot<TestAllTypes>());
+  EXPECT_EQ(root.asReader().getTextField(),
+            builder2.getRoot<TestAllTypes>().asReader().getTextField());
+
+  // \u escapes, including a surrogate pair, decode to UTF-8.
+  MallocMessageBuilder builder3;
+  json.decode(kj::StringPtr("{\"textField\": \"\\u00e9\\u20ac\\ud83d\\ude00\\/\"}"),
+              builder3.initRoot<TestAllTypes>());
+  EXPECT_EQ("\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80/",
+            builder3.getRoot<TestAllTypes>().getTextField());
+}
+
+TEST(Json, Unions) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<test::TestUnnamedUnion>();
+  root.setBefore("a");
+  root.setBar(123);
+
+  JsonCodec json;
+  auto text = json.encode(root.asReader());
+  EXPECT_EQ("{\"before\":\"a\",\"middle\":0,\"bar\":123}", text);
+
+  MallocMessageBuilder builder2;
+  auto root2 = builder2.initRoot<test::TestUnnamedUnion>();
+  json.decode(text, root2);
+  EXPECT_EQ(test::TestUnnamedUnion::BAR, root2.which());
+  EXPECT_EQ(123u, root2.getBar());
+  EXPECT_EQ("a", root2.getBefore());
+}
+
+TEST(Json, Groups) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<test::TestGroups>();
+  auto bar = root.getGroups().initBar();
+  bar.setCorge(12);
+  bar.setGrault("foo");
+  bar.setGarply(34);
+
+  JsonCodec json;
+  auto text = json.encode(root.asReader());
+  EXPECT_EQ("{\"groups\":{\"bar\":{\"corge\":12,\"grault\":\"foo\",\"garply\":\"34\"}}}", text);
+
+  MallocMessageBuilder builder2;
+  auto root2 = builder2.initRoot<test::TestGroups>();
+  json.decode(text, root2);
+  ASSERT_EQ(test::TestGroups::Groups::BAR, root2.getGroups().which());
+  EXPECT_EQ(12, root2.getGroups().getBar().getCorge());
+  EXPECT_EQ("foo", root2.getGroups().getBar().getGrault());
+  EXPECT_EQ(34, root2.getGroups().getBar().getGarply());
+}
+
+TEST(Json, DecodeLenient) {
+  // Whitespace, unknown fields (of any shape), nulls, numbers for enums and 64-bit integers as
+  // plain numbers are all accepted.
+  JsonCodec json;
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<TestAllTypes>();
+  json.decode(kj::StringPtr(
+      " {\n"
+      "  \"unknown\": {\"a\": [1, 2.5e3, \"x\\\"\", true, false, null, {}, []]},\n"
+      "  \"int64Field\": -9223372036854775808,\n"
+      "  \"uInt64Field\": 18446744073709551615,\n"
+      "  \"textField\": null,\n"
+      "  \"float64Field\": -1.5e-3,\n"
+      "  \"enumField\": 3,\n"
+      "  \"enumList\": [\"bar\", 7],\n"
+      "  \"int8List\": [],\n"
+      "  \"structField\": {\"int32Field\": \"42\"}\n"
+      "} "), root);
+
+  EXPECT_EQ(int64_t(kj::minValue), root.getInt64Field());
+  EXPECT_EQ(uint64_t(kj::maxValue), root.getUInt64Field());
+  EXPECT_FALSE(root.hasTextField());
+  EXPECT_EQ(-1.5e-3, root.getFloat64Field());
+  EXPECT_EQ(TestEnum::QUX, root.getEnumField());
+  ASSERT_EQ(2u, root.getEnumList().size());
+  EXPECT_EQ(TestEnum::BAR, root.getEnumList()[0]);
+  EXPECT_EQ(TestEnum::GARPLY, root.getEnumList()[1]);
+  EXPECT_TRUE(root.hasInt8List());
+  EXPECT_EQ(0u, root.getInt8List().size());
+  EXPECT_EQ(42, root.getStructField().getInt32Field());
+}
+
+TEST(Json, DecodeErrors) {
+  JsonCodec json;
+
+  auto expectError = [&](kj::StringPtr input, kj::StringPtr expected) {
+    MallocMessageBuilder builder;
+    auto root = builder.initRoot<TestAllTypes>();
+    KJ_IF_MAYBE(e, kj::runCatchingExceptions([&]() { json.decode(input, root); })) {
+      EXPECT_TRUE(strstr(e->getDescription().cStr(), expected.cStr()) != nullptr)
+          << input.cStr() << ": " << e->getDescription().cStr();
+    } else {
+      ADD_FAILURE() << "Expected exception: " << input.cStr();
+    }
+  };
+
+  expectError("", "expected character");
+  expectError("[]", "expected character");
+  expectError("{\"int8Field\": 1", "expected character");
+  expectError("{\"int8Field\": 128}", "out-of-range");
+  expectError("{\"uInt8Field\": -1}", "Expected an integer");
+  expectError("{\"int32Field\": 1.5}", "Expected an integer");
+  expectError("{\"uInt64Field\": 18446744073709551616}", "Integer out of range");
+  expectError("{\"boolField\": 1}", "Expected true or false");
+  expectError("{\"textField\": \"abc}", "unterminated string");
+  expectError("{\"textField\": \"\\q\"}", "unknown escape sequence");
+  expectError("{\"enumField\": \"nope\"}", "Unknown enumerant");
+  expectError("{\"dataField\": [256]}", "Byte value out of range");
+  expectError("{} {}", "unexpected data after the top-level object");
+
+  kj::String deep = kj::str("{\"unknown\":", kj::repeat('[', 100), kj::repeat(']', 100), "}");
+  expectError(deep, "nested too deeply");
+}
+
+}  // namespace
+}  // namespace _ (private)
+}  // namespace capnp
@@ -0,0 +1,892 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "json.h"
+#include <kj/debug.h>
+#include <kj/hash.h>
+#include <kj/io.h>
+#include <kj/vector.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace capnp {
+
+namespace {
+
+static const char HEXDIGITS[] = "0123456789abcdef";
+
+struct NameHasher {
+  inline uint operator()(kj::ArrayPtr<const char> name) const {
+    // FNV-1a.
+    uint result = 2166136261u;
+    for (char c: name) {
+      result = (result ^ static_cast<byte>(c)) * 16777619u;
+    }
+    return result;
+  }
+};
+
+bool isPointerType(schema::Type::Which type) {
+  switch (type) {
+    case schema::Type::TEXT:
+    case schema::Type::DATA:
+    case schema::Type::LIST:
+    case schema::Type::STRUCT:
+    case schema::Type::INTERFACE:
+    case schema::Type::ANY_POINTER:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool matches(kj::ArrayPtr<const char> token, kj::StringPtr literal) {
+  return token == literal.asArray();
+}
+
+struct FieldInfo {
+  StructSchema::Field field;
+
+  schema::Type::Which type;
+  // STRUCT for groups.
+
+  bool isPointer;
+  // True for pointer slots, which are omitted when null.  False for groups.
+
+  kj::String key;
+  // The field name, quoted and followed by a colon, ready to write out.
+
+  EnumSchema enumSchema;
+  // For enum fields, the enum's schema.
+};
+
+struct StructTable {
+  kj::Array<FieldInfo> fields;
+  // Indexed by field index.
+
+  kj::Array<uint> nonUnionFields;
+  // Indexes of the fields which aren't union members, in code order.
+
+  kj::HashMap<kj::ArrayPtr<const char>, uint, NameHasher> fieldsByName;
+  // Keys point into `fields[i].key`.
+};
+
+struct CodecState {
+  // What a JsonCodec keeps between calls.
+
+  kj::HashMap<uint64_t, kj::Own<StructTable>> tables;
+  // By type ID.
+
+  kj::Vector<char> scratch;
+  // Holds decoded strings that contained escapes, so that decoding doesn't allocate per string.
+
+  StructTable& getTable(StructSchema schema) {
+    uint64_t id = schema.getProto().getId();
+    KJ_IF_MAYBE(table, tables.find(id)) {
+      return **table;
+    }
+
+    auto table = kj::heap<StructTable>();
+    auto fields = schema.getFields();
+    auto infos = kj::heapArrayBuilder<FieldInfo>(fields.size());
+    for (auto field: fields) {
+      auto proto = field.getProto();
+      FieldInfo info;
+      info.field = field;
+      info.key = kj::str('"', proto.getName(), "\":");
+      switch (proto.which()) {
+        case schema::Field::SLOT: {
+          auto type = proto.getSlot().getType();
+          info.type = type.which();
+          info.isPointer = isPointerType(info.type);
+          if (info.type == schema::Type::ENUM) {
+            info.enumSchema = schema.getDependency(type.getEnum().getTypeId()).asEnum();
+          }
+          break;
+        }
+        case schema::Field::GROUP:
+          info.type = schema::Type::STRUCT;
+          info.isPointer = false;
+          break;
+      }
+      infos.add(kj::mv(info));
+    }
+    table->fields = infos.finish();
+
+    for (uint i: kj::indices(table->fields)) {
+      auto& key = table->fields[i].key;
+      table->fieldsByName.insert(key.slice(1, key.size() - 2), kj::mv(i));
+    }
+
+    auto nonUnionFields = schema.getNonUnionFields();
+    auto indexes = kj::heapArrayBuilder<uint>(nonUnionFields.size());
+    for (auto field: nonUnionFields) {
+      indexes.add(field.getIndex());
+    }
+    table->nonUnionFields = indexes.finish();
+
+    StructTable& result = *table;
+    tables.insert(id, kj::mv(table));
+    return result;
+  }
+};
+
+class Encoder {
+public:
+  Encoder(CodecState& codec, kj::OutputStream& output)
+      : codec(codec), output(output), pos(buffer) {}
+
+  void flush() {
+    if (pos > buffer) {
+      output.write(buffer, pos - buffer);
+      pos = buffer;
+    }
+  }
+
+  void encodeStruct(DynamicStruct::Reader value) {
+    StructTable& table = codec.getTable(value.getSchema());
+
+    put('{');
+    bool first = true;
+    for (uint index: table.nonUnionFields) {
+      encodeField(value, table.fields[index], first);
+    }
+    KJ_IF_MAYBE(field, value.which()) {
+      encodeField(value, table.fields[field->getIndex()], first);
+    }
+    put('}');
+  }
+
+private:
+  CodecState& codec;
+  kj::OutputStream& output;
+  char buffer[8192];
+  char* pos;
+
+  inline void put(char c) {
+    if (pos == buffer + sizeof(buffer)) flush();
+    *pos++ = c;
+  }
+
+  void write(const char* data, size_t size) {
+    if (size > size_t(buffer + sizeof(buffer) - pos)) {
+      flush();
+      if (size > sizeof(buffer)) {
+        output.write(data, size);
+        return;
+      }
+    }
+    memcpy(pos, data, size);
+    pos += size;
+  }
+
+  inline void write(kj::ArrayPtr<const char> text) { write(text.begin(), text.size()); }
+  template <size_t n>
+  inline void write(const char (&literal)[n]) { write(literal, n - 1); }
+
+  void writeUnsigned(uint64_t value) {
+    // kj::toCharSequence() goes through snprintf(), which dominates encoding time for
+    // number-heavy messages.
+    char digits[20];
+    char* start = digits + sizeof(digits);
+    do {
+      *--start = '0' + value % 10;
+      value /= 10;
+    } while (value != 0);
+    write(start, digits + sizeof(digits) - start);
+  }
+
+  void writeSigned(int64_t value) {
+    if (value < 0) {
+      put('-');
+      writeUnsigned(0 - static_cast<uint64_t>(value));
+    } else {
+      writeUnsigned(value);
+    }
+  }
+
+  void encodeField(DynamicStruct::Reader value, const FieldInfo& info, bool& first) {
+    if (info.isPointer && !value.has(info.field)) return;
+
+    if (!first) put(',');
+    first = false;
+    write(info.key.asArray());
+    encodeValue(value.get(info.field), info.type);
+  }
+
+  void encodeValue(const DynamicValue::Reader& value, schema::Type::Which type) {
+    switch (value.getType()) {
+      case DynamicValue::UNKNOWN:
+      case DynamicValue::VOID:
+      case DynamicValue::CAPABILITY:
+      case DynamicValue::ANY_POINTER:
+        write("null");
+        return;
+      case DynamicValue::BOOL:
+        if (value.as<bool>()) {
+          write("true");
+        } else {
+          write("false");
+        }
+        return;
+      case DynamicValue::INT:
+        if (type == schema::Type::INT64) {
+          put('"');
+          writeSigned(value.as<int64_t>());
+          put('"');
+        } else {
+          writeSigned(value.as<int64_t>());
+        }
+        return;
+      case DynamicValue::UINT:
+        if (type == schema::Type::UINT64) {
+          put('"');
+          writeUnsigned(value.as<uint64_t>());
+          put('"');
+        } else {
+          writeUnsigned(value.as<uint64_t>());
+        }
+        return;
+      case DynamicValue::FLOAT: {
+        double d = value.as<double>();
+        if (fabs(d) < 1e15 && d == double(int64_t(d)) && !(d == 0 && signbit(d))) {
+          // Integral values (zero, most commonly) are written like integers, which is several
+          // times faster than the general shortest-round-trip formatting.
+          writeSigned(int64_t(d));
+        } else if (isnan(d)) {
+          write("\"NaN\"");
+        } else if (isinf(d)) {
+          if (d > 0) {
+            write("\"Infinity\"");
+          } else {
+            write("\"-Infinity\"");
+          }
+        } else if (type == schema::Type::FLOAT32) {
+          write(kj::toCharSequence(value.as<float>()));
+        } else {
+          write(kj::toCharSequence(d));
+        }
+        return;
+      }
+      case DynamicValue::TEXT:
+        encodeString(value.as<Text>());
+        return;
+      case DynamicValue::DATA: {
+        put('[');
+        bool first = true;
+        for (byte b: value.as<Data>()) {
+          if (!first) put(',');
+          first = false;
+          writeUnsigned(b);
+        }
+        put(']');
+        return;
+      }
+      case DynamicValue::LIST: {
+        auto list = value.as<DynamicList>();
+        auto elementType = list.getSchema().whichElementType();
+        put('[');
+        for (uint i = 0; i < list.size(); i++) {
+          if (i > 0) put(',');
+          encodeValue(list[i], elementType);
+        }
+        put(']');
+        return;
+      }
+      case DynamicValue::ENUM: {
+        auto enumValue = value.as<DynamicEnum>();
+        KJ_IF_MAYBE(enumerant, enumValue.getEnumerant()) {
+          put('"');
+          write(enumerant->getProto().getName().asArray());
+          put('"');
+        } else {
+          // Unknown enumerant; output the raw number.
+          writeUnsigned(enumValue.getRaw());
+        }
+        return;
+      }
+      case DynamicValue::STRUCT:
+        encodeStruct(value.as<DynamicStruct>());
+        return;
+    }
+
+    KJ_UNREACHABLE;
+  }
+
+  void encodeString(kj::ArrayPtr<const char> text) {
+    put('"');
+
+    // Copy runs of characters that need no escaping in one go.
+    const char* run = text.begin();
+    for (const char* p = text.begin(); p != text.end(); ++p) {
+      byte c = *p;
+      if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+      write(run, p - run);
+      run = p + 1;
+      switch (c) {
+        case '"': write("\\\""); break;
+        case '\\': write("\\\\"); break;
+        case '\b': write("\\b"); break;
+        case '\f': write("\\f"); break;
+        case '\n': write("\\n"); break;
+        case '\r': write("\\r"); break;
+        case '\t': write("\\t"); break;
+        default: {
+          char escape[6] = { '\\', 'u', '0', '0', HEXDIGITS[c / 16], HEXDIGITS[c % 16] };
+          write(escape, sizeof(escape));
+          break;
+        }
+      }
+    }
+    write(run, text.end() - run);
+
+    put('"');
+  }
+};
+
+class Decoder {
+public:
+  Decoder(CodecState& codec, kj::ArrayPtr<const char> input)
+      : codec(codec), begin(input.begin()), pos(input.begin()), end(input.end()) {}
+
+  void decodeRoot(DynamicStruct::Builder output) {
+    decodeStruct(output, 0);
+    skipWhitespace();
+    KJ_REQUIRE(pos == end, "Invalid JSON: unexpected data after the top-level object.", offset());
+  }
+
+private:
+  CodecState& codec;
+  const char* begin;
+  const char* pos;
+  const char* end;
+
+  inline size_t offset() { return pos - begin; }
+
+  inline void skipWhitespace() {
+    while (pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) ++pos;
+  }
+
+  inline bool tryConsume(char c) {
+    skipWhitespace();
+    if (pos < end && *pos == c) {
+      ++pos;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  inline void consume(char c) {
+    KJ_REQUIRE(tryConsume(c), "Invalid JSON: expected character.", kj::str(c), offset());
+  }
+
+  bool tryConsumeLiteral(kj::StringPtr literal) {
+    skipWhitespace();
+    if (size_t(end - pos) >= literal.size() && memcmp(pos, literal.begin(), literal.size()) == 0) {
+      pos += literal.size();
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  void checkDepth(uint depth) {
+    KJ_REQUIRE(depth < JsonCodec::MAX_NESTING_DEPTH, "JSON nested too deeply.", offset());
+  }
+
+  // -------------------------------------------------------------------
+  // Structure
+
+  void decodeStruct(DynamicStruct::Builder output, uint depth) {
+    checkDepth(depth);
+    StructTable& table = codec.getTable(output.getSchema());
+
+    consume('{');
+    if (tryConsume('}')) return;
+    do {
+      auto name = parseString();
+      consume(':');
+      KJ_IF_MAYBE(index, table.fieldsByName.find(name)) {
+        decodeField(output, table.fields[*index], depth);
+      } else {
+        // Unknown field, perhaps from a newer version of the schema.
+        skipValue(depth + 1);
+      }
+    } while (tryConsume(','));
+    consume('}');
+  }
+
+  void decodeField(DynamicStruct::Builder output, const FieldInfo& info, uint depth) {
+    if (tryConsumeLiteral("null")) {
+      if (info.type == schema::Type::VOID) {
+        output.set(info.field, VOID);
+      }
+      return;
+    }
+
+    switch (info.type) {
+      case schema::Type::VOID:
+        KJ_FAIL_REQUIRE("Expected null for Void field.", info.key, offset());
+      case schema::Type::BOOL:
+      case schema::Type::INT8:
+      case schema::Type::INT16:
+      case schema::Type::INT32:
+      case schema::Type::INT64:
+      case schema::Type::UINT8:
+      case schema::Type::UINT16:
+      case schema::Type::UINT32:
+      case schema::Type::UINT64:
+      case schema::Type::FLOAT32:
+      case schema::Type::FLOAT64:
+        output.set(info.field, parsePrimitive(info.type));
+        return;
+      case schema::Type::TEXT: {
+        auto text = parseString();
+        copyText(output.init(info.field, text.size()).as<Text>(), text);
+        return;
+      }
+      case schema::Type::DATA:
+        decodeBytes(output.init(info.field, countElements(depth)).as<Data>());
+        return;
+      case schema::Type::LIST:
+        decodeList(output.init(info.field, countElements(depth)).as<DynamicList>(), depth + 1);
+        return;
+      case schema::Type::ENUM:
+        output.set(info.field, parseEnum(info.enumSchema));
+        return;
+      case schema::Type::STRUCT:
+        decodeStruct(output.init(info.field).as<DynamicStruct>(), depth + 1);
+        return;
+      case schema::Type::INTERFACE:
+      case schema::Type::ANY_POINTER:
+        KJ_FAIL_REQUIRE("Only null can be decoded into a capability or AnyPointer field.",
+                        info.key, offset());
+    }
+
+    KJ_FAIL_REQUIRE("Unknown field type.", info.key, offset());
+  }
+
+  void decodeList(DynamicList::Builder output, uint depth) {
+    checkDepth(depth);
+    auto schema = output.getSchema();
+    auto type = schema.whichElementType();
+
+    consume('[');
+    for (uint i = 0; i < output.size(); i++) {
+      if (i > 0) consume(',');
+
+      if (isPointerType(type) && tryConsumeLiteral("null")) continue;
+
+      switch (type) {
+        case schema::Type::VOID:
+          KJ_REQUIRE(tryConsumeLiteral("null"), "Expected null for Void element.", offset());
+          break;
+        case schema::Type::BOOL:
+        case schema::Type::INT8:
+        case schema::Type::INT16:
+        case schema::Type::INT32:
+        case schema::Type::INT64:
+        case schema::Type::UINT8:
+        case schema::Type::UINT16:
+        case schema::Type::UINT32:
+        case schema::Type::UINT64:
+        case schema::Type::FLOAT32:
+        case schema::Type::FLOAT64:
+          output.set(i, parsePrimitive(type));
+          break;
+        case schema::Type::TEXT: {
+          auto text = parseString();
+          copyText(output.init(i, text.size()).as<Text>(), text);
+          break;
+        }
+        case schema::Type::DATA:
+          decodeBytes(output.init(i, countElements(depth)).as<Data>());
+          break;
+        case schema::Type::LIST:
+          decodeList(output.init(i, countElements(depth)).as<DynamicList>(), depth + 1);
+          break;
+        case schema::Type::ENUM:
+          output.set(i, parseEnum(schema.getEnumElementType()));
+          break;
+        case schema::Type::STRUCT:
+          decodeStruct(output[i].as<DynamicStruct>(), depth + 1);
+          break;
+        case schema::Type::INTERFACE:
+        case schema::Type::ANY_POINTER:
+          KJ_FAIL_REQUIRE("Only null can be decoded into a capability or AnyPointer element.",
+                          offset());
+      }
+    }
+    consume(']');
+  }
+
+  void decodeBytes(Data::Builder output) {
+    consume('[');
+    for (uint i = 0; i < output.size(); i++) {
+      if (i > 0) consume(',');
+      uint64_t value = parseUnsigned();
+      KJ_REQUIRE(value <= 255, "Byte value out of range.", value, offset());
+      output[i] = value;
+    }
+    consume(']');
+  }
+
+  static void copyText(Text::Builder output, kj::ArrayPtr<const char> text) {
+    memcpy(output.begin(), text.begin(), text.size());
+  }
+
+  uint countElements(uint depth) {
+    // Counts the elements of the array at `pos` without consuming it, so that the list can be
+    // allocated at its final size before its elements are decoded.  This scans the array twice,
+    // but that is much cheaper than building it up in a temporary first.
+
+    const char* start = pos;
+    uint count = 0;
+    consume('[');
+    if (!tryConsume(']')) {
+      do {
+        skipValue(depth + 1);
+        ++count;
+      } while (tryConsume(','));
+      consume(']');
+    }
+    pos = start;
+    return count;
+  }
+
+  void skipValue(uint depth) {
+    checkDepth(depth);
+    skipWhitespace();
+    KJ_REQUIRE(pos < end, "Invalid JSON: unexpected end of input.", offset());
+
+    switch (*pos) {
+      case '{':
+        ++pos;
+        if (!tryConsume('}')) {
+          do {
+            parseString();
+            consume(':');
+            skipValue(depth + 1);
+          } while (tryConsume(','));
+          consume('}');
+        }
+        break;
+      case '[':
+        ++pos;
+        if (!tryConsume(']')) {
+          do {
+            skipValue(depth + 1);
+          } while (tryConsume(','));
+          consume(']');
+        }
+        break;
+      case '"':
+        parseString();
+        break;
+      default:
+        if (!tryConsumeLiteral("true") && !tryConsumeLiteral("false") &&
+            !tryConsumeLiteral("null")) {
+          parseNumberToken();
+        }
+        break;
+    }
+  }
+
+  // -------------------------------------------------------------------
+  // Scalars
+
+  kj::ArrayPtr<const char> parseString() {
+    // Returns the string's contents.  If it contained escapes, the result is decoded into
+    // `codec.scratch` and is only valid until the next call.
+
+    consume('"');
+    const char* start = pos;
+    while (pos < end && *pos != '"' && *pos != '\\') {
+      KJ_REQUIRE(static_cast<byte>(*pos) >= 0x20, "Invalid JSON: control character in string.",
+                 offset());
+      ++pos;
+    }
+    KJ_REQUIRE(pos < end, "Invalid JSON: unterminated string.", offset());
+    if (*pos == '"') {
+      return kj::arrayPtr(start, pos++);
+    }
+
+    auto& scratch = codec.scratch;
+    scratch.resize(0);
+    scratch.addAll(start, pos);
+    for (;;) {
+      KJ_REQUIRE(pos < end, "Invalid JSON: unterminated string.", offset());
+      char c = *pos++;
+      if (c == '"') {
+        break;
+      } else if (c == '\\') {
+        KJ_REQUIRE(pos < end, "Invalid JSON: unterminated string.", offset());
+        switch (*pos++) {
+          case '"': scratch.add('"'); break;
+          case '\\': scratch.add('\\'); break;
+          case '/': scratch.add('/'); break;
+          case 'b': scratch.add('\b'); break;
+          case 'f': scratch.add('\f'); break;
+          case 'n': scratch.add('\n'); break;
+          case 'r': scratch.add('\r'); break;
+          case 't': scratch.add('\t'); break;
+          case 'u': parseUnicodeEscape(); break;
+          default:
+            KJ_FAIL_REQUIRE("Invalid JSON: unknown escape sequence.", offset() - 1);
+        }
+      } else {
+        KJ_REQUIRE(static_cast<byte>(c) >= 0x20, "Invalid JSON: control character in string.",
+                   offset());
+        scratch.add(c);
+      }
+    }
+    return scratch.asPtr();
+  }
+
+  uint parseHex4() {
+    KJ_REQUIRE(end - pos >= 4, "Invalid JSON: truncated \\u escape.", offset());
+    uint result = 0;
+    for (uint i = 0; i < 4; i++) {
+      char c = *pos++;
+      uint digit;
+      if (c >= '0' && c <= '9') {
+        digit = c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        digit = c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        digit = c - 'A' + 10;
+      } else {
+        KJ_FAIL_REQUIRE("Invalid JSON: bad hex digit in \\u escape.", offset());
+      }
+      result = result * 16 + digit;
+    }
+    return result;
+  }
+
+  void parseUnicodeEscape() {
+    // Decodes a \u escape (with `pos` just past the 'u') to UTF-8 in the scratch buffer,
+    // combining surrogate pairs.
+
+    uint32_t codePoint = parseHex4();
+    if (codePoint >= 0xd800 && codePoint < 0xdc00 &&
+        end - pos >= 6 && pos[0] == '\\' && pos[1] == 'u') {
+      const char* highEnd = pos;
+      pos += 2;
+      uint32_t low = parseHex4();
+      if (low >= 0xdc00 && low < 0xe000) {
+        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+      } else {
+        // Not a pair after all; leave the second escape to be decoded on its own.
+        pos = highEnd;
+      }
+    }
+
+    auto& scratch = codec.scratch;
+    if (codePoint < 0x80) {
+      scratch.add(codePoint);
+    } else if (codePoint < 0x800) {
+      scratch.add(0xc0 | (codePoint >> 6));
+      scratch.add(0x80 | (codePoint & 0x3f));
+    } else if (codePoint < 0x10000) {
+      scratch.add(0xe0 | (codePoint >> 12));
+      scratch.add(0x80 | ((codePoint >> 6) & 0x3f));
+      scratch.add(0x80 | (codePoint & 0x3f));
+    } else {
+      scratch.add(0xf0 | (codePoint >> 18));
+      scratch.add(0x80 | ((codePoint >> 12) & 0x3f));
+      scratch.add(0x80 | ((codePoint >> 6) & 0x3f));
+      scratch.add(0x80 | (codePoint & 0x3f));
+    }
+  }
+
+  kj::ArrayPtr<const char> parseNumberToken() {
+    // Returns the text of a number, which may also be quoted.
+
+    skipWhitespace();
+    if (pos < end && *pos == '"') {
+      return parseString();
+    }
+
+    const char* start = pos;
+    while (pos < end && ((*pos >= '0' && *pos <= '9') ||
+                         *pos == '-' || *pos == '+' || *pos == '.' || *pos == 'e' || *pos == 'E')) {
+      ++pos;
+    }
+    KJ_REQUIRE(pos > start, "Invalid JSON: expected a value.", offset());
+    return kj::arrayPtr(start, pos);
+  }
+
+  uint64_t parseMagnitude(kj::ArrayPtr<const char> digits) {
+    KJ_REQUIRE(digits.size() > 0, "Invalid JSON: expected an integer.", offset());
+    const uint64_t max = kj::maxValue;
+    uint64_t result = 0;
+    for (char c: digits) {
+      KJ_REQUIRE(c >= '0' && c <= '9', "Expected an integer.", digits, offset());
+      uint digit = c - '0';
+      KJ_REQUIRE(result <= (max - digit) / 10, "Integer out of range.", digits, offset());
+      result = result * 10 + digit;
+    }
+    return result;
+  }
+
+  int64_t parseInteger() {
+    const int64_t max = kj::maxValue;
+    auto token = parseNumberToken();
+    if (token.size() > 0 && token[0] == '-') {
+      uint64_t magnitude = parseMagnitude(token.slice(1, token.size()));
+      KJ_REQUIRE(magnitude <= uint64_t(max) + 1,
+                 "Integer out of range.", token, offset());
+      return static_cast<int64_t>(0 - magnitude);
+    } else {
+      uint64_t magnitude = parseMagnitude(token);
+      KJ_REQUIRE(magnitude <= uint64_t(max),
+                 "Integer out of range.", token, offset());
+      return magnitude;
+    }
+  }
+
+  uint64_t parseUnsigned() {
+    return parseMagnitude(parseNumberToken());
+  }
+
+  double parseFloat() {
+    auto token = parseNumberToken();
+    if (matches(token, "NaN")) {
+      return nan("");
+    } else if (matches(token, "Infinity")) {
+      return INFINITY;
+    } else if (matches(token, "-Infinity")) {
+      return -INFINITY;
+    }
+
+    // strtod() needs a NUL terminator, which the input lacks.
+    char buffer[64];
+    KJ_REQUIRE(token.size() > 0 && token.size() < sizeof(buffer),
+               "Invalid JSON: expected a number.", offset());
+    memcpy(buffer, token.begin(), token.size());
+    buffer[token.size()] = '\0';
+    char* numberEnd;
+    double result = strtod(buffer, &numberEnd);
+    KJ_REQUIRE(numberEnd == buffer + token.size(), "Expected a number.", token, offset());
+    return result;
+  }
+
+  DynamicValue::Reader parsePrimitive(schema::Type::Which type) {
+    switch (type) {
+      case schema::Type::BOOL:
+        if (tryConsumeLiteral("true")) {
+          return true;
+        } else if (tryConsumeLiteral("false")) {
+          return false;
+        } else {
+          KJ_FAIL_REQUIRE("Expected true or false.", offset());
+        }
+      case schema::Type::INT8:
+      case schema::Type::INT16:
+      case schema::Type::INT32:
+      case schema::Type::INT64:
+        return parseInteger();
+      case schema::Type::UINT8:
+      case schema::Type::UINT16:
+      case schema::Type::UINT32:
+      case schema::Type::UINT64:
+        return parseUnsigned();
+      case schema::Type::FLOAT32:
+      case schema::Type::FLOAT64:
+        return parseFloat();
+      default:
+        KJ_FAIL_ASSERT("Not a primitive type.", (uint)type);
+    }
+  }
+
+  DynamicEnum parseEnum(EnumSchema schema) {
+    skipWhitespace();
+    if (pos < end && *pos == '"') {
+      // findEnumerantByName() needs a NUL-terminated name.
+      auto name = parseString();
+      auto& scratch = codec.scratch;
+      if (name.begin() != scratch.begin()) {
+        scratch.resize(0);
+        scratch.addAll(name);
+      }
+      scratch.add('\0');
+
+      KJ_IF_MAYBE(enumerant, schema.findEnumerantByName(
+          kj::StringPtr(scratch.begin(), scratch.size() - 1))) {
+        return DynamicEnum(*enumerant);
+      } else {
+        KJ_FAIL_REQUIRE("Unknown enumerant.", scratch.begin(), offset());
+      }
+    } else {
+      uint64_t raw = parseUnsigned();
+      KJ_REQUIRE(raw <= 0xffff, "Enum value out of range.", raw, offset());
+      return DynamicEnum(schema, raw);
+    }
+  }
+};
+
+class VectorOutputStream final: public kj::OutputStream {
+public:
+  explicit VectorOutputStream(kj::Vector<char>& vector): vector(vector) {}
+
+  void write(const void* buffer, size_t size) override {
+    auto chars = reinterpret_cast<const char*>(buffer);
+    vector.addAll(chars, chars + size);
+  }
+
+private:
+  kj::Vector<char>& vector;
+};
+
+}  // namespace
+
+struct JsonCodec::Impl {
+  CodecState state;
+};
+
+JsonCodec::JsonCodec(): impl(kj::heap<Impl>()) {}
+JsonCodec::~JsonCodec() noexcept(false) {}
+
+void JsonCodec::encode(DynamicStruct::Reader input, kj::OutputStream& output) {
+  Encoder encoder(impl->state, output);
+  encoder.encodeStruct(input);
+  encoder.flush();
+}
+
+kj::String JsonCodec::encode(DynamicStruct::Reader input) {
+  kj::Vector<char> result;
+  VectorOutputStream output(result);
+  encode(input, output);
+  result.add('\0');
+  return kj::String(result.releaseAsArray());
+}
+
+void JsonCodec::decode(kj::ArrayPtr<const char> input, DynamicStruct::Builder output) {
+  Decoder decoder(impl->state, input);
+  decoder.decodeRoot(output);
+}
+
+}  // namespace capnp
@@ -0,0 +1,86 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CAPNP_JSON_H_
+#define CAPNP_JSON_H_
+
+#include "dynamic.h"
+#include <kj/string.h>
+
+namespace kj { class OutputStream; }
+
+namespace capnp {
+
+class JsonCodec {
+  // Converts Cap'n Proto structs to and from JSON, guided by their schemas.  Encoding streams
+  // straight from a reader to an `OutputStream`, and decoding writes straight into a builder, so
+  // neither builds a JSON document tree in between.
+  //
+  // The mapping is:
+  // - Void is `null`.  Bool, Int8-32, UInt8-32 and floats are JSON booleans and numbers.
+  // - Int64 and UInt64 are encoded as strings, since many JSON parsers (notably JavaScript's)
+  //   lose precision above 2^53.  The decoder accepts either numbers or strings for any number.
+  // - Non-finite floats are the strings "NaN", "Infinity" and "-Infinity".
+  // - Text is a string.  Data is an array of byte values.
+  // - Enums are their enumerant names, or the raw number if the enumerant is unknown.  The
+  //   decoder accepts either.
+  // - Structs are objects keyed by field name.  Null pointer fields are omitted.  Of a union,
+  //   only the active member is encoded.  Groups are nested objects.
+  // - Lists are arrays.
+  // - Capabilities and AnyPointers are encoded as `null`, and only `null` is accepted for them.
+  //
+  // When decoding, unknown keys are skipped so that newer senders can talk to older receivers,
+  // and `null` leaves a field at its default.
+  //
+  // The codec builds a table for each struct type the first time it sees one (field names,
+  // pre-quoted keys, types) and reuses it, so keep a codec around rather than making one per
+  // message.  A JsonCodec is not thread-safe; use one per thread.
+
+public:
+  JsonCodec();
+  ~JsonCodec() noexcept(false);
+  KJ_DISALLOW_COPY(JsonCodec);
+
+  void encode(DynamicStruct::Reader input, kj::OutputStream& output);
+  // Write `input` as a single line of JSON.
+
+  kj::String encode(DynamicStruct::Reader input);
+  // Return `input` as a single line of JSON.
+
+  void decode(kj::ArrayPtr<const char> input, DynamicStruct::Builder output);
+  // Parse a JSON object into `output`, which should be freshly initialized: fields that the JSON
+  // doesn't mention keep whatever value they had.  Throws if the input isn't valid JSON or doesn't
+  // match the schema.
+
+  static constexpr uint MAX_NESTING_DEPTH = 64;
+  // Objects and arrays nested deeper than this are rejected, so that hostile input can't overflow
+  // the stack.
+
+private:
+  struct Impl;
+  kj::Own<Impl> impl;
+};
+
+}  // namespace capnp
+
+#endif  // CAPNP_JSON_H_
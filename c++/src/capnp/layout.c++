@@ -28,6 +28,7 @@
 #include "capability.h"
 #include <string.h>
 #include <stdlib.h>
+#include <algorithm>
 
 namespace capnp {
 namespace _ {  // private
@@ -42,6 +43,10 @@ void setGlobalBrokenCapFactoryForLayoutCpp(BrokenCapFactory& factory) {
   __atomic_store_n(&brokenCapFactory, &factory, __ATOMIC_RELAXED);
 }
 
+static constexpr WordCount64 MAX_RESERVE = (1ull << 29) * WORDS;
+// Largest deep copy for which we try to reserve a single segment.  Pointer offsets are 30-bit
+// signed word counts, so segments can't usefully be much bigger than this anyway.
+
 // =======================================================================================
 
 struct WirePointer {
@@ -310,7 +315,7 @@ struct WireHelpers {
 
   static KJ_ALWAYS_INLINE(word* allocate(
       WirePointer*& ref, SegmentBuilder*& segment, WordCount amount,
-      WirePointer::Kind kind, BuilderArena* orphanArena)) {
+      WirePointer::Kind kind, BuilderArena* orphanArena, WordCount reserve = 0 * WORDS)) {
     // Allocate space in the mesasge for a new object, creating far pointers if necessary.
     //
     // * `ref` starts out being a reference to the pointer which shall be assigned to point at the
@@ -330,6 +335,9 @@ struct WireHelpers {
     //   In this case, `segment` starts out null; the allocation takes place in an arbitrary
     //   segment belonging to the arena.  `ref` will be initialized as a non-far pointer, but its
     //   target offset will be set to zero.
+    // * `reserve` is the number of words the caller expects to allocate next, e.g. the children
+    //   of an object being deep-copied.  The object is placed in a segment with enough room left
+    //   for them too, so that the whole copy is contiguous and needs no further far pointers.
 
     if (orphanArena == nullptr) {
       if (!ref->isNull()) zeroObject(segment, ref);
@@ -341,14 +349,15 @@ struct WireHelpers {
         return reinterpret_cast<word*>(ref);
       }
 
-      word* ptr = segment->allocate(amount);
+      word* ptr = reserve == 0 * WORDS || segment->available() >= amount + reserve ?
+          segment->allocate(amount) : nullptr;
 
       if (ptr == nullptr) {
         // Need to allocate in a new segment.  We'll need to allocate an extra pointer worth of
         // space to act as the landing pad for a far pointer.
 
         WordCount amountPlusRef = amount + POINTER_SIZE_IN_WORDS;
-        auto allocation = segment->getArena()->allocate(amountPlusRef);
+        auto allocation = segment->getArena()->allocate(amountPlusRef, reserve);
         segment = allocation.segment;
         ptr = allocation.words;
 
@@ -369,14 +378,49 @@ struct WireHelpers {
     } else {
       // orphanArena is non-null.  Allocate an orphan.
       KJ_DASSERT(ref->isNull());
-      auto allocation = orphanArena->allocate(amount);
+      auto allocation = orphanArena->allocate(amount, reserve);
       segment = allocation.segment;
       ref->setKindForOrphan(kind);
       return allocation.words;
     }
   }
 
-  static KJ_ALWAYS_INLINE(word* followFars(
+  static WordCount64 copySizeOf(const StructReader& value) {
+    // Measure a deep copy ahead of time so that it can be reserved in one segment.  Values with no
+    // pointers have no children to reserve for, so they skip the traversal.
+    return value.pointerCount == 0 * POINTERS ? 0 * WORDS : value.totalSize().wordCount;
+  }
+
+  static WordCount64 copySizeOf(const ListReader& value) {
+    return value.structPointerCount == 0 * POINTERS ? 0 * WORDS : value.totalSize().wordCount;
+  }
+
+  static WordCount64 copySizeOf(SegmentReader* segment, const WirePointer* ref, int nestingLimit) {
+    if (ref == nullptr || ref->isNull()) {
+      return 0 * WORDS;
+    }
+
+    WordCount64 result = totalSize(segment, ref, nestingLimit).wordCount;
+    if (segment != nullptr) {
+      // Like StructReader::totalSize(), don't charge the read limit for the measuring pass.
+      segment->unread(result);
+    }
+    return result;
+  }
+
+  static KJ_ALWAYS_INLINE(WordCount reserveAfter(WordCount64 copySize, WordCount amount)) {
+    // Given the measured size of an entire deep copy, returns how much to reserve after
+    // allocating its root object of size `amount`.  Copies that could never fit in one segment get
+    // no reservation.
+
+    if (copySize <= amount || copySize > MAX_RESERVE) {
+      return 0 * WORDS;
+    } else {
+      return (copySize - amount) / WORDS * WORDS;
+    }
+  }
+
+  static KJ_ALWAYS_INLINE(word* followFarsNoWritableCheck(
       WirePointer*& ref, word* refTarget, SegmentBuilder*& segment)) {
     // If `ref` is a far pointer, follow it.  On return, `ref` will have been updated to point at
     // a WirePointer that contains the type information about the target object, and a pointer to
@@ -407,6 +451,15 @@ struct WireHelpers {
     }
   }
 
+  static KJ_ALWAYS_INLINE(word* followFars(
+      WirePointer*& ref, word* refTarget, SegmentBuilder*& segment)) {
+    // Like followFarsNoWritableCheck() but also throws if the target lies in an external,
+    // read-only segment.  Used by everything that is about to return a Builder.
+    word* result = followFarsNoWritableCheck(ref, refTarget, segment);
+    segment->checkWritable();
+    return result;
+  }
+
   static KJ_ALWAYS_INLINE(const word* followFars(
       const WirePointer*& ref, const word* refTarget, SegmentReader*& segment)) {
     // Like the other followFars() but operates on readers.
@@ -487,6 +540,10 @@ struct WireHelpers {
   }
 
   static void zeroObject(SegmentBuilder* segment, WirePointer* tag, word* ptr) {
+    // We shouldn't zero out external data linked into the message.  It can only be a blob, so
+    // there is nothing below it to zero either.
+    if (!segment->isWritable()) return;
+
     switch (tag->kind()) {
       case WirePointer::STRUCT: {
         WirePointer* pointerSection =
@@ -566,9 +623,11 @@ struct WireHelpers {
     // do not zero the object body.  Used when upgrading.
 
     if (ref->kind() == WirePointer::FAR) {
-      word* pad = segment->getArena()->getSegment(ref->farRef.segmentId.get())
-          ->getPtrUnchecked(ref->farPositionInSegment());
-      memset(pad, 0, sizeof(WirePointer) * (1 + ref->isDoubleFar()));
+      SegmentBuilder* padSegment = segment->getArena()->getSegment(ref->farRef.segmentId.get());
+      if (padSegment->isWritable()) {  // Don't zero external data.
+        word* pad = padSegment->getPtrUnchecked(ref->farPositionInSegment());
+        memset(pad, 0, sizeof(WirePointer) * (1 + ref->isDoubleFar()));
+      }
     }
     memset(ref, 0, sizeof(*ref));
   }
@@ -580,7 +639,7 @@ struct WireHelpers {
       SegmentReader* segment, const WirePointer* ref, int nestingLimit) {
     // Compute the total size of the object pointed to, not counting far pointer overhead.
 
-    MessageSizeCounts result = { 0 * WORDS, 0 };
+    MessageSizeCounts result = { 0 * WORDS, 0, false };
 
     if (ref->isNull()) {
       return result;
@@ -591,6 +650,10 @@ struct WireHelpers {
     }
     --nestingLimit;
 
+    if (ref->kind() == WirePointer::FAR) {
+      result.hasFarPointers = true;
+    }
+
     const word* ptr = followFars(ref, ref->target(), segment);
 
     switch (ref->kind()) {
@@ -670,13 +733,20 @@ struct WireHelpers {
             WordCount dataSize = elementTag->structRef.dataSize.get();
             WirePointerCount pointerCount = elementTag->structRef.ptrCount.get();
 
+            if (pointerCount == 0 * POINTERS) {
+              // Elements are pure data; the word count above already covers them.
+              break;
+            }
+
             const word* pos = ptr + POINTER_SIZE_IN_WORDS;
             for (uint i = 0; i < count / ELEMENTS; i++) {
               pos += dataSize;
 
               for (uint j = 0; j < pointerCount / POINTERS; j++) {
-                result += totalSize(segment, reinterpret_cast<const WirePointer*>(pos),
-                                    nestingLimit);
+                const WirePointer* element = reinterpret_cast<const WirePointer*>(pos);
+                if (!element->isNull()) {
+                  result += totalSize(segment, element, nestingLimit);
+                }
                 pos += POINTER_SIZE_IN_WORDS;
               }
             }
@@ -702,6 +772,377 @@ struct WireHelpers {
     return result;
   }
 
+  // -----------------------------------------------------------------
+  // Canonical sizes, structural equality, and hashing.
+
+  static uint64_t dataWord(const StructReader& value, uint index) {
+    // Get the index'th word of the struct's data section, zero-extended past its end.
+
+    if (value.dataSize == 1 * BITS) {
+      return index == 0 && value.getDataField<bool>(0 * ELEMENTS);
+    }
+
+    uint bytes = value.dataSize / BITS_PER_BYTE / BYTES;
+    uint offset = index * sizeof(uint64_t);
+    if (offset >= bytes) {
+      return 0;
+    }
+
+    uint64_t result = 0;
+    memcpy(&result, reinterpret_cast<const byte*>(value.data) + offset,
+           kj::min(bytes - offset, uint(sizeof(uint64_t))));
+    return result;
+  }
+
+  static uint canonicalDataWords(const StructReader& value) {
+    uint count = roundBitsUpToWords(value.dataSize) / WORDS;
+    while (count > 0 && dataWord(value, count - 1) == 0) {
+      --count;
+    }
+    return count;
+  }
+
+  static uint canonicalPointerCount(const StructReader& value) {
+    uint count = value.pointerCount / POINTERS;
+    while (count > 0 && value.pointers[count - 1].isNull()) {
+      --count;
+    }
+    return count;
+  }
+
+  static StructReader getStructElementUnchecked(const ListReader& list, uint index) {
+    // Like ListReader::getStructElement(), but without consuming nesting depth.
+
+    BitCount64 indexBit = ElementCount64(index * ELEMENTS) * list.step;
+    const byte* structData = list.ptr + indexBit / BITS_PER_BYTE;
+    return StructReader(list.segment, structData,
+        reinterpret_cast<const WirePointer*>(structData + list.structDataSize / BITS_PER_BYTE),
+        list.structDataSize, list.structPointerCount, indexBit % BITS_PER_BYTE,
+        list.nestingLimit);
+  }
+
+  struct PointerTarget {
+    // A pointer's decoded target, as needed for structural comparison.
+
+    enum Kind { NONE, STRUCT, LIST, CAPABILITY };
+    Kind kind = NONE;
+    StructReader structValue;
+    ListReader listValue;
+    FieldSize elementSize = FieldSize::VOID;
+    Arena* capArena = nullptr;
+    uint capIndex = 0;
+  };
+
+  static PointerTarget readTarget(
+      SegmentReader* segment, const WirePointer* ref, int nestingLimit) {
+    // Decode and bounds-check `ref`.  Null pointers, including `ref == nullptr`, and invalid
+    // pointers come back as NONE.
+
+    PointerTarget result;
+
+    if (ref == nullptr || ref->isNull()) {
+      return result;
+    }
+
+    KJ_REQUIRE(nestingLimit > 0,
+               "Message is too deeply-nested or contains cycles.  See capnp::ReadOptions.") {
+      return result;
+    }
+
+    const word* ptr = followFars(ref, ref->target(), segment);
+    if (KJ_UNLIKELY(ptr == nullptr)) {
+      // Already reported the error.
+      return result;
+    }
+
+    switch (ref->kind()) {
+      case WirePointer::STRUCT:
+        KJ_REQUIRE(boundsCheck(segment, ptr, ptr + ref->structRef.wordSize()),
+                   "Message contained out-of-bounds struct pointer.") {
+          return result;
+        }
+
+        result.kind = PointerTarget::STRUCT;
+        result.structValue = StructReader(segment, ptr,
+            reinterpret_cast<const WirePointer*>(ptr + ref->structRef.dataSize.get()),
+            ref->structRef.dataSize.get() * BITS_PER_WORD, ref->structRef.ptrCount.get(),
+            0 * BITS, nestingLimit - 1);
+        return result;
+
+      case WirePointer::LIST: {
+        FieldSize elementSize = ref->listRef.elementSize();
+
+        if (elementSize == FieldSize::INLINE_COMPOSITE) {
+          WordCount wordCount = ref->listRef.inlineCompositeWordCount();
+          const WirePointer* tag = reinterpret_cast<const WirePointer*>(ptr);
+          ptr += POINTER_SIZE_IN_WORDS;
+
+          KJ_REQUIRE(boundsCheck(segment, ptr - POINTER_SIZE_IN_WORDS, ptr + wordCount),
+                     "Message contains out-of-bounds list pointer.") {
+            return result;
+          }
+
+          KJ_REQUIRE(tag->kind() == WirePointer::STRUCT,
+                     "INLINE_COMPOSITE lists of non-STRUCT type are not supported.") {
+            return result;
+          }
+
+          ElementCount elementCount = tag->inlineCompositeListElementCount();
+          auto wordsPerElement = tag->structRef.wordSize() / ELEMENTS;
+
+          KJ_REQUIRE(wordsPerElement * elementCount <= wordCount,
+                     "INLINE_COMPOSITE list's elements overrun its word count.") {
+            return result;
+          }
+
+          result.listValue = ListReader(segment, ptr, elementCount,
+              wordsPerElement * BITS_PER_WORD, tag->structRef.dataSize.get() * BITS_PER_WORD,
+              tag->structRef.ptrCount.get(), nestingLimit - 1);
+        } else {
+          BitCount dataSize = dataBitsPerElement(elementSize) * ELEMENTS;
+          WirePointerCount pointerCount = pointersPerElement(elementSize) * ELEMENTS;
+          auto step = (dataSize + pointerCount * BITS_PER_POINTER) / ELEMENTS;
+          ElementCount elementCount = ref->listRef.elementCount();
+          WordCount wordCount = roundBitsUpToWords(ElementCount64(elementCount) * step);
+
+          KJ_REQUIRE(boundsCheck(segment, ptr, ptr + wordCount),
+                     "Message contains out-of-bounds list pointer.") {
+            return result;
+          }
+
+          result.listValue = ListReader(segment, ptr, elementCount, step, dataSize, pointerCount,
+                                        nestingLimit - 1);
+        }
+
+        result.kind = PointerTarget::LIST;
+        result.elementSize = elementSize;
+        return result;
+      }
+
+      case WirePointer::FAR:
+        KJ_FAIL_ASSERT("Far pointer should have been handled above.") {
+          return result;
+        }
+
+      case WirePointer::OTHER:
+        KJ_REQUIRE(ref->isCapability(), "Unknown pointer type.") {
+          return result;
+        }
+
+        result.kind = PointerTarget::CAPABILITY;
+        result.capArena = segment == nullptr ? nullptr : segment->getArena();
+        result.capIndex = ref->capRef.index.get();
+        return result;
+    }
+
+    KJ_UNREACHABLE;
+  }
+
+  static bool structEquals(const StructReader& a, const StructReader& b) {
+    if (a.segment == b.segment && a.data == b.data && a.pointers == b.pointers &&
+        a.dataSize == b.dataSize && a.pointerCount == b.pointerCount &&
+        a.bit0Offset == b.bit0Offset) {
+      // Same object.
+      return true;
+    }
+
+    if (a.dataSize == b.dataSize && a.dataSize % BITS_PER_BYTE == 0 * BITS) {
+      if (memcmp(a.data, b.data, a.dataSize / BITS_PER_BYTE / BYTES) != 0) {
+        return false;
+      }
+    } else {
+      uint dataWords =
+          kj::max(roundBitsUpToWords(a.dataSize), roundBitsUpToWords(b.dataSize)) / WORDS;
+      for (uint i = 0; i < dataWords; i++) {
+        if (dataWord(a, i) != dataWord(b, i)) {
+          return false;
+        }
+      }
+    }
+
+    uint aCount = a.pointerCount / POINTERS;
+    uint bCount = b.pointerCount / POINTERS;
+    uint pointerCount = kj::max(aCount, bCount);
+    for (uint i = 0; i < pointerCount; i++) {
+      if (!pointerEquals(a.segment, i < aCount ? a.pointers + i : nullptr, a.nestingLimit,
+                         b.segment, i < bCount ? b.pointers + i : nullptr, b.nestingLimit)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  static bool listEquals(const ListReader& a, const ListReader& b, FieldSize elementSize) {
+    if (a.elementCount != b.elementCount) {
+      return false;
+    }
+
+    uint count = a.elementCount / ELEMENTS;
+
+    switch (elementSize) {
+      case FieldSize::VOID:
+        return true;
+
+      case FieldSize::BIT:
+      case FieldSize::BYTE:
+      case FieldSize::TWO_BYTES:
+      case FieldSize::FOUR_BYTES:
+      case FieldSize::EIGHT_BYTES: {
+        uint bits = count * a.step * ELEMENTS / BITS;
+        if (memcmp(a.ptr, b.ptr, bits / 8) != 0) {
+          return false;
+        }
+        if (bits % 8 != 0) {
+          byte mask = (1u << (bits % 8)) - 1;
+          return (a.ptr[bits / 8] & mask) == (b.ptr[bits / 8] & mask);
+        }
+        return true;
+      }
+
+      case FieldSize::POINTER:
+        for (uint i = 0; i < count; i++) {
+          if (!pointerEquals(a.segment, reinterpret_cast<const WirePointer*>(a.ptr) + i,
+                             a.nestingLimit,
+                             b.segment, reinterpret_cast<const WirePointer*>(b.ptr) + i,
+                             b.nestingLimit)) {
+            return false;
+          }
+        }
+        return true;
+
+      case FieldSize::INLINE_COMPOSITE:
+        for (uint i = 0; i < count; i++) {
+          if (!structEquals(a.getStructElement(i * ELEMENTS), b.getStructElement(i * ELEMENTS))) {
+            return false;
+          }
+        }
+        return true;
+    }
+
+    KJ_UNREACHABLE;
+  }
+
+  static bool pointerEquals(SegmentReader* aSegment, const WirePointer* a, int aNestingLimit,
+                            SegmentReader* bSegment, const WirePointer* b, int bNestingLimit) {
+    PointerTarget aTarget = readTarget(aSegment, a, aNestingLimit);
+    PointerTarget bTarget = readTarget(bSegment, b, bNestingLimit);
+
+    if (aTarget.kind != bTarget.kind) {
+      return false;
+    }
+
+    switch (aTarget.kind) {
+      case PointerTarget::NONE:
+        return true;
+      case PointerTarget::STRUCT:
+        return structEquals(aTarget.structValue, bTarget.structValue);
+      case PointerTarget::LIST:
+        return aTarget.elementSize == bTarget.elementSize &&
+            listEquals(aTarget.listValue, bTarget.listValue, aTarget.elementSize);
+      case PointerTarget::CAPABILITY:
+        return aTarget.capArena == bTarget.capArena && aTarget.capIndex == bTarget.capIndex;
+    }
+
+    KJ_UNREACHABLE;
+  }
+
+  static inline uint64_t hashCombine(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+  }
+
+  static uint64_t structHash(const StructReader& value) {
+    uint dataWords = canonicalDataWords(value);
+    uint pointerCount = canonicalPointerCount(value);
+
+    uint64_t result = hashCombine(PointerTarget::STRUCT, dataWords);
+    result = hashCombine(result, pointerCount);
+    for (uint i = 0; i < dataWords; i++) {
+      result = hashCombine(result, dataWord(value, i));
+    }
+    for (uint i = 0; i < pointerCount; i++) {
+      result = hashCombine(result,
+          pointerHash(value.segment, value.pointers + i, value.nestingLimit));
+    }
+    return result;
+  }
+
+  static uint64_t listHash(const ListReader& value, FieldSize elementSize) {
+    uint count = value.elementCount / ELEMENTS;
+    uint64_t result = hashCombine(PointerTarget::LIST, static_cast<uint>(elementSize));
+    result = hashCombine(result, count);
+
+    switch (elementSize) {
+      case FieldSize::VOID:
+        break;
+
+      case FieldSize::BIT:
+      case FieldSize::BYTE:
+      case FieldSize::TWO_BYTES:
+      case FieldSize::FOUR_BYTES:
+      case FieldSize::EIGHT_BYTES: {
+        uint bytes = count * value.step * ELEMENTS / BITS / 8;
+        uint extraBits = count * value.step * ELEMENTS / BITS % 8;
+        uint offset = 0;
+        for (; offset + sizeof(uint64_t) <= bytes; offset += sizeof(uint64_t)) {
+          uint64_t chunk;
+          memcpy(&chunk, value.ptr + offset, sizeof(chunk));
+          result = hashCombine(result, chunk);
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, value.ptr + offset, bytes - offset);
+        if (extraBits != 0) {
+          reinterpret_cast<byte*>(&tail)[bytes - offset] =
+              value.ptr[bytes] & ((1u << extraBits) - 1);
+        }
+        result = hashCombine(result, tail);
+        break;
+      }
+
+      case FieldSize::POINTER:
+        for (uint i = 0; i < count; i++) {
+          result = hashCombine(result, pointerHash(value.segment,
+              reinterpret_cast<const WirePointer*>(value.ptr) + i, value.nestingLimit));
+        }
+        break;
+
+      case FieldSize::INLINE_COMPOSITE:
+        for (uint i = 0; i < count; i++) {
+          result = hashCombine(result, structHash(value.getStructElement(i * ELEMENTS)));
+        }
+        break;
+    }
+
+    return result;
+  }
+
+  static uint64_t pointerHash(SegmentReader* segment, const WirePointer* ref, int nestingLimit) {
+    PointerTarget target = readTarget(segment, ref, nestingLimit);
+
+    switch (target.kind) {
+      case PointerTarget::NONE:
+        return 0;
+      case PointerTarget::STRUCT:
+        return structHash(target.structValue);
+      case PointerTarget::LIST:
+        return listHash(target.listValue, target.elementSize);
+      case PointerTarget::CAPABILITY:
+        return hashCombine(PointerTarget::CAPABILITY, target.capIndex);
+    }
+
+    KJ_UNREACHABLE;
+  }
+
+  static uint64_t finishHash(uint64_t h) {
+    // Final avalanche (MurmurHash3 fmix64) so that the low bits are usable as a bucket index.
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
   // -----------------------------------------------------------------
   // Copy from an unchecked message.
 
@@ -1508,23 +1949,36 @@ struct WireHelpers {
 
   static SegmentAnd<word*> setStructPointer(
       SegmentBuilder* segment, WirePointer* ref, StructReader value,
-      BuilderArena* orphanArena = nullptr) {
+      BuilderArena* orphanArena = nullptr, bool canonical = false,
+      WordCount64 copySize = 0 * WORDS) {
     WordCount dataSize = roundBitsUpToWords(value.dataSize);
-    WordCount totalSize = dataSize + value.pointerCount * WORDS_PER_POINTER;
+    WirePointerCount pointerCount = value.pointerCount;
+
+    if (canonical) {
+      // Canonical form drops trailing zero data words and trailing null pointers.
+      dataSize = canonicalDataWords(value) * WORDS;
+      pointerCount = canonicalPointerCount(value) * POINTERS;
+    }
+
+    WordCount totalSize = dataSize + pointerCount * WORDS_PER_POINTER;
 
-    word* ptr = allocate(ref, segment, totalSize, WirePointer::STRUCT, orphanArena);
-    ref->structRef.set(dataSize, value.pointerCount);
+    word* ptr = allocate(ref, segment, totalSize, WirePointer::STRUCT, orphanArena,
+                         reserveAfter(copySize, totalSize));
+    ref->structRef.set(dataSize, pointerCount);
 
     if (value.dataSize == 1 * BITS) {
-      *reinterpret_cast<char*>(ptr) = value.getDataField<bool>(0 * ELEMENTS);
+      if (dataSize > 0 * WORDS) {
+        *reinterpret_cast<char*>(ptr) = value.getDataField<bool>(0 * ELEMENTS);
+      }
     } else {
-      memcpy(ptr, value.data, value.dataSize / BITS_PER_BYTE / BYTES);
+      memcpy(ptr, value.data, kj::min(value.dataSize / BITS_PER_BYTE / BYTES,
+                                       dataSize * BYTES_PER_WORD / BYTES));
     }
 
     WirePointer* pointerSection = reinterpret_cast<WirePointer*>(ptr + dataSize);
-    for (uint i = 0; i < value.pointerCount / POINTERS; i++) {
+    for (uint i = 0; i < pointerCount / POINTERS; i++) {
       copyPointer(segment, pointerSection + i, value.segment, value.pointers + i,
-                  value.nestingLimit);
+                  value.nestingLimit, nullptr, canonical);
     }
 
     return { segment, ptr };
@@ -1542,12 +1996,14 @@ struct WireHelpers {
 
   static SegmentAnd<word*> setListPointer(
       SegmentBuilder* segment, WirePointer* ref, ListReader value,
-      BuilderArena* orphanArena = nullptr) {
+      BuilderArena* orphanArena = nullptr, bool canonical = false,
+      WordCount64 copySize = 0 * WORDS) {
     WordCount totalSize = roundBitsUpToWords(value.elementCount * value.step);
 
     if (value.step * ELEMENTS <= BITS_PER_WORD * WORDS) {
       // List of non-structs.
-      word* ptr = allocate(ref, segment, totalSize, WirePointer::LIST, orphanArena);
+      word* ptr = allocate(ref, segment, totalSize, WirePointer::LIST, orphanArena,
+                           reserveAfter(copySize, totalSize));
 
       if (value.structPointerCount == 1 * POINTERS) {
         // List of pointers.
@@ -1555,7 +2011,7 @@ struct WireHelpers {
         for (uint i = 0; i < value.elementCount / ELEMENTS; i++) {
           copyPointer(segment, reinterpret_cast<WirePointer*>(ptr) + i,
                       value.segment, reinterpret_cast<const WirePointer*>(value.ptr) + i,
-                      value.nestingLimit);
+                      value.nestingLimit, nullptr, canonical);
         }
       } else {
         // List of data.
@@ -1573,53 +2029,98 @@ struct WireHelpers {
         }
 
         ref->listRef.set(elementSize, value.elementCount);
-        memcpy(ptr, value.ptr, totalSize * BYTES_PER_WORD / BYTES);
+        if (canonical) {
+          // Copy only the elements themselves so that padding bits come out zero.
+          uint bits = value.elementCount * value.step / BITS;
+          memcpy(ptr, value.ptr, bits / 8);
+          if (bits % 8 != 0) {
+            reinterpret_cast<byte*>(ptr)[bits / 8] =
+                value.ptr[bits / 8] & ((1u << (bits % 8)) - 1);
+          }
+        } else {
+          memcpy(ptr, value.ptr, totalSize * BYTES_PER_WORD / BYTES);
+        }
       }
 
       return { segment, ptr };
     } else {
-      // List of structs.
-      word* ptr = allocate(ref, segment, totalSize + POINTER_SIZE_IN_WORDS, WirePointer::LIST,
-                           orphanArena);
-      ref->listRef.setInlineComposite(totalSize);
+      return setStructListPointer(segment, ref, value, orphanArena, canonical, copySize);
+    }
+  }
+
+  static SegmentAnd<word*> setStructListPointer(
+      SegmentBuilder* segment, WirePointer* ref, ListReader value,
+      BuilderArena* orphanArena = nullptr, bool canonical = false,
+      WordCount64 copySize = 0 * WORDS) {
+    // Copy `value` as an INLINE_COMPOSITE list.  setListPointer() can only infer the encoding from
+    // the element step, so copyPointer() calls this directly for lists it knows are struct lists
+    // (which matters when the elements happen to be exactly one word).
 
-      WordCount dataSize = roundBitsUpToWords(value.structDataSize);
-      WirePointerCount pointerCount = value.structPointerCount;
+    WordCount totalSize = roundBitsUpToWords(value.elementCount * value.step);
 
-      WirePointer* tag = reinterpret_cast<WirePointer*>(ptr);
-      tag->setKindAndInlineCompositeListElementCount(WirePointer::STRUCT, value.elementCount);
-      tag->structRef.set(dataSize, pointerCount);
-      word* dst = ptr + POINTER_SIZE_IN_WORDS;
+    WordCount srcDataSize = roundBitsUpToWords(value.structDataSize);
+    WordCount dataSize = srcDataSize;
+    WirePointerCount pointerCount = value.structPointerCount;
 
-      const word* src = reinterpret_cast<const word*>(value.ptr);
+    if (canonical) {
+      // All elements share one layout, so the canonical element size is the largest truncated
+      // size of any element.
+      uint maxDataWords = 0;
+      uint maxPointers = 0;
       for (uint i = 0; i < value.elementCount / ELEMENTS; i++) {
-        memcpy(dst, src, value.structDataSize / BITS_PER_BYTE / BYTES);
-        dst += dataSize;
-        src += dataSize;
-
-        for (uint j = 0; j < pointerCount / POINTERS; j++) {
-          copyPointer(segment, reinterpret_cast<WirePointer*>(dst),
-              value.segment, reinterpret_cast<const WirePointer*>(src), value.nestingLimit);
-          dst += POINTER_SIZE_IN_WORDS;
-          src += POINTER_SIZE_IN_WORDS;
-        }
+        StructReader element = getStructElementUnchecked(value, i);
+        maxDataWords = kj::max(maxDataWords, canonicalDataWords(element));
+        maxPointers = kj::max(maxPointers, canonicalPointerCount(element));
       }
+      dataSize = maxDataWords * WORDS;
+      pointerCount = maxPointers * POINTERS;
+      totalSize = (dataSize + pointerCount * WORDS_PER_POINTER) / ELEMENTS * value.elementCount;
+    }
 
-      return { segment, ptr };
+    word* ptr = allocate(ref, segment, totalSize + POINTER_SIZE_IN_WORDS, WirePointer::LIST,
+                         orphanArena, reserveAfter(copySize, totalSize + POINTER_SIZE_IN_WORDS));
+    ref->listRef.setInlineComposite(totalSize);
+
+    WirePointer* tag = reinterpret_cast<WirePointer*>(ptr);
+    tag->setKindAndInlineCompositeListElementCount(WirePointer::STRUCT, value.elementCount);
+    tag->structRef.set(dataSize, pointerCount);
+    word* dst = ptr + POINTER_SIZE_IN_WORDS;
+
+    const word* src = reinterpret_cast<const word*>(value.ptr);
+    for (uint i = 0; i < value.elementCount / ELEMENTS; i++) {
+      memcpy(dst, src, kj::min(value.structDataSize / BITS_PER_BYTE / BYTES,
+                               dataSize * BYTES_PER_WORD / BYTES));
+      dst += dataSize;
+      src += srcDataSize;
+
+      for (uint j = 0; j < pointerCount / POINTERS; j++) {
+        copyPointer(segment, reinterpret_cast<WirePointer*>(dst),
+            value.segment, reinterpret_cast<const WirePointer*>(src), value.nestingLimit,
+            nullptr, canonical);
+        dst += POINTER_SIZE_IN_WORDS;
+        src += POINTER_SIZE_IN_WORDS;
+      }
+
+      src += (value.structPointerCount - pointerCount) * WORDS_PER_POINTER;
     }
+
+    return { segment, ptr };
   }
 
   static KJ_ALWAYS_INLINE(SegmentAnd<word*> copyPointer(
       SegmentBuilder* dstSegment, WirePointer* dst,
       SegmentReader* srcSegment, const WirePointer* src,
-      int nestingLimit, BuilderArena* orphanArena = nullptr)) {
-    return copyPointer(dstSegment, dst, srcSegment, src, src->target(), nestingLimit, orphanArena);
+      int nestingLimit, BuilderArena* orphanArena = nullptr, bool canonical = false,
+      WordCount64 copySize = 0 * WORDS)) {
+    return copyPointer(dstSegment, dst, srcSegment, src, src->target(), nestingLimit, orphanArena,
+                       canonical, copySize);
   }
 
   static SegmentAnd<word*> copyPointer(
       SegmentBuilder* dstSegment, WirePointer* dst,
       SegmentReader* srcSegment, const WirePointer* src, const word* srcTarget,
-      int nestingLimit, BuilderArena* orphanArena = nullptr) {
+      int nestingLimit, BuilderArena* orphanArena = nullptr, bool canonical = false,
+      WordCount64 copySize = 0 * WORDS) {
     // Deep-copy the object pointed to by src into dst.  It turns out we can't reuse
     // readStructPointer(), etc. because they do type checking whereas here we want to accept any
     // valid pointer.
@@ -1653,7 +2154,7 @@ struct WireHelpers {
                          src->structRef.dataSize.get() * BITS_PER_WORD,
                          src->structRef.ptrCount.get(),
                          0 * BITS, nestingLimit - 1),
-            orphanArena);
+            orphanArena, canonical, copySize);
 
       case WirePointer::LIST: {
         FieldSize elementSize = src->listRef.elementSize();
@@ -1686,11 +2187,11 @@ struct WireHelpers {
             goto useDefault;
           }
 
-          return setListPointer(dstSegment, dst,
+          return setStructListPointer(dstSegment, dst,
               ListReader(srcSegment, ptr, elementCount, wordsPerElement * BITS_PER_WORD,
                          tag->structRef.dataSize.get() * BITS_PER_WORD,
                          tag->structRef.ptrCount.get(), nestingLimit - 1),
-              orphanArena);
+              orphanArena, canonical, copySize);
         } else {
           BitCount dataSize = dataBitsPerElement(elementSize) * ELEMENTS;
           WirePointerCount pointerCount = pointersPerElement(elementSize) * ELEMENTS;
@@ -1706,7 +2207,7 @@ struct WireHelpers {
           return setListPointer(dstSegment, dst,
               ListReader(srcSegment, ptr, elementCount, step, dataSize, pointerCount,
                          nestingLimit - 1),
-              orphanArena);
+              orphanArena, canonical, copySize);
         }
       }
 
@@ -1720,6 +2221,10 @@ struct WireHelpers {
           goto useDefault;
         }
 
+        KJ_REQUIRE(!canonical, "Cannot create a canonical message with a capability.") {
+          goto useDefault;
+        }
+
         KJ_IF_MAYBE(cap, srcSegment->getArena()->extractCap(src->capRef.index.get())) {
           setCapabilityPointer(dstSegment, dst, kj::mv(*cap), orphanArena);
           return { dstSegment, nullptr };
@@ -1768,7 +2273,7 @@ struct WireHelpers {
       location = reinterpret_cast<word*>(ref);  // dummy so that it is non-null
     } else {
       WirePointer* refCopy = ref;
-      location = followFars(refCopy, ref->target(), segment);
+      location = followFarsNoWritableCheck(refCopy, ref->target(), segment);
     }
 
     OrphanBuilder result(ref, segment, location);
@@ -2157,12 +2662,14 @@ Data::Builder PointerBuilder::getBlob<Data>(const void* defaultValue, ByteCount
   return WireHelpers::getWritableDataPointer(pointer, segment, defaultValue, defaultSize);
 }
 
-void PointerBuilder::setStruct(const StructReader& value) {
-  WireHelpers::setStructPointer(segment, pointer, value);
+void PointerBuilder::setStruct(const StructReader& value, bool canonical) {
+  WireHelpers::setStructPointer(segment, pointer, value, nullptr, canonical,
+                                WireHelpers::copySizeOf(value));
 }
 
-void PointerBuilder::setList(const ListReader& value) {
-  WireHelpers::setListPointer(segment, pointer, value);
+void PointerBuilder::setList(const ListReader& value, bool canonical) {
+  WireHelpers::setListPointer(segment, pointer, value, nullptr, canonical,
+                              WireHelpers::copySizeOf(value));
 }
 
 kj::Own<ClientHook> PointerBuilder::getCapability() {
@@ -2195,8 +2702,10 @@ void PointerBuilder::transferFrom(PointerBuilder other) {
   WireHelpers::transferPointer(segment, pointer, other.segment, other.pointer);
 }
 
-void PointerBuilder::copyFrom(PointerReader other) {
-  WireHelpers::copyPointer(segment, pointer, other.segment, other.pointer, other.nestingLimit);
+void PointerBuilder::copyFrom(PointerReader other, bool canonical) {
+  auto size = WireHelpers::copySizeOf(other.segment, other.pointer, other.nestingLimit);
+  WireHelpers::copyPointer(segment, pointer, other.segment, other.pointer, other.nestingLimit,
+                           nullptr, canonical, size);
 }
 
 PointerReader PointerBuilder::asReader() const {
@@ -2257,6 +2766,15 @@ MessageSizeCounts PointerReader::targetSize() const {
   return WireHelpers::totalSize(segment, pointer, nestingLimit);
 }
 
+bool PointerReader::equals(const PointerReader& other) const {
+  return WireHelpers::pointerEquals(segment, pointer, nestingLimit,
+                                    other.segment, other.pointer, other.nestingLimit);
+}
+
+uint64_t PointerReader::hash() const {
+  return WireHelpers::finishHash(WireHelpers::pointerHash(segment, pointer, nestingLimit));
+}
+
 bool PointerReader::isNull() const {
   return pointer == nullptr || pointer->isNull();
 }
@@ -2357,6 +2875,26 @@ void StructBuilder::copyContentFrom(StructReader other) {
   }
 }
 
+bool StructBuilder::copyDataFrom(StructReader other) {
+  if (other.data == data) {
+    // Copying onto ourselves; the pointer copies would free the very objects they read from.
+    return false;
+  }
+
+  if (dataSize != other.dataSize || pointerCount != other.pointerCount) {
+    // Different versions of the type.  Let the generic path sort out the overlap.
+    copyContentFrom(other);
+    return false;
+  }
+
+  if (dataSize == 1 * BITS) {
+    setDataField<bool>(0 * ELEMENTS, other.getDataField<bool>(0 * ELEMENTS));
+  } else {
+    memcpy(data, other.data, dataSize / BITS_PER_BYTE / BYTES);
+  }
+  return true;
+}
+
 StructReader StructBuilder::asReader() const {
   return StructReader(segment, data, pointers,
       dataSize, pointerCount, bit0Offset, kj::maxValue);
@@ -2371,7 +2909,7 @@ BuilderArena* StructBuilder::getArena() {
 
 MessageSizeCounts StructReader::totalSize() const {
   MessageSizeCounts result = {
-    WireHelpers::roundBitsUpToWords(dataSize) + pointerCount * WORDS_PER_POINTER, 0 };
+    WireHelpers::roundBitsUpToWords(dataSize) + pointerCount * WORDS_PER_POINTER, 0, false };
 
   for (uint i = 0; i < pointerCount / POINTERS; i++) {
     result += WireHelpers::totalSize(segment, pointers + i, nestingLimit);
@@ -2386,6 +2924,60 @@ MessageSizeCounts StructReader::totalSize() const {
   return result;
 }
 
+void StructReader::getNonNullPointers(kj::ArrayPtr<uint64_t> bits) const {
+  // A WirePointer is null exactly when all 64 of its bits are zero, so there is no need to decode
+  // anything.  The inner loop has no branches and vectorizes.
+  static_assert(sizeof(WirePointer) == sizeof(uint64_t), "WirePointer is not one word?");
+  const uint64_t* raw = reinterpret_cast<const uint64_t*>(pointers);
+  size_t count = kj::min(size_t(pointerCount / POINTERS), bits.size() * 64);
+
+  for (size_t i = 0; i < bits.size(); i++) {
+    size_t start = i * 64;
+    size_t end = kj::min(start + 64, kj::max(start, count));
+    uint64_t word = 0;
+    for (size_t j = start; j < end; j++) {
+      word |= uint64_t(raw[j] != 0) << (j - start);
+    }
+    bits[i] = word;
+  }
+}
+
+bool StructReader::equals(const StructReader& other) const {
+  return WireHelpers::structEquals(*this, other);
+}
+
+uint64_t StructReader::hash() const {
+  return WireHelpers::finishHash(WireHelpers::structHash(*this));
+}
+
+MessageSizeCounts ListReader::totalSize() const {
+  MessageSizeCounts result = {
+    WireHelpers::roundBitsUpToWords(ElementCount64(elementCount) * step), 0, false };
+
+  if (step * ELEMENTS > BITS_PER_WORD * WORDS) {
+    // A copy of a struct list is INLINE_COMPOSITE, which adds a tag word.
+    result.wordCount += POINTER_SIZE_IN_WORDS;
+  }
+
+  if (structPointerCount > 0 * POINTERS) {
+    for (uint i = 0; i < elementCount / ELEMENTS; i++) {
+      const byte* element = ptr + i * ELEMENTS * step / BITS_PER_BYTE;
+      const WirePointer* elementPointers =
+          reinterpret_cast<const WirePointer*>(element + structDataSize / BITS_PER_BYTE);
+      for (uint j = 0; j < structPointerCount / POINTERS; j++) {
+        result += WireHelpers::totalSize(segment, elementPointers + j, nestingLimit);
+      }
+    }
+  }
+
+  if (segment != nullptr) {
+    // As in StructReader::totalSize(), this traversal should not count against the read limit.
+    segment->unread(result.wordCount);
+  }
+
+  return result;
+}
+
 // =======================================================================================
 // ListBuilder
 
@@ -2542,7 +3134,8 @@ OrphanBuilder OrphanBuilder::initData(BuilderArena* arena, ByteCount size) {
 
 OrphanBuilder OrphanBuilder::copy(BuilderArena* arena, StructReader copyFrom) {
   OrphanBuilder result;
-  auto allocation = WireHelpers::setStructPointer(nullptr, result.tagAsPtr(), copyFrom, arena);
+  auto allocation = WireHelpers::setStructPointer(nullptr, result.tagAsPtr(), copyFrom, arena,
+                                                  false, WireHelpers::copySizeOf(copyFrom));
   result.segment = allocation.segment;
   result.location = reinterpret_cast<word*>(allocation.value);
   return result;
@@ -2550,7 +3143,8 @@ OrphanBuilder OrphanBuilder::copy(BuilderArena* arena, StructReader copyFrom) {
 
 OrphanBuilder OrphanBuilder::copy(BuilderArena* arena, ListReader copyFrom) {
   OrphanBuilder result;
-  auto allocation = WireHelpers::setListPointer(nullptr, result.tagAsPtr(), copyFrom, arena);
+  auto allocation = WireHelpers::setListPointer(nullptr, result.tagAsPtr(), copyFrom, arena,
+                                                false, WireHelpers::copySizeOf(copyFrom));
   result.segment = allocation.segment;
   result.location = reinterpret_cast<word*>(allocation.value);
   return result;
@@ -2559,7 +3153,8 @@ OrphanBuilder OrphanBuilder::copy(BuilderArena* arena, ListReader copyFrom) {
 OrphanBuilder OrphanBuilder::copy(BuilderArena* arena, PointerReader copyFrom) {
   OrphanBuilder result;
   auto allocation = WireHelpers::copyPointer(
-      nullptr, result.tagAsPtr(), copyFrom.segment, copyFrom.pointer, copyFrom.nestingLimit, arena);
+      nullptr, result.tagAsPtr(), copyFrom.segment, copyFrom.pointer, copyFrom.nestingLimit, arena,
+      false, WireHelpers::copySizeOf(copyFrom.segment, copyFrom.pointer, copyFrom.nestingLimit));
   result.segment = allocation.segment;
   result.location = reinterpret_cast<word*>(allocation.value);
   return result;
@@ -2583,6 +3178,33 @@ OrphanBuilder OrphanBuilder::copy(BuilderArena* arena, Data::Reader copyFrom) {
   return result;
 }
 
+OrphanBuilder OrphanBuilder::referenceExternalData(BuilderArena* arena, Data::Reader data) {
+  KJ_REQUIRE(reinterpret_cast<uintptr_t>(data.begin()) % sizeof(void*) == 0,
+             "Cannot referenceExternalData() that is not aligned.");
+  KJ_REQUIRE(data.size() < (1u << 29), "Lists are limited to 2**29 elements.");
+
+  ByteCount byteSize = data.size() * BYTES;
+  kj::ArrayPtr<const word> words(reinterpret_cast<const word*>(data.begin()),
+                                 WireHelpers::roundBytesUpToWords(byteSize) / WORDS);
+
+  OrphanBuilder result;
+  result.tagAsPtr()->setKindForOrphan(WirePointer::LIST);
+  result.tagAsPtr()->listRef.set(FieldSize::BYTE, byteSize * (1 * ELEMENTS / BYTES));
+  result.segment = arena->addExternalSegment(words);
+
+  // const_cast OK here because we will check whether the segment is writable when we try to get
+  // a builder.
+  result.location = const_cast<word*>(words.begin());
+
+  return result;
+}
+
+OrphanBuilder OrphanBuilder::referenceExternalText(BuilderArena* arena, Text::Reader text) {
+  // Text::Reader guarantees a NUL terminator at end(), which becomes part of the byte list.
+  return referenceExternalData(arena,
+      Data::Reader(reinterpret_cast<const byte*>(text.begin()), text.size() + 1));
+}
+
 OrphanBuilder OrphanBuilder::copy(BuilderArena* arena, kj::Own<ClientHook> copyFrom) {
   OrphanBuilder result;
   WireHelpers::setCapabilityPointer(nullptr, result.tagAsPtr(), kj::mv(copyFrom), arena);
@@ -2669,6 +3291,93 @@ Data::Reader OrphanBuilder::asDataReader() const {
   return WireHelpers::readDataPointer(segment, tagAsPtr(), location, nullptr, 0 * BYTES);
 }
 
+void OrphanBuilder::truncate(ElementCount size, bool isText) {
+  if (isText) size += 1 * ELEMENTS;  // NUL terminator
+
+  if (location == nullptr && tagAsPtr()->isPositional()) {
+    // Null orphan.
+    KJ_REQUIRE(size == (isText ? 1 : 0) * ELEMENTS, "Can't truncate() a list to a larger size.");
+    return;
+  }
+
+  WirePointer* ref = tagAsPtr();
+  SegmentBuilder* segment = this->segment;
+  word* target = WireHelpers::followFars(ref, location, segment);
+
+  KJ_REQUIRE(ref->kind() == WirePointer::LIST, "Can't truncate() a non-list.") {
+    return;
+  }
+
+  word* oldEnd;
+  word* newEnd;
+
+  FieldSize elementSize = ref->listRef.elementSize();
+  if (elementSize == FieldSize::INLINE_COMPOSITE) {
+    WirePointer* elementTag = reinterpret_cast<WirePointer*>(target);
+    KJ_ASSERT(elementTag->kind() == WirePointer::STRUCT,
+              "Don't know how to handle non-STRUCT inline composite.");
+
+    ElementCount oldSize = elementTag->inlineCompositeListElementCount();
+    KJ_REQUIRE(size <= oldSize, "Can't truncate() a list to a larger size.") {
+      return;
+    }
+
+    WordCount dataSize = elementTag->structRef.dataSize.get();
+    WirePointerCount pointerCount = elementTag->structRef.ptrCount.get();
+    auto wordsPerElement = elementTag->structRef.wordSize() / ELEMENTS;
+
+    word* elements = target + POINTER_SIZE_IN_WORDS;
+    newEnd = elements + size * wordsPerElement;
+    oldEnd = elements + oldSize * wordsPerElement;
+
+    for (word* pos = newEnd; pos < oldEnd; pos += wordsPerElement * ELEMENTS) {
+      WirePointer* pointers = reinterpret_cast<WirePointer*>(pos + dataSize);
+      for (uint j = 0; j < pointerCount / POINTERS; j++) {
+        WireHelpers::zeroObject(segment, pointers + j);
+      }
+    }
+
+    ref->listRef.setInlineComposite(size * wordsPerElement);
+    elementTag->setKindAndInlineCompositeListElementCount(WirePointer::STRUCT, size);
+    memset(newEnd, 0, intervalLength(newEnd, oldEnd) * BYTES_PER_WORD / BYTES);
+  } else {
+    ElementCount oldSize = ref->listRef.elementCount();
+    KJ_REQUIRE(size <= oldSize, "Can't truncate() a list to a larger size.") {
+      return;
+    }
+
+    if (elementSize == FieldSize::POINTER) {
+      WirePointer* pointers = reinterpret_cast<WirePointer*>(target);
+      for (uint i = size / ELEMENTS; i < oldSize / ELEMENTS; i++) {
+        WireHelpers::zeroObject(segment, pointers + i);
+      }
+    }
+
+    auto step = dataBitsPerElement(elementSize) +
+                pointersPerElement(elementSize) * BITS_PER_POINTER;
+    BitCount64 newBits = ElementCount64(size) * step;
+    BitCount64 oldBits = ElementCount64(oldSize) * step;
+    newEnd = target + WireHelpers::roundBitsUpToWords(newBits);
+    oldEnd = target + WireHelpers::roundBitsUpToWords(oldBits);
+
+    // Zero everything from the first dropped bit to the end of the old list, including any
+    // leftover bits of a partial byte (bit lists only).  Text also needs a new NUL terminator.
+    byte* bytes = reinterpret_cast<byte*>(target);
+    uint64_t newBitCount = newBits / BITS;
+    size_t firstZeroByte = (newBitCount + 7) / 8;
+    if (isText) --firstZeroByte;
+    if (newBitCount % 8 != 0) {
+      bytes[newBitCount / 8] &= (1 << (newBitCount % 8)) - 1;
+    }
+    memset(bytes + firstZeroByte, 0,
+           intervalLength(target, oldEnd) * BYTES_PER_WORD / BYTES - firstZeroByte);
+
+    ref->listRef.set(elementSize, size);
+  }
+
+  segment->tryTruncate(oldEnd, newEnd);
+}
+
 void OrphanBuilder::euthanize() {
   // Carefully catch any exceptions and rethrow them as recoverable exceptions since we may be in
   // a destructor.
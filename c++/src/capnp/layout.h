@@ -167,10 +167,14 @@ inline constexpr FieldSize elementSizeForType() {
 struct MessageSizeCounts {
   WordCount64 wordCount;
   uint capCount;
+  bool hasFarPointers;
+  // True if any pointer in the traversed tree is a far pointer.  Such a tree cannot be read
+  // in-place by an unchecked reader.
 
   MessageSizeCounts& operator+=(const MessageSizeCounts& other) {
     wordCount += other.wordCount;
     capCount += other.capCount;
+    hasFarPointers = hasFarPointers || other.hasFarPointers;
     return *this;
   }
 
@@ -312,12 +316,15 @@ public:
   // Init methods:  Initialize the pointer to a newly-allocated object, discarding the existing
   // object.
 
-  void setStruct(const StructReader& value);
-  void setList(const ListReader& value);
+  void setStruct(const StructReader& value, bool canonical = false);
+  void setList(const ListReader& value, bool canonical = false);
   template <typename T> void setBlob(typename T::Reader value);
   void setCapability(kj::Own<ClientHook>&& cap);
   // Set methods:  Initialize the pointer to a newly-allocated copy of the given value, discarding
-  // the existing object.
+  // the existing object.  If `canonical` is true, the copy is written in canonical form: trailing
+  // zero data words and trailing null pointers are truncated, list padding is zeroed, and
+  // capabilities are rejected.  Combined with a single-segment builder, this produces the
+  // canonical encoding of the value.
 
   void adopt(OrphanBuilder&& orphan);
   // Set the pointer to point at the given orphaned value.
@@ -331,7 +338,7 @@ public:
   void transferFrom(PointerBuilder other);
   // Equivalent to `adopt(other.disown())`.
 
-  void copyFrom(PointerReader other);
+  void copyFrom(PointerReader other, bool canonical = false);
   // Equivalent to `set(other.get())`.
 
   PointerReader asReader() const;
@@ -368,6 +375,10 @@ public:
   // use the result as a hint for allocating the first segment, do the copy, and then throw an
   // exception if it overruns.
 
+  bool equals(const PointerReader& other) const;
+  uint64_t hash() const;
+  // Structural equality and hashing of the target objects; see StructReader::equals().
+
   bool isNull() const;
 
   StructReader getStruct(const word* defaultValue) const;
@@ -459,6 +470,12 @@ public:
   // copied, meaning there is a risk of data loss when copying from messages built with future
   // versions of the protocol.
 
+  bool copyDataFrom(StructReader other);
+  // Fast path for generated `copyFrom()` methods.  If `other` has exactly the same section sizes
+  // as this struct, copies its data section with a single memcpy and returns true, leaving the
+  // caller to copy each pointer.  Otherwise, does the same as copyContentFrom() and returns false.
+  // Copying a struct over itself is a no-op and returns false.
+
   StructReader asReader() const;
   // Gets a StructReader pointing at the same memory.
 
@@ -523,6 +540,12 @@ public:
   // Get a reader for a pointer field given the index within the pointer section.  If the index
   // is out-of-bounds, returns a null pointer.
 
+  void getNonNullPointers(kj::ArrayPtr<uint64_t> bits) const;
+  // Sets bit i of `bits` (least-significant bit of bits[0] first) if pointer i is non-null, and
+  // clears every other bit, including those past the end of the pointer section.  Scans the
+  // section a word at a time, which is much cheaper than calling getPointerField(i).isNull()
+  // for each pointer of a wide struct.
+
   MessageSizeCounts totalSize() const;
   // Return the total size of the struct and everything to which it points.  Does not count far
   // pointer overhead.  This is useful for deciding how much space is needed to copy the struct
@@ -530,6 +553,17 @@ public:
   // use the result as a hint for allocating the first segment, do the copy, and then throw an
   // exception if it overruns.
 
+  bool equals(const StructReader& other) const;
+  // Returns true if the two structs would have identical canonical encodings, i.e. they have
+  // the same data (treating a missing tail of the data section as zeros), the same pointers
+  // (treating missing pointers as null), and recursively equal targets.  Lists are equal only if
+  // they have the same element size and count.  Neither side needs to be canonical.  A
+  // capability is equal only to a pointer to the same capability table entry of the same message.
+
+  uint64_t hash() const;
+  // Hash consistent with equals():  structs that compare equal hash the same regardless of how
+  // they are encoded.  The hash is not stable across CPU endianness and should not be persisted.
+
 private:
   SegmentReader* segment;  // Memory segment in which the struct resides.
 
@@ -604,6 +638,12 @@ public:
       ElementCount index, kj::NoInfer<T> value));
   // Set the element at the given index.
 
+  template <typename T>
+  KJ_ALWAYS_INLINE(kj::Maybe<kj::ArrayPtr<WireValue<T>>> getDenseDataElements());
+  // If the elements are tightly packed values of type T -- i.e. this is not a struct list being
+  // accessed as a list of primitives -- returns them as a contiguous array, for bulk access.
+  // Otherwise returns null.  Always null for bit and void lists.
+
   KJ_ALWAYS_INLINE(PointerBuilder getPointerElement(ElementCount index));
 
   StructBuilder getStructElement(ElementCount index);
@@ -658,10 +698,19 @@ public:
   KJ_ALWAYS_INLINE(T getDataElement(ElementCount index) const);
   // Get the element of the given type at the given index.
 
+  template <typename T>
+  KJ_ALWAYS_INLINE(kj::Maybe<kj::ArrayPtr<const WireValue<T>>> getDenseDataElements() const);
+  // Like ListBuilder::getDenseDataElements().
+
   KJ_ALWAYS_INLINE(PointerReader getPointerElement(ElementCount index) const);
 
   StructReader getStructElement(ElementCount index) const;
 
+  MessageSizeCounts totalSize() const;
+  // Return the total size of the list and everything to which its elements point, as it would be
+  // if copied (including the tag word of a struct list).  Like StructReader::totalSize(), this
+  // is a hint for allocation, not a trustworthy value.
+
 private:
   SegmentReader* segment;  // Memory segment in which the list resides.
 
@@ -719,6 +768,10 @@ public:
   static OrphanBuilder copy(BuilderArena* arena, Data::Reader copyFrom);
   static OrphanBuilder copy(BuilderArena* arena, kj::Own<ClientHook> copyFrom);
 
+  static OrphanBuilder referenceExternalData(BuilderArena* arena, Data::Reader data);
+  static OrphanBuilder referenceExternalText(BuilderArena* arena, Text::Reader text);
+  // Make an orphan byte list backed by caller-owned memory; see Orphanage::referenceExternalData().
+
   OrphanBuilder& operator=(const OrphanBuilder& other) = delete;
   inline OrphanBuilder& operator=(OrphanBuilder&& other);
 
@@ -745,6 +798,10 @@ public:
   Text::Reader asTextReader() const;
   Data::Reader asDataReader() const;
 
+  void truncate(ElementCount size, bool isText);
+  // Shrink a list or blob in place; see Orphan::truncate().  For text, `size` excludes the NUL
+  // terminator.
+
 private:
   static_assert(1 * POINTERS * WORDS_PER_POINTER == 1 * WORDS,
                 "This struct assumes a pointer is one word.");
@@ -979,6 +1036,25 @@ inline void ListBuilder::setDataElement<bool>(ElementCount index, bool value) {
 template <>
 inline void ListBuilder::setDataElement<Void>(ElementCount index, Void value) {}
 
+template <typename T>
+inline kj::Maybe<kj::ArrayPtr<WireValue<T>>> ListBuilder::getDenseDataElements() {
+  if (step == bitsPerElement<T>()) {
+    return kj::arrayPtr(reinterpret_cast<WireValue<T>*>(ptr), elementCount / ELEMENTS);
+  } else {
+    return nullptr;
+  }
+}
+
+template <>
+inline kj::Maybe<kj::ArrayPtr<WireValue<bool>>> ListBuilder::getDenseDataElements<bool>() {
+  return nullptr;
+}
+
+template <>
+inline kj::Maybe<kj::ArrayPtr<WireValue<Void>>> ListBuilder::getDenseDataElements<Void>() {
+  return nullptr;
+}
+
 inline PointerBuilder ListBuilder::getPointerElement(ElementCount index) {
   return PointerBuilder(segment,
       reinterpret_cast<WirePointer*>(ptr + index * step / BITS_PER_BYTE));
@@ -1006,6 +1082,27 @@ inline Void ListReader::getDataElement<Void>(ElementCount index) const {
   return VOID;
 }
 
+template <typename T>
+inline kj::Maybe<kj::ArrayPtr<const WireValue<T>>> ListReader::getDenseDataElements() const {
+  if (step == bitsPerElement<T>()) {
+    return kj::arrayPtr(reinterpret_cast<const WireValue<T>*>(ptr), elementCount / ELEMENTS);
+  } else {
+    return nullptr;
+  }
+}
+
+template <>
+inline kj::Maybe<kj::ArrayPtr<const WireValue<bool>>>
+    ListReader::getDenseDataElements<bool>() const {
+  return nullptr;
+}
+
+template <>
+inline kj::Maybe<kj::ArrayPtr<const WireValue<Void>>>
+    ListReader::getDenseDataElements<Void>() const {
+  return nullptr;
+}
+
 inline PointerReader ListReader::getPointerElement(ElementCount index) const {
   return PointerReader(segment,
       reinterpret_cast<const WirePointer*>(ptr + index * step / BITS_PER_BYTE), nestingLimit);
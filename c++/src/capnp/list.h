@@ -115,6 +115,43 @@ struct List<T, Kind::PRIMITIVE> {
       return reader.template getDataElement<T>(index * ELEMENTS);
     }
 
+    kj::Maybe<kj::ArrayPtr<const T>> asArrayPtr() const {
+      // Returns the list's contents as a native array, without copying, if the native and wire
+      // representations are the same.  This is the case on little-endian hosts (and for byte-sized
+      // types everywhere), except for lists of bools and for struct lists that are being read as
+      // lists of primitives (which happens when an old schema reads a list written by a newer
+      // one).  Otherwise returns null; use copyTo() instead.
+
+      if (!_::WireIsNative_<_::WireValue<T>>::value) return nullptr;
+      if (size() == 0) return kj::ArrayPtr<const T>();
+      KJ_IF_MAYBE(elements, reader.template getDenseDataElements<T>()) {
+        return kj::arrayPtr(reinterpret_cast<const T*>(elements->begin()), elements->size());
+      } else {
+        return nullptr;
+      }
+    }
+
+    void copyTo(kj::ArrayPtr<T> output) const {
+      // Copies the whole list into `output`, which must have exactly size() elements.  This is a
+      // memcpy() when the representations match and a vectorizable byte-swapping loop on
+      // big-endian hosts, so it is much faster than indexing element-by-element.
+
+      // Checked even in release builds (unlike KJ_IREQUIRE), since a mismatch would overrun the
+      // array.
+      if (KJ_UNLIKELY(output.size() != size())) {
+        ::kj::_::inlineRequireFailure(__FILE__, __LINE__, "output.size() == size()",
+            "\"Output array must be the same size as the list.\"",
+            "Output array must be the same size as the list.");
+      }
+      KJ_IF_MAYBE(elements, reader.template getDenseDataElements<T>()) {
+        _::copyFromWire(output.begin(), elements->begin(), elements->size());
+      } else {
+        for (uint i = 0; i < output.size(); i++) {
+          output[i] = reader.template getDataElement<T>(i * ELEMENTS);
+        }
+      }
+    }
+
     typedef _::IndexingIterator<const Reader, T> Iterator;
     inline Iterator begin() const { return Iterator(this, 0); }
     inline Iterator end() const { return Iterator(this, size()); }
@@ -156,6 +193,40 @@ struct List<T, Kind::PRIMITIVE> {
       builder.template setDataElement<T>(index * ELEMENTS, value);
     }
 
+    kj::Maybe<kj::ArrayPtr<T>> asArrayPtr() {
+      // Returns the list's contents as a mutable native array.  See Reader::asArrayPtr().
+
+      if (!_::WireIsNative_<_::WireValue<T>>::value) return nullptr;
+      if (size() == 0) return kj::ArrayPtr<T>();
+      KJ_IF_MAYBE(elements, builder.template getDenseDataElements<T>()) {
+        return kj::arrayPtr(reinterpret_cast<T*>(elements->begin()), elements->size());
+      } else {
+        return nullptr;
+      }
+    }
+
+    void copyTo(kj::ArrayPtr<T> output) { asReader().copyTo(output); }
+    // See Reader::copyTo().
+
+    void setFrom(kj::ArrayPtr<const T> values) {
+      // Overwrites the whole list with `values`, which must have exactly size() elements.  The
+      // inverse of copyTo(), with the same performance characteristics.
+
+      // Checked even in release builds; see Reader::copyTo().
+      if (KJ_UNLIKELY(values.size() != size())) {
+        ::kj::_::inlineRequireFailure(__FILE__, __LINE__, "values.size() == size()",
+            "\"Input array must be the same size as the list.\"",
+            "Input array must be the same size as the list.");
+      }
+      KJ_IF_MAYBE(elements, builder.template getDenseDataElements<T>()) {
+        _::copyToWire(elements->begin(), values.begin(), values.size());
+      } else {
+        for (uint i = 0; i < values.size(); i++) {
+          builder.template setDataElement<T>(i * ELEMENTS, values[i]);
+        }
+      }
+    }
+
     typedef _::IndexingIterator<Builder, T> Iterator;
     inline Iterator begin() { return Iterator(this, 0); }
     inline Iterator end() { return Iterator(this, size()); }
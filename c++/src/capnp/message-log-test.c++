@@ -0,0 +1,277 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "message-log.h"
+#include "test-util.h"
+#include <kj/debug.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace capnp {
+namespace _ {  // private
+namespace {
+
+kj::AutoCloseFd makeTempFile() {
+  char filename[] = "/tmp/capnproto-message-log-test-XXXXXX";
+  kj::AutoCloseFd fd(mkstemp(filename));
+  KJ_ASSERT(fd.get() >= 0);
+
+  // Unlink the file so that it will be deleted on close.
+  KJ_SYSCALL(unlink(filename));
+  return kj::mv(fd);
+}
+
+void appendNumbered(MessageLogWriter& writer, uint count) {
+  for (uint i = 0; i < count; i++) {
+    MallocMessageBuilder builder;
+    builder.initRoot<TestAllTypes>().setUInt32Field(writer.size());
+    writer.append(builder);
+  }
+}
+
+uint32_t numberOf(MessageReader& reader) {
+  return reader.getRoot<TestAllTypes>().getUInt32Field();
+}
+
+TEST(MessageLog, WriteAndRead) {
+  auto data = makeTempFile();
+  auto index = makeTempFile();
+
+  {
+    MessageLogWriter writer(data, index);
+
+    MallocMessageBuilder builder;
+    initTestMessage(builder.initRoot<TestAllTypes>());
+    EXPECT_EQ(0u, writer.append(builder));
+
+    appendNumbered(writer, 99);
+    EXPECT_EQ(100u, writer.size());
+  }
+
+  MessageLogReader reader(data, index);
+  ASSERT_EQ(100u, reader.size());
+
+  checkTestMessage(reader.get(0)->getRoot<TestAllTypes>());
+  EXPECT_EQ(57u, numberOf(*reader.get(57)));
+  EXPECT_EQ(99u, numberOf(*reader.get(99)));
+  EXPECT_ANY_THROW(reader.get(100));
+
+  auto range = reader.getRange(10, 20);
+  ASSERT_EQ(10u, range.size());
+  for (uint i = 0; i < range.size(); i++) {
+    EXPECT_EQ(10 + i, numberOf(*range[i]));
+  }
+  EXPECT_EQ(0u, reader.getRange(100, 100).size());
+  EXPECT_ANY_THROW(reader.getRange(90, 101));
+
+  // The data file is an ordinary message stream.
+  MmapMessageFileReader stream(data);
+  KJ_IF_MAYBE(first, stream.nextMessage()) {
+    checkTestMessage((*first)->getRoot<TestAllTypes>());
+  } else {
+    ADD_FAILURE() << "Expected first message.";
+  }
+  KJ_IF_MAYBE(second, stream.nextMessage()) {
+    EXPECT_EQ(1u, numberOf(**second));
+  } else {
+    ADD_FAILURE() << "Expected second message.";
+  }
+
+  auto words = reader.getWords(1);
+  FlatArrayMessageReader raw(words);
+  EXPECT_EQ(1u, numberOf(raw));
+  EXPECT_TRUE(raw.getEnd() == words.end());
+}
+
+TEST(MessageLog, SyncInterval) {
+  auto data = makeTempFile();
+  auto index = makeTempFile();
+
+  MessageLogWriter writer(data, index, 4);
+  MessageLogReader reader(data, index);
+  EXPECT_EQ(0u, reader.size());
+  EXPECT_FALSE(reader.refresh());
+
+  // Nothing is visible until a batch fills up.
+  appendNumbered(writer, 3);
+  EXPECT_EQ(3u, writer.size());
+  EXPECT_EQ(0u, writer.getSyncedCount());
+  EXPECT_FALSE(reader.refresh());
+
+  appendNumbered(writer, 1);
+  EXPECT_EQ(4u, writer.getSyncedCount());
+  EXPECT_TRUE(reader.refresh());
+  EXPECT_EQ(4u, reader.size());
+
+  appendNumbered(writer, 1);
+  EXPECT_FALSE(reader.refresh());
+  writer.sync();
+  EXPECT_TRUE(reader.refresh());
+  EXPECT_EQ(5u, reader.size());
+  EXPECT_EQ(4u, numberOf(*reader.get(4)));
+}
+
+TEST(MessageLog, ReadWhileAppending) {
+  auto data = makeTempFile();
+  auto index = makeTempFile();
+
+  MessageLogWriter writer(data, index, 1);
+  appendNumbered(writer, 1);
+
+  MessageLogReader reader(data, index);
+  ASSERT_EQ(1u, reader.size());
+  auto first = reader.get(0);
+
+  // Readers obtained before a refresh() stay valid even though the log gets remapped.
+  for (uint i = 0; i < 50; i++) {
+    appendNumbered(writer, 10);
+    EXPECT_TRUE(reader.refresh());
+    EXPECT_EQ(writer.size(), reader.size());
+    EXPECT_EQ(reader.size() - 1, numberOf(*reader.get(reader.size() - 1)));
+  }
+  EXPECT_EQ(0u, numberOf(*first));
+
+  // ...and even outlive the MessageLogReader.
+  kj::Own<MessageReader> last;
+  {
+    MessageLogReader other(data, index);
+    last = other.get(other.size() - 1);
+  }
+  EXPECT_EQ(500u, numberOf(*last));
+}
+
+TEST(MessageLog, SingleWriter) {
+  auto data = makeTempFile();
+  auto index = makeTempFile();
+
+  kj::String dataPath = kj::str("/proc/self/fd/", data.get());
+  if (access(dataPath.cStr(), F_OK) != 0) {
+    // Can't open a second description of an unlinked file without /proc.
+    return;
+  }
+
+  MessageLogWriter writer(data, index);
+  kj::AutoCloseFd data2(open(dataPath.cStr(), O_RDWR));
+  ASSERT_GE(data2.get(), 0);
+  EXPECT_ANY_THROW(MessageLogWriter(data2, index));
+}
+
+TEST(MessageLog, Recovery) {
+  auto data = makeTempFile();
+  auto index = makeTempFile();
+
+  {
+    MessageLogWriter writer(data, index);
+    appendNumbered(writer, 5);
+  }
+
+  struct stat stats;
+  KJ_SYSCALL(fstat(data, &stats));
+  off_t goodSize = stats.st_size;
+
+  // Simulate a crash after two more messages reached the data file but not the index, and a
+  // third was torn halfway through.
+  {
+    MallocMessageBuilder builder;
+    builder.initRoot<TestAllTypes>().setUInt32Field(5);
+    writeMessageToFd(data, builder);
+    builder.getRoot<TestAllTypes>().setUInt32Field(6);
+    writeMessageToFd(data, builder);
+
+    KJ_SYSCALL(fstat(data, &stats));
+    goodSize = stats.st_size;
+
+    builder.getRoot<TestAllTypes>().setUInt32Field(7);
+    auto words = messageToFlatArray(builder);
+    KJ_SYSCALL(write(data, words.begin(), words.size() * sizeof(word) / 2));
+  }
+  KJ_SYSCALL(ftruncate(index, 4 * sizeof(word) + 3));
+
+  {
+    MessageLogReader reader(data, index);
+    EXPECT_EQ(4u, reader.size());
+  }
+
+  {
+    MessageLogWriter writer(data, index);
+    EXPECT_EQ(7u, writer.size());
+    EXPECT_EQ(7u, writer.getSyncedCount());
+
+    KJ_SYSCALL(fstat(data, &stats));
+    EXPECT_EQ(goodSize, stats.st_size);
+
+    appendNumbered(writer, 1);
+  }
+
+  MessageLogReader reader(data, index);
+  ASSERT_EQ(8u, reader.size());
+  for (uint i = 0; i < reader.size(); i++) {
+    EXPECT_EQ(i, numberOf(*reader.get(i)));
+  }
+}
+
+TEST(MessageLog, FailedAppend) {
+  auto data = makeTempFile();
+  auto index = makeTempFile();
+
+  MessageLogWriter writer(data, index);
+  appendNumbered(writer, 2);
+
+  struct stat stats;
+  KJ_SYSCALL(fstat(data, &stats));
+  off_t goodSize = stats.st_size;
+
+  // Cap the file size so that the next append is torn partway through.
+  struct rlimit oldLimit;
+  KJ_SYSCALL(getrlimit(RLIMIT_FSIZE, &oldLimit));
+  struct rlimit limit = oldLimit;
+  limit.rlim_cur = goodSize + 16;
+  auto oldHandler = signal(SIGXFSZ, SIG_IGN);
+  KJ_SYSCALL(setrlimit(RLIMIT_FSIZE, &limit));
+  EXPECT_ANY_THROW(appendNumbered(writer, 1));
+  KJ_SYSCALL(setrlimit(RLIMIT_FSIZE, &oldLimit));
+  signal(SIGXFSZ, oldHandler);
+
+  EXPECT_EQ(2u, writer.size());
+  KJ_SYSCALL(fstat(data, &stats));
+  EXPECT_EQ(goodSize, stats.st_size);
+
+  appendNumbered(writer, 1);
+  writer.sync();
+
+  MessageLogReader reader(data, index);
+  ASSERT_EQ(3u, reader.size());
+  for (uint i = 0; i < reader.size(); i++) {
+    EXPECT_EQ(i, numberOf(*reader.get(i)));
+  }
+}
+
+}  // namespace
+}  // namespace _ (private)
+}  // namespace capnp
@@ -0,0 +1,350 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "message-log.h"
+#include "endian.h"
+#include <kj/debug.h>
+#include <kj/refcount.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace capnp {
+
+namespace {
+
+void preadFully(int fd, void* buffer, size_t size, uint64_t offset) {
+  byte* pos = reinterpret_cast<byte*>(buffer);
+  while (size > 0) {
+    ssize_t n;
+    KJ_SYSCALL(n = pread(fd, pos, size, offset));
+    KJ_REQUIRE(n > 0, "Message log file ended prematurely.");
+    pos += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+void pwriteFully(int fd, const void* buffer, size_t size, uint64_t offset) {
+  const byte* pos = reinterpret_cast<const byte*>(buffer);
+  while (size > 0) {
+    ssize_t n;
+    KJ_SYSCALL(n = pwrite(fd, pos, size, offset));
+    pos += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+void syncData(int fd) {
+#if __linux__
+  KJ_SYSCALL(fdatasync(fd));
+#else
+  KJ_SYSCALL(fsync(fd));
+#endif
+}
+
+uint64_t sizeInWords(int fd) {
+  struct stat stats;
+  KJ_SYSCALL(fstat(fd, &stats));
+  KJ_REQUIRE(S_ISREG(stats.st_mode), "Message log must be a regular file.");
+  return stats.st_size / sizeof(word);
+}
+
+kj::Maybe<uint64_t> completeMessageSize(int fd, uint64_t offset, uint64_t limit) {
+  // Returns the size in words of the message starting at word `offset` of the file, or null if
+  // the message does not fit entirely before word `limit` or its segment table is implausible.
+
+  if (limit - offset < 1) {
+    return nullptr;
+  }
+
+  _::WireValue<uint32_t> firstWord[2];
+  preadFully(fd, firstWord, sizeof(firstWord), offset * sizeof(word));
+
+  uint segmentCount = firstWord[0].get() + 1;
+  if (segmentCount == 0 || segmentCount >= 512 || firstWord[1].get() == 0) {
+    // A real first segment always holds at least the root pointer, so a zero size here means
+    // we're looking at zero-filled space left behind by a crash, not a message.
+    return nullptr;
+  }
+
+  uint64_t tableWords = segmentCount / 2 + 1;
+  if (limit - offset < tableWords) {
+    return nullptr;
+  }
+
+  auto table = kj::heapArray<_::WireValue<uint32_t>>(tableWords * 2);
+  preadFully(fd, table.begin(), tableWords * sizeof(word), offset * sizeof(word));
+
+  uint64_t total = tableWords;
+  for (uint i = 0; i < segmentCount; i++) {
+    total += table[i + 1].get();
+  }
+
+  if (limit - offset < total) {
+    return nullptr;
+  }
+  return total;
+}
+
+}  // namespace
+
+// =======================================================================================
+
+MessageLogWriter::MessageLogWriter(int dataFd, int indexFd, uint syncInterval)
+    : dataFd(dataFd), indexFd(indexFd), syncInterval(syncInterval),
+      syncedCount(0), dataEnd(0) {
+  KJ_SYSCALL(flock(dataFd, LOCK_EX | LOCK_NB), "Message log is already open for writing.");
+
+  KJ_ON_SCOPE_FAILURE(flock(dataFd, LOCK_UN));
+  recover();
+}
+
+MessageLogWriter::~MessageLogWriter() noexcept(false) {
+  unwindDetector.catchExceptionsIfUnwinding([&]() {
+    KJ_DEFER(flock(dataFd, LOCK_UN));
+    sync();
+  });
+}
+
+void MessageLogWriter::recover() {
+  uint64_t dataWords = sizeInWords(dataFd);
+  uint64_t indexWords = sizeInWords(indexFd);
+
+  // Drop index entries pointing past the end of the data, which can only be left behind if the
+  // data file was truncated behind our back.
+  syncedCount = indexWords;
+  while (syncedCount > 0) {
+    _::WireValue<uint64_t> entry;
+    preadFully(indexFd, &entry, sizeof(entry), (syncedCount - 1) * sizeof(word));
+    if (entry.get() <= dataWords) {
+      dataEnd = entry.get();
+      break;
+    }
+    --syncedCount;
+  }
+
+  // Index any complete messages written after the last sync.
+  for (;;) {
+    KJ_IF_MAYBE(size, completeMessageSize(dataFd, dataEnd, dataWords)) {
+      dataEnd += *size;
+      pending.add(dataEnd);
+    } else {
+      break;
+    }
+  }
+
+  // Cut off whatever is left: a torn message in the data file, a torn entry in the index.
+  struct stat stats;
+  KJ_SYSCALL(fstat(dataFd, &stats));
+  if (uint64_t(stats.st_size) != dataEnd * sizeof(word)) {
+    KJ_SYSCALL(ftruncate(dataFd, dataEnd * sizeof(word)));
+  }
+  KJ_SYSCALL(fstat(indexFd, &stats));
+  if (uint64_t(stats.st_size) != syncedCount * sizeof(word)) {
+    KJ_SYSCALL(ftruncate(indexFd, syncedCount * sizeof(word)));
+  }
+
+  KJ_SYSCALL(lseek(dataFd, dataEnd * sizeof(word), SEEK_SET));
+  sync();
+}
+
+uint64_t MessageLogWriter::append(MessageBuilder& builder) {
+  return append(builder.getSegmentsForOutput());
+}
+
+uint64_t MessageLogWriter::append(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
+  KJ_REQUIRE(segments.size() > 0 && segments[0].size() > 0,
+             "Can't append an empty message to a message log.");
+
+  {
+    // writeMessageToFd() writes at the fd's offset.  If it fails partway, cut off whatever it
+    // managed to write and seek back, so the file and its offset still agree with `dataEnd`.
+    KJ_ON_SCOPE_FAILURE({
+      off_t end = dataEnd * sizeof(word);
+      if (ftruncate(dataFd, end) < 0 || lseek(dataFd, end, SEEK_SET) < 0) {
+        KJ_LOG(ERROR, "couldn't roll back partial append to message log", errno);
+      }
+    });
+    writeMessageToFd(dataFd, segments);
+  }
+  dataEnd += computeSerializedSizeInWords(segments);
+  pending.add(dataEnd);
+
+  uint64_t result = size() - 1;
+  if (syncInterval > 0 && pending.size() >= syncInterval) {
+    sync();
+  }
+  return result;
+}
+
+void MessageLogWriter::sync() {
+  if (pending.size() == 0) {
+    return;
+  }
+
+  // The data must be on disk before any index entry refers to it.
+  syncData(dataFd);
+
+  auto entries = kj::heapArray<_::WireValue<uint64_t>>(pending.size());
+  for (uint i = 0; i < pending.size(); i++) {
+    entries[i].set(pending[i]);
+  }
+  pwriteFully(indexFd, entries.begin(), entries.size() * sizeof(entries[0]),
+              syncedCount * sizeof(word));
+
+  // No need to sync the index:  it can be rebuilt from the data if the entries are lost.
+  syncedCount += pending.size();
+  pending.resize(0);
+}
+
+// =======================================================================================
+
+namespace _ {  // private
+
+class LogMapping: public kj::Refcounted {
+  // A read-only mapping of the first `wordCount` words of a file.  Refcounted so that message
+  // readers handed out by MessageLogReader can keep it alive past a remap.
+
+public:
+  LogMapping(int fd, uint64_t wordCount, MmapAdvice advice) {
+    if (wordCount == 0) {
+      // mmap()ing zero bytes will fail.
+      return;
+    }
+
+    void* ptr = mmap(NULL, wordCount * sizeof(word), PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      KJ_FAIL_SYSCALL("mmap", errno);
+    }
+
+    words = kj::Array<const word>(reinterpret_cast<const word*>(ptr), wordCount,
+                                  kj::MmapDisposer::instance);
+
+    if (advice != MmapAdvice::NORMAL) {
+      // Only a hint; ignore failure.
+      madvise(ptr, wordCount * sizeof(word), toMadvise(advice));
+    }
+  }
+
+  kj::Array<const word> words;
+
+private:
+  static int toMadvise(MmapAdvice advice) {
+    switch (advice) {
+      case MmapAdvice::NORMAL: return MADV_NORMAL;
+      case MmapAdvice::SEQUENTIAL: return MADV_SEQUENTIAL;
+      case MmapAdvice::RANDOM: return MADV_RANDOM;
+      case MmapAdvice::WILL_NEED: return MADV_WILLNEED;
+    }
+    KJ_UNREACHABLE;
+  }
+};
+
+}  // namespace _ (private)
+
+namespace {
+
+struct LogMappingRef {
+  // Base class of LogMessageReader so that the mapping outlives the reader pointing into it.
+
+  explicit LogMappingRef(kj::Own<_::LogMapping> mapping): mapping(kj::mv(mapping)) {}
+  kj::Own<_::LogMapping> mapping;
+};
+
+class LogMessageReader: private LogMappingRef, public FlatArrayMessageReader {
+public:
+  LogMessageReader(kj::Own<_::LogMapping> mapping, kj::ArrayPtr<const word> words,
+                   ReaderOptions options)
+      : LogMappingRef(kj::mv(mapping)), FlatArrayMessageReader(words, options) {}
+};
+
+}  // namespace
+
+MessageLogReader::MessageLogReader(int dataFd, int indexFd, ReaderOptions options,
+                                   MmapAdvice advice)
+    : dataFd(dataFd), indexFd(indexFd), options(options), advice(advice),
+      data(kj::refcounted<_::LogMapping>(dataFd, 0, advice)),
+      index(kj::refcounted<_::LogMapping>(indexFd, 0, MmapAdvice::NORMAL)),
+      count(0) {
+  refresh();
+}
+
+MessageLogReader::~MessageLogReader() noexcept(false) {}
+
+bool MessageLogReader::refresh() {
+  // Map the index before the data.  The writer extends the data before the index, so every entry
+  // we see here refers to data that will be present when we stat the data file next.
+  uint64_t indexWords = sizeInWords(indexFd);
+  if (indexWords == count) {
+    return false;
+  }
+
+  auto newIndex = kj::refcounted<_::LogMapping>(indexFd, indexWords, MmapAdvice::NORMAL);
+  auto newData = kj::refcounted<_::LogMapping>(dataFd, sizeInWords(dataFd), advice);
+
+  auto entries = reinterpret_cast<const _::WireValue<uint64_t>*>(newIndex->words.begin());
+  uint64_t newCount = indexWords;
+  while (newCount > 0 && entries[newCount - 1].get() > newData->words.size()) {
+    // The data file was truncated by a recovering writer; those entries are being rewritten.
+    --newCount;
+  }
+
+  index = kj::mv(newIndex);
+  data = kj::mv(newData);
+  bool grew = newCount > count;
+  count = newCount;
+  return grew;
+}
+
+kj::ArrayPtr<const word> MessageLogReader::getWords(uint64_t n) {
+  KJ_REQUIRE(n < count, "Message number out of range.", n, count);
+
+  auto entries = reinterpret_cast<const _::WireValue<uint64_t>*>(index->words.begin());
+  uint64_t begin = n == 0 ? 0 : entries[n - 1].get();
+  uint64_t end = entries[n].get();
+
+  KJ_REQUIRE(begin <= end && end <= data->words.size(), "Message log index is corrupt.", n);
+  return data->words.slice(begin, end);
+}
+
+kj::Own<MessageReader> MessageLogReader::get(uint64_t n) {
+  auto words = getWords(n);
+  return kj::heap<LogMessageReader>(kj::addRef(*data), words, options);
+}
+
+kj::Array<kj::Own<MessageReader>> MessageLogReader::getRange(uint64_t begin, uint64_t end) {
+  KJ_REQUIRE(begin <= end && end <= count, "Message range is out of bounds.", begin, end, count);
+
+  auto builder = kj::heapArrayBuilder<kj::Own<MessageReader>>(end - begin);
+  for (uint64_t i = begin; i < end; i++) {
+    builder.add(get(i));
+  }
+  return builder.finish();
+}
+
+}  // namespace capnp
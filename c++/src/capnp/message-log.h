@@ -0,0 +1,148 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef CAPNP_MESSAGE_LOG_H_
+#define CAPNP_MESSAGE_LOG_H_
+
+#include "serialize.h"
+#include <kj/vector.h>
+
+namespace capnp {
+
+namespace _ {  // private
+class LogMapping;
+}  // namespace _ (private)
+
+// A message log is an append-only sequence of messages with random access by message number.
+// It consists of two files:
+// - The data file holds the messages back to back in the standard stream format, exactly as
+//   repeated calls to writeMessageToFd() would produce, so tools that read message streams (e.g.
+//   MmapMessageFileReader or `capnp decode`) can still read it front to back.
+// - The index file is a flat array of little-endian 64-bit word offsets, one per message, each
+//   pointing just past the end of that message in the data file.  Message N therefore spans
+//   [index[N-1], index[N]) (with index[-1] = 0) and can be found without reading any segment
+//   table that precedes it.
+//
+// The data file is the source of truth; the index can always be rebuilt from it.  A message's
+// index entry is only written after its data has been fsync()ed, so readers that consult the
+// index never observe a partially-written message, and after a crash the index never refers to
+// data that was lost.  MessageLogWriter repairs the tail of both files when it opens them.
+
+class MessageLogWriter {
+  // Appends messages to a message log.  Only one writer may have a given log open at a time; this
+  // is enforced with an exclusive flock() on the data file.  Any number of MessageLogReaders, in
+  // this or other processes, may read the log concurrently.
+
+public:
+  explicit MessageLogWriter(int dataFd, int indexFd, uint syncInterval = 64);
+  // Open a log for appending, without taking ownership of the descriptors.  Both files may be
+  // empty.  If the previous writer crashed, any incomplete message at the end of the data file is
+  // truncated away and index entries missing for complete messages are regenerated.
+  //
+  // `syncInterval` is the number of appended messages after which append() calls sync() by
+  // itself.  Zero means sync() is only ever called explicitly (and by the destructor).
+
+  KJ_DISALLOW_COPY(MessageLogWriter);
+  ~MessageLogWriter() noexcept(false);
+  // Calls sync() and releases the writer lock.
+
+  uint64_t append(MessageBuilder& builder);
+  uint64_t append(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
+  // Write a message to the end of the data file and return its message number.  The message is
+  // not visible to readers, nor durable, until the next sync().
+
+  void sync();
+  // fdatasync() the data file, then publish the index entries of all messages appended since the
+  // last sync.  Each call costs one disk flush regardless of how many messages it covers; callers
+  // with a slow trickle of messages may want to call this on a timer rather than waiting for
+  // `syncInterval` messages to accumulate.
+
+  inline uint64_t size() const { return syncedCount + pending.size(); }
+  // Number of messages in the log, including those not yet synced.
+
+  inline uint64_t getSyncedCount() const { return syncedCount; }
+  // Number of messages that are durable and visible to readers.
+
+private:
+  int dataFd;
+  int indexFd;
+  uint syncInterval;
+  uint64_t syncedCount;
+  uint64_t dataEnd;
+  // Offset, in words, of the end of the last message written to the data file.
+
+  kj::Vector<uint64_t> pending;
+  // End offsets of messages appended since the last sync.
+
+  kj::UnwindDetector unwindDetector;
+
+  void recover();
+};
+
+class MessageLogReader {
+  // Maps a message log and returns readers for individual messages in O(1).  Safe to use while
+  // another process appends to the log: the reader sees a consistent prefix of the log, which
+  // refresh() advances.
+
+public:
+  explicit MessageLogReader(int dataFd, int indexFd, ReaderOptions options = ReaderOptions(),
+                            MmapAdvice advice = MmapAdvice::RANDOM);
+  // Map a message log, without taking ownership of the descriptors.  The descriptors must remain
+  // open as long as refresh() may be called.
+
+  KJ_DISALLOW_COPY(MessageLogReader);
+  ~MessageLogReader() noexcept(false);
+
+  inline uint64_t size() const { return count; }
+  // Number of messages visible as of construction or the last refresh().
+
+  bool refresh();
+  // Pick up messages synced by a writer since the log was last mapped.  Returns true if any new
+  // messages became visible.
+
+  kj::Own<MessageReader> get(uint64_t n);
+  // Returns a reader for message number `n`, which must be less than size().  The returned reader
+  // holds a reference to the mapping it points into, so it remains valid across refresh() and
+  // even after the MessageLogReader is destroyed.
+
+  kj::Array<kj::Own<MessageReader>> getRange(uint64_t begin, uint64_t end);
+  // Returns readers for messages [begin, end).
+
+  kj::ArrayPtr<const word> getWords(uint64_t n);
+  // Returns the raw serialized form of message `n` (segment table included), e.g. to forward it
+  // elsewhere without parsing.  Valid until the next refresh().
+
+private:
+  int dataFd;
+  int indexFd;
+  ReaderOptions options;
+  MmapAdvice advice;
+  kj::Own<_::LogMapping> data;
+  kj::Own<_::LogMapping> index;
+  uint64_t count;
+};
+
+}  // namespace capnp
+
+#endif  // CAPNP_MESSAGE_LOG_H_
@@ -22,7 +22,9 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "message.h"
+#include "dynamic.h"
 #include <gtest/gtest.h>
+#include "test-util.h"
 
 namespace capnp {
 namespace _ {  // private
@@ -46,6 +48,375 @@ TEST(Message, MallocBuilderWithFirstSegment) {
   EXPECT_EQ(16u, segment.size());
 }
 
+TEST(Message, MallocBuilderReset) {
+  MallocMessageBuilder builder(16, AllocationStrategy::FIXED_SIZE);
+  initTestMessage(builder.initRoot<TestAllTypes>());
+
+  auto firstSegments = kj::heapArray<kj::ArrayPtr<const word>>(builder.getSegmentsForOutput());
+  ASSERT_GT(firstSegments.size(), 1u);
+
+  builder.reset();
+  EXPECT_EQ(0u, builder.getSegmentsForOutput().size());
+
+  // Every old segment must have been zeroed.
+  for (auto segment: firstSegments) {
+    for (auto& w: segment) {
+      EXPECT_EQ(0u, *reinterpret_cast<const uint64_t*>(&w));
+    }
+  }
+
+  // Building the same message again reuses the same segments, in order.
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  checkTestMessage(builder.getRoot<TestAllTypes>());
+  auto secondSegments = builder.getSegmentsForOutput();
+  ASSERT_EQ(firstSegments.size(), secondSegments.size());
+  for (uint i = 0; i < firstSegments.size(); i++) {
+    EXPECT_EQ(firstSegments[i].begin(), secondSegments[i].begin());
+    EXPECT_EQ(firstSegments[i].size(), secondSegments[i].size());
+  }
+
+  // A smaller message after reset starts out empty.
+  builder.reset();
+  builder.initRoot<TestAllTypes>().setInt32Field(123);
+  EXPECT_EQ(123, builder.getRoot<TestAllTypes>().getInt32Field());
+  EXPECT_FALSE(builder.getRoot<TestAllTypes>().hasTextField());
+}
+
+TEST(Message, MallocBuilderCompact) {
+  MallocMessageBuilder builder(16, AllocationStrategy::FIXED_SIZE);
+  auto root = builder.initRoot<TestAllTypes>();
+  initTestMessage(root);
+
+  // Overwriting a field abandons the old value.
+  for (uint i = 0; i < 10; i++) {
+    root.setTextField(kj::str("text number ", i));
+    root.initStructList(3);
+  }
+  initTestMessage(root);
+  size_t wasted = builder.getWastedWords();
+  EXPECT_GT(wasted, 100u);
+
+  size_t before = 0;
+  for (auto segment: builder.getSegmentsForOutput()) before += segment.size();
+
+  builder.compact();
+  checkTestMessage(builder.getRoot<TestAllTypes>());
+
+  auto segments = builder.getSegmentsForOutput();
+  ASSERT_EQ(1u, segments.size());
+  EXPECT_EQ(0u, builder.getWastedWords());
+  EXPECT_EQ(before - wasted, segments[0].size());
+
+  // The compacted message can go on being modified.
+  builder.getRoot<TestAllTypes>().setTextField("bar");
+  EXPECT_EQ("bar", builder.getRoot<TestAllTypes>().getTextField());
+}
+
+TEST(Message, MallocBuilderCompactWithFirstSegment) {
+  word scratch[16];
+  memset(scratch, 0, sizeof(scratch));
+  MallocMessageBuilder builder(kj::arrayPtr(scratch, 16), AllocationStrategy::FIXED_SIZE);
+
+  auto root = builder.initRoot<TestAllTypes>();
+  initTestMessage(root);
+  root.initStructList(10);
+  initTestMessage(root);
+  EXPECT_GT(builder.getWastedWords(), 0u);
+
+  builder.compact();
+  checkTestMessage(builder.getRoot<TestAllTypes>());
+
+  // The caller's first segment is kept, so the message still spans several segments.
+  EXPECT_EQ(scratch, builder.getSegmentsForOutput()[0].begin());
+  EXPECT_GT(builder.getSegmentsForOutput().size(), 1u);
+}
+
+TEST(Message, MallocBuilderResetWithFirstSegment) {
+  word scratch[16];
+  memset(scratch, 0, sizeof(scratch));
+  MallocMessageBuilder builder(kj::arrayPtr(scratch, 16), AllocationStrategy::FIXED_SIZE);
+
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  EXPECT_EQ(scratch, builder.getSegmentsForOutput()[0].begin());
+
+  builder.reset();
+  for (auto& w: scratch) {
+    EXPECT_EQ(0u, *reinterpret_cast<uint64_t*>(&w));
+  }
+
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  EXPECT_EQ(scratch, builder.getSegmentsForOutput()[0].begin());
+  checkTestMessage(builder.getRoot<TestAllTypes>());
+}
+
+TEST(Message, BuilderPool) {
+  MessageBuilderPool pool(1, 1024);
+
+  MallocMessageBuilder* first;
+  {
+    auto builder = pool.get();
+    first = builder.get();
+    initTestMessage(builder->initRoot<TestAllTypes>());
+  }
+
+  {
+    auto builder = pool.get();
+    EXPECT_EQ(first, builder.get());
+    EXPECT_EQ(0u, builder->getSegmentsForOutput().size());
+
+    // Only one idle builder is kept, so this one is new.
+    auto other = pool.get();
+    EXPECT_NE(first, other.get());
+  }
+
+  {
+    // A builder whose message exceeded the retention limit isn't pooled.
+    auto builder = pool.get();
+    builder->initRoot<TestAllTypes>().initStructList(2000);
+  }
+
+  {
+    auto builder = pool.get();
+    initTestMessage(builder->initRoot<TestAllTypes>());
+    checkTestMessage(builder->getRoot<TestAllTypes>());
+  }
+}
+
+TEST(Message, BuilderPoolFirstSegmentSize) {
+  MessageBuilderPool pool(1, 65536);
+
+  MallocMessageBuilder* small;
+  {
+    auto builder = pool.get(64);
+    small = builder.get();
+    builder->initRoot<TestAllTypes>();
+  }
+
+  {
+    // A smaller request can reuse it.
+    auto builder = pool.get(16);
+    EXPECT_EQ(small, builder.get());
+  }
+
+  {
+    // A bigger one can't, so it gets a new builder that actually honors the size.
+    auto builder = pool.get(4096);
+    builder->initRoot<TestAllTypes>().initDataField(4000 * sizeof(word));
+    EXPECT_EQ(1u, builder->getSegmentsForOutput().size());
+  }
+
+  {
+    // The big builder replaced the small one in the pool.
+    auto builder = pool.get(4096);
+    builder->initRoot<TestAllTypes>().initDataField(4000 * sizeof(word));
+    EXPECT_EQ(1u, builder->getSegmentsForOutput().size());
+  }
+}
+
+TEST(Message, SetRootSingleAllocation) {
+  MallocMessageBuilder source;
+  initTestMessage(source.initRoot<TestAllTypes>());
+  auto reader = source.getRoot<TestAllTypes>().asReader();
+
+  // The root pointer goes in the first (tiny) segment and the whole copy goes in one more.
+  MallocMessageBuilder builder(16, AllocationStrategy::FIXED_SIZE);
+  builder.setRoot(reader);
+  EXPECT_EQ(2u, builder.getSegmentsForOutput().size());
+  checkTestMessage(builder.getRoot<TestAllTypes>());
+
+  // When the first segment is big enough, everything stays in it.
+  MallocMessageBuilder bigBuilder(reader.totalSize().wordCount + 1);
+  bigBuilder.setRoot(reader);
+  EXPECT_EQ(1u, bigBuilder.getSegmentsForOutput().size());
+  checkTestMessage(bigBuilder.getRoot<TestAllTypes>());
+}
+
+TEST(Message, ValidatedInPlace) {
+  MallocMessageBuilder builder;
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  auto segments = builder.getSegmentsForOutput();
+  ASSERT_EQ(1u, segments.size());
+
+  ValidatedMessage message(segments);
+  EXPECT_TRUE(message.isInPlace());
+  EXPECT_EQ(segments[0].begin(), message.getFlatWords().begin());
+  checkTestMessage(message.getRoot<TestAllTypes>());
+}
+
+TEST(Message, ValidatedMultiSegment) {
+  MallocMessageBuilder builder(0, AllocationStrategy::FIXED_SIZE);
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  auto segments = builder.getSegmentsForOutput();
+  ASSERT_GT(segments.size(), 1u);
+
+  ValidatedMessage message(segments);
+  EXPECT_FALSE(message.isInPlace());
+  EXPECT_EQ(builder.getRoot<TestAllTypes>().asReader().totalSize().wordCount + 1,
+            message.getFlatWords().size());
+  checkTestMessage(message.getRoot<TestAllTypes>());
+}
+
+class CountingSegmentReader: public SegmentArrayMessageReader {
+public:
+  using SegmentArrayMessageReader::SegmentArrayMessageReader;
+
+  kj::ArrayPtr<const word> getSegment(uint id) override {
+    ++fetches;
+    return SegmentArrayMessageReader::getSegment(id);
+  }
+
+  uint fetches = 0;
+};
+
+TEST(Message, EmptyMiddleSegment) {
+  // Segment 0 holds a far pointer into segment 2, skipping an empty segment 1.  Segments must be
+  // found by their real count rather than by stopping at the first empty one, and only the
+  // segments actually visited should be fetched.
+  WireValue<uint64_t> segment0[1];
+  segment0[0].set(0x0000000200000002ull);       // far pointer: segment 2, offset 0
+  WireValue<uint64_t> segment2[2];
+  segment2[0].set(0x0000000100000000ull);       // struct pointer: one data word, no pointers
+  segment2[1].set(0x123456789abcdef0ull);
+
+  kj::ArrayPtr<const word> segments[3] = {
+    kj::arrayPtr(reinterpret_cast<const word*>(segment0), 1),
+    nullptr,
+    kj::arrayPtr(reinterpret_cast<const word*>(segment2), 2),
+  };
+
+  CountingSegmentReader reader(segments);
+  auto root = reader.getRoot<TestAllTypes>();
+  EXPECT_EQ(0x12345678, root.getInt32Field());
+  EXPECT_EQ(int8_t(0xde), root.getInt8Field());
+  EXPECT_EQ(2u, reader.fetches);
+}
+
+TEST(Message, ValidatedRejectsInvalid) {
+  MallocMessageBuilder builder;
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  auto segment = builder.getSegmentsForOutput()[0];
+
+  kj::Array<word> copy = kj::heapArray<word>(segment.size());
+  memcpy(copy.begin(), segment.begin(), segment.size() * sizeof(word));
+
+  // Point the root struct far outside the segment.
+  uint32_t* rootPointer = reinterpret_cast<uint32_t*>(copy.begin());
+  rootPointer[0] = 1000000u << 2;
+  EXPECT_ANY_THROW(ValidatedMessage message(copy.asPtr()));
+}
+
+TEST(Message, ValidatedTraversalLimit) {
+  MallocMessageBuilder builder;
+  initTestMessage(builder.initRoot<TestAllTypes>());
+
+  ReaderOptions options;
+  options.traversalLimitInWords = 8;
+  EXPECT_ANY_THROW(ValidatedMessage message(builder.getSegmentsForOutput(), options));
+
+  options.traversalLimitInWords = 1024;
+  ValidatedMessage message(builder.getSegmentsForOutput(), options);
+  checkTestMessage(message.getRoot<TestAllTypes>());
+}
+
+TEST(Message, Canonicalize) {
+  MallocMessageBuilder builder1;
+  initTestMessage(builder1.initRoot<TestAllTypes>());
+
+  MallocMessageBuilder builder2(0, AllocationStrategy::FIXED_SIZE);
+  initTestMessage(builder2.initRoot<TestAllTypes>());
+  ASSERT_GT(builder2.getSegmentsForOutput().size(), 1u);
+
+  auto canonical1 = canonicalize(builder1.getRoot<TestAllTypes>().asReader());
+  auto canonical2 = canonicalize(builder2.getRoot<TestAllTypes>().asReader());
+  ASSERT_EQ(canonical1.size(), canonical2.size());
+  EXPECT_EQ(0, memcmp(canonical1.begin(), canonical2.begin(), canonical1.size() * sizeof(word)));
+
+  EXPECT_TRUE(isCanonical(canonical1));
+  checkTestMessage(readMessageUnchecked<TestAllTypes>(canonical1.begin()));
+
+  // The AnyPointer form produces the same encoding.
+  auto canonical3 = canonicalize(builder2.getRoot<AnyPointer>().asReader());
+  ASSERT_EQ(canonical1.size(), canonical3.size());
+  EXPECT_EQ(0, memcmp(canonical1.begin(), canonical3.begin(), canonical1.size() * sizeof(word)));
+}
+
+TEST(Message, CanonicalizeTruncates) {
+  MallocMessageBuilder oldBuilder;
+  auto oldRoot = oldBuilder.initRoot<test::TestOldVersion>();
+  oldRoot.setOld1(123);
+  oldRoot.setOld2("foo");
+  oldRoot.initOld3().setOld1(456);
+
+  MallocMessageBuilder newBuilder;
+  auto newRoot = newBuilder.initRoot<test::TestNewVersion>();
+  newRoot.setOld1(123);
+  newRoot.setOld2("foo");
+  newRoot.initOld3().setOld1(456);
+
+  // The new version has a larger struct layout, but the extra fields are at their defaults.
+  EXPECT_FALSE(isCanonical(newBuilder.getSegmentsForOutput()[0]));
+
+  auto oldCanonical = canonicalize(oldRoot.asReader());
+  auto newCanonical = canonicalize(newRoot.asReader());
+  ASSERT_EQ(oldCanonical.size(), newCanonical.size());
+  EXPECT_EQ(0, memcmp(oldCanonical.begin(), newCanonical.begin(),
+                      oldCanonical.size() * sizeof(word)));
+  EXPECT_TRUE(isCanonical(newCanonical));
+
+  // Setting a new field makes the encodings differ.
+  newRoot.setNew1(1);
+  EXPECT_NE(oldCanonical.size(), canonicalize(newRoot.asReader()).size());
+}
+
+TEST(Message, StructuralEquality) {
+  MallocMessageBuilder builder1;
+  initTestMessage(builder1.initRoot<TestAllTypes>());
+  MallocMessageBuilder builder2(0, AllocationStrategy::FIXED_SIZE);
+  initTestMessage(builder2.initRoot<TestAllTypes>());
+
+  auto reader1 = builder1.getRoot<TestAllTypes>().asReader();
+  auto reader2 = builder2.getRoot<TestAllTypes>().asReader();
+  EXPECT_TRUE(structurallyEqual(reader1, reader2));
+  EXPECT_EQ(structuralHash(reader1), structuralHash(reader2));
+
+  EXPECT_TRUE(structurallyEqual(builder1.getRoot<AnyPointer>().asReader(),
+                                builder2.getRoot<AnyPointer>().asReader()));
+  EXPECT_EQ(structuralHash(builder1.getRoot<AnyPointer>().asReader()),
+            structuralHash(builder2.getRoot<AnyPointer>().asReader()));
+  EXPECT_TRUE(structurallyEqual(toDynamic(reader1), toDynamic(reader2)));
+
+  builder2.getRoot<TestAllTypes>().getStructList()[1].setTextField("changed");
+  EXPECT_FALSE(structurallyEqual(reader1, reader2));
+  EXPECT_NE(structuralHash(reader1), structuralHash(reader2));
+
+  builder2.getRoot<TestAllTypes>().getStructList()[1].setTextField(
+      reader1.getStructList()[1].getTextField());
+  EXPECT_TRUE(structurallyEqual(reader1, reader2));
+
+  builder2.getRoot<TestAllTypes>().getBoolList().set(3, !reader1.getBoolList()[3]);
+  EXPECT_FALSE(structurallyEqual(reader1, reader2));
+}
+
+TEST(Message, StructuralEqualityAcrossVersions) {
+  MallocMessageBuilder oldBuilder;
+  auto oldRoot = oldBuilder.initRoot<test::TestOldVersion>();
+  oldRoot.setOld1(123);
+  oldRoot.initOld3().setOld2("bar");
+
+  MallocMessageBuilder newBuilder;
+  auto newRoot = newBuilder.initRoot<test::TestNewVersion>();
+  newRoot.setOld1(123);
+  newRoot.initOld3().setOld2("bar");
+
+  auto oldAny = oldBuilder.getRoot<AnyPointer>().asReader();
+  auto newAny = newBuilder.getRoot<AnyPointer>().asReader();
+  EXPECT_TRUE(structurallyEqual(oldAny, newAny));
+  EXPECT_EQ(structuralHash(oldAny), structuralHash(newAny));
+
+  newRoot.getOld3().setNew2("qux");
+  EXPECT_FALSE(structurallyEqual(oldAny, newAny));
+}
+
 // TODO(test):  More tests.
 
 }  // namespace
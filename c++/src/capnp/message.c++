@@ -42,6 +42,21 @@ MessageReader::~MessageReader() noexcept(false) {
   }
 }
 
+void MessageReader::reset() {
+  if (allocatedArena) {
+    allocatedArena = false;
+    arena()->~ReaderArena();
+  }
+}
+
+uint MessageReader::getSegmentCount() {
+  uint count = 0;
+  while (getSegment(count) != nullptr) {
+    ++count;
+  }
+  return count;
+}
+
 AnyPointer::Reader MessageReader::getRootInternal() {
   if (!allocatedArena) {
     static_assert(sizeof(_::ReaderArena) <= sizeof(arenaSpace),
@@ -112,6 +127,26 @@ kj::ArrayPtr<kj::Maybe<kj::Own<ClientHook>>> MessageBuilder::getCapTable() {
   }
 }
 
+void MessageBuilder::clearArena() {
+  if (allocatedArena) {
+    kj::dtor(*arena());
+    allocatedArena = false;
+  }
+}
+
+size_t MessageBuilder::getWastedWords() {
+  if (!allocatedArena) return 0;
+
+  size_t total = 0;
+  for (auto segment: arena()->getSegmentsForOutput()) {
+    total += segment.size();
+  }
+
+  // One word for the root pointer itself.
+  uint64_t live = getRootInternal().targetSize().wordCount + 1;
+  return total > live ? total - live : 0;
+}
+
 Orphanage MessageBuilder::getOrphanage() {
   // We must ensure that the arena and root pointer have been allocated before the Orphanage
   // can be used.
@@ -136,21 +171,129 @@ kj::ArrayPtr<const word> SegmentArrayMessageReader::getSegment(uint id) {
   }
 }
 
+uint SegmentArrayMessageReader::getSegmentCount() {
+  return segments.size();
+}
+
 // -------------------------------------------------------------------
 
+ValidatedMessage::ValidatedMessage(
+    kj::ArrayPtr<const kj::ArrayPtr<const word>> segments, ReaderOptions options) {
+  KJ_REQUIRE(segments.size() > 0 && segments[0].size() > 0,
+             "Message did not contain a root pointer.");
+
+  _::MessageSizeCounts size;
+
+  {
+    SegmentArrayMessageReader reader(segments, options);
+    AnyPointer::Reader root = reader.getRoot<AnyPointer>();
+
+    // The traversal below charges the reader's read limiter, so it enforces the traversal limit
+    // as well as bounds and nesting.
+    size = _::PointerHelpers<AnyPointer>::getInternalReader(root).targetSize();
+  }
+
+  KJ_REQUIRE(size.capCount == 0, "Validated messages cannot contain capabilities.");
+
+  if (segments.size() == 1 && !size.hasFarPointers) {
+    words = segments[0];
+  } else {
+    // Flatten into a single segment.  Use a fresh reader so that the copy is not charged against
+    // the traversal limit a second time.
+    SegmentArrayMessageReader reader(segments, options);
+    ownedCopy = kj::heapArray<word>(size.wordCount / WORDS + 1);
+    memset(ownedCopy.begin(), 0, ownedCopy.size() * sizeof(word));
+    copyToUnchecked(reader.getRoot<AnyPointer>(), ownedCopy);
+    words = ownedCopy;
+  }
+}
+
+ValidatedMessage::ValidatedMessage(kj::ArrayPtr<const word> segment, ReaderOptions options)
+    : ValidatedMessage(kj::arrayPtr(&segment, 1), options) {}
+
+// -------------------------------------------------------------------
+
+namespace {
+
+template <typename SetFunc>
+kj::Array<word> buildCanonical(WordCount64 wordCount, SetFunc&& setRoot) {
+  // Canonical form never needs more space than a plain copy, so a flat array of the traversal
+  // size suffices.  The builder has exactly one segment, so no far pointers are created.
+
+  kj::Array<word> scratch = kj::heapArray<word>(wordCount / WORDS + 1);
+  memset(scratch.begin(), 0, scratch.size() * sizeof(word));
+
+  FlatMessageBuilder builder(scratch);
+  setRoot(_::PointerHelpers<AnyPointer>::getInternalBuilder(builder.getRoot<AnyPointer>()));
+
+  auto segments = builder.getSegmentsForOutput();
+  KJ_ASSERT(segments.size() == 1);
+
+  kj::Array<word> result = kj::heapArray<word>(segments[0].size());
+  memcpy(result.begin(), segments[0].begin(), segments[0].size() * sizeof(word));
+  return result;
+}
+
+}  // namespace
+
+namespace _ {  // private
+
+kj::Array<word> canonicalizeImpl(const StructReader& reader) {
+  return buildCanonical(reader.totalSize().wordCount, [&](PointerBuilder root) {
+    root.setStruct(reader, true);
+  });
+}
+
+kj::Array<word> canonicalizeImpl(const PointerReader& reader) {
+  return buildCanonical(reader.targetSize().wordCount, [&](PointerBuilder root) {
+    root.copyFrom(reader, true);
+  });
+}
+
+}  // namespace _ (private)
+
+bool isCanonical(kj::ArrayPtr<const word> words) {
+  if (words.size() == 0) {
+    return false;
+  }
+
+  kj::Array<word> canonical;
+  KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+    SegmentArrayMessageReader reader(kj::arrayPtr(&words, 1));
+    canonical = canonicalize(reader.getRoot<AnyPointer>());
+  })) {
+    // Not a valid message, or it contains capabilities.
+    return false;
+  }
+
+  return canonical.size() == words.size() &&
+      memcmp(canonical.begin(), words.begin(), words.size() * sizeof(word)) == 0;
+}
+
+// -------------------------------------------------------------------
+
+SegmentAllocator::~SegmentAllocator() noexcept(false) {}
+
 struct MallocMessageBuilder::MoreSegments {
-  std::vector<void*> segments;
+  std::vector<kj::ArrayPtr<word>> segments;
+  // All segments after the first, in the order they were handed out.
+
+  size_t inUse = 0;
+  // Number of entries at the start of `segments` that belong to the current message.  The rest
+  // are zeroed and waiting to be reused after a reset().
 };
 
 MallocMessageBuilder::MallocMessageBuilder(
     uint firstSegmentWords, AllocationStrategy allocationStrategy)
     : nextSize(firstSegmentWords), allocationStrategy(allocationStrategy),
-      ownFirstSegment(true), returnedFirstSegment(false), firstSegment(nullptr) {}
+      ownFirstSegment(true), returnedFirstSegment(false), firstSegment(nullptr),
+      firstSegmentSize(0) {}
 
 MallocMessageBuilder::MallocMessageBuilder(
     kj::ArrayPtr<word> firstSegment, AllocationStrategy allocationStrategy)
     : nextSize(firstSegment.size()), allocationStrategy(allocationStrategy),
-      ownFirstSegment(false), returnedFirstSegment(false), firstSegment(firstSegment.begin()) {
+      ownFirstSegment(false), returnedFirstSegment(false), firstSegment(firstSegment.begin()),
+      firstSegmentSize(firstSegment.size()) {
   KJ_REQUIRE(firstSegment.size() > 0, "First segment size must be non-zero.");
 
   // Checking just the first word should catch most cases of failing to zero the segment.
@@ -158,31 +301,123 @@ MallocMessageBuilder::MallocMessageBuilder(
           "First segment must be zeroed.");
 }
 
+MallocMessageBuilder::MallocMessageBuilder(
+    SegmentAllocator& allocator, uint firstSegmentWords, AllocationStrategy allocationStrategy)
+    : nextSize(firstSegmentWords), allocationStrategy(allocationStrategy), allocator(&allocator),
+      ownFirstSegment(true), returnedFirstSegment(false), firstSegment(nullptr),
+      firstSegmentSize(0) {}
+
 MallocMessageBuilder::~MallocMessageBuilder() noexcept(false) {
-  if (returnedFirstSegment) {
-    if (ownFirstSegment) {
-      free(firstSegment);
-    } else {
-      // Must zero first segment.
-      kj::ArrayPtr<const kj::ArrayPtr<const word>> segments = getSegmentsForOutput();
-      if (segments.size() > 0) {
-        KJ_ASSERT(segments[0].begin() == firstSegment,
-            "First segment in getSegmentsForOutput() is not the first segment allocated?");
-        memset(firstSegment, 0, segments[0].size() * sizeof(word));
-      }
+  // A SegmentAllocator wants to know how much of each segment the message dirtied.
+  kj::ArrayPtr<const kj::ArrayPtr<const word>> outputSegments = nullptr;
+  if (allocator != nullptr && returnedFirstSegment) outputSegments = getSegmentsForOutput();
+  auto wordsUsed = [&](const void* start) -> size_t {
+    for (auto segment: outputSegments) {
+      if (segment.begin() == start) return segment.size();
     }
+    return 0;
+  };
 
-    KJ_IF_MAYBE(s, moreSegments) {
-      for (void* ptr: s->get()->segments) {
-        free(ptr);
-      }
+  if (ownFirstSegment) {
+    if (firstSegment != nullptr) {
+      releaseMemory(firstSegment, firstSegmentSize, wordsUsed(firstSegment));
+    }
+  } else if (returnedFirstSegment) {
+    // Must zero first segment.
+    kj::ArrayPtr<const kj::ArrayPtr<const word>> segments = getSegmentsForOutput();
+    if (segments.size() > 0) {
+      KJ_ASSERT(segments[0].begin() == firstSegment,
+          "First segment in getSegmentsForOutput() is not the first segment allocated?");
+      memset(firstSegment, 0, segments[0].size() * sizeof(word));
+    }
+  }
+
+  KJ_IF_MAYBE(s, moreSegments) {
+    for (auto segment: s->get()->segments) {
+      releaseMemory(segment.begin(), segment.size(), wordsUsed(segment.begin()));
+    }
+  }
+}
+
+kj::ArrayPtr<word> MallocMessageBuilder::allocateMemory(uint size) {
+  if (allocator != nullptr) {
+    auto result = allocator->allocate(size);
+    KJ_ASSERT(result.size() >= size, "SegmentAllocator returned a segment that is too small.");
+    return result;
+  }
+
+  void* result = calloc(size, sizeof(word));
+  if (result == nullptr) {
+    KJ_FAIL_SYSCALL("calloc(size, sizeof(word))", ENOMEM, size);
+  }
+  return kj::arrayPtr(reinterpret_cast<word*>(result), size);
+}
+
+void MallocMessageBuilder::releaseMemory(void* segment, size_t size, size_t wordsUsed) {
+  if (allocator != nullptr) {
+    allocator->release(kj::arrayPtr(reinterpret_cast<word*>(segment), size), wordsUsed);
+  } else {
+    free(segment);
+  }
+}
+
+bool MallocMessageBuilder::ownsSegment(const word* start) {
+  if (start == firstSegment) return true;
+  KJ_IF_MAYBE(s, moreSegments) {
+    for (size_t i = 0; i < s->get()->inUse; i++) {
+      if (start == s->get()->segments[i].begin()) return true;
     }
   }
+  return false;
+}
+
+void MallocMessageBuilder::reset() {
+  // Every word the message used lies in one of the output segments, which in turn all lie in
+  // segments we handed out, so zeroing those leaves all our segments fully zeroed.  Output
+  // segments we didn't hand out are external data (see Orphanage::referenceExternalData()),
+  // which belongs to the caller and must be left alone.
+  for (auto segment: getSegmentsForOutput()) {
+    if (ownsSegment(segment.begin())) {
+      memset(const_cast<word*>(segment.begin()), 0, segment.size() * sizeof(word));
+    }
+  }
+
+  clearArena();
+
+  returnedFirstSegment = false;
+  KJ_IF_MAYBE(s, moreSegments) {
+    s->get()->inUse = 0;
+  }
+}
+
+void MallocMessageBuilder::compact() {
+  auto segments = getSegmentsForOutput();
+  if (segments.size() == 0) return;
+
+  AnyPointer::Reader root = getRoot<AnyPointer>().asReader();
+  uint64_t liveWords = root.targetSize().wordCount + 1;
+  KJ_REQUIRE(liveWords <= uint(kj::maxValue),
+             "Message is too large to compact into one segment.");
+
+  MallocMessageBuilder scratch(liveWords, AllocationStrategy::FIXED_SIZE);
+  scratch.setRoot(root);
+
+  reset();
+
+  if (ownFirstSegment && firstSegmentSize < liveWords) {
+    // reset() has zeroed it, so no words are dirty.
+    releaseMemory(firstSegment, firstSegmentSize, 0);
+    firstSegment = nullptr;
+    nextSize = std::max<uint>(nextSize, liveWords);
+  }
+
+  getRoot<AnyPointer>().set(scratch.getRoot<AnyPointer>().asReader());
 }
 
 kj::ArrayPtr<word> MallocMessageBuilder::allocateSegment(uint minimumSize) {
-  if (!returnedFirstSegment && !ownFirstSegment) {
-    kj::ArrayPtr<word> result = kj::arrayPtr(reinterpret_cast<word*>(firstSegment), nextSize);
+  if (!returnedFirstSegment && firstSegment != nullptr) {
+    kj::ArrayPtr<word> result = kj::arrayPtr(reinterpret_cast<word*>(firstSegment),
+                                             firstSegmentSize);
     if (result.size() >= minimumSize) {
       returnedFirstSegment = true;
       return result;
@@ -190,18 +425,34 @@ kj::ArrayPtr<word> MallocMessageBuilder::allocateSegment(uint minimumSize) {
     // If the provided first segment wasn't big enough, we discard it and proceed to allocate
     // our own.  This never happens in practice since minimumSize is always 1 for the first
     // segment.
+    if (ownFirstSegment) {
+      releaseMemory(firstSegment, firstSegmentSize, 0);
+    }
+    firstSegment = nullptr;
     ownFirstSegment = true;
   }
 
-  uint size = std::max(minimumSize, nextSize);
-
-  void* result = calloc(size, sizeof(word));
-  if (result == nullptr) {
-    KJ_FAIL_SYSCALL("calloc(size, sizeof(word))", ENOMEM, size);
+  if (returnedFirstSegment) {
+    // Reuse a segment left over from before the last reset(), if one is big enough.
+    KJ_IF_MAYBE(s, moreSegments) {
+      auto& segments = s->get()->segments;
+      size_t& inUse = s->get()->inUse;
+      for (size_t i = inUse; i < segments.size(); i++) {
+        if (segments[i].size() >= minimumSize) {
+          std::swap(segments[i], segments[inUse]);
+          return segments[inUse++];
+        }
+      }
+    }
   }
 
+  kj::ArrayPtr<word> memory = allocateMemory(std::max(minimumSize, nextSize));
+  word* result = memory.begin();
+  uint size = memory.size();
+
   if (!returnedFirstSegment) {
     firstSegment = result;
+    firstSegmentSize = size;
     returnedFirstSegment = true;
 
     // After the first segment, we want nextSize to equal the total size allocated so far.
@@ -215,11 +466,66 @@ kj::ArrayPtr<word> MallocMessageBuilder::allocateSegment(uint minimumSize) {
       segments = newSegments;
       moreSegments = mv(newSegments);
     }
-    segments->segments.push_back(result);
+    segments->segments.insert(segments->segments.begin() + segments->inUse,
+                              kj::arrayPtr(result, size));
+    ++segments->inUse;
     if (allocationStrategy == AllocationStrategy::GROW_HEURISTICALLY) nextSize += size;
   }
 
-  return kj::arrayPtr(reinterpret_cast<word*>(result), size);
+  return memory;
+}
+
+// -------------------------------------------------------------------
+
+MessageBuilderPool::MessageBuilderPool(uint maxPooledBuilders, uint maxRetainedWords)
+    : maxPooledBuilders(maxPooledBuilders), maxRetainedWords(maxRetainedWords) {}
+
+MessageBuilderPool::~MessageBuilderPool() noexcept(false) {
+  for (auto builder: idle) {
+    delete builder;
+  }
+}
+
+kj::Own<MallocMessageBuilder> MessageBuilderPool::get(uint firstSegmentWords) {
+  // Prefer the most recently returned builder that is big enough, since its memory is most likely
+  // still in cache.  Handing out one that is too small would make the message spill into extra
+  // segments and defeat the caller's size hint.
+  for (size_t i = idle.size(); i > 0; i--) {
+    MallocMessageBuilder* builder = idle[i - 1];
+    uint capacity = builder->firstSegment == nullptr ? builder->nextSize
+                                                     : builder->firstSegmentSize;
+    if (capacity >= firstSegmentWords) {
+      idle[i - 1] = idle.back();
+      idle.removeLast();
+      return kj::Own<MallocMessageBuilder>(builder, *this);
+    }
+  }
+
+  if (!idle.empty()) {
+    // None is big enough.  Drop one so that the pool gradually adapts to the sizes in demand.
+    delete idle.back();
+    idle.removeLast();
+  }
+
+  return kj::Own<MallocMessageBuilder>(new MallocMessageBuilder(firstSegmentWords), *this);
+}
+
+void MessageBuilderPool::disposeImpl(void* pointer) const {
+  auto builder = static_cast<MallocMessageBuilder*>(pointer);
+
+  size_t totalWords = 0;
+  for (auto segment: builder->getSegmentsForOutput()) {
+    if (builder->ownsSegment(segment.begin())) {
+      totalWords += segment.size();
+    }
+  }
+
+  if (idle.size() < maxPooledBuilders && totalWords <= maxRetainedWords) {
+    builder->reset();
+    idle.add(builder);
+  } else {
+    delete builder;
+  }
 }
 
 // -------------------------------------------------------------------
@@ -24,6 +24,7 @@
 #include <kj/common.h>
 #include <kj/memory.h>
 #include <kj/mutex.h>
+#include <kj/vector.h>
 #include "common.h"
 #include "layout.h"
 #include "any.h"
@@ -42,6 +43,11 @@ class StructSchema;
 class Orphanage;
 template <typename T>
 class Orphan;
+class ClientHook;
+
+typedef kj::SmallVector<kj::Maybe<kj::Own<ClientHook>>, 1> CapTable;
+// The table of capabilities attached to a message.  Almost every message carries zero or one
+// capability, so one fits inline without a heap allocation.
 
 // =======================================================================================
 
@@ -105,6 +111,12 @@ public:
   // Normally getSegment() will only be called once for each segment ID.  Subclasses can call
   // reset() to clear the segment table and start over with new segments.
 
+  virtual uint getSegmentCount();
+  // Returns the number of segments in the message, counting empty ones.  The default
+  // implementation calls getSegment() with increasing IDs until it returns null, so it cannot see
+  // past an empty segment and fetches every segment up front; subclasses that know the count from
+  // their segment table should override it.
+
   inline const ReaderOptions& getOptions();
   // Get the options passed to the constructor.
 
@@ -118,6 +130,7 @@ public:
   // RootType in this case must be DynamicStruct, and you must #include <capnp/dynamic.h> to
   // use this.
 
+  void initCapTable(CapTable&& capTable);
   void initCapTable(kj::Array<kj::Maybe<kj::Own<ClientHook>>> capTable);
   // Sets the table of capabilities embedded in this message.  Capability pointers found in the
   // message content contain indexes into this table.  You must call this before attempting to
@@ -128,6 +141,12 @@ public:
   // You must link against libcapnp-rpc to call this method (the rest of MessageBuilder is in
   // regular libcapnp).
 
+protected:
+  void reset();
+  // Discard everything derived from the current message content -- the segment table, the read
+  // limit, and the cap table -- so that the reader can be pointed at a new message.  The next
+  // getRoot() will call getSegment() afresh.
+
 private:
   ReaderOptions options;
 
@@ -135,7 +154,7 @@ private:
   // because we don't want clients to have to #include arena.h, which itself includes a bunch of
   // big STL headers.  We don't use a pointer to a ReaderArena because that would require an
   // extra malloc on every message which could be expensive when processing small messages.
-  void* arenaSpace[15 + sizeof(kj::MutexGuarded<void*>) / sizeof(void*)];
+  void* arenaSpace[17 + sizeof(kj::MutexGuarded<void*>) / sizeof(void*)];
   bool allocatedArena;
 
   _::ReaderArena* arena() { return reinterpret_cast<_::ReaderArena*>(arenaSpace); }
@@ -207,8 +226,25 @@ public:
 
   Orphanage getOrphanage();
 
+  size_t getWastedWords();
+  // Returns how many of the words in getSegmentsForOutput() are not reachable from the root:
+  // space left behind by overwritten fields, discarded or not-yet-adopted orphans, and unused
+  // tails of list and struct resizes.  Writing fields in place never reclaims this space, so a
+  // long-lived message that is mutated repeatedly keeps growing; compare this with the output
+  // size to decide when to call `MallocMessageBuilder::compact()`.
+  //
+  // Far pointer landing pads count as waste too, so a multi-segment message never reports zero.
+  // This walks the whole message, so it costs about as much as a copy.
+
+protected:
+  void clearArena();
+  // Destroys the message content built so far, including its capability table, so that the next
+  // call to initRoot() etc. starts a new message.  Any outstanding Builders and Orphans pointing
+  // into the old message become invalid.  This does not free any segments; a subclass calling
+  // this must make sure that allocateSegment() returns zeroed space afterwards.
+
 private:
-  void* arenaSpace[18];
+  void* arenaSpace[19];
   // Space in which we can construct a BuilderArena.  We don't use BuilderArena directly here
   // because we don't want clients to have to #include arena.h, which itself includes a bunch of
   // big STL headers.  We don't use a pointer to a BuilderArena because that would require an
@@ -258,6 +294,31 @@ void copyToUnchecked(Reader&& reader, kj::ArrayPtr<word> uncheckedBuffer);
 // readMessageUnchecked().  The buffer's size must be exactly reader.totalSizeInWords() + 1,
 // otherwise an exception will be thrown.  The buffer must be zero'd before calling.
 
+template <typename Reader>
+kj::Array<word> canonicalize(Reader&& reader);
+// Returns the canonical encoding of the given struct (generated type, DynamicStruct, or
+// AnyPointer): a single segment, starting with the root pointer, in which objects appear in
+// pre-order, struct data sections and pointer sections have trailing zeros / nulls truncated,
+// and all padding is zero.  Two values with the same content always have byte-for-byte identical
+// canonical encodings, so the result is suitable for hashing, deduplication, and signing.
+// Throws if the value contains capabilities.  The result can be read with
+// readMessageUnchecked() or, with checking, FlatArrayMessageReader.
+
+bool isCanonical(kj::ArrayPtr<const word> words);
+// Returns true if `words` is a valid single-segment message that is already in canonical form.
+// Two canonical messages are equal exactly when their words are equal, so stored canonical
+// encodings can be compared with memcmp() and hashed as bytes without being parsed.
+
+template <typename Reader>
+bool structurallyEqual(const Reader& a, const Reader& b);
+// Returns true if `a` and `b` would have the same canonical encoding, comparing the readers
+// directly without canonicalizing either one.  Valid for the same types as canonicalize().
+
+template <typename Reader>
+uint64_t structuralHash(const Reader& reader);
+// Hashes the content of the reader consistently with structurallyEqual(), again without
+// canonicalizing.  Not stable across CPU endianness; do not persist the result.
+
 template <typename Type>
 static typename Type::Reader defaultValue();
 // Get a default instance of the given struct or list type.
@@ -281,11 +342,51 @@ public:
   ~SegmentArrayMessageReader() noexcept(false);
 
   virtual kj::ArrayPtr<const word> getSegment(uint id) override;
+  uint getSegmentCount() override;
 
 private:
   kj::ArrayPtr<const kj::ArrayPtr<const word>> segments;
 };
 
+class ValidatedMessage {
+  // Validates a message once up-front and then provides unchecked readers for it.
+  //
+  // The constructor performs a single full traversal of the message, applying the same bounds,
+  // far pointer, nesting, and traversal limit checks that a regular MessageReader applies lazily,
+  // and throws if any of them fail.  Afterwards, getRoot() returns readers built on
+  // readMessageUnchecked(), so field access does no per-pointer bounds checking and does not
+  // charge a read limiter.  This is meant for messages whose integrity is already established
+  // by other means (e.g. files written by this process and protected by a checksum) but which
+  // are still read often enough that checking costs matter.
+  //
+  // If the message consists of a single segment containing no far pointers, it is used in-place
+  // and the segment array must remain valid for the lifetime of the ValidatedMessage.  Otherwise,
+  // the message is flattened into a single owned buffer during validation.  Messages containing
+  // capabilities are rejected, since unchecked readers have no capability table.
+
+public:
+  explicit ValidatedMessage(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments,
+                            ReaderOptions options = ReaderOptions());
+  explicit ValidatedMessage(kj::ArrayPtr<const word> segment,
+                            ReaderOptions options = ReaderOptions());
+  KJ_DISALLOW_COPY(ValidatedMessage);
+
+  template <typename RootType>
+  typename RootType::Reader getRoot() const;
+  // Get an unchecked reader for the root of the message.
+
+  inline bool isInPlace() const { return ownedCopy == nullptr; }
+  // True if the readers point directly into the original segments, false if the message had to
+  // be flattened into a private copy.
+
+  inline kj::ArrayPtr<const word> getFlatWords() const;
+  // Returns the words that the unchecked readers point into.  The first word is the root pointer.
+
+private:
+  kj::ArrayPtr<const word> words;
+  kj::Array<word> ownedCopy;
+};
+
 enum class AllocationStrategy: uint8_t {
   FIXED_SIZE,
   // The builder will prefer to allocate the same amount of space for each segment with no
@@ -305,10 +406,28 @@ enum class AllocationStrategy: uint8_t {
 constexpr uint SUGGESTED_FIRST_SEGMENT_WORDS = 1024;
 constexpr AllocationStrategy SUGGESTED_ALLOCATION_STRATEGY = AllocationStrategy::GROW_HEURISTICALLY;
 
+class SegmentAllocator {
+  // Supplies the memory for a `MallocMessageBuilder`'s segments, in place of calloc() and free().
+  // See `capnp/segment-allocator.h` for implementations backed by a free-list pool, huge pages, or
+  // memory on a particular NUMA node.
+
+public:
+  virtual ~SegmentAllocator() noexcept(false);
+
+  virtual kj::ArrayPtr<word> allocate(uint minimumWords) = 0;
+  // Returns a block of at least `minimumWords` words, which must be entirely zero.  The block may
+  // be bigger than requested, in which case the builder uses the extra space.  Memory that is
+  // known to be zero already, such as a fresh anonymous mmap(), need not be cleared again.
+
+  virtual void release(kj::ArrayPtr<word> segment, size_t wordsUsed) = 0;
+  // Returns a block obtained from `allocate()`.  Only the first `wordsUsed` words can be non-zero,
+  // so an allocator that reuses blocks only has to clear that much.
+};
+
 class MallocMessageBuilder: public MessageBuilder {
-  // A simple MessageBuilder that uses malloc() (actually, calloc()) to allocate segments.  This
-  // implementation should be reasonable for any case that doesn't require writing the message to
-  // a specific location in memory.
+  // A simple MessageBuilder that uses malloc() (actually, calloc()) to allocate segments, or a
+  // `SegmentAllocator` if one is given.  This implementation should be reasonable for any case that
+  // doesn't require writing the message to a specific location in memory.
 
 public:
   explicit MallocMessageBuilder(uint firstSegmentWords = SUGGESTED_FIRST_SEGMENT_WORDS,
@@ -334,22 +453,87 @@ public:
   // firstSegment MUST be zero-initialized.  MallocMessageBuilder's destructor will write new zeros
   // over any space that was used so that it can be reused.
 
+  explicit MallocMessageBuilder(SegmentAllocator& allocator,
+      uint firstSegmentWords = SUGGESTED_FIRST_SEGMENT_WORDS,
+      AllocationStrategy allocationStrategy = SUGGESTED_ALLOCATION_STRATEGY);
+  // Like the first constructor, but gets segments from `allocator`, which must outlive the builder.
+
   KJ_DISALLOW_COPY(MallocMessageBuilder);
   virtual ~MallocMessageBuilder() noexcept(false);
 
+  void reset();
+  // Discards the message content so that the builder can be used to build a new message, but
+  // keeps all the segments allocated so far for reuse.  Only the words actually used by the old
+  // message are zeroed.  Any outstanding Builders and Orphans pointing into the old message
+  // become invalid.
+  //
+  // Use this to build many messages in a loop without calling malloc() and free() each time.
+
+  void compact();
+  // Rewrites the message so that its reachable content is packed contiguously, dropping the space
+  // counted by getWastedWords().  When the builder owns its first segment, that segment is
+  // replaced by one big enough to hold the whole message, so the result is a single segment.
+  // Other segments are kept for reuse, as with reset().
+  //
+  // The message is copied twice (out to a scratch message and back).  Like reset(), this
+  // invalidates all outstanding Builders and Orphans; get new ones from getRoot().
+
   virtual kj::ArrayPtr<word> allocateSegment(uint minimumSize) override;
 
 private:
   uint nextSize;
   AllocationStrategy allocationStrategy;
 
+  SegmentAllocator* allocator = nullptr;
+  // Null to use calloc() and free().
+
   bool ownFirstSegment;
   bool returnedFirstSegment;
 
   void* firstSegment;
+  uint firstSegmentSize;
 
   struct MoreSegments;
   kj::Maybe<kj::Own<MoreSegments>> moreSegments;
+
+  bool ownsSegment(const word* start);
+  // Whether `start` is the beginning of a segment returned by allocateSegment(), as opposed to
+  // external data referenced by the message.
+
+  kj::ArrayPtr<word> allocateMemory(uint size);
+  void releaseMemory(void* segment, size_t size, size_t wordsUsed);
+
+  friend class MessageBuilderPool;
+};
+
+class MessageBuilderPool: private kj::Disposer {
+  // Hands out MallocMessageBuilders and takes them back for reuse when they are dropped, so that
+  // code building a message per request doesn't malloc() and free() segments each time.  A
+  // builder returned by get() is reset() and placed back in the pool when its Own is destroyed.
+  //
+  // A pool is not thread-safe:  all builders from a given pool must be created and destroyed in
+  // the same thread, and the pool must outlive them.
+
+public:
+  explicit MessageBuilderPool(uint maxPooledBuilders = 16, uint maxRetainedWords = 65536);
+  // At most `maxPooledBuilders` idle builders are kept.  A builder whose message grew beyond
+  // `maxRetainedWords` is freed rather than pooled, so that one huge message doesn't pin its
+  // memory forever.
+
+  KJ_DISALLOW_COPY(MessageBuilderPool);
+  ~MessageBuilderPool() noexcept(false);
+
+  kj::Own<MallocMessageBuilder> get(uint firstSegmentWords = SUGGESTED_FIRST_SEGMENT_WORDS);
+  // Gets an empty builder whose first segment has room for at least `firstSegmentWords`.  If no
+  // idle builder is big enough, one of them is replaced by a new builder of the requested size.
+
+private:
+  uint maxPooledBuilders;
+  uint maxRetainedWords;
+
+  mutable kj::Vector<MallocMessageBuilder*> idle;
+
+  void disposeImpl(void* pointer) const override;
 };
 
 class FlatMessageBuilder: public MessageBuilder {
@@ -439,6 +623,36 @@ void copyToUnchecked(Reader&& reader, kj::ArrayPtr<word> uncheckedBuffer) {
   builder.requireFilled();
 }
 
+namespace _ {  // private
+kj::Array<word> canonicalizeImpl(const StructReader& reader);
+kj::Array<word> canonicalizeImpl(const PointerReader& reader);
+}  // namespace _ (private)
+
+template <typename Reader>
+inline kj::Array<word> canonicalize(Reader&& reader) {
+  return _::canonicalizeImpl(_::PointerHelpers<FromReader<Reader>>::getInternalReader(reader));
+}
+
+template <typename Reader>
+inline bool structurallyEqual(const Reader& a, const Reader& b) {
+  typedef _::PointerHelpers<FromReader<Reader>> Helpers;
+  return Helpers::getInternalReader(a).equals(Helpers::getInternalReader(b));
+}
+
+template <typename Reader>
+inline uint64_t structuralHash(const Reader& reader) {
+  return _::PointerHelpers<FromReader<Reader>>::getInternalReader(reader).hash();
+}
+
+template <typename RootType>
+inline typename RootType::Reader ValidatedMessage::getRoot() const {
+  return readMessageUnchecked<RootType>(words.begin());
+}
+
+inline kj::ArrayPtr<const word> ValidatedMessage::getFlatWords() const {
+  return words;
+}
+
 }  // namespace capnp
 
 #endif  // CAPNP_MESSAGE_H_
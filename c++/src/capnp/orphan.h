@@ -61,6 +61,16 @@ public:
 
   inline ReaderFor<T> getReader() const;
 
+  inline void truncate(uint size);
+  // Shrinks a list, Text, or Data orphan to `size` elements (for Text, characters) in place,
+  // without copying.  The dropped elements are zeroed, along with anything they point to; if the
+  // list was the last thing allocated in its segment, the space is also given back so that the
+  // next allocation can reuse it.  `size` must not exceed the current size.  Only valid for
+  // T = List<U>, Text, or Data.
+  //
+  // This is the cheap way to trim a list that was allocated for a worst-case element count and
+  // then only partly filled.
+
   inline bool operator==(decltype(nullptr)) const { return builder == nullptr; }
   inline bool operator!=(decltype(nullptr)) const { return builder != nullptr; }
 
@@ -120,6 +130,23 @@ public:
   // Allocate a new orphaned object (struct, list, or blob) and initialize it as a copy of the
   // given object.
 
+  Orphan<Data> referenceExternalData(Data::Reader data) const;
+  Orphan<Text> referenceExternalText(Text::Reader text) const;
+  // Creates an orphan that points at an existing region of memory without copying it.  The memory
+  // becomes one of the message's segments, linked in via a far pointer once the orphan is adopted,
+  // so writeMessage() and the RPC system send it straight from the caller's buffer.  This is
+  // useful for embedding very large blobs, e.g. whole mmap'd files.  The restrictions are SEVERE:
+  // - The memory must remain valid and unchanged until the `MessageBuilder` is destroyed or
+  //   reset, even if the orphan is abandoned.
+  // - Because the data is const, you will not be allowed to obtain a `Data::Builder` or
+  //   `Text::Builder` for it; any call which would return one throws.  You can obtain Readers,
+  //   e.g. via the orphan's getReader() or from a parent Reader once the orphan is adopted.
+  // - `data.begin()` must be aligned to a machine word boundary.  Anything returned by malloc()
+  //   qualifies, as does any blob obtained from another Cap'n Proto message.
+  // - The message will include the bytes after the end of the data, up to the next 8-byte
+  //   boundary, and so they must be readable and contain no secrets.  For Text, the count starts
+  //   after the NUL terminator.
+
 private:
   _::BuilderArena* arena;
 
@@ -171,6 +198,9 @@ struct OrphanGetImpl<List<T, k>, Kind::LIST> {
   static inline typename List<T>::Reader applyReader(const _::OrphanBuilder& builder) {
     return typename List<T>::Reader(builder.asListReader(_::ElementSizeForType<T>::value));
   }
+  static inline void truncate(_::OrphanBuilder& builder, uint size) {
+    builder.truncate(size * ELEMENTS, false);
+  }
 };
 
 template <typename T>
@@ -181,6 +211,9 @@ struct OrphanGetImpl<List<T, Kind::STRUCT>, Kind::LIST> {
   static inline typename List<T>::Reader applyReader(const _::OrphanBuilder& builder) {
     return typename List<T>::Reader(builder.asListReader(_::ElementSizeForType<T>::value));
   }
+  static inline void truncate(_::OrphanBuilder& builder, uint size) {
+    builder.truncate(size * ELEMENTS, false);
+  }
 };
 
 template <>
@@ -191,6 +224,9 @@ struct OrphanGetImpl<Text, Kind::BLOB> {
   static inline Text::Reader applyReader(const _::OrphanBuilder& builder) {
     return Text::Reader(builder.asTextReader());
   }
+  static inline void truncate(_::OrphanBuilder& builder, uint size) {
+    builder.truncate(size * ELEMENTS, true);
+  }
 };
 
 template <>
@@ -201,6 +237,9 @@ struct OrphanGetImpl<Data, Kind::BLOB> {
   static inline Data::Reader applyReader(const _::OrphanBuilder& builder) {
     return Data::Reader(builder.asDataReader());
   }
+  static inline void truncate(_::OrphanBuilder& builder, uint size) {
+    builder.truncate(size * ELEMENTS, false);
+  }
 };
 
 }  // namespace _ (private)
@@ -215,6 +254,11 @@ inline ReaderFor<T> Orphan<T>::getReader() const {
   return _::OrphanGetImpl<T>::applyReader(builder);
 }
 
+template <typename T>
+inline void Orphan<T>::truncate(uint size) {
+  _::OrphanGetImpl<T>::truncate(builder, size);
+}
+
 template <typename T>
 struct Orphanage::GetInnerBuilder<T, Kind::STRUCT> {
   static inline _::StructBuilder apply(typename T::Builder& t) {
@@ -303,6 +347,13 @@ inline Orphan<FromReader<Reader>> Orphanage::newOrphanCopy(Reader& copyFrom) con
   return newOrphanCopy(kj::implicitCast<const Reader&>(copyFrom));
 }
 
+inline Orphan<Data> Orphanage::referenceExternalData(Data::Reader data) const {
+  return Orphan<Data>(_::OrphanBuilder::referenceExternalData(arena, data));
+}
+inline Orphan<Text> Orphanage::referenceExternalText(Text::Reader text) const {
+  return Orphan<Text>(_::OrphanBuilder::referenceExternalText(arena, text));
+}
+
 }  // namespace capnp
 
 #endif  // CAPNP_ORPHAN_H_
@@ -49,6 +49,23 @@ struct PointerHelpers<T, Kind::STRUCT> {
   static inline typename T::Builder init(PointerBuilder builder) {
     return typename T::Builder(builder.initStruct(structSize<T>()));
   }
+  static inline void copy(PointerBuilder builder, PointerReader reader) {
+    // Used by generated copyFrom() methods.  Recurses into T's own copyFrom() when the source has
+    // T's layout; structs from other versions of the schema take the generic path so that fields
+    // unknown to us survive the copy.
+    if (reader.isNull()) {
+      builder.clear();
+    } else {
+      StructReader value = reader.getStruct(nullptr);
+      if (value.getDataSectionSize() == structSize<T>().data * BITS_PER_WORD &&
+          value.getPointerSectionSize() == structSize<T>().pointers) {
+        typename T::Builder(builder.initStruct(structSize<T>()))
+            .copyFrom(typename T::Reader(value));
+      } else {
+        builder.setStruct(value);
+      }
+    }
+  }
   static inline void adopt(PointerBuilder builder, Orphan<T>&& value) {
     builder.adopt(kj::mv(value.builder));
   }
@@ -113,6 +130,14 @@ struct PointerHelpers<T, Kind::BLOB> {
   static inline typename T::Builder init(PointerBuilder builder, uint size) {
     return builder.initBlob<T>(size * BYTES);
   }
+  static inline void copy(PointerBuilder builder, PointerReader reader) {
+    // Used by generated copyFrom() methods.
+    if (reader.isNull()) {
+      builder.clear();
+    } else {
+      builder.setBlob<T>(reader.getBlob<T>(nullptr, 0 * BYTES));
+    }
+  }
   static inline void adopt(PointerBuilder builder, Orphan<T>&& value) {
     builder.adopt(kj::mv(value.builder));
   }
@@ -27,6 +27,8 @@
 #include "dynamic.h"
 #include <kj/string-tree.h>
 
+namespace kj { class OutputStream; }
+
 namespace capnp {
 
 kj::StringTree prettyPrint(DynamicStruct::Reader value);
@@ -40,6 +42,33 @@ kj::StringTree prettyPrint(DynamicList::Builder value);
 // If you don't want indentation, just use the value's KJ stringifier (e.g. pass it to kj::str(),
 // any of the KJ debug macros, etc.).
 
+struct PrettyPrintOptions {
+  bool indent = true;
+  // Indent the output like prettyPrint() does.  If false, produce the same single-line text as
+  // the KJ stringifier.
+
+  uint threads = 1;
+  // If greater than one, lists with more than `chunkSize` elements are cut into chunks which are
+  // printed by up to this many threads at once.  The output is the same either way.  Recoverable
+  // exceptions raised while printing in a worker thread are passed on to the calling thread's
+  // kj::ExceptionCallback once that chunk is done.
+
+  uint chunkSize = 4096;
+  // Number of list elements per chunk when printing in parallel.
+};
+
+void prettyPrint(kj::OutputStream& output, DynamicStruct::Reader value,
+                 PrettyPrintOptions options = PrettyPrintOptions());
+void prettyPrint(kj::OutputStream& output, DynamicStruct::Builder value,
+                 PrettyPrintOptions options = PrettyPrintOptions());
+void prettyPrint(kj::OutputStream& output, DynamicList::Reader value,
+                 PrettyPrintOptions options = PrettyPrintOptions());
+void prettyPrint(kj::OutputStream& output, DynamicList::Builder value,
+                 PrettyPrintOptions options = PrettyPrintOptions());
+// Like prettyPrint() above, but writes the text to `output` while traversing the value, rather
+// than building the whole thing in memory first.  Use this for dumping large messages.  Output is
+// buffered internally; there is no need to wrap `output` in a buffered stream.
+
 }  // namespace capnp
 
 #endif  // PRETTY_PRINT_H_
@@ -0,0 +1,120 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rpc-observer.h"
+#include <time.h>
+
+namespace capnp {
+
+RpcObserver::~RpcObserver() noexcept(false) {}
+
+void RpcObserver::connectionOpened() {}
+void RpcObserver::connectionClosed() {}
+
+uint64_t RpcObserver::callStarted(Direction direction, uint64_t interfaceId, uint16_t methodId) {
+  return 0;
+}
+
+void RpcObserver::callFinished(Direction direction, uint64_t interfaceId, uint16_t methodId,
+                               uint64_t token, Outcome outcome) {}
+
+void RpcObserver::embargoStarted() {}
+void RpcObserver::embargoReleased() {}
+void RpcObserver::messageSent(size_t bytes) {}
+void RpcObserver::messageReceived(size_t bytes) {}
+
+// =======================================================================================
+
+namespace {
+
+uint64_t monotonicNanos() {
+  // kj::Timer::now() only advances when the event loop waits, which is too coarse for timing
+  // calls that complete within a single turn.
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
+
+}  // namespace
+
+kj::Maybe<const RpcStatsObserver::MethodStats&> RpcStatsObserver::getMethodStats(
+    Direction direction, uint64_t interfaceId, uint16_t methodId) const {
+  return methods.find(MethodKey { interfaceId, methodId, direction });
+}
+
+void RpcStatsObserver::connectionOpened() {
+  ++openConnections;
+}
+
+void RpcStatsObserver::connectionClosed() {
+  --openConnections;
+}
+
+uint64_t RpcStatsObserver::callStarted(
+    Direction direction, uint64_t interfaceId, uint16_t methodId) {
+  ++callsInFlight[index(direction)];
+  return monotonicNanos();
+}
+
+void RpcStatsObserver::callFinished(Direction direction, uint64_t interfaceId, uint16_t methodId,
+                                    uint64_t token, Outcome outcome) {
+  --callsInFlight[index(direction)];
+
+  kj::Duration latency = static_cast<int64_t>(monotonicNanos() - token) * kj::NANOSECONDS;
+  MethodStats& stats = methods[MethodKey { interfaceId, methodId, direction }];
+  ++stats.calls;
+  switch (outcome) {
+    case Outcome::RETURNED:
+      break;
+    case Outcome::FAILED:
+      ++stats.failures;
+      break;
+    case Outcome::CANCELED:
+      ++stats.cancellations;
+      break;
+  }
+  stats.totalLatency += latency;
+  if (latency > stats.maxLatency) stats.maxLatency = latency;
+}
+
+void RpcStatsObserver::embargoStarted() {
+  ++embargoesInFlight;
+  ++embargoCount;
+}
+
+void RpcStatsObserver::embargoReleased() {
+  --embargoesInFlight;
+}
+
+void RpcStatsObserver::messageSent(size_t bytes) {
+  ++messagesSent;
+  bytesSent += bytes;
+}
+
+void RpcStatsObserver::messageReceived(size_t bytes) {
+  ++messagesReceived;
+  bytesReceived += bytes;
+}
+
+}  // namespace capnp
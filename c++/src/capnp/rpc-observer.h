@@ -0,0 +1,180 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef CAPNP_RPC_OBSERVER_H_
+#define CAPNP_RPC_OBSERVER_H_
+
+#include "common.h"
+#include <kj/hash.h>
+#include <kj/time.h>
+#include <inttypes.h>
+
+namespace capnp {
+
+class RpcObserver {
+  // Receives notifications about RPC activity, for metrics and tracing.  Install one with
+  // `RpcSystem::setObserver()`, and with `TwoPartyVatNetwork::setObserver()` to also get byte
+  // counts.  Every method has an empty default implementation, so an observer overrides only what
+  // it needs.
+  //
+  // All methods are called on the thread running the RpcSystem's event loop.  They must not throw
+  // and must not call back into the RPC system.  When no observer is installed, each event costs
+  // the RPC system a null check.
+
+public:
+  enum class Direction {
+    OUTGOING,
+    // A call made by this vat to a capability hosted by the peer (an entry in the question table).
+
+    INCOMING
+    // A call received from the peer (an entry in the answer table).
+  };
+
+  enum class Outcome {
+    RETURNED,   // The call completed with results (or, for tail calls, sent them elsewhere).
+    FAILED,     // The call threw an exception, or the connection was lost.
+    CANCELED    // The caller canceled the call before it returned.
+  };
+
+  virtual ~RpcObserver() noexcept(false);
+
+  virtual void connectionOpened();
+  virtual void connectionClosed();
+
+  virtual uint64_t callStarted(Direction direction, uint64_t interfaceId, uint16_t methodId);
+  // Returns an arbitrary token that will be passed back to callFinished() for the same call, such
+  // as a span ID or a start time.  The default returns zero.
+
+  virtual void callFinished(Direction direction, uint64_t interfaceId, uint16_t methodId,
+                            uint64_t token, Outcome outcome);
+  // Called exactly once for each callStarted():  for OUTGOING calls when the `Return` arrives or
+  // the connection is lost, for INCOMING calls when the `Return` is sent.
+
+  virtual void embargoStarted();
+  virtual void embargoReleased();
+  // An embargo holds back calls to a promise that resolved to a capability pointing back to this
+  // vat, until calls already sent through the peer have made it back.
+
+  virtual void messageSent(size_t bytes);
+  virtual void messageReceived(size_t bytes);
+  // Called by VatNetworks that support observers, once per message.  `bytes` is the size of the
+  // message data, before any packing.
+};
+
+class RpcStatsObserver final: public RpcObserver {
+  // An RpcObserver that keeps counters in memory, for polling by a metrics exporter or for tests.
+
+public:
+  struct MethodStats {
+    uint64_t calls = 0;
+    // Calls finished.
+
+    uint64_t failures = 0;
+    uint64_t cancellations = 0;
+    // Of which failed, or were canceled.
+
+    kj::Duration totalLatency = 0 * kj::NANOSECONDS;
+    kj::Duration maxLatency = 0 * kj::NANOSECONDS;
+    // Time from start to finish of the finished calls.
+  };
+
+  uint getOpenConnections() const { return openConnections; }
+  uint getCallsInFlight(Direction direction) const { return callsInFlight[index(direction)]; }
+  // The number of outgoing calls in flight is the size of the question table, the number of
+  // incoming ones the size of the answer table.
+
+  uint getEmbargoesInFlight() const { return embargoesInFlight; }
+  uint64_t getEmbargoCount() const { return embargoCount; }
+
+  uint64_t getMessagesSent() const { return messagesSent; }
+  uint64_t getMessagesReceived() const { return messagesReceived; }
+  uint64_t getBytesSent() const { return bytesSent; }
+  uint64_t getBytesReceived() const { return bytesReceived; }
+
+  kj::Maybe<const MethodStats&> getMethodStats(
+      Direction direction, uint64_t interfaceId, uint16_t methodId) const;
+
+  template <typename Func>
+  void forEachMethod(Func&& func);
+  // Calls `func(direction, interfaceId, methodId, const MethodStats&)` for every method that has
+  // had a call finish.
+
+  // implements RpcObserver --------------------------------------------------
+
+  void connectionOpened() override;
+  void connectionClosed() override;
+  uint64_t callStarted(Direction direction, uint64_t interfaceId, uint16_t methodId) override;
+  void callFinished(Direction direction, uint64_t interfaceId, uint16_t methodId,
+                    uint64_t token, Outcome outcome) override;
+  void embargoStarted() override;
+  void embargoReleased() override;
+  void messageSent(size_t bytes) override;
+  void messageReceived(size_t bytes) override;
+
+private:
+  struct MethodKey {
+    uint64_t interfaceId;
+    uint16_t methodId;
+    Direction direction;
+
+    inline bool operator==(const MethodKey& other) const {
+      return interfaceId == other.interfaceId && methodId == other.methodId &&
+             direction == other.direction;
+    }
+  };
+
+  struct MethodKeyHasher {
+    inline uint operator()(const MethodKey& key) const {
+      return kj::DefaultHasher<uint64_t>()(
+          key.interfaceId + key.methodId + (static_cast<uint64_t>(key.direction) << 32));
+    }
+  };
+
+  uint openConnections = 0;
+  uint callsInFlight[2] = {0, 0};
+  uint embargoesInFlight = 0;
+  uint64_t embargoCount = 0;
+  uint64_t messagesSent = 0;
+  uint64_t messagesReceived = 0;
+  uint64_t bytesSent = 0;
+  uint64_t bytesReceived = 0;
+
+  kj::HashMap<MethodKey, MethodStats, MethodKeyHasher> methods;
+
+  static inline uint index(Direction direction) { return static_cast<uint>(direction); }
+};
+
+// =======================================================================================
+// inline implementation details
+
+template <typename Func>
+void RpcStatsObserver::forEachMethod(Func&& func) {
+  methods.forEach([&](const MethodKey& key, const MethodStats& stats) {
+    func(key.direction, key.interfaceId, key.methodId, stats);
+  });
+}
+
+}  // namespace capnp
+
+#endif  // CAPNP_RPC_OBSERVER_H_
@@ -33,6 +33,7 @@ namespace capnp {
 
 class OutgoingRpcMessage;
 class IncomingRpcMessage;
+class RpcObserver;
 
 template <typename SturdyRefHostId>
 class RpcSystem;
@@ -83,6 +84,12 @@ private:
   // TODO(someday):  Maybe define a public API called `TypelessStruct` so we don't have to rely
   // on `_::StructReader` here?
 
+  void baseSetFlowControlWindow(size_t bytes);
+  size_t baseGetCallBytesInFlight();
+  void baseSetIncomingCallLimit(uint calls);
+  uint baseGetIncomingCallsInProgress();
+  void baseSetObserver(kj::Maybe<RpcObserver&> observer);
+
   template <typename>
   friend class capnp::RpcSystem;
 };
@@ -0,0 +1,368 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rpc-shm.h"
+#include "test-util.h"
+#include <kj/async-unix.h>
+#include <kj/debug.h>
+#include <kj/thread.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+namespace capnp {
+namespace _ {
+namespace {
+
+class BigFooImpl final: public test::TestInterface::Server {
+  // foo() returns a string of the requested length.
+
+public:
+  BigFooImpl(int& callCount): callCount(callCount) {}
+
+protected:
+  kj::Promise<void> foo(FooContext context) override {
+    ++callCount;
+    auto text = context.getResults().initX(context.getParams().getI());
+    memset(text.begin(), 'x', text.size());
+    return kj::READY_NOW;
+  }
+
+private:
+  int& callCount;
+};
+
+class TestRestorer final: public SturdyRefRestorer<test::TestSturdyRefObjectId> {
+public:
+  TestRestorer(int& callCount): callCount(callCount) {}
+
+  Capability::Client restore(test::TestSturdyRefObjectId::Reader objectId) override {
+    switch (objectId.getTag()) {
+      case test::TestSturdyRefObjectId::Tag::TEST_INTERFACE:
+        return kj::heap<BigFooImpl>(callCount);
+      case test::TestSturdyRefObjectId::Tag::TEST_PIPELINE:
+        return kj::heap<TestPipelineImpl>(callCount);
+      default:
+        return Capability::Client(newBrokenCap("Not implemented."));
+    }
+  }
+
+private:
+  int& callCount;
+};
+
+kj::AsyncIoProvider::PipeThread runServer(kj::AsyncIoProvider& ioProvider, int regionFd,
+                                          int& callCount) {
+  return ioProvider.newPipeThread(
+      [regionFd,&callCount](kj::AsyncIoProvider& ioProvider, kj::AsyncIoStream& stream,
+                            kj::WaitScope& waitScope) {
+    SharedMemoryVatNetwork network(stream, regionFd, rpc::twoparty::Side::SERVER);
+    TestRestorer restorer(callCount);
+    auto server = makeRpcServer(network, restorer);
+    network.onDisconnect().wait(waitScope);
+  });
+}
+
+Capability::Client getPersistentCap(RpcSystem<rpc::twoparty::SturdyRefHostId>& client,
+                                    test::TestSturdyRefObjectId::Tag tag) {
+  MallocMessageBuilder hostIdMessage(8);
+  auto hostId = hostIdMessage.initRoot<rpc::twoparty::SturdyRefHostId>();
+  hostId.setSide(rpc::twoparty::Side::SERVER);
+
+  MallocMessageBuilder objectIdMessage(8);
+  objectIdMessage.initRoot<test::TestSturdyRefObjectId>().setTag(tag);
+
+  return client.restore(hostId, objectIdMessage.getRoot<AnyPointer>());
+}
+
+kj::Promise<void> callFoo(test::TestInterface::Client& client, uint size) {
+  auto request = client.fooRequest();
+  request.setI(size);
+  return request.send().then([size](Response<test::TestInterface::FooResults>&& response) {
+    auto text = response.getX();
+    EXPECT_EQ(size, text.size());
+    for (char c: text) {
+      if (c != 'x') {
+        ADD_FAILURE() << "Response corrupted.";
+        break;
+      }
+    }
+  });
+}
+
+TEST(SharedMemoryNetwork, Basic) {
+  auto ioContext = kj::setupAsyncIo();
+  auto region = SharedMemoryVatNetwork::newRegion();
+  int callCount = 0;
+
+  auto serverThread = runServer(*ioContext.provider, region, callCount);
+  SharedMemoryVatNetwork network(*serverThread.pipe, region, rpc::twoparty::Side::CLIENT);
+  auto rpcClient = makeRpcClient(network);
+
+  auto client = getPersistentCap(rpcClient, test::TestSturdyRefObjectId::Tag::TEST_INTERFACE)
+      .castAs<test::TestInterface>();
+
+  callFoo(client, 3).wait(ioContext.waitScope);
+  callFoo(client, 100000).wait(ioContext.waitScope);
+  EXPECT_EQ(2, callCount);
+}
+
+TEST(SharedMemoryNetwork, Pipelining) {
+  auto ioContext = kj::setupAsyncIo();
+  auto region = SharedMemoryVatNetwork::newRegion();
+  int callCount = 0;
+  int reverseCallCount = 0;  // Calls back from server to client.
+
+  auto serverThread = runServer(*ioContext.provider, region, callCount);
+  SharedMemoryVatNetwork network(*serverThread.pipe, region, rpc::twoparty::Side::CLIENT);
+  auto rpcClient = makeRpcClient(network);
+
+  auto client = getPersistentCap(rpcClient, test::TestSturdyRefObjectId::Tag::TEST_PIPELINE)
+      .castAs<test::TestPipeline>();
+
+  auto request = client.getCapRequest();
+  request.setN(234);
+  request.setInCap(test::TestInterface::Client(kj::heap<TestInterfaceImpl>(reverseCallCount)));
+
+  auto promise = request.send();
+
+  auto pipelineRequest = promise.getOutBox().getCap().fooRequest();
+  pipelineRequest.setI(321);
+  auto pipelinePromise = pipelineRequest.send();
+
+  auto pipelineRequest2 = promise.getOutBox().getCap().castAs<test::TestExtends>().graultRequest();
+  auto pipelinePromise2 = pipelineRequest2.send();
+
+  promise = nullptr;  // Just to be annoying, drop the original promise.
+
+  auto response = pipelinePromise.wait(ioContext.waitScope);
+  EXPECT_EQ("bar", response.getX());
+
+  auto response2 = pipelinePromise2.wait(ioContext.waitScope);
+  checkTestMessage(response2);
+
+  EXPECT_EQ(3, callCount);
+  EXPECT_EQ(1, reverseCallCount);
+}
+
+TEST(SharedMemoryNetwork, RegionFull) {
+  // With a tiny region, most segments don't fit and have to be sent over the stream instead.
+
+  auto ioContext = kj::setupAsyncIo();
+  auto region = SharedMemoryVatNetwork::newRegion(4096);
+  int callCount = 0;
+
+  auto serverThread = runServer(*ioContext.provider, region, callCount);
+  SharedMemoryVatNetwork network(*serverThread.pipe, region, rpc::twoparty::Side::CLIENT);
+  auto rpcClient = makeRpcClient(network);
+
+  auto client = getPersistentCap(rpcClient, test::TestSturdyRefObjectId::Tag::TEST_INTERFACE)
+      .castAs<test::TestInterface>();
+
+  auto promise1 = callFoo(client, 10);
+  auto promise2 = callFoo(client, 50000);
+  auto promise3 = callFoo(client, 2000);
+  promise1.wait(ioContext.waitScope);
+  promise2.wait(ioContext.waitScope);
+  promise3.wait(ioContext.waitScope);
+  EXPECT_EQ(3, callCount);
+}
+
+TEST(SharedMemoryNetwork, SpaceIsReused) {
+  // Many more messages than fit in the region at once, so released space must be reused.
+
+  auto ioContext = kj::setupAsyncIo();
+  auto region = SharedMemoryVatNetwork::newRegion(1 << 16);
+  int callCount = 0;
+
+  auto serverThread = runServer(*ioContext.provider, region, callCount);
+  SharedMemoryVatNetwork network(*serverThread.pipe, region, rpc::twoparty::Side::CLIENT);
+  auto rpcClient = makeRpcClient(network);
+
+  auto client = getPersistentCap(rpcClient, test::TestSturdyRefObjectId::Tag::TEST_INTERFACE)
+      .castAs<test::TestInterface>();
+
+  for (uint i = 0; i < 200; i++) {
+    kj::Vector<kj::Promise<void>> promises;
+    for (uint j = 0; j < 4; j++) {
+      promises.add(callFoo(client, 1000 + i * 7 + j));
+    }
+    for (auto& promise: promises) {
+      promise.wait(ioContext.waitScope);
+    }
+  }
+  EXPECT_EQ(800, callCount);
+}
+
+struct RawRecord {
+  // The wire format of a record with one segment, as written by SharedMemoryVatNetwork.
+
+  uint32_t type;
+  uint32_t segmentCount;
+  uint32_t offset;
+  uint32_t size;
+  uint32_t used;
+  uint32_t reserved;
+};
+
+static constexpr uint32_t RAW_RELEASE = 2;
+
+kj::Own<TwoPartyVatNetworkBase::Connection> connectToServer(SharedMemoryVatNetwork& network) {
+  MallocMessageBuilder hostIdMessage(8);
+  auto hostId = hostIdMessage.initRoot<rpc::twoparty::SturdyRefHostId>();
+  hostId.setSide(rpc::twoparty::Side::SERVER);
+  KJ_IF_MAYBE(connection, network.connectToRefHost(hostId)) {
+    return kj::mv(*connection);
+  }
+  KJ_FAIL_ASSERT("Expected a connection to the server.");
+}
+
+TEST(SharedMemoryNetwork, SentSpaceOutlivesRelease) {
+  // The peer releasing a message must not free space that the sender's builder still uses.
+
+  auto ioContext = kj::setupAsyncIo();
+  auto region = SharedMemoryVatNetwork::newRegion(1 << 16);
+  auto pipe = ioContext.provider->newTwoWayPipe();
+  SharedMemoryVatNetwork network(*pipe.ends[0], region, rpc::twoparty::Side::CLIENT);
+  auto connection = connectToServer(network);
+
+  auto message = connection->newOutgoingMessage(0);
+  message->getBody().setAs<Text>("still here");
+  message->send();
+
+  RawRecord record;
+  pipe.ends[1]->read(&record, sizeof(record)).wait(ioContext.waitScope);
+  ASSERT_EQ(1u, record.segmentCount);
+  ASSERT_NE(0xffffffffu, record.offset) << "Expected the segment to be in shared memory.";
+
+  // Release it, then release it again.  The duplicate is rejected.
+  record.type = RAW_RELEASE;
+  RawRecord records[2] = { record, record };
+  pipe.ends[1]->write(records, sizeof(records)).wait(ioContext.waitScope);
+  EXPECT_ANY_THROW(connection->receiveIncomingMessage().wait(ioContext.waitScope));
+
+  // The first release did not wipe the message out from under its builder.
+  EXPECT_EQ("still here", message->getBody().getAs<Text>());
+
+  // Allocating more space must not hand out the builder's block either.
+  auto other = connection->newOutgoingMessage(0);
+  other->getBody().setAs<Text>("something else");
+  EXPECT_EQ("still here", message->getBody().getAs<Text>());
+}
+
+TEST(SharedMemoryNetwork, RejectBogusRelease) {
+  auto ioContext = kj::setupAsyncIo();
+  auto region = SharedMemoryVatNetwork::newRegion(1 << 16);
+
+  RawRecord bogus[3];
+  memset(bogus, 0, sizeof(bogus));
+  for (auto& record: bogus) {
+    record.type = RAW_RELEASE;
+    record.segmentCount = 1;
+  }
+  bogus[0].size = 16;                   // Never allocated.
+  bogus[1].size = 0;                    // Zero size.
+  bogus[2].offset = (1 << 16) / 8 / 2;  // In the peer's half.
+  bogus[2].size = 16;
+
+  for (auto& record: bogus) {
+    auto pipe = ioContext.provider->newTwoWayPipe();
+    SharedMemoryVatNetwork network(*pipe.ends[0], region, rpc::twoparty::Side::CLIENT);
+    auto connection = connectToServer(network);
+
+    pipe.ends[1]->write(&record, sizeof(record)).wait(ioContext.waitScope);
+    EXPECT_ANY_THROW(connection->receiveIncomingMessage().wait(ioContext.waitScope));
+  }
+}
+
+class BreakingStream final: public kj::AsyncIoStream {
+  // Never delivers any data.  The first `writesBeforeFailure` writes succeed; later ones fail a
+  // turn after they start, as writes to a broken connection would.
+
+public:
+  uint writesBeforeFailure = 0;
+  uint writeCount = 0;
+
+  kj::Promise<size_t> read(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return kj::NEVER_DONE;
+  }
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return kj::NEVER_DONE;
+  }
+
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    if (writeCount++ < writesBeforeFailure) {
+      return kj::READY_NOW;
+    }
+    return kj::evalLater([]() -> kj::Promise<void> {
+      KJ_FAIL_ASSERT("stream broke");
+    });
+  }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+    return write(nullptr, 0);
+  }
+
+  void shutdownWrite() override {}
+};
+
+TEST(SharedMemoryNetwork, WriteFailure) {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+  auto runTurns = [&]() {
+    for (uint i = 0; i < 5; i++) {
+      kj::evalLater([]() {}).wait(waitScope);
+    }
+  };
+
+  auto region = SharedMemoryVatNetwork::newRegion(1 << 16);
+  BreakingStream stream;
+  stream.writesBeforeFailure = 1;
+  SharedMemoryVatNetwork network(stream, region, rpc::twoparty::Side::CLIENT);
+  auto connection = connectToServer(network);
+
+  auto sendOne = [&]() {
+    auto message = connection->newOutgoingMessage(0);
+    message->getBody().setAs<Text>("foo");
+    message->send();
+  };
+
+  sendOne();
+  runTurns();
+  EXPECT_EQ(1u, stream.writeCount);
+
+  // The second batch's write fails while another message is queued behind it.
+  sendOne();
+  kj::evalLater([]() {}).wait(waitScope);
+  kj::evalLater([]() {}).wait(waitScope);
+  EXPECT_EQ(2u, stream.writeCount);
+  sendOne();
+  runTurns();
+
+  EXPECT_EQ(2u, stream.writeCount);
+  EXPECT_ANY_THROW(sendOne());
+  runTurns();
+  EXPECT_EQ(2u, stream.writeCount);
+}
+
+}  // namespace
+}  // namespace _
+}  // namespace capnp
@@ -0,0 +1,578 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rpc-shm.h"
+#include <kj/debug.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+namespace capnp {
+
+// The stream carries a sequence of records.  Each is a RecordHeader followed by `segmentCount`
+// SegmentDescriptors.  A MESSAGE record describes a message the sender has finished building; its
+// descriptors are followed by the content of any INLINE segments, in order.  A RELEASE record
+// returns the listed segments of earlier MESSAGE records to their sender.  Both peers are on the
+// same host, so everything is in native byte order.
+
+enum RecordType: uint32_t {
+  MESSAGE = 1,
+  RELEASE = 2
+};
+
+static constexpr uint32_t INLINE_SEGMENT = 0xffffffffu;
+// SegmentDescriptor::offset for a segment whose content follows the record on the stream rather
+// than being in the shared region.
+
+static constexpr uint32_t MAX_SEGMENTS = 512;
+// Same limit as the stream serialization, for the same reason.
+
+struct SharedMemoryVatNetwork::RecordHeader {
+  uint32_t type;
+  uint32_t segmentCount;
+};
+
+struct SharedMemoryVatNetwork::SegmentDescriptor {
+  uint32_t offset;
+  // Words from the start of the region, or INLINE_SEGMENT.
+
+  uint32_t size;
+  // Words allocated.  Zero for inline segments.
+
+  uint32_t used;
+  // Words actually part of the message.
+
+  uint32_t reserved;
+};
+
+static_assert(sizeof(word) == 8, "Records assume 8-byte words.");
+
+constexpr size_t SharedMemoryVatNetwork::DEFAULT_REGION_SIZE;
+
+kj::AutoCloseFd SharedMemoryVatNetwork::newRegion(size_t size) {
+  int fd;
+#if __linux__ && defined(MFD_CLOEXEC)
+  KJ_SYSCALL(fd = memfd_create("capnp-rpc", MFD_CLOEXEC));
+#else
+  // No anonymous shared memory; create a named object and unlink it immediately.
+  auto name = kj::str("/capnp-rpc-", getpid(), '-', reinterpret_cast<uintptr_t>(&fd), '-', rand());
+  KJ_SYSCALL(fd = shm_open(name.cStr(), O_RDWR | O_CREAT | O_EXCL, 0600), name);
+  KJ_SYSCALL(shm_unlink(name.cStr()), name);
+#endif
+  kj::AutoCloseFd result(fd);
+  KJ_SYSCALL(ftruncate(fd, size));
+  return kj::mv(result);
+}
+
+SharedMemoryVatNetwork::SharedMemoryVatNetwork(
+    kj::AsyncIoStream& stream, int regionFd, rpc::twoparty::Side side,
+    ReaderOptions receiveOptions)
+    : stream(stream), side(side), receiveOptions(receiveOptions), previousWrite(kj::READY_NOW) {
+  struct stat stats;
+  KJ_SYSCALL(fstat(regionFd, &stats));
+  size_t regionWords = stats.st_size / sizeof(word);
+  KJ_REQUIRE(regionWords >= 2, "Shared memory region is too small.", stats.st_size);
+  KJ_REQUIRE(regionWords <= INLINE_SEGMENT, "Shared memory region is too large.", stats.st_size);
+
+  void* mapping = mmap(NULL, regionWords * sizeof(word), PROT_READ | PROT_WRITE, MAP_SHARED,
+                       regionFd, 0);
+  if (mapping == MAP_FAILED) {
+    KJ_FAIL_SYSCALL("mmap", errno);
+  }
+  region = kj::Array<word>(reinterpret_cast<word*>(mapping), regionWords,
+                           kj::MmapDisposer::instance);
+
+  size_t half = regionWords / 2;
+  auto clientSpace = region.slice(0, half);
+  auto serverSpace = region.slice(half, half * 2);
+  if (side == rpc::twoparty::Side::CLIENT) {
+    sendSpace = clientSpace;
+    receiveSpace = serverSpace;
+  } else {
+    sendSpace = serverSpace;
+    receiveSpace = clientSpace;
+  }
+  freeSpace[sendSpace.begin() - region.begin()] = sendSpace.size();
+
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  disconnectPromise = paf.promise.fork();
+  disconnectFulfiller.fulfiller = kj::mv(paf.fulfiller);
+}
+
+SharedMemoryVatNetwork::~SharedMemoryVatNetwork() noexcept(false) {}
+
+void SharedMemoryVatNetwork::FulfillerDisposer::disposeImpl(void* pointer) const {
+  if (--refcount == 0) {
+    fulfiller->fulfill();
+  }
+}
+
+kj::Own<TwoPartyVatNetworkBase::Connection> SharedMemoryVatNetwork::asConnection() {
+  ++disconnectFulfiller.refcount;
+  return kj::Own<TwoPartyVatNetworkBase::Connection>(this, disconnectFulfiller);
+}
+
+kj::Maybe<kj::Own<TwoPartyVatNetworkBase::Connection>> SharedMemoryVatNetwork::connectToRefHost(
+    rpc::twoparty::SturdyRefHostId::Reader ref) {
+  if (ref.getSide() == side) {
+    return nullptr;
+  } else {
+    return asConnection();
+  }
+}
+
+kj::Promise<kj::Own<TwoPartyVatNetworkBase::Connection>>
+    SharedMemoryVatNetwork::acceptConnectionAsRefHost() {
+  if (side == rpc::twoparty::Side::SERVER && !accepted) {
+    accepted = true;
+    return asConnection();
+  } else {
+    // Create a promise that will never be fulfilled.
+    auto paf = kj::newPromiseAndFulfiller<kj::Own<TwoPartyVatNetworkBase::Connection>>();
+    acceptFulfiller = kj::mv(paf.fulfiller);
+    return kj::mv(paf.promise);
+  }
+}
+
+// =======================================================================================
+// Shared space allocation
+
+kj::Maybe<kj::ArrayPtr<word>> SharedMemoryVatNetwork::allocateShared(
+    uint minimumSize, uint preferredSize) {
+  // First fit.  Take the preferred size if any block has it, otherwise settle for the minimum.
+
+  auto best = freeSpace.end();
+  for (auto iter = freeSpace.begin(); iter != freeSpace.end(); ++iter) {
+    if (iter->second >= preferredSize) {
+      best = iter;
+      break;
+    } else if (iter->second >= minimumSize && best == freeSpace.end()) {
+      best = iter;
+    }
+  }
+
+  if (best == freeSpace.end()) {
+    return nullptr;
+  }
+
+  size_t offset = best->first;
+  size_t size = kj::min(best->second, static_cast<size_t>(preferredSize));
+  if (size < best->second) {
+    freeSpace[offset + size] = best->second - size;
+  }
+  freeSpace.erase(best);
+
+  SharedBlock block;
+  block.size = size;
+  allocatedSpace[offset] = block;
+
+  return region.slice(offset, offset + size);
+}
+
+void SharedMemoryVatNetwork::sharedBlockSent(size_t offset, size_t used) {
+  auto iter = allocatedSpace.find(offset);
+  KJ_ASSERT(iter != allocatedSpace.end() && iter->second.builderAlive);
+
+  auto& block = iter->second;
+  block.used = kj::max(block.used, used);
+  ++block.peerRefs;
+}
+
+void SharedMemoryVatNetwork::sharedBlockDropped(size_t offset, size_t used) {
+  auto iter = allocatedSpace.find(offset);
+  KJ_ASSERT(iter != allocatedSpace.end() && iter->second.builderAlive);
+
+  auto& block = iter->second;
+  block.used = kj::max(block.used, used);
+  block.builderAlive = false;
+  if (block.peerRefs == 0) {
+    freeShared(offset, block.size, block.used);
+    allocatedSpace.erase(iter);
+  }
+}
+
+void SharedMemoryVatNetwork::sharedBlockReleased(const SegmentDescriptor& descriptor) {
+  auto iter = allocatedSpace.find(descriptor.offset);
+  KJ_REQUIRE(iter != allocatedSpace.end() && descriptor.size != 0 &&
+             descriptor.size == iter->second.size && iter->second.peerRefs > 0,
+             "Peer released a segment we didn't send.", descriptor.offset, descriptor.size);
+
+  auto& block = iter->second;
+  --block.peerRefs;
+  if (block.peerRefs == 0 && !block.builderAlive) {
+    freeShared(descriptor.offset, block.size, block.used);
+    allocatedSpace.erase(iter);
+  }
+}
+
+void SharedMemoryVatNetwork::freeShared(size_t offset, size_t size, size_t used) {
+  memset(region.begin() + offset, 0, used * sizeof(word));
+
+  // Merge with the following block.
+  auto next = freeSpace.find(offset + size);
+  if (next != freeSpace.end()) {
+    size += next->second;
+    freeSpace.erase(next);
+  }
+
+  // Merge with the preceding block.
+  auto iter = freeSpace.lower_bound(offset);
+  if (iter != freeSpace.begin()) {
+    --iter;
+    if (iter->first + iter->second == offset) {
+      iter->second += size;
+      return;
+    }
+  }
+
+  freeSpace[offset] = size;
+}
+
+// =======================================================================================
+// Outgoing messages
+
+class SharedMemoryVatNetwork::SharedMessageBuilder final: public MessageBuilder {
+  // Allocates segments in our half of the shared region, falling back to the heap when the
+  // region is full.
+
+public:
+  SharedMessageBuilder(SharedMemoryVatNetwork& network, uint firstSegmentWords)
+      : network(network), nextSize(firstSegmentWords) {}
+
+  ~SharedMessageBuilder() noexcept(false) {
+    // Shared segments that were sent are freed once the peer releases them as well.  Heap
+    // segments are always ours.
+    auto segments = getSegmentsForOutput();
+    for (uint i: kj::indices(allocations)) {
+      auto& allocation = allocations[i];
+      if (allocation.shared) {
+        network.sharedBlockDropped(allocation.space.begin() - network.region.begin(),
+                                   segments[i].size());
+      } else {
+        free(allocation.space.begin());
+      }
+    }
+  }
+
+  kj::ArrayPtr<word> allocateSegment(uint minimumSize) override {
+    uint size = kj::max(minimumSize, nextSize);
+
+    Allocation allocation;
+    KJ_IF_MAYBE(space, network.allocateShared(minimumSize, size)) {
+      allocation.space = *space;
+      allocation.shared = true;
+    } else {
+      void* result = calloc(size, sizeof(word));
+      if (result == nullptr) {
+        KJ_FAIL_SYSCALL("calloc(size, sizeof(word))", ENOMEM, size);
+      }
+      allocation.space = kj::arrayPtr(reinterpret_cast<word*>(result), size);
+      allocation.shared = false;
+    }
+    allocations.add(allocation);
+
+    // Grow heuristically, like MallocMessageBuilder.
+    nextSize += allocation.space.size();
+    return allocation.space;
+  }
+
+  void send() {
+    // Queue a MESSAGE record for the content built so far.
+
+    auto segments = getSegmentsForOutput();
+    KJ_ASSERT(segments.size() == allocations.size());
+
+    auto descriptors = kj::heapArrayBuilder<SegmentDescriptor>(segments.size());
+    auto inlineContent = kj::heapArrayBuilder<kj::ArrayPtr<const word>>(segments.size());
+    for (uint i: kj::indices(segments)) {
+      auto& allocation = allocations[i];
+      KJ_ASSERT(segments[i].begin() == allocation.space.begin());
+
+      SegmentDescriptor descriptor;
+      memset(&descriptor, 0, sizeof(descriptor));
+      descriptor.used = segments[i].size();
+      if (allocation.shared) {
+        descriptor.offset = allocation.space.begin() - network.region.begin();
+        descriptor.size = allocation.space.size();
+        network.sharedBlockSent(descriptor.offset, descriptor.used);
+      } else {
+        descriptor.offset = INLINE_SEGMENT;
+        inlineContent.add(segments[i]);
+      }
+      descriptors.add(descriptor);
+    }
+
+    network.queueRecord(MESSAGE, descriptors.finish(), inlineContent.finish());
+  }
+
+private:
+  SharedMemoryVatNetwork& network;
+  uint nextSize;
+
+  struct Allocation {
+    kj::ArrayPtr<word> space;
+    bool shared;
+  };
+  kj::Vector<Allocation> allocations;
+  // In segment order.
+};
+
+class SharedMemoryVatNetwork::OutgoingMessageImpl final
+    : public OutgoingRpcMessage, public kj::Refcounted {
+public:
+  OutgoingMessageImpl(SharedMemoryVatNetwork& network, uint firstSegmentWordSize)
+      : message(network,
+            firstSegmentWordSize == 0 ? SUGGESTED_FIRST_SEGMENT_WORDS : firstSegmentWordSize) {}
+
+  AnyPointer::Builder getBody() override {
+    return message.getRoot<AnyPointer>();
+  }
+
+  kj::ArrayPtr<kj::Maybe<kj::Own<ClientHook>>> getCapTable() override {
+    return message.getCapTable();
+  }
+
+  void send() override {
+    message.send();
+  }
+
+  size_t sizeInWords() override {
+    size_t result = 0;
+    for (auto segment: message.getSegmentsForOutput()) {
+      result += segment.size();
+    }
+    return result;
+  }
+
+private:
+  SharedMessageBuilder message;
+};
+
+kj::Own<OutgoingRpcMessage> SharedMemoryVatNetwork::newOutgoingMessage(uint firstSegmentWordSize) {
+  return kj::refcounted<OutgoingMessageImpl>(*this, firstSegmentWordSize);
+}
+
+void SharedMemoryVatNetwork::queueRecord(
+    uint32_t type, kj::ArrayPtr<const SegmentDescriptor> descriptors,
+    kj::ArrayPtr<const kj::ArrayPtr<const word>> inlineContent) {
+  KJ_IF_MAYBE(exception, writeError) {
+    if (type == MESSAGE) {
+      kj::throwRecoverableException(kj::cp(*exception));
+    }
+    // A RELEASE has nobody left to tell.
+    return;
+  }
+
+  RecordHeader header;
+  header.type = type;
+  header.segmentCount = descriptors.size();
+
+  auto append = [this](const void* data, size_t size) {
+    auto bytes = reinterpret_cast<const kj::byte*>(data);
+    queuedRecords.addAll(bytes, bytes + size);
+  };
+  append(&header, sizeof(header));
+  append(descriptors.begin(), descriptors.size() * sizeof(SegmentDescriptor));
+  for (auto segment: inlineContent) {
+    append(segment.begin(), segment.size() * sizeof(word));
+  }
+
+  if (!flushScheduled) {
+    flushScheduled = true;
+    previousWrite = previousWrite.then([this]() {
+      // Yield first so that everything else sent during this turn makes it into the batch.
+      return kj::evalLater([this]() { return flushQueue(); });
+    }).eagerlyEvaluate([this](kj::Exception&& exception) {
+      // The disconnect itself is handled on the read end, which will fail as well.
+      writeFailed(kj::mv(exception));
+    });
+  }
+}
+
+void SharedMemoryVatNetwork::writeFailed(kj::Exception&& exception) {
+  // As in TwoPartyVatNetwork:  drop whatever was queued behind the failed write, and make later
+  // sends fail rather than pile up records that no flush will ever take.
+  flushScheduled = false;
+  queuedRecords.releaseAsArray();
+  if (writeError == nullptr) {
+    writeError = kj::mv(exception);
+  }
+}
+
+kj::Promise<void> SharedMemoryVatNetwork::flushQueue() {
+  if (writeError != nullptr) {
+    // An earlier write failed after this flush was scheduled, and dropped its records.
+    return kj::READY_NOW;
+  }
+
+  flushScheduled = false;
+
+  auto records = queuedRecords.releaseAsArray();
+
+  auto promise = stream.write(records.begin(), records.size());
+  return promise.attach(kj::mv(records)).eagerlyEvaluate(nullptr);
+}
+
+// =======================================================================================
+// Incoming messages
+
+class SharedMemoryVatNetwork::IncomingMessageImpl final: public IncomingRpcMessage {
+public:
+  IncomingMessageImpl(SharedMemoryVatNetwork& network,
+                      kj::Array<SegmentDescriptor> descriptors,
+                      kj::Array<kj::ArrayPtr<const word>> segments,
+                      kj::Array<word> inlineContent)
+      : network(network), descriptors(kj::mv(descriptors)), segments(kj::mv(segments)),
+        inlineContent(kj::mv(inlineContent)),
+        message(this->segments, network.receiveOptions) {}
+
+  ~IncomingMessageImpl() noexcept(false) {
+    // Hand the shared segments back to the sender.
+    unwindDetector.catchExceptionsIfUnwinding([&]() {
+      auto shared = kj::heapArrayBuilder<SegmentDescriptor>(descriptors.size());
+      for (auto& descriptor: descriptors) {
+        if (descriptor.offset != INLINE_SEGMENT) {
+          shared.add(descriptor);
+        }
+      }
+      if (shared.size() > 0) {
+        network.queueRecord(RELEASE, shared.finish());
+      }
+    });
+  }
+
+  AnyPointer::Reader getBody() override {
+    return message.getRoot<AnyPointer>();
+  }
+
+  void initCapTable(CapTable&& capTable) override {
+    message.initCapTable(kj::mv(capTable));
+  }
+
+private:
+  SharedMemoryVatNetwork& network;
+  kj::Array<SegmentDescriptor> descriptors;
+  kj::Array<kj::ArrayPtr<const word>> segments;
+  kj::Array<word> inlineContent;
+  SegmentArrayMessageReader message;
+  kj::UnwindDetector unwindDetector;
+};
+
+kj::Promise<kj::Maybe<kj::Own<IncomingRpcMessage>>>
+    SharedMemoryVatNetwork::receiveIncomingMessage() {
+  return kj::evalLater([this]() { return readRecord(); });
+}
+
+kj::Promise<kj::Maybe<kj::Own<IncomingRpcMessage>>> SharedMemoryVatNetwork::readRecord() {
+  auto header = kj::heap<RecordHeader>();
+  auto headerPtr = header.get();
+
+  return stream.tryRead(headerPtr, sizeof(RecordHeader), sizeof(RecordHeader))
+      .then(kj::mvCapture(header,
+          [this](kj::Own<RecordHeader>&& header, size_t n)
+          -> kj::Promise<kj::Maybe<kj::Own<IncomingRpcMessage>>> {
+    if (n == 0) {
+      return kj::Maybe<kj::Own<IncomingRpcMessage>>(nullptr);
+    }
+    KJ_REQUIRE(n == sizeof(RecordHeader), "Premature EOF.");
+    KJ_REQUIRE(header->type == MESSAGE || header->type == RELEASE, "Unknown record type.",
+               header->type);
+    KJ_REQUIRE(header->segmentCount > 0 && header->segmentCount < MAX_SEGMENTS,
+               "Bad segment count.", header->segmentCount);
+
+    uint32_t type = header->type;
+    auto descriptors = kj::heapArray<SegmentDescriptor>(header->segmentCount);
+    auto descriptorsPtr = descriptors.asPtr();
+    return stream.read(descriptorsPtr.begin(), descriptorsPtr.size() * sizeof(SegmentDescriptor))
+        .then(kj::mvCapture(descriptors,
+            [this,type](kj::Array<SegmentDescriptor>&& descriptors)
+            -> kj::Promise<kj::Maybe<kj::Own<IncomingRpcMessage>>> {
+      if (type == RELEASE) {
+        for (auto& descriptor: descriptors) {
+          sharedBlockReleased(descriptor);
+        }
+        return readRecord();
+      }
+
+      size_t inlineWords = 0;
+      for (auto& descriptor: descriptors) {
+        if (descriptor.offset == INLINE_SEGMENT) {
+          inlineWords += descriptor.used;
+        }
+      }
+      KJ_REQUIRE(inlineWords <= receiveOptions.traversalLimitInWords,
+                 "Message is too large.  To increase the limit on the receiving end, see "
+                 "capnp::ReaderOptions.");
+
+      auto inlineContent = kj::heapArray<word>(inlineWords);
+      auto inlinePtr = inlineContent.asPtr();
+      return stream.read(inlinePtr.begin(), inlinePtr.size() * sizeof(word))
+          .then(kj::mvCapture(inlineContent, kj::mvCapture(descriptors,
+              [this](kj::Array<SegmentDescriptor>&& descriptors, kj::Array<word>&& inlineContent)
+              -> kj::Maybe<kj::Own<IncomingRpcMessage>> {
+        size_t receiveStart = receiveSpace.begin() - region.begin();
+        size_t inlineOffset = 0;
+
+        auto segments = kj::heapArrayBuilder<kj::ArrayPtr<const word>>(descriptors.size());
+        for (auto& descriptor: descriptors) {
+          if (descriptor.offset == INLINE_SEGMENT) {
+            segments.add(inlineContent.slice(inlineOffset, inlineOffset + descriptor.used));
+            inlineOffset += descriptor.used;
+          } else {
+            KJ_REQUIRE(descriptor.offset >= receiveStart &&
+                       descriptor.size <= receiveSpace.size() &&
+                       descriptor.offset - receiveStart <= receiveSpace.size() - descriptor.size &&
+                       descriptor.used <= descriptor.size,
+                       "Peer sent a segment outside its half of the shared region.");
+            segments.add(region.slice(descriptor.offset, descriptor.offset + descriptor.used));
+          }
+        }
+
+        return kj::Own<IncomingRpcMessage>(kj::heap<IncomingMessageImpl>(
+            *this, kj::mv(descriptors), segments.finish(), kj::mv(inlineContent)));
+      })));
+    }));
+  }));
+}
+
+void SharedMemoryVatNetwork::introduceTo(TwoPartyVatNetworkBase::Connection& recipient,
+    rpc::twoparty::ThirdPartyCapId::Builder sendToRecipient,
+    rpc::twoparty::RecipientId::Builder sendToTarget) {
+  KJ_FAIL_REQUIRE("Three-party introductions should never occur on two-party network.");
+}
+
+TwoPartyVatNetworkBase::ConnectionAndProvisionId SharedMemoryVatNetwork::connectToIntroduced(
+    rpc::twoparty::ThirdPartyCapId::Reader capId) {
+  KJ_FAIL_REQUIRE("Three-party introductions should never occur on two-party network.");
+}
+
+kj::Own<TwoPartyVatNetworkBase::Connection> SharedMemoryVatNetwork::acceptIntroducedConnection(
+    rpc::twoparty::RecipientId::Reader recipientId) {
+  KJ_FAIL_REQUIRE("Three-party introductions should never occur on two-party network.");
+}
+
+}  // namespace capnp
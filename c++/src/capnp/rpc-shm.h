@@ -0,0 +1,184 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CAPNP_RPC_SHM_H_
+#define CAPNP_RPC_SHM_H_
+
+#include "rpc-twoparty.h"
+#include <kj/io.h>
+#include <map>
+
+namespace capnp {
+
+class SharedMemoryVatNetwork: public TwoPartyVatNetworkBase,
+                              private TwoPartyVatNetworkBase::Connection {
+  // A two-party `VatNetwork` for peers on the same host which avoids copying message content.
+  //
+  // Like `TwoPartyVatNetwork`, this runs over a byte stream (typically a Unix socket), but the
+  // stream carries only short records describing where each message's segments are.  The
+  // segments themselves are allocated directly in a shared memory region that both peers have
+  // mapped:  the sender builds its message in place and the receiver reads it in place.  When the
+  // receiver is done with a message, it sends a record back releasing the space for reuse.
+  //
+  // The region is split in half, one half for the messages each side sends.  If a side's half is
+  // full (because the peer is holding on to lots of messages), further segments are allocated on
+  // the heap and their content is sent over the stream instead, like `TwoPartyVatNetwork` does.
+  //
+  // The peers must trust each other:  a message lives in memory the sender can still write to, so
+  // a malicious sender could modify it while the receiver is reading it.  Segment locations are
+  // bounds-checked and messages are read with the usual `ReaderOptions` limits, but nothing more.
+  //
+  // Messages received from this network point into the shared region, so the network must
+  // outlive them, as well as the `RpcSystem` using it.
+
+public:
+  SharedMemoryVatNetwork(kj::AsyncIoStream& stream, int regionFd, rpc::twoparty::Side side,
+                         ReaderOptions receiveOptions = ReaderOptions());
+  // `regionFd` refers to a region created with `newRegion()` (by either side) and passed to the
+  // peer, e.g. by inheritance across fork() or over a Unix socket.  The constructor maps it; the
+  // caller keeps ownership of the descriptor and may close it once the constructor returns.
+  // Both peers must pass descriptors for the same region, and opposite `side`s.
+
+  ~SharedMemoryVatNetwork() noexcept(false);
+
+  static constexpr size_t DEFAULT_REGION_SIZE = 16 << 20;
+
+  static kj::AutoCloseFd newRegion(size_t size = DEFAULT_REGION_SIZE);
+  // Create a new anonymous shared memory region of `size` bytes, initially zero.
+
+  kj::Promise<void> onDisconnect() { return disconnectPromise.addBranch(); }
+  // Returns a promise that resolves when the peer disconnects.
+
+  // implements VatNetwork -----------------------------------------------------
+
+  kj::Maybe<kj::Own<TwoPartyVatNetworkBase::Connection>> connectToRefHost(
+      rpc::twoparty::SturdyRefHostId::Reader ref) override;
+  kj::Promise<kj::Own<TwoPartyVatNetworkBase::Connection>> acceptConnectionAsRefHost() override;
+
+private:
+  class SharedMessageBuilder;
+  class OutgoingMessageImpl;
+  class IncomingMessageImpl;
+  struct RecordHeader;
+  struct SegmentDescriptor;
+
+  kj::AsyncIoStream& stream;
+  rpc::twoparty::Side side;
+  ReaderOptions receiveOptions;
+  bool accepted = false;
+
+  kj::Array<word> region;
+  // The whole shared region, as mapped by us.  Unmapped when destroyed.
+
+  kj::ArrayPtr<word> sendSpace;
+  kj::ArrayPtr<word> receiveSpace;
+  // The halves of `region` in which we and the peer, respectively, allocate outgoing segments.
+
+  std::map<size_t, size_t> freeSpace;
+  // Free blocks in `sendSpace`, as (offset, size) in words from the start of `region`.  Adjacent
+  // blocks are always merged.  Free space is zeroed, as MessageBuilder requires.
+
+  struct SharedBlock {
+    size_t size;
+
+    size_t used = 0;
+    // How much of the block may have been written, and so must be zeroed when it is freed.
+
+    uint peerRefs = 0;
+    // MESSAGE records naming this block that the peer has not released yet.
+
+    bool builderAlive = true;
+    // The builder may keep reading its segments after sending them, e.g. to serve pipelined
+    // calls on a Return, so a block can't be reused until the builder is gone too.
+  };
+
+  std::map<size_t, SharedBlock> allocatedSpace;
+  // Blocks of `sendSpace` handed out by allocateShared(), keyed by offset.  A block goes back to
+  // `freeSpace` once its builder has been destroyed and the peer has released every message
+  // naming it.
+
+  kj::Vector<kj::byte> queuedRecords;
+  // Records written since the last batch was handed to the stream.
+
+  bool flushScheduled = false;
+  // Whether a flush of `queuedRecords` has been chained onto `previousWrite`.
+
+  kj::Maybe<kj::Exception> writeError;
+  // Set once a write fails.  Sending a message after that throws it.
+
+  kj::Promise<void> previousWrite;
+  // Resolves when the previous write completes.  This effectively serves as the write queue.
+
+  kj::Own<kj::PromiseFulfiller<kj::Own<TwoPartyVatNetworkBase::Connection>>> acceptFulfiller;
+  // Fulfiller for the promise returned by acceptConnectionAsRefHost() on the client side, or the
+  // second call on the server side.  Never fulfilled, because there is only one connection.
+
+  kj::ForkedPromise<void> disconnectPromise = nullptr;
+
+  class FulfillerDisposer: public kj::Disposer {
+    // Hack:  Like TwoPartyVatNetwork, we are both a VatNetwork and a VatNetwork::Connection, and
+    //   need to know when the RPC system drops its last reference to the Connection.
+
+  public:
+    mutable kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+    mutable uint refcount = 0;
+
+    void disposeImpl(void* pointer) const override;
+  };
+  FulfillerDisposer disconnectFulfiller;
+
+  kj::Own<TwoPartyVatNetworkBase::Connection> asConnection();
+
+  kj::Maybe<kj::ArrayPtr<word>> allocateShared(uint minimumSize, uint preferredSize);
+  void sharedBlockSent(size_t offset, size_t used);
+  void sharedBlockDropped(size_t offset, size_t used);
+  void sharedBlockReleased(const SegmentDescriptor& descriptor);
+  // Called when a block is named in a MESSAGE record, when its builder is destroyed, and when the
+  // peer releases it.  `used` is how much of the block may have been written.
+
+  void freeShared(size_t offset, size_t size, size_t used);
+  // `used` is how much of the block needs to be zeroed.
+
+  void queueRecord(uint32_t type, kj::ArrayPtr<const SegmentDescriptor> descriptors,
+                   kj::ArrayPtr<const kj::ArrayPtr<const word>> inlineContent = nullptr);
+  kj::Promise<void> flushQueue();
+  void writeFailed(kj::Exception&& exception);
+
+  kj::Promise<kj::Maybe<kj::Own<IncomingRpcMessage>>> readRecord();
+
+  // implements Connection -----------------------------------------------------
+
+  kj::Own<OutgoingRpcMessage> newOutgoingMessage(uint firstSegmentWordSize) override;
+  kj::Promise<kj::Maybe<kj::Own<IncomingRpcMessage>>> receiveIncomingMessage() override;
+  void introduceTo(TwoPartyVatNetworkBase::Connection& recipient,
+      rpc::twoparty::ThirdPartyCapId::Builder sendToRecipient,
+      rpc::twoparty::RecipientId::Builder sendToTarget) override;
+  ConnectionAndProvisionId connectToIntroduced(
+      rpc::twoparty::ThirdPartyCapId::Reader capId) override;
+  kj::Own<TwoPartyVatNetworkBase::Connection> acceptIntroducedConnection(
+      rpc::twoparty::RecipientId::Reader recipientId) override;
+};
+
+}  // namespace capnp
+
+#endif  // CAPNP_RPC_SHM_H_
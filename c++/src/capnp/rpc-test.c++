@@ -202,6 +202,7 @@ public:
 
   uint getSentCount() { return sent; }
   uint getReceivedCount() { return received; }
+  uint getMultiSegmentSentCount() { return multiSegmentSent; }
 
   typedef TestNetworkAdapterBase::Connection Connection;
 
@@ -239,7 +240,7 @@ public:
         return message.getRoot<AnyPointer>();
       }
 
-      void initCapTable(kj::Array<kj::Maybe<kj::Own<ClientHook>>>&& capTable) override {
+      void initCapTable(CapTable&& capTable) override {
         message.initCapTable(kj::mv(capTable));
       }
 
@@ -268,6 +269,9 @@ public:
         }
 
         ++connection.network.sent;
+        if (message.getSegmentsForOutput().size() > 1) {
+          ++connection.network.multiSegmentSent;
+        }
 
         // Uncomment to get a debug dump.
 //        kj::String msg = connection.network.network.dumper.dump(
@@ -389,6 +393,7 @@ private:
   TestNetwork& network;
   uint sent = 0;
   uint received = 0;
+  uint multiSegmentSent = 0;
 
   std::map<const TestNetworkAdapter*, kj::Own<ConnectionImpl>> connections;
   std::queue<kj::Own<kj::PromiseFulfiller<kj::Own<Connection>>>> fulfillerQueue;
@@ -565,6 +570,63 @@ TEST(Rpc, TailCall) {
   EXPECT_EQ(1, context.restorer.callCount);
 }
 
+class TestTailCalleeForwarder final: public test::TestTailCallee::Server {
+public:
+  TestTailCalleeForwarder(test::TestTailCallee::Client target, int& callCount)
+      : target(kj::mv(target)), callCount(callCount) {}
+
+  kj::Promise<void> foo(FooContext context) override {
+    ++callCount;
+
+    auto params = context.getParams();
+    auto tailRequest = target.fooRequest();
+    tailRequest.setI(params.getI());
+    tailRequest.setT(params.getT());
+    return context.tailCall(kj::mv(tailRequest));
+  }
+
+private:
+  test::TestTailCallee::Client target;
+  int& callCount;
+};
+
+TEST(Rpc, TailCallRedirected) {
+  // The callee is called back over the connection with its results redirected to the caller's
+  // vat, and itself tail-calls a local object, so the final response is adopted as-is.
+
+  TestContext context;
+
+  auto caller = context.connect(test::TestSturdyRefObjectId::Tag::TEST_TAIL_CALLER)
+      .castAs<test::TestTailCaller>();
+
+  int calleeCallCount = 0;
+  int forwarderCallCount = 0;
+
+  test::TestTailCallee::Client callee(kj::heap<TestTailCalleeForwarder>(
+      kj::heap<TestTailCalleeImpl>(calleeCallCount), forwarderCallCount));
+
+  auto request = caller.fooRequest();
+  request.setI(789);
+  request.setCallee(callee);
+
+  auto promise = request.send();
+
+  auto dependentCall0 = promise.getC().getCallSequenceRequest().send();
+
+  auto response = promise.wait(context.waitScope);
+  EXPECT_EQ(789, response.getI());
+  EXPECT_EQ("from TestTailCaller", response.getT());
+
+  auto dependentCall1 = response.getC().getCallSequenceRequest().send();
+
+  EXPECT_EQ(0, dependentCall0.wait(context.waitScope).getN());
+  EXPECT_EQ(1, dependentCall1.wait(context.waitScope).getN());
+
+  EXPECT_EQ(1, calleeCallCount);
+  EXPECT_EQ(1, forwarderCallCount);
+  EXPECT_EQ(1, context.restorer.callCount);
+}
+
 TEST(Rpc, Cancelation) {
   // Tests allowCancellation().
 
@@ -738,6 +800,98 @@ TEST(Rpc, Cancel) {
   EXPECT_TRUE(destroyed);
 }
 
+TEST(Rpc, FlowControl) {
+  TestContext context;
+  context.rpcClient.setFlowControlWindow(1);
+
+  auto client = context.connect(test::TestSturdyRefObjectId::Tag::TEST_MORE_STUFF)
+      .castAs<test::TestMoreStuff>();
+
+  // Nothing in flight yet.
+  client.whenWritable().wait(context.waitScope);
+  EXPECT_EQ(0u, context.rpcClient.getCallBytesInFlight());
+
+  bool writable = false;
+  kj::Promise<void> writablePromise = nullptr;
+
+  {
+    auto request = client.neverReturnRequest();
+    request.setCap(kj::heap<TestCapDestructor>(kj::newPromiseAndFulfiller<void>().fulfiller));
+    auto responsePromise = request.send();
+    EXPECT_GT(context.rpcClient.getCallBytesInFlight(), 0u);
+
+    // The call never returns, so the window stays full.
+    writablePromise = client.whenWritable().then([&]() { writable = true; })
+        .eagerlyEvaluate(nullptr);
+    for (uint i = 0; i < 10; i++) {
+      kj::evalLater([]() {}).wait(context.waitScope);
+    }
+    EXPECT_FALSE(writable);
+  }
+
+  // Canceling the call makes the server return, and that opens the window.
+  writablePromise.wait(context.waitScope);
+  EXPECT_TRUE(writable);
+  EXPECT_EQ(0u, context.rpcClient.getCallBytesInFlight());
+}
+
+TEST(Rpc, Observer) {
+  TestContext context;
+  RpcStatsObserver clientStats;
+  RpcStatsObserver serverStats;
+  context.rpcClient.setObserver(clientStats);
+  context.rpcServer.setObserver(serverStats);
+
+  auto client = context.connect(test::TestSturdyRefObjectId::Tag::TEST_INTERFACE)
+      .castAs<test::TestInterface>();
+
+  auto request1 = client.fooRequest();
+  request1.setI(123);
+  request1.setJ(true);
+  auto promise1 = request1.send();
+  EXPECT_EQ(1u, clientStats.getCallsInFlight(RpcObserver::Direction::OUTGOING));
+  EXPECT_EQ("foo", promise1.wait(context.waitScope).getX());
+
+  client.barRequest().send().then(
+      [](Response<test::TestInterface::BarResults>&& response) {
+        ADD_FAILURE() << "Expected bar() call to fail.";
+      }, [](kj::Exception&& e) {}).wait(context.waitScope);
+
+  EXPECT_EQ(1u, clientStats.getOpenConnections());
+  EXPECT_EQ(1u, serverStats.getOpenConnections());
+  EXPECT_EQ(0u, clientStats.getCallsInFlight(RpcObserver::Direction::OUTGOING));
+  EXPECT_EQ(0u, serverStats.getCallsInFlight(RpcObserver::Direction::INCOMING));
+
+  uint64_t interfaceId = typeId<test::TestInterface>();
+
+  KJ_IF_MAYBE(foo, clientStats.getMethodStats(
+      RpcObserver::Direction::OUTGOING, interfaceId, 0)) {
+    EXPECT_EQ(1u, foo->calls);
+    EXPECT_EQ(0u, foo->failures);
+  } else {
+    ADD_FAILURE() << "No stats for outgoing foo().";
+  }
+
+  KJ_IF_MAYBE(foo, serverStats.getMethodStats(
+      RpcObserver::Direction::INCOMING, interfaceId, 0)) {
+    EXPECT_EQ(1u, foo->calls);
+    EXPECT_EQ(0u, foo->failures);
+  } else {
+    ADD_FAILURE() << "No stats for incoming foo().";
+  }
+
+  KJ_IF_MAYBE(bar, serverStats.getMethodStats(
+      RpcObserver::Direction::INCOMING, interfaceId, 1)) {
+    EXPECT_EQ(1u, bar->calls);
+    EXPECT_EQ(1u, bar->failures);
+  } else {
+    ADD_FAILURE() << "No stats for incoming bar().";
+  }
+
+  EXPECT_TRUE(serverStats.getMethodStats(
+      RpcObserver::Direction::OUTGOING, interfaceId, 0) == nullptr);
+}
+
 TEST(Rpc, SendTwice) {
   TestContext context;
 
@@ -823,6 +977,51 @@ TEST(Rpc, Embargo) {
   EXPECT_EQ(5, call5.wait(context.waitScope).getN());
 }
 
+class BigFooImpl final: public test::TestInterface::Server {
+  // Returns results too big for the default first segment.
+
+protected:
+  kj::Promise<void> foo(FooContext context) override {
+    auto text = context.getResults().initX(12000);
+    memset(text.begin(), 'x', text.size());
+    return kj::READY_NOW;
+  }
+};
+
+class BigFooRestorer final: public SturdyRefRestorer<test::TestSturdyRefObjectId> {
+public:
+  Capability::Client restore(test::TestSturdyRefObjectId::Reader objectId) override {
+    return kj::heap<BigFooImpl>();
+  }
+};
+
+TEST(Rpc, AdaptiveFirstSegmentSize) {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+  TestNetwork network;
+  BigFooRestorer restorer;
+  TestNetworkAdapter& clientNetwork = network.add("client");
+  TestNetworkAdapter& serverNetwork = network.add("server");
+  auto rpcClient = makeRpcClient(clientNetwork);
+  auto rpcServer = makeRpcServer(serverNetwork, restorer);
+
+  MallocMessageBuilder refMessage(128);
+  auto ref = refMessage.initRoot<rpc::SturdyRef>();
+  auto hostId = ref.getHostId().initAs<test::TestSturdyRefHostId>();
+  hostId.setHost("server");
+  ref.getObjectId().initAs<test::TestSturdyRefObjectId>();
+  auto client = rpcClient.restore(hostId, ref.getObjectId()).castAs<test::TestInterface>();
+
+  for (uint i = 0; i < 4; i++) {
+    auto response = client.fooRequest().send().wait(waitScope);
+    EXPECT_EQ(12000u, response.getX().size());
+  }
+
+  // Only the first return had to guess at its size.  The rest were sized from it.
+  EXPECT_EQ(1u, serverNetwork.getMultiSegmentSentCount());
+  EXPECT_EQ(0u, clientNetwork.getMultiSegmentSentCount());
+}
+
 }  // namespace
 }  // namespace _ (private)
 }  // namespace capnp
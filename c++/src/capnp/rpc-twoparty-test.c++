@@ -58,11 +58,13 @@ private:
   int& callCount;
 };
 
-kj::AsyncIoProvider::PipeThread runServer(kj::AsyncIoProvider& ioProvider, int& callCount) {
+kj::AsyncIoProvider::PipeThread runServer(
+    kj::AsyncIoProvider& ioProvider, int& callCount,
+    TwoPartyVatNetwork::Encoding encoding = TwoPartyVatNetwork::Encoding::UNPACKED) {
   return ioProvider.newPipeThread(
-      [&callCount](kj::AsyncIoProvider& ioProvider, kj::AsyncIoStream& stream,
-                   kj::WaitScope& waitScope) {
-    TwoPartyVatNetwork network(stream, rpc::twoparty::Side::SERVER);
+      [&callCount,encoding](kj::AsyncIoProvider& ioProvider, kj::AsyncIoStream& stream,
+                            kj::WaitScope& waitScope) {
+    TwoPartyVatNetwork network(stream, rpc::twoparty::Side::SERVER, ReaderOptions(), encoding);
     TestRestorer restorer(callCount);
     auto server = makeRpcServer(network, restorer);
     network.onDisconnect().wait(waitScope);
@@ -92,6 +94,8 @@ TEST(TwoPartyNetwork, Basic) {
   auto serverThread = runServer(*ioContext.provider, callCount);
   TwoPartyVatNetwork network(*serverThread.pipe, rpc::twoparty::Side::CLIENT);
   auto rpcClient = makeRpcClient(network);
+  RpcStatsObserver stats;
+  network.setObserver(stats);
 
   // Request the particular capability from the server.
   auto client = getPersistentCap(rpcClient, rpc::twoparty::Side::SERVER,
@@ -118,6 +122,9 @@ TEST(TwoPartyNetwork, Basic) {
 
   EXPECT_EQ(0, callCount);
 
+  // Nothing has been written yet; the calls are batched until the event loop runs.
+  EXPECT_GT(network.getQueuedBytes(), 0u);
+
   auto response1 = promise1.wait(ioContext.waitScope);
 
   EXPECT_EQ("foo", response1.getX());
@@ -128,6 +135,39 @@ TEST(TwoPartyNetwork, Basic) {
 
   EXPECT_EQ(2, callCount);
   EXPECT_TRUE(barFailed);
+
+  // The Restore and three Calls went out, and a Return came back for each.
+  EXPECT_GE(stats.getMessagesSent(), 4u);
+  EXPECT_GE(stats.getMessagesReceived(), 4u);
+  EXPECT_GE(stats.getBytesSent(), stats.getMessagesSent() * sizeof(word));
+  EXPECT_GE(stats.getBytesReceived(), stats.getMessagesReceived() * sizeof(word));
+}
+
+TEST(TwoPartyNetwork, Packed) {
+  auto ioContext = kj::setupAsyncIo();
+  int callCount = 0;
+
+  auto serverThread = runServer(*ioContext.provider, callCount,
+                                TwoPartyVatNetwork::Encoding::PACKED);
+  TwoPartyVatNetwork network(*serverThread.pipe, rpc::twoparty::Side::CLIENT, ReaderOptions(),
+                             TwoPartyVatNetwork::Encoding::PACKED);
+  auto rpcClient = makeRpcClient(network);
+
+  auto client = getPersistentCap(rpcClient, rpc::twoparty::Side::SERVER,
+      test::TestSturdyRefObjectId::Tag::TEST_INTERFACE).castAs<test::TestInterface>();
+
+  auto request1 = client.fooRequest();
+  request1.setI(123);
+  request1.setJ(true);
+  auto promise1 = request1.send();
+
+  auto request2 = client.bazRequest();
+  initTestMessage(request2.initS());
+  auto promise2 = request2.send();
+
+  EXPECT_EQ("foo", promise1.wait(ioContext.waitScope).getX());
+  promise2.wait(ioContext.waitScope);
+  EXPECT_EQ(2, callCount);
 }
 
 TEST(TwoPartyNetwork, Pipelining) {
@@ -211,6 +251,255 @@ TEST(TwoPartyNetwork, Pipelining) {
   }
 }
 
+class HeldCallsImpl final: public test::TestInterface::Server {
+  // foo() doesn't return until release() is called.
+
+public:
+  kj::Promise<void> foo(FooContext context) override {
+    ++callCount;
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    fulfillers.add(kj::mv(paf.fulfiller));
+    return paf.promise.then([context]() mutable {
+      context.getResults().setX("foo");
+    });
+  }
+
+  void release() {
+    for (auto& fulfiller: fulfillers) {
+      fulfiller->fulfill();
+    }
+    fulfillers.resize(0);
+  }
+
+  uint callCount = 0;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> fulfillers;
+};
+
+class HeldCallsRestorer final: public SturdyRefRestorer<test::TestSturdyRefObjectId> {
+public:
+  HeldCallsRestorer(HeldCallsImpl& impl): impl(impl) {}
+
+  Capability::Client restore(test::TestSturdyRefObjectId::Reader objectId) override {
+    return kj::Own<HeldCallsImpl>(&impl, kj::NullDisposer::instance);
+  }
+
+private:
+  HeldCallsImpl& impl;
+};
+
+void runBriefly(kj::AsyncIoContext& ioContext) {
+  // Gives messages time to cross the pipe.
+  ioContext.provider->getTimer().afterDelay(20 * kj::MILLISECONDS).wait(ioContext.waitScope);
+}
+
+TEST(TwoPartyNetwork, IncomingCallLimit) {
+  auto ioContext = kj::setupAsyncIo();
+  auto pipe = ioContext.provider->newTwoWayPipe();
+
+  HeldCallsImpl impl;
+  HeldCallsRestorer restorer(impl);
+  TwoPartyVatNetwork serverNetwork(*pipe.ends[0], rpc::twoparty::Side::SERVER);
+  auto server = makeRpcServer(serverNetwork, restorer);
+  server.setIncomingCallLimit(3);
+
+  TwoPartyVatNetwork clientNetwork(*pipe.ends[1], rpc::twoparty::Side::CLIENT);
+  auto rpcClient = makeRpcClient(clientNetwork);
+  auto client = getPersistentCap(rpcClient, rpc::twoparty::Side::SERVER,
+      test::TestSturdyRefObjectId::Tag::TEST_INTERFACE).castAs<test::TestInterface>();
+
+  kj::Vector<kj::Promise<void>> promises;
+  uint returned = 0;
+  for (uint i = 0; i < 10; i++) {
+    promises.add(client.fooRequest().send()
+        .then([&](Response<test::TestInterface::FooResults>&&) { ++returned; })
+        .eagerlyEvaluate(nullptr));
+  }
+
+  runBriefly(ioContext);
+  EXPECT_EQ(3u, impl.callCount);
+  EXPECT_EQ(3u, server.getIncomingCallsInProgress());
+
+  while (returned < 10) {
+    impl.release();
+    runBriefly(ioContext);
+    EXPECT_LE(server.getIncomingCallsInProgress(), 3u);
+  }
+
+  EXPECT_EQ(10u, impl.callCount);
+  EXPECT_EQ(0u, server.getIncomingCallsInProgress());
+}
+
+TEST(TwoPartyNetwork, ReceiveLimit) {
+  auto ioContext = kj::setupAsyncIo();
+  auto pipe = ioContext.provider->newTwoWayPipe();
+
+  HeldCallsImpl impl;
+  HeldCallsRestorer restorer(impl);
+  TwoPartyVatNetwork serverNetwork(*pipe.ends[0], rpc::twoparty::Side::SERVER);
+  auto server = makeRpcServer(serverNetwork, restorer);
+
+  TwoPartyVatNetwork clientNetwork(*pipe.ends[1], rpc::twoparty::Side::CLIENT);
+  auto rpcClient = makeRpcClient(clientNetwork);
+  auto client = getPersistentCap(rpcClient, rpc::twoparty::Side::SERVER,
+      test::TestSturdyRefObjectId::Tag::TEST_INTERFACE).castAs<test::TestInterface>();
+
+  // Let the Restore through, then limit to about four calls' worth of messages.
+  client.whenResolved().wait(ioContext.waitScope);
+  EXPECT_EQ(0u, serverNetwork.getReceivedBytesHeld());
+
+  kj::Vector<kj::Promise<void>> promises;
+  uint returned = 0;
+  auto sendCall = [&]() {
+    auto request = client.fooRequest();
+    request.setI(123);
+    promises.add(request.send()
+        .then([&](Response<test::TestInterface::FooResults>&&) { ++returned; })
+        .eagerlyEvaluate(nullptr));
+  };
+
+  sendCall();
+  runBriefly(ioContext);
+  size_t callBytes = serverNetwork.getReceivedBytesHeld();
+  ASSERT_GT(callBytes, 0u);
+  serverNetwork.setReceiveLimit(callBytes * 4);
+
+  for (uint i = 1; i < 10; i++) {
+    sendCall();
+  }
+
+  runBriefly(ioContext);
+  EXPECT_EQ(4u, impl.callCount);
+  EXPECT_EQ(callBytes * 4, serverNetwork.getReceivedBytesHeld());
+  EXPECT_EQ(1u, serverNetwork.getReceivePauseCount());
+
+  while (returned < 10) {
+    impl.release();
+    runBriefly(ioContext);
+    EXPECT_LE(serverNetwork.getReceivedBytesHeld(), callBytes * 4);
+  }
+
+  EXPECT_EQ(10u, impl.callCount);
+  EXPECT_EQ(0u, serverNetwork.getReceivedBytesHeld());
+}
+
+class BreakingStream final: public kj::AsyncIoStream {
+  // Never delivers any data.  The first `writesBeforeFailure` writes succeed; later ones fail a
+  // turn after they start, as writes to a broken connection would.
+
+public:
+  uint writesBeforeFailure = 0;
+  uint writeCount = 0;
+
+  kj::Promise<size_t> read(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return kj::NEVER_DONE;
+  }
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return kj::NEVER_DONE;
+  }
+
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    return write(nullptr);
+  }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+    if (writeCount++ < writesBeforeFailure) {
+      return kj::READY_NOW;
+    }
+    return kj::evalLater([]() -> kj::Promise<void> {
+      KJ_FAIL_ASSERT("stream broke");
+    });
+  }
+
+  void shutdownWrite() override {}
+};
+
+void runTurns(kj::WaitScope& waitScope) {
+  for (uint i = 0; i < 5; i++) {
+    kj::evalLater([]() {}).wait(waitScope);
+  }
+}
+
+TEST(TwoPartyNetwork, WriteFailure) {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  BreakingStream stream;
+  stream.writesBeforeFailure = 1;
+  TwoPartyVatNetwork network(stream, rpc::twoparty::Side::CLIENT);
+
+  MallocMessageBuilder hostIdMessage(8);
+  auto hostId = hostIdMessage.initRoot<rpc::twoparty::SturdyRefHostId>();
+  hostId.setSide(rpc::twoparty::Side::SERVER);
+  kj::Own<TwoPartyVatNetworkBase::Connection> connection;
+  KJ_IF_MAYBE(c, network.connectToRefHost(hostId)) {
+    connection = kj::mv(*c);
+  } else {
+    KJ_FAIL_ASSERT("Expected a connection to the server.");
+  }
+
+  auto sendOne = [&]() {
+    auto message = connection->newOutgoingMessage(0);
+    message->getBody().setAs<Text>("foo");
+    message->send();
+  };
+
+  sendOne();
+  sendOne();
+  runTurns(waitScope);
+  EXPECT_EQ(1u, stream.writeCount);
+
+  // The second batch's write fails while another message is queued behind it.
+  sendOne();
+  sendOne();
+  kj::evalLater([]() {}).wait(waitScope);
+  kj::evalLater([]() {}).wait(waitScope);
+  EXPECT_EQ(2u, stream.writeCount);
+  sendOne();
+  runTurns(waitScope);
+
+  // Nothing more is written, and later sends report the failure instead of queuing forever.
+  EXPECT_EQ(2u, stream.writeCount);
+  EXPECT_EQ(0u, network.getQueuedBytes());
+  EXPECT_ANY_THROW(sendOne());
+  runTurns(waitScope);
+  EXPECT_EQ(2u, stream.writeCount);
+}
+
+TEST(TwoPartyNetwork, ReceivedSizeCountsEverySegment) {
+  // An empty segment in the middle of a message must not hide the segments after it from the
+  // byte accounting.
+  auto ioContext = kj::setupAsyncIo();
+  auto pipe = ioContext.provider->newTwoWayPipe();
+
+  TwoPartyVatNetwork network(*pipe.ends[0], rpc::twoparty::Side::SERVER);
+  RpcStatsObserver stats;
+  network.setObserver(stats);
+
+  MallocMessageBuilder hostIdMessage(8);
+  auto hostId = hostIdMessage.initRoot<rpc::twoparty::SturdyRefHostId>();
+  hostId.setSide(rpc::twoparty::Side::CLIENT);
+  kj::Own<TwoPartyVatNetworkBase::Connection> connection;
+  KJ_IF_MAYBE(c, network.connectToRefHost(hostId)) {
+    connection = kj::mv(*c);
+  } else {
+    KJ_FAIL_ASSERT("Expected a connection to the client.");
+  }
+
+  // Three segments of one, zero and one words, each holding a null pointer.
+  uint32_t table[4] = {2, 1, 0, 1};
+  word content[2];
+  memset(content, 0, sizeof(content));
+  kj::ArrayPtr<const byte> pieces[2] = {
+    kj::arrayPtr(reinterpret_cast<const byte*>(table), sizeof(table)),
+    kj::arrayPtr(reinterpret_cast<const byte*>(content), sizeof(content))
+  };
+  pipe.ends[1]->write(pieces).wait(ioContext.waitScope);
+
+  auto message = connection->receiveIncomingMessage().wait(ioContext.waitScope);
+  ASSERT_TRUE(message != nullptr);
+  EXPECT_EQ(sizeof(content), stats.getBytesReceived());
+  EXPECT_EQ(sizeof(content), network.getReceivedBytesHeld());
+}
+
 }  // namespace
 }  // namespace _
 }  // namespace capnp
@@ -27,14 +27,41 @@
 
 namespace capnp {
 
+namespace {
+
+kj::Own<kj::AsyncInputStream> wrapInput(kj::AsyncIoStream& stream,
+                                        TwoPartyVatNetwork::Encoding encoding) {
+  if (encoding == TwoPartyVatNetwork::Encoding::PACKED) {
+    return kj::heap<PackedAsyncInputStream>(stream);
+  } else {
+    return kj::Own<kj::AsyncInputStream>(&stream, kj::NullDisposer::instance);
+  }
+}
+
+kj::Own<kj::AsyncOutputStream> wrapOutput(kj::AsyncIoStream& stream,
+                                          TwoPartyVatNetwork::Encoding encoding) {
+  if (encoding == TwoPartyVatNetwork::Encoding::PACKED) {
+    return kj::heap<PackedAsyncOutputStream>(stream);
+  } else {
+    return kj::Own<kj::AsyncOutputStream>(&stream, kj::NullDisposer::instance);
+  }
+}
+
+}  // namespace
+
 TwoPartyVatNetwork::TwoPartyVatNetwork(kj::AsyncIoStream& stream, rpc::twoparty::Side side,
-                                       ReaderOptions receiveOptions)
-    : stream(stream), side(side), receiveOptions(receiveOptions), previousWrite(kj::READY_NOW) {
+                                       ReaderOptions receiveOptions, Encoding encoding)
+    : stream(stream), side(side), receiveOptions(receiveOptions),
+      input(wrapInput(stream, encoding)), output(wrapOutput(stream, encoding)),
+      messageInput(*input), receiveQuota(kj::refcounted<ReceiveQuota>()),
+      previousWrite(kj::READY_NOW) {
   auto paf = kj::newPromiseAndFulfiller<void>();
   disconnectPromise = paf.promise.fork();
   disconnectFulfiller.fulfiller = kj::mv(paf.fulfiller);
 }
 
+TwoPartyVatNetwork::~TwoPartyVatNetwork() noexcept(false) {}
+
 void TwoPartyVatNetwork::FulfillerDisposer::disposeImpl(void* pointer) const {
   if (--refcount == 0) {
     fulfiller->fulfill();
@@ -73,45 +100,168 @@ class TwoPartyVatNetwork::OutgoingMessageImpl final
 public:
   OutgoingMessageImpl(TwoPartyVatNetwork& network, uint firstSegmentWordSize)
       : network(network),
-        message(firstSegmentWordSize == 0 ? SUGGESTED_FIRST_SEGMENT_WORDS : firstSegmentWordSize) {}
+        message(network.builderPool.get(
+            firstSegmentWordSize == 0 ? SUGGESTED_FIRST_SEGMENT_WORDS : firstSegmentWordSize)) {}
 
   AnyPointer::Builder getBody() override {
-    return message.getRoot<AnyPointer>();
+    return message->getRoot<AnyPointer>();
   }
 
   kj::ArrayPtr<kj::Maybe<kj::Own<ClientHook>>> getCapTable() override {
-    return message.getCapTable();
+    return message->getCapTable();
   }
 
   void send() override {
-    network.previousWrite = network.previousWrite.then([&]() {
-      // Note that if the write fails, all further writes will be skipped due to the exception.
-      // We never actually handle this exception because we assume the read end will fail as well
-      // and it's cleaner to handle the failure there.
-      auto promise = writeMessage(network.stream, message).eagerlyEvaluate(nullptr);
-      return kj::mv(promise);
-    }).attach(kj::addRef(*this));
+    network.queueMessage(kj::addRef(*this));
+  }
+
+  size_t sizeInWords() override {
+    size_t result = 0;
+    for (auto segment: message->getSegmentsForOutput()) {
+      result += segment.size();
+    }
+    return result;
+  }
+
+  kj::ArrayPtr<const kj::ArrayPtr<const word>> getSegmentsForOutput() {
+    return message->getSegmentsForOutput();
   }
 
 private:
   TwoPartyVatNetwork& network;
-  MallocMessageBuilder message;
+  kj::Own<MallocMessageBuilder> message;
+};
+
+void TwoPartyVatNetwork::queueMessage(kj::Own<OutgoingMessageImpl> message) {
+  KJ_IF_MAYBE(exception, writeError) {
+    kj::throwRecoverableException(kj::cp(*exception));
+    return;
+  }
+
+  size_t bytes = message->sizeInWords() * sizeof(word);
+  queuedBytes += bytes;
+  KJ_IF_MAYBE(o, observer) {
+    o->messageSent(bytes);
+  }
+  queuedMessages.add(kj::mv(message));
+
+  if (!flushScheduled) {
+    flushScheduled = true;
+    previousWrite = previousWrite.then([this]() {
+      // Yield first so that everything else sent during this turn makes it into the batch.
+      return kj::evalLater([this]() { return flushQueue(); });
+    }).eagerlyEvaluate([this](kj::Exception&& exception) {
+      // The disconnect itself is handled on the read end, which will fail as well.
+      writeFailed(kj::mv(exception));
+    });
+  }
+}
+
+void TwoPartyVatNetwork::writeFailed(kj::Exception&& exception) {
+  // Nothing queued behind the failed write can be sent anymore.  Drop it, and make later sends
+  // fail rather than queue up messages that no flush will ever take.
+  flushScheduled = false;
+  queuedMessages.releaseAsArray();
+  queuedBytes = 0;
+  if (writeError == nullptr) {
+    writeError = kj::mv(exception);
+  }
+}
+
+kj::Promise<void> TwoPartyVatNetwork::flushQueue() {
+  if (writeError != nullptr) {
+    // An earlier write failed after this flush was scheduled, and dropped its messages.
+    return kj::READY_NOW;
+  }
+
+  flushScheduled = false;
+
+  auto messages = queuedMessages.releaseAsArray();
+
+  auto segments = kj::heapArrayBuilder<kj::ArrayPtr<const kj::ArrayPtr<const word>>>(
+      messages.size());
+  size_t bytes = 0;
+  for (auto& message: messages) {
+    segments.add(message->getSegmentsForOutput());
+    bytes += message->sizeInWords() * sizeof(word);
+  }
+  auto segmentsArray = segments.finish();
+
+  auto promise = writeMessages(*output, segmentsArray).then([this,bytes]() {
+    queuedBytes -= bytes;
+  });
+  return promise.attach(kj::mv(segmentsArray), kj::mv(messages)).eagerlyEvaluate(nullptr);
+}
+
+class TwoPartyVatNetwork::ReceiveQuota final: public kj::Refcounted {
+public:
+  size_t limit = kj::maxValue;
+  size_t bytesHeld = 0;
+  uint64_t pauseCount = 0;
+
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> waiter;
+  // The receive loop, if it is waiting for `bytesHeld` to drop below `limit`.
+
+  kj::Promise<void> whenBelowLimit() {
+    if (bytesHeld < limit) return kj::READY_NOW;
+
+    ++pauseCount;
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    waiter = kj::mv(paf.fulfiller);
+    return kj::mv(paf.promise);
+  }
+
+  void release(size_t bytes) {
+    bytesHeld -= bytes;
+    wakeIfBelowLimit();
+  }
+
+  void wakeIfBelowLimit() {
+    if (bytesHeld < limit) {
+      KJ_IF_MAYBE(w, waiter) {
+        w->get()->fulfill();
+        waiter = nullptr;
+      }
+    }
+  }
 };
 
+void TwoPartyVatNetwork::setReceiveLimit(size_t bytes) {
+  receiveQuota->limit = bytes;
+  receiveQuota->wakeIfBelowLimit();
+}
+
+size_t TwoPartyVatNetwork::getReceivedBytesHeld() {
+  return receiveQuota->bytesHeld;
+}
+
+uint64_t TwoPartyVatNetwork::getReceivePauseCount() {
+  return receiveQuota->pauseCount;
+}
+
 class TwoPartyVatNetwork::IncomingMessageImpl final: public IncomingRpcMessage {
 public:
-  IncomingMessageImpl(kj::Own<MessageReader> message): message(kj::mv(message)) {}
+  IncomingMessageImpl(kj::Own<MessageReader> message, kj::Own<ReceiveQuota> quota, size_t bytes)
+      : message(kj::mv(message)), quota(kj::mv(quota)), bytes(bytes) {
+    this->quota->bytesHeld += bytes;
+  }
+
+  ~IncomingMessageImpl() noexcept(false) {
+    quota->release(bytes);
+  }
 
   AnyPointer::Reader getBody() override {
     return message->getRoot<AnyPointer>();
   }
 
-  void initCapTable(kj::Array<kj::Maybe<kj::Own<ClientHook>>>&& capTable) override {
+  void initCapTable(CapTable&& capTable) override {
     message->initCapTable(kj::mv(capTable));
   }
 
 private:
   kj::Own<MessageReader> message;
+  kj::Own<ReceiveQuota> quota;
+  size_t bytes;
 };
 
 kj::Own<OutgoingRpcMessage> TwoPartyVatNetwork::newOutgoingMessage(uint firstSegmentWordSize) {
@@ -120,11 +270,23 @@ kj::Own<OutgoingRpcMessage> TwoPartyVatNetwork::newOutgoingMessage(uint firstSeg
 
 kj::Promise<kj::Maybe<kj::Own<IncomingRpcMessage>>> TwoPartyVatNetwork::receiveIncomingMessage() {
   return kj::evalLater([&]() {
-    return tryReadMessage(stream, receiveOptions)
+    // Don't read any further while we're holding too much already.
+    return receiveQuota->whenBelowLimit();
+  }).then([&]() {
+    return messageInput.tryReadMessage(receiveOptions)
         .then([&](kj::Maybe<kj::Own<MessageReader>>&& message)
               -> kj::Maybe<kj::Own<IncomingRpcMessage>> {
       KJ_IF_MAYBE(m, message) {
-        return kj::Own<IncomingRpcMessage>(kj::heap<IncomingMessageImpl>(kj::mv(*m)));
+        size_t words = 0;
+        MessageReader& reader = **m;
+        for (uint i = 0, count = reader.getSegmentCount(); i < count; i++) {
+          words += reader.getSegment(i).size();
+        }
+        KJ_IF_MAYBE(o, observer) {
+          o->messageReceived(words * sizeof(word));
+        }
+        return kj::Own<IncomingRpcMessage>(kj::heap<IncomingMessageImpl>(
+            kj::mv(*m), kj::addRef(*receiveQuota), words * sizeof(word)));
       } else {
         return nullptr;
       }
@@ -33,9 +33,11 @@ static const ::capnp::_::AlignedData<25> b_9fd69ebc87b9719c = {
      99, 108, 105, 101, 110, 116,   0,   0, }
 };
 static const uint16_t m_9fd69ebc87b9719c[] = {1, 0};
+static const uint16_t mh_9fd69ebc87b9719c[] = {1, 3, 5, 0, 65535, 1};
 const ::capnp::_::RawSchema s_9fd69ebc87b9719c = {
   0x9fd69ebc87b9719c, b_9fd69ebc87b9719c.words, 25, nullptr, m_9fd69ebc87b9719c,
-  0, 2, nullptr, nullptr, nullptr
+  0, 2, nullptr, nullptr, nullptr,
+  mh_9fd69ebc87b9719c, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<33> b_e615e371b1036508 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -77,9 +79,12 @@ static const ::capnp::_::RawSchema* const d_e615e371b1036508[] = {
 };
 static const uint16_t m_e615e371b1036508[] = {0};
 static const uint16_t i_e615e371b1036508[] = {0};
+static const uint16_t mh_e615e371b1036508[] = {1, 2, 0, 65535, 0};
+static const uint16_t dh_e615e371b1036508[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_e615e371b1036508 = {
   0xe615e371b1036508, b_e615e371b1036508.words, 33, d_e615e371b1036508, m_e615e371b1036508,
-  1, 1, i_e615e371b1036508, nullptr, nullptr
+  1, 1, i_e615e371b1036508, nullptr, nullptr,
+  mh_e615e371b1036508, dh_e615e371b1036508, nullptr
 };
 static const ::capnp::_::AlignedData<32> b_b88d09a9c5f39817 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -117,9 +122,11 @@ static const ::capnp::_::AlignedData<32> b_b88d09a9c5f39817 = {
 };
 static const uint16_t m_b88d09a9c5f39817[] = {0};
 static const uint16_t i_b88d09a9c5f39817[] = {0};
+static const uint16_t mh_b88d09a9c5f39817[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_b88d09a9c5f39817 = {
   0xb88d09a9c5f39817, b_b88d09a9c5f39817.words, 32, nullptr, m_b88d09a9c5f39817,
-  0, 1, i_b88d09a9c5f39817, nullptr, nullptr
+  0, 1, i_b88d09a9c5f39817, nullptr, nullptr,
+  mh_b88d09a9c5f39817, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<17> b_89f389b6fd4082c1 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -142,7 +149,8 @@ static const ::capnp::_::AlignedData<17> b_89f389b6fd4082c1 = {
 };
 const ::capnp::_::RawSchema s_89f389b6fd4082c1 = {
   0x89f389b6fd4082c1, b_89f389b6fd4082c1.words, 17, nullptr, nullptr,
-  0, 0, nullptr, nullptr, nullptr
+  0, 0, nullptr, nullptr, nullptr,
+  nullptr, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<18> b_b47f4979672cb59d = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -166,7 +174,8 @@ static const ::capnp::_::AlignedData<18> b_b47f4979672cb59d = {
 };
 const ::capnp::_::RawSchema s_b47f4979672cb59d = {
   0xb47f4979672cb59d, b_b47f4979672cb59d.words, 18, nullptr, nullptr,
-  0, 0, nullptr, nullptr, nullptr
+  0, 0, nullptr, nullptr, nullptr,
+  nullptr, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<61> b_95b29059097fca83 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -233,9 +242,11 @@ static const ::capnp::_::AlignedData<61> b_95b29059097fca83 = {
 };
 static const uint16_t m_95b29059097fca83[] = {0, 1, 2};
 static const uint16_t i_95b29059097fca83[] = {0, 1, 2};
+static const uint16_t mh_95b29059097fca83[] = {1, 4, 0, 65535, 1, 0, 2};
 const ::capnp::_::RawSchema s_95b29059097fca83 = {
   0x95b29059097fca83, b_95b29059097fca83.words, 61, nullptr, m_95b29059097fca83,
-  0, 3, i_95b29059097fca83, nullptr, nullptr
+  0, 3, i_95b29059097fca83, nullptr, nullptr,
+  mh_95b29059097fca83, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<61> b_9d263a3630b7ebee = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -302,9 +313,11 @@ static const ::capnp::_::AlignedData<61> b_9d263a3630b7ebee = {
 };
 static const uint16_t m_9d263a3630b7ebee[] = {2, 0, 1};
 static const uint16_t i_9d263a3630b7ebee[] = {0, 1, 2};
+static const uint16_t mh_9d263a3630b7ebee[] = {1, 4, 0, 65535, 1, 0, 2};
 const ::capnp::_::RawSchema s_9d263a3630b7ebee = {
   0x9d263a3630b7ebee, b_9d263a3630b7ebee.words, 61, nullptr, m_9d263a3630b7ebee,
-  0, 3, i_9d263a3630b7ebee, nullptr, nullptr
+  0, 3, i_9d263a3630b7ebee, nullptr, nullptr,
+  mh_9d263a3630b7ebee, nullptr, nullptr
 };
 }  // namespace schemas
 namespace _ {  // private
@@ -129,6 +129,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline  ::capnp::rpc::twoparty::Side getSide() const;
 
 private:
@@ -161,6 +163,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::capnp::rpc::twoparty::Side getSide();
   inline void setSide( ::capnp::rpc::twoparty::Side value);
 
@@ -201,6 +205,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline  ::uint32_t getJoinId() const;
 
 private:
@@ -233,6 +239,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getJoinId();
   inline void setJoinId( ::uint32_t value);
 
@@ -273,6 +281,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<0> presenceMask() const;
+
 private:
   ::capnp::_::StructReader _reader;
   template <typename T, ::capnp::Kind k>
@@ -303,6 +313,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
 private:
   ::capnp::_::StructBuilder _builder;
   template <typename T, ::capnp::Kind k>
@@ -340,6 +352,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<0> presenceMask() const;
+
 private:
   ::capnp::_::StructReader _reader;
   template <typename T, ::capnp::Kind k>
@@ -370,6 +384,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
 private:
   ::capnp::_::StructBuilder _builder;
   template <typename T, ::capnp::Kind k>
@@ -407,6 +423,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline  ::uint32_t getJoinId() const;
 
   inline  ::uint16_t getPartCount() const;
@@ -443,6 +461,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getJoinId();
   inline void setJoinId( ::uint32_t value);
 
@@ -489,6 +509,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline  ::uint32_t getJoinId() const;
 
   inline bool getSucceeded() const;
@@ -526,6 +548,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getJoinId();
   inline void setJoinId( ::uint32_t value);
 
@@ -564,6 +588,18 @@ private:
 
 // =======================================================================================
 
+inline ::capnp::FieldPresence<1> SturdyRefHostId::Reader::presenceMask() const {
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, _reader.hasDataField< ::uint16_t>(0 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void SturdyRefHostId::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<SturdyRefHostId>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
 inline  ::capnp::rpc::twoparty::Side SturdyRefHostId::Reader::getSide() const {
   return _reader.getDataField< ::capnp::rpc::twoparty::Side>(
       0 * ::capnp::ELEMENTS);
@@ -578,6 +614,18 @@ inline void SturdyRefHostId::Builder::setSide( ::capnp::rpc::twoparty::Side valu
       0 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<1> ProvisionId::Reader::presenceMask() const {
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void ProvisionId::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<ProvisionId>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
 inline  ::uint32_t ProvisionId::Reader::getJoinId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -592,6 +640,42 @@ inline void ProvisionId::Builder::setJoinId( ::uint32_t value) {
       0 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<0> RecipientId::Reader::presenceMask() const {
+  ::capnp::FieldPresence<0> _result;
+  return _result;
+}
+
+inline void RecipientId::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<RecipientId>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
+inline ::capnp::FieldPresence<0> ThirdPartyCapId::Reader::presenceMask() const {
+  ::capnp::FieldPresence<0> _result;
+  return _result;
+}
+
+inline void ThirdPartyCapId::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<ThirdPartyCapId>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
+inline ::capnp::FieldPresence<3> JoinKeyPart::Reader::presenceMask() const {
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, _reader.hasDataField< ::uint16_t>(2 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField< ::uint16_t>(3 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void JoinKeyPart::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<JoinKeyPart>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
 inline  ::uint32_t JoinKeyPart::Reader::getJoinId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -634,6 +718,24 @@ inline void JoinKeyPart::Builder::setPartNum( ::uint16_t value) {
       3 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<3> JoinResult::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, _reader.hasDataField<bool>(32 * ::capnp::ELEMENTS));
+  _result.set(2, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void JoinResult::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<JoinResult>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t JoinResult::Reader::getJoinId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
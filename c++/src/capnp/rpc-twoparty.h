@@ -26,7 +26,9 @@
 
 #include "rpc.h"
 #include "message.h"
+#include "serialize-async.h"
 #include <kj/async-io.h>
+#include <kj/vector.h>
 #include <capnp/rpc-twoparty.capnp.h>
 
 namespace capnp {
@@ -44,12 +46,45 @@ class TwoPartyVatNetwork: public TwoPartyVatNetworkBase,
   // Use `TwoPartyVatNetwork` only if you need the advanced features.
 
 public:
+  enum class Encoding {
+    UNPACKED,
+    // Messages are written in the standard serialization format (see serialize.h).
+
+    PACKED
+    // Messages are packed (see serialize-packed.h), trading some CPU time for a smaller encoding.
+    // Both ends of the stream must use the same encoding; the two-party protocol carries no
+    // handshake to negotiate it.
+  };
+
   TwoPartyVatNetwork(kj::AsyncIoStream& stream, rpc::twoparty::Side side,
-                     ReaderOptions receiveOptions = ReaderOptions());
+                     ReaderOptions receiveOptions = ReaderOptions(),
+                     Encoding encoding = Encoding::UNPACKED);
+  ~TwoPartyVatNetwork() noexcept(false);
 
   kj::Promise<void> onDisconnect() { return disconnectPromise.addBranch(); }
   // Returns a promise that resolves when the peer disconnects.
 
+  size_t getQueuedBytes() { return queuedBytes; }
+  // Bytes of outgoing messages that have been sent but not yet fully written to the stream.  A
+  // steadily growing value means the peer (or the link) is not keeping up.
+
+  void setReceiveLimit(size_t bytes);
+  // Stop reading from the stream while received messages totaling `bytes` or more are still held
+  // in memory, resuming as they are released.  The RPC system holds on to a received call until
+  // the call completes or calls `CallContext::releaseParams()`, so this bounds the memory a peer
+  // can tie up with queued or long-running calls.  By default there is no limit.  See also
+  // `RpcSystem::setIncomingCallLimit()`, whose warning about deadlock applies here too.
+
+  size_t getReceivedBytesHeld();
+  // Bytes of received messages not yet released.
+
+  uint64_t getReceivePauseCount();
+  // How many times reading has stopped because of the receive limit.
+
+  void setObserver(kj::Maybe<RpcObserver&> observer) { this->observer = observer; }
+  // Report the size of every message sent and received to `observer`, which must outlive this
+  // network.  Use together with RpcSystem::setObserver(); see rpc-observer.h.
+
   // implements VatNetwork -----------------------------------------------------
 
   kj::Maybe<kj::Own<TwoPartyVatNetworkBase::Connection>> connectToRefHost(
@@ -59,12 +94,45 @@ public:
 private:
   class OutgoingMessageImpl;
   class IncomingMessageImpl;
+  class ReceiveQuota;
 
   kj::AsyncIoStream& stream;
   rpc::twoparty::Side side;
   ReaderOptions receiveOptions;
   bool accepted = false;
 
+  kj::Own<kj::AsyncInputStream> input;
+  kj::Own<kj::AsyncOutputStream> output;
+  // Either `stream` itself or, when using packed encoding, wrappers around it.
+
+  BufferedMessageInput messageInput;
+  // Incoming messages are read through a buffer, typically several per read() call.
+
+  kj::Own<ReceiveQuota> receiveQuota;
+  // Accounts for received messages still held; see setReceiveLimit().  Refcounted because the
+  // messages may outlive the network.
+
+  MessageBuilderPool builderPool;
+  // Outgoing messages are built in recycled builders.  Declared before previousWrite so that it
+  // outlives messages still queued for writing.
+
+  kj::Vector<kj::Own<OutgoingMessageImpl>> queuedMessages;
+  // Messages sent since the last batch was handed to the stream.  Everything sent during one turn
+  // of the event loop (or while the previous write is still in progress) goes out in a single
+  // write.
+
+  bool flushScheduled = false;
+  // Whether a flush of `queuedMessages` has been chained onto `previousWrite`.
+
+  kj::Maybe<kj::Exception> writeError;
+  // Set once a write fails.  Sending after that throws it.
+
+  size_t queuedBytes = 0;
+  // See getQueuedBytes().
+
+  kj::Maybe<RpcObserver&> observer;
+  // See setObserver().
+
   kj::Promise<void> previousWrite;
   // Resolves when the previous write completes.  This effectively serves as the write queue.
 
@@ -91,6 +159,10 @@ private:
   kj::Own<TwoPartyVatNetworkBase::Connection> asConnection();
   // Returns a pointer to this with the disposer set to drainedFulfiller.
 
+  void queueMessage(kj::Own<OutgoingMessageImpl> message);
+  kj::Promise<void> flushQueue();
+  void writeFailed(kj::Exception&& exception);
+
   // implements Connection -----------------------------------------------------
 
   kj::Own<OutgoingRpcMessage> newOutgoingMessage(uint firstSegmentWordSize) override;
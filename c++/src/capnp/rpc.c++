@@ -28,7 +28,7 @@
 #include <kj/async.h>
 #include <kj/one-of.h>
 #include <kj/function.h>
-#include <unordered_map>
+#include <kj/hash.h>
 #include <map>
 #include <queue>
 #include <capnp/rpc.capnp.h>
@@ -128,8 +128,10 @@ kj::Exception toException(const rpc::Exception::Reader& exception) {
       break;
   }
 
+  // The local stack at this point says nothing about where the error happened.
   return kj::Exception(nature, durability, "(remote)", 0,
-                       kj::str("remote exception: ", exception.getReason()));
+                       kj::str("remote exception: ", exception.getReason()),
+                       kj::Exception::NoTrace());
 }
 
 void fromException(const kj::Exception& exception, rpc::Exception::Builder builder) {
@@ -224,12 +226,7 @@ public:
     if (id < kj::size(low)) {
       return low[id];
     } else {
-      auto iter = high.find(id);
-      if (iter == high.end()) {
-        return nullptr;
-      } else {
-        return iter->second;
-      }
+      return high.find(id);
     }
   }
 
@@ -240,10 +237,10 @@ public:
       T toRelease = kj::mv(low[id]);
       low[id] = T();
       return toRelease;
+    } else KJ_IF_MAYBE(toRelease, high.erase(id)) {
+      return kj::mv(*toRelease);
     } else {
-      T toRelease = kj::mv(high[id]);
-      high.erase(id);
-      return toRelease;
+      return T();
     }
   }
 
@@ -252,14 +249,12 @@ public:
     for (Id i: kj::indices(low)) {
       func(i, low[i]);
     }
-    for (auto& entry: high) {
-      func(entry.first, entry.second);
-    }
+    high.forEach(func);
   }
 
 private:
   T low[16];
-  std::unordered_map<Id, T> high;
+  kj::HashMap<Id, T> high;
 };
 
 // =======================================================================================
@@ -313,6 +308,41 @@ public:
     disconnect(kj::mv(exception));
   }
 
+  void setFlowControlWindow(size_t bytes) {
+    flowControlWindow = bytes;
+    if (callBytesInFlight < flowControlWindow) {
+      wakeFlowControlWaiters();
+    }
+  }
+
+  size_t getCallBytesInFlight() { return callBytesInFlight; }
+
+  void setIncomingCallLimit(uint calls) {
+    incomingCallLimit = calls;
+    wakeMessageLoopIfBelowLimit();
+  }
+
+  uint getIncomingCallsInProgress() { return incomingCallsInProgress; }
+
+  void setObserver(kj::Maybe<RpcObserver&> observer) {
+    this->observer = observer;
+  }
+
+  kj::Promise<void> whenWindowOpen() {
+    // Resolves once the bytes of outstanding calls on this connection fall below the flow control
+    // window.
+
+    if (!connection.is<Connected>()) {
+      return kj::cp(connection.get<Disconnected>());
+    }
+    if (callBytesInFlight < flowControlWindow) {
+      return kj::READY_NOW;
+    }
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    flowControlWaiters.add(kj::mv(paf.fulfiller));
+    return kj::mv(paf.promise);
+  }
+
   void disconnect(kj::Exception&& exception) {
     if (!connection.is<Connected>()) {
       // Already disconnected.
@@ -337,6 +367,7 @@ public:
           // QuestionRef still present.
           questionRef->reject(kj::cp(networkException));
         }
+        reportQuestionFinished(question, RpcObserver::Outcome::FAILED);
       });
 
       answers.forEach([&](AnswerId id, Answer& answer) {
@@ -368,8 +399,17 @@ public:
       embargoes.forEach([&](EmbargoId id, Embargo& embargo) {
         KJ_IF_MAYBE(f, embargo.fulfiller) {
           f->get()->reject(kj::cp(networkException));
+          KJ_IF_MAYBE(o, observer) {
+            o->embargoReleased();
+          }
         }
       });
+
+      auto waiters = kj::mv(flowControlWaiters);
+      for (auto& waiter: waiters) {
+        waiter->reject(kj::cp(networkException));
+      }
+      callBytesInFlight = 0;
     })) {
       // Some destructor must have thrown an exception.  There is no appropriate place to report
       // these errors.
@@ -388,6 +428,10 @@ public:
     // Indicate disconnect.
     disconnectFulfiller->fulfill();
     connection.init<Disconnected>(kj::mv(networkException));
+
+    KJ_IF_MAYBE(o, observer) {
+      o->connectionClosed();
+    }
   }
 
 private:
@@ -409,6 +453,10 @@ private:
   typedef uint32_t ExportId;
   typedef ExportId ImportId;
   // See equivalent definitions in rpc.capnp.
+
+  typedef kj::SmallVector<ExportId, 1> ExportList;
+  // Exports sent in one message's cap table.  Like the cap table itself, this is usually empty or
+  // has one entry.
   //
   // We always use the type that refers to the local table of the same name.  So e.g. although
   // QuestionId and AnswerId are the same type, we use QuestionId when referring to an entry in
@@ -418,8 +466,23 @@ private:
   // means that any time we read an ID from a received message, its type should invert.
   // TODO(cleanup):  Perhaps we could enforce that in a type-safe way?  Hmm...
 
+  struct MethodKey {
+    uint64_t interfaceId;
+    uint16_t methodId;
+
+    inline bool operator==(const MethodKey& other) const {
+      return interfaceId == other.interfaceId && methodId == other.methodId;
+    }
+  };
+
+  struct MethodKeyHasher {
+    inline uint operator()(const MethodKey& key) const {
+      return kj::DefaultHasher<uint64_t>()(key.interfaceId + key.methodId);
+    }
+  };
+
   struct Question {
-    kj::Array<ExportId> paramExports;
+    ExportList paramExports;
     // List of exports that were sent in the request.  If the response has `releaseParamCaps` these
     // will need to be released.
 
@@ -433,6 +496,16 @@ private:
     bool isTailCall = false;
     // Is this a tail call?  If so, we don't expect to receive results in the `Return`.
 
+    size_t callBytes = 0;
+    // Size of the `Call` message, counted against the flow control window until `Return` is
+    // received.
+
+    bool isObserved = false;
+    MethodKey method = MethodKey { 0, 0 };
+    uint64_t observerToken = 0;
+    // Set if the observer was told that this call started, so that it can be told when it
+    // finishes.
+
     inline bool operator==(decltype(nullptr)) const {
       return !isAwaitingReturn && selfRef == nullptr;
     }
@@ -461,7 +534,7 @@ private:
     // The call context, if it's still active.  Becomes null when the `Return` message is sent.
     // This object, if non-null, is owned by `asyncOp`.
 
-    kj::Array<ExportId> resultExports;
+    ExportList resultExports;
     // List of exports that were sent in the results.  If the finish has `releaseResultCaps` these
     // will need to be released.
   };
@@ -511,6 +584,16 @@ private:
     inline bool operator!=(decltype(nullptr)) const { return fulfiller != nullptr; }
   };
 
+  enum SizedMessage {
+    CALL_MESSAGE,
+    RETURN_MESSAGE
+  };
+
+  struct MessageSizeEstimate {
+    uint words[2] = {0, 0};
+    // Indexed by SizedMessage.  Zero if no such message has been seen yet.
+  };
+
   // =======================================================================================
   // OK, now we can define RpcConnectionState's member data.
 
@@ -531,13 +614,34 @@ private:
   // The Four Tables!
   // The order of the tables is important for correct destruction.
 
-  std::unordered_map<ClientHook*, ExportId> exportsByCap;
+  kj::HashMap<ClientHook*, ExportId> exportsByCap;
   // Maps already-exported ClientHook objects to their ID in the export table.
 
   ExportTable<EmbargoId, Embargo> embargoes;
   // There are only four tables.  This definitely isn't a fifth table.  I don't know what you're
   // talking about.
 
+  kj::HashMap<MethodKey, MessageSizeEstimate, MethodKeyHasher> messageSizeEstimates;
+  // Recently-observed sizes of `Call` and `Return` messages for each method.  When the
+  // application doesn't provide a size hint, we size the first segment from here instead of
+  // using the network's default, so that methods whose messages reliably outgrow the default
+  // still get single-segment messages in the steady state.
+
+  size_t flowControlWindow = kj::maxValue;
+  size_t callBytesInFlight = 0;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> flowControlWaiters;
+  // Bytes of calls sent and not yet returned, and the callers waiting in `whenWritable()` for
+  // that to drop below the window.
+
+  uint incomingCallLimit = kj::maxValue;
+  uint incomingCallsInProgress = 0;
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> messageLoopWaiter;
+  // Calls received and not yet finished, and the message loop, if it has stopped reading until
+  // that drops below the limit.
+
+  kj::Maybe<RpcObserver&> observer;
+  // See RpcSystem::setObserver().
+
   kj::TaskSet tasks;
 
   // =====================================================================================
@@ -581,7 +685,7 @@ private:
 
       auto request = kj::heap<RpcRequest>(
           *connectionState, *connectionState->connection.get<Connected>(),
-          sizeHint, kj::addRef(*this));
+          MethodKey { interfaceId, methodId }, sizeHint, kj::addRef(*this));
       auto callBuilder = request->getCall();
 
       callBuilder.setInterfaceId(interfaceId);
@@ -614,6 +718,10 @@ private:
       return connectionState.get();
     }
 
+    kj::Promise<void> whenWritable() override {
+      return connectionState->whenWindowOpen();
+    }
+
   protected:
     kj::Own<RpcConnectionState> connectionState;
   };
@@ -821,6 +929,12 @@ private:
       return fork.addBranch();
     }
 
+    kj::Promise<void> whenWritable() override {
+      // Once resolved, calls go wherever `cap` sends them, which may be a different connection or
+      // no connection at all.
+      return cap->whenWritable();
+    }
+
   private:
     bool isResolved;
     kj::Own<ClientHook> cap;
@@ -860,6 +974,9 @@ private:
 
         auto paf = kj::newPromiseAndFulfiller<void>();
         embargo.fulfiller = kj::mv(paf.fulfiller);
+        KJ_IF_MAYBE(o, connectionState->observer) {
+          o->embargoStarted();
+        }
 
         // Make a promise which resolves to `replacement` as soon as the `Disembargo` comes back.
         auto embargoPromise = paf.promise.then(
@@ -880,6 +997,62 @@ private:
     }
   };
 
+  uint chooseFirstSegmentSize(kj::Maybe<MessageSize> sizeHint, uint additional,
+                              MethodKey method, SizedMessage type) {
+    // Like firstSegmentSize(), but when there is no hint, falls back to the observed size of
+    // earlier messages of the same type for the same method.
+
+    if (sizeHint != nullptr) {
+      return firstSegmentSize(sizeHint, additional);
+    }
+
+    KJ_IF_MAYBE(estimate, messageSizeEstimates.find(method)) {
+      uint words = estimate->words[type];
+      // Leave some slack so that messages slightly bigger than the estimate still fit.
+      return words + words / 8;
+    } else {
+      return 0;
+    }
+  }
+
+  void releaseCallBytes(size_t bytes) {
+    callBytesInFlight -= kj::min(bytes, callBytesInFlight);
+    if (callBytesInFlight < flowControlWindow) {
+      wakeFlowControlWaiters();
+    }
+  }
+
+  void reportQuestionFinished(Question& question, RpcObserver::Outcome outcome) {
+    if (question.isObserved) {
+      question.isObserved = false;
+      KJ_IF_MAYBE(o, observer) {
+        o->callFinished(RpcObserver::Direction::OUTGOING, question.method.interfaceId,
+                        question.method.methodId, question.observerToken, outcome);
+      }
+    }
+  }
+
+  void wakeFlowControlWaiters() {
+    auto waiters = kj::mv(flowControlWaiters);
+    for (auto& waiter: waiters) {
+      waiter->fulfill();
+    }
+  }
+
+  void observeMessageSize(MethodKey method, SizedMessage type, size_t words) {
+    // Update the estimate used by chooseFirstSegmentSize().  Growth takes effect immediately so
+    // that a method with big messages stops spilling into extra segments right away, while a
+    // single unusually large message decays away over later calls.
+
+    uint observed = kj::min(MAX_SIZE_HINT, words);
+    uint& estimate = messageSizeEstimates[method].words[type];
+    if (observed >= estimate) {
+      estimate = observed;
+    } else {
+      estimate -= (estimate - observed) / 8;
+    }
+  }
+
   kj::Maybe<ExportId> writeDescriptor(ClientHook& cap, rpc::CapDescriptor::Builder descriptor) {
     // Write a descriptor for the given capability.
 
@@ -896,13 +1069,12 @@ private:
     if (inner->getBrand() == this) {
       return kj::downcast<RpcClient>(*inner).writeDescriptor(descriptor);
     } else {
-      auto iter = exportsByCap.find(inner);
-      if (iter != exportsByCap.end()) {
+      KJ_IF_MAYBE(existingId, exportsByCap.find(inner)) {
         // We've already seen and exported this capability before.  Just up the refcount.
-        auto& exp = KJ_ASSERT_NONNULL(exports.find(iter->second));
+        auto& exp = KJ_ASSERT_NONNULL(exports.find(*existingId));
         ++exp.refcount;
-        descriptor.setSenderHosted(iter->second);
-        return iter->second;
+        descriptor.setSenderHosted(*existingId);
+        return *existingId;
       } else {
         // This is the first time we've seen this capability.
         ExportId exportId;
@@ -924,10 +1096,10 @@ private:
     }
   }
 
-  kj::Array<ExportId> writeDescriptors(kj::ArrayPtr<kj::Maybe<kj::Own<ClientHook>>> capTable,
-                                       rpc::Payload::Builder payload) {
+  ExportList writeDescriptors(kj::ArrayPtr<kj::Maybe<kj::Own<ClientHook>>> capTable,
+                              rpc::Payload::Builder payload) {
     auto capTableBuilder = payload.initCapTable(capTable.size());
-    kj::Vector<ExportId> exports(capTable.size());
+    ExportList exports;
     for (uint i: kj::indices(capTable)) {
       KJ_IF_MAYBE(cap, capTable[i]) {
         KJ_IF_MAYBE(exportId, writeDescriptor(**cap, capTableBuilder[i])) {
@@ -937,7 +1109,7 @@ private:
         capTableBuilder[i].setNone();
       }
     }
-    return exports.releaseAsArray();
+    return exports;
   }
 
   kj::Maybe<kj::Own<ClientHook>> writeTarget(ClientHook& cap, rpc::MessageTarget::Builder target) {
@@ -1014,9 +1186,7 @@ private:
           // be able to just reuse the existing export table entry to represent the new promise --
           // unless it already has an entry.  Let's check.
 
-          auto insertResult = exportsByCap.insert(std::make_pair(exp.clientHook.get(), exportId));
-
-          if (insertResult.second) {
+          if (exportsByCap.insert(exp.clientHook.get(), kj::cp(exportId))) {
             // The new promise was not already in the table, therefore the existing export table
             // entry has now been repurposed to represent it.  There is no need to send a resolve
             // message at all.  We do, however, have to start resolving the next promise.
@@ -1138,12 +1308,12 @@ private:
     }
   }
 
-  kj::Array<kj::Maybe<kj::Own<ClientHook>>> receiveCaps(List<rpc::CapDescriptor>::Reader capTable) {
-    auto result = kj::heapArrayBuilder<kj::Maybe<kj::Own<ClientHook>>>(capTable.size());
+  CapTable receiveCaps(List<rpc::CapDescriptor>::Reader capTable) {
+    CapTable result;
     for (auto cap: capTable) {
       result.add(receiveCap(cap));
     }
-    return result.finish();
+    return result;
   }
 
   // =====================================================================================
@@ -1210,12 +1380,14 @@ private:
   class RpcRequest final: public RequestHook {
   public:
     RpcRequest(RpcConnectionState& connectionState, VatNetworkBase::Connection& connection,
-               kj::Maybe<MessageSize> sizeHint, kj::Own<RpcClient>&& target)
+               MethodKey method, kj::Maybe<MessageSize> sizeHint, kj::Own<RpcClient>&& target)
         : connectionState(kj::addRef(connectionState)),
           target(kj::mv(target)),
+          method(method),
           message(connection.newOutgoingMessage(
-              firstSegmentSize(sizeHint, messageSizeHint<rpc::Call>() +
-                  sizeInWords<rpc::Payload>() + MESSAGE_TARGET_SIZE_HINT))),
+              connectionState.chooseFirstSegmentSize(sizeHint, messageSizeHint<rpc::Call>() +
+                  sizeInWords<rpc::Payload>() + MESSAGE_TARGET_SIZE_HINT,
+                  method, CALL_MESSAGE))),
           callBuilder(message->getBody().getAs<rpc::Message>().initCall()),
           paramsBuilder(callBuilder.getParams().getContent()) {}
 
@@ -1311,6 +1483,7 @@ private:
     kj::Own<RpcConnectionState> connectionState;
 
     kj::Own<RpcClient> target;
+    MethodKey method;
     kj::Own<OutgoingRpcMessage> message;
     rpc::Call::Builder callBuilder;
     AnyPointer::Builder paramsBuilder;
@@ -1331,13 +1504,23 @@ private:
       question.isAwaitingReturn = true;
       question.paramExports = kj::mv(exports);
       question.isTailCall = isTailCall;
+      KJ_IF_MAYBE(o, connectionState->observer) {
+        question.isObserved = true;
+        question.method = method;
+        question.observerToken = o->callStarted(
+            RpcObserver::Direction::OUTGOING, method.interfaceId, method.methodId);
+      }
 
       // Finish and send.
       callBuilder.setQuestionId(questionId);
       if (isTailCall) {
         callBuilder.getSendResultsTo().setYourself();
       }
+      size_t words = message->sizeInWords();
+      question.callBytes = words * sizeof(word);
+      connectionState->callBytesInFlight += question.callBytes;
       message->send();
+      connectionState->observeMessageSize(method, CALL_MESSAGE, words);
 
       // Make the result promise.
       SendInternalResult result;
@@ -1486,10 +1669,11 @@ private:
 
   class RpcServerResponseImpl final: public RpcServerResponse {
   public:
-    RpcServerResponseImpl(RpcConnectionState& connectionState,
+    RpcServerResponseImpl(RpcConnectionState& connectionState, MethodKey method,
                           kj::Own<OutgoingRpcMessage>&& message,
                           rpc::Payload::Builder payload)
         : connectionState(connectionState),
+          method(method),
           message(kj::mv(message)),
           payload(payload) {}
 
@@ -1497,7 +1681,7 @@ private:
       return payload.getContent();
     }
 
-    kj::Maybe<kj::Array<ExportId>> send() {
+    kj::Maybe<ExportList> send() {
       // Send the response and return the export list.  Returns nullptr if there were no caps.
       // (Could return a non-null empty array if there were caps but none of them were exports.)
 
@@ -1506,6 +1690,7 @@ private:
       auto exports = connectionState.writeDescriptors(capTable, payload);
 
       message->send();
+      connectionState.observeMessageSize(method, RETURN_MESSAGE, message->sizeInWords());
       if (capTable.size() == 0) {
         return nullptr;
       } else {
@@ -1515,6 +1700,7 @@ private:
 
   private:
     RpcConnectionState& connectionState;
+    MethodKey method;
     kj::Own<OutgoingRpcMessage> message;
     rpc::Payload::Builder payload;
   };
@@ -1526,12 +1712,21 @@ private:
         : message(sizeHint.map([](MessageSize size) { return size.wordCount; })
                           .orDefault(SUGGESTED_FIRST_SEGMENT_WORDS)) {}
 
+    explicit LocallyRedirectedRpcResponse(Response<AnyPointer>&& tailResponse)
+        : tailResponse(kj::mv(tailResponse)) {}
+    // Holds the response to a tail call as-is, rather than copying it into `message`.
+
     AnyPointer::Builder getResultsBuilder() override {
+      KJ_REQUIRE(tailResponse == nullptr, "Can't modify the results of a tail call.");
       return message.getRoot<AnyPointer>();
     }
 
     AnyPointer::Reader getResults() override {
-      return message.getRoot<AnyPointer>();
+      KJ_IF_MAYBE(t, tailResponse) {
+        return *t;
+      } else {
+        return message.getRoot<AnyPointer>();
+      }
     }
 
     kj::Own<RpcResponse> addRef() override {
@@ -1540,20 +1735,29 @@ private:
 
   private:
     MallocMessageBuilder message;
+    kj::Maybe<Response<AnyPointer>> tailResponse;
   };
 
   class RpcCallContext final: public CallContextHook, public kj::Refcounted {
   public:
-    RpcCallContext(RpcConnectionState& connectionState, AnswerId answerId,
+    RpcCallContext(RpcConnectionState& connectionState, AnswerId answerId, MethodKey method,
                    kj::Own<IncomingRpcMessage>&& request, const AnyPointer::Reader& params,
                    bool redirectResults, kj::Own<kj::PromiseFulfiller<void>>&& cancelFulfiller)
         : connectionState(kj::addRef(connectionState)),
           answerId(answerId),
+          method(method),
           request(kj::mv(request)),
           params(params),
           returnMessage(nullptr),
           redirectResults(redirectResults),
-          cancelFulfiller(kj::mv(cancelFulfiller)) {}
+          cancelFulfiller(kj::mv(cancelFulfiller)) {
+      ++connectionState.incomingCallsInProgress;
+      KJ_IF_MAYBE(o, connectionState.observer) {
+        isObserved = true;
+        observerToken = o->callStarted(
+            RpcObserver::Direction::INCOMING, method.interfaceId, method.methodId);
+      }
+    }
 
     ~RpcCallContext() noexcept(false) {
       if (isFirstResponder()) {
@@ -1579,9 +1783,17 @@ private:
             message->send();
           }
 
-          cleanupAnswerTable(nullptr, true);
+          reportFinished(redirectResults ? RpcObserver::Outcome::RETURNED
+                                         : RpcObserver::Outcome::CANCELED);
+          cleanupAnswerTable(ExportList(), true);
         });
       }
+
+      if (inProgress) {
+        // Can only happen if the connection was lost before we could send a return.
+        inProgress = false;
+        connectionState->incomingCallFinished();
+      }
     }
 
     kj::Own<RpcResponse> consumeRedirectedResponse() {
@@ -1611,12 +1823,13 @@ private:
         returnMessage.setReleaseParamCaps(false);
 
         auto exports = kj::downcast<RpcServerResponseImpl>(*KJ_ASSERT_NONNULL(response)).send();
+        reportFinished(RpcObserver::Outcome::RETURNED);
         KJ_IF_MAYBE(e, exports) {
           // Caps were returned, so we can't free the pipeline yet.
           cleanupAnswerTable(kj::mv(*e), false);
         } else {
           // No caps in the results, therefore the pipeline is irrelevant.
-          cleanupAnswerTable(nullptr, true);
+          cleanupAnswerTable(ExportList(), true);
         }
       }
     }
@@ -1635,9 +1848,11 @@ private:
           message->send();
         }
 
+        reportFinished(RpcObserver::Outcome::FAILED);
+
         // Do not allow releasing the pipeline because we want pipelined calls to propagate the
         // exception rather than fail with a "no such field" exception.
-        cleanupAnswerTable(nullptr, false);
+        cleanupAnswerTable(ExportList(), false);
       }
     }
 
@@ -1677,11 +1892,11 @@ private:
           response = kj::refcounted<LocallyRedirectedRpcResponse>(sizeHint);
         } else {
           auto message = connectionState->connection.get<Connected>()->newOutgoingMessage(
-              firstSegmentSize(sizeHint, messageSizeHint<rpc::Return>() +
-                               sizeInWords<rpc::Payload>()));
+              connectionState->chooseFirstSegmentSize(sizeHint, messageSizeHint<rpc::Return>() +
+                  sizeInWords<rpc::Payload>(), method, RETURN_MESSAGE));
           returnMessage = message->getBody().initAs<rpc::Message>().initReturn();
           response = kj::heap<RpcServerResponseImpl>(
-              *connectionState, kj::mv(message), returnMessage.getResults());
+              *connectionState, method, kj::mv(message), returnMessage.getResults());
         }
 
         auto results = response->getResultsBuilder();
@@ -1720,7 +1935,8 @@ private:
 
             // There are no caps in our return message, but of course the tail results could have
             // caps, so we must continue to honor pipeline calls (and just bounce them back).
-            cleanupAnswerTable(nullptr, false);
+            reportFinished(RpcObserver::Outcome::RETURNED);
+            cleanupAnswerTable(ExportList(), false);
           }
           return { kj::mv(tailInfo->promise), kj::mv(tailInfo->pipeline) };
         }
@@ -1731,10 +1947,18 @@ private:
 
       // Wait for response.
       auto voidPromise = promise.then([this](Response<AnyPointer>&& tailResponse) {
-        // Copy the response.
-        // TODO(perf):  It would be nice if we could somehow make the response get built in-place
-        //   but requires some refactoring.
-        getResults(tailResponse.targetSize()).set(tailResponse);
+        if (redirectResults || !connectionState->connection.is<Connected>()) {
+          // The results stay in this vat, so there's no need to copy them anywhere:  the tail
+          // call's response can serve as ours directly.
+          kj::Own<RpcServerResponse> redirected =
+              kj::refcounted<LocallyRedirectedRpcResponse>(kj::mv(tailResponse));
+          response = kj::mv(redirected);
+        } else {
+          // Copy the response into our Return message.
+          // TODO(perf):  It would be nice if we could somehow make the response get built in-place
+          //   but requires some refactoring.
+          getResults(tailResponse.targetSize()).set(tailResponse);
+        }
       });
 
       return { kj::mv(voidPromise), PipelineHook::from(kj::mv(promise)) };
@@ -1761,6 +1985,7 @@ private:
   private:
     kj::Own<RpcConnectionState> connectionState;
     AnswerId answerId;
+    MethodKey method;
 
     // Request ---------------------------------------------
 
@@ -1792,8 +2017,34 @@ private:
 
     kj::UnwindDetector unwindDetector;
 
+    // Observation -----------------------------------------
+
+    bool isObserved = false;
+    uint64_t observerToken = 0;
+
+    bool inProgress = true;
+    // Whether this call still counts against the connection's incoming call limit.
+
     // -----------------------------------------------------
 
+    void reportFinished(RpcObserver::Outcome outcome) {
+      // Called once the call has returned (or been canceled), to tell the observer and to release
+      // the call's slot under the incoming call limit.
+
+      if (inProgress) {
+        inProgress = false;
+        connectionState->incomingCallFinished();
+      }
+
+      if (isObserved) {
+        isObserved = false;
+        KJ_IF_MAYBE(o, connectionState->observer) {
+          o->callFinished(RpcObserver::Direction::INCOMING, method.interfaceId, method.methodId,
+                          observerToken, outcome);
+        }
+      }
+    }
+
     bool isFirstResponder() {
       if (responseSent) {
         return false;
@@ -1803,7 +2054,7 @@ private:
       }
     }
 
-    void cleanupAnswerTable(kj::Array<ExportId> resultExports, bool shouldFreePipeline) {
+    void cleanupAnswerTable(ExportList resultExports, bool shouldFreePipeline) {
       // We need to remove the `callContext` pointer -- which points back to us -- from the
       // answer table.  Or we might even be responsible for removing the entire answer table
       // entry.
@@ -1837,6 +2088,13 @@ private:
       return kj::READY_NOW;
     }
 
+    if (incomingCallsInProgress >= incomingCallLimit) {
+      // Leave further messages in the connection until some calls finish.
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      messageLoopWaiter = kj::mv(paf.fulfiller);
+      return paf.promise.then([this]() { return messageLoop(); });
+    }
+
     return connection.get<Connected>()->receiveIncomingMessage().then(
         [this](kj::Maybe<kj::Own<IncomingRpcMessage>>&& message) {
       KJ_IF_MAYBE(m, message) {
@@ -1845,7 +2103,7 @@ private:
       } else {
         disconnect(kj::Exception(
             kj::Exception::Nature::PRECONDITION, kj::Exception::Durability::PERMANENT,
-            __FILE__, __LINE__, kj::str("Peer disconnected.")));
+            __FILE__, __LINE__, kj::str("Peer disconnected."), kj::Exception::NoTrace()));
         return false;
       }
     }).then([this](bool keepGoing) {
@@ -1857,6 +2115,20 @@ private:
     });
   }
 
+  void incomingCallFinished() {
+    --incomingCallsInProgress;
+    wakeMessageLoopIfBelowLimit();
+  }
+
+  void wakeMessageLoopIfBelowLimit() {
+    if (incomingCallsInProgress < incomingCallLimit) {
+      KJ_IF_MAYBE(waiter, messageLoopWaiter) {
+        waiter->get()->fulfill();
+        messageLoopWaiter = nullptr;
+      }
+    }
+  }
+
   void handleMessage(kj::Own<IncomingRpcMessage> message) {
     auto reader = message->getBody().getAs<rpc::Message>();
 
@@ -1976,7 +2248,8 @@ private:
     AnswerId answerId = call.getQuestionId();
 
     auto context = kj::refcounted<RpcCallContext>(
-        *this, answerId, kj::mv(message), payload.getContent(),
+        *this, answerId, MethodKey { call.getInterfaceId(), call.getMethodId() },
+        kj::mv(message), payload.getContent(),
         redirectResults, kj::mv(cancelPaf.fulfiller));
 
     // No more using `call` after this point, as it now belongs to the context.
@@ -2089,18 +2362,23 @@ private:
   void handleReturn(kj::Own<IncomingRpcMessage>&& message, const rpc::Return::Reader& ret) {
     // Transitive destructors can end up manipulating the question table and invalidating our
     // pointer into it, so make sure these destructors run later.
-    kj::Array<ExportId> exportsToRelease;
+    ExportList exportsToRelease;
     KJ_DEFER(releaseExports(exportsToRelease));
     kj::Maybe<kj::Promise<kj::Own<RpcResponse>>> promiseToRelease;
 
     KJ_IF_MAYBE(question, questions.find(ret.getAnswerId())) {
       KJ_REQUIRE(question->isAwaitingReturn, "Duplicate Return.") { return; }
       question->isAwaitingReturn = false;
+      releaseCallBytes(question->callBytes);
+      question->callBytes = 0;
+      reportQuestionFinished(*question,
+          question->selfRef == nullptr ? RpcObserver::Outcome::CANCELED :
+          ret.isException() ? RpcObserver::Outcome::FAILED : RpcObserver::Outcome::RETURNED);
 
       if (ret.getReleaseParamCaps()) {
         exportsToRelease = kj::mv(question->paramExports);
       } else {
-        question->paramExports = nullptr;
+        question->paramExports.clear();
       }
 
       KJ_IF_MAYBE(questionRef, question->selfRef) {
@@ -2179,7 +2457,7 @@ private:
   void handleFinish(const rpc::Finish::Reader& finish) {
     // Delay release of these things until return so that transitive destructors don't accidentally
     // modify the answer table and invalidate our pointer into it.
-    kj::Array<ExportId> exportsToRelease;
+    ExportList exportsToRelease;
     KJ_DEFER(releaseExports(exportsToRelease));
     Answer answerToRelease;
     kj::Maybe<kj::Own<PipelineHook>> pipelineToRelease;
@@ -2190,7 +2468,7 @@ private:
       if (finish.getReleaseResultCaps()) {
         exportsToRelease = kj::mv(answer->resultExports);
       } else {
-        answer->resultExports = nullptr;
+        answer->resultExports.clear();
       }
 
       pipelineToRelease = kj::mv(answer->pipeline);
@@ -2341,6 +2619,9 @@ private:
         KJ_IF_MAYBE(embargo, embargoes.find(context.getReceiverLoopback())) {
           KJ_ASSERT_NONNULL(embargo->fulfiller)->fulfill();
           embargoes.erase(context.getReceiverLoopback(), *embargo);
+          KJ_IF_MAYBE(o, observer) {
+            o->embargoReleased();
+          }
         } else {
           KJ_FAIL_REQUIRE("Invalid embargo ID in 'Disembargo.context.receiverLoopback'.") {
             return;
@@ -2393,7 +2674,7 @@ private:
     ret.setAnswerId(answerId);
 
     kj::Own<ClientHook> capHook;
-    kj::Array<ExportId> resultExports;
+    ExportList resultExports;
     KJ_DEFER(releaseExports(resultExports));  // in case something goes wrong
 
     // Call the restorer and initialize the answer.
@@ -2442,17 +2723,17 @@ public:
 
   ~Impl() noexcept(false) {
     unwindDetector.catchExceptionsIfUnwinding([&]() {
-      // std::unordered_map doesn't like it when elements' destructors throw, so carefully
+      // Elements' destructors could throw or come back and modify the map, so carefully
       // disassemble it.
       if (!connections.empty()) {
         kj::Vector<kj::Own<RpcConnectionState>> deleteMe(connections.size());
         kj::Exception shutdownException(
             kj::Exception::Nature::LOCAL_BUG, kj::Exception::Durability::PERMANENT,
             __FILE__, __LINE__, kj::str("RpcSystem was destroyed."));
-        for (auto& entry: connections) {
-          entry.second->disconnect(kj::cp(shutdownException));
-          deleteMe.add(kj::mv(entry.second));
-        }
+        connections.forEach([&](VatNetworkBase::Connection*, kj::Own<RpcConnectionState>& state) {
+          state->disconnect(kj::cp(shutdownException));
+          deleteMe.add(kj::mv(state));
+        });
       }
     });
   }
@@ -2469,6 +2750,43 @@ public:
     }
   }
 
+  void setFlowControlWindow(size_t bytes) {
+    flowControlWindow = bytes;
+    connections.forEach([&](VatNetworkBase::Connection*, kj::Own<RpcConnectionState>& state) {
+      state->setFlowControlWindow(bytes);
+    });
+  }
+
+  size_t getCallBytesInFlight() {
+    size_t total = 0;
+    connections.forEach([&](VatNetworkBase::Connection*, kj::Own<RpcConnectionState>& state) {
+      total += state->getCallBytesInFlight();
+    });
+    return total;
+  }
+
+  void setIncomingCallLimit(uint calls) {
+    incomingCallLimit = calls;
+    connections.forEach([&](VatNetworkBase::Connection*, kj::Own<RpcConnectionState>& state) {
+      state->setIncomingCallLimit(calls);
+    });
+  }
+
+  uint getIncomingCallsInProgress() {
+    uint total = 0;
+    connections.forEach([&](VatNetworkBase::Connection*, kj::Own<RpcConnectionState>& state) {
+      total += state->getIncomingCallsInProgress();
+    });
+    return total;
+  }
+
+  void setObserver(kj::Maybe<RpcObserver&> observer) {
+    this->observer = observer;
+    connections.forEach([&](VatNetworkBase::Connection*, kj::Own<RpcConnectionState>& state) {
+      state->setObserver(observer);
+    });
+  }
+
   void taskFailed(kj::Exception&& exception) override {
     KJ_LOG(ERROR, exception);
   }
@@ -2476,17 +2794,20 @@ public:
 private:
   VatNetworkBase& network;
   kj::Maybe<SturdyRefRestorerBase&> restorer;
+  size_t flowControlWindow = kj::maxValue;
+  uint incomingCallLimit = kj::maxValue;
+  kj::Maybe<RpcObserver&> observer;
   kj::TaskSet tasks;
 
-  typedef std::unordered_map<VatNetworkBase::Connection*, kj::Own<RpcConnectionState>>
-      ConnectionMap;
+  typedef kj::HashMap<VatNetworkBase::Connection*, kj::Own<RpcConnectionState>> ConnectionMap;
   ConnectionMap connections;
 
   kj::UnwindDetector unwindDetector;
 
   RpcConnectionState& getConnectionState(kj::Own<VatNetworkBase::Connection>&& connection) {
-    auto iter = connections.find(connection);
-    if (iter == connections.end()) {
+    KJ_IF_MAYBE(state, connections.find(connection)) {
+      return **state;
+    } else {
       VatNetworkBase::Connection* connectionPtr = connection;
       auto onDisconnect = kj::newPromiseAndFulfiller<void>();
       tasks.add(onDisconnect.promise.then([this,connectionPtr]() {
@@ -2494,11 +2815,15 @@ private:
       }));
       auto newState = kj::refcounted<RpcConnectionState>(
           restorer, kj::mv(connection), kj::mv(onDisconnect.fulfiller));
+      newState->setFlowControlWindow(flowControlWindow);
+      newState->setIncomingCallLimit(incomingCallLimit);
+      newState->setObserver(observer);
+      KJ_IF_MAYBE(o, observer) {
+        o->connectionOpened();
+      }
       RpcConnectionState& result = *newState;
-      connections.insert(std::make_pair(connectionPtr, kj::mv(newState)));
+      connections.insert(connectionPtr, kj::mv(newState));
       return result;
-    } else {
-      return *iter->second;
     }
   }
 
@@ -2527,5 +2852,31 @@ Capability::Client RpcSystemBase::baseRestore(
   return impl->restore(hostId, objectId);
 }
 
+void RpcSystemBase::baseSetFlowControlWindow(size_t bytes) {
+  impl->setFlowControlWindow(bytes);
+}
+
+size_t RpcSystemBase::baseGetCallBytesInFlight() {
+  return impl->getCallBytesInFlight();
+}
+
+void RpcSystemBase::baseSetIncomingCallLimit(uint calls) {
+  impl->setIncomingCallLimit(calls);
+}
+
+uint RpcSystemBase::baseGetIncomingCallsInProgress() {
+  return impl->getIncomingCallsInProgress();
+}
+
+void RpcSystemBase::baseSetObserver(kj::Maybe<RpcObserver&> observer) {
+  impl->setObserver(observer);
+}
+
 }  // namespace _ (private)
+
+size_t OutgoingRpcMessage::sizeInWords() {
+  // +1 for the root pointer.
+  return getBody().targetSize().wordCount + 1;
+}
+
 }  // namespace capnp
@@ -239,9 +239,12 @@ static const ::capnp::_::RawSchema* const d_91b79f1f808db032[] = {
 };
 static const uint16_t m_91b79f1f808db032[] = {1, 11, 2, 9, 13, 4, 12, 10, 6, 5, 8, 3, 7, 0};
 static const uint16_t i_91b79f1f808db032[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+static const uint16_t mh_91b79f1f808db032[] = {4, 18, 1, 8, 19, 1, 7, 65535, 13, 0, 9, 1, 5, 65535, 6, 11, 65535, 65535, 2, 10, 12, 4, 3, 8};
+static const uint16_t dh_91b79f1f808db032[] = {4, 18, 2, 17, 2, 19, 12, 8, 0, 65535, 65535, 5, 2, 7, 1, 13, 11, 10, 65535, 3, 65535, 9, 6, 4};
 const ::capnp::_::RawSchema s_91b79f1f808db032 = {
   0x91b79f1f808db032, b_91b79f1f808db032.words, 214, d_91b79f1f808db032, m_91b79f1f808db032,
-  14, 14, i_91b79f1f808db032, nullptr, nullptr
+  14, 14, i_91b79f1f808db032, nullptr, nullptr,
+  mh_91b79f1f808db032, dh_91b79f1f808db032, nullptr
 };
 static const ::capnp::_::AlignedData<114> b_836a53ce789d4cd4 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -366,9 +369,12 @@ static const ::capnp::_::RawSchema* const d_836a53ce789d4cd4[] = {
 };
 static const uint16_t m_836a53ce789d4cd4[] = {6, 2, 3, 4, 0, 5, 1};
 static const uint16_t i_836a53ce789d4cd4[] = {0, 1, 2, 3, 4, 5, 6};
+static const uint16_t mh_836a53ce789d4cd4[] = {2, 9, 3, 5, 1, 3, 4, 5, 6, 65535, 65535, 2, 0};
+static const uint16_t dh_836a53ce789d4cd4[] = {1, 4, 1, 2, 0, 65535, 1};
 const ::capnp::_::RawSchema s_836a53ce789d4cd4 = {
   0x836a53ce789d4cd4, b_836a53ce789d4cd4.words, 114, d_836a53ce789d4cd4, m_836a53ce789d4cd4,
-  3, 7, i_836a53ce789d4cd4, nullptr, nullptr
+  3, 7, i_836a53ce789d4cd4, nullptr, nullptr,
+  mh_836a53ce789d4cd4, dh_836a53ce789d4cd4, nullptr
 };
 static const ::capnp::_::AlignedData<61> b_dae8b0f61aab5f99 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -438,9 +444,12 @@ static const ::capnp::_::RawSchema* const d_dae8b0f61aab5f99[] = {
 };
 static const uint16_t m_dae8b0f61aab5f99[] = {0, 2, 1};
 static const uint16_t i_dae8b0f61aab5f99[] = {0, 1, 2};
+static const uint16_t mh_dae8b0f61aab5f99[] = {1, 4, 2, 0, 2, 1, 65535};
+static const uint16_t dh_dae8b0f61aab5f99[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_dae8b0f61aab5f99 = {
   0xdae8b0f61aab5f99, b_dae8b0f61aab5f99.words, 61, d_dae8b0f61aab5f99, m_dae8b0f61aab5f99,
-  1, 3, i_dae8b0f61aab5f99, nullptr, nullptr
+  1, 3, i_dae8b0f61aab5f99, nullptr, nullptr,
+  mh_dae8b0f61aab5f99, dh_dae8b0f61aab5f99, nullptr
 };
 static const ::capnp::_::AlignedData<139> b_9e19b28d3db3573a = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -589,9 +598,12 @@ static const ::capnp::_::RawSchema* const d_9e19b28d3db3573a[] = {
 };
 static const uint16_t m_9e19b28d3db3573a[] = {7, 0, 4, 3, 1, 2, 5, 6};
 static const uint16_t i_9e19b28d3db3573a[] = {2, 3, 4, 5, 6, 7, 0, 1};
+static const uint16_t mh_9e19b28d3db3573a[] = {3, 11, 1, 3, 0, 3, 65535, 2, 5, 7, 6, 1, 65535, 65535, 0, 4};
+static const uint16_t dh_9e19b28d3db3573a[] = {1, 3, 0, 0, 65535, 1};
 const ::capnp::_::RawSchema s_9e19b28d3db3573a = {
   0x9e19b28d3db3573a, b_9e19b28d3db3573a.words, 139, d_9e19b28d3db3573a, m_9e19b28d3db3573a,
-  2, 8, i_9e19b28d3db3573a, nullptr, nullptr
+  2, 8, i_9e19b28d3db3573a, nullptr, nullptr,
+  mh_9e19b28d3db3573a, dh_9e19b28d3db3573a, nullptr
 };
 static const ::capnp::_::AlignedData<47> b_d37d2eb2c2f80e63 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -644,9 +656,11 @@ static const ::capnp::_::AlignedData<47> b_d37d2eb2c2f80e63 = {
 };
 static const uint16_t m_d37d2eb2c2f80e63[] = {0, 1};
 static const uint16_t i_d37d2eb2c2f80e63[] = {0, 1};
+static const uint16_t mh_d37d2eb2c2f80e63[] = {1, 3, 2, 0, 65535, 1};
 const ::capnp::_::RawSchema s_d37d2eb2c2f80e63 = {
   0xd37d2eb2c2f80e63, b_d37d2eb2c2f80e63.words, 47, nullptr, m_d37d2eb2c2f80e63,
-  0, 2, i_d37d2eb2c2f80e63, nullptr, nullptr
+  0, 2, i_d37d2eb2c2f80e63, nullptr, nullptr,
+  mh_d37d2eb2c2f80e63, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<60> b_bbc29655fa89086e = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -716,9 +730,12 @@ static const ::capnp::_::RawSchema* const d_bbc29655fa89086e[] = {
 };
 static const uint16_t m_bbc29655fa89086e[] = {1, 2, 0};
 static const uint16_t i_bbc29655fa89086e[] = {1, 2, 0};
+static const uint16_t mh_bbc29655fa89086e[] = {1, 4, 1, 0, 1, 2, 65535};
+static const uint16_t dh_bbc29655fa89086e[] = {1, 3, 0, 0, 65535, 1};
 const ::capnp::_::RawSchema s_bbc29655fa89086e = {
   0xbbc29655fa89086e, b_bbc29655fa89086e.words, 60, d_bbc29655fa89086e, m_bbc29655fa89086e,
-  2, 3, i_bbc29655fa89086e, nullptr, nullptr
+  2, 3, i_bbc29655fa89086e, nullptr, nullptr,
+  mh_bbc29655fa89086e, dh_bbc29655fa89086e, nullptr
 };
 static const ::capnp::_::AlignedData<45> b_ad1a6c0d7dd07497 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -769,9 +786,11 @@ static const ::capnp::_::AlignedData<45> b_ad1a6c0d7dd07497 = {
 };
 static const uint16_t m_ad1a6c0d7dd07497[] = {0, 1};
 static const uint16_t i_ad1a6c0d7dd07497[] = {0, 1};
+static const uint16_t mh_ad1a6c0d7dd07497[] = {1, 3, 1, 1, 0, 65535};
 const ::capnp::_::RawSchema s_ad1a6c0d7dd07497 = {
   0xad1a6c0d7dd07497, b_ad1a6c0d7dd07497.words, 45, nullptr, m_ad1a6c0d7dd07497,
-  0, 2, i_ad1a6c0d7dd07497, nullptr, nullptr
+  0, 2, i_ad1a6c0d7dd07497, nullptr, nullptr,
+  mh_ad1a6c0d7dd07497, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<39> b_f964368b0fbd3711 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -820,9 +839,12 @@ static const ::capnp::_::RawSchema* const d_f964368b0fbd3711[] = {
 };
 static const uint16_t m_f964368b0fbd3711[] = {1, 0};
 static const uint16_t i_f964368b0fbd3711[] = {0, 1};
+static const uint16_t mh_f964368b0fbd3711[] = {1, 3, 0, 1, 65535, 0};
+static const uint16_t dh_f964368b0fbd3711[] = {1, 3, 0, 65535, 1, 0};
 const ::capnp::_::RawSchema s_f964368b0fbd3711 = {
   0xf964368b0fbd3711, b_f964368b0fbd3711.words, 39, d_f964368b0fbd3711, m_f964368b0fbd3711,
-  2, 2, i_f964368b0fbd3711, nullptr, nullptr
+  2, 2, i_f964368b0fbd3711, nullptr, nullptr,
+  mh_f964368b0fbd3711, dh_f964368b0fbd3711, nullptr
 };
 static const ::capnp::_::AlignedData<76> b_d562b4df655bdd4d = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -907,9 +929,12 @@ static const ::capnp::_::RawSchema* const d_d562b4df655bdd4d[] = {
 };
 static const uint16_t m_d562b4df655bdd4d[] = {2, 3, 1, 0};
 static const uint16_t i_d562b4df655bdd4d[] = {0, 1, 2, 3};
+static const uint16_t mh_d562b4df655bdd4d[] = {2, 6, 3, 4, 3, 1, 2, 65535, 65535, 0};
+static const uint16_t dh_d562b4df655bdd4d[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_d562b4df655bdd4d = {
   0xd562b4df655bdd4d, b_d562b4df655bdd4d.words, 76, d_d562b4df655bdd4d, m_d562b4df655bdd4d,
-  1, 4, i_d562b4df655bdd4d, nullptr, nullptr
+  1, 4, i_d562b4df655bdd4d, nullptr, nullptr,
+  mh_d562b4df655bdd4d, dh_d562b4df655bdd4d, nullptr
 };
 static const ::capnp::_::AlignedData<45> b_e40ef0b4b02e882c = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -963,9 +988,12 @@ static const ::capnp::_::RawSchema* const d_e40ef0b4b02e882c[] = {
 };
 static const uint16_t m_e40ef0b4b02e882c[] = {0, 1};
 static const uint16_t i_e40ef0b4b02e882c[] = {0, 1};
+static const uint16_t mh_e40ef0b4b02e882c[] = {1, 3, 1, 0, 1, 65535};
+static const uint16_t dh_e40ef0b4b02e882c[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_e40ef0b4b02e882c = {
   0xe40ef0b4b02e882c, b_e40ef0b4b02e882c.words, 45, d_e40ef0b4b02e882c, m_e40ef0b4b02e882c,
-  1, 2, i_e40ef0b4b02e882c, nullptr, nullptr
+  1, 2, i_e40ef0b4b02e882c, nullptr, nullptr,
+  mh_e40ef0b4b02e882c, dh_e40ef0b4b02e882c, nullptr
 };
 static const ::capnp::_::AlignedData<46> b_ec0c922151b8b0a8 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1017,9 +1045,11 @@ static const ::capnp::_::AlignedData<46> b_ec0c922151b8b0a8 = {
 };
 static const uint16_t m_ec0c922151b8b0a8[] = {1, 0};
 static const uint16_t i_ec0c922151b8b0a8[] = {0, 1};
+static const uint16_t mh_ec0c922151b8b0a8[] = {1, 3, 1, 0, 1, 65535};
 const ::capnp::_::RawSchema s_ec0c922151b8b0a8 = {
   0xec0c922151b8b0a8, b_ec0c922151b8b0a8.words, 46, nullptr, m_ec0c922151b8b0a8,
-  0, 2, i_ec0c922151b8b0a8, nullptr, nullptr
+  0, 2, i_ec0c922151b8b0a8, nullptr, nullptr,
+  mh_ec0c922151b8b0a8, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<46> b_86267432565dee97 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1071,9 +1101,11 @@ static const ::capnp::_::AlignedData<46> b_86267432565dee97 = {
 };
 static const uint16_t m_86267432565dee97[] = {1, 0};
 static const uint16_t i_86267432565dee97[] = {0, 1};
+static const uint16_t mh_86267432565dee97[] = {1, 3, 1, 0, 1, 65535};
 const ::capnp::_::RawSchema s_86267432565dee97 = {
   0x86267432565dee97, b_86267432565dee97.words, 46, nullptr, m_86267432565dee97,
-  0, 2, i_86267432565dee97, nullptr, nullptr
+  0, 2, i_86267432565dee97, nullptr, nullptr,
+  mh_86267432565dee97, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<60> b_9c6a046bfbc1ac5a = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1142,9 +1174,12 @@ static const ::capnp::_::RawSchema* const d_9c6a046bfbc1ac5a[] = {
 };
 static const uint16_t m_9c6a046bfbc1ac5a[] = {0, 2, 1};
 static const uint16_t i_9c6a046bfbc1ac5a[] = {0, 1, 2};
+static const uint16_t mh_9c6a046bfbc1ac5a[] = {1, 4, 1, 65535, 0, 2, 1};
+static const uint16_t dh_9c6a046bfbc1ac5a[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_9c6a046bfbc1ac5a = {
   0x9c6a046bfbc1ac5a, b_9c6a046bfbc1ac5a.words, 60, d_9c6a046bfbc1ac5a, m_9c6a046bfbc1ac5a,
-  1, 3, i_9c6a046bfbc1ac5a, nullptr, nullptr
+  1, 3, i_9c6a046bfbc1ac5a, nullptr, nullptr,
+  mh_9c6a046bfbc1ac5a, dh_9c6a046bfbc1ac5a, nullptr
 };
 static const ::capnp::_::AlignedData<60> b_d4c9b56290554016 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1210,9 +1245,11 @@ static const ::capnp::_::AlignedData<60> b_d4c9b56290554016 = {
 };
 static const uint16_t m_d4c9b56290554016[] = {2, 1, 0};
 static const uint16_t i_d4c9b56290554016[] = {0, 1, 2};
+static const uint16_t mh_d4c9b56290554016[] = {1, 4, 2, 1, 0, 2, 65535};
 const ::capnp::_::RawSchema s_d4c9b56290554016 = {
   0xd4c9b56290554016, b_d4c9b56290554016.words, 60, nullptr, m_d4c9b56290554016,
-  0, 3, i_d4c9b56290554016, nullptr, nullptr
+  0, 3, i_d4c9b56290554016, nullptr, nullptr,
+  mh_d4c9b56290554016, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<59> b_fbe1980490e001af = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1280,9 +1317,12 @@ static const ::capnp::_::RawSchema* const d_fbe1980490e001af[] = {
 };
 static const uint16_t m_fbe1980490e001af[] = {2, 0, 1};
 static const uint16_t i_fbe1980490e001af[] = {0, 1, 2};
+static const uint16_t mh_fbe1980490e001af[] = {1, 4, 5, 1, 0, 65535, 2};
+static const uint16_t dh_fbe1980490e001af[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_fbe1980490e001af = {
   0xfbe1980490e001af, b_fbe1980490e001af.words, 59, d_fbe1980490e001af, m_fbe1980490e001af,
-  1, 3, i_fbe1980490e001af, nullptr, nullptr
+  1, 3, i_fbe1980490e001af, nullptr, nullptr,
+  mh_fbe1980490e001af, dh_fbe1980490e001af, nullptr
 };
 static const ::capnp::_::AlignedData<47> b_95bc14545813fbc1 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1338,9 +1378,12 @@ static const ::capnp::_::RawSchema* const d_95bc14545813fbc1[] = {
 };
 static const uint16_t m_95bc14545813fbc1[] = {0, 1};
 static const uint16_t i_95bc14545813fbc1[] = {0, 1};
+static const uint16_t mh_95bc14545813fbc1[] = {1, 3, 0, 0, 65535, 1};
+static const uint16_t dh_95bc14545813fbc1[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_95bc14545813fbc1 = {
   0x95bc14545813fbc1, b_95bc14545813fbc1.words, 47, d_95bc14545813fbc1, m_95bc14545813fbc1,
-  1, 2, i_95bc14545813fbc1, nullptr, nullptr
+  1, 2, i_95bc14545813fbc1, nullptr, nullptr,
+  mh_95bc14545813fbc1, dh_95bc14545813fbc1, nullptr
 };
 static const ::capnp::_::AlignedData<48> b_9a0e61223d96743b = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1397,9 +1440,12 @@ static const ::capnp::_::RawSchema* const d_9a0e61223d96743b[] = {
 };
 static const uint16_t m_9a0e61223d96743b[] = {1, 0};
 static const uint16_t i_9a0e61223d96743b[] = {0, 1};
+static const uint16_t mh_9a0e61223d96743b[] = {1, 3, 0, 65535, 1, 0};
+static const uint16_t dh_9a0e61223d96743b[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_9a0e61223d96743b = {
   0x9a0e61223d96743b, b_9a0e61223d96743b.words, 48, d_9a0e61223d96743b, m_9a0e61223d96743b,
-  1, 2, i_9a0e61223d96743b, nullptr, nullptr
+  1, 2, i_9a0e61223d96743b, nullptr, nullptr,
+  mh_9a0e61223d96743b, dh_9a0e61223d96743b, nullptr
 };
 static const ::capnp::_::AlignedData<107> b_8523ddc40b86b8b0 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1516,9 +1562,12 @@ static const ::capnp::_::RawSchema* const d_8523ddc40b86b8b0[] = {
 };
 static const uint16_t m_8523ddc40b86b8b0[] = {0, 4, 3, 1, 2, 5};
 static const uint16_t i_8523ddc40b86b8b0[] = {0, 1, 2, 3, 4, 5};
+static const uint16_t mh_8523ddc40b86b8b0[] = {2, 8, 3, 0, 65535, 65535, 0, 3, 5, 2, 1, 4};
+static const uint16_t dh_8523ddc40b86b8b0[] = {1, 3, 0, 1, 0, 65535};
 const ::capnp::_::RawSchema s_8523ddc40b86b8b0 = {
   0x8523ddc40b86b8b0, b_8523ddc40b86b8b0.words, 107, d_8523ddc40b86b8b0, m_8523ddc40b86b8b0,
-  2, 6, i_8523ddc40b86b8b0, nullptr, nullptr
+  2, 6, i_8523ddc40b86b8b0, nullptr, nullptr,
+  mh_8523ddc40b86b8b0, dh_8523ddc40b86b8b0, nullptr
 };
 static const ::capnp::_::AlignedData<53> b_d800b1d6cd6f1ca0 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1580,9 +1629,12 @@ static const ::capnp::_::RawSchema* const d_d800b1d6cd6f1ca0[] = {
 };
 static const uint16_t m_d800b1d6cd6f1ca0[] = {0, 1};
 static const uint16_t i_d800b1d6cd6f1ca0[] = {0, 1};
+static const uint16_t mh_d800b1d6cd6f1ca0[] = {1, 3, 1, 0, 1, 65535};
+static const uint16_t dh_d800b1d6cd6f1ca0[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_d800b1d6cd6f1ca0 = {
   0xd800b1d6cd6f1ca0, b_d800b1d6cd6f1ca0.words, 53, d_d800b1d6cd6f1ca0, m_d800b1d6cd6f1ca0,
-  1, 2, i_d800b1d6cd6f1ca0, nullptr, nullptr
+  1, 2, i_d800b1d6cd6f1ca0, nullptr, nullptr,
+  mh_d800b1d6cd6f1ca0, dh_d800b1d6cd6f1ca0, nullptr
 };
 static const ::capnp::_::AlignedData<47> b_f316944415569081 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1635,9 +1687,11 @@ static const ::capnp::_::AlignedData<47> b_f316944415569081 = {
 };
 static const uint16_t m_f316944415569081[] = {1, 0};
 static const uint16_t i_f316944415569081[] = {0, 1};
+static const uint16_t mh_f316944415569081[] = {1, 3, 1, 1, 0, 65535};
 const ::capnp::_::RawSchema s_f316944415569081 = {
   0xf316944415569081, b_f316944415569081.words, 47, nullptr, m_f316944415569081,
-  0, 2, i_f316944415569081, nullptr, nullptr
+  0, 2, i_f316944415569081, nullptr, nullptr,
+  mh_f316944415569081, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<46> b_ce8c7a90684b48ff = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1689,9 +1743,11 @@ static const ::capnp::_::AlignedData<46> b_ce8c7a90684b48ff = {
 };
 static const uint16_t m_ce8c7a90684b48ff[] = {0, 1};
 static const uint16_t i_ce8c7a90684b48ff[] = {0, 1};
+static const uint16_t mh_ce8c7a90684b48ff[] = {1, 3, 4, 0, 1, 65535};
 const ::capnp::_::RawSchema s_ce8c7a90684b48ff = {
   0xce8c7a90684b48ff, b_ce8c7a90684b48ff.words, 46, nullptr, m_ce8c7a90684b48ff,
-  0, 2, i_ce8c7a90684b48ff, nullptr, nullptr
+  0, 2, i_ce8c7a90684b48ff, nullptr, nullptr,
+  mh_ce8c7a90684b48ff, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<46> b_d37007fde1f0027d = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1743,9 +1799,11 @@ static const ::capnp::_::AlignedData<46> b_d37007fde1f0027d = {
 };
 static const uint16_t m_d37007fde1f0027d[] = {0, 1};
 static const uint16_t i_d37007fde1f0027d[] = {0, 1};
+static const uint16_t mh_d37007fde1f0027d[] = {1, 3, 0, 0, 65535, 1};
 const ::capnp::_::RawSchema s_d37007fde1f0027d = {
   0xd37007fde1f0027d, b_d37007fde1f0027d.words, 46, nullptr, m_d37007fde1f0027d,
-  0, 2, i_d37007fde1f0027d, nullptr, nullptr
+  0, 2, i_d37007fde1f0027d, nullptr, nullptr,
+  mh_d37007fde1f0027d, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<65> b_d625b7063acf691a = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1819,9 +1877,12 @@ static const ::capnp::_::RawSchema* const d_d625b7063acf691a[] = {
 };
 static const uint16_t m_d625b7063acf691a[] = {2, 1, 0};
 static const uint16_t i_d625b7063acf691a[] = {0, 1, 2};
+static const uint16_t mh_d625b7063acf691a[] = {1, 4, 0, 2, 1, 0, 65535};
+static const uint16_t dh_d625b7063acf691a[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_d625b7063acf691a = {
   0xd625b7063acf691a, b_d625b7063acf691a.words, 65, d_d625b7063acf691a, m_d625b7063acf691a,
-  1, 3, i_d625b7063acf691a, nullptr, nullptr
+  1, 3, i_d625b7063acf691a, nullptr, nullptr,
+  mh_d625b7063acf691a, dh_d625b7063acf691a, nullptr
 };
 static const ::capnp::_::AlignedData<33> b_bbaeda2607b6f958 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1859,9 +1920,11 @@ static const ::capnp::_::AlignedData<33> b_bbaeda2607b6f958 = {
     101, 100,   0,   0,   0,   0,   0,   0, }
 };
 static const uint16_t m_bbaeda2607b6f958[] = {2, 0, 1};
+static const uint16_t mh_bbaeda2607b6f958[] = {1, 4, 3, 1, 0, 2, 65535};
 const ::capnp::_::RawSchema s_bbaeda2607b6f958 = {
   0xbbaeda2607b6f958, b_bbaeda2607b6f958.words, 33, nullptr, m_bbaeda2607b6f958,
-  0, 3, nullptr, nullptr, nullptr
+  0, 3, nullptr, nullptr, nullptr,
+  mh_bbaeda2607b6f958, nullptr, nullptr
 };
 }  // namespace schemas
 namespace _ {  // private
@@ -389,6 +389,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<14> presenceMask() const;
+
   inline Which which() const;
   inline bool isUnimplemented() const;
   inline bool hasUnimplemented() const;
@@ -476,6 +478,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isUnimplemented();
   inline bool hasUnimplemented();
@@ -626,6 +630,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<7> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool hasTarget() const;
@@ -672,6 +678,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -741,6 +749,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline Which which() const;
   inline bool isCaller() const;
   inline  ::capnp::Void getCaller() const;
@@ -833,6 +843,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<8> presenceMask() const;
+
   inline Which which() const;
   inline  ::uint32_t getAnswerId() const;
 
@@ -889,6 +901,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline  ::uint32_t getAnswerId();
   inline void setAnswerId( ::uint32_t value);
@@ -966,6 +980,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool getReleaseResultCaps() const;
@@ -1000,6 +1016,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -1043,6 +1061,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline Which which() const;
   inline  ::uint32_t getPromiseId() const;
 
@@ -1084,6 +1104,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline  ::uint32_t getPromiseId();
   inline void setPromiseId( ::uint32_t value);
@@ -1141,6 +1163,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline  ::uint32_t getId() const;
 
   inline  ::uint32_t getReferenceCount() const;
@@ -1175,6 +1199,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getId();
   inline void setId( ::uint32_t value);
 
@@ -1218,6 +1244,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasTarget() const;
   inline  ::capnp::rpc::MessageTarget::Reader getTarget() const;
 
@@ -1253,6 +1281,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasTarget();
   inline  ::capnp::rpc::MessageTarget::Builder getTarget();
   inline void setTarget( ::capnp::rpc::MessageTarget::Reader value);
@@ -1302,6 +1332,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<4> presenceMask() const;
+
   inline Which which() const;
   inline bool isSenderLoopback() const;
   inline  ::uint32_t getSenderLoopback() const;
@@ -1399,6 +1431,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool hasTarget() const;
@@ -1434,6 +1468,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -1482,6 +1518,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool hasObjectId() const;
@@ -1517,6 +1555,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -1561,6 +1601,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool hasObjectId() const;
@@ -1596,6 +1638,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -1640,6 +1684,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool hasTarget() const;
@@ -1678,6 +1724,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -1730,6 +1778,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool hasProvision() const;
@@ -1767,6 +1817,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -1814,6 +1866,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool hasTarget() const;
@@ -1852,6 +1906,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -1904,6 +1960,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline Which which() const;
   inline bool isImportedCap() const;
   inline  ::uint32_t getImportedCap() const;
@@ -1942,6 +2000,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isImportedCap();
   inline  ::uint32_t getImportedCap();
@@ -1992,6 +2052,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasContent() const;
   inline ::capnp::AnyPointer::Reader getContent() const;
 
@@ -2028,6 +2090,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasContent();
   inline ::capnp::AnyPointer::Builder getContent();
   inline ::capnp::AnyPointer::Builder initContent();
@@ -2076,6 +2140,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<6> presenceMask() const;
+
   inline Which which() const;
   inline bool isNone() const;
   inline  ::capnp::Void getNone() const;
@@ -2127,6 +2193,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isNone();
   inline  ::capnp::Void getNone();
@@ -2197,6 +2265,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline  ::uint32_t getQuestionId() const;
 
   inline bool hasTransform() const;
@@ -2232,6 +2302,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint32_t getQuestionId();
   inline void setQuestionId( ::uint32_t value);
 
@@ -2279,6 +2351,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline Which which() const;
   inline bool isNoop() const;
   inline  ::capnp::Void getNoop() const;
@@ -2316,6 +2390,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isNoop();
   inline  ::capnp::Void getNoop();
@@ -2362,6 +2438,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasHostId() const;
   inline ::capnp::AnyPointer::Reader getHostId() const;
 
@@ -2398,6 +2476,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasHostId();
   inline ::capnp::AnyPointer::Builder getHostId();
   inline ::capnp::AnyPointer::Builder initHostId();
@@ -2443,6 +2523,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasId() const;
   inline ::capnp::AnyPointer::Reader getId() const;
 
@@ -2478,6 +2560,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasId();
   inline ::capnp::AnyPointer::Builder getId();
   inline ::capnp::AnyPointer::Builder initId();
@@ -2522,6 +2606,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline bool hasReason() const;
   inline  ::capnp::Text::Reader getReason() const;
 
@@ -2559,6 +2645,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasReason();
   inline  ::capnp::Text::Builder getReason();
   inline void setReason( ::capnp::Text::Reader value);
@@ -2607,6 +2695,35 @@ inline Message::Which Message::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<14> Message::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<14> _result;
+  _result.set(0, which() == Message::UNIMPLEMENTED && ((_pointers[0] >> 0) & 1));
+  _result.set(1, which() == Message::ABORT && ((_pointers[0] >> 0) & 1));
+  _result.set(2, which() == Message::CALL && ((_pointers[0] >> 0) & 1));
+  _result.set(3, which() == Message::RETURN && ((_pointers[0] >> 0) & 1));
+  _result.set(4, which() == Message::FINISH && ((_pointers[0] >> 0) & 1));
+  _result.set(5, which() == Message::RESOLVE && ((_pointers[0] >> 0) & 1));
+  _result.set(6, which() == Message::RELEASE && ((_pointers[0] >> 0) & 1));
+  _result.set(7, which() == Message::SAVE && ((_pointers[0] >> 0) & 1));
+  _result.set(8, which() == Message::RESTORE && ((_pointers[0] >> 0) & 1));
+  _result.set(9, which() == Message::DELETE && ((_pointers[0] >> 0) & 1));
+  _result.set(10, which() == Message::PROVIDE && ((_pointers[0] >> 0) & 1));
+  _result.set(11, which() == Message::ACCEPT && ((_pointers[0] >> 0) & 1));
+  _result.set(12, which() == Message::JOIN && ((_pointers[0] >> 0) & 1));
+  _result.set(13, which() == Message::DISEMBARGO && ((_pointers[0] >> 0) & 1));
+  return _result;
+}
+
+inline void Message::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Message>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool Message::Reader::isUnimplemented() const {
   return which() == Message::UNIMPLEMENTED;
 }
@@ -3335,6 +3452,34 @@ inline ::capnp::Orphan< ::capnp::rpc::Disembargo> Message::Builder::disownDisemb
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<7> Call::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<7> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  _result.set(2, _reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField< ::uint16_t>(2 * ::capnp::ELEMENTS));
+  _result.set(4, (_pointers[0] >> 1) & 1);
+  _result.set(5, true);
+  _result.set(6, _reader.hasDataField<bool>(128 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Call::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Call>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::rpc::MessageTarget>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  ::capnp::_::PointerHelpers< ::capnp::rpc::Payload>::copy(
+      _builder.getPointerField(1 * ::capnp::POINTERS),
+      _other.getPointerField(1 * ::capnp::POINTERS));
+  _builder.getPointerField(2 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(2 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Call::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -3482,6 +3627,16 @@ inline Call::SendResultsTo::Which Call::SendResultsTo::Builder::which() {
   return _builder.getDataField<Which>(3 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<3> Call::SendResultsTo::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, which() == Call::SendResultsTo::CALLER);
+  _result.set(1, which() == Call::SendResultsTo::YOURSELF);
+  _result.set(2, which() == Call::SendResultsTo::THIRD_PARTY && ((_pointers[0] >> 2) & 1));
+  return _result;
+}
+
 inline bool Call::SendResultsTo::Reader::isCaller() const {
   return which() == Call::SendResultsTo::CALLER;
 }
@@ -3576,6 +3731,29 @@ inline Return::Which Return::Builder::which() {
   return _builder.getDataField<Which>(3 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<8> Return::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<8> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, _reader.hasDataField<bool>(32 * ::capnp::ELEMENTS));
+  _result.set(2, which() == Return::RESULTS && ((_pointers[0] >> 0) & 1));
+  _result.set(3, which() == Return::EXCEPTION && ((_pointers[0] >> 0) & 1));
+  _result.set(4, which() == Return::CANCELED);
+  _result.set(5, which() == Return::RESULTS_SENT_ELSEWHERE);
+  _result.set(6, which() == Return::TAKE_FROM_OTHER_QUESTION && (_reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS)));
+  _result.set(7, which() == Return::ACCEPT_FROM_THIRD_PARTY && ((_pointers[0] >> 0) & 1));
+  return _result;
+}
+
+inline void Return::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Return>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Return::Reader::getAnswerId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -3821,6 +3999,19 @@ inline ::capnp::AnyPointer::Builder Return::Builder::initAcceptFromThirdParty()
   return result;
 }
 
+inline ::capnp::FieldPresence<2> Finish::Reader::presenceMask() const {
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, _reader.hasDataField<bool>(32 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Finish::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Finish>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
 inline  ::uint32_t Finish::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -3856,6 +4047,24 @@ inline Resolve::Which Resolve::Builder::which() {
   return _builder.getDataField<Which>(2 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<3> Resolve::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, which() == Resolve::CAP && ((_pointers[0] >> 0) & 1));
+  _result.set(2, which() == Resolve::EXCEPTION && ((_pointers[0] >> 0) & 1));
+  return _result;
+}
+
+inline void Resolve::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Resolve>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Resolve::Reader::getPromiseId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -3974,6 +4183,19 @@ inline ::capnp::Orphan< ::capnp::rpc::Exception> Resolve::Builder::disownExcepti
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> Release::Reader::presenceMask() const {
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Release::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Release>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
 inline  ::uint32_t Release::Reader::getId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -4002,6 +4224,24 @@ inline void Release::Builder::setReferenceCount( ::uint32_t value) {
       1 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<2> Disembargo::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, true);
+  return _result;
+}
+
+inline void Disembargo::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Disembargo>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::rpc::MessageTarget>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool Disembargo::Reader::hasTarget() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -4058,6 +4298,15 @@ inline Disembargo::Context::Which Disembargo::Context::Builder::which() {
   return _builder.getDataField<Which>(2 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<4> Disembargo::Context::Reader::presenceMask() const {
+  ::capnp::FieldPresence<4> _result;
+  _result.set(0, which() == Disembargo::Context::SENDER_LOOPBACK && (_reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS)));
+  _result.set(1, which() == Disembargo::Context::RECEIVER_LOOPBACK && (_reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS)));
+  _result.set(2, which() == Disembargo::Context::ACCEPT);
+  _result.set(3, which() == Disembargo::Context::PROVIDE && (_reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS)));
+  return _result;
+}
+
 inline bool Disembargo::Context::Reader::isSenderLoopback() const {
   return which() == Disembargo::Context::SENDER_LOOPBACK;
 }
@@ -4162,6 +4411,24 @@ inline void Disembargo::Context::Builder::setProvide( ::uint32_t value) {
       0 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<2> Save::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void Save::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Save>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::rpc::MessageTarget>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Save::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -4211,6 +4478,23 @@ inline ::capnp::Orphan< ::capnp::rpc::MessageTarget> Save::Builder::disownTarget
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> Restore::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void Restore::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Restore>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Restore::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -4246,6 +4530,23 @@ inline ::capnp::AnyPointer::Builder Restore::Builder::initObjectId() {
   return result;
 }
 
+inline ::capnp::FieldPresence<2> Delete::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void Delete::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Delete>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Delete::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -4281,6 +4582,27 @@ inline ::capnp::AnyPointer::Builder Delete::Builder::initObjectId() {
   return result;
 }
 
+inline ::capnp::FieldPresence<3> Provide::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  _result.set(2, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void Provide::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Provide>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::rpc::MessageTarget>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Provide::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -4351,6 +4673,24 @@ inline ::capnp::AnyPointer::Builder Provide::Builder::initRecipient() {
   return result;
 }
 
+inline ::capnp::FieldPresence<3> Accept::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  _result.set(2, _reader.hasDataField<bool>(32 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Accept::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Accept>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Accept::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -4400,6 +4740,27 @@ inline void Accept::Builder::setEmbargo(bool value) {
       32 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<3> Join::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  _result.set(2, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void Join::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Join>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::rpc::MessageTarget>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t Join::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -4477,6 +4838,23 @@ inline MessageTarget::Which MessageTarget::Builder::which() {
   return _builder.getDataField<Which>(2 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<2> MessageTarget::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, which() == MessageTarget::IMPORTED_CAP && (_reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS)));
+  _result.set(1, which() == MessageTarget::PROMISED_ANSWER && ((_pointers[0] >> 0) & 1));
+  return _result;
+}
+
+inline void MessageTarget::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<MessageTarget>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool MessageTarget::Reader::isImportedCap() const {
   return which() == MessageTarget::IMPORTED_CAP;
 }
@@ -4555,6 +4933,25 @@ inline ::capnp::Orphan< ::capnp::rpc::PromisedAnswer> MessageTarget::Builder::di
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> Payload::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void Payload::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Payload>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline bool Payload::Reader::hasContent() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -4615,6 +5012,27 @@ inline CapDescriptor::Which CapDescriptor::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<6> CapDescriptor::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<6> _result;
+  _result.set(0, which() == CapDescriptor::NONE);
+  _result.set(1, which() == CapDescriptor::SENDER_HOSTED && (_reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(2, which() == CapDescriptor::SENDER_PROMISE && (_reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(3, which() == CapDescriptor::RECEIVER_HOSTED && (_reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(4, which() == CapDescriptor::RECEIVER_ANSWER && ((_pointers[0] >> 0) & 1));
+  _result.set(5, which() == CapDescriptor::THIRD_PARTY_HOSTED && ((_pointers[0] >> 0) & 1));
+  return _result;
+}
+
+inline void CapDescriptor::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<CapDescriptor>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool CapDescriptor::Reader::isNone() const {
   return which() == CapDescriptor::NONE;
 }
@@ -4823,6 +5241,23 @@ inline ::capnp::Orphan< ::capnp::rpc::ThirdPartyCapDescriptor> CapDescriptor::Bu
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> PromisedAnswer::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void PromisedAnswer::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<PromisedAnswer>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint32_t PromisedAnswer::Reader::getQuestionId() const {
   return _reader.getDataField< ::uint32_t>(
       0 * ::capnp::ELEMENTS);
@@ -4876,6 +5311,19 @@ inline PromisedAnswer::Op::Which PromisedAnswer::Op::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<2> PromisedAnswer::Op::Reader::presenceMask() const {
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, which() == PromisedAnswer::Op::NOOP);
+  _result.set(1, which() == PromisedAnswer::Op::GET_POINTER_FIELD && (_reader.hasDataField< ::uint16_t>(1 * ::capnp::ELEMENTS)));
+  return _result;
+}
+
+inline void PromisedAnswer::Op::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<PromisedAnswer::Op>::getInternalReader(other);
+  _builder.copyDataFrom(_other);
+}
+
 inline bool PromisedAnswer::Op::Reader::isNoop() const {
   return which() == PromisedAnswer::Op::NOOP;
 }
@@ -4928,6 +5376,25 @@ inline void PromisedAnswer::Op::Builder::setGetPointerField( ::uint16_t value) {
       1 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<2> SturdyRef::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void SturdyRef::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<SturdyRef>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline bool SturdyRef::Reader::hasHostId() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -4970,6 +5437,23 @@ inline ::capnp::AnyPointer::Builder SturdyRef::Builder::initObjectId() {
   return result;
 }
 
+inline ::capnp::FieldPresence<2> ThirdPartyCapDescriptor::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, _reader.hasDataField< ::uint32_t>(0 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void ThirdPartyCapDescriptor::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<ThirdPartyCapDescriptor>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool ThirdPartyCapDescriptor::Reader::hasId() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -5005,6 +5489,25 @@ inline void ThirdPartyCapDescriptor::Builder::setVineId( ::uint32_t value) {
       0 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<3> Exception::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, _reader.hasDataField<bool>(0 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField< ::uint16_t>(1 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Exception::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Exception>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool Exception::Reader::hasReason() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
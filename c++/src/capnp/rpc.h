@@ -25,7 +25,9 @@
 #define CAPNP_RPC_H_
 
 #include "capability.h"
+#include "message.h"
 #include "rpc-prelude.h"
+#include "rpc-observer.h"
 
 namespace capnp {
 
@@ -64,6 +66,35 @@ public:
   //
   // `hostId` identifies the host from which to request the ref, in the format specified by the
   // `VatNetwork` in use.  `objectId` is the object ID in whatever format is expected by said host.
+
+  void setFlowControlWindow(size_t bytes);
+  // Limit how many bytes of calls may be outstanding -- sent but not yet returned -- on each
+  // connection before `Capability::Client::whenWritable()` stops resolving.  The window is
+  // advisory:  calls are never refused, but a producer that waits for `whenWritable()` between
+  // calls keeps at most about one window's worth of calls (plus one call) in flight.  By default
+  // there is no limit.
+
+  size_t getCallBytesInFlight();
+  // Total size of calls sent and not yet returned, across all connections.
+
+  void setIncomingCallLimit(uint calls);
+  // Stop reading messages from a connection while `calls` or more of the calls received on it are
+  // still in progress (not yet returned or canceled), resuming as they finish.  This bounds how
+  // much work, and memory, a misbehaving or overloaded peer can pile up on us.  By default there
+  // is no limit.  To also bound the bytes of received messages held, see the VatNetwork in use
+  // (e.g. `TwoPartyVatNetwork::setReceiveLimit()`).
+  //
+  // Warning:  While reading is stopped, nothing at all is read from the connection -- including
+  // returns for calls we made to the peer.  If calls from the peer wait on calls back to the
+  // peer, a limit lower than the number of such calls can deadlock the connection.
+
+  uint getIncomingCallsInProgress();
+  // Total number of received calls still in progress, across all connections.
+
+  void setObserver(kj::Maybe<RpcObserver&> observer);
+  // Report connections, calls and embargoes to `observer`, which must outlive the RpcSystem.  Set
+  // this once, before any connections are made; otherwise events for connections and calls that
+  // were already open go unreported or unmatched.  See rpc-observer.h.
 };
 
 template <typename SturdyRefHostId, typename LocalSturdyRefObjectId,
@@ -133,6 +164,12 @@ public:
   virtual void send() = 0;
   // Send the message, or at least put it in a queue to be sent later.  Note that the builder
   // returned by `getBody()` remains valid at least until the `OutgoingRpcMessage` is destroyed.
+
+  virtual size_t sizeInWords();
+  // Get the total size of the message built so far.  The RPC system uses this to learn how large
+  // each method's messages tend to be, so that it can size the first segment of later messages
+  // to fit.  The default implementation traverses the body; implementations backed by a
+  // `MessageBuilder` should override it to add up the segment sizes instead, which is cheaper.
 };
 
 class IncomingRpcMessage {
@@ -143,7 +180,7 @@ public:
   // Get the message body, to be interpreted by the caller.  (The standard RPC implementation
   // interprets it as a Message as defined in rpc.capnp.)
 
-  virtual void initCapTable(kj::Array<kj::Maybe<kj::Own<ClientHook>>>&& capTable) = 0;
+  virtual void initCapTable(CapTable&& capTable) = 0;
   // Calls initCapTable() on the underlying MessageReader.
 };
 
@@ -343,6 +380,31 @@ Capability::Client RpcSystem<SturdyRefHostId>::restore(
   return baseRestore(_::PointerHelpers<SturdyRefHostId>::getInternalReader(hostId), objectId);
 }
 
+template <typename SturdyRefHostId>
+inline void RpcSystem<SturdyRefHostId>::setFlowControlWindow(size_t bytes) {
+  baseSetFlowControlWindow(bytes);
+}
+
+template <typename SturdyRefHostId>
+inline size_t RpcSystem<SturdyRefHostId>::getCallBytesInFlight() {
+  return baseGetCallBytesInFlight();
+}
+
+template <typename SturdyRefHostId>
+inline void RpcSystem<SturdyRefHostId>::setIncomingCallLimit(uint calls) {
+  baseSetIncomingCallLimit(calls);
+}
+
+template <typename SturdyRefHostId>
+inline uint RpcSystem<SturdyRefHostId>::getIncomingCallsInProgress() {
+  return baseGetIncomingCallsInProgress();
+}
+
+template <typename SturdyRefHostId>
+inline void RpcSystem<SturdyRefHostId>::setObserver(kj::Maybe<RpcObserver&> observer) {
+  baseSetObserver(observer);
+}
+
 template <typename SturdyRefHostId, typename LocalSturdyRefObjectId,
           typename ProvisionId, typename RecipientId, typename ThirdPartyCapId, typename JoinResult>
 RpcSystem<SturdyRefHostId> makeRpcServer(
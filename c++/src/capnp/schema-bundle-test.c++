@@ -0,0 +1,123 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "schema-bundle.h"
+#include "serialize.h"
+#include <gtest/gtest.h>
+#include "test-util.h"
+#include <kj/debug.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace capnp {
+namespace _ {  // private
+namespace {
+
+kj::Array<Schema> getTestSchemas(SchemaLoader& source) {
+  // The schemas belong to `source`, which must outlive them.
+  source.loadCompiledTypeAndDependencies<test::TestAllTypes>();
+  source.loadCompiledTypeAndDependencies<test::TestLists>();
+  return source.getAllLoaded();
+}
+
+kj::String writeBundleFile() {
+  char path[] = "/tmp/capnp-bundle-test.XXXXXX";
+  int fd;
+  KJ_SYSCALL(fd = mkstemp(path));
+  kj::FdOutputStream output((kj::AutoCloseFd(fd)));
+  SchemaLoader source;
+  writeSchemaBundle(output, getTestSchemas(source));
+  return kj::heapString(path);
+}
+
+TEST(SchemaBundle, LoadLazily) {
+  kj::String path = writeBundleFile();
+  KJ_DEFER(unlink(path.cStr()));
+
+  SchemaLoader loader;
+  loader.loadBundle(path);
+  EXPECT_EQ(0u, loader.getAllLoaded().size());
+
+  auto native = Schema::from<test::TestAllTypes>();
+  Schema schema = loader.get(typeId<test::TestAllTypes>());
+  EXPECT_EQ(kj::str(native.getProto()), kj::str(schema.getProto()));
+  EXPECT_FALSE(schema == native);
+
+  // Dependencies are filled in from the bundle when first used, not left as stubs.
+  auto nested = schema.getDependency(typeId<test::TestAllTypes>()).asStruct();
+  EXPECT_EQ(native.asStruct().getFields().size(), nested.getFields().size());
+  auto enumSchema = schema.getDependency(typeId<test::TestEnum>()).asEnum();
+  EXPECT_EQ(Schema::from<test::TestEnum>().getEnumerants().size(),
+            enumSchema.getEnumerants().size());
+
+  // Only what was touched has been loaded.
+  SchemaLoader source;
+  EXPECT_LT(loader.getAllLoaded().size(), getTestSchemas(source).size());
+
+  EXPECT_TRUE(loader.tryGet(0x1234567890abcdefull) == nullptr);
+}
+
+TEST(SchemaBundle, InMemory) {
+  auto buffer = kj::heapArray<word>(1 << 16);
+  kj::ArrayOutputStream output(kj::arrayPtr(reinterpret_cast<byte*>(buffer.begin()),
+                                            buffer.size() * sizeof(word)));
+  SchemaLoader source;
+  auto schemas = getTestSchemas(source);
+  writeSchemaBundle(output, schemas);
+
+  SchemaBundle bundle(buffer.slice(0, output.getArray().size() / sizeof(word)));
+
+  ASSERT_EQ(schemas.size(), bundle.getNodes().size());
+  for (uint i = 1; i < bundle.getNodes().size(); i++) {
+    EXPECT_LT(bundle.getNodes()[i - 1].getId(), bundle.getNodes()[i].getId());
+  }
+
+  for (auto schema: schemas) {
+    KJ_IF_MAYBE(node, bundle.find(schema.getProto().getId())) {
+      EXPECT_EQ(schema.getProto().getDisplayName(), node->getDisplayName());
+    } else {
+      ADD_FAILURE() << "Node not found: " << schema.getProto().getDisplayName().cStr();
+    }
+  }
+  EXPECT_TRUE(bundle.find(0) == nullptr);
+
+  // Usable directly as a lazy load callback.
+  SchemaLoader loader(bundle);
+  EXPECT_EQ(kj::str(Schema::from<test::TestLists>().getProto()),
+            kj::str(loader.get(typeId<test::TestLists>()).getProto()));
+}
+
+TEST(SchemaBundle, RejectsUnsorted) {
+  MallocMessageBuilder builder;
+  auto nodes = builder.initRoot<schema::CodeGeneratorRequest>().initNodes(2);
+  nodes[0].setId(2);
+  nodes[1].setId(1);
+
+  auto words = messageToFlatArray(builder);
+  EXPECT_ANY_THROW(SchemaBundle bundle(words));
+}
+
+}  // namespace
+}  // namespace _ (private)
+}  // namespace capnp
@@ -0,0 +1,161 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "schema-bundle.h"
+#include "serialize.h"
+#include <kj/debug.h>
+#include <kj/vector.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <algorithm>
+
+namespace capnp {
+
+namespace {
+
+kj::Array<const word> mapFile(int fd) {
+  struct stat stats;
+  KJ_SYSCALL(fstat(fd, &stats));
+  size_t size = stats.st_size / sizeof(word);
+  KJ_REQUIRE(size > 0, "Schema bundle file is empty.");
+
+  void* mapping = mmap(nullptr, size * sizeof(word), PROT_READ, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    KJ_FAIL_SYSCALL("mmap", errno);
+  }
+  return kj::Array<const word>(reinterpret_cast<const word*>(mapping), size,
+                               kj::MmapDisposer::instance);
+}
+
+kj::Array<kj::ArrayPtr<const word>> getSegments(kj::ArrayPtr<const word> data) {
+  // Parse the segment table.  The segments point into `data`.
+  FlatArrayMessageReader reader(data);
+  auto segments = kj::heapArrayBuilder<kj::ArrayPtr<const word>>(reader.getSegmentCount());
+  for (uint i = 0; i < segments.capacity(); i++) {
+    segments.add(reader.getSegment(i));
+  }
+  return segments.finish();
+}
+
+ReaderOptions bundleReaderOptions(kj::ArrayPtr<const word> data) {
+  // A big bundle may legitimately exceed the default traversal limit, but no valid message can
+  // need more traversal than its own size.
+  ReaderOptions options;
+  options.traversalLimitInWords = std::max<uint64_t>(options.traversalLimitInWords, data.size());
+  return options;
+}
+
+}  // namespace
+
+SchemaBundle::SchemaBundle(kj::ArrayPtr<const word> data)
+    : SchemaBundle(nullptr, data) {}
+
+SchemaBundle::SchemaBundle(int fd): SchemaBundle(mapFile(fd), nullptr) {}
+
+SchemaBundle::SchemaBundle(kj::Array<const word>&& mappingParam, kj::ArrayPtr<const word> data)
+    : mapping(kj::mv(mappingParam)),
+      message(getSegments(mapping == nullptr ? data : mapping.asPtr()),
+              bundleReaderOptions(mapping == nullptr ? data : mapping.asPtr())) {
+  auto root = message.getRoot<schema::CodeGeneratorRequest>();
+  nodes = root.getNodes();
+  requestedFiles = root.getRequestedFiles();
+
+  for (uint i = 1; i < nodes.size(); i++) {
+    KJ_REQUIRE(nodes[i - 1].getId() < nodes[i].getId(),
+               "Schema bundle's nodes are not sorted by ID.", nodes[i].getId());
+  }
+}
+
+SchemaBundle::~SchemaBundle() noexcept(false) {}
+
+kj::Maybe<schema::Node::Reader> SchemaBundle::find(uint64_t id) const {
+  uint lower = 0;
+  uint upper = nodes.size();
+  while (lower < upper) {
+    uint mid = (lower + upper) / 2;
+    auto node = nodes[mid];
+    uint64_t midId = node.getId();
+    if (midId < id) {
+      lower = mid + 1;
+    } else if (midId > id) {
+      upper = mid;
+    } else {
+      return node;
+    }
+  }
+  return nullptr;
+}
+
+void SchemaBundle::load(const SchemaLoader& loader, uint64_t id) const {
+  KJ_IF_MAYBE(node, find(id)) {
+    loader.loadOnce(*node);
+  }
+}
+
+// -------------------------------------------------------------------
+
+namespace {
+
+void writeBundle(kj::OutputStream& output, kj::ArrayPtr<schema::Node::Reader> nodes,
+                 List<schema::CodeGeneratorRequest::RequestedFile>::Reader requestedFiles) {
+  std::sort(nodes.begin(), nodes.end(),
+      [](const schema::Node::Reader& a, const schema::Node::Reader& b) {
+    return a.getId() < b.getId();
+  });
+
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<schema::CodeGeneratorRequest>();
+  auto list = root.initNodes(nodes.size());
+  for (uint i = 0; i < nodes.size(); i++) {
+    KJ_REQUIRE(i == 0 || nodes[i - 1].getId() != nodes[i].getId(),
+               "Duplicate node ID in schema bundle.", nodes[i].getId());
+    list.setWithCaveats(i, nodes[i]);
+  }
+  root.setRequestedFiles(requestedFiles);
+
+  // One segment, so that readers can use the file in place.
+  builder.compact();
+  writeMessage(output, builder);
+}
+
+}  // namespace
+
+void writeSchemaBundle(kj::OutputStream& output, kj::ArrayPtr<const Schema> schemas) {
+  auto nodes = kj::heapArray<schema::Node::Reader>(schemas.size());
+  for (uint i = 0; i < schemas.size(); i++) {
+    nodes[i] = schemas[i].getProto();
+  }
+  writeBundle(output, nodes, List<schema::CodeGeneratorRequest::RequestedFile>::Reader());
+}
+
+void writeSchemaBundle(kj::OutputStream& output, schema::CodeGeneratorRequest::Reader request) {
+  auto nodes = kj::heapArray<schema::Node::Reader>(request.getNodes().size());
+  for (uint i = 0; i < nodes.size(); i++) {
+    nodes[i] = request.getNodes()[i];
+  }
+  writeBundle(output, nodes, request.getRequestedFiles());
+}
+
+}  // namespace capnp
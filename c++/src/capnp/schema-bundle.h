@@ -0,0 +1,89 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef CAPNP_SCHEMA_BUNDLE_H_
+#define CAPNP_SCHEMA_BUNDLE_H_
+
+#include "schema-loader.h"
+#include "message.h"
+#include <kj/io.h>
+
+namespace capnp {
+
+class SchemaBundle final: public SchemaLoader::LazyLoadCallback {
+  // A precompiled set of schema nodes, as written by `capnp compile -obundle` or
+  // writeSchemaBundle(), which lets a program skip parsing .capnp files at startup.
+  //
+  // A bundle file is an ordinary Cap'n Proto message (with the usual segment table) whose root is
+  // a `schema::CodeGeneratorRequest`.  Its `nodes` list holds every node, sorted by ID; the sorted
+  // list is the ID index, searched by binary search.  The writer always produces a single segment
+  // with no far pointers, so the message is read in place from the mapped file:  opening a bundle
+  // costs one validation pass over it, and since the pages are never written, every process
+  // mapping the same file shares them.
+  //
+  // Usually you hand the bundle to SchemaLoader::loadBundle(), which turns nodes into `Schema`s
+  // only as they are first requested.  A bundle can also be used directly as a `LazyLoadCallback`.
+  // All methods are thread-safe.
+
+public:
+  explicit SchemaBundle(kj::ArrayPtr<const word> data);
+  // Reads a bundle from memory that the caller keeps valid for the bundle's lifetime.
+
+  explicit SchemaBundle(int fd);
+  // mmap()s the whole file open on `fd`.  The fd is not retained and may be closed afterwards.
+
+  ~SchemaBundle() noexcept(false);
+  KJ_DISALLOW_COPY(SchemaBundle);
+
+  kj::Maybe<schema::Node::Reader> find(uint64_t id) const;
+  // Looks up a node by ID.  The reader points into the bundle.
+
+  inline List<schema::Node>::Reader getNodes() const { return nodes; }
+  // All nodes, in ID order.
+
+  inline List<schema::CodeGeneratorRequest::RequestedFile>::Reader getRequestedFiles() const {
+    return requestedFiles;
+  }
+  // The files named on the compiler's command line, if the bundle came from `capnp compile`.
+
+  void load(const SchemaLoader& loader, uint64_t id) const override;
+  // Calls `loader.loadOnce()` with the node `id`, if the bundle has it.
+
+private:
+  kj::Array<const word> mapping;
+  ValidatedMessage message;
+  List<schema::Node>::Reader nodes;
+  List<schema::CodeGeneratorRequest::RequestedFile>::Reader requestedFiles;
+
+  SchemaBundle(kj::Array<const word>&& mapping, kj::ArrayPtr<const word> data);
+};
+
+void writeSchemaBundle(kj::OutputStream& output, kj::ArrayPtr<const Schema> schemas);
+void writeSchemaBundle(kj::OutputStream& output, schema::CodeGeneratorRequest::Reader request);
+// Writes a bundle containing the given schemas' nodes, or the nodes and requested files of a
+// code generator request, sorted into the form SchemaBundle expects.
+
+}  // namespace capnp
+
+#endif  // CAPNP_SCHEMA_BUNDLE_H_
@@ -25,6 +25,7 @@
 #include <gtest/gtest.h>
 #include "test-util.h"
 #include <kj/debug.h>
+#include <kj/thread.h>
 
 namespace capnp {
 namespace _ {  // private
@@ -54,6 +55,17 @@ TEST(SchemaLoader, Load) {
 
   auto struct16Schema = testListsSchema.getDependency(typeId<test::TestLists::Struct16>());
   EXPECT_EQ(0u, struct16Schema.getProto().getStruct().getFields().size());
+
+  // Name lookups go through the hash table that the loader built.
+  auto loadedStruct = testListsSchema.asStruct();
+  for (auto field: nativeSchema.asStruct().getFields()) {
+    KJ_IF_MAYBE(found, loadedStruct.findFieldByName(field.getProto().getName())) {
+      EXPECT_EQ(field.getIndex(), found->getIndex());
+    } else {
+      ADD_FAILURE() << "Field not found: " << field.getProto().getName().cStr();
+    }
+  }
+  EXPECT_TRUE(loadedStruct.findFieldByName("noSuchField") == nullptr);
 }
 
 TEST(SchemaLoader, LoadLateUnion) {
@@ -209,6 +221,33 @@ TEST(SchemaLoader, Upgrade) {
   schema.requireUsableAs<test::TestOldVersion>();
 }
 
+TEST(SchemaLoader, UpgradeDynamicAccess) {
+  // Dynamic accessors cache field descriptors per schema.  Make sure they see the new fields after
+  // the loader upgrades the node.
+
+  SchemaLoader loader;
+  loader.loadCompiledTypeAndDependencies<test::TestOldVersion>();
+  StructSchema schema = loader.get(typeId<test::TestOldVersion>()).asStruct();
+
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<DynamicStruct>(schema);
+  root.set("old1", 123);
+  EXPECT_EQ(123, root.get("old1").as<int64_t>());
+  EXPECT_TRUE(schema.findFieldByName("new1") == nullptr);
+
+  loadUnderAlternateTypeId<test::TestNewVersion>(loader, typeId<test::TestOldVersion>());
+
+  auto reader = root.asReader();
+  EXPECT_EQ(123, reader.get("old1").as<int64_t>());
+  EXPECT_EQ(987, reader.get("new1").as<int64_t>());
+  EXPECT_EQ("baz", reader.get("new2").as<Text>());
+
+  // New roots are allocated at the upgraded size.
+  auto root2 = builder.initRoot<DynamicStruct>(schema);
+  root2.set("new1", 456);
+  EXPECT_EQ(456, root2.get("new1").as<int64_t>());
+}
+
 TEST(SchemaLoader, Downgrade) {
   SchemaLoader loader;
 
@@ -226,6 +265,51 @@ TEST(SchemaLoader, Downgrade) {
   schema.requireUsableAs<test::TestNewVersion>();
 }
 
+TEST(SchemaLoader, ConcurrentGet) {
+  // Lookups of loaded schemas don't take the lock.  Hammer them from another thread while this
+  // one keeps loading more schemas, forcing the lock-free table to grow a few times.
+
+  SchemaLoader loader;
+  loader.loadCompiledTypeAndDependencies<TestAllTypes>();
+  auto initial = loader.getAllLoaded();
+
+  uint mismatches = 0;
+  {
+    kj::Thread reader([&]() {
+      for (uint i = 0; i < 1000; i++) {
+        for (auto schema: initial) {
+          if (loader.get(schema.getProto().getId()) != schema) ++mismatches;
+        }
+      }
+    });
+
+    loader.loadCompiledTypeAndDependencies<TestDefaults>();
+    loader.loadCompiledTypeAndDependencies<TestUnion>();
+    loader.loadCompiledTypeAndDependencies<test::TestUnnamedUnion>();
+    loader.loadCompiledTypeAndDependencies<test::TestGroups>();
+    loader.loadCompiledTypeAndDependencies<test::TestInterleavedGroups>();
+    loader.loadCompiledTypeAndDependencies<TestUnionDefaults>();
+    loader.loadCompiledTypeAndDependencies<TestNestedTypes>();
+    loader.loadCompiledTypeAndDependencies<TestUsing>();
+    loader.loadCompiledTypeAndDependencies<test::TestLists>();
+    loader.loadCompiledTypeAndDependencies<TestListDefaults>();
+    loader.loadCompiledTypeAndDependencies<test::TestLateUnion>();
+    loader.loadCompiledTypeAndDependencies<test::TestNewVersion>();
+    loader.loadCompiledTypeAndDependencies<test::TestStructUnion>();
+    loader.loadCompiledTypeAndDependencies<test::TestPrintInlineStructs>();
+    loader.loadCompiledTypeAndDependencies<test::TestInterface>();
+    loader.loadCompiledTypeAndDependencies<test::TestPipeline>();
+    loader.loadCompiledTypeAndDependencies<test::TestMoreStuff>();
+  }
+
+  EXPECT_EQ(0u, mismatches);
+  auto all = loader.getAllLoaded();
+  EXPECT_GT(all.size(), 32u);
+  for (auto schema: all) {
+    EXPECT_TRUE(loader.get(schema.getProto().getId()) == schema);
+  }
+}
+
 TEST(SchemaLoader, Incompatible) {
   SchemaLoader loader;
   loader.loadCompiledTypeAndDependencies<test::TestListDefaults>();
@@ -23,6 +23,7 @@
 
 #define CAPNP_PRIVATE
 #include "schema-loader.h"
+#include "schema-bundle.h"
 #include <unordered_map>
 #include <map>
 #include "message.h"
@@ -32,6 +33,8 @@
 #include <kj/arena.h>
 #include <kj/vector.h>
 #include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace capnp {
 
@@ -45,7 +48,12 @@ public:
   inline InitializerImpl(const SchemaLoader& loader, const LazyLoadCallback& callback)
       : loader(loader), callback(callback) {}
 
-  inline kj::Maybe<const LazyLoadCallback&> getCallback() const { return callback; }
+  inline bool hasLazySources() const { return callback != nullptr || bundles.size() > 0; }
+
+  void loadLazily(uint64_t id) const;
+  // Asks the bundles, then the callback, to load the node with the given ID.
+
+  inline void addBundle(kj::Own<const SchemaBundle>&& bundle) { bundles.add(kj::mv(bundle)); }
 
   void init(const _::RawSchema* schema) const override;
 
@@ -54,6 +62,7 @@ public:
 private:
   const SchemaLoader& loader;
   kj::Maybe<const LazyLoadCallback&> callback;
+  kj::Vector<kj::Own<const SchemaBundle>> bundles;
 };
 
 class SchemaLoader::Impl {
@@ -61,6 +70,11 @@ public:
   inline explicit Impl(const SchemaLoader& loader): initializer(loader) {}
   inline Impl(const SchemaLoader& loader, const LazyLoadCallback& callback)
       : initializer(loader, callback) {}
+  ~Impl() {
+    for (auto& schema: schemas) {
+      _::destroyStructLayout(schema.second->structLayout);
+    }
+  }
 
   _::RawSchema* load(const schema::Node::Reader& reader, bool isPlaceholder);
 
@@ -72,12 +86,22 @@ public:
 
   struct TryGetResult {
     _::RawSchema* schema;
-    kj::Maybe<const LazyLoadCallback&> callback;
+    kj::Maybe<const InitializerImpl&> lazyLoader;
+    // Set if there is somewhere to load missing schemas from.
   };
 
   TryGetResult tryGet(uint64_t typeId) const;
   kj::Array<Schema> getAllLoaded() const;
 
+  inline void addBundle(kj::Own<const SchemaBundle>&& bundle) {
+    initializer.addBundle(kj::mv(bundle));
+  }
+
+  const _::RawSchema* tryGetPublished(uint64_t typeId) const;
+  // Look up a schema without holding the lock.  Returns null if the ID isn't found, in which case
+  // the caller must fall back to tryGet() under the lock, since a concurrent load() may not have
+  // published the schema yet.  The result may be a placeholder (check lazyInitializer).
+
   void requireStructSize(uint64_t id, uint dataWordCount, uint pointerCount,
                          schema::ElementSize preferredListEncoding);
   // Require any struct nodes loaded with this ID -- in the past and in the future -- to have at
@@ -100,6 +124,29 @@ private:
 
   InitializerImpl initializer;
 
+  struct PublishedEntry {
+    uint64_t id;
+    const _::RawSchema* schema;  // Null if the entry is empty.  Stored last, with release.
+  };
+  struct PublishedTable {
+    uint mask;
+    kj::Array<PublishedEntry> entries;
+  };
+
+  PublishedTable* published = nullptr;
+  // A copy of `schemas` as an insert-only open-addressed hash table, for readers that don't take
+  // the lock.  Read with acquire; replaced with a bigger copy as it fills up.
+
+  kj::Vector<kj::Own<PublishedTable>> publishedTables;
+  // All tables ever published.  Replaced ones stay alive because readers may still be probing
+  // them.  (They will just miss newer entries and fall back to the locked path.)
+
+  uint publishedCount = 0;
+
+  void publish(const _::RawSchema* schema);
+  // Add `schema` to the published table, if it isn't there already.  Must be called with the
+  // lock held exclusively, after `schema` is fully initialized (or marked as a placeholder).
+
   kj::ArrayPtr<word> makeUncheckedNode(schema::Node::Reader node);
   // Construct a copy of the given schema node, allocated as a single-segment ("unchecked") node
   // within the loader's arena.
@@ -192,12 +239,41 @@ public:
     return membersByDiscriminant.begin();
   }
 
+  const uint16_t* makeMemberHash() {
+    auto keys = kj::heapArrayBuilder<uint64_t>(members.size());
+    auto values = kj::heapArrayBuilder<uint16_t>(members.size());
+    for (auto& member: members) {
+      keys.add(_::hashMemberName(member.first));
+      values.add(member.second);
+    }
+    return copyHashTable(_::buildPerfectHash(keys.finish(), values.finish()));
+  }
+
+  const uint16_t* makeDependencyHash() {
+    auto keys = kj::heapArrayBuilder<uint64_t>(dependencies.size());
+    auto values = kj::heapArrayBuilder<uint16_t>(dependencies.size());
+    for (auto& dep: dependencies) {
+      values.add(keys.size());
+      keys.add(dep.first);
+    }
+    return copyHashTable(_::buildPerfectHash(keys.finish(), values.finish()));
+  }
+
 private:
   SchemaLoader::Impl& loader;
   Text::Reader nodeName;
   bool isValid;
   std::map<uint64_t, _::RawSchema*> dependencies;
 
+  const uint16_t* copyHashTable(kj::Array<uint16_t> table) {
+    if (table.size() == 0) {
+      return nullptr;
+    }
+    kj::ArrayPtr<uint16_t> result = loader.arena.allocateArray<uint16_t>(table.size());
+    memcpy(result.begin(), table.begin(), table.size() * sizeof(uint16_t));
+    return result.begin();
+  }
+
   // Maps name -> index for each member.
   std::map<Text::Reader, uint> members;
 
@@ -1150,6 +1226,7 @@ _::RawSchema* SchemaLoader::Impl::load(const schema::Node::Reader& reader, bool
     slot = &arena.allocate<_::RawSchema>();
     slot->id = validatedReader.getId();
     slot->canCastTo = nullptr;
+    slot->structLayout = nullptr;
     shouldReplace = true;
   } else {
     // Yes, check if it is compatible and figure out which schema is newer.
@@ -1176,6 +1253,8 @@ _::RawSchema* SchemaLoader::Impl::load(const schema::Node::Reader& reader, bool
     slot->dependencies = validator.makeDependencyArray(&slot->dependencyCount);
     slot->membersByName = validator.makeMemberInfoArray(&slot->memberCount);
     slot->membersByDiscriminant = validator.makeMembersByDiscriminantArray();
+    slot->memberHash = validator.makeMemberHash();
+    slot->dependencyHash = validator.makeDependencyHash();
   }
 
   if (isPlaceholder) {
@@ -1187,6 +1266,7 @@ _::RawSchema* SchemaLoader::Impl::load(const schema::Node::Reader& reader, bool
     __atomic_store_n(&slot->lazyInitializer, nullptr, __ATOMIC_RELEASE);
   }
 
+  publish(slot);
   return slot;
 }
 
@@ -1195,6 +1275,7 @@ _::RawSchema* SchemaLoader::Impl::loadNative(const _::RawSchema* nativeSchema) {
   bool shouldReplace;
   if (slot == nullptr) {
     slot = &arena.allocate<_::RawSchema>();
+    slot->structLayout = nullptr;
     shouldReplace = true;
   } else if (slot->canCastTo != nullptr) {
     // Already loaded natively, or we're currently in the process of loading natively and there
@@ -1221,6 +1302,7 @@ _::RawSchema* SchemaLoader::Impl::loadNative(const _::RawSchema* nativeSchema) {
     // yet.
     _::RawSchema temp = *nativeSchema;
     temp.lazyInitializer = result->lazyInitializer;
+    temp.structLayout = result->structLayout;  // Ours, not the native schema's.
     *result = temp;
 
     // Indicate that casting is safe.  Note that it's important to set this before recursively
@@ -1260,6 +1342,7 @@ _::RawSchema* SchemaLoader::Impl::loadNative(const _::RawSchema* nativeSchema) {
   // a release-store here.
   __atomic_store_n(&result->lazyInitializer, nullptr, __ATOMIC_RELEASE);
 
+  publish(result);
   return result;
 }
 
@@ -1287,11 +1370,79 @@ _::RawSchema* SchemaLoader::Impl::loadEmpty(
 }
 
 SchemaLoader::Impl::TryGetResult SchemaLoader::Impl::tryGet(uint64_t typeId) const {
+  kj::Maybe<const InitializerImpl&> lazyLoader;
+  if (initializer.hasLazySources()) lazyLoader = initializer;
+
   auto iter = schemas.find(typeId);
   if (iter == schemas.end()) {
-    return {nullptr, initializer.getCallback()};
+    return {nullptr, lazyLoader};
   } else {
-    return {iter->second, initializer.getCallback()};
+    return {iter->second, lazyLoader};
+  }
+}
+
+namespace {
+
+inline uint hashTypeId(uint64_t id) {
+  // Type IDs are random, but mix anyway in case someone assigned them sequentially.
+  return static_cast<uint>((id * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+}  // namespace
+
+const _::RawSchema* SchemaLoader::Impl::tryGetPublished(uint64_t typeId) const {
+  const PublishedTable* table = __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+  if (table == nullptr) return nullptr;
+
+  // The table is never more than half full, so this terminates.
+  for (uint i = hashTypeId(typeId) & table->mask;; i = (i + 1) & table->mask) {
+    const PublishedEntry& entry = table->entries[i];
+    const _::RawSchema* schema = __atomic_load_n(&entry.schema, __ATOMIC_ACQUIRE);
+    if (schema == nullptr) return nullptr;
+    if (entry.id == typeId) return schema;
+  }
+}
+
+void SchemaLoader::Impl::publish(const _::RawSchema* schema) {
+  PublishedTable* table = published;
+
+  if (table == nullptr || (publishedCount + 1) * 2 > table->entries.size()) {
+    // Grow by copying into a new table, then swap it in.  Nobody can see the new table until
+    // the release-store, so it can be filled with plain stores.
+    auto newTable = kj::heap<PublishedTable>();
+    uint capacity = table == nullptr ? 64 : table->entries.size() * 2;
+    newTable->mask = capacity - 1;
+    newTable->entries = kj::heapArray<PublishedEntry>(capacity);
+    for (auto& entry: newTable->entries) {
+      entry.id = 0;
+      entry.schema = nullptr;
+    }
+    if (table != nullptr) {
+      for (auto& entry: table->entries) {
+        if (entry.schema == nullptr) continue;
+        uint i = hashTypeId(entry.id) & newTable->mask;
+        while (newTable->entries[i].schema != nullptr) i = (i + 1) & newTable->mask;
+        newTable->entries[i] = entry;
+      }
+    }
+
+    __atomic_store_n(&published, newTable.get(), __ATOMIC_RELEASE);
+    table = newTable.get();
+    publishedTables.add(kj::mv(newTable));
+  }
+
+  for (uint i = hashTypeId(schema->id) & table->mask;; i = (i + 1) & table->mask) {
+    PublishedEntry& entry = table->entries[i];
+    if (entry.schema == nullptr) {
+      entry.id = schema->id;
+      __atomic_store_n(&entry.schema, schema, __ATOMIC_RELEASE);
+      ++publishedCount;
+      return;
+    } else if (entry.id == schema->id) {
+      // Already published.  The RawSchema for a given ID never moves, so there's nothing to do.
+      KJ_DASSERT(entry.schema == schema);
+      return;
+    }
   }
 }
 
@@ -1396,10 +1547,21 @@ void SchemaLoader::Impl::applyStructSizeRequirement(
   }
 }
 
-void SchemaLoader::InitializerImpl::init(const _::RawSchema* schema) const {
+void SchemaLoader::InitializerImpl::loadLazily(uint64_t id) const {
+  for (auto& bundle: bundles) {
+    KJ_IF_MAYBE(node, bundle->find(id)) {
+      loader.loadOnce(*node);
+      return;
+    }
+  }
+
   KJ_IF_MAYBE(c, callback) {
-    c->load(loader, schema->id);
+    c->load(loader, id);
   }
+}
+
+void SchemaLoader::InitializerImpl::init(const _::RawSchema* schema) const {
+  loadLazily(schema->id);
 
   if (schema->lazyInitializer != nullptr) {
     // The callback declined to load a schema.  We need to disable the initializer so that it
@@ -1435,10 +1597,17 @@ Schema SchemaLoader::get(uint64_t id) const {
 }
 
 kj::Maybe<Schema> SchemaLoader::tryGet(uint64_t id) const {
+  // Fast path:  once a schema is loaded and initialized, it can be found without locking.
+  const _::RawSchema* published = impl.getWithoutLock()->tryGetPublished(id);
+  if (published != nullptr &&
+      __atomic_load_n(&published->lazyInitializer, __ATOMIC_ACQUIRE) == nullptr) {
+    return Schema(published);
+  }
+
   auto getResult = impl.lockShared()->get()->tryGet(id);
   if (getResult.schema == nullptr || getResult.schema->lazyInitializer != nullptr) {
-    KJ_IF_MAYBE(c, getResult.callback) {
-      c->load(*this, id);
+    KJ_IF_MAYBE(l, getResult.lazyLoader) {
+      l->loadLazily(id);
     }
     getResult = impl.lockShared()->get()->tryGet(id);
   }
@@ -1465,6 +1634,17 @@ Schema SchemaLoader::loadOnce(const schema::Node::Reader& reader) const {
   }
 }
 
+void SchemaLoader::loadBundle(kj::Own<const SchemaBundle>&& bundle) {
+  impl.lockExclusive()->get()->addBundle(kj::mv(bundle));
+}
+
+void SchemaLoader::loadBundle(kj::StringPtr path) {
+  int fd;
+  KJ_SYSCALL(fd = open(path.cStr(), O_RDONLY | O_CLOEXEC), path);
+  kj::AutoCloseFd closer(fd);
+  loadBundle(kj::heap<SchemaBundle>(fd));
+}
+
 kj::Array<Schema> SchemaLoader::getAllLoaded() const {
   return impl.lockShared()->get()->getAllLoaded();
 }
@@ -30,6 +30,8 @@
 
 namespace capnp {
 
+class SchemaBundle;
+
 class SchemaLoader {
   // Class which can be used to construct Schema objects from schema::Nodes as defined in
   // schema.capnp.
@@ -72,6 +74,9 @@ public:
   //
   // The returned schema may be invalidated if load() is called with a new schema for the same ID.
   // In general, you should not call load() while a schema from this loader is in-use.
+  //
+  // Once a schema is loaded (and, if lazy, initialized), looking it up takes no lock, so any
+  // number of threads can call get() concurrently without contending.
 
   kj::Maybe<Schema> tryGet(uint64_t id) const;
   // Like get() but doesn't throw.
@@ -126,6 +131,17 @@ public:
   // type using as<T>(), you must call this method before constructing the DynamicValue.  Otherwise,
   // as<T>() will throw an exception complaining about type mismatch.
 
+  void loadBundle(kj::Own<const SchemaBundle>&& bundle);
+  void loadBundle(kj::StringPtr path);
+  // Makes the nodes of a precompiled schema bundle (see schema-bundle.h) available to get() and
+  // tryGet(), without loading any of them yet.  Each node is validated and copied out of the
+  // bundle the first time it, or a schema depending on it, is requested, so a program with
+  // thousands of schemas only pays for the ones it touches.  The second form mmap()s the file at
+  // `path`.
+  //
+  // Bundles are searched in the order they were added, before any LazyLoadCallback.  Like
+  // load(), this must not be called while other threads are using the loader.
+
   kj::Array<Schema> getAllLoaded() const;
   // Get a complete list of all loaded schema nodes.  It is particularly useful to call this after
   // loadCompiledTypeAndDependencies<T>() in order to get a flat list of all of T's transitive
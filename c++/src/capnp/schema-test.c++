@@ -94,6 +94,48 @@ TEST(Schema, FieldLookupOutOfOrder) {
   EXPECT_EQ(5, schema.getFieldByName("waldo").getProto().getOrdinal().getExplicit());
 }
 
+TEST(Schema, FieldLookupEveryMember) {
+  auto structSchema = Schema::from<TestAllTypes>();
+  for (auto field: structSchema.getFields()) {
+    KJ_IF_MAYBE(found, structSchema.findFieldByName(field.getProto().getName())) {
+      EXPECT_EQ(field.getIndex(), found->getIndex());
+    } else {
+      ADD_FAILURE() << "Field not found: " << field.getProto().getName().cStr();
+    }
+  }
+  EXPECT_TRUE(structSchema.findFieldByName("int32") == nullptr);
+  EXPECT_TRUE(structSchema.findFieldByName("int32Field2") == nullptr);
+
+  auto enumSchema = Schema::from<TestEnum>();
+  for (auto enumerant: enumSchema.getEnumerants()) {
+    KJ_IF_MAYBE(found, enumSchema.findEnumerantByName(enumerant.getProto().getName())) {
+      EXPECT_EQ(enumerant.getOrdinal(), found->getOrdinal());
+    } else {
+      ADD_FAILURE() << "Enumerant not found: " << enumerant.getProto().getName().cStr();
+    }
+  }
+}
+
+TEST(Schema, PerfectHash) {
+  constexpr uint COUNT = 10000;
+  auto keys = KJ_MAP(i, kj::range<uint>(0, COUNT)) {
+    return hashMemberName(kj::str("member", i));
+  };
+  auto values = KJ_MAP(i, kj::range<uint>(0, COUNT)) { return static_cast<uint16_t>(i * 3); };
+
+  auto table = buildPerfectHash(keys, values);
+  ASSERT_NE(0u, table.size());
+
+  for (uint i = 0; i < COUNT; i++) {
+    EXPECT_EQ(i * 3, perfectHashLookup(table.begin(), keys[i]));
+  }
+
+  // Duplicate keys can't be placed.
+  uint64_t duplicates[2] = { 123, 123 };
+  uint16_t duplicateValues[2] = { 0, 1 };
+  EXPECT_EQ(0u, buildPerfectHash(duplicates, duplicateValues).size());
+}
+
 TEST(Schema, Unions) {
   auto schema = Schema::from<TestUnion>().asStruct();
 
@@ -24,6 +24,8 @@
 #include "schema.h"
 #include "message.h"
 #include <kj/debug.h>
+#include <kj/vector.h>
+#include <algorithm>
 
 namespace capnp {
 
@@ -85,7 +87,7 @@ static const AlignedData<13> NULL_SCHEMA_BYTES = {{
 }};
 const RawSchema NULL_SCHEMA = {
   0x0000000000000000, NULL_SCHEMA_BYTES.words, 13,
-  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr
+  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
 };
 
 static const AlignedData<14> NULL_STRUCT_SCHEMA_BYTES = {{
@@ -106,7 +108,7 @@ static const AlignedData<14> NULL_STRUCT_SCHEMA_BYTES = {{
 }};
 const RawSchema NULL_STRUCT_SCHEMA = {
   0x0000000000000001, NULL_STRUCT_SCHEMA_BYTES.words, 14,
-  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr
+  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
 };
 
 static const AlignedData<14> NULL_ENUM_SCHEMA_BYTES = {{
@@ -127,7 +129,7 @@ static const AlignedData<14> NULL_ENUM_SCHEMA_BYTES = {{
 }};
 const RawSchema NULL_ENUM_SCHEMA = {
   0x0000000000000002, NULL_ENUM_SCHEMA_BYTES.words, 14,
-  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr
+  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
 };
 
 static const AlignedData<14> NULL_INTERFACE_SCHEMA_BYTES = {{
@@ -148,7 +150,7 @@ static const AlignedData<14> NULL_INTERFACE_SCHEMA_BYTES = {{
 }};
 const RawSchema NULL_INTERFACE_SCHEMA = {
   0x0000000000000003, NULL_INTERFACE_SCHEMA_BYTES.words, 14,
-  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr
+  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
 };
 
 static const AlignedData<20> NULL_CONST_SCHEMA_BYTES = {{
@@ -175,9 +177,151 @@ static const AlignedData<20> NULL_CONST_SCHEMA_BYTES = {{
 }};
 const RawSchema NULL_CONST_SCHEMA = {
   0x0000000000000004, NULL_CONST_SCHEMA_BYTES.words, 20,
-  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr
+  nullptr, nullptr, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
 };
 
+// -------------------------------------------------------------------
+// Perfect hashing
+//
+// This is "hash and displace":  keys are first hashed into B buckets, then each bucket gets a
+// displacement chosen so that, hashed again with that displacement, all of its keys land in
+// distinct free slots out of M.  A lookup is therefore two hashes and two table reads, and never
+// probes.
+
+namespace {
+
+static constexpr uint16_t EMPTY_SLOT = 0xffff;
+
+inline uint64_t mixHash(uint64_t k) {
+  // MurmurHash3's 64-bit finalizer.
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+inline uint perfectHashBucket(uint64_t key, uint bucketCount) {
+  return mixHash(key) % bucketCount;
+}
+
+inline uint perfectHashSlot(uint64_t key, uint displacement, uint slotCount) {
+  return mixHash(key + (displacement + 1) * 0x9e3779b97f4a7c15ull) % slotCount;
+}
+
+}  // namespace
+
+uint64_t hashMemberName(kj::StringPtr name) {
+  // FNV-1a.
+  uint64_t result = 0xcbf29ce484222325ull;
+  for (char c: name) {
+    result = (result ^ static_cast<byte>(c)) * 0x100000001b3ull;
+  }
+  return result;
+}
+
+kj::Array<uint16_t> buildPerfectHash(kj::ArrayPtr<const uint64_t> keys,
+                                     kj::ArrayPtr<const uint16_t> values) {
+  KJ_REQUIRE(keys.size() == values.size());
+
+  uint keyCount = keys.size();
+  if (keyCount == 0 || keyCount > 40000) {
+    // Too many to fit the slot count in 16 bits.
+    return nullptr;
+  }
+
+  {
+    // Duplicate keys could never be placed, so check for them up front.
+    auto sortedKeys = KJ_MAP(key, keys) { return key; };
+    std::sort(sortedKeys.begin(), sortedKeys.end());
+    if (std::adjacent_find(sortedKeys.begin(), sortedKeys.end()) != sortedKeys.end()) {
+      return nullptr;
+    }
+  }
+
+  uint bucketCount = keyCount / 4 + 1;
+
+  // Sort the keys by bucket, biggest buckets first, so that the hardest buckets are placed while
+  // there is the most room.
+  auto bucketOf = KJ_MAP(key, keys) { return perfectHashBucket(key, bucketCount); };
+  auto bucketSizes = kj::heapArray<uint>(bucketCount);
+  memset(bucketSizes.begin(), 0, bucketSizes.size() * sizeof(uint));
+  for (uint bucket: bucketOf) {
+    ++bucketSizes[bucket];
+  }
+  auto order = KJ_MAP(i, kj::range<uint>(0, keyCount)) { return i; };
+  std::sort(order.begin(), order.end(), [&](uint a, uint b) {
+    uint bucketA = bucketOf[a], bucketB = bucketOf[b];
+    if (bucketSizes[bucketA] != bucketSizes[bucketB]) {
+      return bucketSizes[bucketA] > bucketSizes[bucketB];
+    }
+    return bucketA < bucketB;
+  });
+
+  kj::Vector<uint> placed;
+
+  // Try a table with 25% slack first, and give it more room if some bucket can't be placed.
+  uint slotCount = keyCount + keyCount / 4 + 1;
+  for (uint attempt = 0; attempt < 8 && slotCount < EMPTY_SLOT;
+       attempt++, slotCount += keyCount / 4 + 1) {
+    auto table = kj::heapArray<uint16_t>(2 + bucketCount + slotCount);
+    table[0] = bucketCount;
+    table[1] = slotCount;
+    uint16_t* displacements = table.begin() + 2;
+    uint16_t* slots = displacements + bucketCount;
+    memset(displacements, 0, bucketCount * sizeof(uint16_t));
+    for (uint i = 0; i < slotCount; i++) {
+      slots[i] = EMPTY_SLOT;
+    }
+
+    bool success = true;
+    for (uint start = 0; start < keyCount && success;) {
+      uint bucket = bucketOf[order[start]];
+      uint end = start + bucketSizes[bucket];
+
+      success = false;
+      for (uint displacement = 0; displacement < EMPTY_SLOT; displacement++) {
+        placed.resize(0);
+        for (uint i = start; i < end; i++) {
+          uint slot = perfectHashSlot(keys[order[i]], displacement, slotCount);
+          if (slots[slot] != EMPTY_SLOT) break;
+          slots[slot] = values[order[i]];
+          placed.add(slot);
+        }
+
+        if (placed.size() == end - start) {
+          displacements[bucket] = displacement;
+          success = true;
+          break;
+        }
+
+        // Undo the partial placement and try the next displacement.
+        for (uint slot: placed) {
+          slots[slot] = EMPTY_SLOT;
+        }
+      }
+
+      start = end;
+    }
+
+    if (success) {
+      return kj::mv(table);
+    }
+  }
+
+  return nullptr;
+}
+
+uint perfectHashLookup(const uint16_t* table, uint64_t key) {
+  uint bucketCount = table[0];
+  uint slotCount = table[1];
+  const uint16_t* displacements = table + 2;
+  const uint16_t* slots = displacements + bucketCount;
+  return slots[perfectHashSlot(key, displacements[perfectHashBucket(key, bucketCount)],
+                               slotCount)];
+}
+
 }  // namespace _ (private)
 
 // =======================================================================================
@@ -191,6 +335,17 @@ kj::ArrayPtr<const word> Schema::asUncheckedMessage() const {
 }
 
 Schema Schema::getDependency(uint64_t id) const {
+  if (raw->dependencyHash != nullptr) {
+    uint index = _::perfectHashLookup(raw->dependencyHash, id);
+    if (index < raw->dependencyCount && raw->dependencies[index]->id == id) {
+      const _::RawSchema* result = raw->dependencies[index];
+      result->ensureInitialized();
+      return Schema(result);
+    }
+    KJ_FAIL_REQUIRE("Requested ID not found in dependency table.", kj::hex(id));
+    return Schema();
+  }
+
   uint lower = 0;
   uint upper = raw->dependencyCount;
 
@@ -291,6 +446,17 @@ namespace {
 template <typename List>
 auto findSchemaMemberByName(const _::RawSchema* raw, kj::StringPtr name, List&& list)
     -> kj::Maybe<decltype(list[0])> {
+  if (raw->memberHash != nullptr) {
+    uint index = _::perfectHashLookup(raw->memberHash, _::hashMemberName(name));
+    if (index < list.size()) {
+      auto candidate = list[index];
+      if (candidate.getProto().getName() == name) {
+        return candidate;
+      }
+    }
+    return nullptr;
+  }
+
   uint lower = 0;
   uint upper = raw->memberCount;
   List unnamedUnionMembers;
@@ -189,9 +189,12 @@ static const ::capnp::_::RawSchema* const d_e682ab4cf923a417[] = {
 };
 static const uint16_t m_e682ab4cf923a417[] = {11, 5, 10, 1, 2, 8, 6, 0, 9, 4, 3, 7};
 static const uint16_t i_e682ab4cf923a417[] = {6, 7, 8, 9, 10, 11, 0, 1, 2, 3, 4, 5};
+static const uint16_t mh_e682ab4cf923a417[] = {4, 16, 0, 1, 3, 11, 65535, 65535, 5, 65535, 3, 9, 8, 1, 65535, 4, 10, 11, 2, 7, 6, 0};
+static const uint16_t dh_e682ab4cf923a417[] = {2, 9, 1, 0, 1, 5, 0, 3, 65535, 2, 4, 6, 65535};
 const ::capnp::_::RawSchema s_e682ab4cf923a417 = {
   0xe682ab4cf923a417, b_e682ab4cf923a417.words, 171, d_e682ab4cf923a417, m_e682ab4cf923a417,
-  7, 12, i_e682ab4cf923a417, nullptr, nullptr
+  7, 12, i_e682ab4cf923a417, nullptr, nullptr,
+  mh_e682ab4cf923a417, dh_e682ab4cf923a417, nullptr
 };
 static const ::capnp::_::AlignedData<46> b_debf55bbfa0fc242 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -243,9 +246,11 @@ static const ::capnp::_::AlignedData<46> b_debf55bbfa0fc242 = {
 };
 static const uint16_t m_debf55bbfa0fc242[] = {1, 0};
 static const uint16_t i_debf55bbfa0fc242[] = {0, 1};
+static const uint16_t mh_debf55bbfa0fc242[] = {1, 3, 3, 65535, 1, 0};
 const ::capnp::_::RawSchema s_debf55bbfa0fc242 = {
   0xdebf55bbfa0fc242, b_debf55bbfa0fc242.words, 46, nullptr, m_debf55bbfa0fc242,
-  0, 2, i_debf55bbfa0fc242, nullptr, nullptr
+  0, 2, i_debf55bbfa0fc242, nullptr, nullptr,
+  mh_debf55bbfa0fc242, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<125> b_9ea0b19b37fb4435 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -381,9 +386,12 @@ static const ::capnp::_::RawSchema* const d_9ea0b19b37fb4435[] = {
 };
 static const uint16_t m_9ea0b19b37fb4435[] = {0, 4, 5, 6, 3, 1, 2};
 static const uint16_t i_9ea0b19b37fb4435[] = {0, 1, 2, 3, 4, 5, 6};
+static const uint16_t mh_9ea0b19b37fb4435[] = {2, 9, 1, 7, 2, 65535, 0, 3, 4, 6, 65535, 1, 5};
+static const uint16_t dh_9ea0b19b37fb4435[] = {1, 4, 0, 65535, 1, 2, 0};
 const ::capnp::_::RawSchema s_9ea0b19b37fb4435 = {
   0x9ea0b19b37fb4435, b_9ea0b19b37fb4435.words, 125, d_9ea0b19b37fb4435, m_9ea0b19b37fb4435,
-  3, 7, i_9ea0b19b37fb4435, nullptr, nullptr
+  3, 7, i_9ea0b19b37fb4435, nullptr, nullptr,
+  mh_9ea0b19b37fb4435, dh_9ea0b19b37fb4435, nullptr
 };
 static const ::capnp::_::AlignedData<34> b_b54ab3364333f598 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -427,9 +435,12 @@ static const ::capnp::_::RawSchema* const d_b54ab3364333f598[] = {
 };
 static const uint16_t m_b54ab3364333f598[] = {0};
 static const uint16_t i_b54ab3364333f598[] = {0};
+static const uint16_t mh_b54ab3364333f598[] = {1, 2, 0, 65535, 0};
+static const uint16_t dh_b54ab3364333f598[] = {1, 3, 0, 1, 65535, 0};
 const ::capnp::_::RawSchema s_b54ab3364333f598 = {
   0xb54ab3364333f598, b_b54ab3364333f598.words, 34, d_b54ab3364333f598, m_b54ab3364333f598,
-  2, 1, i_b54ab3364333f598, nullptr, nullptr
+  2, 1, i_b54ab3364333f598, nullptr, nullptr,
+  mh_b54ab3364333f598, dh_b54ab3364333f598, nullptr
 };
 static const ::capnp::_::AlignedData<51> b_e82753cff0c2218f = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -490,9 +501,12 @@ static const ::capnp::_::RawSchema* const d_e82753cff0c2218f[] = {
 };
 static const uint16_t m_e82753cff0c2218f[] = {1, 0};
 static const uint16_t i_e82753cff0c2218f[] = {0, 1};
+static const uint16_t mh_e82753cff0c2218f[] = {1, 3, 0, 0, 65535, 1};
+static const uint16_t dh_e82753cff0c2218f[] = {1, 3, 0, 1, 65535, 0};
 const ::capnp::_::RawSchema s_e82753cff0c2218f = {
   0xe82753cff0c2218f, b_e82753cff0c2218f.words, 51, d_e82753cff0c2218f, m_e82753cff0c2218f,
-  2, 2, i_e82753cff0c2218f, nullptr, nullptr
+  2, 2, i_e82753cff0c2218f, nullptr, nullptr,
+  mh_e82753cff0c2218f, dh_e82753cff0c2218f, nullptr
 };
 static const ::capnp::_::AlignedData<44> b_b18aa5ac7a0d9420 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -547,9 +561,12 @@ static const ::capnp::_::RawSchema* const d_b18aa5ac7a0d9420[] = {
 };
 static const uint16_t m_b18aa5ac7a0d9420[] = {0, 1};
 static const uint16_t i_b18aa5ac7a0d9420[] = {0, 1};
+static const uint16_t mh_b18aa5ac7a0d9420[] = {1, 3, 0, 65535, 0, 1};
+static const uint16_t dh_b18aa5ac7a0d9420[] = {1, 4, 1, 0, 65535, 1, 2};
 const ::capnp::_::RawSchema s_b18aa5ac7a0d9420 = {
   0xb18aa5ac7a0d9420, b_b18aa5ac7a0d9420.words, 44, d_b18aa5ac7a0d9420, m_b18aa5ac7a0d9420,
-  3, 2, i_b18aa5ac7a0d9420, nullptr, nullptr
+  3, 2, i_b18aa5ac7a0d9420, nullptr, nullptr,
+  mh_b18aa5ac7a0d9420, dh_b18aa5ac7a0d9420, nullptr
 };
 static const ::capnp::_::AlignedData<214> b_ec1619d4400a0290 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -773,9 +790,12 @@ static const ::capnp::_::RawSchema* const d_ec1619d4400a0290[] = {
 };
 static const uint16_t m_ec1619d4400a0290[] = {12, 2, 3, 4, 6, 1, 8, 9, 10, 11, 5, 7, 0};
 static const uint16_t i_ec1619d4400a0290[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+static const uint16_t mh_ec1619d4400a0290[] = {4, 17, 2, 1, 0, 1, 65535, 4, 65535, 11, 1, 8, 3, 12, 65535, 9, 6, 65535, 2, 7, 0, 5, 10};
+static const uint16_t dh_ec1619d4400a0290[] = {1, 3, 1, 65535, 1, 0};
 const ::capnp::_::RawSchema s_ec1619d4400a0290 = {
   0xec1619d4400a0290, b_ec1619d4400a0290.words, 214, d_ec1619d4400a0290, m_ec1619d4400a0290,
-  2, 13, i_ec1619d4400a0290, nullptr, nullptr
+  2, 13, i_ec1619d4400a0290, nullptr, nullptr,
+  mh_ec1619d4400a0290, dh_ec1619d4400a0290, nullptr
 };
 static const ::capnp::_::AlignedData<108> b_9aad50a41f4af45f = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -895,9 +915,12 @@ static const ::capnp::_::RawSchema* const d_9aad50a41f4af45f[] = {
 };
 static const uint16_t m_9aad50a41f4af45f[] = {2, 1, 3, 5, 0, 6, 4};
 static const uint16_t i_9aad50a41f4af45f[] = {4, 5, 0, 1, 2, 3, 6};
+static const uint16_t mh_9aad50a41f4af45f[] = {2, 9, 3, 1, 5, 0, 2, 65535, 6, 1, 65535, 4, 3};
+static const uint16_t dh_9aad50a41f4af45f[] = {2, 6, 12, 0, 2, 3, 65535, 0, 1, 65535};
 const ::capnp::_::RawSchema s_9aad50a41f4af45f = {
   0x9aad50a41f4af45f, b_9aad50a41f4af45f.words, 108, d_9aad50a41f4af45f, m_9aad50a41f4af45f,
-  4, 7, i_9aad50a41f4af45f, nullptr, nullptr
+  4, 7, i_9aad50a41f4af45f, nullptr, nullptr,
+  mh_9aad50a41f4af45f, dh_9aad50a41f4af45f, nullptr
 };
 static const ::capnp::_::AlignedData<23> b_97b14cbe7cfec712 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -926,7 +949,8 @@ static const ::capnp::_::AlignedData<23> b_97b14cbe7cfec712 = {
 };
 const ::capnp::_::RawSchema s_97b14cbe7cfec712 = {
   0x97b14cbe7cfec712, b_97b14cbe7cfec712.words, 23, nullptr, nullptr,
-  0, 0, nullptr, nullptr, nullptr
+  0, 0, nullptr, nullptr, nullptr,
+  nullptr, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<75> b_c42305476bb4746f = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1012,9 +1036,12 @@ static const ::capnp::_::RawSchema* const d_c42305476bb4746f[] = {
 };
 static const uint16_t m_c42305476bb4746f[] = {2, 3, 0, 1};
 static const uint16_t i_c42305476bb4746f[] = {0, 1, 2, 3};
+static const uint16_t mh_c42305476bb4746f[] = {2, 6, 3, 0, 0, 65535, 3, 1, 65535, 2};
+static const uint16_t dh_c42305476bb4746f[] = {1, 4, 2, 0, 65535, 2, 1};
 const ::capnp::_::RawSchema s_c42305476bb4746f = {
   0xc42305476bb4746f, b_c42305476bb4746f.words, 75, d_c42305476bb4746f, m_c42305476bb4746f,
-  3, 4, i_c42305476bb4746f, nullptr, nullptr
+  3, 4, i_c42305476bb4746f, nullptr, nullptr,
+  mh_c42305476bb4746f, dh_c42305476bb4746f, nullptr
 };
 static const ::capnp::_::AlignedData<30> b_cafccddb68db1d11 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1053,9 +1080,12 @@ static const ::capnp::_::RawSchema* const d_cafccddb68db1d11[] = {
 };
 static const uint16_t m_cafccddb68db1d11[] = {0};
 static const uint16_t i_cafccddb68db1d11[] = {0};
+static const uint16_t mh_cafccddb68db1d11[] = {1, 2, 0, 0, 65535};
+static const uint16_t dh_cafccddb68db1d11[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_cafccddb68db1d11 = {
   0xcafccddb68db1d11, b_cafccddb68db1d11.words, 30, d_cafccddb68db1d11, m_cafccddb68db1d11,
-  1, 1, i_cafccddb68db1d11, nullptr, nullptr
+  1, 1, i_cafccddb68db1d11, nullptr, nullptr,
+  mh_cafccddb68db1d11, dh_cafccddb68db1d11, nullptr
 };
 static const ::capnp::_::AlignedData<47> b_bb90d5c287870be6 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1111,9 +1141,12 @@ static const ::capnp::_::RawSchema* const d_bb90d5c287870be6[] = {
 };
 static const uint16_t m_bb90d5c287870be6[] = {1, 0};
 static const uint16_t i_bb90d5c287870be6[] = {0, 1};
+static const uint16_t mh_bb90d5c287870be6[] = {1, 3, 0, 1, 0, 65535};
+static const uint16_t dh_bb90d5c287870be6[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_bb90d5c287870be6 = {
   0xbb90d5c287870be6, b_bb90d5c287870be6.words, 47, d_bb90d5c287870be6, m_bb90d5c287870be6,
-  1, 2, i_bb90d5c287870be6, nullptr, nullptr
+  1, 2, i_bb90d5c287870be6, nullptr, nullptr,
+  mh_bb90d5c287870be6, dh_bb90d5c287870be6, nullptr
 };
 static const ::capnp::_::AlignedData<64> b_978a7cebdc549a4d = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1186,9 +1219,12 @@ static const ::capnp::_::RawSchema* const d_978a7cebdc549a4d[] = {
 };
 static const uint16_t m_978a7cebdc549a4d[] = {2, 1, 0};
 static const uint16_t i_978a7cebdc549a4d[] = {0, 1, 2};
+static const uint16_t mh_978a7cebdc549a4d[] = {1, 4, 1, 0, 1, 2, 65535};
+static const uint16_t dh_978a7cebdc549a4d[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_978a7cebdc549a4d = {
   0x978a7cebdc549a4d, b_978a7cebdc549a4d.words, 64, d_978a7cebdc549a4d, m_978a7cebdc549a4d,
-  1, 3, i_978a7cebdc549a4d, nullptr, nullptr
+  1, 3, i_978a7cebdc549a4d, nullptr, nullptr,
+  mh_978a7cebdc549a4d, dh_978a7cebdc549a4d, nullptr
 };
 static const ::capnp::_::AlignedData<95> b_9500cce23b334d80 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1292,9 +1328,12 @@ static const ::capnp::_::RawSchema* const d_9500cce23b334d80[] = {
 };
 static const uint16_t m_9500cce23b334d80[] = {4, 1, 0, 2, 3};
 static const uint16_t i_9500cce23b334d80[] = {0, 1, 2, 3, 4};
+static const uint16_t mh_9500cce23b334d80[] = {2, 7, 0, 2, 1, 65535, 2, 0, 3, 65535, 4};
+static const uint16_t dh_9500cce23b334d80[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_9500cce23b334d80 = {
   0x9500cce23b334d80, b_9500cce23b334d80.words, 95, d_9500cce23b334d80, m_9500cce23b334d80,
-  1, 5, i_9500cce23b334d80, nullptr, nullptr
+  1, 5, i_9500cce23b334d80, nullptr, nullptr,
+  mh_9500cce23b334d80, dh_9500cce23b334d80, nullptr
 };
 static const ::capnp::_::AlignedData<260> b_d07378ede1f9cc60 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1566,9 +1605,12 @@ static const ::capnp::_::RawSchema* const d_d07378ede1f9cc60[] = {
 };
 static const uint16_t m_d07378ede1f9cc60[] = {18, 1, 13, 15, 10, 11, 3, 4, 5, 2, 17, 14, 16, 12, 7, 8, 9, 6, 0};
 static const uint16_t i_d07378ede1f9cc60[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+static const uint16_t mh_d07378ede1f9cc60[] = {5, 24, 0, 0, 37, 30, 18, 65535, 16, 14, 11, 0, 10, 8, 65535, 15, 6, 17, 65535, 65535, 1, 3, 2, 5, 7, 13, 18, 9, 65535, 12, 4};
+static const uint16_t dh_d07378ede1f9cc60[] = {2, 6, 1, 0, 3, 1, 2, 65535, 0, 65535};
 const ::capnp::_::RawSchema s_d07378ede1f9cc60 = {
   0xd07378ede1f9cc60, b_d07378ede1f9cc60.words, 260, d_d07378ede1f9cc60, m_d07378ede1f9cc60,
-  4, 19, i_d07378ede1f9cc60, nullptr, nullptr
+  4, 19, i_d07378ede1f9cc60, nullptr, nullptr,
+  mh_d07378ede1f9cc60, dh_d07378ede1f9cc60, nullptr
 };
 static const ::capnp::_::AlignedData<31> b_87e739250a60ea97 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1608,9 +1650,12 @@ static const ::capnp::_::RawSchema* const d_87e739250a60ea97[] = {
 };
 static const uint16_t m_87e739250a60ea97[] = {0};
 static const uint16_t i_87e739250a60ea97[] = {0};
+static const uint16_t mh_87e739250a60ea97[] = {1, 2, 0, 0, 65535};
+static const uint16_t dh_87e739250a60ea97[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_87e739250a60ea97 = {
   0x87e739250a60ea97, b_87e739250a60ea97.words, 31, d_87e739250a60ea97, m_87e739250a60ea97,
-  1, 1, i_87e739250a60ea97, nullptr, nullptr
+  1, 1, i_87e739250a60ea97, nullptr, nullptr,
+  mh_87e739250a60ea97, dh_87e739250a60ea97, nullptr
 };
 static const ::capnp::_::AlignedData<30> b_9e0e78711a7f87a9 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1649,9 +1694,12 @@ static const ::capnp::_::RawSchema* const d_9e0e78711a7f87a9[] = {
 };
 static const uint16_t m_9e0e78711a7f87a9[] = {0};
 static const uint16_t i_9e0e78711a7f87a9[] = {0};
+static const uint16_t mh_9e0e78711a7f87a9[] = {1, 2, 0, 0, 65535};
+static const uint16_t dh_9e0e78711a7f87a9[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_9e0e78711a7f87a9 = {
   0x9e0e78711a7f87a9, b_9e0e78711a7f87a9.words, 30, d_9e0e78711a7f87a9, m_9e0e78711a7f87a9,
-  1, 1, i_9e0e78711a7f87a9, nullptr, nullptr
+  1, 1, i_9e0e78711a7f87a9, nullptr, nullptr,
+  mh_9e0e78711a7f87a9, dh_9e0e78711a7f87a9, nullptr
 };
 static const ::capnp::_::AlignedData<30> b_ac3a6f60ef4cc6d3 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1690,9 +1738,12 @@ static const ::capnp::_::RawSchema* const d_ac3a6f60ef4cc6d3[] = {
 };
 static const uint16_t m_ac3a6f60ef4cc6d3[] = {0};
 static const uint16_t i_ac3a6f60ef4cc6d3[] = {0};
+static const uint16_t mh_ac3a6f60ef4cc6d3[] = {1, 2, 0, 0, 65535};
+static const uint16_t dh_ac3a6f60ef4cc6d3[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_ac3a6f60ef4cc6d3 = {
   0xac3a6f60ef4cc6d3, b_ac3a6f60ef4cc6d3.words, 30, d_ac3a6f60ef4cc6d3, m_ac3a6f60ef4cc6d3,
-  1, 1, i_ac3a6f60ef4cc6d3, nullptr, nullptr
+  1, 1, i_ac3a6f60ef4cc6d3, nullptr, nullptr,
+  mh_ac3a6f60ef4cc6d3, dh_ac3a6f60ef4cc6d3, nullptr
 };
 static const ::capnp::_::AlignedData<31> b_ed8bca69f7fb0cbf = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -1732,9 +1783,12 @@ static const ::capnp::_::RawSchema* const d_ed8bca69f7fb0cbf[] = {
 };
 static const uint16_t m_ed8bca69f7fb0cbf[] = {0};
 static const uint16_t i_ed8bca69f7fb0cbf[] = {0};
+static const uint16_t mh_ed8bca69f7fb0cbf[] = {1, 2, 0, 0, 65535};
+static const uint16_t dh_ed8bca69f7fb0cbf[] = {1, 2, 0, 65535, 0};
 const ::capnp::_::RawSchema s_ed8bca69f7fb0cbf = {
   0xed8bca69f7fb0cbf, b_ed8bca69f7fb0cbf.words, 31, d_ed8bca69f7fb0cbf, m_ed8bca69f7fb0cbf,
-  1, 1, i_ed8bca69f7fb0cbf, nullptr, nullptr
+  1, 1, i_ed8bca69f7fb0cbf, nullptr, nullptr,
+  mh_ed8bca69f7fb0cbf, dh_ed8bca69f7fb0cbf, nullptr
 };
 static const ::capnp::_::AlignedData<285> b_ce23dcd2d7b00c9b = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2025,9 +2079,11 @@ static const ::capnp::_::AlignedData<285> b_ce23dcd2d7b00c9b = {
 };
 static const uint16_t m_ce23dcd2d7b00c9b[] = {18, 1, 13, 15, 10, 11, 3, 4, 5, 2, 17, 14, 16, 12, 7, 8, 9, 6, 0};
 static const uint16_t i_ce23dcd2d7b00c9b[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+static const uint16_t mh_ce23dcd2d7b00c9b[] = {5, 24, 0, 0, 37, 30, 18, 65535, 16, 14, 11, 0, 10, 8, 65535, 15, 6, 17, 65535, 65535, 1, 3, 2, 5, 7, 13, 18, 9, 65535, 12, 4};
 const ::capnp::_::RawSchema s_ce23dcd2d7b00c9b = {
   0xce23dcd2d7b00c9b, b_ce23dcd2d7b00c9b.words, 285, nullptr, m_ce23dcd2d7b00c9b,
-  0, 19, i_ce23dcd2d7b00c9b, nullptr, nullptr
+  0, 19, i_ce23dcd2d7b00c9b, nullptr, nullptr,
+  mh_ce23dcd2d7b00c9b, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<45> b_f1c8950dab257542 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2081,9 +2137,12 @@ static const ::capnp::_::RawSchema* const d_f1c8950dab257542[] = {
 };
 static const uint16_t m_f1c8950dab257542[] = {0, 1};
 static const uint16_t i_f1c8950dab257542[] = {0, 1};
+static const uint16_t mh_f1c8950dab257542[] = {1, 3, 0, 0, 65535, 1};
+static const uint16_t dh_f1c8950dab257542[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_f1c8950dab257542 = {
   0xf1c8950dab257542, b_f1c8950dab257542.words, 45, d_f1c8950dab257542, m_f1c8950dab257542,
-  1, 2, i_f1c8950dab257542, nullptr, nullptr
+  1, 2, i_f1c8950dab257542, nullptr, nullptr,
+  mh_f1c8950dab257542, dh_f1c8950dab257542, nullptr
 };
 static const ::capnp::_::AlignedData<53> b_d1958f7dba521926 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2141,9 +2200,11 @@ static const ::capnp::_::AlignedData<53> b_d1958f7dba521926 = {
     109, 112, 111, 115, 105, 116, 101,   0, }
 };
 static const uint16_t m_d1958f7dba521926[] = {1, 2, 5, 0, 4, 7, 6, 3};
+static const uint16_t mh_d1958f7dba521926[] = {3, 11, 0, 4, 1, 6, 5, 65535, 2, 0, 3, 1, 7, 65535, 65535, 4};
 const ::capnp::_::RawSchema s_d1958f7dba521926 = {
   0xd1958f7dba521926, b_d1958f7dba521926.words, 53, nullptr, m_d1958f7dba521926,
-  0, 8, nullptr, nullptr, nullptr
+  0, 8, nullptr, nullptr, nullptr,
+  mh_d1958f7dba521926, nullptr, nullptr
 };
 static const ::capnp::_::AlignedData<57> b_bfc546f6210ad7ce = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2210,9 +2271,12 @@ static const ::capnp::_::RawSchema* const d_bfc546f6210ad7ce[] = {
 };
 static const uint16_t m_bfc546f6210ad7ce[] = {0, 1};
 static const uint16_t i_bfc546f6210ad7ce[] = {0, 1};
+static const uint16_t mh_bfc546f6210ad7ce[] = {1, 3, 1, 65535, 0, 1};
+static const uint16_t dh_bfc546f6210ad7ce[] = {1, 3, 0, 1, 65535, 0};
 const ::capnp::_::RawSchema s_bfc546f6210ad7ce = {
   0xbfc546f6210ad7ce, b_bfc546f6210ad7ce.words, 57, d_bfc546f6210ad7ce, m_bfc546f6210ad7ce,
-  2, 2, i_bfc546f6210ad7ce, nullptr, nullptr
+  2, 2, i_bfc546f6210ad7ce, nullptr, nullptr,
+  mh_bfc546f6210ad7ce, dh_bfc546f6210ad7ce, nullptr
 };
 static const ::capnp::_::AlignedData<69> b_cfea0eb02e810062 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2290,9 +2354,12 @@ static const ::capnp::_::RawSchema* const d_cfea0eb02e810062[] = {
 };
 static const uint16_t m_cfea0eb02e810062[] = {1, 0, 2};
 static const uint16_t i_cfea0eb02e810062[] = {0, 1, 2};
+static const uint16_t mh_cfea0eb02e810062[] = {1, 4, 1, 2, 65535, 1, 0};
+static const uint16_t dh_cfea0eb02e810062[] = {1, 2, 0, 0, 65535};
 const ::capnp::_::RawSchema s_cfea0eb02e810062 = {
   0xcfea0eb02e810062, b_cfea0eb02e810062.words, 69, d_cfea0eb02e810062, m_cfea0eb02e810062,
-  1, 3, i_cfea0eb02e810062, nullptr, nullptr
+  1, 3, i_cfea0eb02e810062, nullptr, nullptr,
+  mh_cfea0eb02e810062, dh_cfea0eb02e810062, nullptr
 };
 static const ::capnp::_::AlignedData<49> b_ae504193122357e5 = {
   {   0,   0,   0,   0,   5,   0,   5,   0,
@@ -2347,9 +2414,11 @@ static const ::capnp::_::AlignedData<49> b_ae504193122357e5 = {
 };
 static const uint16_t m_ae504193122357e5[] = {0, 1};
 static const uint16_t i_ae504193122357e5[] = {0, 1};
+static const uint16_t mh_ae504193122357e5[] = {1, 3, 3, 65535, 0, 1};
 const ::capnp::_::RawSchema s_ae504193122357e5 = {
   0xae504193122357e5, b_ae504193122357e5.words, 49, nullptr, m_ae504193122357e5,
-  0, 2, i_ae504193122357e5, nullptr, nullptr
+  0, 2, i_ae504193122357e5, nullptr, nullptr,
+  mh_ae504193122357e5, nullptr, nullptr
 };
 }  // namespace schemas
 namespace _ {  // private
@@ -411,6 +411,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<12> presenceMask() const;
+
   inline Which which() const;
   inline  ::uint64_t getId() const;
 
@@ -475,6 +477,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline  ::uint64_t getId();
   inline void setId( ::uint64_t value);
@@ -567,6 +571,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasName() const;
   inline  ::capnp::Text::Reader getName() const;
 
@@ -602,6 +608,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasName();
   inline  ::capnp::Text::Builder getName();
   inline void setName( ::capnp::Text::Reader value);
@@ -649,6 +657,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<7> presenceMask() const;
+
   inline  ::uint16_t getDataWordCount() const;
 
   inline  ::uint16_t getPointerCount() const;
@@ -756,6 +766,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline bool hasEnumerants() const;
   inline  ::capnp::List< ::capnp::schema::Enumerant>::Reader getEnumerants() const;
 
@@ -833,6 +845,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasMethods() const;
   inline  ::capnp::List< ::capnp::schema::Method>::Reader getMethods() const;
 
@@ -921,6 +935,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasType() const;
   inline  ::capnp::schema::Type::Reader getType() const;
 
@@ -1010,6 +1026,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<13> presenceMask() const;
+
   inline bool hasType() const;
   inline  ::capnp::schema::Type::Reader getType() const;
 
@@ -1148,6 +1166,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<7> presenceMask() const;
+
   inline Which which() const;
   inline bool hasName() const;
   inline  ::capnp::Text::Reader getName() const;
@@ -1197,6 +1217,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool hasName();
   inline  ::capnp::Text::Builder getName();
@@ -1267,6 +1289,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<4> presenceMask() const;
+
   inline  ::uint32_t getOffset() const;
 
   inline bool hasType() const;
@@ -1366,6 +1390,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline  ::uint64_t getTypeId() const;
 
 private:
@@ -1438,6 +1464,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline Which which() const;
   inline bool isImplicit() const;
   inline  ::capnp::Void getImplicit() const;
@@ -1521,6 +1549,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline bool hasName() const;
   inline  ::capnp::Text::Reader getName() const;
 
@@ -1559,6 +1589,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasName();
   inline  ::capnp::Text::Builder getName();
   inline void setName( ::capnp::Text::Reader value);
@@ -1613,6 +1645,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<5> presenceMask() const;
+
   inline bool hasName() const;
   inline  ::capnp::Text::Reader getName() const;
 
@@ -1655,6 +1689,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasName();
   inline  ::capnp::Text::Builder getName();
   inline void setName( ::capnp::Text::Reader value);
@@ -1715,6 +1751,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<19> presenceMask() const;
+
   inline Which which() const;
   inline bool isVoid() const;
   inline  ::capnp::Void getVoid() const;
@@ -1803,6 +1841,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isVoid();
   inline  ::capnp::Void getVoid();
@@ -1917,6 +1957,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline bool hasElementType() const;
   inline  ::capnp::schema::Type::Reader getElementType() const;
 
@@ -1995,6 +2037,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline  ::uint64_t getTypeId() const;
 
 private:
@@ -2067,6 +2111,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline  ::uint64_t getTypeId() const;
 
 private:
@@ -2139,6 +2185,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<1> presenceMask() const;
+
   inline  ::uint64_t getTypeId() const;
 
 private:
@@ -2211,6 +2259,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<19> presenceMask() const;
+
   inline Which which() const;
   inline bool isVoid() const;
   inline  ::capnp::Void getVoid() const;
@@ -2304,6 +2354,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline Which which();
   inline bool isVoid();
   inline  ::capnp::Void getVoid();
@@ -2429,6 +2481,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline  ::uint64_t getId() const;
 
   inline bool hasValue() const;
@@ -2464,6 +2518,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint64_t getId();
   inline void setId( ::uint64_t value);
 
@@ -2512,6 +2568,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline bool hasNodes() const;
   inline  ::capnp::List< ::capnp::schema::Node>::Reader getNodes() const;
 
@@ -2548,6 +2606,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline bool hasNodes();
   inline  ::capnp::List< ::capnp::schema::Node>::Builder getNodes();
   inline void setNodes( ::capnp::List< ::capnp::schema::Node>::Reader value);
@@ -2599,6 +2659,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<3> presenceMask() const;
+
   inline  ::uint64_t getId() const;
 
   inline bool hasFilename() const;
@@ -2637,6 +2699,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint64_t getId();
   inline void setId( ::uint64_t value);
 
@@ -2691,6 +2755,8 @@ public:
     return _reader.totalSize().asPublic();
   }
 
+  inline ::capnp::FieldPresence<2> presenceMask() const;
+
   inline  ::uint64_t getId() const;
 
   inline bool hasName() const;
@@ -2726,6 +2792,8 @@ public:
 
   inline ::capnp::MessageSize totalSize() const { return asReader().totalSize(); }
 
+  inline void copyFrom(Reader other);
+
   inline  ::uint64_t getId();
   inline void setId( ::uint64_t value);
 
@@ -2771,6 +2839,42 @@ inline Node::Which Node::Builder::which() {
   return _builder.getDataField<Which>(6 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<12> Node::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<12> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  _result.set(2, _reader.hasDataField< ::uint32_t>(2 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField< ::uint64_t>(2 * ::capnp::ELEMENTS));
+  _result.set(4, (_pointers[0] >> 1) & 1);
+  _result.set(5, (_pointers[0] >> 2) & 1);
+  _result.set(6, which() == Node::FILE);
+  _result.set(7, which() == Node::STRUCT);
+  _result.set(8, which() == Node::ENUM);
+  _result.set(9, which() == Node::INTERFACE);
+  _result.set(10, which() == Node::CONST);
+  _result.set(11, which() == Node::ANNOTATION);
+  return _result;
+}
+
+inline void Node::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Node>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+  _builder.getPointerField(2 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(2 * ::capnp::POINTERS));
+  _builder.getPointerField(3 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(3 * ::capnp::POINTERS));
+  _builder.getPointerField(4 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(4 * ::capnp::POINTERS));
+}
+
 inline  ::uint64_t Node::Reader::getId() const {
   return _reader.getDataField< ::uint64_t>(
       0 * ::capnp::ELEMENTS);
@@ -3065,6 +3169,24 @@ inline Node::Annotation::Builder Node::Builder::initAnnotation() {
   _builder.getPointerField(3 * ::capnp::POINTERS).clear();
   return Node::Annotation::Builder(_builder);
 }
+inline ::capnp::FieldPresence<2> Node::NestedNode::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, _reader.hasDataField< ::uint64_t>(0 * ::capnp::ELEMENTS));
+  return _result;
+}
+
+inline void Node::NestedNode::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Node::NestedNode>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool Node::NestedNode::Reader::hasName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -3111,6 +3233,20 @@ inline void Node::NestedNode::Builder::setId( ::uint64_t value) {
       0 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<7> Node::Struct::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<7> _result;
+  _result.set(0, _reader.hasDataField< ::uint16_t>(7 * ::capnp::ELEMENTS));
+  _result.set(1, _reader.hasDataField< ::uint16_t>(12 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField< ::uint16_t>(13 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField<bool>(224 * ::capnp::ELEMENTS));
+  _result.set(4, _reader.hasDataField< ::uint16_t>(15 * ::capnp::ELEMENTS));
+  _result.set(5, _reader.hasDataField< ::uint32_t>(8 * ::capnp::ELEMENTS));
+  _result.set(6, (_pointers[0] >> 3) & 1);
+  return _result;
+}
+
 inline  ::uint16_t Node::Struct::Reader::getDataWordCount() const {
   return _reader.getDataField< ::uint16_t>(
       7 * ::capnp::ELEMENTS);
@@ -3227,6 +3363,14 @@ inline ::capnp::Orphan< ::capnp::List< ::capnp::schema::Field>> Node::Struct::Bu
       _builder.getPointerField(3 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<1> Node::Enum::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, (_pointers[0] >> 3) & 1);
+  return _result;
+}
+
 inline bool Node::Enum::Reader::hasEnumerants() const {
   return !_reader.getPointerField(3 * ::capnp::POINTERS).isNull();
 }
@@ -3259,6 +3403,15 @@ inline ::capnp::Orphan< ::capnp::List< ::capnp::schema::Enumerant>> Node::Enum::
       _builder.getPointerField(3 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> Node::Interface::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 3) & 1);
+  _result.set(1, (_pointers[0] >> 4) & 1);
+  return _result;
+}
+
 inline bool Node::Interface::Reader::hasMethods() const {
   return !_reader.getPointerField(3 * ::capnp::POINTERS).isNull();
 }
@@ -3327,6 +3480,15 @@ inline ::capnp::Orphan< ::capnp::List< ::uint64_t>> Node::Interface::Builder::di
       _builder.getPointerField(4 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> Node::Const::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 3) & 1);
+  _result.set(1, (_pointers[0] >> 4) & 1);
+  return _result;
+}
+
 inline bool Node::Const::Reader::hasType() const {
   return !_reader.getPointerField(3 * ::capnp::POINTERS).isNull();
 }
@@ -3397,6 +3559,26 @@ inline ::capnp::Orphan< ::capnp::schema::Value> Node::Const::Builder::disownValu
       _builder.getPointerField(4 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<13> Node::Annotation::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<13> _result;
+  _result.set(0, (_pointers[0] >> 3) & 1);
+  _result.set(1, _reader.hasDataField<bool>(112 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField<bool>(113 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField<bool>(114 * ::capnp::ELEMENTS));
+  _result.set(4, _reader.hasDataField<bool>(115 * ::capnp::ELEMENTS));
+  _result.set(5, _reader.hasDataField<bool>(116 * ::capnp::ELEMENTS));
+  _result.set(6, _reader.hasDataField<bool>(117 * ::capnp::ELEMENTS));
+  _result.set(7, _reader.hasDataField<bool>(118 * ::capnp::ELEMENTS));
+  _result.set(8, _reader.hasDataField<bool>(119 * ::capnp::ELEMENTS));
+  _result.set(9, _reader.hasDataField<bool>(120 * ::capnp::ELEMENTS));
+  _result.set(10, _reader.hasDataField<bool>(121 * ::capnp::ELEMENTS));
+  _result.set(11, _reader.hasDataField<bool>(122 * ::capnp::ELEMENTS));
+  _result.set(12, _reader.hasDataField<bool>(123 * ::capnp::ELEMENTS));
+  return _result;
+}
+
 inline bool Node::Annotation::Reader::hasType() const {
   return !_reader.getPointerField(3 * ::capnp::POINTERS).isNull();
 }
@@ -3607,6 +3789,35 @@ inline Field::Which Field::Builder::which() {
   return _builder.getDataField<Which>(4 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<7> Field::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<7> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, _reader.hasDataField< ::uint16_t>(0 * ::capnp::ELEMENTS));
+  _result.set(2, (_pointers[0] >> 1) & 1);
+  _result.set(3, _reader.hasDataField< ::uint16_t>(1 * ::capnp::ELEMENTS));
+  _result.set(4, which() == Field::SLOT);
+  _result.set(5, which() == Field::GROUP);
+  _result.set(6, true);
+  return _result;
+}
+
+inline void Field::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Field>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+  _builder.getPointerField(2 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(2 * ::capnp::POINTERS));
+  _builder.getPointerField(3 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(3 * ::capnp::POINTERS));
+}
+
 inline bool Field::Reader::hasName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -3760,6 +3971,17 @@ inline Field::Ordinal::Builder Field::Builder::initOrdinal() {
   _builder.setDataField< ::uint16_t>(6 * ::capnp::ELEMENTS, 0);
   return Field::Ordinal::Builder(_builder);
 }
+inline ::capnp::FieldPresence<4> Field::Slot::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<4> _result;
+  _result.set(0, _reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 2) & 1);
+  _result.set(2, (_pointers[0] >> 3) & 1);
+  _result.set(3, _reader.hasDataField<bool>(128 * ::capnp::ELEMENTS));
+  return _result;
+}
+
 inline  ::uint32_t Field::Slot::Reader::getOffset() const {
   return _reader.getDataField< ::uint32_t>(
       1 * ::capnp::ELEMENTS);
@@ -3858,6 +4080,12 @@ inline void Field::Slot::Builder::setHadExplicitDefault(bool value) {
       128 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<1> Field::Group::Reader::presenceMask() const {
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(2 * ::capnp::ELEMENTS));
+  return _result;
+}
+
 inline  ::uint64_t Field::Group::Reader::getTypeId() const {
   return _reader.getDataField< ::uint64_t>(
       2 * ::capnp::ELEMENTS);
@@ -3879,6 +4107,13 @@ inline Field::Ordinal::Which Field::Ordinal::Builder::which() {
   return _builder.getDataField<Which>(5 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<2> Field::Ordinal::Reader::presenceMask() const {
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, which() == Field::Ordinal::IMPLICIT);
+  _result.set(1, which() == Field::Ordinal::EXPLICIT && (_reader.hasDataField< ::uint16_t>(6 * ::capnp::ELEMENTS)));
+  return _result;
+}
+
 inline bool Field::Ordinal::Reader::isImplicit() const {
   return which() == Field::Ordinal::IMPLICIT;
 }
@@ -3931,6 +4166,27 @@ inline void Field::Ordinal::Builder::setExplicit( ::uint16_t value) {
       6 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<3> Enumerant::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, _reader.hasDataField< ::uint16_t>(0 * ::capnp::ELEMENTS));
+  _result.set(2, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void Enumerant::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Enumerant>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline bool Enumerant::Reader::hasName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -4009,6 +4265,29 @@ inline ::capnp::Orphan< ::capnp::List< ::capnp::schema::Annotation>> Enumerant::
       _builder.getPointerField(1 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<5> Method::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<5> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, _reader.hasDataField< ::uint16_t>(0 * ::capnp::ELEMENTS));
+  _result.set(2, _reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS));
+  _result.set(3, _reader.hasDataField< ::uint64_t>(2 * ::capnp::ELEMENTS));
+  _result.set(4, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void Method::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Method>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline bool Method::Reader::hasName() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -4122,6 +4401,38 @@ inline Type::Which Type::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<19> Type::Reader::presenceMask() const {
+  ::capnp::FieldPresence<19> _result;
+  _result.set(0, which() == Type::VOID);
+  _result.set(1, which() == Type::BOOL);
+  _result.set(2, which() == Type::INT8);
+  _result.set(3, which() == Type::INT16);
+  _result.set(4, which() == Type::INT32);
+  _result.set(5, which() == Type::INT64);
+  _result.set(6, which() == Type::UINT8);
+  _result.set(7, which() == Type::UINT16);
+  _result.set(8, which() == Type::UINT32);
+  _result.set(9, which() == Type::UINT64);
+  _result.set(10, which() == Type::FLOAT32);
+  _result.set(11, which() == Type::FLOAT64);
+  _result.set(12, which() == Type::TEXT);
+  _result.set(13, which() == Type::DATA);
+  _result.set(14, which() == Type::LIST);
+  _result.set(15, which() == Type::ENUM);
+  _result.set(16, which() == Type::STRUCT);
+  _result.set(17, which() == Type::INTERFACE);
+  _result.set(18, which() == Type::ANY_POINTER);
+  return _result;
+}
+
+inline void Type::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Type>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool Type::Reader::isVoid() const {
   return which() == Type::VOID;
 }
@@ -4600,6 +4911,14 @@ inline void Type::Builder::setAnyPointer( ::capnp::Void value) {
       0 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<1> Type::List::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
 inline bool Type::List::Reader::hasElementType() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -4635,6 +4954,12 @@ inline ::capnp::Orphan< ::capnp::schema::Type> Type::List::Builder::disownElemen
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<1> Type::Enum::Reader::presenceMask() const {
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS));
+  return _result;
+}
+
 inline  ::uint64_t Type::Enum::Reader::getTypeId() const {
   return _reader.getDataField< ::uint64_t>(
       1 * ::capnp::ELEMENTS);
@@ -4649,6 +4974,12 @@ inline void Type::Enum::Builder::setTypeId( ::uint64_t value) {
       1 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<1> Type::Struct::Reader::presenceMask() const {
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS));
+  return _result;
+}
+
 inline  ::uint64_t Type::Struct::Reader::getTypeId() const {
   return _reader.getDataField< ::uint64_t>(
       1 * ::capnp::ELEMENTS);
@@ -4663,6 +4994,12 @@ inline void Type::Struct::Builder::setTypeId( ::uint64_t value) {
       1 * ::capnp::ELEMENTS, value);
 }
 
+inline ::capnp::FieldPresence<1> Type::Interface::Reader::presenceMask() const {
+  ::capnp::FieldPresence<1> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS));
+  return _result;
+}
+
 inline  ::uint64_t Type::Interface::Reader::getTypeId() const {
   return _reader.getDataField< ::uint64_t>(
       1 * ::capnp::ELEMENTS);
@@ -4684,6 +5021,40 @@ inline Value::Which Value::Builder::which() {
   return _builder.getDataField<Which>(0 * ::capnp::ELEMENTS);
 }
 
+inline ::capnp::FieldPresence<19> Value::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<19> _result;
+  _result.set(0, which() == Value::VOID);
+  _result.set(1, which() == Value::BOOL && (_reader.hasDataField<bool>(16 * ::capnp::ELEMENTS)));
+  _result.set(2, which() == Value::INT8 && (_reader.hasDataField< ::uint8_t>(2 * ::capnp::ELEMENTS)));
+  _result.set(3, which() == Value::INT16 && (_reader.hasDataField< ::uint16_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(4, which() == Value::INT32 && (_reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(5, which() == Value::INT64 && (_reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(6, which() == Value::UINT8 && (_reader.hasDataField< ::uint8_t>(2 * ::capnp::ELEMENTS)));
+  _result.set(7, which() == Value::UINT16 && (_reader.hasDataField< ::uint16_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(8, which() == Value::UINT32 && (_reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(9, which() == Value::UINT64 && (_reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(10, which() == Value::FLOAT32 && (_reader.hasDataField< ::uint32_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(11, which() == Value::FLOAT64 && (_reader.hasDataField< ::uint64_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(12, which() == Value::TEXT && ((_pointers[0] >> 0) & 1));
+  _result.set(13, which() == Value::DATA && ((_pointers[0] >> 0) & 1));
+  _result.set(14, which() == Value::LIST && ((_pointers[0] >> 0) & 1));
+  _result.set(15, which() == Value::ENUM && (_reader.hasDataField< ::uint16_t>(1 * ::capnp::ELEMENTS)));
+  _result.set(16, which() == Value::STRUCT && ((_pointers[0] >> 0) & 1));
+  _result.set(17, which() == Value::INTERFACE);
+  _result.set(18, which() == Value::ANY_POINTER && ((_pointers[0] >> 0) & 1));
+  return _result;
+}
+
+inline void Value::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Value>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline bool Value::Reader::isVoid() const {
   return which() == Value::VOID;
 }
@@ -5257,6 +5628,24 @@ inline ::capnp::AnyPointer::Builder Value::Builder::initAnyPointer() {
   return result;
 }
 
+inline ::capnp::FieldPresence<2> Annotation::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void Annotation::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<Annotation>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::schema::Value>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint64_t Annotation::Reader::getId() const {
   return _reader.getDataField< ::uint64_t>(
       0 * ::capnp::ELEMENTS);
@@ -5306,6 +5695,25 @@ inline ::capnp::Orphan< ::capnp::schema::Value> Annotation::Builder::disownValue
       _builder.getPointerField(0 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> CodeGeneratorRequest::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, (_pointers[0] >> 0) & 1);
+  _result.set(1, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void CodeGeneratorRequest::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<CodeGeneratorRequest>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  _builder.getPointerField(0 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline bool CodeGeneratorRequest::Reader::hasNodes() const {
   return !_reader.getPointerField(0 * ::capnp::POINTERS).isNull();
 }
@@ -5370,6 +5778,27 @@ inline ::capnp::Orphan< ::capnp::List< ::capnp::schema::CodeGeneratorRequest::Re
       _builder.getPointerField(1 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<3> CodeGeneratorRequest::RequestedFile::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<3> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  _result.set(2, (_pointers[0] >> 1) & 1);
+  return _result;
+}
+
+inline void CodeGeneratorRequest::RequestedFile::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<CodeGeneratorRequest::RequestedFile>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+  _builder.getPointerField(1 * ::capnp::POINTERS).copyFrom(
+      _other.getPointerField(1 * ::capnp::POINTERS));
+}
+
 inline  ::uint64_t CodeGeneratorRequest::RequestedFile::Reader::getId() const {
   return _reader.getDataField< ::uint64_t>(
       0 * ::capnp::ELEMENTS);
@@ -5448,6 +5877,24 @@ inline ::capnp::Orphan< ::capnp::List< ::capnp::schema::CodeGeneratorRequest::Re
       _builder.getPointerField(1 * ::capnp::POINTERS));
 }
 
+inline ::capnp::FieldPresence<2> CodeGeneratorRequest::RequestedFile::Import::Reader::presenceMask() const {
+  uint64_t _pointers[1];
+  _reader.getNonNullPointers(::kj::arrayPtr(_pointers, 1));
+  ::capnp::FieldPresence<2> _result;
+  _result.set(0, _reader.hasDataField< ::uint64_t>(0 * ::capnp::ELEMENTS));
+  _result.set(1, (_pointers[0] >> 0) & 1);
+  return _result;
+}
+
+inline void CodeGeneratorRequest::RequestedFile::Import::Builder::copyFrom(Reader other) {
+  ::capnp::_::StructReader _other =
+      ::capnp::_::PointerHelpers<CodeGeneratorRequest::RequestedFile::Import>::getInternalReader(other);
+  if (!_builder.copyDataFrom(_other)) return;
+  ::capnp::_::PointerHelpers< ::capnp::Text>::copy(
+      _builder.getPointerField(0 * ::capnp::POINTERS),
+      _other.getPointerField(0 * ::capnp::POINTERS));
+}
+
 inline  ::uint64_t CodeGeneratorRequest::RequestedFile::Import::Reader::getId() const {
   return _reader.getDataField< ::uint64_t>(
       0 * ::capnp::ELEMENTS);
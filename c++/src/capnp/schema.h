@@ -55,6 +55,15 @@ extern const RawSchema NULL_INTERFACE_SCHEMA;
 extern const RawSchema NULL_CONST_SCHEMA;
 // The schema types default to these null (empty) schemas in case of error, especially when
 // exceptions are disabled.
+
+const RawStructLayout& getStructLayout(StructSchema schema);
+// Get the precomputed field descriptors for the given struct, building them on first use.  This
+// is what makes DynamicStruct accessors cheap; it is defined in dynamic.c++.  The result remains
+// valid as long as the schema does.
+
+void destroyStructLayout(const RawStructLayout* layout);
+// Frees a layout built by getStructLayout(), along with any layouts it superseded.  The owner of a
+// non-const RawSchema (i.e. SchemaLoader) calls this when destroying it.  Null is OK.
 }  // namespace _ (private)
 
 class Schema {
@@ -140,6 +149,7 @@ private:
   friend class ConstSchema;
   friend class ListSchema;
   friend class SchemaLoader;
+  friend const _::RawStructLayout& _::getStructLayout(StructSchema schema);
 };
 
 // -------------------------------------------------------------------
@@ -0,0 +1,147 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "segment-allocator.h"
+#include <gtest/gtest.h>
+#include "test-util.h"
+#include <stdlib.h>
+
+namespace capnp {
+namespace _ {  // private
+namespace {
+
+class CountingSegmentAllocator final: public SegmentAllocator {
+public:
+  uint allocated = 0;
+  uint released = 0;
+
+  kj::ArrayPtr<word> allocate(uint minimumWords) override {
+    ++allocated;
+    return kj::arrayPtr(reinterpret_cast<word*>(calloc(minimumWords, sizeof(word))),
+                        minimumWords);
+  }
+
+  void release(kj::ArrayPtr<word> segment, size_t wordsUsed) override {
+    ++released;
+    free(segment.begin());
+  }
+};
+
+bool isZero(kj::ArrayPtr<const word> segment) {
+  for (auto& w: segment) {
+    if (*reinterpret_cast<const uint64_t*>(&w) != 0) return false;
+  }
+  return true;
+}
+
+TEST(SegmentAllocator, Pooled) {
+  CountingSegmentAllocator backing;
+  PooledSegmentAllocator pool(backing);
+
+  kj::Array<kj::ArrayPtr<const word>> firstSegments;
+  {
+    MallocMessageBuilder builder(pool, 16, AllocationStrategy::FIXED_SIZE);
+    initTestMessage(builder.initRoot<TestAllTypes>());
+    checkTestMessage(builder.getRoot<TestAllTypes>());
+    firstSegments = kj::heapArray<kj::ArrayPtr<const word>>(builder.getSegmentsForOutput());
+    ASSERT_GT(firstSegments.size(), 1u);
+  }
+
+  uint allocated = backing.allocated;
+  EXPECT_EQ(0u, backing.released);
+  EXPECT_GT(pool.getRetainedWords(), 0u);
+
+  // Every pooled block must have been cleared.
+  for (auto segment: firstSegments) {
+    EXPECT_TRUE(isZero(segment));
+  }
+
+  {
+    MallocMessageBuilder builder(pool, 16, AllocationStrategy::FIXED_SIZE);
+    initTestMessage(builder.initRoot<TestAllTypes>());
+    checkTestMessage(builder.getRoot<TestAllTypes>());
+  }
+
+  // The second message was built entirely out of recycled blocks.
+  EXPECT_EQ(allocated, backing.allocated);
+}
+
+TEST(SegmentAllocator, PooledRetainedLimit) {
+  CountingSegmentAllocator backing;
+
+  {
+    PooledSegmentAllocator pool(backing, 0);
+    MallocMessageBuilder builder(pool, 16, AllocationStrategy::FIXED_SIZE);
+    initTestMessage(builder.initRoot<TestAllTypes>());
+  }
+  EXPECT_GT(backing.allocated, 1u);
+  EXPECT_EQ(backing.allocated, backing.released);
+
+  backing.allocated = 0;
+  backing.released = 0;
+  {
+    PooledSegmentAllocator pool(backing);
+    {
+      MallocMessageBuilder builder(pool, 16, AllocationStrategy::FIXED_SIZE);
+      initTestMessage(builder.initRoot<TestAllTypes>());
+    }
+    EXPECT_EQ(0u, backing.released);
+  }
+  // Destroying the pool hands everything back.
+  EXPECT_EQ(backing.allocated, backing.released);
+}
+
+TEST(SegmentAllocator, Mmap) {
+  MmapSegmentAllocator::Options options;
+  options.hugePages = true;
+  MmapSegmentAllocator allocator(options);
+
+  auto segment = allocator.allocate(1);
+  EXPECT_EQ((2u << 20) / sizeof(word), segment.size());
+  EXPECT_TRUE(isZero(segment));
+  allocator.release(segment, 0);
+
+  MallocMessageBuilder builder(allocator);
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  checkTestMessage(builder.getRoot<TestAllTypes>());
+
+  // The first segment took the whole huge page.
+  EXPECT_EQ(1u, builder.getSegmentsForOutput().size());
+}
+
+#if __linux__
+TEST(SegmentAllocator, MmapNumaNode) {
+  MmapSegmentAllocator::Options options;
+  options.numaNode = 0u;
+  MmapSegmentAllocator allocator(options);
+
+  MallocMessageBuilder builder(allocator);
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  checkTestMessage(builder.getRoot<TestAllTypes>());
+}
+#endif
+
+}  // namespace
+}  // namespace _ (private)
+}  // namespace capnp
@@ -0,0 +1,191 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "segment-allocator.h"
+#include <kj/debug.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace capnp {
+
+namespace {
+
+uint log2Ceil(uint n) {
+  // Smallest i such that 2^i >= n.
+  return n <= 1 ? 0 : 32 - __builtin_clz(n - 1);
+}
+
+uint log2Floor(size_t n) {
+  // Largest i such that 2^i <= n, capped to the number of free lists.
+  uint result = 0;
+  while (result < 31 && (size_t(2) << result) <= n) ++result;
+  return result;
+}
+
+}  // namespace
+
+PooledSegmentAllocator::PooledSegmentAllocator(size_t maxRetainedWords)
+    : maxRetainedWords(maxRetainedWords) {}
+PooledSegmentAllocator::PooledSegmentAllocator(SegmentAllocator& backing, size_t maxRetainedWords)
+    : backing(backing), maxRetainedWords(maxRetainedWords) {}
+
+PooledSegmentAllocator::~PooledSegmentAllocator() noexcept(false) {
+  for (auto& list: freeLists) {
+    for (auto segment: list) {
+      // Pooled blocks are already zeroed.
+      releaseBacking(segment, 0);
+    }
+  }
+}
+
+kj::ArrayPtr<word> PooledSegmentAllocator::allocate(uint minimumWords) {
+  uint sizeClass = log2Ceil(minimumWords);
+  if (sizeClass < 31) {
+    // The backing allocator may have handed out bigger blocks than we asked for, so a larger
+    // class can hold the only fitting block.
+    for (uint i = sizeClass; i < kj::size(freeLists); i++) {
+      auto& list = freeLists[i];
+      if (list.size() > 0) {
+        auto result = list.back();
+        list.removeLast();
+        retainedWords -= result.size();
+        return result;
+      }
+    }
+
+    return allocateBacking(1u << sizeClass);
+  } else {
+    // Too big to round up; don't bother pooling.
+    return allocateBacking(minimumWords);
+  }
+}
+
+void PooledSegmentAllocator::release(kj::ArrayPtr<word> segment, size_t wordsUsed) {
+  uint sizeClass = log2Floor(segment.size());
+  if (sizeClass >= 31 || retainedWords + segment.size() > maxRetainedWords) {
+    releaseBacking(segment, wordsUsed);
+    return;
+  }
+
+  memset(segment.begin(), 0, wordsUsed * sizeof(word));
+  freeLists[sizeClass].add(segment);
+  retainedWords += segment.size();
+}
+
+kj::ArrayPtr<word> PooledSegmentAllocator::allocateBacking(uint size) {
+  KJ_IF_MAYBE(b, backing) {
+    return b->allocate(size);
+  }
+
+  void* result = calloc(size, sizeof(word));
+  if (result == nullptr) {
+    KJ_FAIL_SYSCALL("calloc(size, sizeof(word))", ENOMEM, size);
+  }
+  return kj::arrayPtr(reinterpret_cast<word*>(result), size);
+}
+
+void PooledSegmentAllocator::releaseBacking(kj::ArrayPtr<word> segment, size_t wordsUsed) {
+  KJ_IF_MAYBE(b, backing) {
+    b->release(segment, wordsUsed);
+  } else {
+    free(segment.begin());
+  }
+}
+
+// -------------------------------------------------------------------
+
+namespace {
+
+constexpr size_t HUGE_PAGE_SIZE = 2u << 20;
+
+#if __linux__
+constexpr int MPOL_PREFERRED_ = 1;
+// From <linux/mempolicy.h>.  We call mbind() directly rather than depend on libnuma.
+#endif
+
+void bindToNode(void* mapping, size_t size, uint node) {
+#if __linux__
+  KJ_REQUIRE(node < sizeof(unsigned long) * 8 * 16, "NUMA node number out of range.", node);
+  unsigned long mask[16];
+  memset(mask, 0, sizeof(mask));
+  mask[node / (sizeof(unsigned long) * 8)] |= 1ul << (node % (sizeof(unsigned long) * 8));
+  KJ_SYSCALL(syscall(SYS_mbind, mapping, size, MPOL_PREFERRED_, mask, sizeof(mask) * 8, 0),
+             node);
+#else
+  KJ_FAIL_REQUIRE("NUMA placement is not supported on this platform.", node);
+#endif
+}
+
+}  // namespace
+
+MmapSegmentAllocator::MmapSegmentAllocator() {}
+MmapSegmentAllocator::MmapSegmentAllocator(Options options): options(options) {}
+
+kj::ArrayPtr<word> MmapSegmentAllocator::allocate(uint minimumWords) {
+  size_t alignment = options.hugePages ? HUGE_PAGE_SIZE : sysconf(_SC_PAGESIZE);
+  size_t size = minimumWords * sizeof(word);
+  size = (size + alignment - 1) / alignment * alignment;
+
+  void* mapping = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (options.hugePages) {
+    // Fails with ENOMEM if no huge pages are reserved; fall through to ordinary pages.
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (mapping == MAP_FAILED) {
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+      KJ_FAIL_SYSCALL("mmap", errno, size);
+    }
+#ifdef MADV_HUGEPAGE
+    if (options.hugePages) {
+      // Only a hint; transparent huge pages may be disabled.
+      madvise(mapping, size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  KJ_IF_MAYBE(node, options.numaNode) {
+    KJ_ON_SCOPE_FAILURE(munmap(mapping, size));
+    // No page has been touched yet, so the policy applies to all of them.
+    bindToNode(mapping, size, *node);
+  }
+
+  return kj::arrayPtr(reinterpret_cast<word*>(mapping), size / sizeof(word));
+}
+
+void MmapSegmentAllocator::release(kj::ArrayPtr<word> segment, size_t wordsUsed) {
+  KJ_SYSCALL(munmap(segment.begin(), segment.size() * sizeof(word)));
+}
+
+}  // namespace capnp
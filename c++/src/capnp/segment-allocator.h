@@ -0,0 +1,101 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef CAPNP_SEGMENT_ALLOCATOR_H_
+#define CAPNP_SEGMENT_ALLOCATOR_H_
+
+#include "message.h"
+#include <kj/vector.h>
+
+namespace capnp {
+
+class PooledSegmentAllocator final: public SegmentAllocator {
+  // Keeps released segments on free lists, bucketed by power-of-two size, and hands them out
+  // again instead of going back to calloc() -- or to another SegmentAllocator, if one is given.
+  // Requests are rounded up to a power of two so that blocks fit interchangeably.  A released
+  // block is re-zeroed only as far as its message actually wrote, which for the typical message
+  // that uses a fraction of its segment is much cheaper than calloc() clearing the whole thing.
+  //
+  // Like MessageBuilderPool, this is not thread-safe:  all builders using a given allocator must
+  // live in the same thread, and the allocator must outlive them.
+
+public:
+  explicit PooledSegmentAllocator(size_t maxRetainedWords = 1 << 20);
+  explicit PooledSegmentAllocator(SegmentAllocator& backing, size_t maxRetainedWords = 1 << 20);
+  // At most `maxRetainedWords` words of idle blocks are kept; beyond that, released blocks are
+  // returned to `backing` (or free()d).
+
+  KJ_DISALLOW_COPY(PooledSegmentAllocator);
+  ~PooledSegmentAllocator() noexcept(false);
+
+  kj::ArrayPtr<word> allocate(uint minimumWords) override;
+  void release(kj::ArrayPtr<word> segment, size_t wordsUsed) override;
+
+  inline size_t getRetainedWords() const { return retainedWords; }
+  // Total size of the idle blocks currently pooled.
+
+private:
+  kj::Maybe<SegmentAllocator&> backing;
+  size_t maxRetainedWords;
+  size_t retainedWords = 0;
+
+  kj::Vector<kj::ArrayPtr<word>> freeLists[32];
+  // freeLists[i] holds idle blocks of at least 2^i words.
+
+  kj::ArrayPtr<word> allocateBacking(uint size);
+  void releaseBacking(kj::ArrayPtr<word> segment, size_t wordsUsed);
+};
+
+class MmapSegmentAllocator final: public SegmentAllocator {
+  // Maps each segment directly with mmap(), which makes it possible to back large messages with
+  // huge pages and to place them on a particular NUMA node.  Fresh anonymous mappings are already
+  // zero, so nothing is ever cleared, but every segment costs a pair of system calls; stack a
+  // PooledSegmentAllocator on top of this one if builders come and go frequently.
+  //
+  // This allocator holds no state, so it may be shared between threads.
+
+public:
+  struct Options {
+    bool hugePages = false;
+    // Round segments up to a multiple of the huge page size (2 MiB) and map them with
+    // MAP_HUGETLB.  If no huge pages are reserved, falls back to ordinary pages with
+    // madvise(MADV_HUGEPAGE), which lets transparent huge pages kick in where enabled.
+
+    kj::Maybe<uint> numaNode;
+    // If set, segment memory is preferentially placed on this NUMA node.
+  };
+
+  MmapSegmentAllocator();
+  explicit MmapSegmentAllocator(Options options);
+
+  kj::ArrayPtr<word> allocate(uint minimumWords) override;
+  void release(kj::ArrayPtr<word> segment, size_t wordsUsed) override;
+
+private:
+  Options options;
+};
+
+}  // namespace capnp
+
+#endif  // CAPNP_SEGMENT_ALLOCATOR_H_
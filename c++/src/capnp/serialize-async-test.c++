@@ -23,6 +23,7 @@
 
 #include "serialize-async.h"
 #include "serialize.h"
+#include "serialize-packed.h"
 #include <kj/debug.h>
 #include <kj/thread.h>
 #include <stdlib.h>
@@ -173,6 +174,49 @@ TEST_F(SerializeAsyncTest, ParseAsyncEvenSegmentCount) {
   checkTestMessage(received->getRoot<TestAllTypes>());
 }
 
+TEST_F(SerializeAsyncTest, BufferedInput) {
+  auto ioContext = kj::setupAsyncIo();
+  auto input = ioContext.lowLevelProvider->wrapInputFd(fds[0]);
+  kj::FdOutputStream rawOutput(fds[1]);
+  FragmentingOutputStream output(rawOutput);
+
+  kj::Thread thread([&]() {
+    for (uint i = 0; i < 20; i++) {
+      if (i % 5 == 0) {
+        TestMessageBuilder message(i % 3 + 1);
+        initTestMessage(message.getRoot<TestAllTypes>());
+        writeMessage(output, message);
+      } else {
+        // Small segments so that some of these have several.
+        MallocMessageBuilder message(i % 4 + 1, AllocationStrategy::FIXED_SIZE);
+        message.getRoot<TestAllTypes>().setUInt32Field(i);
+        writeMessage(output, message);
+      }
+    }
+    KJ_SYSCALL(shutdown(fds[1], SHUT_WR));
+  });
+
+  // Use a tiny buffer so that messages straddle chunks and the initTestMessage() ones don't fit
+  // at all.
+  BufferedMessageInput bufferedInput(*input, 64);
+
+  kj::Vector<kj::Own<MessageReader>> readers;
+  for (uint i = 0; i < 20; i++) {
+    readers.add(bufferedInput.readMessage().wait(ioContext.waitScope));
+  }
+
+  // Readers stay valid after later messages have been read.
+  for (uint i = 0; i < 20; i++) {
+    if (i % 5 == 0) {
+      checkTestMessage(readers[i]->getRoot<TestAllTypes>());
+    } else {
+      EXPECT_EQ(i, readers[i]->getRoot<TestAllTypes>().getUInt32Field());
+    }
+  }
+
+  EXPECT_TRUE(bufferedInput.tryReadMessage().wait(ioContext.waitScope) == nullptr);
+}
+
 TEST_F(SerializeAsyncTest, WriteAsync) {
   auto ioContext = kj::setupAsyncIo();
   auto output = ioContext.lowLevelProvider->wrapOutputFd(fds[1]);
@@ -242,6 +286,169 @@ TEST_F(SerializeAsyncTest, WriteAsyncEvenSegmentCount) {
   writeMessage(*output, message).wait(ioContext.waitScope);
 }
 
+TEST_F(SerializeAsyncTest, WriteAsyncBatch) {
+  auto ioContext = kj::setupAsyncIo();
+  auto output = ioContext.lowLevelProvider->wrapOutputFd(fds[1]);
+
+  // Enough messages that the batch has more pieces than writev() accepts at once.
+  constexpr uint MESSAGE_COUNT = 1000;
+
+  auto builders = kj::heapArrayBuilder<kj::Own<TestMessageBuilder>>(MESSAGE_COUNT);
+  auto segments = kj::heapArrayBuilder<kj::ArrayPtr<const kj::ArrayPtr<const word>>>(
+      MESSAGE_COUNT);
+  for (uint i = 0; i < MESSAGE_COUNT; i++) {
+    builders.add(kj::heap<TestMessageBuilder>(i % 3 + 1));
+    auto root = builders.back()->getRoot<TestAllTypes>();
+    root.setUInt32Field(i);
+    root.setTextField("foo");
+    segments.add(builders.back()->getSegmentsForOutput());
+  }
+  auto segmentsArray = segments.finish();
+
+  kj::Thread thread([&]() {
+    for (uint i = 0; i < MESSAGE_COUNT; i++) {
+      StreamFdMessageReader reader(fds[0]);
+      EXPECT_EQ(i, reader.getRoot<TestAllTypes>().getUInt32Field());
+      EXPECT_EQ("foo", reader.getRoot<TestAllTypes>().getTextField());
+    }
+  });
+
+  writeMessages(*output, segmentsArray).wait(ioContext.waitScope);
+}
+
+TEST_F(SerializeAsyncTest, WriteAsyncBatchBuilders) {
+  auto ioContext = kj::setupAsyncIo();
+  auto output = ioContext.lowLevelProvider->wrapOutputFd(fds[1]);
+
+  constexpr uint MESSAGE_COUNT = 100;
+
+  auto messages = kj::heapArrayBuilder<kj::Own<MallocMessageBuilder>>(MESSAGE_COUNT);
+  auto builders = kj::heapArrayBuilder<MessageBuilder*>(MESSAGE_COUNT);
+  for (uint i = 0; i < MESSAGE_COUNT; i++) {
+    messages.add(kj::heap<MallocMessageBuilder>());
+    messages.back()->initRoot<TestAllTypes>().setUInt32Field(i);
+    builders.add(messages.back().get());
+  }
+  auto buildersArray = builders.finish();
+
+  kj::Thread thread([&]() {
+    for (uint i = 0; i < MESSAGE_COUNT; i++) {
+      StreamFdMessageReader reader(fds[0]);
+      EXPECT_EQ(i, reader.getRoot<TestAllTypes>().getUInt32Field());
+    }
+  });
+
+  writeMessages(*output, buildersArray).wait(ioContext.waitScope);
+}
+
+TEST_F(SerializeAsyncTest, ReadPackedAsync) {
+  auto ioContext = kj::setupAsyncIo();
+  auto input = ioContext.lowLevelProvider->wrapInputFd(fds[0]);
+  kj::FdOutputStream rawOutput(fds[1]);
+  FragmentingOutputStream output(rawOutput);
+
+  kj::Thread thread([&]() {
+    TestMessageBuilder message(3);
+    initTestMessage(message.getRoot<TestAllTypes>());
+    writePackedMessage(output, message);
+
+    // An unpacked message right behind it, which readPackedMessage() must not consume.
+    MallocMessageBuilder message2;
+    message2.getRoot<TestAllTypes>().setUInt32Field(123);
+    writeMessage(output, message2);
+    KJ_SYSCALL(shutdown(fds[1], SHUT_WR));
+  });
+
+  auto reader = readPackedMessage(*input).wait(ioContext.waitScope);
+  checkTestMessage(reader->getRoot<TestAllTypes>());
+
+  auto reader2 = readMessage(*input).wait(ioContext.waitScope);
+  EXPECT_EQ(123u, reader2->getRoot<TestAllTypes>().getUInt32Field());
+
+  EXPECT_TRUE(tryReadPackedMessage(*input).wait(ioContext.waitScope) == nullptr);
+}
+
+TEST_F(SerializeAsyncTest, WritePackedAsync) {
+  auto ioContext = kj::setupAsyncIo();
+  auto output = ioContext.lowLevelProvider->wrapOutputFd(fds[1]);
+
+  TestMessageBuilder message(3);
+  initTestMessage(message.getRoot<TestAllTypes>());
+
+  kj::Thread thread([&]() {
+    PackedFdMessageReader reader(fds[0]);
+    checkTestMessage(reader.getRoot<TestAllTypes>());
+  });
+
+  writePackedMessage(*output, message).wait(ioContext.waitScope);
+}
+
+TEST_F(SerializeAsyncTest, PackedInput) {
+  auto ioContext = kj::setupAsyncIo();
+  auto rawInput = ioContext.lowLevelProvider->wrapInputFd(fds[0]);
+  kj::FdOutputStream rawOutput(fds[1]);
+  FragmentingOutputStream output(rawOutput);
+
+  kj::Thread thread([&]() {
+    for (uint i = 0; i < 10; i++) {
+      if (i % 2 == 0) {
+        TestMessageBuilder message(i % 3 + 1);
+        initTestMessage(message.getRoot<TestAllTypes>());
+        writePackedMessage(output, message);
+      } else {
+        MallocMessageBuilder message(i % 4 + 1, AllocationStrategy::FIXED_SIZE);
+        message.getRoot<TestAllTypes>().setUInt32Field(i);
+        writePackedMessage(output, message);
+      }
+    }
+    KJ_SYSCALL(shutdown(fds[1], SHUT_WR));
+  });
+
+  // The fragmenting output and the small buffer make tags and runs straddle reads.
+  PackedAsyncInputStream input(*rawInput, 64);
+  BufferedMessageInput bufferedInput(input, 64);
+
+  for (uint i = 0; i < 10; i++) {
+    auto reader = bufferedInput.readMessage().wait(ioContext.waitScope);
+    if (i % 2 == 0) {
+      checkTestMessage(reader->getRoot<TestAllTypes>());
+    } else {
+      EXPECT_EQ(i, reader->getRoot<TestAllTypes>().getUInt32Field());
+    }
+  }
+
+  EXPECT_TRUE(bufferedInput.tryReadMessage().wait(ioContext.waitScope) == nullptr);
+}
+
+TEST_F(SerializeAsyncTest, PackedOutput) {
+  auto ioContext = kj::setupAsyncIo();
+  auto rawOutput = ioContext.lowLevelProvider->wrapOutputFd(fds[1]);
+  PackedAsyncOutputStream output(*rawOutput);
+
+  TestMessageBuilder message1(1);
+  initTestMessage(message1.getRoot<TestAllTypes>());
+  TestMessageBuilder message2(2);
+  message2.getRoot<TestAllTypes>().setUInt32Field(123);
+
+  kj::Thread thread([&]() {
+    kj::FdInputStream rawInput(fds[0]);
+    kj::BufferedInputStreamWrapper input(rawInput);
+    {
+      PackedMessageReader reader(input);
+      checkTestMessage(reader.getRoot<TestAllTypes>());
+    }
+    {
+      PackedMessageReader reader(input);
+      EXPECT_EQ(123u, reader.getRoot<TestAllTypes>().getUInt32Field());
+    }
+  });
+
+  kj::ArrayPtr<const kj::ArrayPtr<const word>> messages[2] = {
+    message1.getSegmentsForOutput(), message2.getSegmentsForOutput()
+  };
+  writeMessages(output, kj::arrayPtr(messages, 2)).wait(ioContext.waitScope);
+}
+
 }  // namespace
 }  // namespace _ (private)
 }  // namespace capnp
@@ -22,7 +22,10 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "serialize-async.h"
+#include "serialize.h"
+#include "serialize-packed.h"
 #include <kj/debug.h>
+#include <kj/refcount.h>
 
 namespace capnp {
 
@@ -48,6 +51,10 @@ public:
     }
   }
 
+  uint getSegmentCount() override {
+    return segmentCount();
+  }
+
 private:
   _::WireValue<uint32_t> firstWord[2];
   kj::Array<_::WireValue<uint32_t>> moreSizes;
@@ -176,49 +183,337 @@ kj::Promise<kj::Maybe<kj::Own<MessageReader>>> tryReadMessage(
 
 // =======================================================================================
 
-namespace {
+// =======================================================================================
 
-struct WriteArrays {
-  // Holds arrays that must remain valid until a write completes.
+class BufferedMessageInput::Chunk: public kj::Refcounted {
+public:
+  explicit Chunk(size_t size): words(kj::heapArray<word>(size)) {}
+
+  byte* bytes() { return reinterpret_cast<byte*>(words.begin()); }
+  size_t capacity() { return words.size() * sizeof(word); }
 
-  kj::Array<_::WireValue<uint32_t>> table;
-  kj::Array<kj::ArrayPtr<const byte>> pieces;
+  kj::Array<word> words;
 };
 
-}  // namespace
+class BufferedMessageInput::Reader: public FlatArrayMessageReader {
+public:
+  Reader(kj::ArrayPtr<const word> words, ReaderOptions options, kj::Own<Chunk> chunk)
+      : FlatArrayMessageReader(words, options), chunk(kj::mv(chunk)) {}
+
+private:
+  kj::Own<Chunk> chunk;
+};
+
+BufferedMessageInput::BufferedMessageInput(kj::AsyncInputStream& input, size_t bufferWords)
+    : input(input), bufferWords(bufferWords), chunk(kj::refcounted<Chunk>(bufferWords)) {}
+
+BufferedMessageInput::~BufferedMessageInput() noexcept(false) {}
+
+kj::Promise<bool> BufferedMessageInput::fill(size_t bytes) {
+  size_t available = dataEnd - readPos;
+  if (available >= bytes) {
+    return true;
+  }
+
+  if (readPos + bytes > chunk->capacity()) {
+    // Doesn't fit in the rest of this chunk.  Start a new one, leaving the old one to the readers
+    // that still point into it.
+    size_t words = kj::max(bufferWords, (bytes + sizeof(word) - 1) / sizeof(word));
+    auto newChunk = kj::refcounted<Chunk>(words);
+    memcpy(newChunk->bytes(), chunk->bytes() + readPos, available);
+    chunk = kj::mv(newChunk);
+    readPos = 0;
+    dataEnd = available;
+  }
+
+  return input.tryRead(chunk->bytes() + dataEnd, bytes - available, chunk->capacity() - dataEnd)
+      .then([this,bytes](size_t n) {
+    dataEnd += n;
+    return dataEnd - readPos >= bytes;
+  });
+}
+
+kj::Promise<kj::Own<MessageReader>> BufferedMessageInput::readMessage(ReaderOptions options) {
+  return tryReadMessage(options).then([](kj::Maybe<kj::Own<MessageReader>>&& maybeReader) {
+    KJ_IF_MAYBE(reader, maybeReader) {
+      return kj::mv(*reader);
+    } else {
+      KJ_FAIL_REQUIRE("Premature EOF.") {
+        // Hand back an empty message.
+        return kj::Own<MessageReader>(kj::heap<FlatArrayMessageReader>(nullptr));
+      }
+    }
+  });
+}
+
+kj::Promise<kj::Maybe<kj::Own<MessageReader>>> BufferedMessageInput::tryReadMessage(
+    ReaderOptions options) {
+  return fill(sizeof(word)).then([this,options](bool success)
+      -> kj::Promise<kj::Maybe<kj::Own<MessageReader>>> {
+    if (!success) {
+      KJ_REQUIRE(dataEnd == readPos, "Premature EOF.") {
+        return kj::Maybe<kj::Own<MessageReader>>(nullptr);
+      }
+      return kj::Maybe<kj::Own<MessageReader>>(nullptr);
+    }
+
+    return readAfterFirstWord(options);
+  });
+}
+
+kj::Promise<kj::Maybe<kj::Own<MessageReader>>> BufferedMessageInput::readAfterFirstWord(
+    ReaderOptions options) {
+  uint segmentCount =
+      reinterpret_cast<const _::WireValue<uint32_t>*>(chunk->bytes() + readPos)[0].get() + 1;
+
+  // Reject messages with too many segments for security reasons.
+  KJ_REQUIRE(segmentCount < 512, "Message has too many segments.") {
+    return kj::Maybe<kj::Own<MessageReader>>(nullptr);  // exception will be propagated
+  }
+
+  size_t tableBytes = (segmentCount / 2 + 1) * sizeof(word);
+
+  return fill(tableBytes).then([this,options,segmentCount,tableBytes](bool success)
+      -> kj::Promise<kj::Maybe<kj::Own<MessageReader>>> {
+    KJ_REQUIRE(success, "Premature EOF.") {
+      return kj::Maybe<kj::Own<MessageReader>>(nullptr);
+    }
+
+    auto table = reinterpret_cast<const _::WireValue<uint32_t>*>(chunk->bytes() + readPos);
+    size_t totalWords = 0;
+    for (uint i = 0; i < segmentCount; i++) {
+      totalWords += table[i + 1].get();
+    }
+
+    // Don't accept a message which the receiver couldn't possibly traverse without hitting the
+    // traversal limit.  Without this check, a malicious client could transmit a very large
+    // segment size to make the receiver allocate excessive space and possibly crash.
+    KJ_REQUIRE(totalWords <= options.traversalLimitInWords,
+               "Message is too large.  To increase the limit on the receiving end, see "
+               "capnp::ReaderOptions.") {
+      return kj::Maybe<kj::Own<MessageReader>>(nullptr);  // exception will be propagated
+    }
+
+    size_t messageBytes = tableBytes + totalWords * sizeof(word);
+
+    return fill(messageBytes).then([this,options,messageBytes](bool success)
+        -> kj::Maybe<kj::Own<MessageReader>> {
+      KJ_REQUIRE(success, "Premature EOF.") {
+        return nullptr;
+      }
+
+      auto words = kj::arrayPtr(reinterpret_cast<const word*>(chunk->bytes() + readPos),
+                                messageBytes / sizeof(word));
+      readPos += messageBytes;
+      return kj::Own<MessageReader>(kj::heap<Reader>(words, options, kj::addRef(*chunk)));
+    });
+  });
+}
+
+// =======================================================================================
 
 kj::Promise<void> writeMessage(kj::AsyncOutputStream& output,
                                kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
-  KJ_REQUIRE(segments.size() > 0, "Tried to serialize uninitialized message.");
+  return writeMessages(output, kj::arrayPtr(&segments, 1));
+}
+
+kj::Promise<void> writeMessages(
+    kj::AsyncOutputStream& output,
+    kj::ArrayPtr<const kj::ArrayPtr<const kj::ArrayPtr<const word>>> messages) {
+  auto batch = kj::heap<MessageBatch>(messages);
+  auto promise = output.write(batch->getPieces());
+
+  // Make sure the batch isn't freed until the write completes.
+  return promise.attach(kj::mv(batch));
+}
+
+kj::Promise<void> writeMessages(kj::AsyncOutputStream& output,
+                                kj::ArrayPtr<MessageBuilder* const> builders) {
+  auto batch = kj::heap<MessageBatch>(builders);
+  auto promise = output.write(batch->getPieces());
+  return promise.attach(kj::mv(batch));
+}
+
+// =======================================================================================
+
+kj::Promise<kj::Own<MessageReader>> readPackedMessage(
+    kj::AsyncInputStream& input, ReaderOptions options, kj::ArrayPtr<word> scratchSpace) {
+  auto packedInput = kj::heap<PackedAsyncInputStream>(input, 64, false);
+  auto promise = readMessage(*packedInput, options, scratchSpace);
+  return promise.attach(kj::mv(packedInput));
+}
+
+kj::Promise<kj::Maybe<kj::Own<MessageReader>>> tryReadPackedMessage(
+    kj::AsyncInputStream& input, ReaderOptions options, kj::ArrayPtr<word> scratchSpace) {
+  auto packedInput = kj::heap<PackedAsyncInputStream>(input, 64, false);
+  auto promise = tryReadMessage(*packedInput, options, scratchSpace);
+  return promise.attach(kj::mv(packedInput));
+}
+
+kj::Promise<void> writePackedMessage(kj::AsyncOutputStream& output,
+                                     kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
+  // PackedAsyncOutputStream packs synchronously within write(), so it needn't outlive the call.
+  PackedAsyncOutputStream packedOutput(output);
+  return writeMessage(packedOutput, segments);
+}
 
-  WriteArrays arrays;
-  arrays.table = kj::heapArray<_::WireValue<uint32_t>>((segments.size() + 2) & ~size_t(1));
+PackedAsyncInputStream::PackedAsyncInputStream(kj::AsyncInputStream& inner, size_t bufferBytes,
+                                               bool readAhead)
+    : inner(inner), readAhead(readAhead),
+      buffer(kj::heapArray<byte>(kj::max(bufferBytes, size_t(64)))) {}
+PackedAsyncInputStream::~PackedAsyncInputStream() noexcept(false) {}
+
+kj::Promise<size_t> PackedAsyncInputStream::read(void* buffer, size_t minBytes, size_t maxBytes) {
+  return tryReadInternal(reinterpret_cast<byte*>(buffer), minBytes, maxBytes, 0)
+      .then([=](size_t result) {
+    KJ_REQUIRE(result >= minBytes, "Premature EOF") {
+      // Pretend we read zeros from the input.
+      memset(reinterpret_cast<byte*>(buffer) + result, 0, minBytes - result);
+      return minBytes;
+    }
+    return result;
+  });
+}
+
+kj::Promise<size_t> PackedAsyncInputStream::tryRead(
+    void* buffer, size_t minBytes, size_t maxBytes) {
+  return tryReadInternal(reinterpret_cast<byte*>(buffer), minBytes, maxBytes, 0);
+}
+
+size_t PackedAsyncInputStream::unpack(byte* dst, size_t maxBytes) {
+  byte* out = dst;
+  byte* const end = dst + maxBytes;
+
+  while (out < end) {
+    if (partialWordPos < sizeof(word)) {
+      size_t n = kj::min(sizeof(word) - partialWordPos, size_t(end - out));
+      memcpy(out, partialWord + partialWordPos, n);
+      partialWordPos += n;
+      out += n;
+    } else if (zerosRemaining > 0) {
+      size_t n = kj::min(zerosRemaining, size_t(end - out));
+      memset(out, 0, n);
+      zerosRemaining -= n;
+      out += n;
+    } else if (literalRemaining > 0) {
+      size_t n = kj::min(kj::min(literalRemaining, size_t(end - out)), dataEnd - readPos);
+      if (n == 0) break;
+      memcpy(out, buffer.begin() + readPos, n);
+      literalRemaining -= n;
+      readPos += n;
+      out += n;
+    } else {
+      // Decode one tagged word, but only once all of its bytes have arrived.
+      const byte* in = buffer.begin() + readPos;
+      size_t available = dataEnd - readPos;
+      if (available == 0) break;
+
+      byte tag = in[0];
+      size_t needed = 1 + __builtin_popcount(tag) + (tag == 0 || tag == 0xff);
+      if (available < needed) break;
+
+      const byte* pos = in + 1;
+      byte* target = size_t(end - out) >= sizeof(word) ? out : partialWord;
+      for (uint i = 0; i < sizeof(word); i++) {
+        target[i] = (tag & (1u << i)) ? *pos++ : 0;
+      }
+      if (tag == 0) {
+        zerosRemaining = *pos++ * sizeof(word);
+      } else if (tag == 0xff) {
+        literalRemaining = *pos++ * sizeof(word);
+      }
+      readPos += pos - in;
 
-  // We write the segment count - 1 because this makes the first word zero for single-segment
-  // messages, improving compression.  We don't bother doing this with segment sizes because
-  // one-word segments are rare anyway.
-  arrays.table[0].set(segments.size() - 1);
-  for (uint i = 0; i < segments.size(); i++) {
-    arrays.table[i + 1].set(segments[i].size());
+      if (target == out) {
+        out += sizeof(word);
+      } else {
+        partialWordPos = 0;
+      }
+    }
   }
-  if (segments.size() % 2 == 0) {
-    // Set padding byte.
-    arrays.table[segments.size() + 1].set(0);
+
+  return out - dst;
+}
+
+size_t PackedAsyncInputStream::bytesNeeded() {
+  if (literalRemaining > 0) {
+    return literalRemaining;
   }
 
-  arrays.pieces = kj::heapArray<kj::ArrayPtr<const byte>>(segments.size() + 1);
-  arrays.pieces[0] = kj::arrayPtr(reinterpret_cast<byte*>(arrays.table.begin()),
-                                  arrays.table.size() * sizeof(arrays.table[0]));
+  size_t available = dataEnd - readPos;
+  if (available == 0) {
+    return 1;
+  }
 
-  for (uint i = 0; i < segments.size(); i++) {
-    arrays.pieces[i + 1] = kj::arrayPtr(reinterpret_cast<const byte*>(segments[i].begin()),
-                                        reinterpret_cast<const byte*>(segments[i].end()));
+  byte tag = buffer[readPos];
+  return 1 + __builtin_popcount(tag) + (tag == 0 || tag == 0xff) - available;
+}
+
+kj::Promise<size_t> PackedAsyncInputStream::tryReadInternal(
+    byte* dst, size_t minBytes, size_t maxBytes, size_t alreadyRead) {
+  size_t n = unpack(dst, maxBytes);
+  if (n >= minBytes) {
+    return alreadyRead + n;
+  }
+
+  // Need more input.  Whatever is left over is at most a partial tagged word, so move it to the
+  // front of the buffer.
+  if (readPos > 0) {
+    memmove(buffer.begin(), buffer.begin() + readPos, dataEnd - readPos);
+    dataEnd -= readPos;
+    readPos = 0;
   }
 
-  auto promise = output.write(arrays.pieces);
+  size_t maxRead = buffer.size() - dataEnd;
+  if (!readAhead) {
+    maxRead = kj::min(maxRead, bytesNeeded());
+  }
+
+  return inner.tryRead(buffer.begin() + dataEnd, 1, maxRead)
+      .then([this,dst,minBytes,maxBytes,alreadyRead,n](size_t amount) -> kj::Promise<size_t> {
+    if (amount == 0) {
+      KJ_REQUIRE(readPos == dataEnd && literalRemaining == 0,
+                 "Packed input ended in the middle of a word.") {
+        break;
+      }
+      return alreadyRead + n;
+    }
+
+    dataEnd += amount;
+    return tryReadInternal(dst + n, minBytes - n, maxBytes - n, alreadyRead + n);
+  });
+}
+
+PackedAsyncOutputStream::PackedAsyncOutputStream(kj::AsyncOutputStream& inner): inner(inner) {}
+PackedAsyncOutputStream::~PackedAsyncOutputStream() noexcept(false) {}
+
+kj::Promise<void> PackedAsyncOutputStream::write(const void* buffer, size_t size) {
+  kj::ArrayPtr<const byte> piece(reinterpret_cast<const byte*>(buffer), size);
+  return write(kj::arrayPtr(&piece, 1));
+}
+
+kj::Promise<void> PackedAsyncOutputStream::write(
+    kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) {
+  size_t size = 0;
+  for (auto& piece: pieces) {
+    KJ_REQUIRE(piece.size() % sizeof(word) == 0,
+               "PackedAsyncOutputStream can only write whole words.");
+    size += piece.size();
+  }
+
+  // In the worst case, a word packs to ten bytes:  the tag, all eight bytes, and a run count.
+  auto packed = kj::heapArray<byte>(size / sizeof(word) * 10);
+  kj::ArrayOutputStream arrayOutput(packed);
+  {
+    _::PackedOutputStream packedOutput(arrayOutput);
+    for (auto& piece: pieces) {
+      packedOutput.write(piece.begin(), piece.size());
+    }
+  }
+  size_t packedSize = arrayOutput.getArray().size();
 
-  // Make sure the arrays aren't freed until the write completes.
-  return promise.then(kj::mvCapture(arrays, [](WriteArrays&&) {}));
+  auto promise = inner.write(packed.begin(), packedSize);
+  return promise.attach(kj::mv(packed));
 }
 
 }  // namespace capnp
@@ -50,6 +50,156 @@ kj::Promise<void> writeMessage(kj::AsyncOutputStream& output, MessageBuilder& bu
     KJ_WARN_UNUSED_RESULT;
 // Write asynchronously.  The parameters must remain valid until the returned promise resolves.
 
+kj::Promise<void> writeMessages(
+    kj::AsyncOutputStream& output,
+    kj::ArrayPtr<const kj::ArrayPtr<const kj::ArrayPtr<const word>>> messages)
+    KJ_WARN_UNUSED_RESULT;
+kj::Promise<void> writeMessages(kj::AsyncOutputStream& output,
+                                kj::ArrayPtr<MessageBuilder* const> builders)
+    KJ_WARN_UNUSED_RESULT;
+// Write several messages, one after the other, in a single call to `output.write()` (typically a
+// single writev()).  Each element of `messages` is the segment array of one message.  The
+// messages must remain valid until the returned promise resolves, but the arrays describing them
+// need not.  Tiny messages are coalesced into one buffer; see MessageBatch in serialize.h.
+
+class BufferedMessageInput {
+  // Reads a sequence of messages from an AsyncInputStream through a buffer.  Each read() asks for
+  // as much data as the buffer can hold, so a small message usually costs a single read() call and
+  // several messages that arrive together share one.  Messages are parsed in place, without
+  // copying:  each returned MessageReader holds a reference to the buffer chunk it lives in, and
+  // a chunk is freed once all its readers are gone.
+  //
+  // So a reader pins its whole chunk -- 64 KiB with the default `bufferWords` -- however small
+  // its message is.  Drop readers promptly.  To keep a message for a long time, copy it out (e.g.
+  // `setRoot()` it into a MallocMessageBuilder) and drop the reader.
+  //
+  // Only one read may be in progress at a time.  The BufferedMessageInput and the stream must
+  // outlive any read in progress, but not the returned MessageReaders.
+
+public:
+  explicit BufferedMessageInput(kj::AsyncInputStream& input, size_t bufferWords = 8192);
+  // `bufferWords` is the size of each buffer chunk.  A message larger than that gets a chunk of
+  // its own.
+
+  KJ_DISALLOW_COPY(BufferedMessageInput);
+  ~BufferedMessageInput() noexcept(false);
+
+  kj::Promise<kj::Own<MessageReader>> readMessage(ReaderOptions options = ReaderOptions());
+  kj::Promise<kj::Maybe<kj::Own<MessageReader>>> tryReadMessage(
+      ReaderOptions options = ReaderOptions());
+  // Read the next message.  `tryReadMessage()` returns null on a clean EOF between messages.
+
+private:
+  class Chunk;
+  class Reader;
+
+  kj::AsyncInputStream& input;
+  size_t bufferWords;
+
+  kj::Own<Chunk> chunk;
+  size_t readPos = 0;
+  // Byte offset in `chunk` of the start of the next message.
+  size_t dataEnd = 0;
+  // Byte offset in `chunk` just past the data received so far.
+
+  kj::Promise<bool> fill(size_t bytes);
+  // Makes sure at least `bytes` bytes past `readPos` have been received, moving the unconsumed
+  // data to a new chunk first if the current one is too small.  Returns false on EOF.
+
+  kj::Promise<kj::Maybe<kj::Own<MessageReader>>> readAfterFirstWord(ReaderOptions options);
+};
+
+// =======================================================================================
+// Packed streams
+
+kj::Promise<kj::Own<MessageReader>> readPackedMessage(
+    kj::AsyncInputStream& input, ReaderOptions options = ReaderOptions(),
+    kj::ArrayPtr<word> scratchSpace = nullptr);
+kj::Promise<kj::Maybe<kj::Own<MessageReader>>> tryReadPackedMessage(
+    kj::AsyncInputStream& input, ReaderOptions options = ReaderOptions(),
+    kj::ArrayPtr<word> scratchSpace = nullptr);
+// Read a packed message asynchronously, unpacking it as the bytes arrive.  Exactly the bytes of
+// this one message are consumed from `input`, which takes a few small reads per packed word.  To
+// read a sequence of messages from one stream, it is much cheaper to wrap the stream in a
+// PackedAsyncInputStream once and use readMessage() or BufferedMessageInput on that.
+//
+// `input` must remain valid until the returned promise resolves (or is canceled).
+
+kj::Promise<void> writePackedMessage(kj::AsyncOutputStream& output,
+                                     kj::ArrayPtr<const kj::ArrayPtr<const word>> segments)
+    KJ_WARN_UNUSED_RESULT;
+kj::Promise<void> writePackedMessage(kj::AsyncOutputStream& output, MessageBuilder& builder)
+    KJ_WARN_UNUSED_RESULT;
+// Write a packed message asynchronously.  The message is packed up front and then written with a
+// single write() call, so only `output` must remain valid until the returned promise resolves.
+
+class PackedAsyncInputStream final: public kj::AsyncInputStream {
+  // Unpacks data read from `inner` that was written in the packed format (see
+  // serialize-packed.h), e.g. by PackedAsyncOutputStream.  Unlike `_::PackedInputStream`, reads
+  // may be of any size, so packed messages can be read by wrapping the input in one of these and
+  // then using readMessage() or BufferedMessageInput as usual.
+  //
+  // This reads ahead from `inner`, so once wrapped, `inner` must only be read through the wrapper.
+
+public:
+  explicit PackedAsyncInputStream(kj::AsyncInputStream& inner, size_t bufferBytes = 8192,
+                                  bool readAhead = true);
+  // If `readAhead` is false, never reads past the end of the data needed to satisfy the current
+  // read, at the expense of making more, smaller reads.
+  KJ_DISALLOW_COPY(PackedAsyncInputStream);
+  ~PackedAsyncInputStream() noexcept(false);
+
+  // implements AsyncInputStream -------------------------------------
+  kj::Promise<size_t> read(void* buffer, size_t minBytes, size_t maxBytes) override;
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override;
+
+private:
+  kj::AsyncInputStream& inner;
+  bool readAhead;
+
+  kj::Array<byte> buffer;
+  size_t readPos = 0;
+  size_t dataEnd = 0;
+  // Packed bytes received from `inner` and not yet unpacked are in buffer[readPos, dataEnd).
+
+  byte partialWord[sizeof(word)];
+  uint partialWordPos = sizeof(word);
+  // An unpacked word that didn't fit in the caller's buffer.  Bytes from `partialWordPos` on have
+  // yet to be delivered.
+
+  size_t zerosRemaining = 0;
+  size_t literalRemaining = 0;
+  // Bytes still to be delivered from a run of zero words (tag 0x00) or of literal words
+  // (tag 0xff).
+
+  size_t unpack(byte* dst, size_t maxBytes);
+  // Unpacks as much of the buffered input as fits in `dst`.
+
+  size_t bytesNeeded();
+  // After unpack() has run out of input, the number of bytes needed to make further progress.
+
+  kj::Promise<size_t> tryReadInternal(byte* dst, size_t minBytes, size_t maxBytes,
+                                      size_t alreadyRead);
+};
+
+class PackedAsyncOutputStream final: public kj::AsyncOutputStream {
+  // Packs everything written to it and passes the result on to `inner`, one `inner.write()` per
+  // write.  Each write must consist of whole words, which everything written by writeMessage()
+  // and writeMessages() does.
+
+public:
+  explicit PackedAsyncOutputStream(kj::AsyncOutputStream& inner);
+  KJ_DISALLOW_COPY(PackedAsyncOutputStream);
+  ~PackedAsyncOutputStream() noexcept(false);
+
+  // implements AsyncOutputStream ------------------------------------
+  kj::Promise<void> write(const void* buffer, size_t size) override;
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override;
+
+private:
+  kj::AsyncOutputStream& inner;
+};
+
 // =======================================================================================
 // inline implementation details
 
@@ -57,6 +207,11 @@ inline kj::Promise<void> writeMessage(kj::AsyncOutputStream& output, MessageBuil
   return writeMessage(output, builder.getSegmentsForOutput());
 }
 
+inline kj::Promise<void> writePackedMessage(kj::AsyncOutputStream& output,
+                                            MessageBuilder& builder) {
+  return writePackedMessage(output, builder.getSegmentsForOutput());
+}
+
 }  // namespace capnp
 
 #endif  // CAPNP_SERIALIZE_ASYNC_H_
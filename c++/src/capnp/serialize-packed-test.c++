@@ -276,6 +276,53 @@ private:
   uint desiredSegmentCount;
 };
 
+TEST(Packed, AllTags) {
+  // Exercise every tag value through the fast path, with the words back-to-back in one stream so
+  // that the vectorized kernels see every combination of compaction and expansion.
+
+  std::string unpacked;
+  std::string expected;
+  for (uint tag = 0; tag < 256; tag++) {
+    expected.push_back(tag);
+    for (uint i = 0; i < 8; i++) {
+      if (tag & (1u << i)) {
+        unpacked.push_back((tag * 8 + i) % 255 + 1);
+        expected.push_back(unpacked.back());
+      } else {
+        unpacked.push_back(0);
+      }
+    }
+    if (tag == 0 || tag == 0xff) {
+      // Run length.  The next word never continues the run.
+      expected.push_back(0);
+    }
+  }
+
+  TestPipe pipe;
+  {
+    kj::BufferedOutputStreamWrapper bufferedOut(pipe);
+    PackedOutputStream packedOut(bufferedOut);
+    packedOut.write(unpacked.data(), unpacked.size());
+  }
+  if (pipe.getData() != expected) {
+    ADD_FAILURE()
+        << "Expected: " << DisplayByteArray(expected) << "\n"
+        << "Actual:   " << DisplayByteArray(pipe.getData());
+  }
+
+  for (uint blockSize: {1u, 7u, 64u, 0xffffffffu}) {
+    pipe.resetRead(blockSize);
+    std::string roundTrip;
+    roundTrip.resize(unpacked.size());
+    {
+      PackedInputStream packedIn(pipe);
+      packedIn.InputStream::read(&*roundTrip.begin(), roundTrip.size());
+      EXPECT_TRUE(pipe.allRead());
+    }
+    EXPECT_TRUE(roundTrip == unpacked) << "Block size: " << blockSize;
+  }
+}
+
 TEST(Packed, RoundTrip) {
   TestMessageBuilder builder(1);
   initTestMessage(builder.initRoot<TestAllTypes>());
@@ -287,6 +334,38 @@ TEST(Packed, RoundTrip) {
   checkTestMessage(reader.getRoot<TestAllTypes>());
 }
 
+TEST(Packed, WriteToArray) {
+  for (uint segmentCount: {1, 7, 10}) {
+    TestMessageBuilder builder(segmentCount);
+    initTestMessage(builder.initRoot<TestAllTypes>());
+
+    TestPipe pipe;
+    writePackedMessage(pipe, builder);
+
+    auto buffer = kj::heapArray<byte>(computePackedSizeUpperBoundInBytes(builder));
+    kj::ArrayPtr<byte> written = writePackedMessage(buffer, builder);
+    EXPECT_EQ(buffer.begin(), written.begin());
+    EXPECT_EQ(pipe.getData(), std::string(reinterpret_cast<char*>(written.begin()), written.size()));
+  }
+}
+
+TEST(Packed, UpperBoundIsEnough) {
+  // Bytes which are all nonzero make packing expand the data as much as it can.
+  MallocMessageBuilder builder;
+  auto data = builder.initRoot<TestAllTypes>().initDataField(4096);
+  memset(data.begin(), 0xab, data.size());
+
+  auto buffer = kj::heapArray<byte>(computePackedSizeUpperBoundInBytes(builder));
+  kj::ArrayPtr<byte> written = writePackedMessage(buffer, builder);
+  EXPECT_LE(written.size(), buffer.size());
+
+  kj::ArrayInputStream input(written);
+  PackedMessageReader reader(input);
+  auto readData = reader.getRoot<TestAllTypes>().getDataField();
+  ASSERT_EQ(4096u, readData.size());
+  EXPECT_EQ(0xab, readData[4095]);
+}
+
 TEST(Packed, RoundTripScratchSpace) {
   TestMessageBuilder builder(1);
   initTestMessage(builder.initRoot<TestAllTypes>());
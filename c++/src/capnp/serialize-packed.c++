@@ -26,14 +26,154 @@
 #include "layout.h"
 #include <vector>
 
+#if !defined(CAPNP_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define CAPNP_PACKED_SSSE3 1
+#include <tmmintrin.h>
+#else
+#define CAPNP_PACKED_SSSE3 0
+#endif
+
 namespace capnp {
 
 namespace _ {  // private
 
-PackedInputStream::PackedInputStream(kj::BufferedInputStream& inner): inner(inner) {}
-PackedInputStream::~PackedInputStream() noexcept(false) {}
+namespace {
 
-size_t PackedInputStream::tryRead(void* dst, size_t minBytes, size_t maxBytes) {
+// =======================================================================================
+// Word kernels
+//
+// The packing loops below are written against a "kernel" which knows how to compute the tag of
+// one word and compact it (pack), or expand one word given its tag (unpack).  The loops are
+// templates instantiated once per kernel, and we pick an instantiation at runtime based on what
+// the CPU supports.
+//
+// Both kernels may touch all 8 bytes on either side of the word, regardless of the tag.  The
+// loops only use them on the fast path, where the buffers are known to have room for that.
+
+struct ScalarKernel {
+  inline uint8_t pack(const uint8_t* __restrict__ in, uint8_t* __restrict__& out) {
+#define HANDLE_BYTE(n) \
+    uint8_t bit##n = in[n] != 0; \
+    *out = in[n]; \
+    out += bit##n; /* out only advances if the byte was non-zero */
+
+    HANDLE_BYTE(0);
+    HANDLE_BYTE(1);
+    HANDLE_BYTE(2);
+    HANDLE_BYTE(3);
+    HANDLE_BYTE(4);
+    HANDLE_BYTE(5);
+    HANDLE_BYTE(6);
+    HANDLE_BYTE(7);
+#undef HANDLE_BYTE
+
+    return (bit0 << 0) | (bit1 << 1) | (bit2 << 2) | (bit3 << 3)
+         | (bit4 << 4) | (bit5 << 5) | (bit6 << 6) | (bit7 << 7);
+  }
+
+  inline void unpack(uint8_t tag, const uint8_t* __restrict__& in, uint8_t* __restrict__ out) {
+#define HANDLE_BYTE(n) \
+    { \
+       bool isNonzero = (tag & (1u << n)) != 0; \
+       out[n] = *in & (-(int8_t)isNonzero); \
+       in += isNonzero; \
+    }
+
+    HANDLE_BYTE(0);
+    HANDLE_BYTE(1);
+    HANDLE_BYTE(2);
+    HANDLE_BYTE(3);
+    HANDLE_BYTE(4);
+    HANDLE_BYTE(5);
+    HANDLE_BYTE(6);
+    HANDLE_BYTE(7);
+#undef HANDLE_BYTE
+  }
+};
+
+#if CAPNP_PACKED_SSSE3
+
+struct ShuffleTables {
+  // pshufb control vectors indexed by tag.  An index with the high bit set produces a zero byte.
+
+  uint8_t pack[256][8];
+  // Moves the bytes selected by the tag to the front of the word.
+
+  uint8_t unpack[256][8];
+  // Inverse of `pack`:  spreads the first popcount(tag) bytes out to the positions set in the tag.
+
+  uint8_t popcount[256];
+
+  ShuffleTables() {
+    for (uint tag = 0; tag < 256; tag++) {
+      uint count = 0;
+      for (uint i = 0; i < 8; i++) {
+        pack[tag][i] = 0x80;
+        if (tag & (1u << i)) {
+          unpack[tag][i] = count;
+          pack[tag][count++] = i;
+        } else {
+          unpack[tag][i] = 0x80;
+        }
+      }
+      popcount[tag] = count;
+    }
+  }
+};
+
+const ShuffleTables& shuffleTables() {
+  static const ShuffleTables tables;
+  return tables;
+}
+
+bool haveSsse3() {
+  static const bool result = __builtin_cpu_supports("ssse3");
+  return result;
+}
+
+struct Ssse3Kernel {
+  // Computes the tag with a compare + movemask and does the compaction / expansion with a single
+  // shuffle, instead of eight dependent byte steps.
+
+  const ShuffleTables& tables;
+
+  Ssse3Kernel(): tables(shuffleTables()) {}
+
+  __attribute__((target("ssse3")))
+  inline uint8_t pack(const uint8_t* __restrict__ in, uint8_t* __restrict__& out) {
+    __m128i value = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+    uint8_t tag = static_cast<uint8_t>(
+        ~_mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())));
+    __m128i control = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(tables.pack[tag]));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(value, control));
+    out += tables.popcount[tag];
+    return tag;
+  }
+
+  __attribute__((target("ssse3")))
+  inline void unpack(uint8_t tag, const uint8_t* __restrict__& in, uint8_t* __restrict__ out) {
+    __m128i value = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+    __m128i control = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(tables.unpack[tag]));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(value, control));
+    in += tables.popcount[tag];
+  }
+};
+
+#endif  // CAPNP_PACKED_SSSE3
+
+// =======================================================================================
+
+template <typename Kernel>
+KJ_ALWAYS_INLINE(size_t tryReadPacked(kj::BufferedInputStream& inner,
+                                      void* dst, size_t minBytes, size_t maxBytes));
+template <typename Kernel>
+KJ_ALWAYS_INLINE(void writePacked(kj::BufferedOutputStream& inner,
+                                  const void* src, size_t size));
+
+template <typename Kernel>
+inline size_t tryReadPacked(kj::BufferedInputStream& inner,
+                            void* dst, size_t minBytes, size_t maxBytes) {
   if (maxBytes == 0) {
     return 0;
   }
@@ -50,6 +190,7 @@ size_t PackedInputStream::tryRead(void* dst, size_t minBytes, size_t maxBytes) {
     return 0;
   }
   const uint8_t* __restrict__ in = reinterpret_cast<const uint8_t*>(buffer.begin());
+  Kernel kernel;
 
 #define REFRESH_BUFFER() \
   inner.skip(buffer.size()); \
@@ -101,23 +242,8 @@ size_t PackedInputStream::tryRead(void* dst, size_t minBytes, size_t maxBytes) {
       }
     } else {
       tag = *in++;
-
-#define HANDLE_BYTE(n) \
-      { \
-         bool isNonzero = (tag & (1u << n)) != 0; \
-         *out++ = *in & (-(int8_t)isNonzero); \
-         in += isNonzero; \
-      }
-
-      HANDLE_BYTE(0);
-      HANDLE_BYTE(1);
-      HANDLE_BYTE(2);
-      HANDLE_BYTE(3);
-      HANDLE_BYTE(4);
-      HANDLE_BYTE(5);
-      HANDLE_BYTE(6);
-      HANDLE_BYTE(7);
-#undef HANDLE_BYTE
+      kernel.unpack(tag, in, out);
+      out += 8;
     }
 
     if (tag == 0) {
@@ -182,6 +308,154 @@ size_t PackedInputStream::tryRead(void* dst, size_t minBytes, size_t maxBytes) {
 #undef REFRESH_BUFFER
 }
 
+template <typename Kernel>
+inline void writePacked(kj::BufferedOutputStream& inner, const void* src, size_t size) {
+  kj::ArrayPtr<byte> buffer = inner.getWriteBuffer();
+  byte slowBuffer[20];
+
+  uint8_t* __restrict__ out = reinterpret_cast<uint8_t*>(buffer.begin());
+
+  const uint8_t* __restrict__ in = reinterpret_cast<const uint8_t*>(src);
+  const uint8_t* const inEnd = reinterpret_cast<const uint8_t*>(src) + size;
+  Kernel kernel;
+
+  while (in < inEnd) {
+    if (reinterpret_cast<uint8_t*>(buffer.end()) - out < 10) {
+      // Oops, we're out of space.  We need at least 10 bytes for the fast path, since we don't
+      // bounds-check on every byte.
+
+      // Write what we have so far.
+      inner.write(buffer.begin(), out - reinterpret_cast<uint8_t*>(buffer.begin()));
+
+      // Use a slow buffer into which we'll encode 10 to 20 bytes.  This should get us past the
+      // output stream's buffer boundary.
+      buffer = kj::arrayPtr(slowBuffer, sizeof(slowBuffer));
+      out = reinterpret_cast<uint8_t*>(buffer.begin());
+    }
+
+    uint8_t* tagPos = out++;
+    uint8_t tag = kernel.pack(in, out);
+    in += 8;
+    *tagPos = tag;
+
+    if (tag == 0) {
+      // An all-zero word is followed by a count of consecutive zero words (not including the
+      // first one).
+
+      // We can check a whole word at a time.
+      const uint64_t* inWord = reinterpret_cast<const uint64_t*>(in);
+
+      // The count must fit it 1 byte, so limit to 255 words.
+      const uint64_t* limit = reinterpret_cast<const uint64_t*>(inEnd);
+      if (limit - inWord > 255) {
+        limit = inWord + 255;
+      }
+
+      while (inWord < limit && *inWord == 0) {
+        ++inWord;
+      }
+
+      // Write the count.
+      *out++ = inWord - reinterpret_cast<const uint64_t*>(in);
+
+      // Advance input.
+      in = reinterpret_cast<const uint8_t*>(inWord);
+
+    } else if (tag == 0xffu) {
+      // An all-nonzero word is followed by a count of consecutive uncompressed words, followed
+      // by the uncompressed words themselves.
+
+      // Count the number of consecutive words in the input which have no more than a single
+      // zero-byte.  We look for at least two zeros because that's the point where our compression
+      // scheme becomes a net win.
+      // TODO(perf):  Maybe look for three zeros?  Compressing a two-zero word is a loss if the
+      //   following word has no zeros.
+      const uint8_t* runStart = in;
+
+      const uint8_t* limit = inEnd;
+      if ((size_t)(limit - in) > 255 * sizeof(word)) {
+        limit = in + 255 * sizeof(word);
+      }
+
+      while (in < limit) {
+        // Check eight input bytes for zeros.
+        uint c = *in++ == 0;
+        c += *in++ == 0;
+        c += *in++ == 0;
+        c += *in++ == 0;
+        c += *in++ == 0;
+        c += *in++ == 0;
+        c += *in++ == 0;
+        c += *in++ == 0;
+
+        if (c >= 2) {
+          // Un-read the word with multiple zeros, since we'll want to compress that one.
+          in -= 8;
+          break;
+        }
+      }
+
+      // Write the count.
+      uint count = in - runStart;
+      *out++ = count / sizeof(word);
+
+      if (count <= reinterpret_cast<uint8_t*>(buffer.end()) - out) {
+        // There's enough space to memcpy.
+        memcpy(out, runStart, count);
+        out += count;
+      } else {
+        // Input overruns the output buffer.  We'll give it to the output stream in one chunk
+        // and let it decide what to do.
+        inner.write(buffer.begin(), reinterpret_cast<byte*>(out) - buffer.begin());
+        inner.write(runStart, in - runStart);
+        buffer = inner.getWriteBuffer();
+        out = reinterpret_cast<uint8_t*>(buffer.begin());
+      }
+    }
+  }
+
+  // Write whatever is left.
+  inner.write(buffer.begin(), reinterpret_cast<byte*>(out) - buffer.begin());
+}
+
+size_t tryReadPackedScalar(kj::BufferedInputStream& inner,
+                           void* dst, size_t minBytes, size_t maxBytes) {
+  return tryReadPacked<ScalarKernel>(inner, dst, minBytes, maxBytes);
+}
+
+void writePackedScalar(kj::BufferedOutputStream& inner, const void* src, size_t size) {
+  writePacked<ScalarKernel>(inner, src, size);
+}
+
+#if CAPNP_PACKED_SSSE3
+
+__attribute__((target("ssse3")))
+size_t tryReadPackedSsse3(kj::BufferedInputStream& inner,
+                          void* dst, size_t minBytes, size_t maxBytes) {
+  return tryReadPacked<Ssse3Kernel>(inner, dst, minBytes, maxBytes);
+}
+
+__attribute__((target("ssse3")))
+void writePackedSsse3(kj::BufferedOutputStream& inner, const void* src, size_t size) {
+  writePacked<Ssse3Kernel>(inner, src, size);
+}
+
+#endif  // CAPNP_PACKED_SSSE3
+
+}  // namespace
+
+PackedInputStream::PackedInputStream(kj::BufferedInputStream& inner): inner(inner) {}
+PackedInputStream::~PackedInputStream() noexcept(false) {}
+
+size_t PackedInputStream::tryRead(void* dst, size_t minBytes, size_t maxBytes) {
+#if CAPNP_PACKED_SSSE3
+  if (haveSsse3()) {
+    return tryReadPackedSsse3(inner, dst, minBytes, maxBytes);
+  }
+#endif
+  return tryReadPackedScalar(inner, dst, minBytes, maxBytes);
+}
+
 void PackedInputStream::skip(size_t bytes) {
   // We can't just read into buffers because buffers must end on block boundaries.
 
@@ -305,128 +579,13 @@ PackedOutputStream::PackedOutputStream(kj::BufferedOutputStream& inner)
 PackedOutputStream::~PackedOutputStream() noexcept(false) {}
 
 void PackedOutputStream::write(const void* src, size_t size) {
-  kj::ArrayPtr<byte> buffer = inner.getWriteBuffer();
-  byte slowBuffer[20];
-
-  uint8_t* __restrict__ out = reinterpret_cast<uint8_t*>(buffer.begin());
-
-  const uint8_t* __restrict__ in = reinterpret_cast<const uint8_t*>(src);
-  const uint8_t* const inEnd = reinterpret_cast<const uint8_t*>(src) + size;
-
-  while (in < inEnd) {
-    if (reinterpret_cast<uint8_t*>(buffer.end()) - out < 10) {
-      // Oops, we're out of space.  We need at least 10 bytes for the fast path, since we don't
-      // bounds-check on every byte.
-
-      // Write what we have so far.
-      inner.write(buffer.begin(), out - reinterpret_cast<uint8_t*>(buffer.begin()));
-
-      // Use a slow buffer into which we'll encode 10 to 20 bytes.  This should get us past the
-      // output stream's buffer boundary.
-      buffer = kj::arrayPtr(slowBuffer, sizeof(slowBuffer));
-      out = reinterpret_cast<uint8_t*>(buffer.begin());
-    }
-
-    uint8_t* tagPos = out++;
-
-#define HANDLE_BYTE(n) \
-    uint8_t bit##n = *in != 0; \
-    *out = *in; \
-    out += bit##n; /* out only advances if the byte was non-zero */ \
-    ++in
-
-    HANDLE_BYTE(0);
-    HANDLE_BYTE(1);
-    HANDLE_BYTE(2);
-    HANDLE_BYTE(3);
-    HANDLE_BYTE(4);
-    HANDLE_BYTE(5);
-    HANDLE_BYTE(6);
-    HANDLE_BYTE(7);
-#undef HANDLE_BYTE
-
-    uint8_t tag = (bit0 << 0) | (bit1 << 1) | (bit2 << 2) | (bit3 << 3)
-                | (bit4 << 4) | (bit5 << 5) | (bit6 << 6) | (bit7 << 7);
-    *tagPos = tag;
-
-    if (tag == 0) {
-      // An all-zero word is followed by a count of consecutive zero words (not including the
-      // first one).
-
-      // We can check a whole word at a time.
-      const uint64_t* inWord = reinterpret_cast<const uint64_t*>(in);
-
-      // The count must fit it 1 byte, so limit to 255 words.
-      const uint64_t* limit = reinterpret_cast<const uint64_t*>(inEnd);
-      if (limit - inWord > 255) {
-        limit = inWord + 255;
-      }
-
-      while (inWord < limit && *inWord == 0) {
-        ++inWord;
-      }
-
-      // Write the count.
-      *out++ = inWord - reinterpret_cast<const uint64_t*>(in);
-
-      // Advance input.
-      in = reinterpret_cast<const uint8_t*>(inWord);
-
-    } else if (tag == 0xffu) {
-      // An all-nonzero word is followed by a count of consecutive uncompressed words, followed
-      // by the uncompressed words themselves.
-
-      // Count the number of consecutive words in the input which have no more than a single
-      // zero-byte.  We look for at least two zeros because that's the point where our compression
-      // scheme becomes a net win.
-      // TODO(perf):  Maybe look for three zeros?  Compressing a two-zero word is a loss if the
-      //   following word has no zeros.
-      const uint8_t* runStart = in;
-
-      const uint8_t* limit = inEnd;
-      if ((size_t)(limit - in) > 255 * sizeof(word)) {
-        limit = in + 255 * sizeof(word);
-      }
-
-      while (in < limit) {
-        // Check eight input bytes for zeros.
-        uint c = *in++ == 0;
-        c += *in++ == 0;
-        c += *in++ == 0;
-        c += *in++ == 0;
-        c += *in++ == 0;
-        c += *in++ == 0;
-        c += *in++ == 0;
-        c += *in++ == 0;
-
-        if (c >= 2) {
-          // Un-read the word with multiple zeros, since we'll want to compress that one.
-          in -= 8;
-          break;
-        }
-      }
-
-      // Write the count.
-      uint count = in - runStart;
-      *out++ = count / sizeof(word);
-
-      if (count <= reinterpret_cast<uint8_t*>(buffer.end()) - out) {
-        // There's enough space to memcpy.
-        memcpy(out, runStart, count);
-        out += count;
-      } else {
-        // Input overruns the output buffer.  We'll give it to the output stream in one chunk
-        // and let it decide what to do.
-        inner.write(buffer.begin(), reinterpret_cast<byte*>(out) - buffer.begin());
-        inner.write(runStart, in - runStart);
-        buffer = inner.getWriteBuffer();
-        out = reinterpret_cast<uint8_t*>(buffer.begin());
-      }
-    }
+#if CAPNP_PACKED_SSSE3
+  if (haveSsse3()) {
+    writePackedSsse3(inner, src, size);
+    return;
   }
-
-  // Write whatever is left.
-  inner.write(buffer.begin(), reinterpret_cast<byte*>(out) - buffer.begin());
+#endif
+  writePackedScalar(inner, src, size);
 }
 
 }  // namespace _ (private)
@@ -478,4 +637,15 @@ void writePackedMessageToFd(int fd, kj::ArrayPtr<const kj::ArrayPtr<const word>>
   writePackedMessage(output, segments);
 }
 
+size_t computePackedSizeUpperBoundInBytes(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
+  return computeSerializedSizeInWords(segments) * 10;
+}
+
+kj::ArrayPtr<byte> writePackedMessage(kj::ArrayPtr<byte> output,
+                                      kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
+  kj::ArrayOutputStream arrayOutput(output);
+  writePackedMessage(arrayOutput, segments);
+  return arrayOutput.getArray();
+}
+
 }  // namespace capnp
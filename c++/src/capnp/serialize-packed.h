@@ -104,6 +104,19 @@ void writePackedMessageToFd(int fd, MessageBuilder& builder);
 void writePackedMessageToFd(int fd, kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
 // Write a single packed message to the file descriptor.
 
+size_t computePackedSizeUpperBoundInBytes(MessageBuilder& builder);
+size_t computePackedSizeUpperBoundInBytes(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
+// Returns a size that the packed encoding of the message is guaranteed not to exceed, from the
+// segment sizes alone.  Packing never grows a word by more than two bytes (a tag byte, plus a
+// run-length byte after an all-nonzero word), so this is 10 bytes per word of
+// computeSerializedSizeInWords().  The exact packed size depends on the content.
+
+kj::ArrayPtr<byte> writePackedMessage(kj::ArrayPtr<byte> output, MessageBuilder& builder);
+kj::ArrayPtr<byte> writePackedMessage(kj::ArrayPtr<byte> output,
+                                      kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
+// Write a packed message into a caller-provided buffer, which must be at least
+// computePackedSizeUpperBoundInBytes() bytes.  Returns the prefix of `output` that was filled.
+
 // =======================================================================================
 // inline stuff
 
@@ -119,6 +132,14 @@ inline void writePackedMessageToFd(int fd, MessageBuilder& builder) {
   writePackedMessageToFd(fd, builder.getSegmentsForOutput());
 }
 
+inline size_t computePackedSizeUpperBoundInBytes(MessageBuilder& builder) {
+  return computePackedSizeUpperBoundInBytes(builder.getSegmentsForOutput());
+}
+
+inline kj::ArrayPtr<byte> writePackedMessage(kj::ArrayPtr<byte> output, MessageBuilder& builder) {
+  return writePackedMessage(output, builder.getSegmentsForOutput());
+}
+
 }  // namespace capnp
 
 #endif  // CAPNP_SERIALIZE_PACKED_H_
@@ -23,6 +23,8 @@
 
 #include "serialize.h"
 #include <kj/debug.h>
+#include <kj/thread.h>
+#include <kj/vector.h>
 #include <gtest/gtest.h>
 #include <string>
 #include <stdlib.h>
@@ -93,6 +95,49 @@ TEST(Serialize, FlatArrayEvenSegmentCount) {
   checkTestMessage(reader.getRoot<TestAllTypes>());
 }
 
+TEST(Serialize, WriteMessageToArray) {
+  for (uint segmentCount: {1, 7, 10}) {
+    TestMessageBuilder builder(segmentCount);
+    initTestMessage(builder.initRoot<TestAllTypes>());
+
+    kj::Array<word> expected = messageToFlatArray(builder);
+    size_t size = computeSerializedSizeInWords(builder);
+    EXPECT_EQ(expected.size(), size);
+
+    // One word of slack, to check that the returned prefix is exact.
+    kj::Array<word> buffer = kj::heapArray<word>(size + 1);
+    kj::ArrayPtr<word> written = writeMessage(buffer, builder);
+    EXPECT_EQ(buffer.begin(), written.begin());
+    ASSERT_EQ(size, written.size());
+    EXPECT_EQ(0, memcmp(expected.begin(), written.begin(), size * sizeof(word)));
+
+    FlatArrayMessageReader reader(written);
+    checkTestMessage(reader.getRoot<TestAllTypes>());
+
+    EXPECT_ANY_THROW(writeMessage(buffer.slice(0, size - 1), builder));
+  }
+}
+
+TEST(Serialize, FlatArrayConcurrentReaders) {
+  // Many threads traversing the same multi-segment message share its segment table.
+  TestMessageBuilder builder(10);
+  initTestMessage(builder.initRoot<TestAllTypes>());
+
+  kj::Array<word> serialized = messageToFlatArray(builder);
+
+  FlatArrayMessageReader reader(serialized.asPtr());
+  TestAllTypes::Reader root = reader.getRoot<TestAllTypes>();
+
+  kj::Vector<kj::Own<kj::Thread>> threads;
+  for (uint i = 0; i < 4; i++) {
+    threads.add(kj::heap<kj::Thread>([root]() {
+      for (uint j = 0; j < 16; j++) {
+        checkTestMessage(root);
+      }
+    }));
+  }
+}
+
 class TestInputStream: public kj::InputStream {
 public:
   TestInputStream(kj::ArrayPtr<const word> data, bool lazy)
@@ -200,6 +245,106 @@ TEST(Serialize, InputStreamEvenSegmentCountLazy) {
   checkTestMessage(reader.getRoot<TestAllTypes>());
 }
 
+kj::Array<word> makeMessageLog() {
+  // Serializes 20 messages back-to-back:  every fifth one is a full test message (with up to
+  // three segments), the rest are tiny.
+
+  kj::Vector<kj::Array<word>> messages;
+  size_t total = 0;
+  for (uint i = 0; i < 20; i++) {
+    if (i % 5 == 0) {
+      TestMessageBuilder builder(i % 3 + 1);
+      initTestMessage(builder.initRoot<TestAllTypes>());
+      messages.add(messageToFlatArray(builder));
+    } else {
+      MallocMessageBuilder builder(i % 4 + 1, AllocationStrategy::FIXED_SIZE);
+      builder.initRoot<TestAllTypes>().setUInt32Field(i);
+      messages.add(messageToFlatArray(builder));
+    }
+    total += messages.back().size();
+  }
+
+  auto result = kj::heapArray<word>(total);
+  word* pos = result.begin();
+  for (auto& message: messages) {
+    memcpy(pos, message.begin(), message.size() * sizeof(word));
+    pos += message.size();
+  }
+  return result;
+}
+
+class TrickleInputStream: public kj::InputStream {
+  // Returns no more than `minBytes` from each read, and supports EOF.
+
+public:
+  TrickleInputStream(kj::ArrayPtr<const word> data)
+      : pos(reinterpret_cast<const char*>(data.begin())),
+        end(reinterpret_cast<const char*>(data.end())) {}
+
+  size_t tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    size_t amount = kj::min(minBytes, size_t(end - pos));
+    memcpy(buffer, pos, amount);
+    pos += amount;
+    return amount;
+  }
+
+private:
+  const char* pos;
+  const char* end;
+};
+
+void checkMessageLog(BufferedInputStreamMessageReader& reader) {
+  for (uint i = 0; i < 20; i++) {
+    ASSERT_TRUE(reader.nextMessage());
+    if (i % 5 == 0) {
+      checkTestMessage(reader.getRoot<TestAllTypes>());
+    } else {
+      EXPECT_EQ(i, reader.getRoot<TestAllTypes>().getUInt32Field());
+    }
+  }
+  EXPECT_FALSE(reader.nextMessage());
+}
+
+TEST(Serialize, BufferedInputStreamReaderInPlace) {
+  auto log = makeMessageLog();
+  kj::ArrayInputStream stream(kj::arrayPtr(reinterpret_cast<const byte*>(log.begin()),
+                                           log.size() * sizeof(word)));
+  BufferedInputStreamMessageReader reader(stream);
+
+  checkMessageLog(reader);
+
+  // Everything is buffered, so messages are read straight out of the input.
+  kj::ArrayInputStream stream2(kj::arrayPtr(reinterpret_cast<const byte*>(log.begin()),
+                                            log.size() * sizeof(word)));
+  BufferedInputStreamMessageReader reader2(stream2);
+  ASSERT_TRUE(reader2.nextMessage());
+  EXPECT_EQ(log.begin() + 1, reader2.getSegment(0).begin());
+}
+
+TEST(Serialize, BufferedInputStreamReaderCopy) {
+  auto log = makeMessageLog();
+
+  // Delivering only what is asked for means a refill of the buffer gets one byte, so no message
+  // is ever fully buffered.
+  TrickleInputStream stream(log.asPtr());
+  kj::BufferedInputStreamWrapper buffered(stream);
+  BufferedInputStreamMessageReader reader(buffered);
+  checkMessageLog(reader);
+}
+
+TEST(Serialize, BufferedInputStreamReaderMixed) {
+  auto log = makeMessageLog();
+
+  // A small, odd-sized buffer leaves some messages fully buffered, some split across refills, and
+  // some misaligned.
+  kj::ArrayInputStream stream(kj::arrayPtr(reinterpret_cast<const byte*>(log.begin()),
+                                           log.size() * sizeof(word)));
+  byte buffer[100];
+  kj::BufferedInputStreamWrapper buffered(stream, kj::arrayPtr(buffer, sizeof(buffer)));
+  BufferedInputStreamMessageReader reader(buffered);
+  checkMessageLog(reader);
+}
+
 class TestOutputStream: public kj::OutputStream {
 public:
   TestOutputStream() {}
@@ -214,6 +359,14 @@ public:
         std::string(reinterpret_cast<const char*>(other.begin()), other.size() * sizeof(word));
   }
 
+  size_t size() { return data.size(); }
+
+  kj::Array<word> getWords() {
+    auto result = kj::heapArray<word>(data.size() / sizeof(word));
+    memcpy(result.begin(), data.data(), result.size() * sizeof(word));
+    return result;
+  }
+
 private:
   std::string data;
 };
@@ -242,6 +395,56 @@ TEST(Serialize, WriteMessageOddSegmentCount) {
   EXPECT_TRUE(output.dataEquals(serialized.asPtr()));
 }
 
+TEST(Serialize, StreamingMessageBuilder) {
+  TestOutputStream output;
+
+  {
+    // The root and the list of pointers fit in the first segment; the text goes in later ones.
+    StreamingMessageBuilder builder(output, 256, 64);
+    auto list = builder.initRoot<TestAllTypes>().initTextList(100);
+    for (uint i = 0; i < list.size(); i++) {
+      list.set(i, kj::str("item ", i, ": some text to take up space in the segment"));
+    }
+
+    // Most of the message has been written before it is finished.
+    size_t written = output.size();
+    EXPECT_GT(written, 100 * 6 * sizeof(word));
+    EXPECT_EQ(written, builder.getWordsWritten() * sizeof(word));
+
+    builder.finish();
+    EXPECT_EQ(output.size(), builder.getWordsWritten() * sizeof(word));
+  }
+
+  auto words = output.getWords();
+  TestInputStream input(words, false);
+  StreamedMessageReader reader(input);
+
+  auto list = reader.getRoot<TestAllTypes>().getTextList();
+  ASSERT_EQ(100u, list.size());
+  for (uint i = 0; i < list.size(); i++) {
+    EXPECT_EQ(kj::str("item ", i, ": some text to take up space in the segment"), list[i]);
+  }
+}
+
+TEST(Serialize, StreamedMessageTooLarge) {
+  TestOutputStream output;
+
+  {
+    StreamingMessageBuilder builder(output, 256, 64);
+    auto list = builder.initRoot<TestAllTypes>().initTextList(100);
+    for (uint i = 0; i < list.size(); i++) {
+      list.set(i, kj::str("item ", i, ": some text to take up space in the segment"));
+    }
+    builder.finish();
+  }
+
+  auto words = output.getWords();
+  TestInputStream input(words, false);
+  ReaderOptions options;
+  options.traversalLimitInWords = 100;
+  EXPECT_ANY_THROW(StreamedMessageReader(input, options));
+}
+
 TEST(Serialize, WriteMessageEvenSegmentCount) {
   TestMessageBuilder builder(10);
   initTestMessage(builder.initRoot<TestAllTypes>());
@@ -254,6 +457,93 @@ TEST(Serialize, WriteMessageEvenSegmentCount) {
   EXPECT_TRUE(output.dataEquals(serialized.asPtr()));
 }
 
+kj::Array<word> concatenate(kj::ArrayPtr<const kj::Array<word>> arrays) {
+  size_t size = 0;
+  for (auto& array: arrays) size += array.size();
+  auto result = kj::heapArray<word>(size);
+  word* pos = result.begin();
+  for (auto& array: arrays) {
+    memcpy(pos, array.begin(), array.size() * sizeof(word));
+    pos += array.size();
+  }
+  return result;
+}
+
+TEST(Serialize, WriteMessages) {
+  TestMessageBuilder builder1(1);
+  initTestMessage(builder1.initRoot<TestAllTypes>());
+  TestMessageBuilder builder2(7);
+  initTestMessage(builder2.initRoot<TestAllTypes>());
+  TestMessageBuilder builder3(10);
+  initTestMessage(builder3.initRoot<TestAllTypes>());
+
+  MessageBuilder* builders[3] = { &builder1, &builder2, &builder3 };
+  kj::Array<word> flat[3] = {
+    messageToFlatArray(builder1), messageToFlatArray(builder2), messageToFlatArray(builder3)
+  };
+  kj::Array<word> serialized = concatenate(kj::arrayPtr(flat, 3));
+
+  TestOutputStream output;
+  writeMessages(output, kj::arrayPtr(builders, 3));
+  EXPECT_TRUE(output.dataEquals(serialized.asPtr()));
+
+  auto readers = readMessagesFromFlatArray(serialized);
+  ASSERT_EQ(3u, readers.size());
+  for (auto& reader: readers) {
+    checkTestMessage(reader->getRoot<TestAllTypes>());
+  }
+}
+
+TEST(Serialize, MessageBatchCoalescesSmallSegments) {
+  MallocMessageBuilder small1;
+  small1.initRoot<TestAllTypes>().setInt32Field(123);
+  MallocMessageBuilder small2;
+  small2.initRoot<TestAllTypes>().setTextField("foo");
+  MallocMessageBuilder large;
+  large.initRoot<TestAllTypes>().initDataField(MessageBatch::COPY_THRESHOLD * sizeof(word) * 2);
+
+  {
+    // Tiny messages come out as a single piece.
+    MessageBuilder* builders[2] = { &small1, &small2 };
+    MessageBatch batch(kj::arrayPtr(builders, 2));
+    EXPECT_EQ(1u, batch.getPieces().size());
+    EXPECT_EQ(batch.getPieces()[0].size(), batch.size());
+
+    auto readers = readMessagesFromFlatArray(kj::arrayPtr(
+        reinterpret_cast<const word*>(batch.getPieces()[0].begin()),
+        batch.size() / sizeof(word)));
+    ASSERT_EQ(2u, readers.size());
+    EXPECT_EQ(123, readers[0]->getRoot<TestAllTypes>().getInt32Field());
+    EXPECT_EQ("foo", readers[1]->getRoot<TestAllTypes>().getTextField());
+  }
+
+  {
+    // A large segment is referenced in place, splitting the buffer into two runs.
+    MessageBuilder* builders[3] = { &small1, &large, &small2 };
+    MessageBatch batch(kj::arrayPtr(builders, 3));
+    ASSERT_EQ(3u, batch.getPieces().size());
+    auto largeSegment = large.getSegmentsForOutput()[0];
+    EXPECT_EQ(reinterpret_cast<const byte*>(largeSegment.begin()),
+              batch.getPieces()[1].begin());
+
+    kj::Array<word> flat[3] = {
+      messageToFlatArray(small1), messageToFlatArray(large), messageToFlatArray(small2)
+    };
+    TestOutputStream output;
+    writeMessages(output, kj::arrayPtr(builders, 3));
+    EXPECT_TRUE(output.dataEquals(concatenate(kj::arrayPtr(flat, 3))));
+  }
+}
+
+TEST(Serialize, ReadMessagesFromFlatArrayTruncated) {
+  MallocMessageBuilder builder;
+  initTestMessage(builder.initRoot<TestAllTypes>());
+  kj::Array<word> flat[2] = { messageToFlatArray(builder), messageToFlatArray(builder) };
+  kj::Array<word> serialized = concatenate(kj::arrayPtr(flat, 2));
+
+  EXPECT_ANY_THROW(readMessagesFromFlatArray(serialized.slice(0, serialized.size() - 1)));
+}
+
 TEST(Serialize, FileDescriptors) {
   char filename[] = "/tmp/capnproto-serialize-test-XXXXXX";
   kj::AutoCloseFd tmpfile(mkstemp(filename));
@@ -287,6 +577,65 @@ TEST(Serialize, FileDescriptors) {
   }
 }
 
+TEST(Serialize, Mmap) {
+  char filename[] = "/tmp/capnproto-serialize-test-XXXXXX";
+  kj::AutoCloseFd tmpfile(mkstemp(filename));
+  ASSERT_GE(tmpfile.get(), 0);
+
+  // Unlink the file so that it will be deleted on close.
+  EXPECT_EQ(0, unlink(filename));
+
+  {
+    TestMessageBuilder builder(7);
+    initTestMessage(builder.initRoot<TestAllTypes>());
+    writeMessageToFd(tmpfile.get(), builder);
+  }
+
+  {
+    TestMessageBuilder builder(1);
+    builder.initRoot<TestAllTypes>().setTextField("second message in file");
+    writeMessageToFd(tmpfile.get(), builder);
+  }
+
+  {
+    MmapMessageReader reader(tmpfile.get());
+    checkTestMessage(reader.getRoot<TestAllTypes>());
+  }
+
+  {
+    MmapMessageReader reader(tmpfile.get(), ReaderOptions(), MmapAdvice::RANDOM);
+    checkTestMessage(reader.getRoot<TestAllTypes>());
+  }
+
+  {
+    MmapMessageFileReader file(tmpfile.get());
+
+    KJ_IF_MAYBE(reader, file.nextMessage()) {
+      checkTestMessage((*reader)->getRoot<TestAllTypes>());
+    } else {
+      ADD_FAILURE() << "Expected first message.";
+    }
+
+    KJ_IF_MAYBE(reader, file.nextMessage()) {
+      EXPECT_EQ("second message in file", (*reader)->getRoot<TestAllTypes>().getTextField());
+    } else {
+      ADD_FAILURE() << "Expected second message.";
+    }
+
+    EXPECT_TRUE(file.nextMessage() == nullptr);
+  }
+}
+
+TEST(Serialize, MmapEmptyFile) {
+  char filename[] = "/tmp/capnproto-serialize-test-XXXXXX";
+  kj::AutoCloseFd tmpfile(mkstemp(filename));
+  ASSERT_GE(tmpfile.get(), 0);
+  EXPECT_EQ(0, unlink(filename));
+
+  MmapMessageFileReader file(tmpfile.get());
+  EXPECT_TRUE(file.nextMessage() == nullptr);
+}
+
 TEST(Serialize, RejectTooManySegments) {
   kj::Array<word> data = kj::heapArray<word>(8192);
   WireValue<uint32_t>* table = reinterpret_cast<WireValue<uint32_t>*>(data.begin());
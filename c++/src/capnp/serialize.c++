@@ -24,13 +24,17 @@
 #include "serialize.h"
 #include "layout.h"
 #include <kj/debug.h>
+#include <kj/vector.h>
 #include <exception>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
 
 namespace capnp {
 
 FlatArrayMessageReader::FlatArrayMessageReader(
     kj::ArrayPtr<const word> array, ReaderOptions options)
-    : MessageReader(options) {
+    : MessageReader(options), end(array.end()) {
   if (array.size() < 1) {
     // Assume empty message.
     return;
@@ -75,6 +79,8 @@ FlatArrayMessageReader::FlatArrayMessageReader(
       offset += segmentSize;
     }
   }
+
+  end = array.begin() + offset;
 }
 
 kj::ArrayPtr<const word> FlatArrayMessageReader::getSegment(uint id) {
@@ -87,7 +93,11 @@ kj::ArrayPtr<const word> FlatArrayMessageReader::getSegment(uint id) {
   }
 }
 
-kj::Array<word> messageToFlatArray(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
+uint FlatArrayMessageReader::getSegmentCount() {
+  return moreSegments.size() + 1;
+}
+
+size_t computeSerializedSizeInWords(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
   KJ_REQUIRE(segments.size() > 0, "Tried to serialize uninitialized message.");
 
   size_t totalSize = segments.size() / 2 + 1;
@@ -96,10 +106,17 @@ kj::Array<word> messageToFlatArray(kj::ArrayPtr<const kj::ArrayPtr<const word>>
     totalSize += segment.size();
   }
 
-  kj::Array<word> result = kj::heapArray<word>(totalSize);
+  return totalSize;
+}
+
+kj::ArrayPtr<word> writeMessage(kj::ArrayPtr<word> output,
+                                kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
+  size_t totalSize = computeSerializedSizeInWords(segments);
+  KJ_REQUIRE(output.size() >= totalSize, "Output buffer is too small for message.",
+             output.size(), totalSize);
 
   _::WireValue<uint32_t>* table =
-      reinterpret_cast<_::WireValue<uint32_t>*>(result.begin());
+      reinterpret_cast<_::WireValue<uint32_t>*>(output.begin());
 
   // We write the segment count - 1 because this makes the first word zero for single-segment
   // messages, improving compression.  We don't bother doing this with segment sizes because
@@ -115,18 +132,116 @@ kj::Array<word> messageToFlatArray(kj::ArrayPtr<const kj::ArrayPtr<const word>>
     table[segments.size() + 1].set(0);
   }
 
-  word* dst = result.begin() + segments.size() / 2 + 1;
+  word* dst = output.begin() + segments.size() / 2 + 1;
 
   for (auto& segment: segments) {
     memcpy(dst, segment.begin(), segment.size() * sizeof(word));
     dst += segment.size();
   }
 
-  KJ_DASSERT(dst == result.end(), "Buffer overrun/underrun bug in code above.");
+  KJ_DASSERT(dst == output.begin() + totalSize, "Buffer overrun/underrun bug in code above.");
+
+  return output.slice(0, totalSize);
+}
 
+kj::Array<word> messageToFlatArray(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
+  kj::Array<word> result = kj::heapArray<word>(computeSerializedSizeInWords(segments));
+  writeMessage(result, segments);
   return kj::mv(result);
 }
 
+kj::Array<kj::Own<FlatArrayMessageReader>> readMessagesFromFlatArray(
+    kj::ArrayPtr<const word> array, ReaderOptions options) {
+  kj::Vector<kj::Own<FlatArrayMessageReader>> result;
+  const word* pos = array.begin();
+  while (pos < array.end()) {
+    auto reader = kj::heap<FlatArrayMessageReader>(kj::arrayPtr(pos, array.end()), options);
+    pos = reader->getEnd();
+    result.add(kj::mv(reader));
+  }
+  return result.releaseAsArray();
+}
+
+MessageBatch::MessageBatch(kj::ArrayPtr<MessageBuilder* const> builders)
+    : MessageBatch(KJ_MAP(builder, builders) { return builder->getSegmentsForOutput(); }) {}
+
+MessageBatch::MessageBatch(
+    kj::ArrayPtr<const kj::ArrayPtr<const kj::ArrayPtr<const word>>> messages) {
+  // First pass:  size the buffer and count the pieces.  A piece is either a run of buffer space
+  // or a large segment.
+  size_t bufferSize = 0;
+  size_t pieceCount = 0;
+  bool inRun = false;
+  byteCount = 0;
+  for (auto& segments: messages) {
+    KJ_REQUIRE(segments.size() > 0, "Tried to serialize uninitialized message.");
+    bufferSize += segments.size() / 2 + 1;
+    byteCount += (segments.size() / 2 + 1) * sizeof(word);
+    if (!inRun) {
+      ++pieceCount;
+      inRun = true;
+    }
+    for (auto& segment: segments) {
+      byteCount += segment.size() * sizeof(word);
+      if (segment.size() <= COPY_THRESHOLD) {
+        bufferSize += segment.size();
+        if (!inRun) {
+          ++pieceCount;
+          inRun = true;
+        }
+      } else {
+        ++pieceCount;
+        inRun = false;
+      }
+    }
+  }
+
+  buffer = kj::heapArray<word>(bufferSize);
+  auto pieceBuilder = kj::heapArrayBuilder<kj::ArrayPtr<const byte>>(pieceCount);
+
+  word* pos = buffer.begin();
+  word* runStart = pos;
+  auto endRun = [&]() {
+    if (pos > runStart) {
+      pieceBuilder.add(reinterpret_cast<const byte*>(runStart),
+                       reinterpret_cast<const byte*>(pos));
+    }
+    runStart = pos;
+  };
+
+  for (auto& segments: messages) {
+    _::WireValue<uint32_t>* table = reinterpret_cast<_::WireValue<uint32_t>*>(pos);
+
+    // We write the segment count - 1 because this makes the first word zero for single-segment
+    // messages, improving compression.  We don't bother doing this with segment sizes because
+    // one-word segments are rare anyway.
+    table[0].set(segments.size() - 1);
+    for (uint i = 0; i < segments.size(); i++) {
+      table[i + 1].set(segments[i].size());
+    }
+    if (segments.size() % 2 == 0) {
+      // Set padding byte.
+      table[segments.size() + 1].set(0);
+    }
+    pos += segments.size() / 2 + 1;
+
+    for (auto& segment: segments) {
+      if (segment.size() <= COPY_THRESHOLD) {
+        memcpy(pos, segment.begin(), segment.size() * sizeof(word));
+        pos += segment.size();
+      } else {
+        endRun();
+        pieceBuilder.add(reinterpret_cast<const byte*>(segment.begin()),
+                         reinterpret_cast<const byte*>(segment.end()));
+      }
+    }
+  }
+  endRun();
+
+  KJ_DASSERT(pos == buffer.end(), "Buffer overrun/underrun bug in code above.");
+  pieces = pieceBuilder.finish();
+}
+
 // =======================================================================================
 
 InputStreamMessageReader::InputStreamMessageReader(
@@ -229,6 +344,156 @@ kj::ArrayPtr<const word> InputStreamMessageReader::getSegment(uint id) {
   return segment;
 }
 
+uint InputStreamMessageReader::getSegmentCount() {
+  return moreSegments.size() + 1;
+}
+
+// -------------------------------------------------------------------
+
+BufferedInputStreamMessageReader::BufferedInputStreamMessageReader(
+    kj::BufferedInputStream& inputStream, ReaderOptions options)
+    : MessageReader(options), inputStream(inputStream) {}
+
+BufferedInputStreamMessageReader::~BufferedInputStreamMessageReader() noexcept(false) {
+  if (bytesToSkip > 0) {
+    unwindDetector.catchExceptionsIfUnwinding([&]() {
+      inputStream.skip(bytesToSkip);
+    });
+  }
+}
+
+bool BufferedInputStreamMessageReader::nextMessage() {
+  reset();
+  segmentCount = 0;
+
+  if (bytesToSkip > 0) {
+    size_t n = bytesToSkip;
+    bytesToSkip = 0;
+    inputStream.skip(n);
+  }
+
+  auto buffer = inputStream.tryGetReadBuffer();
+  if (buffer.size() == 0) {
+    return false;
+  }
+
+  if (!readInPlace(buffer)) {
+    readCopy();
+  }
+  return true;
+}
+
+void BufferedInputStreamMessageReader::setSegmentCount(uint count) {
+  if (segments.size() < count) {
+    segments = kj::heapArray<kj::ArrayPtr<const word>>(kj::max(count, segments.size() * 2));
+  }
+  segmentCount = count;
+}
+
+bool BufferedInputStreamMessageReader::readInPlace(kj::ArrayPtr<const byte> buffer) {
+  // Point directly into the buffer if the whole message is there and suitably aligned.  Anything
+  // unusual is left to readCopy(), which does the validation.
+
+  if (buffer.size() < sizeof(word) ||
+      reinterpret_cast<uintptr_t>(buffer.begin()) % sizeof(word) != 0) {
+    return false;
+  }
+
+  auto table = reinterpret_cast<const _::WireValue<uint32_t>*>(buffer.begin());
+  uint count = table[0].get() + 1;
+  if (count == 0 || count >= 512) {
+    return false;
+  }
+
+  size_t tableWords = count / 2 + 1;
+  if (buffer.size() < tableWords * sizeof(word)) {
+    return false;
+  }
+
+  size_t totalWords = 0;
+  for (uint i = 0; i < count; i++) {
+    totalWords += table[i + 1].get();
+  }
+  if (totalWords > getOptions().traversalLimitInWords ||
+      buffer.size() / sizeof(word) - tableWords < totalWords) {
+    return false;
+  }
+
+  setSegmentCount(count);
+  const word* pos = reinterpret_cast<const word*>(buffer.begin()) + tableWords;
+  for (uint i = 0; i < count; i++) {
+    uint size = table[i + 1].get();
+    segments[i] = kj::arrayPtr(pos, size);
+    pos += size;
+  }
+
+  bytesToSkip = (tableWords + totalWords) * sizeof(word);
+  return true;
+}
+
+void BufferedInputStreamMessageReader::readCopy() {
+  _::WireValue<uint32_t> firstWord[2];
+
+  inputStream.read(firstWord, sizeof(firstWord));
+
+  uint count = firstWord[0].get() + 1;
+  uint segment0Size = count == 0 ? 0 : firstWord[1].get();
+
+  size_t totalWords = segment0Size;
+
+  // Reject messages with too many segments for security reasons.
+  KJ_REQUIRE(count > 0 && count < 512, "Message has too many segments.") {
+    count = 1;
+    segment0Size = 1;
+    break;
+  }
+
+  // Read sizes for all segments except the first.  Include padding if necessary.
+  _::WireValue<uint32_t> moreSizes[count & ~1];
+  if (count > 1) {
+    inputStream.read(moreSizes, sizeof(moreSizes));
+    for (uint i = 0; i < count - 1; i++) {
+      totalWords += moreSizes[i].get();
+    }
+  }
+
+  // See InputStreamMessageReader.
+  KJ_REQUIRE(totalWords <= getOptions().traversalLimitInWords,
+             "Message is too large.  To increase the limit on the receiving end, see "
+             "capnp::ReaderOptions.") {
+    count = 1;
+    segment0Size = kj::min(segment0Size, getOptions().traversalLimitInWords);
+    totalWords = segment0Size;
+    break;
+  }
+
+  if (scratch.size() < totalWords) {
+    scratch = kj::heapArray<word>(kj::max(totalWords, scratch.size() * 2));
+  }
+
+  setSegmentCount(count);
+  segments[0] = scratch.slice(0, segment0Size);
+  size_t offset = segment0Size;
+  for (uint i = 1; i < count; i++) {
+    uint size = moreSizes[i - 1].get();
+    segments[i] = scratch.slice(offset, offset + size);
+    offset += size;
+  }
+
+  inputStream.read(scratch.begin(), totalWords * sizeof(word));
+}
+
+kj::ArrayPtr<const word> BufferedInputStreamMessageReader::getSegment(uint id) {
+  if (id >= segmentCount) {
+    return nullptr;
+  }
+  return segments[id];
+}
+
+uint BufferedInputStreamMessageReader::getSegmentCount() {
+  return segmentCount;
+}
+
 // -------------------------------------------------------------------
 
 void writeMessage(kj::OutputStream& output, kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
@@ -259,12 +524,212 @@ void writeMessage(kj::OutputStream& output, kj::ArrayPtr<const kj::ArrayPtr<cons
   output.write(pieces);
 }
 
+void writeMessages(kj::OutputStream& output, kj::ArrayPtr<MessageBuilder* const> builders) {
+  MessageBatch batch(builders);
+  output.write(batch.getPieces());
+}
+
+void writeMessages(kj::OutputStream& output,
+                   kj::ArrayPtr<const kj::ArrayPtr<const kj::ArrayPtr<const word>>> messages) {
+  MessageBatch batch(messages);
+  output.write(batch.getPieces());
+}
+
+// =======================================================================================
+
+StreamingMessageBuilder::StreamingMessageBuilder(
+    kj::OutputStream& output, uint firstSegmentWords, uint segmentWords)
+    : output(output), firstSegmentWords(firstSegmentWords), segmentWords(segmentWords) {}
+
+StreamingMessageBuilder::~StreamingMessageBuilder() noexcept(false) {}
+
+kj::ArrayPtr<word> StreamingMessageBuilder::allocateSegment(uint minimumSize) {
+  KJ_REQUIRE(!finished, "Can't modify a StreamingMessageBuilder after finish().");
+
+  if (firstSegment == nullptr) {
+    firstSegment = kj::heapArray<word>(kj::max(minimumSize, firstSegmentWords));
+    memset(firstSegment.begin(), 0, firstSegment.size() * sizeof(word));
+    return firstSegment;
+  }
+
+  // The arena is starting a new segment, so it won't allocate from the previous one again.
+  writeFinishedSegments(getSegmentsForOutput());
+
+  if (currentSegment.size() < minimumSize) {
+    currentSegment = kj::heapArray<word>(kj::max(minimumSize, segmentWords));
+    memset(currentSegment.begin(), 0, currentSegment.size() * sizeof(word));
+  }
+  return currentSegment;
+}
+
+void StreamingMessageBuilder::finish() {
+  KJ_REQUIRE(!finished, "StreamingMessageBuilder::finish() called twice.");
+
+  auto segments = getSegmentsForOutput();
+  KJ_REQUIRE(segments.size() > 0, "Tried to serialize uninitialized message.");
+
+  writeFinishedSegments(segments);
+  writeSegment(0, segments[0]);
+  finished = true;
+}
+
+void StreamingMessageBuilder::writeFinishedSegments(
+    kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
+  for (uint id = segmentsWritten + 1; id < segments.size(); id++) {
+    writeSegment(id, segments[id]);
+
+    if (segments[id].begin() == currentSegment.begin()) {
+      // Clear what was used so the memory can be handed out again.  Other segments (e.g. external
+      // data adopted into the message) aren't ours to reuse.
+      memset(currentSegment.begin(), 0, segments[id].size() * sizeof(word));
+    }
+  }
+  segmentsWritten = segments.size() - 1;
+}
+
+void StreamingMessageBuilder::writeSegment(uint id, kj::ArrayPtr<const word> segment) {
+  _::WireValue<uint32_t> header[2];
+  header[0].set(id);
+  header[1].set(segment.size());
+
+  kj::ArrayPtr<const byte> pieces[2] = {
+    kj::arrayPtr(reinterpret_cast<const byte*>(header), sizeof(header)),
+    kj::arrayPtr(reinterpret_cast<const byte*>(segment.begin()), segment.size() * sizeof(word))
+  };
+  output.write(kj::arrayPtr(pieces, 2));
+
+  wordsWritten += segment.size() + 1;
+}
+
+StreamedMessageReader::StreamedMessageReader(kj::InputStream& inputStream, ReaderOptions options)
+    : MessageReader(options) {
+  kj::Vector<kj::Array<word>> segments;
+  uint64_t totalWords = 0;
+
+  for (;;) {
+    _::WireValue<uint32_t> header[2];
+    inputStream.read(header, sizeof(header));
+    uint id = header[0].get();
+    uint size = header[1].get();
+
+    // Count the headers too, so that a stream of empty segments can't go on forever.
+    totalWords += size + 1;
+    KJ_REQUIRE(totalWords <= options.traversalLimitInWords,
+               "Message is too large.  To increase the limit on the receiving end, see "
+               "capnp::ReaderOptions.") {
+      return;
+    }
+    KJ_REQUIRE(id == 0 || id == segments.size() + 1,
+               "Streamed message has segments out of order.", id) {
+      return;
+    }
+
+    auto segment = kj::heapArray<word>(size);
+    inputStream.read(segment.begin(), size * sizeof(word));
+
+    if (id == 0) {
+      segment0 = kj::mv(segment);
+      break;
+    }
+    segments.add(kj::mv(segment));
+  }
+
+  moreSegments = segments.releaseAsArray();
+}
+
+StreamedMessageReader::~StreamedMessageReader() noexcept(false) {}
+
+kj::ArrayPtr<const word> StreamedMessageReader::getSegment(uint id) {
+  if (id == 0) {
+    return segment0;
+  } else if (id <= moreSegments.size()) {
+    return moreSegments[id - 1];
+  } else {
+    return nullptr;
+  }
+}
+
+uint StreamedMessageReader::getSegmentCount() {
+  return moreSegments.size() + 1;
+}
+
 // =======================================================================================
 StreamFdMessageReader::~StreamFdMessageReader() noexcept(false) {}
 
+namespace {
+
+int toMadvise(MmapAdvice advice) {
+  switch (advice) {
+    case MmapAdvice::NORMAL: return MADV_NORMAL;
+    case MmapAdvice::SEQUENTIAL: return MADV_SEQUENTIAL;
+    case MmapAdvice::RANDOM: return MADV_RANDOM;
+    case MmapAdvice::WILL_NEED: return MADV_WILLNEED;
+  }
+  KJ_UNREACHABLE;
+}
+
+}  // namespace
+
+_::MappedFile::MappedFile(int fd, MmapAdvice advice) {
+  struct stat stats;
+  KJ_SYSCALL(fstat(fd, &stats));
+
+  KJ_REQUIRE(S_ISREG(stats.st_mode), "Can only mmap() regular files.") {
+    return;
+  }
+
+  KJ_REQUIRE(stats.st_size % sizeof(word) == 0,
+             "Message file size is not a multiple of the word size.");
+
+  size_t wordCount = stats.st_size / sizeof(word);
+  if (wordCount == 0) {
+    // mmap()ing zero bytes will fail.
+    return;
+  }
+
+  void* ptr = mmap(NULL, wordCount * sizeof(word), PROT_READ, MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED) {
+    KJ_FAIL_SYSCALL("mmap", errno);
+  }
+
+  mapping = kj::Array<const word>(reinterpret_cast<const word*>(ptr), wordCount,
+                                  kj::MmapDisposer::instance);
+
+  if (advice != MmapAdvice::NORMAL) {
+    // Only a hint; ignore failure.
+    madvise(ptr, wordCount * sizeof(word), toMadvise(advice));
+  }
+}
+
+MmapMessageReader::MmapMessageReader(int fd, ReaderOptions options, MmapAdvice advice)
+    : MappedFile(fd, advice), FlatArrayMessageReader(mapping, options) {}
+
+MmapMessageReader::~MmapMessageReader() noexcept(false) {}
+
+MmapMessageFileReader::MmapMessageFileReader(int fd, ReaderOptions options, MmapAdvice advice)
+    : MappedFile(fd, advice), options(options), pos(mapping.begin()) {}
+
+MmapMessageFileReader::~MmapMessageFileReader() noexcept(false) {}
+
+kj::Maybe<kj::Own<FlatArrayMessageReader>> MmapMessageFileReader::nextMessage() {
+  if (pos == mapping.end()) {
+    return nullptr;
+  }
+
+  auto reader = kj::heap<FlatArrayMessageReader>(
+      kj::arrayPtr(pos, mapping.end()), options);
+  pos = reader->getEnd();
+  return kj::mv(reader);
+}
+
 void writeMessageToFd(int fd, kj::ArrayPtr<const kj::ArrayPtr<const word>> segments) {
   kj::FdOutputStream stream(fd);
   writeMessage(stream, segments);
 }
 
+void writeMessagesToFd(int fd, kj::ArrayPtr<MessageBuilder* const> builders) {
+  kj::FdOutputStream stream(fd);
+  writeMessages(stream, builders);
+}
+
 }  // namespace capnp
@@ -57,11 +57,19 @@ public:
   // The array must remain valid until the MessageReader is destroyed.
 
   kj::ArrayPtr<const word> getSegment(uint id) override;
+  uint getSegmentCount() override;
+
+  const word* getEnd() const { return end; }
+  // Get a pointer just past the end of the message as determined by reading its segment table.
+  // This may be before the end of the input array if it contains additional data (e.g. more
+  // messages).  If the segment table was invalid, this is the end of the input array.
 
 private:
   // Optimize for single-segment case.
   kj::ArrayPtr<const word> segment0;
   kj::Array<kj::ArrayPtr<const word>> moreSegments;
+
+  const word* end;
 };
 
 kj::Array<word> messageToFlatArray(MessageBuilder& builder);
@@ -70,6 +78,57 @@ kj::Array<word> messageToFlatArray(MessageBuilder& builder);
 kj::Array<word> messageToFlatArray(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
 // Version of messageToFlatArray that takes a raw segment array.
 
+size_t computeSerializedSizeInWords(MessageBuilder& builder);
+size_t computeSerializedSizeInWords(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
+// Returns the exact size of the message as written by writeMessage() or messageToFlatArray(), in
+// words.  This only looks at the segment sizes, so it is cheap.  Use it to size a buffer for the
+// writeMessage() overload below, or to write a length prefix ahead of the message.
+
+kj::ArrayPtr<word> writeMessage(kj::ArrayPtr<word> output, MessageBuilder& builder);
+kj::ArrayPtr<word> writeMessage(kj::ArrayPtr<word> output,
+                                kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
+// Write the message into a caller-provided buffer, which must be at least
+// computeSerializedSizeInWords() words.  Returns the prefix of `output` that was filled.
+
+kj::Array<kj::Own<FlatArrayMessageReader>> readMessagesFromFlatArray(
+    kj::ArrayPtr<const word> array, ReaderOptions options = ReaderOptions());
+// Parses every message in an array holding several messages back to back, such as a buffer
+// received from a peer that writes with writeMessages().  The array must remain valid until the
+// returned readers are destroyed.  Throws if the array ends partway through a message.
+
+class MessageBatch {
+  // Frames several messages one after the other, in the same format as writeMessage(), ready to
+  // be written with a single `write()` of the pieces.  The segment tables and every segment of up
+  // to COPY_THRESHOLD words are copied into one contiguous buffer, while larger segments are
+  // referenced in place.  So a batch of tiny messages -- e.g. RPC Finish and Release messages --
+  // is a single piece, and large messages still aren't copied.
+  //
+  // The messages must remain valid and unmodified until the batch is destroyed.
+
+public:
+  static constexpr size_t COPY_THRESHOLD = 256;
+
+  explicit MessageBatch(kj::ArrayPtr<MessageBuilder* const> builders);
+  explicit MessageBatch(
+      kj::ArrayPtr<const kj::ArrayPtr<const kj::ArrayPtr<const word>>> messages);
+  // Each element of `messages` is the segment array of one message.
+
+  MessageBatch(MessageBatch&&) = default;
+  MessageBatch& operator=(MessageBatch&&) = default;
+  KJ_DISALLOW_COPY(MessageBatch);
+
+  inline kj::ArrayPtr<const kj::ArrayPtr<const byte>> getPieces() const { return pieces; }
+  // The framed bytes, in order.
+
+  inline size_t size() const { return byteCount; }
+  // Total bytes across all pieces.
+
+private:
+  kj::Array<word> buffer;
+  kj::Array<kj::ArrayPtr<const byte>> pieces;
+  size_t byteCount;
+};
+
 // =======================================================================================
 
 class InputStreamMessageReader: public MessageReader {
@@ -81,6 +140,7 @@ public:
 
   // implements MessageReader ----------------------------------------
   kj::ArrayPtr<const word> getSegment(uint id) override;
+  uint getSegmentCount() override;
 
 private:
   kj::InputStream& inputStream;
@@ -96,12 +156,154 @@ private:
   kj::UnwindDetector unwindDetector;
 };
 
+class BufferedInputStreamMessageReader: public MessageReader {
+  // Reads a sequence of messages from a BufferedInputStream, reusing one reader -- and its
+  // memory -- for all of them.  nextMessage() advances to the next message in place.  A message
+  // that is entirely present in the stream's buffer is read directly from there, without copying.
+  // Otherwise it is read into a scratch buffer owned by the reader, which grows as needed but is
+  // kept for later messages.  So once warmed up, reading a message allocates nothing.
+  //
+  // To read a stream of messages from a file descriptor, wrap a kj::FdInputStream in a
+  // kj::BufferedInputStreamWrapper.
+
+public:
+  explicit BufferedInputStreamMessageReader(kj::BufferedInputStream& inputStream,
+                                            ReaderOptions options = ReaderOptions());
+  KJ_DISALLOW_COPY(BufferedInputStreamMessageReader);
+  ~BufferedInputStreamMessageReader() noexcept(false);
+
+  bool nextMessage();
+  // Advance to the next message, invalidating everything obtained from the previous one.  Returns
+  // false on a clean EOF between messages.  Must be called before the first getRoot().
+
+  // implements MessageReader ----------------------------------------
+  kj::ArrayPtr<const word> getSegment(uint id) override;
+  uint getSegmentCount() override;
+
+private:
+  kj::BufferedInputStream& inputStream;
+
+  size_t bytesToSkip = 0;
+  // Bytes of the current message still sitting in the stream's buffer, because it was read in
+  // place.  They are consumed when advancing.
+
+  kj::Array<word> scratch;
+  // Space for messages that weren't entirely buffered.
+
+  kj::Array<kj::ArrayPtr<const word>> segments;
+  uint segmentCount = 0;
+  // Table of the current message's segments.  Has room for at least `segmentCount` entries.
+
+  kj::UnwindDetector unwindDetector;
+
+  bool readInPlace(kj::ArrayPtr<const byte> buffer);
+  void readCopy();
+  void setSegmentCount(uint count);
+};
+
 void writeMessage(kj::OutputStream& output, MessageBuilder& builder);
 // Write the message to the given output stream.
 
 void writeMessage(kj::OutputStream& output, kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
 // Write the segment array to the given output stream.
 
+void writeMessages(kj::OutputStream& output, kj::ArrayPtr<MessageBuilder* const> builders);
+void writeMessages(kj::OutputStream& output,
+                   kj::ArrayPtr<const kj::ArrayPtr<const kj::ArrayPtr<const word>>> messages);
+// Write several messages, one after the other, with a single call to `output.write()`.  See
+// MessageBatch.  The reading side needs nothing special:  the messages can be read one at a time
+// with any of the readers above, or all together with readMessagesFromFlatArray().
+
+// =======================================================================================
+// Streamed messages
+//
+// A message too large to hold in memory at once can be written with a StreamingMessageBuilder,
+// which writes each segment to the output as soon as it is finished rather than when the whole
+// message is done.  Since the segment sizes aren't known up-front, this uses a different framing
+// than writeMessage():
+//
+// * For each segment, in the order written:  32-bit little-endian segment ID, 32-bit little-endian
+//   size in words, then the segment data.
+// * Segments 1, 2, 3, ... come first, in order.  Segment 0 (which holds the root pointer) comes
+//   last and ends the message.
+//
+// Read it back with StreamedMessageReader.
+
+class StreamingMessageBuilder: public MessageBuilder {
+  // A MessageBuilder that writes finished segments to `output` as it goes, so that it only holds
+  // the first segment plus the one currently being filled.  Segments after the first are all
+  // `segmentWords` long (unless a single object needs more), and the memory of each is reused for
+  // the next once it has been written.
+  //
+  // The arena only ever allocates from the first segment and the newest one, so a segment is
+  // finished as soon as a newer one is started.  However, nothing stops you from writing through
+  // a Builder that points into a segment that has already been written, and doing so would
+  // silently corrupt the segment that reused its memory.  So you must build the message such
+  // that, once you have started on a new object, you never modify an older one that isn't in the
+  // first segment.  In practice this means allocating the message's "spine" up-front -- e.g. the
+  // root struct and a large list of structs or pointers -- and sizing `firstSegmentWords` so that
+  // it fits in the first segment.  The elements' content can then be filled in one by one, with
+  // the pointers to it landing in the first segment.  The same goes for reading:  don't traverse
+  // content that may live in a segment that has been written.
+  //
+  // Call finish() once the message is complete to write the remaining segments.  A builder
+  // destroyed without calling finish() leaves a truncated message on the stream.
+  // getSegmentsForOutput() must not be used, as written segments are no longer in memory.
+
+public:
+  explicit StreamingMessageBuilder(kj::OutputStream& output,
+      uint firstSegmentWords = SUGGESTED_FIRST_SEGMENT_WORDS, uint segmentWords = 1u << 17);
+  KJ_DISALLOW_COPY(StreamingMessageBuilder);
+  ~StreamingMessageBuilder() noexcept(false);
+
+  void finish();
+  // Writes the segments not yet written, ending with the first.  The builder may not be modified
+  // afterwards.
+
+  uint64_t getWordsWritten() { return wordsWritten; }
+  // Words written to the output so far, including segment headers.
+
+  virtual kj::ArrayPtr<word> allocateSegment(uint minimumSize) override;
+
+private:
+  kj::OutputStream& output;
+  uint firstSegmentWords;
+  uint segmentWords;
+
+  kj::Array<word> firstSegment;
+  kj::Array<word> currentSegment;
+  // The memory of the newest segment, which is reused for the next one once written.
+
+  uint segmentsWritten = 0;
+  // Segments 1 through `segmentsWritten` have been written.
+
+  uint64_t wordsWritten = 0;
+  bool finished = false;
+
+  void writeFinishedSegments(kj::ArrayPtr<const kj::ArrayPtr<const word>> segments);
+  void writeSegment(uint id, kj::ArrayPtr<const word> segment);
+};
+
+class StreamedMessageReader: public MessageReader {
+  // Reads a message written by StreamingMessageBuilder.  The whole message is read into memory
+  // (one allocation per segment); the segment sizes count against the traversal limit, as with
+  // InputStreamMessageReader.
+
+public:
+  explicit StreamedMessageReader(kj::InputStream& inputStream,
+                                 ReaderOptions options = ReaderOptions());
+  KJ_DISALLOW_COPY(StreamedMessageReader);
+  ~StreamedMessageReader() noexcept(false);
+
+  // implements MessageReader ----------------------------------------
+  kj::ArrayPtr<const word> getSegment(uint id) override;
+  uint getSegmentCount() override;
+
+private:
+  kj::Array<word> segment0;
+  kj::Array<kj::Array<word>> moreSegments;
+};
+
 // =======================================================================================
 // Specializations for reading from / writing to file descriptors.
 
@@ -123,6 +325,65 @@ public:
   ~StreamFdMessageReader() noexcept(false);
 };
 
+enum class MmapAdvice {
+  // Access pattern hint passed to madvise() for a mapped message file.
+
+  NORMAL,       // No hint.
+  SEQUENTIAL,   // The file will be read front to back; read ahead aggressively.
+  RANDOM,       // Access will be scattered; don't bother reading ahead.
+  WILL_NEED     // Start paging in the whole file now.
+};
+
+namespace _ {  // private
+
+class MappedFile {
+  // Maps the whole of a regular file read-only.  A base class of the mmap readers below so that
+  // the mapping is established before (and torn down after) the readers that point into it.
+
+public:
+  MappedFile(int fd, MmapAdvice advice);
+
+protected:
+  kj::Array<const word> mapping;
+};
+
+}  // namespace _ (private)
+
+class MmapMessageReader: private _::MappedFile, public FlatArrayMessageReader {
+  // A MessageReader that maps a file containing a single message (as written by
+  // writeMessageToFd()) and reads it in place.  Only the segment table is examined up-front;
+  // segment data is paged in by the OS as the message is traversed, so opening even a very large
+  // file is cheap.
+  //
+  // The mapping is not affected if the descriptor is closed afterwards, so the reader does not
+  // take ownership of it.  Any trailing data after the first message is ignored.
+
+public:
+  explicit MmapMessageReader(int fd, ReaderOptions options = ReaderOptions(),
+                             MmapAdvice advice = MmapAdvice::NORMAL);
+  ~MmapMessageReader() noexcept(false);
+};
+
+class MmapMessageFileReader: private _::MappedFile {
+  // Maps a file containing any number of concatenated messages (e.g. written by repeated calls
+  // to writeMessageToFd()) and iterates over them without copying.
+
+public:
+  explicit MmapMessageFileReader(int fd, ReaderOptions options = ReaderOptions(),
+                                 MmapAdvice advice = MmapAdvice::SEQUENTIAL);
+  KJ_DISALLOW_COPY(MmapMessageFileReader);
+  ~MmapMessageFileReader() noexcept(false);
+
+  kj::Maybe<kj::Own<FlatArrayMessageReader>> nextMessage();
+  // Returns a reader for the next message in the file, or null if the end of the file has been
+  // reached.  The returned reader points into the mapping, so it must not outlive the
+  // MmapMessageFileReader.
+
+private:
+  ReaderOptions options;
+  const word* pos;
+};
+
 void writeMessageToFd(int fd, MessageBuilder& builder);
 // Write the message to the given file descriptor.
 //
@@ -137,6 +398,10 @@ void writeMessageToFd(int fd, kj::ArrayPtr<const kj::ArrayPtr<const word>> segme
 // you catch this exception at the call site.  If throwing an exception is not acceptable, you
 // can implement your own OutputStream with arbitrary error handling and then use writeMessage().
 
+void writeMessagesToFd(int fd, kj::ArrayPtr<MessageBuilder* const> builders);
+// Write several messages to the given file descriptor with a single writev().  Throws on I/O
+// errors, like writeMessageToFd().
+
 // =======================================================================================
 // inline stuff
 
@@ -144,6 +409,14 @@ inline kj::Array<word> messageToFlatArray(MessageBuilder& builder) {
   return messageToFlatArray(builder.getSegmentsForOutput());
 }
 
+inline size_t computeSerializedSizeInWords(MessageBuilder& builder) {
+  return computeSerializedSizeInWords(builder.getSegmentsForOutput());
+}
+
+inline kj::ArrayPtr<word> writeMessage(kj::ArrayPtr<word> output, MessageBuilder& builder) {
+  return writeMessage(output, builder.getSegmentsForOutput());
+}
+
 inline void writeMessage(kj::OutputStream& output, MessageBuilder& builder) {
   writeMessage(output, builder.getSegmentsForOutput());
 }
@@ -48,6 +48,8 @@
 #include "dynamic.h"
 #include "pretty-print.h"
 #include <kj/debug.h>
+#include <kj/io.h>
+#include <kj/vector.h>
 #include <gtest/gtest.h>
 #include "test-util.h"
 
@@ -721,6 +723,131 @@ TEST(Stringify, MoreValues) {
   EXPECT_EQ("(123)", kj::str(DynamicValue::Reader(static_cast<TestEnum>(123))));
 }
 
+class StringOutputStream: public kj::OutputStream {
+public:
+  void write(const void* buffer, size_t size) override {
+    text.addAll(kj::arrayPtr(reinterpret_cast<const char*>(buffer), size));
+    ++writeCount;
+  }
+
+  kj::String get() {
+    kj::String result = kj::heapString(text.begin(), text.size());
+    text.resize(0);
+    return result;
+  }
+
+  kj::Vector<char> text;
+  uint writeCount = 0;
+};
+
+template <typename T>
+void checkStreamed(T value) {
+  StringOutputStream output;
+  PrettyPrintOptions options;
+
+  prettyPrint(output, value, options);
+  EXPECT_EQ(prettyPrint(value).flatten(), output.get());
+
+  options.indent = false;
+  prettyPrint(output, value, options);
+  EXPECT_EQ(kj::str(value), output.get());
+
+  // Tiny chunks so that even short lists get split up.
+  options.threads = 3;
+  options.chunkSize = 2;
+  prettyPrint(output, value, options);
+  EXPECT_EQ(kj::str(value), output.get());
+
+  options.indent = true;
+  prettyPrint(output, value, options);
+  EXPECT_EQ(prettyPrint(value).flatten(), output.get());
+}
+
+TEST(Stringify, Streaming) {
+  MallocMessageBuilder builder;
+
+  {
+    auto root = builder.initRoot<TestAllTypes>();
+    checkStreamed<DynamicStruct::Reader>(root.asReader());
+    initTestMessage(root);
+    checkStreamed<DynamicStruct::Reader>(root.asReader());
+    checkStreamed<DynamicStruct::Builder>(root);
+    checkStreamed<DynamicList::Reader>(root.asReader().getStructList());
+  }
+
+  {
+    auto root = builder.initRoot<test::TestPrintInlineStructs>();
+    auto list = root.initStructList(3);
+    list[0].setInt32Field(123);
+    list[0].setTextField("foo");
+    list[1].setInt32Field(456);
+    list[1].setTextField("bar");
+    list[2].setInt32Field(789);
+    list[2].setTextField("baaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaz");
+    root.setSomeText("foo");
+    checkStreamed<DynamicStruct::Reader>(root.asReader());
+  }
+
+  {
+    auto root = builder.initRoot<test::TestLists>();
+    auto ll = root.initInt32ListList(3);
+    ll.set(0, {123, 456, 789, 1234567890});
+    ll.set(1, {234, 567, 891, 1234567890});
+    ll.set(2, {345, 678, 912, 1234567890});
+    root.initList8(2)[1].setF(34);
+    checkStreamed<DynamicStruct::Reader>(root.asReader());
+  }
+
+  {
+    auto root = builder.initRoot<test::TestStructUnion>();
+    auto s = root.getUn().initStruct();
+    checkStreamed<DynamicStruct::Reader>(root.asReader());
+    s.setSomeText("foo");
+    s.setMoreText("baaaaaaaaaaaaaaaaaaaaaaaaaaaaaar");
+    checkStreamed<DynamicStruct::Reader>(root.asReader());
+  }
+
+  {
+    auto root = builder.initRoot<test::TestUnion>();
+    root.getUnion0().setU0f0s8(0);
+    root.getUnion1().setU1f1s8(0);
+    checkStreamed<DynamicStruct::Reader>(root.asReader());
+  }
+}
+
+TEST(Stringify, StreamingLargeList) {
+  MallocMessageBuilder builder;
+  auto root = builder.initRoot<TestAllTypes>();
+
+  auto ints = root.initInt32List(10000);
+  auto texts = root.initTextList(2000);
+  auto structs = root.initStructList(3000);
+  for (uint i = 0; i < ints.size(); i++) {
+    ints.set(i, i * 7919);
+  }
+  for (uint i = 0; i < texts.size(); i++) {
+    texts.set(i, kj::str("text number ", i));
+  }
+  for (uint i = 0; i < structs.size(); i++) {
+    structs[i].setUInt32Field(i);
+    structs[i].setTextField(kj::str("struct ", i));
+  }
+
+  kj::String expected = prettyPrint(root.asReader()).flatten();
+
+  StringOutputStream output;
+  PrettyPrintOptions options;
+  options.threads = 4;
+  options.chunkSize = 333;
+  for (uint threads: {1, 4}) {
+    options.threads = threads;
+    prettyPrint(output, root.asReader(), options);
+    EXPECT_TRUE(output.writeCount > 1) << "output should be written incrementally";
+    output.writeCount = 0;
+    EXPECT_TRUE(expected == output.get());
+  }
+}
+
 }  // namespace
 }  // namespace _ (private)
 }  // namespace capnp
@@ -21,9 +21,11 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "dynamic.h"
+#include "pretty-print.h"
 #include <kj/debug.h>
 #include <kj/vector.h>
+#include <kj/io.h>
+#include <kj/thread.h>
 
 namespace capnp {
 
@@ -110,6 +112,45 @@ private:
   }
 };
 
+template <typename Output>
+static void escapeTo(kj::ArrayPtr<const char> chars, Output& escaped) {
+  for (char c: chars) {
+    switch (c) {
+      case '\a': escaped.addAll(kj::StringPtr("\\a")); break;
+      case '\b': escaped.addAll(kj::StringPtr("\\b")); break;
+      case '\f': escaped.addAll(kj::StringPtr("\\f")); break;
+      case '\n': escaped.addAll(kj::StringPtr("\\n")); break;
+      case '\r': escaped.addAll(kj::StringPtr("\\r")); break;
+      case '\t': escaped.addAll(kj::StringPtr("\\t")); break;
+      case '\v': escaped.addAll(kj::StringPtr("\\v")); break;
+      case '\'': escaped.addAll(kj::StringPtr("\\\'")); break;
+      case '\"': escaped.addAll(kj::StringPtr("\\\"")); break;
+      case '\\': escaped.addAll(kj::StringPtr("\\\\")); break;
+      default:
+        if (c < 0x20) {
+          escaped.add('\\');
+          escaped.add('x');
+          uint8_t c2 = c;
+          escaped.add(HEXDIGITS[c2 / 16]);
+          escaped.add(HEXDIGITS[c2 % 16]);
+        } else {
+          escaped.add(c);
+        }
+        break;
+    }
+  }
+}
+
+static kj::ArrayPtr<const char> blobChars(const DynamicValue::Reader& value) {
+  // TODO(someday):  Data probably shouldn't be printed as a string.
+  if (value.getType() == DynamicValue::DATA) {
+    auto reader = value.as<Data>();
+    return kj::arrayPtr(reinterpret_cast<const char*>(reader.begin()), reader.size());
+  } else {
+    return value.as<Text>();
+  }
+}
+
 static schema::Type::Which whichFieldType(const StructSchema::Field& field) {
   auto proto = field.getProto();
   switch (proto.which()) {
@@ -143,42 +184,9 @@ static kj::StringTree print(const DynamicValue::Reader& value,
       }
     case DynamicValue::TEXT:
     case DynamicValue::DATA: {
-      // TODO(someday):  Data probably shouldn't be printed as a string.
-      kj::ArrayPtr<const char> chars;
-      if (value.getType() == DynamicValue::DATA) {
-        auto reader = value.as<Data>();
-        chars = kj::arrayPtr(reinterpret_cast<const char*>(reader.begin()), reader.size());
-      } else {
-        chars = value.as<Text>();
-      }
-
+      kj::ArrayPtr<const char> chars = blobChars(value);
       kj::Vector<char> escaped(chars.size());
-
-      for (char c: chars) {
-        switch (c) {
-          case '\a': escaped.addAll(kj::StringPtr("\\a")); break;
-          case '\b': escaped.addAll(kj::StringPtr("\\b")); break;
-          case '\f': escaped.addAll(kj::StringPtr("\\f")); break;
-          case '\n': escaped.addAll(kj::StringPtr("\\n")); break;
-          case '\r': escaped.addAll(kj::StringPtr("\\r")); break;
-          case '\t': escaped.addAll(kj::StringPtr("\\t")); break;
-          case '\v': escaped.addAll(kj::StringPtr("\\v")); break;
-          case '\'': escaped.addAll(kj::StringPtr("\\\'")); break;
-          case '\"': escaped.addAll(kj::StringPtr("\\\"")); break;
-          case '\\': escaped.addAll(kj::StringPtr("\\\\")); break;
-          default:
-            if (c < 0x20) {
-              escaped.add('\\');
-              escaped.add('x');
-              uint8_t c2 = c;
-              escaped.add(HEXDIGITS[c2 / 16]);
-              escaped.add(HEXDIGITS[c2 % 16]);
-            } else {
-              escaped.add(c);
-            }
-            break;
-        }
-      }
+      escapeTo(chars, escaped);
       return kj::strTree('"', escaped, '"');
     }
     case DynamicValue::LIST: {
@@ -261,6 +269,345 @@ kj::StringTree stringify(DynamicValue::Reader value) {
   return print(value, schema::Type::STRUCT, Indent(false), BARE);
 }
 
+// =======================================================================================
+// Streaming printer
+//
+// Produces exactly the same text as print() above, but writes it out as it goes instead of
+// building a StringTree of the whole value.  print() decides whether to put a list or struct on
+// one line by looking at the complete text of every item.  An item can only be printed inline if
+// its text is at most maxInlineValueSize characters with no newlines, and such short text never
+// contains nested line breaks, so it is always identical to the item's compact (non-indented)
+// form.  We can therefore make the same decision by measuring each item's compact form with a
+// length cap, which touches a bounded amount of the message per item.
+
+class TextSink {
+  // Destination for streamed text.  Text is accumulated in a buffer which is written to `output`
+  // whenever it gets big, or kept in memory if `output` is null.  A sink constructed with a
+  // `limit` instead only counts characters, and reports full() once more than `limit` have been
+  // added so that measuring can stop early.
+
+public:
+  explicit TextSink(kj::OutputStream* output): output(output), limit(0), count(0) {}
+  explicit TextSink(size_t limit): output(nullptr), limit(limit), count(0) {}
+
+  KJ_DISALLOW_COPY(TextSink);
+
+  inline bool full() const { return limit != 0 && count > limit; }
+  inline size_t size() const { return count; }
+
+  inline void add(char c) {
+    ++count;
+    if (limit == 0) {
+      buffer.add(c);
+      if (buffer.size() >= FLUSH_SIZE) flush();
+    }
+  }
+
+  template <typename Container>
+  inline void addAll(Container&& text) {
+    count += text.size();
+    if (limit == 0) {
+      buffer.addAll(text);
+      if (buffer.size() >= FLUSH_SIZE) flush();
+    }
+  }
+
+  void flush() {
+    if (output != nullptr && buffer.size() > 0) {
+      output->write(buffer.begin(), buffer.size());
+      buffer.resize(0);
+    }
+  }
+
+  kj::ArrayPtr<const char> getBuffered() const { return buffer; }
+
+  kj::ArrayPtr<const char> clip(kj::ArrayPtr<const char> text) const {
+    // When measuring, returns a prefix of `text` that is just long enough that escaping it would
+    // overflow the limit if escaping the whole thing would, so that huge blobs aren't scanned.
+    if (limit == 0 || text.size() <= limit) return text;
+    return text.slice(0, limit + 1);
+  }
+
+private:
+  static constexpr size_t FLUSH_SIZE = 8192;
+
+  kj::OutputStream* output;
+  size_t limit;
+  size_t count;
+  kj::Vector<char> buffer;
+};
+
+class StreamPrinter {
+public:
+  StreamPrinter(TextSink& sink, uint threads, uint chunkSize)
+      : sink(sink), threads(threads), chunkSize(kj::max(chunkSize, 1u)) {}
+
+  void print(const DynamicValue::Reader& value, schema::Type::Which which, uint indent,
+             PrintMode mode) {
+    // `indent` is the Indent amount:  zero for compact output, else one plus the nesting depth.
+
+    switch (value.getType()) {
+      case DynamicValue::UNKNOWN:
+        sink.add('?');
+        return;
+      case DynamicValue::VOID:
+        sink.addAll(kj::StringPtr("void"));
+        return;
+      case DynamicValue::BOOL:
+        sink.addAll(kj::StringPtr(value.as<bool>() ? "true" : "false"));
+        return;
+      case DynamicValue::INT:
+        sink.addAll(kj::toCharSequence(value.as<int64_t>()));
+        return;
+      case DynamicValue::UINT:
+        sink.addAll(kj::toCharSequence(value.as<uint64_t>()));
+        return;
+      case DynamicValue::FLOAT:
+        if (which == schema::Type::FLOAT32) {
+          sink.addAll(kj::toCharSequence(value.as<float>()));
+        } else {
+          sink.addAll(kj::toCharSequence(value.as<double>()));
+        }
+        return;
+      case DynamicValue::TEXT:
+      case DynamicValue::DATA:
+        sink.add('"');
+        escapeTo(sink.clip(blobChars(value)), sink);
+        sink.add('"');
+        return;
+      case DynamicValue::LIST:
+        printList(value.as<DynamicList>(), indent, mode);
+        return;
+      case DynamicValue::ENUM: {
+        auto enumValue = value.as<DynamicEnum>();
+        KJ_IF_MAYBE(enumerant, enumValue.getEnumerant()) {
+          sink.addAll(enumerant->getProto().getName());
+        } else {
+          // Unknown enum value; output raw number.
+          sink.add('(');
+          sink.addAll(kj::toCharSequence(enumValue.getRaw()));
+          sink.add(')');
+        }
+        return;
+      }
+      case DynamicValue::STRUCT:
+        printStruct(value.as<DynamicStruct>(), indent, mode);
+        return;
+      case DynamicValue::CAPABILITY:
+        sink.addAll(kj::StringPtr("<external capability>"));
+        return;
+      case DynamicValue::ANY_POINTER:
+        sink.addAll(kj::StringPtr("<opaque pointer>"));
+        return;
+    }
+
+    KJ_UNREACHABLE;
+  }
+
+private:
+  TextSink& sink;
+  uint threads;
+  uint chunkSize;
+
+  static constexpr size_t maxInlineValueSize = 24;
+  static constexpr size_t maxInlineRecordSize = 64;
+
+  static uint nextIndent(uint indent) { return indent == 0 ? 0 : indent + 1; }
+
+  static size_t measure(const DynamicValue::Reader& value, schema::Type::Which which,
+                        size_t limit) {
+    // Returns the length of the value's compact form, or something greater than `limit` if it
+    // is longer than that.
+    TextSink counter(limit);
+    StreamPrinter(counter, 1, 1).print(value, which, 0, BARE);
+    return counter.size();
+  }
+
+  struct Delimiters {
+    // How the items of a list or record are separated; mirrors Indent::delimit().
+    kj::String prefix;
+    kj::String separator;
+    kj::StringPtr suffix;
+  };
+
+  static Delimiters delimiters(uint indent, PrintMode mode, bool inlined) {
+    if (inlined) {
+      return { kj::String(), kj::heapString(", "), nullptr };
+    } else {
+      auto separator = kj::heapString(indent * 2 + 2);
+      separator[0] = ',';
+      separator[1] = '\n';
+      memset(separator.begin() + 2, ' ', indent * 2);
+      auto prefix = mode == BARE ? kj::heapString(" ") : kj::heapString(separator.slice(1));
+      return { kj::mv(prefix), kj::mv(separator), " " };
+    }
+  }
+
+  void printList(DynamicList::Reader list, uint indent, PrintMode mode) {
+    auto which = list.getSchema().whichElementType();
+
+    bool inlined = true;
+    if (indent != 0) {
+      for (auto element: list) {
+        if (measure(element, which, maxInlineValueSize) > maxInlineValueSize) {
+          inlined = false;
+          break;
+        }
+      }
+    }
+
+    auto delim = delimiters(indent, mode, inlined);
+    uint childIndent = nextIndent(indent);
+
+    sink.add('[');
+    sink.addAll(delim.prefix);
+    if (threads > 1 && list.size() > chunkSize && !sink.full()) {
+      printListInParallel(list, which, childIndent, delim.separator);
+    } else {
+      for (uint i = 0; i < list.size() && !sink.full(); i++) {
+        if (i > 0) sink.addAll(delim.separator);
+        print(list[i], which, childIndent, BARE);
+      }
+    }
+    sink.addAll(delim.suffix);
+    sink.add(']');
+  }
+
+  class RecoverableExceptionCatcher: public kj::ExceptionCallback {
+    // Installed in worker threads so that recoverable exceptions (e.g. from malformed input)
+    // can be forwarded to the calling thread's callback, as if printing had happened there.
+  public:
+    void onRecoverableException(kj::Exception&& e) override {
+      if (exception == nullptr) exception = kj::mv(e);
+    }
+    kj::Maybe<kj::Exception> exception;
+  };
+
+  void printListInParallel(DynamicList::Reader list, schema::Type::Which which, uint childIndent,
+                           kj::StringPtr separator) {
+    // Cut the list into chunks and print up to `threads` of them at a time, each into its own
+    // buffer, then write the buffers out in order.  Memory use is bounded by the window size.
+
+    struct Chunk {
+      uint begin;
+      uint end;
+      kj::Own<TextSink> text;
+      kj::Maybe<kj::Exception> exception;
+    };
+
+    uint size = list.size();
+    for (uint windowBegin = 0; windowBegin < size; windowBegin += chunkSize * threads) {
+      uint windowEnd = kj::min(size, windowBegin + chunkSize * threads);
+      auto chunks = kj::heapArrayBuilder<Chunk>(
+          (windowEnd - windowBegin + chunkSize - 1) / chunkSize);
+      for (uint begin = windowBegin; begin < windowEnd; begin += chunkSize) {
+        chunks.add(Chunk { begin, kj::min(windowEnd, begin + chunkSize),
+                           kj::heap<TextSink>(nullptr), nullptr });
+      }
+
+      {
+        auto workers = kj::heapArrayBuilder<kj::Own<kj::Thread>>(chunks.size());
+        for (auto& chunk: chunks) {
+          Chunk* c = &chunk;
+          workers.add(kj::heap<kj::Thread>([&,c]() {
+            RecoverableExceptionCatcher catcher;
+            StreamPrinter printer(*c->text, 1, 1);
+            for (uint i = c->begin; i < c->end; i++) {
+              if (i > c->begin) c->text->addAll(separator);
+              printer.print(list[i], which, childIndent, BARE);
+            }
+            c->exception = kj::mv(catcher.exception);
+          }));
+        }
+        // Destroying the workers joins them, rethrowing any fatal exceptions.
+      }
+
+      for (auto& chunk: chunks) {
+        if (chunk.begin > 0) sink.addAll(separator);
+        sink.addAll(chunk.text->getBuffered());
+        KJ_IF_MAYBE(e, chunk.exception) {
+          kj::getExceptionCallback().onRecoverableException(kj::mv(*e));
+        }
+      }
+    }
+  }
+
+  void printStruct(DynamicStruct::Reader structValue, uint indent, PrintMode mode) {
+    auto unionFields = structValue.getSchema().getUnionFields();
+    auto nonUnionFields = structValue.getSchema().getNonUnionFields();
+
+    // Collect the fields that will be printed, in the same order as print().
+    kj::Vector<StructSchema::Field> fields(nonUnionFields.size() + (unionFields.size() != 0));
+
+    auto which = structValue.which();
+    KJ_IF_MAYBE(field, which) {
+      // Even if the union field has its default value, if it is not the default field of the
+      // union then we have to print it anyway.
+      if (field->getProto().getDiscriminantValue() == 0 && !structValue.has(*field)) {
+        which = nullptr;
+      }
+    }
+
+    for (auto field: nonUnionFields) {
+      KJ_IF_MAYBE(unionField, which) {
+        if (unionField->getIndex() < field.getIndex()) {
+          fields.add(*unionField);
+          which = nullptr;
+        }
+      }
+      if (structValue.has(field)) {
+        fields.add(field);
+      }
+    }
+    KJ_IF_MAYBE(unionField, which) {
+      // Union value is last.
+      fields.add(*unionField);
+    }
+
+    bool inlined = true;
+    if (indent != 0) {
+      size_t totalSize = 0;
+      for (auto& field: fields) {
+        // Each item is "name = value".
+        size_t nameSize = field.getProto().getName().size() + 3;
+        if (nameSize > maxInlineValueSize) {
+          inlined = false;
+          break;
+        }
+        size_t valueLimit = maxInlineValueSize - nameSize;
+        size_t valueSize = measure(structValue.get(field), whichFieldType(field), valueLimit);
+        totalSize += nameSize + valueSize;
+        if (valueSize > valueLimit || totalSize > maxInlineRecordSize) {
+          inlined = false;
+          break;
+        }
+      }
+    }
+
+    auto delim = delimiters(indent, mode, inlined);
+    uint childIndent = nextIndent(indent);
+
+    if (mode != PARENTHESIZED) sink.add('(');
+    sink.addAll(delim.prefix);
+    for (uint i = 0; i < fields.size() && !sink.full(); i++) {
+      if (i > 0) sink.addAll(delim.separator);
+      sink.addAll(fields[i].getProto().getName());
+      sink.addAll(kj::StringPtr(" = "));
+      print(structValue.get(fields[i]), whichFieldType(fields[i]), childIndent, PREFIXED);
+    }
+    sink.addAll(delim.suffix);
+    if (mode != PARENTHESIZED) sink.add(')');
+  }
+};
+
+void printToStream(kj::OutputStream& output, const DynamicValue::Reader& value,
+                   schema::Type::Which which, const PrettyPrintOptions& options) {
+  TextSink sink(&output);
+  StreamPrinter(sink, options.threads, options.chunkSize)
+      .print(value, which, options.indent ? 1 : 0, BARE);
+  sink.flush();
+}
+
 }  // namespace
 
 kj::StringTree prettyPrint(DynamicStruct::Reader value) {
@@ -274,6 +621,23 @@ kj::StringTree prettyPrint(DynamicList::Reader value) {
 kj::StringTree prettyPrint(DynamicStruct::Builder value) { return prettyPrint(value.asReader()); }
 kj::StringTree prettyPrint(DynamicList::Builder value) { return prettyPrint(value.asReader()); }
 
+void prettyPrint(kj::OutputStream& output, DynamicStruct::Reader value,
+                 PrettyPrintOptions options) {
+  printToStream(output, value, schema::Type::STRUCT, options);
+}
+void prettyPrint(kj::OutputStream& output, DynamicList::Reader value,
+                 PrettyPrintOptions options) {
+  printToStream(output, value, schema::Type::LIST, options);
+}
+void prettyPrint(kj::OutputStream& output, DynamicStruct::Builder value,
+                 PrettyPrintOptions options) {
+  prettyPrint(output, value.asReader(), options);
+}
+void prettyPrint(kj::OutputStream& output, DynamicList::Builder value,
+                 PrettyPrintOptions options) {
+  prettyPrint(output, value.asReader(), options);
+}
+
 kj::StringTree KJ_STRINGIFY(const DynamicValue::Reader& value) { return stringify(value); }
 kj::StringTree KJ_STRINGIFY(const DynamicValue::Builder& value) { return stringify(value.asReader()); }
 kj::StringTree KJ_STRINGIFY(DynamicEnum value) { return stringify(value); }
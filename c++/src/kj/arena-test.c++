@@ -25,6 +25,8 @@
 #include "debug.h"
 #include <gtest/gtest.h>
 #include <stdint.h>
+#include <map>
+#include "thread.h"
 
 namespace kj {
 namespace {
@@ -306,5 +308,69 @@ TEST(Arena, Strings) {
   EXPECT_EQ(quux.end() + 1, corge.begin());
 }
 
+TEST(Arena, ThreadLocal) {
+  EXPECT_FALSE(ThreadLocalArena::isActive());
+
+  {
+    ThreadLocalArena outer;
+    EXPECT_TRUE(ThreadLocalArena::isActive());
+    EXPECT_EQ(&outer, &ThreadLocalArena::current());
+
+    {
+      ThreadLocalArena inner;
+      EXPECT_EQ(&inner, &ThreadLocalArena::current());
+
+      Arena* otherThreadArena = nullptr;
+      bool otherThreadActive = true;
+      kj::Thread([&]() {
+        otherThreadActive = ThreadLocalArena::isActive();
+        ThreadLocalArena arena;
+        otherThreadArena = &ThreadLocalArena::current();
+      });
+      EXPECT_FALSE(otherThreadActive);
+      EXPECT_NE(&inner, otherThreadArena);
+      EXPECT_EQ(&inner, &ThreadLocalArena::current());
+    }
+
+    EXPECT_EQ(&outer, &ThreadLocalArena::current());
+  }
+
+  EXPECT_FALSE(ThreadLocalArena::isActive());
+}
+
+TEST(Arena, Allocator) {
+  alignas(8) byte scratch[4096];
+  Arena arena(arrayPtr(scratch, sizeof(scratch)));
+
+  typedef std::multimap<uint, StringPtr, std::less<uint>,
+                        ArenaAllocator<std::pair<const uint, StringPtr>>> Map;
+
+  {
+    Map map{ArenaAllocator<std::pair<const uint, StringPtr>>(arena)};
+    map.insert(std::make_pair(2u, StringPtr("bar")));
+    map.insert(std::make_pair(1u, StringPtr("foo")));
+    map.insert(std::make_pair(2u, StringPtr("baz")));
+
+    auto iter = map.begin();
+    EXPECT_EQ("foo", (iter++)->second);
+    EXPECT_EQ("bar", (iter++)->second);
+    EXPECT_EQ("baz", (iter++)->second);
+    EXPECT_TRUE(iter == map.end());
+
+    // The nodes came from the scratch space.
+    for (auto& entry: map) {
+      const byte* ptr = reinterpret_cast<const byte*>(&entry);
+      EXPECT_TRUE(ptr >= scratch && ptr < scratch + sizeof(scratch));
+    }
+  }
+
+  {
+    ThreadLocalArena threadArena;
+    Map map;
+    map.insert(std::make_pair(1u, StringPtr("qux")));
+    EXPECT_EQ("qux", map.begin()->second);
+  }
+}
+
 }  // namespace
 }  // namespace kj
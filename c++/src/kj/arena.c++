@@ -166,4 +166,30 @@ void Arena::setDestructor(void* ptr, void (*destructor)(void*)) {
   objectList = header;
 }
 
+// =======================================================================================
+
+static __thread ThreadLocalArena* threadLocalArena = nullptr;
+
+ThreadLocalArena::ThreadLocalArena(size_t chunkSizeHint)
+    : Arena(chunkSizeHint), previous(threadLocalArena) {
+  threadLocalArena = this;
+}
+
+ThreadLocalArena::~ThreadLocalArena() noexcept(false) {
+  KJ_REQUIRE(threadLocalArena == this,
+             "ThreadLocalArenas must be destroyed in reverse order of construction.") {
+    break;
+  }
+  threadLocalArena = previous;
+}
+
+Arena& ThreadLocalArena::current() {
+  KJ_REQUIRE(threadLocalArena != nullptr, "No ThreadLocalArena is active on this thread.");
+  return *threadLocalArena;
+}
+
+bool ThreadLocalArena::isActive() {
+  return threadLocalArena != nullptr;
+}
+
 }  // namespace kj
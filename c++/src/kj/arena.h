@@ -127,6 +127,70 @@ private:
   static void destroyObject(void* pointer) {
     dtor(*reinterpret_cast<T*>(pointer));
   }
+
+  template <typename T>
+  friend class ArenaAllocator;
+};
+
+class ThreadLocalArena: public Arena {
+  // An Arena which, for as long as it exists, is the calling thread's current arena, as returned
+  // by `ThreadLocalArena::current()`.  Construct one on the stack around a phase of work that
+  // makes many small, short-lived allocations -- typically through ArenaAllocator, below -- and
+  // they all become bump-pointer allocations freed at once when the phase ends.  Since each thread
+  // has its own current arena, this is also the easy way to use arenas in multithreaded code.
+  //
+  // ThreadLocalArenas nest:  destroying one makes the previously-current arena (if any) current
+  // again.  They must be destroyed in the reverse order of construction, on the thread that
+  // created them, which is automatic if they are only ever placed on the stack.
+
+public:
+  explicit ThreadLocalArena(size_t chunkSizeHint = 1024);
+  KJ_DISALLOW_COPY(ThreadLocalArena);
+  ~ThreadLocalArena() noexcept(false);
+
+  static Arena& current();
+  // Returns the innermost ThreadLocalArena on this thread.  It is an error to call this when
+  // there is none.
+
+  static bool isActive();
+  // Returns whether there is a ThreadLocalArena on this thread.
+
+private:
+  ThreadLocalArena* previous;
+};
+
+template <typename T>
+class ArenaAllocator {
+  // A standard-library-compatible allocator that allocates from an Arena.  Deallocation does
+  // nothing; memory is reclaimed when the Arena is destroyed, which must not happen while any
+  // container using it is still alive.  Useful for node-based containers like std::map, which
+  // otherwise make one heap allocation per element.
+  //
+  // A default-constructed ArenaAllocator uses the current ThreadLocalArena.
+
+public:
+  typedef T value_type;
+
+  inline ArenaAllocator(): arena(&ThreadLocalArena::current()) {}
+  inline explicit ArenaAllocator(Arena& arena): arena(&arena) {}
+  template <typename U>
+  inline ArenaAllocator(const ArenaAllocator<U>& other): arena(other.arena) {}
+
+  inline T* allocate(size_t n) {
+    return reinterpret_cast<T*>(arena->allocateBytes(sizeof(T) * n, alignof(T), false));
+  }
+  inline void deallocate(T* ptr, size_t n) {}
+
+  template <typename U>
+  inline bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+  template <typename U>
+  inline bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+  Arena* arena;
+
+  template <typename U>
+  friend class ArenaAllocator;
 };
 
 // =======================================================================================
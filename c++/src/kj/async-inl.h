@@ -170,6 +170,41 @@ protected:
 
 // -------------------------------------------------------------------
 
+// allocPromiseNode() / freePromiseNode() (declared in async-prelude.h) provide memory for
+// promise nodes.  Small nodes are recycled through free lists kept by the thread's
+// current EventLoop, since a typical node lives for only a few turns and a busy loop allocates
+// them at a very high rate.  Without a current loop these fall back to the global allocator.
+
+template <typename T>
+class PromiseNodeDisposer final: public Disposer {
+public:
+  void disposeImpl(void* pointer) const override {
+    KJ_DEFER(freePromiseNode(pointer, sizeof(T)));
+    dtor(*reinterpret_cast<T*>(pointer));
+  }
+
+  static const PromiseNodeDisposer instance;
+};
+
+template <typename T>
+const PromiseNodeDisposer<T> PromiseNodeDisposer<T>::instance = PromiseNodeDisposer<T>();
+
+template <typename T, typename... Params>
+Own<T> heapNode(Params&&... params) {
+  // Like `heap<T>()`, but allocates with `allocPromiseNode()`.  Use for every PromiseNode
+  // allocated on the promise fast path.
+
+  void* memory = allocPromiseNode(sizeof(T));
+  bool constructed = false;
+  KJ_DEFER(if (!constructed) freePromiseNode(memory, sizeof(T)));
+  T* node = reinterpret_cast<T*>(memory);
+  ctor(*node, kj::fwd<Params>(params)...);
+  constructed = true;
+  return Own<T>(node, PromiseNodeDisposer<T>::instance);
+}
+
+// -------------------------------------------------------------------
+
 class ImmediatePromiseNodeBase: public PromiseNode {
 public:
   ImmediatePromiseNodeBase();
@@ -392,7 +427,7 @@ public:
   ForkHub(Own<PromiseNode>&& inner): ForkHubBase(kj::mv(inner), result) {}
 
   Promise<_::UnfixVoid<T>> addBranch() {
-    return Promise<_::UnfixVoid<T>>(false, kj::heap<ForkBranch<T>>(addRef(*this)));
+    return Promise<_::UnfixVoid<T>>(false, heapNode<ForkBranch<T>>(addRef(*this)));
   }
 
 private:
@@ -440,7 +475,7 @@ private:
 
 template <typename T>
 Own<PromiseNode> maybeChain(Own<PromiseNode>&& node, Promise<T>*) {
-  return heap<ChainPromiseNode>(kj::mv(node));
+  return heapNode<ChainPromiseNode>(kj::mv(node));
 }
 
 template <typename T>
@@ -584,7 +619,7 @@ template <typename T>
 Own<PromiseNode> spark(Own<PromiseNode>&& node) {
   // Forces evaluation of the given node to begin as soon as possible, even if no one is waiting
   // on it.
-  return heap<EagerPromiseNode<T>>(kj::mv(node));
+  return heapNode<EagerPromiseNode<T>>(kj::mv(node));
 }
 
 // -------------------------------------------------------------------
@@ -649,11 +684,11 @@ private:
 
 template <typename T>
 Promise<T>::Promise(_::FixVoid<T> value)
-    : PromiseBase(heap<_::ImmediatePromiseNode<_::FixVoid<T>>>(kj::mv(value))) {}
+    : PromiseBase(_::heapNode<_::ImmediatePromiseNode<_::FixVoid<T>>>(kj::mv(value))) {}
 
 template <typename T>
 Promise<T>::Promise(kj::Exception&& exception)
-    : PromiseBase(heap<_::ImmediateBrokenPromiseNode>(kj::mv(exception))) {}
+    : PromiseBase(_::heapNode<_::ImmediateBrokenPromiseNode>(kj::mv(exception))) {}
 
 template <typename T>
 template <typename Func, typename ErrorFunc>
@@ -661,7 +696,7 @@ PromiseForResult<Func, T> Promise<T>::then(Func&& func, ErrorFunc&& errorHandler
   typedef _::FixVoid<_::ReturnType<Func, T>> ResultT;
 
   Own<_::PromiseNode> intermediate =
-      heap<_::TransformPromiseNode<ResultT, _::FixVoid<T>, Func, ErrorFunc>>(
+      _::heapNode<_::TransformPromiseNode<ResultT, _::FixVoid<T>, Func, ErrorFunc>>(
           kj::mv(node), kj::fwd<Func>(func), kj::fwd<ErrorFunc>(errorHandler));
   return PromiseForResult<Func, T>(false,
       _::maybeChain(kj::mv(intermediate), implicitCast<ResultT*>(nullptr)));
@@ -698,13 +733,13 @@ Promise<T> ForkedPromise<T>::addBranch() {
 
 template <typename T>
 Promise<T> Promise<T>::exclusiveJoin(Promise<T>&& other) {
-  return Promise(false, heap<_::ExclusiveJoinPromiseNode>(kj::mv(node), kj::mv(other.node)));
+  return Promise(false, _::heapNode<_::ExclusiveJoinPromiseNode>(kj::mv(node), kj::mv(other.node)));
 }
 
 template <typename T>
 template <typename... Attachments>
 Promise<T> Promise<T>::attach(Attachments&&... attachments) {
-  return Promise(false, kj::heap<_::AttachmentPromiseNode<Tuple<Attachments...>>>(
+  return Promise(false, _::heapNode<_::AttachmentPromiseNode<Tuple<Attachments...>>>(
       kj::mv(node), kj::tuple(kj::fwd<Attachments>(attachments)...)));
 }
 
@@ -751,7 +786,7 @@ void Promise<void>::detach(ErrorFunc&& errorHandler) {
 
 template <typename T>
 Promise<Array<T>> joinPromises(Array<Promise<T>>&& promises) {
-  return Promise<Array<T>>(false, kj::heap<_::ArrayJoinPromiseNode<T>>(
+  return Promise<Array<T>>(false, _::heapNode<_::ArrayJoinPromiseNode<T>>(
       KJ_MAP(p, promises) { return kj::mv(p.node); },
       heapArray<_::ExceptionOr<T>>(promises.size())));
 }
@@ -858,7 +893,7 @@ private:
 
 template <typename T, typename Adapter, typename... Params>
 Promise<T> newAdaptedPromise(Params&&... adapterConstructorParams) {
-  return Promise<T>(false, heap<_::AdapterPromiseNode<_::FixVoid<T>, Adapter>>(
+  return Promise<T>(false, _::heapNode<_::AdapterPromiseNode<_::FixVoid<T>, Adapter>>(
       kj::fwd<Params>(adapterConstructorParams)...));
 }
 
@@ -867,13 +902,183 @@ PromiseFulfillerPair<T> newPromiseAndFulfiller() {
   auto wrapper = _::WeakFulfiller<T>::make();
 
   Own<_::PromiseNode> intermediate(
-      heap<_::AdapterPromiseNode<_::FixVoid<T>, _::PromiseAndFulfillerAdapter<T>>>(*wrapper));
+      _::heapNode<_::AdapterPromiseNode<_::FixVoid<T>, _::PromiseAndFulfillerAdapter<T>>>(
+          *wrapper));
   Promise<_::JoinPromises<T>> promise(false,
       _::maybeChain(kj::mv(intermediate), implicitCast<T*>(nullptr)));
 
   return PromiseFulfillerPair<T> { kj::mv(promise), kj::mv(wrapper) };
 }
 
+// =======================================================================================
+// Cross-thread execution
+
+namespace _ {  // private
+
+class XThreadEvent {
+  // Something sent to an `Executor` from another thread.  Whoever pops it off the executor's
+  // queue calls exactly one of `deliver()` or `discard()`, either of which must dispose of it.
+
+public:
+  virtual void deliver() = 0;
+  // Called in the executor's thread, between turns of its event loop.
+
+  virtual void discard() = 0;
+  // Called instead of `deliver()` if the executor's loop was destroyed first.  May be called in
+  // any thread.
+
+protected:
+  ~XThreadEvent() = default;
+
+private:
+  XThreadEvent* next = nullptr;
+  friend class kj::Executor;
+};
+
+class XThreadPafBase: public XThreadEvent {
+  // The non-template part of the shared state behind `newPromiseAndCrossThreadFulfiller()`.  It
+  // is referenced by the promise node (in the calling thread), by the fulfiller (in any thread),
+  // and, while the result is in flight, by the calling thread's executor queue.  The result is
+  // written once by whichever thread fulfills, and read only after it has come back through the
+  // queue, so it needs no lock of its own.
+
+public:
+  Own<PromiseNode> makeNode();
+  // Called once, right after construction, to create the promise node.
+
+protected:
+  XThreadPafBase();
+  virtual ~XThreadPafBase() noexcept(false);
+
+  bool startFulfill();
+  // Returns true if this is the first call to fulfill or reject, in which case the caller should
+  // store the result and then call `finishFulfill()`.
+
+  void finishFulfill();
+  // Sends the stored result back to the calling thread.
+
+  bool isWaitingImpl() const;
+
+  void dropRef() const;
+
+  virtual void getResult(ExceptionOrValue& output) = 0;
+
+private:
+  Own<const Executor> executor;
+  mutable uint refcount = 2;
+  uint flags = 0;
+  class Node;
+  Node* node = nullptr;
+  // Only touched in the calling thread.
+
+  void deliver() override;
+  void discard() override;
+};
+
+template <typename T>
+class XThreadPaf final: public XThreadPafBase, public PromiseFulfiller<T>, private Disposer {
+public:
+  void fulfill(FixVoid<T>&& value) override {
+    if (startFulfill()) {
+      result = ExceptionOr<FixVoid<T>>(kj::mv(value));
+      finishFulfill();
+    }
+  }
+
+  void reject(Exception&& exception) override {
+    if (startFulfill()) {
+      result = ExceptionOr<FixVoid<T>>(false, kj::mv(exception));
+      finishFulfill();
+    }
+  }
+
+  bool isWaiting() override {
+    return isWaitingImpl();
+  }
+
+  static PromiseFulfillerPair<T> make() {
+    XThreadPaf* ptr = new XThreadPaf;
+    Own<PromiseFulfiller<T>> fulfiller(ptr, *ptr);
+    return PromiseFulfillerPair<T> { Promise<T>(false, ptr->makeNode()), kj::mv(fulfiller) };
+  }
+
+private:
+  ExceptionOr<FixVoid<T>> result;
+
+  XThreadPaf() = default;
+
+  void getResult(ExceptionOrValue& output) override {
+    output.as<FixVoid<T>>() = kj::mv(result);
+  }
+
+  void disposeImpl(void* pointer) const override {
+    // The application discarded the fulfiller.
+    auto self = const_cast<XThreadPaf*>(this);
+    if (self->startFulfill()) {
+      self->result = ExceptionOr<FixVoid<T>>(false, kj::Exception(
+          kj::Exception::Nature::LOCAL_BUG, kj::Exception::Durability::PERMANENT,
+          __FILE__, __LINE__,
+          kj::heapString("PromiseFulfiller was destroyed without fulfilling the promise.")));
+      self->finishFulfill();
+    }
+    dropRef();
+  }
+};
+
+template <typename T>
+struct XThreadFulfill {
+  PromiseFulfiller<T>* fulfiller;
+  void operator()(T&& value) { fulfiller->fulfill(kj::mv(value)); }
+};
+template <>
+struct XThreadFulfill<void> {
+  PromiseFulfiller<void>* fulfiller;
+  void operator()() { fulfiller->fulfill(); }
+};
+
+template <typename Func, typename T>
+class XThreadCall final: public XThreadEvent {
+  // The event sent by `Executor::executeAsync()`.
+
+public:
+  XThreadCall(Func&& func, Own<PromiseFulfiller<T>>&& fulfiller)
+      : func(kj::fwd<Func>(func)), fulfiller(kj::mv(fulfiller)) {}
+
+  void deliver() override {
+    Own<XThreadCall> self(this, _::HeapDisposer<XThreadCall>::instance);
+    auto& f = *fulfiller;
+    _::detach(evalLater(kj::mv(func))
+        .then(XThreadFulfill<T> { &f }, [&f](Exception&& e) { f.reject(kj::mv(e)); })
+        .attach(kj::mv(self)));
+  }
+
+  void discard() override {
+    fulfiller->reject(kj::Exception(
+        kj::Exception::Nature::LOCAL_BUG, kj::Exception::Durability::PERMANENT,
+        __FILE__, __LINE__, kj::heapString("Executor's EventLoop has been destroyed.")));
+    delete this;
+  }
+
+private:
+  Decay<Func> func;
+  Own<PromiseFulfiller<T>> fulfiller;
+};
+
+}  // namespace _ (private)
+
+template <typename T>
+PromiseFulfillerPair<T> newPromiseAndCrossThreadFulfiller() {
+  return _::XThreadPaf<T>::make();
+}
+
+template <typename Func>
+PromiseForResult<Func, void> Executor::executeAsync(Func&& func) const {
+  typedef _::JoinPromises<_::ReturnType<Func, void>> T;
+  auto paf = newPromiseAndCrossThreadFulfiller<T>();
+  send(*new _::XThreadCall<Func, T>(kj::fwd<Func>(func), kj::mv(paf.fulfiller)));
+  return kj::mv(paf.promise);
+}
+
 }  // namespace kj
 
 #endif  // KJ_ASYNC_INL_H_
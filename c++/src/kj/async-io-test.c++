@@ -23,14 +23,19 @@
 
 #include "async-io.h"
 #include "async-unix.h"
+#include "thread-pool.h"
+#include "string-tree.h"
 #include "debug.h"
 #include <gtest/gtest.h>
+#include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
 
 namespace kj {
 namespace {
 
-TEST(AsyncIo, SimpleNetwork) {
-  auto ioContext = setupAsyncIo();
+void testSimpleNetwork(AsyncIoContext& ioContext) {
   auto& network = ioContext.provider->getNetwork();
 
   Own<ConnectionReceiver> listener;
@@ -67,6 +72,11 @@ TEST(AsyncIo, SimpleNetwork) {
   EXPECT_EQ("foo", result);
 }
 
+TEST(AsyncIo, SimpleNetwork) {
+  auto ioContext = setupAsyncIo();
+  testSimpleNetwork(ioContext);
+}
+
 String tryParse(WaitScope& waitScope, Network& network, StringPtr text, uint portHint = 0) {
   return network.parseAddress(text, portHint).wait(waitScope)->toString();
 }
@@ -96,6 +106,31 @@ TEST(AsyncIo, AddressParsing) {
   // connect to "localhost" in a different test, though.
 }
 
+TEST(AsyncIo, LookupThreadPool) {
+  ThreadPool pool(1);
+
+  NetworkOptions options;
+  options.lookupThreadPool = pool;
+  options.lookupCacheTtl = 10 * SECONDS;
+  auto ioContext = setupAsyncIo(options);
+  auto& w = ioContext.waitScope;
+  auto& network = ioContext.provider->getNetwork();
+
+  // Literal addresses don't need a lookup.
+  EXPECT_EQ("1.2.3.4:5678", tryParse(w, network, "1.2.3.4", 5678));
+  EXPECT_EQ(0u, pool.getThreadCount());
+
+  // Service names do.  The second time around the answer comes from the cache.
+  EXPECT_EQ("1.2.3.4:80", tryParse(w, network, "1.2.3.4:http", 5678));
+  EXPECT_EQ(1u, pool.getThreadCount());
+  EXPECT_EQ("1.2.3.4:80", tryParse(w, network, "1.2.3.4:http", 5678));
+
+  // Failures are reported through the promise.
+  EXPECT_TRUE(kj::runCatchingExceptions([&]() {
+    tryParse(w, network, "1.2.3.4:no-such-service");
+  }) != nullptr);
+}
+
 TEST(AsyncIo, OneWayPipe) {
   auto ioContext = setupAsyncIo();
 
@@ -114,6 +149,27 @@ TEST(AsyncIo, OneWayPipe) {
   EXPECT_EQ("foo", result);
 }
 
+TEST(AsyncIo, WriteStringTree) {
+  auto ioContext = setupAsyncIo();
+
+  auto pipe = ioContext.provider->newOneWayPipe();
+
+  auto pieces = heapArray<StringTree>(3000);
+  for (uint i = 0; i < pieces.size(); i++) {
+    pieces[i] = strTree(i);
+  }
+  StringTree tree(kj::mv(pieces), ",");
+  String expected = tree.flatten();
+
+  auto writePromise = pipe.out->write(kj::mv(tree));
+
+  auto buffer = heapArray<char>(expected.size());
+  pipe.in->read(buffer.begin(), buffer.size()).wait(ioContext.waitScope);
+  writePromise.wait(ioContext.waitScope);
+
+  EXPECT_EQ(expected, heapString(buffer.begin(), buffer.size()));
+}
+
 TEST(AsyncIo, TwoWayPipe) {
   auto ioContext = setupAsyncIo();
 
@@ -141,6 +197,97 @@ TEST(AsyncIo, TwoWayPipe) {
   EXPECT_EQ("bar", result2);
 }
 
+TEST(AsyncIo, PumpSplice) {
+  auto ioContext = setupAsyncIo();
+  auto& w = ioContext.waitScope;
+
+  auto pipe1 = ioContext.provider->newTwoWayPipe();
+  auto pipe2 = ioContext.provider->newTwoWayPipe();
+
+  // More than fits in the socket buffers at once, so the pump has to wait on both sides.
+  auto data = heapArray<byte>(1 << 20);
+  for (size_t i = 0; i < data.size(); i++) data[i] = i * 7;
+
+  auto writePromise = pipe1.ends[0]->write(data.begin(), data.size()).then([&]() {
+    pipe1.ends[0]->shutdownWrite();
+  }).eagerlyEvaluate(nullptr);
+  auto pumpPromise = pipe1.ends[1]->pumpTo(*pipe2.ends[0]).eagerlyEvaluate(nullptr);
+
+  auto received = heapArray<byte>(data.size());
+  pipe2.ends[1]->read(received.begin(), received.size()).wait(w);
+  EXPECT_EQ(data.size(), pumpPromise.wait(w));
+  writePromise.wait(w);
+  EXPECT_TRUE(memcmp(data.begin(), received.begin(), data.size()) == 0);
+}
+
+TEST(AsyncIo, PumpLimit) {
+  auto ioContext = setupAsyncIo();
+  auto& w = ioContext.waitScope;
+
+  auto pipe1 = ioContext.provider->newTwoWayPipe();
+  auto pipe2 = ioContext.provider->newTwoWayPipe();
+
+  pipe1.ends[0]->write("foobarbaz", 9).wait(w);
+  EXPECT_EQ(5u, pipe1.ends[1]->pumpTo(*pipe2.ends[0], 5).wait(w));
+
+  char buf[5];
+  pipe2.ends[1]->read(buf, 5).wait(w);
+  EXPECT_EQ("fooba", heapString(buf, 5));
+
+  // Nothing past the limit was consumed.
+  pipe1.ends[1]->read(buf, 4).wait(w);
+  EXPECT_EQ("rbaz", heapString(buf, 4));
+}
+
+class ChunkedInputStream final: public AsyncInputStream {
+  // Returns `data` at most `chunkSize` bytes at a time.
+
+public:
+  ChunkedInputStream(ArrayPtr<const byte> data, size_t chunkSize)
+      : data(data), chunkSize(chunkSize) {}
+
+  Promise<size_t> read(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return tryRead(buffer, minBytes, maxBytes);
+  }
+
+  Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    size_t n = kj::min(kj::min(maxBytes, chunkSize), data.size());
+    memcpy(buffer, data.begin(), n);
+    data = data.slice(n, data.size());
+    return evalLater([n]() { return n; });
+  }
+
+private:
+  ArrayPtr<const byte> data;
+  size_t chunkSize;
+};
+
+TEST(AsyncIo, PumpBuffered) {
+  // The input isn't a file descriptor, so this uses the buffered copy.
+
+  auto ioContext = setupAsyncIo();
+  auto& w = ioContext.waitScope;
+
+  auto data = heapArray<byte>(100000);
+  for (size_t i = 0; i < data.size(); i++) data[i] = i * 7;
+
+  auto pipe = ioContext.provider->newOneWayPipe();
+  ChunkedInputStream input(data, 3000);
+
+  auto pumpPromise = input.pumpTo(*pipe.out, 90000).eagerlyEvaluate(nullptr);
+
+  auto received = heapArray<byte>(90000);
+  pipe.in->read(received.begin(), received.size()).wait(w);
+  EXPECT_EQ(90000u, pumpPromise.wait(w));
+  EXPECT_TRUE(memcmp(data.begin(), received.begin(), received.size()) == 0);
+
+  // Pumping the rest stops at EOF.
+  auto pumpPromise2 = input.pumpTo(*pipe.out).eagerlyEvaluate(nullptr);
+  pipe.in->read(received.begin(), 10000).wait(w);
+  EXPECT_EQ(10000u, pumpPromise2.wait(w));
+  EXPECT_TRUE(memcmp(data.begin() + 90000, received.begin(), 10000) == 0);
+}
+
 TEST(AsyncIo, PipeThread) {
   auto ioContext = setupAsyncIo();
 
@@ -161,6 +308,30 @@ TEST(AsyncIo, PipeThread) {
   EXPECT_EQ("foo", heapString(buf, 3));
 }
 
+#if __linux__
+TEST(AsyncIo, PipeThreadOptions) {
+  auto ioContext = setupAsyncIo();
+
+  ThreadOptions options;
+  options.stackSize = 1 << 20;
+
+  auto pipeThread = ioContext.provider->newPipeThread(options,
+      [](AsyncIoProvider& ioProvider, AsyncIoStream& stream, WaitScope& waitScope) {
+    size_t stackSize = 0;
+    pthread_attr_t attr;
+    KJ_ASSERT(pthread_getattr_np(pthread_self(), &attr) == 0);
+    KJ_ASSERT(pthread_attr_getstacksize(&attr, &stackSize) == 0);
+    pthread_attr_destroy(&attr);
+
+    stream.write(&stackSize, sizeof(stackSize)).wait(waitScope);
+  });
+
+  size_t stackSize = 0;
+  pipeThread.pipe->read(&stackSize, sizeof(stackSize)).wait(ioContext.waitScope);
+  EXPECT_EQ(size_t(1 << 20), stackSize);
+}
+#endif
+
 TEST(AsyncIo, PipeThreadDisconnects) {
   // Like above, but in this case we expect the main thread to detect the pipe thread disconnecting.
 
@@ -184,5 +355,117 @@ TEST(AsyncIo, PipeThreadDisconnects) {
   EXPECT_EQ(0, pipeThread.pipe->tryRead(buf, 1, 1).wait(ioContext.waitScope));
 }
 
+TEST(AsyncIo, Timeouts) {
+  auto ioContext = setupAsyncIo();
+
+  Timer& timer = ioContext.provider->getTimer();
+
+  auto promise1 = timer.timeoutAfter(10 * MILLISECONDS, kj::Promise<void>(kj::NEVER_DONE));
+  auto promise2 = timer.timeoutAfter(100 * MILLISECONDS, kj::Promise<int>(123));
+
+  EXPECT_TRUE(promise1.then([]() { return false; }, [](kj::Exception&& e) {
+    EXPECT_EQ(kj::Exception::Durability::OVERLOADED, e.getDurability());
+    return true;
+  }).wait(ioContext.waitScope));
+  EXPECT_EQ(123, promise2.wait(ioContext.waitScope));
+}
+
+bool hasIoUringInstance() {
+  // Checks whether this process has an io_uring open, i.e. whether setupIoUringAsyncIo() really
+  // set one up rather than falling back to epoll.
+
+  DIR* dir = opendir("/proc/self/fd");
+  if (dir == nullptr) return false;
+  KJ_DEFER(closedir(dir));
+
+  while (struct dirent* entry = readdir(dir)) {
+    char target[64];
+    auto path = kj::str("/proc/self/fd/", entry->d_name);
+    ssize_t n = readlink(path.cStr(), target, sizeof(target));
+    if (n > 0 && StringPtr(heapString(target, n)) == "anon_inode:[io_uring]") {
+      return true;
+    }
+  }
+  return false;
+}
+
+#define SKIP_UNLESS_IO_URING \
+  if (!hasIoUringInstance()) { \
+    KJ_LOG(WARNING, "io_uring unavailable; skipping test"); \
+    return; \
+  }
+
+TEST(AsyncIo, IoUringSimpleNetwork) {
+  auto ioContext = setupIoUringAsyncIo();
+  SKIP_UNLESS_IO_URING;
+  testSimpleNetwork(ioContext);
+}
+
+TEST(AsyncIo, IoUringPipes) {
+  auto ioContext = setupIoUringAsyncIo();
+  SKIP_UNLESS_IO_URING;
+
+  // Much bigger than the pipe buffer, so the write has to wait for the reader.
+  auto data = heapArray<byte>(1 << 20);
+  for (uint i = 0; i < data.size(); i++) data[i] = i * 7;
+
+  auto pipe = ioContext.provider->newOneWayPipe();
+  auto writePromise = pipe.out->write(data.begin(), data.size());
+
+  auto received = heapArray<byte>(data.size() + 1);
+  EXPECT_EQ(data.size(), pipe.in->tryRead(received.begin(), data.size(), received.size())
+      .wait(ioContext.waitScope));
+  writePromise.wait(ioContext.waitScope);
+  EXPECT_TRUE(memcmp(data.begin(), received.begin(), data.size()) == 0);
+
+  // Gathered writes.
+  auto bytes = [](StringPtr text) {
+    return arrayPtr(reinterpret_cast<const byte*>(text.begin()), text.size());
+  };
+  ArrayPtr<const byte> pieces[3] = { bytes("foo"), bytes(""), bytes("bar") };
+  pipe.out->write(pieces).wait(ioContext.waitScope);
+  char buffer[6];
+  pipe.in->read(buffer, 6).wait(ioContext.waitScope);
+  EXPECT_EQ("foobar", heapString(buffer, 6));
+
+  // EOF.
+  pipe.out = nullptr;
+  EXPECT_EQ(0u, pipe.in->tryRead(buffer, 1, 6).wait(ioContext.waitScope));
+}
+
+TEST(AsyncIo, IoUringCancel) {
+  auto ioContext = setupIoUringAsyncIo();
+  SKIP_UNLESS_IO_URING;
+  auto pipe = ioContext.provider->newTwoWayPipe();
+
+  char buffer[4];
+  {
+    // Dropping a read must stop the kernel from writing into the buffer afterwards.
+    auto promise = pipe.ends[0]->tryRead(buffer, 1, 4);
+
+    // Let the read be submitted.
+    evalLater([]() {}).wait(ioContext.waitScope);
+  }
+
+  pipe.ends[1]->write("foo", 3).wait(ioContext.waitScope);
+  EXPECT_EQ(3u, pipe.ends[0]->tryRead(buffer, 3, 4).wait(ioContext.waitScope));
+  EXPECT_EQ("foo", heapString(buffer, 3));
+}
+
+TEST(AsyncIo, IoUringRegisteredBuffers) {
+  byte registered[64];
+  ArrayPtr<byte> buffers[1] = { registered };
+
+  IoUringOptions options;
+  options.registeredBuffers = buffers;
+  auto ioContext = setupIoUringAsyncIo(options);
+  SKIP_UNLESS_IO_URING;
+
+  auto pipe = ioContext.provider->newOneWayPipe();
+  pipe.out->write("registered", 10).wait(ioContext.waitScope);
+  EXPECT_EQ(10u, pipe.in->tryRead(registered + 4, 10, 20).wait(ioContext.waitScope));
+  EXPECT_EQ("registered", heapString(reinterpret_cast<char*>(registered) + 4, 10));
+}
+
 }  // namespace
 }  // namespace kj
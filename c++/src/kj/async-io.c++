@@ -25,7 +25,10 @@
 #include "async-unix.h"
 #include "debug.h"
 #include "thread.h"
+#include "thread-pool.h"
 #include "io.h"
+#include "string-tree.h"
+#include "vector.h"
 #include <unistd.h>
 #include <sys/uio.h>
 #include <errno.h>
@@ -39,7 +42,27 @@
 #include <stdlib.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <limits.h>
 #include <set>
+#include <map>
+
+#if __linux__ && !defined(KJ_USE_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+// Build with KJ_USE_IO_URING=0 to leave out setupIoUringAsyncIo() support.
+#define KJ_USE_IO_URING 1
+#endif
+#endif
+
+#if KJ_USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef IOV_MAX
+// Not all platforms define this; POSIX requires at least 16 but everyone supports far more.
+#define IOV_MAX 1024
+#endif
 
 #ifndef POLLRDHUP
 // Linux-only optimization.  If not available, define to 0, as this will make it a no-op.
@@ -58,6 +81,14 @@ void setNonblocking(int fd) {
   }
 }
 
+void setBlocking(int fd) {
+  int flags;
+  KJ_SYSCALL(flags = fcntl(fd, F_GETFL));
+  if ((flags & O_NONBLOCK) != 0) {
+    KJ_SYSCALL(fcntl(fd, F_SETFL, flags & ~O_NONBLOCK));
+  }
+}
+
 void setCloseOnExec(int fd) {
   int flags;
   KJ_SYSCALL(flags = fcntl(fd, F_GETFD));
@@ -66,6 +97,14 @@ void setCloseOnExec(int fd) {
   }
 }
 
+void setBusyPoll(int fd, uint micros) {
+  // Best-effort; see UnixEventPort::BusyPollOptions::socketBusyPollMicros.
+#ifdef SO_BUSY_POLL
+  int value = micros;
+  setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value));
+#endif
+}
+
 static constexpr uint NEW_FD_FLAGS =
 #if __linux__
     LowLevelAsyncIoProvider::ALREADY_CLOEXEC || LowLevelAsyncIoProvider::ALREADY_NONBLOCK ||
@@ -76,8 +115,11 @@ static constexpr uint NEW_FD_FLAGS =
 
 class OwnedFileDescriptor {
 public:
-  OwnedFileDescriptor(int fd, uint flags): fd(fd), flags(flags) {
-    if (flags & LowLevelAsyncIoProvider::ALREADY_NONBLOCK) {
+  OwnedFileDescriptor(int fd, uint flags, bool blocking = false): fd(fd), flags(flags) {
+    if (blocking) {
+      // Only io_uring wants this; see IoUringStream.
+      setBlocking(fd);
+    } else if (flags & LowLevelAsyncIoProvider::ALREADY_NONBLOCK) {
       KJ_DREQUIRE(fcntl(fd, F_GETFL) & O_NONBLOCK, "You claimed you set NONBLOCK, but you didn't.");
     } else {
       setNonblocking(fd);
@@ -112,10 +154,57 @@ private:
 
 // =======================================================================================
 
+class BufferedPump {
+  // Implements the default `AsyncInputStream::pumpTo()`.  Reads into one buffer while the other
+  // one is being written.
+
+public:
+  BufferedPump(AsyncInputStream& input, AsyncOutputStream& output, uint64_t limit)
+      : input(input), output(output), limit(limit) {}
+
+  Promise<uint64_t> pump() {
+    return pumpLoop(0, READY_NOW);
+  }
+
+private:
+  static constexpr size_t BUFFER_SIZE = 16384;
+
+  AsyncInputStream& input;
+  AsyncOutputStream& output;
+  uint64_t limit;
+  uint64_t readSoFar = 0;
+  byte buffers[2][BUFFER_SIZE];
+
+  Promise<uint64_t> pumpLoop(uint i, Promise<void> previousWrite) {
+    // `previousWrite` is writing out `buffers[1 - i]`, while `buffers[i]` is free to read into.
+
+    size_t amount = kj::min(limit - readSoFar, uint64_t(BUFFER_SIZE));
+    if (amount == 0) {
+      return previousWrite.then([this]() { return readSoFar; });
+    }
+
+    return input.tryRead(buffers[i], 1, amount).then(mvCapture(previousWrite,
+        [this,i](Promise<void>&& previousWrite, size_t n) -> Promise<uint64_t> {
+      if (n == 0) {
+        return previousWrite.then([this]() { return readSoFar; });
+      }
+
+      readSoFar += n;
+      return previousWrite.then([this,i,n]() {
+        return pumpLoop(1 - i, output.write(buffers[i], n).eagerlyEvaluate(nullptr));
+      });
+    }));
+  }
+};
+
+// =======================================================================================
+
 class AsyncStreamFd: public OwnedFileDescriptor, public AsyncIoStream {
 public:
   AsyncStreamFd(UnixEventPort& eventPort, int fd, uint flags)
-      : OwnedFileDescriptor(fd, flags), eventPort(eventPort) {}
+      : OwnedFileDescriptor(fd, flags),
+        eventPort(eventPort),
+        observer(eventPort, fd, UnixEventPort::FdObserver::OBSERVE_READ_WRITE) {}
   virtual ~AsyncStreamFd() noexcept(false) {}
 
   Promise<size_t> read(void* buffer, size_t minBytes, size_t maxBytes) override {
@@ -149,7 +238,7 @@ public:
       size -= n;
     }
 
-    return eventPort.onFdEvent(fd, POLLOUT).then([=](short) {
+    return observer.whenBecomesWritable().then([=]() {
       return write(buffer, size);
     });
   }
@@ -168,9 +257,23 @@ public:
     KJ_SYSCALL(shutdown(fd, SHUT_WR));
   }
 
+  Promise<uint64_t> pumpTo(AsyncOutputStream& output, uint64_t amount) override;
+
+  Promise<void> waitConnected() {
+    // Wait until initial connection has completed.  This actually just waits until it is writable.
+    return observer.whenBecomesWritable();
+  }
+
 private:
   UnixEventPort& eventPort;
-  bool gotHup = false;
+  UnixEventPort::FdObserver observer;
+
+#if __linux__
+  class SplicePump;
+#endif
+
+  uint busyPollMicros = 0;
+  // SO_BUSY_POLL value last applied to the socket.
 
   Promise<size_t> tryReadInternal(void* buffer, size_t minBytes, size_t maxBytes,
                                   size_t alreadyRead) {
@@ -178,6 +281,14 @@ private:
     // maxBytes, and buffer have already been adjusted to account for them, but this count must
     // be included in the final return value.
 
+    // Checked here rather than at construction so that turning busy-polling on also covers
+    // streams which were already open, such as an EzRpcClient's connection.
+    uint wantedBusyPollMicros = eventPort.getBusyPoll().socketBusyPollMicros;
+    if (wantedBusyPollMicros != busyPollMicros) {
+      setBusyPoll(fd, wantedBusyPollMicros);
+      busyPollMicros = wantedBusyPollMicros;
+    }
+
     ssize_t n;
     KJ_NONBLOCKING_SYSCALL(n = ::read(fd, buffer, maxBytes)) {
       return alreadyRead;
@@ -185,8 +296,7 @@ private:
 
     if (n < 0) {
       // Read would block.
-      return eventPort.onFdEvent(fd, POLLIN | POLLRDHUP).then([=](short events) {
-        gotHup = events & (POLLHUP | POLLRDHUP);
+      return observer.whenBecomesReadable().then([=]() {
         return tryReadInternal(buffer, minBytes, maxBytes, alreadyRead);
       });
     } else if (n == 0) {
@@ -194,7 +304,7 @@ private:
       return alreadyRead;
     } else if (implicitCast<size_t>(n) < minBytes) {
       // The kernel returned fewer bytes than we asked for (and fewer than we need).
-      if (gotHup) {
+      if (observer.atEndHint()) {
         // We've already received an indication that the next read() will return EOF, so there's
         // nothing to wait for.
         return alreadyRead + n;
@@ -210,8 +320,7 @@ private:
         minBytes -= n;
         maxBytes -= n;
         alreadyRead += n;
-        return eventPort.onFdEvent(fd, POLLIN | POLLRDHUP).then([=](short events) {
-          gotHup = events & (POLLHUP | POLLRDHUP);
+        return observer.whenBecomesReadable().then([=]() {
           return tryReadInternal(buffer, minBytes, maxBytes, alreadyRead);
         });
       }
@@ -223,14 +332,18 @@ private:
 
   Promise<void> writeInternal(ArrayPtr<const byte> firstPiece,
                               ArrayPtr<const ArrayPtr<const byte>> morePieces) {
-    KJ_STACK_ARRAY(struct iovec, iov, 1 + morePieces.size(), 16, 128);
+    // writev() rejects more than IOV_MAX pieces, so write at most that many at a time.
+    size_t iovCount = kj::min(1 + morePieces.size(), size_t(IOV_MAX));
+    KJ_STACK_ARRAY(struct iovec, iov, iovCount, 16, 128);
 
     // writev() interface is not const-correct.  :(
     iov[0].iov_base = const_cast<byte*>(firstPiece.begin());
     iov[0].iov_len = firstPiece.size();
-    for (uint i = 0; i < morePieces.size(); i++) {
+    size_t iovBytes = firstPiece.size();
+    for (uint i = 0; i + 1 < iovCount; i++) {
       iov[i + 1].iov_base = const_cast<byte*>(morePieces[i].begin());
       iov[i + 1].iov_len = morePieces[i].size();
+      iovBytes += morePieces[i].size();
     }
 
     ssize_t writeResult;
@@ -251,12 +364,20 @@ private:
     // A negative result means EAGAIN, which we can treat the same as having written zero bytes.
     size_t n = writeResult < 0 ? 0 : writeResult;
 
+    // If the kernel took everything we offered, any remaining pieces were simply beyond IOV_MAX
+    // and the socket may well still be writable.
+    bool wroteAll = writeResult >= 0 && n == iovBytes;
+
     // Discard all data that was written, then issue a new write for what's left (if any).
     for (;;) {
       if (n < firstPiece.size()) {
-        // Only part of the first piece was consumed.  Wait for POLLOUT and then write again.
         firstPiece = firstPiece.slice(n, firstPiece.size());
-        return eventPort.onFdEvent(fd, POLLOUT).then([=](short) {
+        if (wroteAll) {
+          return writeInternal(firstPiece, morePieces);
+        }
+
+        // Only part of the first piece was consumed.  Wait for POLLOUT and then write again.
+        return observer.whenBecomesWritable().then([=]() {
           return writeInternal(firstPiece, morePieces);
         });
       } else if (morePieces.size() == 0) {
@@ -273,8 +394,99 @@ private:
   }
 };
 
+#if __linux__
+
+class AsyncStreamFd::SplicePump {
+  // Moves data from one stream to another with splice(), through a pipe since splice() needs a
+  // pipe on one side.  We only splice into the pipe once it has been emptied, so an EAGAIN always
+  // refers to the stream rather than the pipe.
+
+public:
+  SplicePump(AsyncStreamFd& input, AsyncStreamFd& output, uint64_t limit)
+      : input(input), output(output), limit(limit) {
+    int fds[2];
+    KJ_SYSCALL(pipe2(fds, O_NONBLOCK | O_CLOEXEC));
+    pipeIn = fds[0];
+    pipeOut = fds[1];
+  }
+
+  ~SplicePump() {
+    close(pipeIn);
+    close(pipeOut);
+  }
+
+  Promise<uint64_t> pump() {
+    for (;;) {
+      if (buffered > 0) {
+        ssize_t n;
+        KJ_NONBLOCKING_SYSCALL(n = splice(pipeIn, nullptr, output.fd, nullptr, buffered,
+                                          SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) {
+          return pumped;
+        }
+        if (n < 0) {
+          return output.observer.whenBecomesWritable().then([this]() { return pump(); });
+        }
+        buffered -= n;
+        continue;
+      }
+
+      size_t amount = kj::min(limit - pumped, uint64_t(MAX_CHUNK));
+      if (amount == 0) return pumped;
+
+      ssize_t n = splice(input.fd, nullptr, pipeOut, nullptr, amount,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (n < 0) {
+        int error = errno;
+        if (error == EINTR) continue;
+        if (error == EAGAIN || error == EWOULDBLOCK) {
+          return input.observer.whenBecomesReadable().then([this]() { return pump(); });
+        }
+        if (error == EINVAL && pumped == 0) {
+          // This kind of descriptor doesn't support splice().  Copy instead.
+          return input.AsyncInputStream::pumpTo(output, limit);
+        }
+        KJ_FAIL_SYSCALL("splice", error) { return pumped; }
+      } else if (n == 0) {
+        return pumped;  // EOF
+      }
+
+      pumped += n;
+      buffered = n;
+    }
+  }
+
+private:
+  static constexpr size_t MAX_CHUNK = 65536;
+  // The default pipe capacity.
+
+  AsyncStreamFd& input;
+  AsyncStreamFd& output;
+  uint64_t limit;
+  int pipeIn;
+  int pipeOut;
+  uint64_t pumped = 0;
+  size_t buffered = 0;
+  // Bytes sitting in the pipe.
+};
+
+#endif  // __linux__
+
+Promise<uint64_t> AsyncStreamFd::pumpTo(AsyncOutputStream& output, uint64_t amount) {
+#if __linux__
+  KJ_IF_MAYBE(fdOutput, kj::dynamicDowncastIfAvailable<AsyncStreamFd>(output)) {
+    auto pump = heap<SplicePump>(*this, *fdOutput, amount);
+    auto promise = pump->pump();
+    return promise.attach(kj::mv(pump));
+  }
+#endif
+
+  return AsyncInputStream::pumpTo(output, amount);
+}
+
 // =======================================================================================
 
+class HostResolver;
+
 class SocketAddress {
 public:
   SocketAddress(const void* sockaddr, uint len): addrlen(len) {
@@ -389,11 +601,15 @@ public:
   }
 
   static Promise<Array<SocketAddress>> lookupHost(
-      LowLevelAsyncIoProvider& lowLevel, kj::String host, kj::String service, uint portHint);
-  // Perform a DNS lookup.
+      const ThreadPool& pool, kj::String host, kj::String service, uint portHint);
+  // Perform a DNS lookup on one of `pool`'s threads.
+
+  static Promise<Array<SocketAddress>> lookupHost(
+      HostResolver& resolver, kj::String host, kj::String service, uint portHint);
+  // Perform a DNS lookup through `resolver`, which may answer from its cache.
 
   static Promise<Array<SocketAddress>> parse(
-      LowLevelAsyncIoProvider& lowLevel, StringPtr str, uint portHint) {
+      HostResolver& resolver, StringPtr str, uint portHint) {
     // TODO(someday):  Allow commas in `str`.
 
     SocketAddress result;
@@ -457,7 +673,7 @@ public:
       port = strtoul(portText->cStr(), &endptr, 0);
       if (portText->size() == 0 || *endptr != '\0') {
         // Not a number.  Maybe it's a service name.  Fall back to DNS.
-        return lookupHost(lowLevel, kj::heapString(addrPart), kj::heapString(*portText), portHint);
+        return lookupHost(resolver, kj::heapString(addrPart), kj::heapString(*portText), portHint);
       }
       KJ_REQUIRE(port < 65536, "Port number too large.");
     } else {
@@ -504,7 +720,7 @@ public:
       }
       case 0:
         // It's apparently not a simple address...  fall back to DNS.
-        return lookupHost(lowLevel, kj::heapString(addrPart), nullptr, port);
+        return lookupHost(resolver, kj::heapString(addrPart), nullptr, port);
       default:
         KJ_FAIL_SYSCALL("inet_pton", errno, af, addrPart);
     }
@@ -533,54 +749,6 @@ private:
   } addr;
 
   struct LookupParams;
-  class LookupReader;
-};
-
-class SocketAddress::LookupReader {
-  // Reads SocketAddresses off of a pipe coming from another thread that is performing
-  // getaddrinfo.
-
-public:
-  LookupReader(kj::Own<Thread>&& thread, kj::Own<AsyncInputStream>&& input)
-      : thread(kj::mv(thread)), input(kj::mv(input)) {}
-
-  ~LookupReader() {
-    if (thread) thread->detach();
-  }
-
-  Promise<Array<SocketAddress>> read() {
-    return input->tryRead(&current, sizeof(current), sizeof(current)).then(
-        [this](size_t n) -> Promise<Array<SocketAddress>> {
-      if (n < sizeof(current)) {
-        thread = nullptr;
-        // getaddrinfo()'s docs seem to say it will never return an empty list, but let's check
-        // anyway.
-        KJ_REQUIRE(addresses.size() > 0, "DNS lookup returned no addresses.") { break; }
-        return addresses.releaseAsArray();
-      } else {
-        // getaddrinfo() can return multiple copies of the same address for several reasons.
-        // A major one is that we don't give it a socket type (SOCK_STREAM vs. SOCK_DGRAM), so
-        // it may return two copies of the same address, one for each type, unless it explicitly
-        // knows that the service name given is specific to one type.  But we can't tell it a type,
-        // because we don't actually know which one the user wants, and if we specify SOCK_STREAM
-        // while the user specified a UDP service name then they'll get a resolution error which
-        // is lame.  (At least, I think that's how it works.)
-        //
-        // So we instead resort to de-duping results.
-        if (alreadySeen.insert(current).second) {
-          addresses.add(current);
-        }
-        return read();
-      }
-    });
-  }
-
-private:
-  kj::Own<Thread> thread;
-  kj::Own<AsyncInputStream> input;
-  SocketAddress current;
-  kj::Vector<SocketAddress> addresses;
-  std::set<SocketAddress> alreadySeen;
 };
 
 struct SocketAddress::LookupParams {
@@ -589,93 +757,158 @@ struct SocketAddress::LookupParams {
 };
 
 Promise<Array<SocketAddress>> SocketAddress::lookupHost(
-    LowLevelAsyncIoProvider& lowLevel, kj::String host, kj::String service, uint portHint) {
-  // This shitty function spawns a thread to run getaddrinfo().  Unfortunately, getaddrinfo() is
-  // the only cross-platform DNS API and it is blocking.
+    const ThreadPool& pool, kj::String host, kj::String service, uint portHint) {
+  // getaddrinfo() is the only cross-platform DNS API and it is blocking, so we run it on a thread
+  // pool.
   //
-  // TODO(perf):  Use a thread pool?  Maybe kj::Thread should use a thread pool automatically?
-  //   Maybe use the various platform-specific asynchronous DNS libraries?  Please do not implement
-  //   a custom DNS resolver...
-
-  int fds[2];
-#if __linux__
-  KJ_SYSCALL(pipe2(fds, O_NONBLOCK | O_CLOEXEC));
-#else
-  KJ_SYSCALL(pipe(fds));
-#endif
-
-  auto input = lowLevel.wrapInputFd(fds[0], NEW_FD_FLAGS);
-
-  int outFd = fds[1];
+  // TODO(someday):  Maybe use the various platform-specific asynchronous DNS libraries?  Please do
+  //   not implement a custom DNS resolver...
 
   LookupParams params = { kj::mv(host), kj::mv(service) };
 
-  auto thread = heap<Thread>(kj::mvCapture(params, [outFd,portHint](LookupParams&& params) {
-    FdOutputStream output((AutoCloseFd(outFd)));
-
+  return pool.run(kj::mvCapture(params, [portHint](LookupParams&& params) {
     struct addrinfo* list;
     int status = getaddrinfo(
         params.host == "*" ? nullptr : params.host.cStr(),
         params.service == nullptr ? nullptr : params.service.cStr(),
         nullptr, &list);
-    if (status == 0) {
-      KJ_DEFER(freeaddrinfo(list));
-
-      struct addrinfo* cur = list;
-      while (cur != nullptr) {
-        if (params.service == nullptr) {
-          switch (cur->ai_addr->sa_family) {
-            case AF_INET:
-              ((struct sockaddr_in*)cur->ai_addr)->sin_port = htons(portHint);
-              break;
-            case AF_INET6:
-              ((struct sockaddr_in6*)cur->ai_addr)->sin6_port = htons(portHint);
-              break;
-            default:
-              break;
-          }
+    if (status == EAI_SYSTEM) {
+      KJ_FAIL_SYSCALL("getaddrinfo", errno, params.host, params.service);
+    } else if (status != 0) {
+      KJ_FAIL_REQUIRE("DNS lookup failed.", params.host, params.service, gai_strerror(status));
+    }
+    KJ_DEFER(freeaddrinfo(list));
+
+    kj::Vector<SocketAddress> addresses;
+    std::set<SocketAddress> alreadySeen;
+
+    for (struct addrinfo* cur = list; cur != nullptr; cur = cur->ai_next) {
+      if (params.service == nullptr) {
+        switch (cur->ai_addr->sa_family) {
+          case AF_INET:
+            ((struct sockaddr_in*)cur->ai_addr)->sin_port = htons(portHint);
+            break;
+          case AF_INET6:
+            ((struct sockaddr_in6*)cur->ai_addr)->sin6_port = htons(portHint);
+            break;
+          default:
+            break;
         }
+      }
 
-        SocketAddress addr;
-        memset(&addr, 0, sizeof(addr));  // mollify valgrind
-        if (params.host == "*") {
-          // Set up a wildcard SocketAddress.  Only use the port number returned by getaddrinfo().
-          addr.wildcard = true;
-          addr.addrlen = sizeof(addr.addr.inet6);
-          addr.addr.inet6.sin6_family = AF_INET6;
-          switch (cur->ai_addr->sa_family) {
-            case AF_INET:
-              addr.addr.inet6.sin6_port = ((struct sockaddr_in*)cur->ai_addr)->sin_port;
-              break;
-            case AF_INET6:
-              addr.addr.inet6.sin6_port = ((struct sockaddr_in6*)cur->ai_addr)->sin6_port;
-              break;
-            default:
-              addr.addr.inet6.sin6_port = portHint;
-              break;
-          }
-        } else {
-          addr.addrlen = cur->ai_addrlen;
-          memcpy(&addr.addr.generic, cur->ai_addr, cur->ai_addrlen);
+      SocketAddress addr;
+      if (params.host == "*") {
+        // Set up a wildcard SocketAddress.  Only use the port number returned by getaddrinfo().
+        addr.wildcard = true;
+        addr.addrlen = sizeof(addr.addr.inet6);
+        addr.addr.inet6.sin6_family = AF_INET6;
+        switch (cur->ai_addr->sa_family) {
+          case AF_INET:
+            addr.addr.inet6.sin6_port = ((struct sockaddr_in*)cur->ai_addr)->sin_port;
+            break;
+          case AF_INET6:
+            addr.addr.inet6.sin6_port = ((struct sockaddr_in6*)cur->ai_addr)->sin6_port;
+            break;
+          default:
+            addr.addr.inet6.sin6_port = portHint;
+            break;
         }
-        static_assert(canMemcpy<SocketAddress>(), "Can't write() SocketAddress...");
-        output.write(&addr, sizeof(addr));
-        cur = cur->ai_next;
+      } else {
+        addr.addrlen = cur->ai_addrlen;
+        memcpy(&addr.addr.generic, cur->ai_addr, cur->ai_addrlen);
       }
-    } else if (status == EAI_SYSTEM) {
-      KJ_FAIL_SYSCALL("getaddrinfo", errno, params.host, params.service) {
-        return;
+
+      // getaddrinfo() can return multiple copies of the same address for several reasons.
+      // A major one is that we don't give it a socket type (SOCK_STREAM vs. SOCK_DGRAM), so
+      // it may return two copies of the same address, one for each type, unless it explicitly
+      // knows that the service name given is specific to one type.  But we can't tell it a type,
+      // because we don't actually know which one the user wants, and if we specify SOCK_STREAM
+      // while the user specified a UDP service name then they'll get a resolution error which
+      // is lame.  (At least, I think that's how it works.)
+      //
+      // So we instead resort to de-duping results.
+      if (alreadySeen.insert(addr).second) {
+        addresses.add(addr);
       }
+    }
+
+    // getaddrinfo()'s docs seem to say it will never return an empty list, but let's check
+    // anyway.
+    KJ_REQUIRE(addresses.size() > 0, "DNS lookup returned no addresses.", params.host);
+
+    return addresses.releaseAsArray();
+  }));
+}
+
+class HostResolver {
+  // Performs the DNS lookups for a `SocketNetwork`, optionally remembering the results for a
+  // short time.
+
+public:
+  HostResolver(Timer& timer, const NetworkOptions& options)
+      : timer(timer), cacheTtl(options.lookupCacheTtl) {
+    KJ_IF_MAYBE(p, options.lookupThreadPool) {
+      pool = p;
     } else {
-      KJ_FAIL_REQUIRE("DNS lookup failed.",
-                      params.host, params.service, gai_strerror(status)) {
-        return;
+      ownPool = heap<ThreadPool>(options.lookupThreads);
+      pool = ownPool.get();
+    }
+  }
+
+  Promise<Array<SocketAddress>> lookup(kj::String host, kj::String service, uint portHint) {
+    if (cacheTtl <= 0 * SECONDS) {
+      return SocketAddress::lookupHost(*pool, kj::mv(host), kj::mv(service), portHint);
+    }
+
+    auto key = kj::str(host, ' ', service, ' ', portHint);
+
+    auto iter = cache.find(key);
+    if (iter != cache.end() && iter->second.expires > timer.now()) {
+      return kj::heapArray<SocketAddress>(iter->second.addresses);
+    }
+
+    return SocketAddress::lookupHost(*pool, kj::mv(host), kj::mv(service), portHint)
+        .then(kj::mvCapture(key, [this](kj::String&& key, Array<SocketAddress>&& addresses) {
+      auto now = timer.now();
+
+      // Lookups only happen on a cache miss, so a full sweep here costs little by comparison.
+      for (auto iter = cache.begin(); iter != cache.end();) {
+        if (iter->second.expires <= now) {
+          iter = cache.erase(iter);
+        } else {
+          ++iter;
+        }
       }
+
+      auto& entry = cache[kj::mv(key)];
+      entry.expires = now + cacheTtl;
+      entry.addresses = kj::heapArray<SocketAddress>(addresses);
+      return kj::mv(addresses);
+    }));
+  }
+
+private:
+  struct CacheEntry {
+    TimePoint expires = origin<TimePoint>();
+    Array<SocketAddress> addresses;
+  };
+
+  struct KeyLess {
+    inline bool operator()(const kj::String& a, const kj::String& b) const {
+      return StringPtr(a) < StringPtr(b);
     }
-  }));
+  };
+
+  Timer& timer;
+  Duration cacheTtl;
+  const ThreadPool* pool;
+  Own<ThreadPool> ownPool;
+  std::map<kj::String, CacheEntry, KeyLess> cache;
+};
 
-  auto reader = heap<LookupReader>(kj::mv(thread), kj::mv(input));
-  return reader->read().attach(kj::mv(reader));
+Promise<Array<SocketAddress>> SocketAddress::lookupHost(
+    HostResolver& resolver, kj::String host, kj::String service, uint portHint) {
+  return resolver.lookup(kj::mv(host), kj::mv(service), portHint);
 }
 
 // =======================================================================================
@@ -683,7 +916,8 @@ Promise<Array<SocketAddress>> SocketAddress::lookupHost(
 class FdConnectionReceiver final: public ConnectionReceiver, public OwnedFileDescriptor {
 public:
   FdConnectionReceiver(UnixEventPort& eventPort, int fd, uint flags)
-      : OwnedFileDescriptor(fd, flags), eventPort(eventPort) {}
+      : OwnedFileDescriptor(fd, flags), eventPort(eventPort),
+        observer(eventPort, fd, UnixEventPort::FdObserver::OBSERVE_READ) {}
 
   Promise<Own<AsyncIoStream>> accept() override {
     int newFd;
@@ -706,7 +940,7 @@ public:
         case EWOULDBLOCK:
 #endif
           // Not ready yet.
-          return eventPort.onFdEvent(fd, POLLIN).then([this](short) {
+          return observer.whenBecomesReadable().then([this]() {
             return accept();
           });
 
@@ -737,13 +971,34 @@ public:
 
 public:
   UnixEventPort& eventPort;
+  UnixEventPort::FdObserver observer;
+};
+
+class TimerImpl final: public Timer {
+public:
+  TimerImpl(UnixEventPort& eventPort): eventPort(eventPort) {}
+
+  TimePoint now() override { return eventPort.steadyTime(); }
+
+  Promise<void> atTime(TimePoint time) override {
+    return eventPort.atSteadyTime(time);
+  }
+
+  Promise<void> afterDelay(Duration delay) override {
+    return eventPort.atSteadyTime(eventPort.steadyTime() + delay);
+  }
+
+private:
+  UnixEventPort& eventPort;
 };
 
 class LowLevelAsyncIoProviderImpl final: public LowLevelAsyncIoProvider {
 public:
-  LowLevelAsyncIoProviderImpl(): eventLoop(eventPort), waitScope(eventLoop) {}
+  LowLevelAsyncIoProviderImpl()
+      : eventLoop(eventPort), timer(eventPort), waitScope(eventLoop) {}
 
   inline WaitScope& getWaitScope() { return waitScope; }
+  inline UnixEventPort& getEventPort() { return eventPort; }
 
   Own<AsyncInputStream> wrapInputFd(int fd, uint flags = 0) override {
     return heap<AsyncStreamFd>(eventPort, fd, flags);
@@ -756,27 +1011,614 @@ public:
   }
   Promise<Own<AsyncIoStream>> wrapConnectingSocketFd(int fd, uint flags = 0) override {
     auto result = heap<AsyncStreamFd>(eventPort, fd, flags);
-    return eventPort.onFdEvent(fd, POLLOUT).then(kj::mvCapture(result,
-        [fd](Own<AsyncIoStream>&& stream, short events) {
+    auto connected = result->waitConnected();
+    return connected.then(kj::mvCapture(result,
+        [fd](Own<AsyncStreamFd>&& stream) {
           int err;
           socklen_t errlen = sizeof(err);
           KJ_SYSCALL(getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen));
           if (err != 0) {
             KJ_FAIL_SYSCALL("connect()", err) { break; }
           }
-          return kj::mv(stream);
+          return Own<AsyncIoStream>(kj::mv(stream));
         }));
   }
   Own<ConnectionReceiver> wrapListenSocketFd(int fd, uint flags = 0) override {
     return heap<FdConnectionReceiver>(eventPort, fd, flags);
   }
 
+  Timer& getTimer() override { return timer; }
+
+private:
+  UnixEventPort eventPort;
+  EventLoop eventLoop;
+  TimerImpl timer;
+  WaitScope waitScope;
+};
+
+// =======================================================================================
+
+#if KJ_USE_IO_URING
+
+class IoUring {
+  // One io_uring instance, driven by the event loop.  Operations queue their submission entries
+  // as they start, and everything queued during a turn goes to the kernel in a single
+  // io_uring_enter() from an event scheduled at the end of the turn.  Completions are reaped
+  // whenever the ring's descriptor, which sits in the UnixEventPort's epoll set, becomes readable.
+
+public:
+  IoUring(UnixEventPort& eventPort, const IoUringOptions& options);
+  ~IoUring() noexcept(false);
+  KJ_DISALLOW_COPY(IoUring);
+
+  Promise<int> run(const struct io_uring_sqe& sqe);
+  // Submits the operation described by `sqe` (whose `user_data` is ignored) and resolves to its
+  // result: non-negative on success or a negated errno.  Dropping the promise cancels the
+  // operation, and waits for the kernel to acknowledge, since it may still be using the buffers.
+
+  Maybe<uint> findRegisteredBuffer(const void* begin, size_t size);
+  // If [begin, begin + size) is within one of the registered buffers, return its index.
+
+  static bool isSupported();
+
+private:
+  class Op;
+  class OpAdapter;
+
+  struct io_uring_params params;
+  int ringFd;
+
+  void* sqRing = nullptr;
+  size_t sqRingSize = 0;
+  void* cqRing = nullptr;
+  size_t cqRingSize = 0;
+  struct io_uring_sqe* sqes = nullptr;
+
+  uint32_t* sqHead;
+  uint32_t* sqTail;
+  uint32_t* sqFlags;
+  uint32_t* sqArray;
+  uint32_t sqMask;
+  uint32_t* cqHead;
+  uint32_t* cqTail;
+  struct io_uring_cqe* cqes;
+  uint32_t cqMask;
+
+  uint32_t queuedTail;
+  // Our copy of the submission queue tail, including entries not yet handed to the kernel.
+
+  uint32_t unsubmitted = 0;
+
+  Array<struct iovec> registeredBuffers;
+
+  Own<UnixEventPort::FdObserver> observer;
+  Promise<void> reapTask = nullptr;
+
+  bool flushScheduled = false;
+  Promise<void> flushTask = nullptr;
+
+  void push(const struct io_uring_sqe& sqe, Op* op);
+  void enqueue(const struct io_uring_sqe& sqe, Op* op);
+  // Queue an entry.  enqueue() also makes sure it gets submitted at the end of the turn.
+
+  void submit();
+  int enter(uint toSubmit, uint minComplete, uint flags);
+  void reap();
+  Promise<void> reapLoop();
+  void cancel(Op& op);
+  void unmapAndClose();
+};
+
+class IoUring::Op {
+public:
+  virtual void complete(int result) = 0;
+
+  bool done = false;
+  bool canceling = false;
+};
+
+class IoUring::OpAdapter final: public Op {
+public:
+  OpAdapter(PromiseFulfiller<int>& fulfiller, IoUring& ring, const struct io_uring_sqe& sqe)
+      : fulfiller(fulfiller), ring(ring) {
+    ring.enqueue(sqe, this);
+  }
+
+  ~OpAdapter() noexcept(false) {
+    if (!done) {
+      ring.cancel(*this);
+    }
+  }
+
+  void complete(int result) override {
+    fulfiller.fulfill(kj::cp(result));
+  }
+
+private:
+  PromiseFulfiller<int>& fulfiller;
+  IoUring& ring;
+};
+
+IoUring::IoUring(UnixEventPort& eventPort, const IoUringOptions& options) {
+  memset(&params, 0, sizeof(params));
+  KJ_SYSCALL(ringFd = syscall(__NR_io_uring_setup, options.queueDepth, &params));
+  KJ_ON_SCOPE_FAILURE(unmapAndClose());
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sqRingSize = cqRingSize = kj::max(sqRingSize, cqRingSize);
+  }
+
+  auto map = [this](size_t size, off_t offset) {
+    void* result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd, offset);
+    if (result == MAP_FAILED) {
+      KJ_FAIL_SYSCALL("mmap(io_uring)", errno, offset);
+    }
+    return result;
+  };
+
+  sqRing = map(sqRingSize, IORING_OFF_SQ_RING);
+  cqRing = params.features & IORING_FEAT_SINGLE_MMAP ? sqRing : map(cqRingSize, IORING_OFF_CQ_RING);
+  sqes = reinterpret_cast<struct io_uring_sqe*>(
+      map(params.sq_entries * sizeof(struct io_uring_sqe), IORING_OFF_SQES));
+
+  byte* sq = reinterpret_cast<byte*>(sqRing);
+  sqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+  sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+  sqFlags = reinterpret_cast<uint32_t*>(sq + params.sq_off.flags);
+  sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+  sqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+
+  byte* cq = reinterpret_cast<byte*>(cqRing);
+  cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+  cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+  cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  cqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+
+  queuedTail = *sqTail;
+
+  if (options.registeredBuffers.size() > 0) {
+    registeredBuffers = KJ_MAP(buffer, options.registeredBuffers) {
+      struct iovec iov;
+      iov.iov_base = const_cast<byte*>(buffer.begin());
+      iov.iov_len = buffer.size();
+      return iov;
+    };
+    KJ_SYSCALL(syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS,
+                       registeredBuffers.begin(), registeredBuffers.size()));
+  }
+
+  observer = heap<UnixEventPort::FdObserver>(eventPort, ringFd,
+                                             UnixEventPort::FdObserver::OBSERVE_READ);
+  reapTask = reapLoop().eagerlyEvaluate([](Exception&& exception) {
+    KJ_LOG(ERROR, "io_uring completion processing failed", exception);
+  });
+}
+
+IoUring::~IoUring() noexcept(false) {
+  flushTask = nullptr;
+  reapTask = nullptr;
+  observer = nullptr;
+  unmapAndClose();
+}
+
+void IoUring::unmapAndClose() {
+  if (sqes != nullptr) munmap(sqes, params.sq_entries * sizeof(struct io_uring_sqe));
+  if (cqRing != nullptr && cqRing != sqRing) munmap(cqRing, cqRingSize);
+  if (sqRing != nullptr) munmap(sqRing, sqRingSize);
+  close(ringFd);
+}
+
+bool IoUring::isSupported() {
+  static int supported = -1;
+  // Racy but idempotent.
+
+  int result = __atomic_load_n(&supported, __ATOMIC_RELAXED);
+  if (result < 0) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, 1, &params);
+    if (fd < 0) {
+      // ENOSYS on old kernels; EPERM where disabled by sysctl or seccomp.
+      result = 0;
+    } else {
+      close(fd);
+      // Fast poll (Linux 5.7) is what makes socket reads cheap: without it, each read that would
+      // block ties up a kernel worker thread.  Every opcode we use predates it.
+      result = (params.features & IORING_FEAT_FAST_POLL) != 0;
+    }
+    __atomic_store_n(&supported, result, __ATOMIC_RELAXED);
+  }
+  return result;
+}
+
+Promise<int> IoUring::run(const struct io_uring_sqe& sqe) {
+  return newAdaptedPromise<int, OpAdapter>(*this, sqe);
+}
+
+Maybe<uint> IoUring::findRegisteredBuffer(const void* begin, size_t size) {
+  const byte* ptr = reinterpret_cast<const byte*>(begin);
+  for (uint i = 0; i < registeredBuffers.size(); i++) {
+    const byte* start = reinterpret_cast<const byte*>(registeredBuffers[i].iov_base);
+    if (ptr >= start && ptr + size <= start + registeredBuffers[i].iov_len) {
+      return i;
+    }
+  }
+  return nullptr;
+}
+
+void IoUring::push(const struct io_uring_sqe& sqe, Op* op) {
+  if (queuedTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == params.sq_entries) {
+    // Queue full; hand over what we have early.
+    submit();
+  }
+
+  uint32_t index = queuedTail & sqMask;
+  sqes[index] = sqe;
+  sqes[index].user_data = reinterpret_cast<uint64_t>(op);
+  sqArray[index] = index;
+  ++queuedTail;
+  ++unsubmitted;
+}
+
+void IoUring::enqueue(const struct io_uring_sqe& sqe, Op* op) {
+  push(sqe, op);
+
+  if (!flushScheduled) {
+    flushScheduled = true;
+    flushTask = evalLater([this]() {
+      flushScheduled = false;
+      submit();
+    }).eagerlyEvaluate([](Exception&& exception) {
+      KJ_LOG(ERROR, "io_uring submission failed", exception);
+    });
+  }
+}
+
+void IoUring::submit() {
+  __atomic_store_n(sqTail, queuedTail, __ATOMIC_RELEASE);
+  while (unsubmitted > 0) {
+    unsubmitted -= enter(unsubmitted, 0, 0);
+  }
+
+  // Reads on sockets which already have data, and most writes, complete during submission.
+  // Picking them up now saves a trip through epoll.
+  reap();
+}
+
+int IoUring::enter(uint toSubmit, uint minComplete, uint flags) {
+  for (;;) {
+    long n = syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0);
+    if (n >= 0) {
+      return n;
+    }
+
+    int error = errno;
+    if (error == EINTR) {
+      continue;
+    } else if ((error == EAGAIN || error == EBUSY) && toSubmit > 0) {
+      // The kernel is short of memory for requests, or the completion queue has overflowed.
+      // Either way, draining completions makes room.
+      reap();
+    } else {
+      KJ_FAIL_SYSCALL("io_uring_enter", error);
+    }
+  }
+}
+
+void IoUring::reap() {
+  for (;;) {
+    uint32_t head = *cqHead;
+    uint32_t tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+      struct io_uring_cqe& cqe = cqes[head & cqMask];
+      Op* op = reinterpret_cast<Op*>(cqe.user_data);
+      int result = cqe.res;
+
+      // Release the slot before calling out, in case the callee submits more.
+      __atomic_store_n(cqHead, ++head, __ATOMIC_RELEASE);
+
+      if (op != nullptr) {
+        op->done = true;
+        if (!op->canceling) {
+          op->complete(result);
+        }
+      }
+    }
+
+    if ((__atomic_load_n(sqFlags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) == 0) {
+      break;
+    }
+
+    // Completions which didn't fit were held back by the kernel; ask for them.
+    enter(0, 0, IORING_ENTER_GETEVENTS);
+  }
+}
+
+Promise<void> IoUring::reapLoop() {
+  return observer->whenBecomesReadable().then([this]() {
+    reap();
+    return reapLoop();
+  });
+}
+
+void IoUring::cancel(Op& op) {
+  op.canceling = true;
+
+  struct io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_ASYNC_CANCEL;
+  sqe.fd = -1;
+  sqe.addr = reinterpret_cast<uint64_t>(static_cast<Op*>(&op));
+  push(sqe, nullptr);
+  submit();
+
+  while (!op.done) {
+    enter(0, 1, IORING_ENTER_GETEVENTS);
+    reap();
+  }
+}
+
+struct io_uring_sqe makeSqe(uint8_t opcode, int fd) {
+  struct io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = opcode;
+  sqe.fd = fd;
+  return sqe;
+}
+
+Promise<void> pollFd(IoUring& ring, int fd, short events) {
+  auto sqe = makeSqe(IORING_OP_POLL_ADD, fd);
+  sqe.poll_events = events;
+  return ring.run(sqe).then([](int result) {
+    if (result < 0) {
+      KJ_FAIL_SYSCALL("poll", -result);
+    }
+  });
+}
+
+class IoUringStream final: public OwnedFileDescriptor, public AsyncIoStream {
+  // Stream whose reads and writes are io_uring operations rather than readiness notifications
+  // followed by system calls.
+  //
+  // The descriptor is switched to blocking mode: io_uring then arms an internal poll on its own
+  // when an operation can't complete right away, whereas on a non-blocking descriptor it just
+  // fails the operation with EAGAIN.  (We cope with EAGAIN anyway, in case someone else flips the
+  // flag back, by waiting for readiness and retrying.)
+
+public:
+  IoUringStream(IoUring& ring, int fd, uint flags)
+      : OwnedFileDescriptor(fd, flags, true), ring(ring) {}
+
+  Promise<size_t> read(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return tryReadInternal(reinterpret_cast<byte*>(buffer), minBytes, maxBytes, 0)
+        .then([=](size_t result) {
+      KJ_REQUIRE(result >= minBytes, "Premature EOF") {
+        // Pretend we read zeros from the input.
+        memset(reinterpret_cast<byte*>(buffer) + result, 0, minBytes - result);
+        return minBytes;
+      }
+      return result;
+    });
+  }
+
+  Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return tryReadInternal(reinterpret_cast<byte*>(buffer), minBytes, maxBytes, 0);
+  }
+
+  Promise<void> write(const void* buffer, size_t size) override {
+    return writeInternal(arrayPtr(reinterpret_cast<const byte*>(buffer), size), nullptr);
+  }
+
+  Promise<void> write(ArrayPtr<const ArrayPtr<const byte>> pieces) override {
+    if (pieces.size() == 0) {
+      return READY_NOW;
+    }
+    return writeInternal(pieces[0], pieces.slice(1, pieces.size()));
+  }
+
+  void shutdownWrite() override {
+    KJ_SYSCALL(shutdown(fd, SHUT_WR));
+  }
+
+  Promise<void> waitConnected() {
+    return pollFd(ring, fd, POLLOUT);
+  }
+
+private:
+  IoUring& ring;
+
+  static constexpr size_t MAX_IO_SIZE = 0x7ffff000;
+  // Linux never transfers more than this in one call.
+
+  Promise<size_t> tryReadInternal(byte* buffer, size_t minBytes, size_t maxBytes,
+                                  size_t alreadyRead) {
+    // Same contract as AsyncStreamFd::tryReadInternal().
+
+    auto sqe = makeSqe(IORING_OP_READ, fd);
+    KJ_IF_MAYBE(index, ring.findRegisteredBuffer(buffer, maxBytes)) {
+      sqe.opcode = IORING_OP_READ_FIXED;
+      sqe.buf_index = *index;
+    }
+    sqe.addr = reinterpret_cast<uint64_t>(buffer);
+    sqe.len = kj::min(maxBytes, MAX_IO_SIZE);
+    sqe.off = -1;  // Current file position, like read().
+
+    return ring.run(sqe).then([=](int result) -> Promise<size_t> {
+      if (result < 0) {
+        if (result == -EINTR) {
+          return tryReadInternal(buffer, minBytes, maxBytes, alreadyRead);
+        } else if (result == -EAGAIN) {
+          return pollFd(ring, fd, POLLIN).then([=]() {
+            return tryReadInternal(buffer, minBytes, maxBytes, alreadyRead);
+          });
+        }
+        KJ_FAIL_SYSCALL("read", -result, fd) { break; }
+        return alreadyRead;
+      } else if (result == 0) {
+        // EOF -OR- maxBytes == 0.
+        return alreadyRead;
+      } else if (implicitCast<size_t>(result) < minBytes) {
+        return tryReadInternal(buffer + result, minBytes - result, maxBytes - result,
+                               alreadyRead + result);
+      } else {
+        return alreadyRead + result;
+      }
+    });
+  }
+
+  Promise<void> writeInternal(ArrayPtr<const byte> firstPiece,
+                              ArrayPtr<const ArrayPtr<const byte>> morePieces) {
+    // The iovecs must stay put until the kernel is done with them.
+    auto iov = heapArray<struct iovec>(kj::min(1 + morePieces.size(), size_t(IOV_MAX)));
+
+    // writev() interface is not const-correct.  :(
+    iov[0].iov_base = const_cast<byte*>(firstPiece.begin());
+    iov[0].iov_len = firstPiece.size();
+    for (uint i = 1; i < iov.size(); i++) {
+      iov[i].iov_base = const_cast<byte*>(morePieces[i - 1].begin());
+      iov[i].iov_len = morePieces[i - 1].size();
+    }
+
+    auto sqe = makeSqe(IORING_OP_WRITEV, fd);
+    sqe.addr = reinterpret_cast<uint64_t>(iov.begin());
+    sqe.len = iov.size();
+    sqe.off = -1;
+
+    return ring.run(sqe).then([=](int result) -> Promise<void> {
+      if (result < 0) {
+        if (result == -EINTR) {
+          return writeInternal(firstPiece, morePieces);
+        } else if (result == -EAGAIN) {
+          return pollFd(ring, fd, POLLOUT).then([=]() {
+            return writeInternal(firstPiece, morePieces);
+          });
+        }
+        KJ_FAIL_SYSCALL("writev", -result, fd) { break; }
+        return READY_NOW;
+      }
+      return writeRemaining(result, firstPiece, morePieces);
+    }).attach(kj::mv(iov));
+  }
+
+  Promise<void> writeRemaining(size_t n, ArrayPtr<const byte> firstPiece,
+                               ArrayPtr<const ArrayPtr<const byte>> morePieces) {
+    // Discard all data that was written, then issue a new write for what's left (if any).
+    for (;;) {
+      if (n < firstPiece.size()) {
+        return writeInternal(firstPiece.slice(n, firstPiece.size()), morePieces);
+      } else if (morePieces.size() == 0) {
+        KJ_DASSERT(n == firstPiece.size(), n);
+        return READY_NOW;
+      } else {
+        n -= firstPiece.size();
+        firstPiece = morePieces[0];
+        morePieces = morePieces.slice(1, morePieces.size());
+      }
+    }
+  }
+};
+
+class IoUringConnectionReceiver final: public ConnectionReceiver, public OwnedFileDescriptor {
+public:
+  IoUringConnectionReceiver(IoUring& ring, int fd, uint flags)
+      : OwnedFileDescriptor(fd, flags, true), ring(ring) {}
+
+  Promise<Own<AsyncIoStream>> accept() override {
+    auto sqe = makeSqe(IORING_OP_ACCEPT, fd);
+    sqe.accept_flags = SOCK_CLOEXEC;
+
+    return ring.run(sqe).then([this](int result) -> Promise<Own<AsyncIoStream>> {
+      if (result >= 0) {
+        return Own<AsyncIoStream>(heap<IoUringStream>(ring, result,
+            LowLevelAsyncIoProvider::TAKE_OWNERSHIP | LowLevelAsyncIoProvider::ALREADY_CLOEXEC));
+      }
+
+      int error = -result;
+      switch (error) {
+        case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+        case EWOULDBLOCK:
+#endif
+          return pollFd(ring, fd, POLLIN).then([this]() {
+            return accept();
+          });
+
+        case EINTR:
+        case ENETDOWN:
+        case EPROTO:
+        case EHOSTDOWN:
+        case EHOSTUNREACH:
+        case ENETUNREACH:
+        case ECONNABORTED:
+        case ETIMEDOUT:
+          // See FdConnectionReceiver::accept().
+          return accept();
+
+        default:
+          KJ_FAIL_SYSCALL("accept", error);
+      }
+    });
+  }
+
+  uint getPort() override {
+    return SocketAddress::getLocalAddress(fd).getPort();
+  }
+
+private:
+  IoUring& ring;
+};
+
+class IoUringAsyncIoProvider final: public LowLevelAsyncIoProvider {
+public:
+  IoUringAsyncIoProvider(const IoUringOptions& options)
+      : eventLoop(eventPort), timer(eventPort), waitScope(eventLoop), ring(eventPort, options) {}
+
+  inline WaitScope& getWaitScope() { return waitScope; }
+  inline UnixEventPort& getEventPort() { return eventPort; }
+
+  Own<AsyncInputStream> wrapInputFd(int fd, uint flags = 0) override {
+    return heap<IoUringStream>(ring, fd, flags);
+  }
+  Own<AsyncOutputStream> wrapOutputFd(int fd, uint flags = 0) override {
+    return heap<IoUringStream>(ring, fd, flags);
+  }
+  Own<AsyncIoStream> wrapSocketFd(int fd, uint flags = 0) override {
+    return heap<IoUringStream>(ring, fd, flags);
+  }
+  Promise<Own<AsyncIoStream>> wrapConnectingSocketFd(int fd, uint flags = 0) override {
+    auto result = heap<IoUringStream>(ring, fd, flags);
+    auto connected = result->waitConnected();
+    return connected.then(kj::mvCapture(result,
+        [fd](Own<IoUringStream>&& stream) {
+          int err;
+          socklen_t errlen = sizeof(err);
+          KJ_SYSCALL(getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen));
+          if (err != 0) {
+            KJ_FAIL_SYSCALL("connect()", err) { break; }
+          }
+          return Own<AsyncIoStream>(kj::mv(stream));
+        }));
+  }
+  Own<ConnectionReceiver> wrapListenSocketFd(int fd, uint flags = 0) override {
+    return heap<IoUringConnectionReceiver>(ring, fd, flags);
+  }
+
+  Timer& getTimer() override { return timer; }
+
 private:
   UnixEventPort eventPort;
   EventLoop eventLoop;
+  TimerImpl timer;
   WaitScope waitScope;
+  IoUring ring;
 };
 
+#endif  // KJ_USE_IO_URING
+
 // =======================================================================================
 
 class NetworkAddressImpl final: public NetworkAddress {
@@ -860,13 +1702,15 @@ private:
 
 class SocketNetwork final: public Network {
 public:
-  explicit SocketNetwork(LowLevelAsyncIoProvider& lowLevel): lowLevel(lowLevel) {}
+  SocketNetwork(LowLevelAsyncIoProvider& lowLevel, const NetworkOptions& options)
+      : lowLevel(lowLevel), resolver(lowLevel.getTimer(), options) {}
 
   Promise<Own<NetworkAddress>> parseAddress(StringPtr addr, uint portHint = 0) override {
     auto& lowLevelCopy = lowLevel;
+    auto& resolverCopy = resolver;
     return evalLater(mvCapture(heapString(addr),
-        [&lowLevelCopy,portHint](String&& addr) {
-      return SocketAddress::parse(lowLevelCopy, addr, portHint);
+        [&resolverCopy,portHint](String&& addr) {
+      return SocketAddress::parse(resolverCopy, addr, portHint);
     })).then([&lowLevelCopy](Array<SocketAddress> addresses) -> Own<NetworkAddress> {
       return heap<NetworkAddressImpl>(lowLevelCopy, kj::mv(addresses));
     });
@@ -880,14 +1724,16 @@ public:
 
 private:
   LowLevelAsyncIoProvider& lowLevel;
+  HostResolver resolver;
 };
 
 // =======================================================================================
 
 class AsyncIoProviderImpl final: public AsyncIoProvider {
 public:
-  AsyncIoProviderImpl(LowLevelAsyncIoProvider& lowLevel)
-      : lowLevel(lowLevel), network(lowLevel) {}
+  AsyncIoProviderImpl(LowLevelAsyncIoProvider& lowLevel,
+                      const NetworkOptions& options = NetworkOptions())
+      : lowLevel(lowLevel), network(lowLevel, options) {}
 
   OneWayPipe newOneWayPipe() override {
     int fds[2];
@@ -920,6 +1766,7 @@ public:
   }
 
   PipeThread newPipeThread(
+      const ThreadOptions& options,
       Function<void(AsyncIoProvider&, AsyncIoStream&, WaitScope&)> startFunc) override {
     int fds[2];
     int type = SOCK_STREAM;
@@ -933,7 +1780,7 @@ public:
 
     auto pipe = lowLevel.wrapSocketFd(fds[0], NEW_FD_FLAGS);
 
-    auto thread = heap<Thread>(kj::mvCapture(startFunc,
+    auto thread = heap<Thread>(options, kj::mvCapture(startFunc,
         [threadFd](Function<void(AsyncIoProvider&, AsyncIoStream&, WaitScope&)>&& startFunc) {
       LowLevelAsyncIoProviderImpl lowLevel;
       auto stream = lowLevel.wrapSocketFd(threadFd, NEW_FD_FLAGS);
@@ -944,6 +1791,8 @@ public:
     return { kj::mv(thread), kj::mv(pipe) };
   }
 
+  Timer& getTimer() override { return lowLevel.getTimer(); }
+
 private:
   LowLevelAsyncIoProvider& lowLevel;
   SocketNetwork network;
@@ -955,15 +1804,70 @@ Promise<void> AsyncInputStream::read(void* buffer, size_t bytes) {
   return read(buffer, bytes, bytes).then([](size_t) {});
 }
 
-Own<AsyncIoProvider> newAsyncIoProvider(LowLevelAsyncIoProvider& lowLevel) {
-  return kj::heap<AsyncIoProviderImpl>(lowLevel);
+Promise<uint64_t> AsyncInputStream::pumpTo(AsyncOutputStream& output, uint64_t amount) {
+  auto pump = heap<BufferedPump>(*this, output, amount);
+  auto promise = pump->pump();
+  return promise.attach(kj::mv(pump));
+}
+
+namespace {
+
+Promise<void> writeBatches(AsyncOutputStream& output, ArrayPtr<const ArrayPtr<const byte>> pieces) {
+  if (pieces.size() == 0) return READY_NOW;
+
+  size_t n = kj::min(pieces.size(), StringTree::WRITE_BATCH_SIZE);
+  return output.write(pieces.slice(0, n)).then([&output, pieces, n]() {
+    return writeBatches(output, pieces.slice(n, pieces.size()));
+  });
+}
+
+}  // namespace
+
+Promise<void> AsyncOutputStream::write(StringTree&& text) {
+  auto tree = heap<StringTree>(kj::mv(text));
+
+  Vector<ArrayPtr<const byte>> pieces;
+  tree->visit([&](ArrayPtr<const char> piece) {
+    pieces.add(arrayPtr(reinterpret_cast<const byte*>(piece.begin()), piece.size()));
+  });
+  auto piecesArray = pieces.releaseAsArray();
+
+  auto promise = writeBatches(*this, piecesArray);
+  return promise.attach(kj::mv(tree), kj::mv(piecesArray));
+}
+
+Own<AsyncIoProvider> newAsyncIoProvider(LowLevelAsyncIoProvider& lowLevel,
+                                       NetworkOptions networkOptions) {
+  return kj::heap<AsyncIoProviderImpl>(lowLevel, networkOptions);
 }
 
-AsyncIoContext setupAsyncIo() {
+AsyncIoContext setupAsyncIo(NetworkOptions networkOptions) {
   auto lowLevel = heap<LowLevelAsyncIoProviderImpl>();
-  auto ioProvider = kj::heap<AsyncIoProviderImpl>(*lowLevel);
+  auto ioProvider = kj::heap<AsyncIoProviderImpl>(*lowLevel, networkOptions);
   auto& waitScope = lowLevel->getWaitScope();
-  return { kj::mv(lowLevel), kj::mv(ioProvider), waitScope };
+  auto& eventPort = lowLevel->getEventPort();
+  return { kj::mv(lowLevel), kj::mv(ioProvider), waitScope, eventPort };
+}
+
+bool isIoUringSupported() {
+#if KJ_USE_IO_URING
+  return IoUring::isSupported();
+#else
+  return false;
+#endif
+}
+
+AsyncIoContext setupIoUringAsyncIo(IoUringOptions options) {
+#if KJ_USE_IO_URING
+  if (IoUring::isSupported()) {
+    auto lowLevel = heap<IoUringAsyncIoProvider>(options);
+    auto ioProvider = kj::heap<AsyncIoProviderImpl>(*lowLevel);
+    auto& waitScope = lowLevel->getWaitScope();
+    auto& eventPort = lowLevel->getEventPort();
+    return { kj::mv(lowLevel), kj::mv(ioProvider), waitScope, eventPort };
+  }
+#endif
+  return setupAsyncIo();
 }
 
 }  // namespace kj
@@ -27,9 +27,15 @@
 #include "async.h"
 #include "function.h"
 #include "thread.h"
+#include "time.h"
 
 namespace kj {
 
+class UnixEventPort;
+class ThreadPool;
+class AsyncOutputStream;
+class StringTree;
+
 class AsyncInputStream {
   // Asynchronous equivalent of InputStream (from io.h).
 
@@ -38,6 +44,16 @@ public:
   virtual Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) = 0;
 
   Promise<void> read(void* buffer, size_t bytes);
+
+  virtual Promise<uint64_t> pumpTo(AsyncOutputStream& output, uint64_t amount = kj::maxValue);
+  // Reads from this stream and writes everything to `output` until `amount` bytes have been copied
+  // or EOF is reached, whichever comes first, and returns the number of bytes copied.  Nothing is
+  // read past `amount`.  Neither stream may be used for anything else until the promise resolves.
+  //
+  // The default implementation copies through a pair of buffers, so that reading the next chunk
+  // overlaps with writing the previous one.  Streams created by `LowLevelAsyncIoProvider` (when
+  // `output` is one too) instead use `splice()` on Linux, so the data never passes through user
+  // space.
 };
 
 class AsyncOutputStream {
@@ -46,6 +62,10 @@ class AsyncOutputStream {
 public:
   virtual Promise<void> write(const void* buffer, size_t size) = 0;
   virtual Promise<void> write(ArrayPtr<const ArrayPtr<const byte>> pieces) = 0;
+
+  Promise<void> write(StringTree&& text);
+  // Writes `text` without flattening it, passing its pieces to the gathering `write()` above in
+  // batches of up to `StringTree::WRITE_BATCH_SIZE`.  The tree is kept until the write completes.
 };
 
 class AsyncIoStream: public AsyncInputStream, public AsyncOutputStream {
@@ -187,15 +207,31 @@ public:
     Own<AsyncIoStream> pipe;
   };
 
+  inline PipeThread newPipeThread(
+      Function<void(AsyncIoProvider&, AsyncIoStream&, WaitScope&)> startFunc) {
+    return newPipeThread(ThreadOptions(), kj::mv(startFunc));
+  }
   virtual PipeThread newPipeThread(
+      const ThreadOptions& options,
       Function<void(AsyncIoProvider&, AsyncIoStream&, WaitScope&)> startFunc) = 0;
   // Create a new thread and set up a two-way pipe (socketpair) which can be used to communicate
   // with it.  One end of the pipe is passed to the thread's start function and the other end of
   // the pipe is returned.  The new thread also gets its own `AsyncIoProvider` instance and will
   // already have an active `EventLoop` when `startFunc` is called.
   //
+  // `options` are passed to the `Thread`; e.g. pin the thread to a core to give that core its own
+  // event loop.
+  //
   // TODO(someday):  I'm not entirely comfortable with this interface.  It seems to be doing too
   //   much at once but I'm not sure how to cleanly break it down.
+
+  virtual Timer& getTimer() = 0;
+  // Returns a `Timer` based on real time.  Time does not pass while event handlers are running --
+  // it only updates when the event loop polls for system events.  This means that calling `now()`
+  // on this timer does not require a system call.
+  //
+  // This timer is not affected by changes to the system date.  It is unspecified whether the timer
+  // continues to count while the system is suspended.
 };
 
 class LowLevelAsyncIoProvider {
@@ -270,18 +306,42 @@ public:
   // have had `bind()` and `listen()` called on it, so it's ready for `accept()`.
   //
   // `flags` is a bitwise-OR of the values of the `Flags` enum.
+
+  virtual Timer& getTimer() = 0;
+  // Returns a `Timer` based on real time.  See `AsyncIoProvider::getTimer()`.
+};
+
+struct NetworkOptions {
+  // Options for the `Network` returned by `AsyncIoProvider::getNetwork()`.
+
+  uint lookupThreads = 4;
+  // Host names are resolved with getaddrinfo(), which blocks, so lookups run on a `ThreadPool`
+  // (see `kj/thread-pool.h`) of at most this many threads.  Threads are only started when needed.
+
+  Maybe<const ThreadPool&> lookupThreadPool = nullptr;
+  // Use this pool for lookups instead, e.g. to share one pool between several threads' event
+  // loops.  It must outlive the `Network`.  Overrides `lookupThreads`.
+
+  Duration lookupCacheTtl = 0 * SECONDS;
+  // If non-zero, the results of host name lookups are remembered for this long (measured by the
+  // provider's `Timer`), so that reconnecting to the same hosts does not repeat the lookups.  The
+  // TTLs in the DNS records themselves are not available through getaddrinfo(), so keep this
+  // short.
 };
 
-Own<AsyncIoProvider> newAsyncIoProvider(LowLevelAsyncIoProvider& lowLevel);
+Own<AsyncIoProvider> newAsyncIoProvider(LowLevelAsyncIoProvider& lowLevel,
+                                       NetworkOptions networkOptions = NetworkOptions());
 // Make a new AsyncIoProvider wrapping a `LowLevelAsyncIoProvider`.
 
 struct AsyncIoContext {
   Own<LowLevelAsyncIoProvider> lowLevelProvider;
   Own<AsyncIoProvider> provider;
   WaitScope& waitScope;
+  UnixEventPort& unixEventPort;
+  // The underlying port, e.g. for `UnixEventPort::setBusyPoll()`.
 };
 
-AsyncIoContext setupAsyncIo();
+AsyncIoContext setupAsyncIo(NetworkOptions networkOptions = NetworkOptions());
 // Convenience method which sets up the current thread with everything it needs to do async I/O.
 // The returned objects contain an `EventLoop` which is wrapping an appropriate `EventPort` for
 // doing I/O on the host system, so everything is ready for the thread to start making async calls
@@ -303,6 +363,35 @@ AsyncIoContext setupAsyncIo();
 //       return 0;
 //     }
 
+struct IoUringOptions {
+  uint queueDepth = 256;
+  // Size of the submission queue.  If more operations than this start in one turn of the event
+  // loop, the excess is submitted early rather than at the end of the turn.
+
+  ArrayPtr<const ArrayPtr<byte>> registeredBuffers = nullptr;
+  // Memory to register with the kernel up front.  Reads whose destination lies entirely within one
+  // of these buffers use IORING_OP_READ_FIXED, which saves the kernel from pinning the pages on
+  // every call.  The memory must outlive the returned context, and counts against
+  // RLIMIT_MEMLOCK.
+};
+
+bool isIoUringSupported();
+// Returns true if the running kernel supports everything `setupIoUringAsyncIo()` needs (Linux 5.7
+// or later, with io_uring not disabled).
+
+AsyncIoContext setupIoUringAsyncIo(IoUringOptions options = IoUringOptions());
+// Like `setupAsyncIo()`, but streams and listeners do their I/O by submitting operations to an
+// io_uring instead of waiting for readiness and then calling read() / writev() / accept(), which
+// saves the system calls that fail with EAGAIN.  All operations started during one turn of the
+// event loop are submitted to the kernel together.  The streams are ordinary `AsyncIoStream`s,
+// so everything built on top (e.g. `TwoPartyVatNetwork`) works unchanged.
+//
+// Descriptors wrapped by the returned provider are switched to blocking mode; io_uring needs that
+// to wait for readiness internally, and nothing ever blocks on them.  Timers and the rest of the
+// `UnixEventPort` work as usual.
+//
+// Falls back to `setupAsyncIo()` if `isIoUringSupported()` is false.
+
 }  // namespace kj
 
 #endif  // KJ_ASYNC_IO_H_
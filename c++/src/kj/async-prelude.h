@@ -181,10 +181,18 @@ private:
   friend Promise<Array<U>> kj::joinPromises(Array<Promise<U>>&& promises);
 };
 
+class XThreadEvent;
+class XThreadPafBase;
+template <typename T>
+class XThreadPaf;
+
+void* allocPromiseNode(size_t size);
+void freePromiseNode(void* ptr, size_t size);
 void detach(kj::Promise<void>&& promise);
 void waitImpl(Own<_::PromiseNode>&& node, _::ExceptionOrValue& result, WaitScope& waitScope);
 Promise<void> yield();
 Own<PromiseNode> neverDone();
+kj::String demangleTypeName(const char* name);
 
 class NeverDone {
 public:
@@ -0,0 +1,156 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "async-stats.h"
+#include "debug.h"
+#include <gtest/gtest.h>
+#include <string.h>
+
+namespace kj {
+namespace {
+
+TEST(Log2Histogram, Buckets) {
+  Log2Histogram histogram;
+  histogram.record(0);
+  histogram.record(1);
+  histogram.record(5);
+  histogram.record(7);
+  histogram.record(1000);
+
+  EXPECT_EQ(5u, histogram.getCount());
+  EXPECT_EQ(1013u, histogram.getSum());
+  EXPECT_EQ(1000u, histogram.getMax());
+
+  EXPECT_EQ(1u, histogram.getBucket(0));
+  EXPECT_EQ(1u, histogram.getBucket(1));
+  EXPECT_EQ(2u, histogram.getBucket(3));
+  EXPECT_EQ(1u, histogram.getBucket(10));
+  EXPECT_EQ(7u, Log2Histogram::getBucketLimit(3));
+  EXPECT_EQ(~uint64_t(0), Log2Histogram::getBucketLimit(64));
+
+  EXPECT_EQ(0u, histogram.getPercentile(0));
+  EXPECT_EQ(7u, histogram.getPercentile(0.5));
+  EXPECT_EQ(1000u, histogram.getPercentile(1));
+
+  histogram.reset();
+  EXPECT_EQ(0u, histogram.getCount());
+  EXPECT_EQ(0u, histogram.getPercentile(0.5));
+}
+
+class CountingPort: public EventPort {
+public:
+  Maybe<Own<PromiseFulfiller<void>>> fulfiller;
+  uint waitCount = 0;
+
+  void wait() override {
+    ++waitCount;
+    KJ_IF_MAYBE(f, fulfiller) {
+      f->get()->fulfill();
+      fulfiller = nullptr;
+    }
+  }
+  void poll() override {}
+};
+
+TEST(EventLoopStats, Basic) {
+  CountingPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  EventLoopStats stats;
+  loop.setProfiler(stats);
+
+  auto paf = newPromiseAndFulfiller<void>();
+  port.fulfiller = kj::mv(paf.fulfiller);
+
+  int result = evalLater([]() { return 1; })
+      .then([](int i) { return i + 1; })
+      .then([&](int i) { return paf.promise.then([i]() { return i * 10; }); })
+      .wait(waitScope);
+  EXPECT_EQ(20, result);
+
+  EXPECT_EQ(1u, port.waitCount);
+  EXPECT_EQ(1u, stats.getWaitNanos().getCount());
+  EXPECT_GT(stats.getEventNanos().getCount(), 0u);
+  EXPECT_EQ(stats.getEventNanos().getCount(), stats.getQueueDepths().getCount());
+
+  // One turn before the port wait and one after.
+  EXPECT_EQ(2u, stats.getTurnNanos().getCount());
+  EXPECT_EQ(stats.getEventNanos().getCount(), stats.getTurnEventCounts().getSum());
+
+  uint64_t sourceEvents = 0;
+  bool sawLambda = false;
+  stats.forEachSource([&](const char* source, const EventLoopStats::SourceStats& sourceStats) {
+    sourceEvents += sourceStats.count;
+    if (source != nullptr && _::demangleTypeName(source).findFirst('{') != nullptr) {
+      // Demangled lambda types look like `{lambda(int)#1}`.
+      sawLambda = true;
+    }
+  });
+  EXPECT_EQ(stats.getEventNanos().getCount(), sourceEvents);
+  EXPECT_TRUE(sawLambda);
+
+  String text = stats.exportText();
+  EXPECT_TRUE(strstr(text.cStr(), "# TYPE kj_event_loop_event_nanoseconds histogram") != nullptr);
+  EXPECT_TRUE(strstr(text.cStr(), "kj_event_loop_wait_nanoseconds_count 1\n") != nullptr);
+  EXPECT_TRUE(strstr(text.cStr(), "kj_event_loop_source_events{source=\"") != nullptr);
+
+  // Removing the profiler stops collection.
+  uint64_t before = stats.getEventNanos().getCount();
+  loop.setProfiler(nullptr);
+  evalLater([]() {}).wait(waitScope);
+  EXPECT_EQ(before, stats.getEventNanos().getCount());
+
+  stats.reset();
+  EXPECT_EQ(0u, stats.getEventNanos().getCount());
+  stats.forEachSource([&](const char*, const EventLoopStats::SourceStats&) {
+    ADD_FAILURE() << "sources not reset";
+  });
+}
+
+TEST(EventLoopStats, QueueDepth) {
+  EventLoop loop;
+  WaitScope waitScope(loop);
+
+  EXPECT_EQ(0u, loop.getQueueDepth());
+
+  auto a = evalLater([]() {}).eagerlyEvaluate(nullptr);
+  auto b = evalLater([]() {}).eagerlyEvaluate(nullptr);
+  auto c = evalLater([]() {}).eagerlyEvaluate(nullptr);
+  EXPECT_EQ(3u, loop.getQueueDepth());
+
+  // Canceling a queued event takes it off the queue.
+  { auto drop = kj::mv(b); }
+  EXPECT_EQ(2u, loop.getQueueDepth());
+
+  EventLoopStats stats;
+  loop.setProfiler(stats);
+  a.wait(waitScope);
+  c.wait(waitScope);
+  EXPECT_EQ(0u, loop.getQueueDepth());
+  EXPECT_GE(stats.getQueueDepths().getMax(), 1u);
+}
+
+}  // namespace
+}  // namespace kj
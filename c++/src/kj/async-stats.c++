@@ -0,0 +1,164 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "async-stats.h"
+#include "vector.h"
+#include <algorithm>
+
+namespace kj {
+
+uint64_t Log2Histogram::getBucketLimit(uint i) {
+  return i == 0 ? 0 : i >= 64 ? ~uint64_t(0) : (uint64_t(1) << i) - 1;
+}
+
+uint64_t Log2Histogram::getPercentile(double fraction) const {
+  if (count == 0) return 0;
+
+  uint64_t target = static_cast<uint64_t>(fraction * count);
+  if (target >= count) target = count - 1;
+
+  uint64_t seen = 0;
+  for (uint i = 0; i < BUCKET_COUNT; i++) {
+    seen += buckets[i];
+    if (seen > target) {
+      return kj::min(getBucketLimit(i), max);
+    }
+  }
+  return max;
+}
+
+void Log2Histogram::reset() {
+  for (auto& bucket: buckets) bucket = 0;
+  count = 0;
+  sum = 0;
+  max = 0;
+}
+
+// =======================================================================================
+
+void EventLoopStats::eventFired(const char* source, uint64_t nanoseconds, uint queueDepth) {
+  eventNanos.record(nanoseconds);
+  queueDepths.record(queueDepth);
+
+  SourceStats& stats = sources[source];
+  ++stats.count;
+  stats.totalNanos += nanoseconds;
+  if (nanoseconds > stats.maxNanos) stats.maxNanos = nanoseconds;
+}
+
+void EventLoopStats::turnFinished(uint64_t nanoseconds, uint eventCount) {
+  turnNanos.record(nanoseconds);
+  turnEventCounts.record(eventCount);
+}
+
+void EventLoopStats::portWaited(uint64_t nanoseconds) {
+  waitNanos.record(nanoseconds);
+}
+
+void EventLoopStats::reset() {
+  eventNanos.reset();
+  turnNanos.reset();
+  turnEventCounts.reset();
+  queueDepths.reset();
+  waitNanos.reset();
+  sources.clear();
+}
+
+namespace {
+
+void exportHistogram(Vector<String>& lines, StringPtr name, const Log2Histogram& histogram) {
+  lines.add(kj::str("# TYPE kj_event_loop_", name, " histogram"));
+
+  // Cumulative buckets, skipping the long run of empty ones past the maximum.
+  uint64_t cumulative = 0;
+  for (uint i = 0; i < Log2Histogram::BUCKET_COUNT && cumulative < histogram.getCount(); i++) {
+    cumulative += histogram.getBucket(i);
+    lines.add(kj::str("kj_event_loop_", name, "_bucket{le=\"", Log2Histogram::getBucketLimit(i),
+                      "\"} ", cumulative));
+  }
+  lines.add(kj::str("kj_event_loop_", name, "_bucket{le=\"+Inf\"} ", histogram.getCount()));
+  lines.add(kj::str("kj_event_loop_", name, "_sum ", histogram.getSum()));
+  lines.add(kj::str("kj_event_loop_", name, "_count ", histogram.getCount()));
+}
+
+String escapeLabel(const char* source) {
+  if (source == nullptr) return heapString("unknown");
+
+  String name = _::demangleTypeName(source);
+  Vector<char> result(name.size() + 1);
+  for (char c: name) {
+    if (c == '\\' || c == '"') result.add('\\');
+    if (c == '\n') {
+      result.addAll(StringPtr("\\n"));
+    } else {
+      result.add(c);
+    }
+  }
+  result.add('\0');
+  return String(result.releaseAsArray());
+}
+
+}  // namespace
+
+String EventLoopStats::exportText(uint maxSources) const {
+  Vector<String> lines;
+
+  exportHistogram(lines, "event_nanoseconds", eventNanos);
+  exportHistogram(lines, "turn_nanoseconds", turnNanos);
+  exportHistogram(lines, "turn_events", turnEventCounts);
+  exportHistogram(lines, "queue_depth", queueDepths);
+  exportHistogram(lines, "wait_nanoseconds", waitNanos);
+
+  struct Entry {
+    const char* source;
+    const SourceStats* stats;
+  };
+  Vector<Entry> top(sources.size());
+  sources.forEach([&](const char* source, const SourceStats& stats) {
+    top.add(Entry { source, &stats });
+  });
+  std::sort(top.begin(), top.end(), [](const Entry& a, const Entry& b) {
+    return a.stats->totalNanos > b.stats->totalNanos;
+  });
+  if (top.size() > maxSources) top.resize(maxSources);
+
+  auto labels = KJ_MAP(entry, top) { return escapeLabel(entry.source); };
+
+  // Prometheus wants each metric's samples grouped together.
+  auto exportSources = [&](StringPtr name, StringPtr type, uint64_t SourceStats::*field) {
+    lines.add(kj::str("# TYPE kj_event_loop_", name, " ", type));
+    for (uint i = 0; i < top.size(); i++) {
+      lines.add(kj::str("kj_event_loop_", name, "{source=\"", labels[i], "\"} ",
+                        top[i].stats->*field));
+    }
+  };
+  exportSources("source_events", "counter", &SourceStats::count);
+  exportSources("source_nanoseconds", "counter", &SourceStats::totalNanos);
+  exportSources("source_max_nanoseconds", "gauge", &SourceStats::maxNanos);
+
+  lines.add(String());
+  return kj::strArray(lines, "\n");
+}
+
+}  // namespace kj
@@ -0,0 +1,129 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef KJ_ASYNC_STATS_H_
+#define KJ_ASYNC_STATS_H_
+
+#include "async.h"
+#include "hash.h"
+#include "string.h"
+
+namespace kj {
+
+class Log2Histogram {
+  // Counts values into power-of-two buckets: bucket 0 holds zero and bucket `i` holds values in
+  // [2^(i-1), 2^i).  Cheap enough to update on every event, and precise enough to tell a 10us
+  // callback from a 10ms one.
+
+public:
+  static constexpr uint BUCKET_COUNT = 65;
+
+  inline void record(uint64_t value) {
+    ++buckets[value == 0 ? 0 : 64 - __builtin_clzll(value)];
+    ++count;
+    sum += value;
+    if (value > max) max = value;
+  }
+
+  inline uint64_t getCount() const { return count; }
+  inline uint64_t getSum() const { return sum; }
+  inline uint64_t getMax() const { return max; }
+  inline uint64_t getBucket(uint i) const { return buckets[i]; }
+
+  static uint64_t getBucketLimit(uint i);
+  // The largest value that falls into bucket `i`.
+
+  uint64_t getPercentile(double fraction) const;
+  // Returns the limit of the bucket containing the given fraction (0 to 1) of recorded values, so
+  // the true percentile is at most this and at least half of it.  Returns zero if empty.
+
+  void reset();
+
+private:
+  uint64_t buckets[BUCKET_COUNT] = {};
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t max = 0;
+};
+
+class EventLoopStats final: public EventLoopProfiler {
+  // An EventLoopProfiler which keeps histograms of event run times, turn lengths, queue depths
+  // and port wait times, plus totals for each event source.  Install it with
+  // `EventLoop::setProfiler()`.
+  //
+  // Like the loop itself, this is not thread-safe.  To scrape it from another thread, send the
+  // work to the loop with its `Executor`.
+
+public:
+  struct SourceStats {
+    uint64_t count = 0;
+    uint64_t totalNanos = 0;
+    uint64_t maxNanos = 0;
+  };
+
+  inline const Log2Histogram& getEventNanos() const { return eventNanos; }
+  inline const Log2Histogram& getTurnNanos() const { return turnNanos; }
+  inline const Log2Histogram& getTurnEventCounts() const { return turnEventCounts; }
+  inline const Log2Histogram& getQueueDepths() const { return queueDepths; }
+  inline const Log2Histogram& getWaitNanos() const { return waitNanos; }
+
+  template <typename Func>
+  void forEachSource(Func&& func) const;
+  // Calls func(const char* source, const SourceStats&) for each distinct event source seen.
+  // `source` is a mangled type name; see `EventLoopProfiler::eventFired()`.
+
+  kj::String exportText(uint maxSources = 20) const;
+  // Renders everything in the Prometheus text exposition format, with metric names prefixed by
+  // `kj_event_loop_`.  Only the `maxSources` sources with the most total run time are included,
+  // with their type names demangled.
+
+  void reset();
+
+  void eventFired(const char* source, uint64_t nanoseconds, uint queueDepth) override;
+  void turnFinished(uint64_t nanoseconds, uint eventCount) override;
+  void portWaited(uint64_t nanoseconds) override;
+
+private:
+  Log2Histogram eventNanos;
+  Log2Histogram turnNanos;
+  Log2Histogram turnEventCounts;
+  Log2Histogram queueDepths;
+  Log2Histogram waitNanos;
+
+  HashMap<const char*, SourceStats> sources;
+};
+
+// =======================================================================================
+// inline implementation details
+
+template <typename Func>
+void EventLoopStats::forEachSource(Func&& func) const {
+  sources.forEach([&](const char* source, const SourceStats& stats) {
+    func(source, stats);
+  });
+}
+
+}  // namespace kj
+
+#endif  // KJ_ASYNC_STATS_H_
@@ -24,12 +24,16 @@
 #include "async-unix.h"
 #include "thread.h"
 #include "debug.h"
+#include "mutex.h"
+#include "vector.h"
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <gtest/gtest.h>
 #include <pthread.h>
+#include <algorithm>
 
 namespace kj {
 
@@ -196,8 +200,59 @@ TEST_F(AsyncUnixTest, SignalsNoWait) {
   EXPECT_TRUE(receivedSigio);
 }
 
+TEST_F(AsyncUnixTest, SignalsStayPendingWithoutWaiter) {
+  // A signal that arrives after its only waiter was canceled is not consumed, and is delivered to
+  // the next onSignal().
+
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  {
+    auto canceled = port.onSignal(SIGURG);
+  }
+
+  kill(getpid(), SIGURG);
+  kill(getpid(), SIGIO);
+
+  EXPECT_EQ(SIGIO, port.onSignal(SIGIO).wait(waitScope).si_signo);
+
+  sigset_t pending;
+  sigemptyset(&pending);
+  KJ_SYSCALL(sigpending(&pending));
+  EXPECT_TRUE(sigismember(&pending, SIGURG));
+
+  EXPECT_EQ(SIGURG, port.onSignal(SIGURG).wait(waitScope).si_signo);
+}
+
 #endif  // !__CYGWIN32__
 
+#if KJ_USE_EPOLL
+TEST_F(AsyncUnixTest, SignalFdFailure) {
+  // If the signalfd can't be created, onSignal() throws.  The failed waiter must not be left in
+  // the port's list.
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  // Allow no new file descriptors:  every one below the lowest free one is in use.
+  struct rlimit oldLimit;
+  KJ_SYSCALL(getrlimit(RLIMIT_NOFILE, &oldLimit));
+  int lowestFree;
+  KJ_SYSCALL(lowestFree = dup(STDIN_FILENO));
+  close(lowestFree);
+  struct rlimit limit = oldLimit;
+  limit.rlim_cur = lowestFree;
+  KJ_SYSCALL(setrlimit(RLIMIT_NOFILE, &limit));
+  EXPECT_ANY_THROW(port.onSignal(SIGURG));
+  KJ_SYSCALL(setrlimit(RLIMIT_NOFILE, &oldLimit));
+
+  kill(getpid(), SIGURG);
+  siginfo_t info = port.onSignal(SIGURG).wait(waitScope);
+  EXPECT_EQ(SIGURG, info.si_signo);
+}
+#endif
+
 TEST_F(AsyncUnixTest, Poll) {
   UnixEventPort port;
   EventLoop loop(port);
@@ -314,4 +369,269 @@ TEST_F(AsyncUnixTest, PollNoWait) {
   EXPECT_EQ(2, receivedCount);
 }
 
+TEST_F(AsyncUnixTest, PollSameFdTwice) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  int pipefds[2];
+  KJ_SYSCALL(pipe(pipefds));
+  KJ_DEFER({ close(pipefds[1]); close(pipefds[0]); });
+
+  // Two waiters on the same FD with different masks are tracked independently.
+  bool gotPri = false;
+  auto priPromise = port.onFdEvent(pipefds[0], POLLPRI).then([&](short) { gotPri = true; });
+  KJ_SYSCALL(write(pipefds[1], "foo", 3));
+
+  EXPECT_EQ(POLLIN, port.onFdEvent(pipefds[0], POLLIN).wait(waitScope));
+  EXPECT_FALSE(gotPri);
+}
+
+TEST_F(AsyncUnixTest, FdObserver) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  int pipefds[2];
+  KJ_SYSCALL(pipe(pipefds));
+  KJ_DEFER({ close(pipefds[1]); close(pipefds[0]); });
+
+  {
+    UnixEventPort::FdObserver observer(port, pipefds[0],
+        UnixEventPort::FdObserver::OBSERVE_READ);
+
+    bool readable = false;
+    auto promise = observer.whenBecomesReadable().then([&]() { readable = true; });
+
+    loop.run();
+    port.poll();
+    loop.run();
+    EXPECT_FALSE(readable);
+
+    KJ_SYSCALL(write(pipefds[1], "foo", 3));
+    promise.wait(waitScope);
+    EXPECT_TRUE(readable);
+    EXPECT_FALSE(observer.atEndHint());
+
+    // Writing more data generates a new edge even though we didn't drain the pipe.
+    Thread thread([&]() {
+      delay();
+      KJ_SYSCALL(write(pipefds[1], "bar", 3));
+    });
+    observer.whenBecomesReadable().wait(waitScope);
+  }
+
+  {
+    UnixEventPort::FdObserver observer(port, pipefds[1],
+        UnixEventPort::FdObserver::OBSERVE_WRITE);
+
+    // A fresh pipe is writable right away.
+    observer.whenBecomesWritable().wait(waitScope);
+  }
+}
+
+TEST_F(AsyncUnixTest, FdObserverHangup) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  int pipefds[2];
+  KJ_SYSCALL(pipe(pipefds));
+  KJ_DEFER(close(pipefds[0]));
+
+  UnixEventPort::FdObserver observer(port, pipefds[0], UnixEventPort::FdObserver::OBSERVE_READ);
+  auto promise = observer.whenBecomesReadable();
+
+  close(pipefds[1]);
+  promise.wait(waitScope);
+  EXPECT_TRUE(observer.atEndHint());
+}
+
+TEST_F(AsyncUnixTest, SteadyTimers) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  auto start = port.steadyTime();
+  kj::Vector<TimePoint> expected;
+  kj::Vector<TimePoint> actual;
+
+  auto addTimer = [&](Duration delay) {
+    expected.add(kj::max(start + delay, start));
+    port.atSteadyTime(start + delay).then([&]() {
+      actual.add(port.steadyTime());
+    }).detach([](Exception&& e) { ADD_FAILURE() << str(e).cStr(); });
+  };
+
+  addTimer(30 * MILLISECONDS);
+  addTimer(40 * MILLISECONDS);
+  addTimer(20350 * MICROSECONDS);
+  addTimer(30 * MILLISECONDS);
+  addTimer(-10 * MILLISECONDS);
+
+  std::sort(expected.begin(), expected.end());
+  port.atSteadyTime(expected.back() + MILLISECONDS).wait(waitScope);
+
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_LE(expected[i], actual[i]) << "Actual time for timer " << i << " is "
+        << ((actual[i] - expected[i]) / NANOSECONDS) << " ns too early.";
+  }
+}
+
+TEST_F(AsyncUnixTest, SteadyTimerCancel) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  bool fired = false;
+  {
+    auto promise = port.atSteadyTime(port.steadyTime() + 10 * MILLISECONDS).then([&]() {
+      fired = true;
+    });
+  }
+
+  port.atSteadyTime(port.steadyTime() + 20 * MILLISECONDS).wait(waitScope);
+  EXPECT_FALSE(fired);
+}
+
+TEST_F(AsyncUnixTest, BusyPoll) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  UnixEventPort::BusyPollOptions options;
+  options.spinTime = 100 * MILLISECONDS;
+  port.setBusyPoll(options);
+
+  int pipefds[2];
+  KJ_SYSCALL(pipe(pipefds));
+  KJ_DEFER({ close(pipefds[1]); close(pipefds[0]); });
+
+  // An event arriving mid-spin is picked up without sleeping.
+  {
+    UnixEventPort::FdObserver observer(port, pipefds[0],
+        UnixEventPort::FdObserver::OBSERVE_READ);
+    Thread thread([&]() {
+      delay();
+      KJ_SYSCALL(write(pipefds[1], "foo", 3));
+    });
+    observer.whenBecomesReadable().wait(waitScope);
+  }
+
+  // So is a timer coming due.
+  auto start = port.steadyTime();
+  port.atSteadyTime(start + 5 * MILLISECONDS).wait(waitScope);
+  EXPECT_LE(start + 5 * MILLISECONDS, port.steadyTime());
+
+  // Once the spin runs out, wait() falls back to blocking.
+  options.spinTime = 1 * MILLISECONDS;
+  port.setBusyPoll(options);
+  start = port.steadyTime();
+  port.atSteadyTime(start + 20 * MILLISECONDS).wait(waitScope);
+  EXPECT_LE(start + 20 * MILLISECONDS, port.steadyTime());
+}
+
+TEST_F(AsyncUnixTest, CrossThreadFulfiller) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  auto paf = newPromiseAndCrossThreadFulfiller<int>();
+  EXPECT_TRUE(paf.fulfiller->isWaiting());
+
+  {
+    Thread thread([&]() {
+      // Make sure the main thread is asleep in wait() by the time we fulfill.
+      delay();
+      paf.fulfiller->fulfill(123);
+      paf.fulfiller = nullptr;
+    });
+
+    EXPECT_EQ(123, paf.promise.wait(waitScope));
+  }
+
+  // Dropping an unfulfilled fulfiller in another thread rejects the promise.
+  auto paf2 = newPromiseAndCrossThreadFulfiller<void>();
+  {
+    Thread thread([&]() { paf2.fulfiller = nullptr; });
+  }
+  EXPECT_ANY_THROW(paf2.promise.wait(waitScope));
+
+  // Results for a discarded promise are dropped quietly.
+  auto paf3 = newPromiseAndCrossThreadFulfiller<int>();
+  paf3.promise = nullptr;
+  EXPECT_FALSE(paf3.fulfiller->isWaiting());
+  {
+    Thread thread([&]() { paf3.fulfiller->fulfill(456); });
+  }
+  loop.run();
+}
+
+TEST_F(AsyncUnixTest, ExecutorAsync) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  MutexGuarded<Maybe<Own<const Executor>>> workerExecutor;
+  Own<const Executor> executor;
+
+  {
+    Own<PromiseFulfiller<void>> stopFulfiller;
+
+    Thread thread([&]() {
+      UnixEventPort workerPort;
+      EventLoop workerLoop(workerPort);
+      WaitScope workerScope(workerLoop);
+
+      auto stop = newPromiseAndFulfiller<void>();
+      stopFulfiller = kj::mv(stop.fulfiller);
+      *workerExecutor.lockExclusive() = getCurrentThreadExecutor().addRef();
+      stop.promise.wait(workerScope);
+      stopFulfiller = nullptr;
+    });
+
+    for (;;) {
+      KJ_IF_MAYBE(e, *workerExecutor.lockExclusive()) {
+        executor = kj::mv(*e);
+        break;
+      }
+      delay();
+    }
+
+    EXPECT_TRUE(executor->isLive());
+    EXPECT_NE(&getCurrentThreadExecutor(), executor.get());
+
+    // Plain values, promises, and exceptions all come back.
+    EXPECT_EQ(123, executor->executeAsync([&]() {
+      EXPECT_EQ(executor.get(), &getCurrentThreadExecutor());
+      return 123;
+    }).wait(waitScope));
+
+    EXPECT_EQ(456, executor->executeAsync([]() {
+      return evalLater([]() { return 456; });
+    }).wait(waitScope));
+
+    EXPECT_ANY_THROW(executor->executeAsync([]() -> int {
+      KJ_FAIL_ASSERT("failed in worker");
+    }).wait(waitScope));
+
+    // Many calls at once arrive in order.
+    uint counter = 0;
+    Vector<Promise<uint>> promises;
+    for (uint i = 0; i < 100; i++) {
+      promises.add(executor->executeAsync([&counter]() { return counter++; }));
+    }
+    for (uint i = 0; i < promises.size(); i++) {
+      EXPECT_EQ(i, promises[i].wait(waitScope));
+    }
+
+    executor->executeAsync([&]() { stopFulfiller->fulfill(); }).wait(waitScope);
+  }
+
+  // The worker's loop is gone, but our reference to its executor is still valid.
+  EXPECT_FALSE(executor->isLive());
+  EXPECT_ANY_THROW(executor->executeAsync([]() { return 1; }).wait(waitScope));
+}
+
 }  // namespace kj
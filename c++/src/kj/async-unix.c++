@@ -25,6 +25,21 @@
 #include "debug.h"
 #include <setjmp.h>
 #include <errno.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <set>
+
+#if KJ_USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#endif
+
+#ifndef POLLRDHUP
+// Linux-only optimization.  If not available, define to 0, as this will make it a no-op.
+#define POLLRDHUP 0
+#endif
 
 namespace kj {
 
@@ -79,6 +94,14 @@ pthread_once_t registerReservedSignalOnce = PTHREAD_ONCE_INIT;
 
 // =======================================================================================
 
+struct UnixEventPort::TimerBefore {
+  bool operator()(TimerPromiseAdapter* lhs, TimerPromiseAdapter* rhs) const;
+};
+
+struct UnixEventPort::TimerSet {
+  std::multiset<TimerPromiseAdapter*, TimerBefore> timers;
+};
+
 class UnixEventPort::SignalPromiseAdapter {
 public:
   inline SignalPromiseAdapter(PromiseFulfiller<siginfo_t>& fulfiller,
@@ -87,6 +110,13 @@ public:
     prev = loop.signalTail;
     *loop.signalTail = this;
     loop.signalTail = &next;
+
+#if KJ_USE_EPOLL
+    // updateSignalFd() builds its mask from the list, so we must be linked in first.  If it
+    // throws, our destructor won't run, so unlink here.
+    KJ_ON_SCOPE_FAILURE(removeFromList());
+    loop.updateSignalFd();
+#endif
   }
 
   ~SignalPromiseAdapter() noexcept(false) {
@@ -97,6 +127,10 @@ public:
         next->prev = prev;
       }
       *prev = next;
+
+#if KJ_USE_EPOLL
+      loop.updateSignalFd();
+#endif
     }
   }
 
@@ -120,30 +154,89 @@ public:
   SignalPromiseAdapter** prev = nullptr;
 };
 
+class UnixEventPort::TimerPromiseAdapter {
+public:
+  TimerPromiseAdapter(PromiseFulfiller<void>& fulfiller, UnixEventPort& port, TimePoint time)
+      : time(time), fulfiller(fulfiller), port(port) {
+    pos = port.timers->timers.insert(this);
+  }
+
+  ~TimerPromiseAdapter() {
+    if (pos != port.timers->timers.end()) {
+      port.timers->timers.erase(pos);
+    }
+  }
+
+  void fulfill() {
+    fulfiller.fulfill();
+    port.timers->timers.erase(pos);
+    pos = port.timers->timers.end();
+  }
+
+  const TimePoint time;
+
+private:
+  PromiseFulfiller<void>& fulfiller;
+  UnixEventPort& port;
+  std::multiset<TimerPromiseAdapter*, TimerBefore>::const_iterator pos;
+};
+
+inline bool UnixEventPort::TimerBefore::operator()(
+    TimerPromiseAdapter* lhs, TimerPromiseAdapter* rhs) const {
+  return lhs->time < rhs->time;
+}
+
+#if KJ_USE_EPOLL
+
+class UnixEventPort::FdEntry final: public EpollTarget {
+  // Tracks the `onFdEvent()` promises waiting on one file descriptor.  The descriptor is
+  // registered level-triggered with the union of the waiters' event masks.
+
+public:
+  FdEntry(UnixEventPort& loop, int fd): loop(loop), fd(fd) {}
+
+  void fire(uint32_t events) override;
+
+  UnixEventPort& loop;
+  int fd;
+  uint32_t registeredEvents = 0;
+  PollPromiseAdapter* pollHead = nullptr;
+  PollPromiseAdapter** pollTail = &pollHead;
+};
+
+#endif  // KJ_USE_EPOLL
+
 class UnixEventPort::PollPromiseAdapter {
 public:
   inline PollPromiseAdapter(PromiseFulfiller<short>& fulfiller,
                             UnixEventPort& loop, int fd, short eventMask)
-      : loop(loop), fd(fd), eventMask(eventMask), fulfiller(fulfiller) {
-    prev = loop.pollTail;
-    *loop.pollTail = this;
-    loop.pollTail = &next;
+      : loop(loop), fd(fd), eventMask(eventMask), fulfiller(fulfiller),
+#if KJ_USE_EPOLL
+        entry(loop.getFdEntry(fd)), listTail(entry.pollTail) {
+#else
+        listTail(loop.pollTail) {
+#endif
+    prev = listTail;
+    *listTail = this;
+    listTail = &next;
+
+#if KJ_USE_EPOLL
+    loop.updateFdEntry(entry);
+#endif
   }
 
   ~PollPromiseAdapter() noexcept(false) {
     if (prev != nullptr) {
-      if (next == nullptr) {
-        loop.pollTail = prev;
-      } else {
-        next->prev = prev;
-      }
-      *prev = next;
+      removeFromList();
+#if KJ_USE_EPOLL
+      loop.updateFdEntry(entry);
+#endif
     }
   }
 
   void removeFromList() {
     if (next == nullptr) {
-      loop.pollTail = prev;
+      listTail = prev;
     } else {
       next->prev = prev;
     }
@@ -156,20 +249,220 @@ public:
   int fd;
   short eventMask;
   PromiseFulfiller<short>& fulfiller;
+#if KJ_USE_EPOLL
+  FdEntry& entry;
+#endif
+  PollPromiseAdapter**& listTail;
   PollPromiseAdapter* next = nullptr;
   PollPromiseAdapter** prev = nullptr;
 };
 
-UnixEventPort::UnixEventPort() {
+#if KJ_USE_EPOLL
+
+void UnixEventPort::FdEntry::fire(uint32_t events) {
+  // On Linux, epoll event bits are numerically identical to the corresponding poll bits.
+  auto ptr = pollHead;
+  while (ptr != nullptr) {
+    auto next = ptr->next;
+    short revents = events & (ptr->eventMask | POLLERR | POLLHUP | POLLNVAL);
+    if (revents != 0) {
+      ptr->fulfiller.fulfill(kj::mv(revents));
+      ptr->removeFromList();
+    }
+    ptr = next;
+  }
+
+  // May destroy `this`.
+  loop.updateFdEntry(*this);
+}
+
+UnixEventPort::FdEntry& UnixEventPort::getFdEntry(int fd) {
+  KJ_REQUIRE(fd >= 0, "invalid file descriptor", fd);
+
+  if (fdEntries.size() <= implicitCast<uint>(fd)) {
+    fdEntries.resize(fd + 1);
+  }
+
+  auto& slot = fdEntries[fd];
+  if (slot.get() == nullptr) {
+    slot = heap<FdEntry>(*this, fd);
+  }
+  return *slot;
+}
+
+void UnixEventPort::updateFdEntry(FdEntry& entry) {
+  uint32_t events = 0;
+  for (auto ptr = entry.pollHead; ptr != nullptr; ptr = ptr->next) {
+    events |= static_cast<uint16_t>(ptr->eventMask);
+  }
+
+  if (events == 0) {
+    if (entry.registeredEvents != 0) {
+      // The FD may already have been closed, in which case the kernel has dropped it from the
+      // epoll set already.
+      if (epoll_ctl(epollFd, EPOLL_CTL_DEL, entry.fd, nullptr) < 0 &&
+          errno != EBADF && errno != ENOENT) {
+        KJ_FAIL_SYSCALL("epoll_ctl(EPOLL_CTL_DEL)", errno, entry.fd) { break; }
+      }
+    }
+    fdEntries[entry.fd] = nullptr;  // destroys `entry`
+  } else if (events != entry.registeredEvents) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = static_cast<EpollTarget*>(&entry);
+    KJ_SYSCALL(epoll_ctl(epollFd, entry.registeredEvents == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                         entry.fd, &event), entry.fd);
+    entry.registeredEvents = events;
+  }
+}
+
+void UnixEventPort::updateSignalFd() {
+  sigset_t mask;
+  sigemptyset(&mask);
+  for (auto ptr = signalHead; ptr != nullptr; ptr = ptr->next) {
+    sigaddset(&mask, ptr->signum);
+  }
+
+  if (signalFd < 0) {
+    if (signalHead == nullptr) return;
+
+    KJ_SYSCALL(signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC));
+
+    // Level-triggered, since readSignalFd() may leave signals in the queue.
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = &signalFd;
+    KJ_SYSCALL(epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event));
+  } else if (memcmp(&mask, &signalFdMask, sizeof(mask)) != 0) {
+    KJ_SYSCALL(signalfd(signalFd, &mask, 0));
+  }
+
+  signalFdMask = mask;
+}
+
+namespace {
+
+siginfo_t toSiginfo(const struct signalfd_siginfo& in) {
+  siginfo_t out;
+  memset(&out, 0, sizeof(out));
+  out.si_signo = in.ssi_signo;
+  out.si_errno = in.ssi_errno;
+  out.si_code = in.ssi_code;
+
+  // Most of siginfo_t is a union, so only fill in what applies to this kind of signal.
+  if (in.ssi_code <= 0) {
+    // Sent by a process, e.g. with kill() or sigqueue().
+    out.si_pid = in.ssi_pid;
+    out.si_uid = in.ssi_uid;
+    out.si_value.sival_ptr = reinterpret_cast<void*>(in.ssi_ptr);
+  } else {
+    switch (in.ssi_signo) {
+      case SIGCHLD:
+        out.si_pid = in.ssi_pid;
+        out.si_uid = in.ssi_uid;
+        out.si_status = in.ssi_status;
+        break;
+      case SIGIO:
+        out.si_band = in.ssi_band;
+        out.si_fd = in.ssi_fd;
+        break;
+      case SIGSEGV:
+      case SIGBUS:
+      case SIGILL:
+      case SIGFPE:
+      case SIGTRAP:
+        out.si_addr = reinterpret_cast<void*>(in.ssi_addr);
+        break;
+      default:
+        out.si_pid = in.ssi_pid;
+        out.si_uid = in.ssi_uid;
+        out.si_value.sival_ptr = reinterpret_cast<void*>(in.ssi_ptr);
+        break;
+    }
+  }
+
+  return out;
+}
+
+}  // namespace
+
+void UnixEventPort::readSignalFd() {
+  // Read one signal at a time: once the last waiter for a signal has been fulfilled, the signalfd
+  // mask no longer includes it, and any further instances must stay pending for a later
+  // onSignal() (or another thread).
+  while (signalHead != nullptr) {
+    struct signalfd_siginfo info;
+    ssize_t n;
+    KJ_NONBLOCKING_SYSCALL(n = read(signalFd, &info, sizeof(info))) {
+      break;
+    }
+    if (n < 0) break;  // EAGAIN
+
+    KJ_ASSERT(n == sizeof(info));
+    gotSignal(toSiginfo(info));
+  }
+}
+
+#endif  // KJ_USE_EPOLL
+
+UnixEventPort::UnixEventPort()
+    : timers(kj::heap<TimerSet>()),
+      frozenSteadyTime(currentSteadyTime()) {
   pthread_once(&registerReservedSignalOnce, &registerReservedSignal);
+
+#if KJ_USE_EPOLL
+  KJ_SYSCALL(epollFd = epoll_create1(EPOLL_CLOEXEC));
+  KJ_SYSCALL(wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  KJ_SYSCALL(epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event));
+#else
+  threadId = pthread_self();
+
+  // The reserved signal must stay blocked in this thread except while waiting, so that a wake()
+  // arriving at any other time stays pending rather than being lost.
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, reservedSignal);
+  pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+#endif
 }
 
-UnixEventPort::~UnixEventPort() {}
+UnixEventPort::~UnixEventPort() {
+#if KJ_USE_EPOLL
+  if (signalFd >= 0) close(signalFd);
+  close(wakeFd);
+  close(epollFd);
+#endif
+}
+
+void UnixEventPort::wake() const {
+#if KJ_USE_EPOLL
+  uint64_t one = 1;
+  ssize_t n;
+  KJ_NONBLOCKING_SYSCALL(n = write(wakeFd, &one, sizeof(one)));
+  // EAGAIN means the counter is saturated, which still wakes the port.
+#else
+  int error = pthread_kill(threadId, reservedSignal);
+  if (error != 0) {
+    KJ_FAIL_SYSCALL("pthread_kill", error);
+  }
+#endif
+}
 
 Promise<short> UnixEventPort::onFdEvent(int fd, short eventMask) {
   return newAdaptedPromise<short, PollPromiseAdapter>(*this, fd, eventMask);
 }
 
+Promise<void> UnixEventPort::atSteadyTime(TimePoint time) {
+  return newAdaptedPromise<void, TimerPromiseAdapter>(*this, time);
+}
+
 Promise<siginfo_t> UnixEventPort::onSignal(int signum) {
   return newAdaptedPromise<siginfo_t, SignalPromiseAdapter>(*this, signum);
 }
@@ -197,9 +490,60 @@ void UnixEventPort::setReservedSignal(int signum) {
   reservedSignal = signum;
 }
 
+#if KJ_USE_EPOLL
+
+class UnixEventPort::PollContext {
+public:
+  PollContext(UnixEventPort& port): port(port) {}
+
+  void run(int timeout) {
+    do {
+      pollResult = epoll_wait(port.epollFd, events, kj::size(events), timeout);
+      pollError = pollResult < 0 ? errno : 0;
+
+      // EINTR should only happen if we received a signal *other than* the ones registered via
+      // the UnixEventPort, so we don't care about that case.
+    } while (pollError == EINTR);
+  }
+
+  inline bool hasResults() { return pollResult != 0; }
+  // True if events arrived (or the call failed, which processResults() will report).
+
+  void processResults() {
+    if (pollResult < 0) {
+      KJ_FAIL_SYSCALL("epoll_wait()", pollError);
+    }
+
+    for (int i = 0; i < pollResult; i++) {
+      if (events[i].data.ptr == nullptr) {
+        // wake() was called.  Just reset the eventfd; the EventLoop picks up whatever was sent
+        // to its executor once we return.
+        uint64_t count;
+        ssize_t n;
+        KJ_NONBLOCKING_SYSCALL(n = read(port.wakeFd, &count, sizeof(count)));
+      } else if (events[i].data.ptr == &port.signalFd) {
+        port.readSignalFd();
+      } else {
+        reinterpret_cast<EpollTarget*>(events[i].data.ptr)->fire(events[i].events);
+      }
+    }
+  }
+
+private:
+  UnixEventPort& port;
+  struct epoll_event events[64];
+  // Anything beyond this many ready descriptors is simply left for the next turn.
+
+  int pollResult = 0;
+  int pollError = 0;
+};
+
+#else  // KJ_USE_EPOLL
+
 class UnixEventPort::PollContext {
 public:
-  PollContext(PollPromiseAdapter* ptr) {
+  PollContext(UnixEventPort& port) {
+    auto ptr = port.pollHead;
     while (ptr != nullptr) {
       struct pollfd pollfd;
       memset(&pollfd, 0, sizeof(pollfd));
@@ -221,6 +565,8 @@ public:
     } while (pollError == EINTR);
   }
 
+  inline bool hasResults() { return pollResult != 0; }
+
   void processResults() {
     if (pollResult < 0) {
       KJ_FAIL_SYSCALL("poll()", pollError);
@@ -244,7 +590,20 @@ private:
   int pollError = 0;
 };
 
+#endif  // KJ_USE_EPOLL, else
+
 void UnixEventPort::wait() {
+  if (busyPoll.spinTime > 0 * NANOSECONDS && spin()) {
+    return;
+  }
+
+#if KJ_USE_EPOLL
+  // Signals come in through the signalfd, so they can stay blocked.
+  PollContext pollContext(*this);
+  pollContext.run(nextTimeoutMs());
+  pollContext.processResults();
+  processTimers();
+#else
   sigset_t newMask;
   sigemptyset(&newMask);
   sigaddset(&newMask, reservedSignal);
@@ -257,7 +616,7 @@ void UnixEventPort::wait() {
     }
   }
 
-  PollContext pollContext(pollHead);
+  PollContext pollContext(*this);
 
   // Capture signals.
   SignalCapture capture;
@@ -270,24 +629,30 @@ void UnixEventPort::wait() {
       gotSignal(capture.siginfo);
     }
 
+    processTimers();
     return;
   }
 
+  int timeout = nextTimeoutMs();
+
   // Enable signals, run the poll, then mask them again.
   sigset_t origMask;
   threadCapture = &capture;
   sigprocmask(SIG_UNBLOCK, &newMask, &origMask);
 
-  pollContext.run(-1);
+  pollContext.run(timeout);
 
   sigprocmask(SIG_SETMASK, &origMask, nullptr);
   threadCapture = nullptr;
 
   // Queue events.
   pollContext.processResults();
+  processTimers();
+#endif
 }
 
 void UnixEventPort::poll() {
+#if !KJ_USE_EPOLL
   sigset_t pending;
   sigset_t waitMask;
   sigemptyset(&pending);
@@ -325,12 +690,41 @@ void UnixEventPort::poll() {
     }
     threadCapture = nullptr;
   }
+#endif
 
   {
-    PollContext pollContext(pollHead);
+    // With epoll, this also picks up pending signals, through the signalfd.
+    PollContext pollContext(*this);
     pollContext.run(0);
     pollContext.processResults();
   }
+
+  processTimers();
+}
+
+bool UnixEventPort::spin() {
+  // Polls with a zero timeout until something happens or the spin time runs out.  Returns true if
+  // events were queued or a timer came due, in which case wait() need not block.
+
+  TimePoint deadline = currentSteadyTime() + busyPoll.spinTime;
+  for (;;) {
+    PollContext pollContext(*this);
+    pollContext.run(0);
+    if (pollContext.hasResults()) {
+      pollContext.processResults();
+      processTimers();
+      return true;
+    }
+
+    if (nextTimeoutMs() == 0) {
+      processTimers();
+      return true;
+    }
+
+    if (currentSteadyTime() >= deadline) {
+      return false;
+    }
+  }
 }
 
 void UnixEventPort::gotSignal(const siginfo_t& siginfo) {
@@ -344,6 +738,144 @@ void UnixEventPort::gotSignal(const siginfo_t& siginfo) {
       ptr = ptr->next;
     }
   }
+
+#if KJ_USE_EPOLL
+  updateSignalFd();
+#endif
+}
+
+TimePoint UnixEventPort::currentSteadyTime() {
+  struct timespec ts;
+  KJ_SYSCALL(clock_gettime(CLOCK_MONOTONIC, &ts));
+  return origin<TimePoint>() + ts.tv_sec * SECONDS + ts.tv_nsec * NANOSECONDS;
+}
+
+int UnixEventPort::nextTimeoutMs() {
+  // Returns the timeout to pass to poll(), i.e. the number of milliseconds until the next timer
+  // fires (rounded up, so we don't wake up early and spin), or -1 if there are no timers.
+
+  auto iter = timers->timers.begin();
+  if (iter == timers->timers.end()) {
+    return -1;
+  }
+
+  Duration delay = (*iter)->time - currentSteadyTime();
+  if (delay <= 0 * NANOSECONDS) {
+    return 0;
+  }
+
+  int64_t ms = (delay + MILLISECONDS - 1 * NANOSECONDS) / MILLISECONDS;
+  return ms > INT_MAX ? INT_MAX : static_cast<int>(ms);
+}
+
+void UnixEventPort::processTimers() {
+  frozenSteadyTime = currentSteadyTime();
+  for (;;) {
+    auto front = timers->timers.begin();
+    if (front == timers->timers.end() || (*front)->time > frozenSteadyTime) {
+      break;
+    }
+    (*front)->fulfill();
+  }
+}
+
+// =======================================================================================
+
+#if KJ_USE_EPOLL
+
+UnixEventPort::FdObserver::FdObserver(UnixEventPort& eventPort, int fd, uint flags)
+    : eventPort(eventPort), fd(fd), flags(flags) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLET;
+  if (flags & OBSERVE_READ) {
+    event.events |= EPOLLIN | EPOLLRDHUP;
+  }
+  if (flags & OBSERVE_WRITE) {
+    event.events |= EPOLLOUT;
+  }
+  event.data.ptr = static_cast<EpollTarget*>(this);
+
+  if (epoll_ctl(eventPort.epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+    int error = errno;
+    if (error != EPERM) {
+      KJ_FAIL_SYSCALL("epoll_ctl(EPOLL_CTL_ADD)", error, fd);
+    }
+    // EPERM means this kind of file can't be polled; it's always ready, like poll() reports.
+  } else {
+    registered = true;
+  }
+}
+
+UnixEventPort::FdObserver::~FdObserver() noexcept(false) {
+  if (registered && epoll_ctl(eventPort.epollFd, EPOLL_CTL_DEL, fd, nullptr) < 0) {
+    KJ_FAIL_SYSCALL("epoll_ctl(EPOLL_CTL_DEL)", errno, fd) { break; }
+  }
+}
+
+Promise<void> UnixEventPort::FdObserver::whenBecomesReadable() {
+  KJ_REQUIRE(flags & OBSERVE_READ, "FdObserver was not set to observe reads.");
+
+  if (!registered) return READY_NOW;
+
+  auto paf = newPromiseAndFulfiller<void>();
+  readFulfiller = kj::mv(paf.fulfiller);
+  return kj::mv(paf.promise);
 }
 
+Promise<void> UnixEventPort::FdObserver::whenBecomesWritable() {
+  KJ_REQUIRE(flags & OBSERVE_WRITE, "FdObserver was not set to observe writes.");
+
+  if (!registered) return READY_NOW;
+
+  auto paf = newPromiseAndFulfiller<void>();
+  writeFulfiller = kj::mv(paf.fulfiller);
+  return kj::mv(paf.promise);
+}
+
+void UnixEventPort::FdObserver::fire(uint32_t events) {
+  if (events & (EPOLLHUP | EPOLLRDHUP)) {
+    atEnd = true;
+  }
+
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR)) {
+    KJ_IF_MAYBE(f, readFulfiller) {
+      f->get()->fulfill();
+      readFulfiller = nullptr;
+    }
+  }
+
+  if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+    KJ_IF_MAYBE(f, writeFulfiller) {
+      f->get()->fulfill();
+      writeFulfiller = nullptr;
+    }
+  }
+}
+
+#else  // KJ_USE_EPOLL
+
+UnixEventPort::FdObserver::FdObserver(UnixEventPort& eventPort, int fd, uint flags)
+    : eventPort(eventPort), fd(fd), flags(flags) {}
+
+UnixEventPort::FdObserver::~FdObserver() noexcept(false) {}
+
+Promise<void> UnixEventPort::FdObserver::whenBecomesReadable() {
+  KJ_REQUIRE(flags & OBSERVE_READ, "FdObserver was not set to observe reads.");
+
+  return eventPort.onFdEvent(fd, POLLIN | POLLRDHUP).then([this](short events) {
+    if (events & (POLLHUP | POLLRDHUP)) {
+      atEnd = true;
+    }
+  });
+}
+
+Promise<void> UnixEventPort::FdObserver::whenBecomesWritable() {
+  KJ_REQUIRE(flags & OBSERVE_WRITE, "FdObserver was not set to observe writes.");
+
+  return eventPort.onFdEvent(fd, POLLOUT).then([](short) {});
+}
+
+#endif  // KJ_USE_EPOLL, else
+
 }  // namespace kj
@@ -25,11 +25,21 @@
 #define KJ_ASYNC_UNIX_H_
 
 #include "async.h"
+#include "time.h"
 #include "vector.h"
 #include <signal.h>
 #include <poll.h>
 #include <pthread.h>
 
+#if __linux__ && !defined(KJ_USE_EPOLL)
+// Default to epoll on Linux.  Define KJ_USE_EPOLL=0 at build time to fall back to `poll()`.
+#define KJ_USE_EPOLL 1
+#endif
+
+#if KJ_USE_EPOLL
+#include <stdint.h>
+#endif
+
 namespace kj {
 
 class UnixEventPort: public EventPort {
@@ -38,10 +48,12 @@ class UnixEventPort: public EventPort {
   // An EventPort implementation which can wait for events on file descriptors as well as signals.
   // This API only makes sense on Unix.
   //
-  // The implementation uses `poll()` or possibly a platform-specific API (e.g. epoll, kqueue).
-  // To also wait on signals without race conditions, the implementation may block signals until
-  // just before `poll()` while using a signal handler which `siglongjmp()`s back to just before
-  // the signal was unblocked, or it may use a nicer platform-specific API like signalfd.
+  // The implementation uses epoll on Linux and `poll()` elsewhere.  (Build with KJ_USE_EPOLL=0 to
+  // force `poll()` on Linux.)
+  // With epoll, signals are received through a signalfd in the epoll set, so they are ordinary
+  // descriptor events and stay blocked all the time.  With `poll()`, to wait on signals without
+  // race conditions, the implementation blocks signals until just before `poll()` while using a
+  // signal handler which `siglongjmp()`s back to just before the signal was unblocked.
   //
   // The implementation reserves a signal for internal use.  By default, it uses SIGUSR1.  If you
   // need to use SIGUSR1 for something else, you must offer a different signal by calling
@@ -51,9 +63,17 @@ public:
   UnixEventPort();
   ~UnixEventPort();
 
+  class FdObserver;
+  // Efficiently watches a single file descriptor over its lifetime.  Prefer this over
+  // `onFdEvent()` for long-lived descriptors such as sockets.  See below.
+
   Promise<short> onFdEvent(int fd, short eventMask);
   // `eventMask` is a bitwise-OR of poll events (e.g. `POLLIN`, `POLLOUT`, etc.).  The next time
   // one or more of the given events occurs on `fd`, the set of events that occurred are returned.
+  //
+  // This is level-triggered:  if an event is already pending when `onFdEvent()` is called, the
+  // promise resolves on the next turn.  With epoll, each call costs a couple of `epoll_ctl()`
+  // calls to register and unregister the descriptor; use `FdObserver` to avoid this.
 
   Promise<siginfo_t> onSignal(int signum);
   // When the given signal is delivered to this thread, return the corresponding siginfo_t.
@@ -78,6 +98,35 @@ public:
   // To un-capture a signal, simply install a different signal handler and then un-block it from
   // the signal mask.
 
+  TimePoint steadyTime() { return frozenSteadyTime; }
+  // Returns the current time on CLOCK_MONOTONIC, as of the last time the event port waited or
+  // polled.  The value does not change between calls to `wait()` / `poll()`, so all events in a
+  // turn see the same time.
+
+  Promise<void> atSteadyTime(TimePoint time);
+  // Returns a promise that resolves once `steadyTime()` reaches `time`.  Outstanding timers are
+  // kept in an ordered set, so adding or cancelling one costs O(log n) and `wait()` sleeps only
+  // until the earliest one.
+
+  struct BusyPollOptions {
+    Duration spinTime = 0 * NANOSECONDS;
+    // How long `wait()` keeps polling without sleeping before it falls back to blocking.  Spinning
+    // avoids the scheduler wakeup latency of a blocking `epoll_wait()` / `poll()` (typically tens
+    // of microseconds) at the cost of burning a core, so only use it on dedicated cores.  Without
+    // epoll, captured signals and cross-thread `wake()`s are not noticed until the spin gives up.
+
+    uint socketBusyPollMicros = 0;
+    // If non-zero, sockets wrapped by this port's `LowLevelAsyncIoProvider` set `SO_BUSY_POLL`
+    // to this many microseconds before their next read, so that the kernel busy-polls the device
+    // queue instead of waiting for an interrupt.  This is best-effort: it is silently skipped for
+    // non-sockets, on platforms without `SO_BUSY_POLL`, and when the kernel refuses (raising it
+    // above `net.core.busy_read` needs CAP_NET_ADMIN).
+  };
+
+  void setBusyPoll(BusyPollOptions options) { busyPoll = options; }
+  const BusyPollOptions& getBusyPoll() { return busyPoll; }
+  // Opt in to busy-polling for low latency.  May be changed at any time from the port's thread.
+
   static void setReservedSignal(int signum);
   // Sets the signal number which `UnixEventPort` reserves for internal use.  If your application
   // needs to use SIGUSR1, call this at startup (before any calls to `captureSignal()` and before
@@ -86,18 +135,131 @@ public:
   // implements EventPort ------------------------------------------------------
   void wait() override;
   void poll() override;
+  void wake() const override;
+  // With epoll, writes to an eventfd which is registered alongside everything else.  Otherwise,
+  // sends the reserved signal to the port's thread.
 
 private:
   class PollPromiseAdapter;
   class SignalPromiseAdapter;
   class PollContext;
+  class TimerPromiseAdapter;
+  struct TimerBefore;
+  struct TimerSet;  // Defined in source file to avoid STL include.
+
+  Own<TimerSet> timers;
+  TimePoint frozenSteadyTime;
+
+  BusyPollOptions busyPoll;
 
-  PollPromiseAdapter* pollHead = nullptr;
-  PollPromiseAdapter** pollTail = &pollHead;
   SignalPromiseAdapter* signalHead = nullptr;
   SignalPromiseAdapter** signalTail = &signalHead;
 
+#if KJ_USE_EPOLL
+  class EpollTarget;
+  class FdEntry;
+
+  int epollFd;
+  int wakeFd;
+  // eventfd written by wake().  Registered with the epoll set using a null `data.ptr`.
+
+  Vector<Own<FdEntry>> fdEntries;
+  // Indexed by file descriptor.  An entry exists only while some `onFdEvent()` promise is waiting
+  // on that descriptor.
+
+  int signalFd = -1;
+  sigset_t signalFdMask;
+  // signalfd covering the signals which `onSignal()` promises are waiting for, created on first
+  // use.  Registered with the epoll set using `&signalFd` as `data.ptr`.
+
+  FdEntry& getFdEntry(int fd);
+  void updateFdEntry(FdEntry& entry);
+  void updateSignalFd();
+  void readSignalFd();
+#else
+  PollPromiseAdapter* pollHead = nullptr;
+  PollPromiseAdapter** pollTail = &pollHead;
+
+  pthread_t threadId;
+  // The thread which constructed the port, and which wake() signals.
+#endif
+
   void gotSignal(const siginfo_t& siginfo);
+  bool spin();
+
+  TimePoint currentSteadyTime();
+  int nextTimeoutMs();
+  void processTimers();
+};
+
+#if KJ_USE_EPOLL
+class UnixEventPort::EpollTarget {
+  // Anything registered with the epoll FD.  `epoll_event::data.ptr` points at one of these.
+
+public:
+  virtual void fire(uint32_t events) = 0;
+};
+#endif
+
+class UnixEventPort::FdObserver final
+#if KJ_USE_EPOLL
+    : private UnixEventPort::EpollTarget
+#endif
+{
+  // Watches a file descriptor for readability and/or writability for as long as the observer
+  // exists.  With epoll, the descriptor is registered once, in edge-triggered mode, when the
+  // observer is constructed, and unregistered when it is destroyed, so waiting costs no system
+  // calls at all.
+  //
+  // Because notification is edge-triggered, `whenBecomesReadable()` only resolves when *new* data
+  // arrives.  Therefore, only call it after a read has returned EAGAIN (or returned fewer bytes
+  // than requested, which for sockets and pipes means the buffer was drained).  The same goes for
+  // `whenBecomesWritable()` and writes.  Spurious wakeups are possible, so always be prepared to
+  // get EAGAIN again after the promise resolves.
+  //
+  // Only one `FdObserver` may exist for a given file descriptor at a time, and you should not
+  // also call `onFdEvent()` on a descriptor that has an observer.  The observer must be destroyed
+  // before the file descriptor is closed.
+
+public:
+  enum Flags {
+    OBSERVE_READ = 1,
+    OBSERVE_WRITE = 2,
+    OBSERVE_READ_WRITE = OBSERVE_READ | OBSERVE_WRITE
+  };
+
+  FdObserver(UnixEventPort& eventPort, int fd, uint flags);
+  KJ_DISALLOW_COPY(FdObserver);
+  ~FdObserver() noexcept(false);
+
+  Promise<void> whenBecomesReadable();
+  // Resolves the next time the descriptor becomes readable, or when the peer hangs up.  Only one
+  // such promise may be outstanding at a time.  Requires OBSERVE_READ.
+
+  Promise<void> whenBecomesWritable();
+  // Resolves the next time the descriptor becomes writable.  Only one such promise may be
+  // outstanding at a time.  Requires OBSERVE_WRITE.
+
+  inline bool atEndHint() { return atEnd; }
+  // Returns true if a hangup has been observed, meaning that once the read buffer is drained the
+  // next read will return EOF.  False negatives are possible; false positives are not.
+
+private:
+  UnixEventPort& eventPort;
+  int fd;
+  uint flags;
+  bool atEnd = false;
+
+#if KJ_USE_EPOLL
+  bool registered = false;
+  // False if epoll refused the descriptor (e.g. a regular file), in which case it is always
+  // considered ready.
+
+  Maybe<Own<PromiseFulfiller<void>>> readFulfiller;
+  Maybe<Own<PromiseFulfiller<void>>> writeFulfiller;
+
+  void fire(uint32_t events) override;
+#endif
 };
 
 }  // namespace kj
@@ -25,7 +25,7 @@
 #include "debug.h"
 #include "vector.h"
 #include <exception>
-#include <map>
+#include <time.h>
 
 #if KJ_USE_FUTEX
 #include <unistd.h>
@@ -35,11 +35,11 @@
 
 #if !KJ_NO_RTTI
 #include <typeinfo>
+#endif
 #if __GNUC__
 #include <cxxabi.h>
 #include <stdlib.h>
 #endif
-#endif
 
 namespace kj {
 
@@ -55,6 +55,13 @@ EventLoop& currentEventLoop() {
   return *loop;
 }
 
+uint64_t monotonicNanos() {
+  // Only called while an EventLoopProfiler is installed.
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
 class BoolEvent: public _::Event {
 public:
   bool fired = false;
@@ -95,12 +102,15 @@ public:
     : errorHandler(errorHandler) {}
 
   ~TaskSetImpl() noexcept(false) {
-    // std::map doesn't like it when elements' destructors throw, so carefully disassemble it.
-    if (!tasks.empty()) {
-      Vector<Own<Task>> deleteMe(tasks.size());
-      for (auto& entry: tasks) {
-        deleteMe.add(kj::mv(entry.second));
+    // Unlink and destroy the tasks one at a time.  Letting the list destroy itself would recurse
+    // once per task, which can overflow the stack when there are many of them.
+    while (tasks != nullptr) {
+      Own<Task> task = kj::mv(KJ_ASSERT_NONNULL(tasks));
+      tasks = kj::mv(task->next);
+      KJ_IF_MAYBE(head, tasks) {
+        head->get()->prev = &tasks;
       }
+      task->prev = nullptr;
     }
   }
 
@@ -130,11 +140,15 @@ public:
         taskSet.errorHandler.taskFailed(kj::mv(*e));
       }
 
-      // Remove from the task map.
-      auto iter = taskSet.tasks.find(this);
-      KJ_ASSERT(iter != taskSet.tasks.end());
-      Own<Event> self = kj::mv(iter->second);
-      taskSet.tasks.erase(iter);
+      // Remove from the task list.
+      KJ_IF_MAYBE(n, next) {
+        n->get()->prev = prev;
+      }
+      Own<Event> self = kj::mv(KJ_ASSERT_NONNULL(*prev));
+      KJ_ASSERT(self.get() == this);
+      *prev = kj::mv(next);
+      next = nullptr;
+      prev = nullptr;
       return mv(self);
     }
 
@@ -142,6 +156,12 @@ public:
       return node;
     }
 
+  public:
+    Maybe<Own<Task>> next;
+    Maybe<Own<Task>>* prev = nullptr;
+    // Links in the TaskSet's list of tasks.  Each task is owned by the previous one's `next`, or by
+    // the list head, and `prev` points at whichever that is, so unlinking is O(1).
+
   private:
     TaskSetImpl& taskSet;
     kj::Own<_::PromiseNode> node;
@@ -149,23 +169,35 @@ public:
 
   void add(Promise<void>&& promise) {
     auto task = heap<Task>(*this, kj::mv(promise.node));
-    Task* ptr = task;
-    tasks.insert(std::make_pair(ptr, kj::mv(task)));
+    KJ_IF_MAYBE(head, tasks) {
+      head->get()->prev = &task->next;
+      task->next = kj::mv(tasks);
+    }
+    task->prev = &tasks;
+    tasks = kj::mv(task);
   }
 
   kj::String trace() {
     kj::Vector<kj::String> traces;
-    for (auto& entry: tasks) {
-      traces.add(entry.second->trace());
+
+    Maybe<Own<Task>>* ptr = &tasks;
+    for (;;) {
+      KJ_IF_MAYBE(task, *ptr) {
+        traces.add(task->get()->trace());
+        ptr = &task->get()->next;
+      } else {
+        break;
+      }
     }
+
     return kj::strArray(traces, "\n============================================\n");
   }
 
 private:
   TaskSet::ErrorHandler& errorHandler;
 
-  // TODO(perf):  Use a linked list instead.
-  std::map<Task*, Own<Task>> tasks;
+  Maybe<Own<Task>> tasks;
+  // Head of a doubly-linked list of unfinished tasks, newest first.
 };
 
 class LoggingErrorHandler: public TaskSet::ErrorHandler {
@@ -198,19 +230,28 @@ NullEventPort NullEventPort::instance = NullEventPort();
 
 void EventPort::setRunnable(bool runnable) {}
 
+void EventPort::wake() const {}
+
 EventLoop::EventLoop()
     : port(_::NullEventPort::instance),
-      daemons(kj::heap<_::TaskSetImpl>(_::LoggingErrorHandler::instance)) {}
+      daemons(kj::heap<_::TaskSetImpl>(_::LoggingErrorHandler::instance)),
+      executor(kj::atomicRefcounted<Executor>(*this)) {}
 
 EventLoop::EventLoop(EventPort& port)
     : port(port),
-      daemons(kj::heap<_::TaskSetImpl>(_::LoggingErrorHandler::instance)) {}
+      daemons(kj::heap<_::TaskSetImpl>(_::LoggingErrorHandler::instance)),
+      executor(kj::atomicRefcounted<Executor>(*this)) {}
 
 EventLoop::~EventLoop() noexcept(false) {
   // Destroy all "daemon" tasks, noting that their destructors might try to access the EventLoop
   // some more.
   daemons = nullptr;
 
+  // Stop accepting cross-thread events.  Other threads may still hold references to the
+  // executor, which will outlive us.
+  executor->shutdown();
+  executor = nullptr;
+
   // The application _should_ destroy everything using the EventLoop before destroying the
   // EventLoop itself, so if there are events on the loop, this indicates a memory leak.
   KJ_REQUIRE(head == nullptr, "EventLoop destroyed with events still in the queue.  Memory leak?",
@@ -231,18 +272,29 @@ EventLoop::~EventLoop() noexcept(false) {
     threadLocalEventLoop = nullptr;
     break;
   }
+
+  for (void* block: freeNodes) {
+    while (block != nullptr) {
+      void* next = *reinterpret_cast<void**>(block);
+      operator delete(block);
+      block = next;
+    }
+  }
 }
 
 void EventLoop::run(uint maxTurnCount) {
   running = true;
   KJ_DEFER(running = false);
 
+  executor->poll();
+
   for (uint i = 0; i < maxTurnCount; i++) {
     if (!turn()) {
       break;
     }
   }
 
+  finishTurn();
   setRunnable(head != nullptr);
 }
 
@@ -265,12 +317,38 @@ bool EventLoop::turn() {
 
     event->next = nullptr;
     event->prev = nullptr;
+    --queueDepth;
 
     Maybe<Own<_::Event>> eventToDestroy;
-    {
+    if (profiler == nullptr) {
       event->firing = true;
       KJ_DEFER(event->firing = false);
       eventToDestroy = event->fire();
+    } else {
+      // Look up the source before firing, since firing may replace the event's inner node.
+#if KJ_NO_RTTI
+      const char* source = nullptr;
+#else
+      _::PromiseNode* inner = event->getInnerForTrace();
+      const char* source = inner == nullptr ? typeid(*event).name() : typeid(*inner).name();
+#endif
+      uint depth = queueDepth;
+
+      uint64_t start = monotonicNanos();
+      if (turnEventCount++ == 0) {
+        turnStartTime = start;
+      }
+
+      {
+        event->firing = true;
+        KJ_DEFER(event->firing = false);
+        eventToDestroy = event->fire();
+      }
+
+      // The callback may have removed the profiler.
+      if (profiler != nullptr) {
+        profiler->eventFired(source, monotonicNanos() - start, depth);
+      }
     }
 
     depthFirstInsertPoint = &head;
@@ -278,6 +356,38 @@ bool EventLoop::turn() {
   }
 }
 
+void EventLoop::finishTurn() {
+  if (turnEventCount > 0) {
+    if (profiler != nullptr) {
+      profiler->turnFinished(monotonicNanos() - turnStartTime, turnEventCount);
+    }
+    turnEventCount = 0;
+  }
+}
+
+void EventLoop::waitOnPort() {
+  finishTurn();
+
+  if (profiler == nullptr) {
+    port.wait();
+  } else {
+    uint64_t start = monotonicNanos();
+    port.wait();
+    if (profiler != nullptr) {
+      profiler->portWaited(monotonicNanos() - start);
+    }
+  }
+}
+
+void EventLoop::setProfiler(kj::Maybe<EventLoopProfiler&> newProfiler) {
+  KJ_IF_MAYBE(p, newProfiler) {
+    profiler = p;
+  } else {
+    profiler = nullptr;
+    turnEventCount = 0;
+  }
+}
+
 void EventLoop::setRunnable(bool runnable) {
   if (runnable != lastRunnableState) {
     port.setRunnable(runnable);
@@ -298,6 +408,87 @@ void EventLoop::leaveScope() {
   threadLocalEventLoop = nullptr;
 }
 
+const Executor& EventLoop::getExecutor() {
+  return *executor;
+}
+
+// =======================================================================================
+
+Executor::Executor(EventLoop& loop): loop(&loop) {}
+
+bool Executor::isLive() const {
+  return *loop.lockShared() != nullptr;
+}
+
+Own<const Executor> Executor::addRef() const {
+  return kj::atomicAddRef(*this);
+}
+
+void Executor::send(_::XThreadEvent& event) const {
+  {
+    auto lock = loop.lockShared();
+    if (*lock != nullptr) {
+      _::XThreadEvent* head = __atomic_load_n(&queueHead, __ATOMIC_RELAXED);
+      do {
+        event.next = head;
+      } while (!__atomic_compare_exchange_n(&queueHead, &head, &event, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+      if (head == nullptr) {
+        // The queue was empty, so the loop may be asleep.  If it wasn't empty, whoever made it
+        // non-empty already woke it, and it hasn't drained the queue yet.
+        (*lock)->port.wake();
+      }
+      return;
+    }
+  }
+
+  // Discard outside the lock, since discarding may well send something somewhere else.
+  event.discard();
+}
+
+bool Executor::poll() {
+  if (__atomic_load_n(&queueHead, __ATOMIC_RELAXED) == nullptr) {
+    return false;
+  }
+
+  // Take the whole stack and reverse it, so that events are delivered in the order they were
+  // sent (at least for any one sending thread).
+  _::XThreadEvent* event = __atomic_exchange_n(&queueHead, nullptr, __ATOMIC_ACQUIRE);
+  _::XThreadEvent* reversed = nullptr;
+  while (event != nullptr) {
+    _::XThreadEvent* next = event->next;
+    event->next = reversed;
+    reversed = event;
+    event = next;
+  }
+
+  while (reversed != nullptr) {
+    _::XThreadEvent* next = reversed->next;
+    reversed->deliver();
+    reversed = next;
+  }
+
+  return true;
+}
+
+void Executor::shutdown() {
+  // Once we hold the lock exclusively, no send is in progress, and none can push after we
+  // release it.
+  *loop.lockExclusive() = nullptr;
+
+  _::XThreadEvent* event = __atomic_exchange_n(&queueHead, nullptr, __ATOMIC_ACQUIRE);
+  while (event != nullptr) {
+    _::XThreadEvent* next = event->next;
+    event->discard();
+    event = next;
+  }
+}
+
+const Executor& getCurrentThreadExecutor() {
+  return currentEventLoop().getExecutor();
+}
+
 namespace _ {  // private
 
 void waitImpl(Own<_::PromiseNode>&& node, _::ExceptionOrValue& result, WaitScope& waitScope) {
@@ -313,12 +504,16 @@ void waitImpl(Own<_::PromiseNode>&& node, _::ExceptionOrValue& result, WaitScope
   KJ_DEFER(loop.running = false);
 
   while (!doneEvent.fired) {
+    // Picking up cross-thread events costs one atomic load when there are none.
+    loop.executor->poll();
+
     if (!loop.turn()) {
       // No events in the queue.  Wait for callback.
-      loop.port.wait();
+      loop.waitOnPort();
     }
   }
 
+  loop.finishTurn();
   loop.setRunnable(loop.head != nullptr);
 
   node->get(result);
@@ -329,12 +524,53 @@ void waitImpl(Own<_::PromiseNode>&& node, _::ExceptionOrValue& result, WaitScope
   }
 }
 
+static constexpr size_t NODE_SIZE_STEP = 16;
+static constexpr uint MAX_FREE_NODES_PER_CLASS = 256;
+// Bounds what an idle loop keeps around to 16 * 256 * (16 + 256) / 2 bytes, about 540k at worst.
+
+void* allocPromiseNode(size_t size) {
+  uint sizeClass = (size - 1) / NODE_SIZE_STEP;
+  if (sizeClass >= EventLoop::NODE_SIZE_CLASSES) {
+    return operator new(size);
+  }
+
+  EventLoop* loop = threadLocalEventLoop;
+  if (loop != nullptr) {
+    void*& head = loop->freeNodes[sizeClass];
+    if (head != nullptr) {
+      void* result = head;
+      head = *reinterpret_cast<void**>(result);
+      --loop->freeNodeCounts[sizeClass];
+      return result;
+    }
+  }
+
+  // Round up, so that the block can be reused for any node in the same size class.
+  return operator new((sizeClass + 1) * NODE_SIZE_STEP);
+}
+
+void freePromiseNode(void* ptr, size_t size) {
+  // Nodes don't have to be freed on the thread or loop that allocated them: the blocks all come
+  // from the global allocator, so any loop can recycle them.
+
+  uint sizeClass = (size - 1) / NODE_SIZE_STEP;
+  EventLoop* loop = threadLocalEventLoop;
+  if (loop != nullptr && sizeClass < EventLoop::NODE_SIZE_CLASSES &&
+      loop->freeNodeCounts[sizeClass] < MAX_FREE_NODES_PER_CLASS) {
+    *reinterpret_cast<void**>(ptr) = loop->freeNodes[sizeClass];
+    loop->freeNodes[sizeClass] = ptr;
+    ++loop->freeNodeCounts[sizeClass];
+  } else {
+    operator delete(ptr);
+  }
+}
+
 Promise<void> yield() {
-  return Promise<void>(false, kj::heap<YieldPromiseNode>());
+  return Promise<void>(false, heapNode<YieldPromiseNode>());
 }
 
 Own<PromiseNode> neverDone() {
-  return kj::heap<NeverDonePromiseNode>();
+  return heapNode<NeverDonePromiseNode>();
 }
 
 void NeverDone::wait(WaitScope& waitScope) const {
@@ -365,6 +601,7 @@ Event::~Event() noexcept(false) {
     if (next != nullptr) {
       next->prev = prev;
     }
+    --loop.queueDepth;
   }
 
   KJ_REQUIRE(!firing, "Promise callback destroyed itself.");
@@ -391,6 +628,7 @@ void Event::armDepthFirst() {
       loop.tail = &next;
     }
 
+    ++loop.queueDepth;
     loop.setRunnable(true);
   }
 }
@@ -410,6 +648,7 @@ void Event::armBreadthFirst() {
 
     loop.tail = &next;
 
+    ++loop.queueDepth;
     loop.setRunnable(true);
   }
 }
@@ -418,9 +657,8 @@ _::PromiseNode* Event::getInnerForTrace() {
   return nullptr;
 }
 
-#if !KJ_NO_RTTI
 #if __GNUC__
-static kj::String demangleTypeName(const char* name) {
+kj::String demangleTypeName(const char* name) {
   int status;
   char* buf = abi::__cxa_demangle(name, nullptr, nullptr, &status);
   kj::String result = kj::heapString(buf == nullptr ? name : buf);
@@ -428,11 +666,10 @@ static kj::String demangleTypeName(const char* name) {
   return kj::mv(result);
 }
 #else
-static kj::String demangleTypeName(const char* name) {
+kj::String demangleTypeName(const char* name) {
   return kj::heapString(name);
 }
 #endif
-#endif
 
 static kj::String traceImpl(Event* event, _::PromiseNode* node) {
 #if KJ_NO_RTTI
@@ -718,7 +955,7 @@ Maybe<Own<Event>> ChainPromiseNode::fire() {
     // There is an exception.  If there is also a value, delete it.
     kj::runCatchingExceptions([&,this]() { intermediate.value = nullptr; });
     // Now set step2 to a rejected promise.
-    inner = heap<ImmediateBrokenPromiseNode>(kj::mv(*exception));
+    inner = heapNode<ImmediateBrokenPromiseNode>(kj::mv(*exception));
   } else KJ_IF_MAYBE(value, intermediate.value) {
     // There is a value and no exception.  The value is itself a promise.  Adopt it as our
     // step2.
@@ -910,5 +1147,83 @@ void AdapterPromiseNodeBase::onReady(Event& event) noexcept {
   onReadyEvent.init(event);
 }
 
+// -------------------------------------------------------------------
+
+namespace {
+
+enum XThreadPafFlags: uint {
+  FULFILLED = 1,
+  NODE_GONE = 2
+};
+
+}  // namespace
+
+class XThreadPafBase::Node final: public PromiseNode {
+public:
+  Node(XThreadPafBase& state): state(state) {
+    state.node = this;
+  }
+
+  ~Node() noexcept(false) {
+    __atomic_fetch_or(&state.flags, NODE_GONE, __ATOMIC_RELEASE);
+    state.node = nullptr;
+    state.dropRef();
+  }
+
+  void onReady(Event& event) noexcept override {
+    onReadyEvent.init(event);
+  }
+
+  void get(ExceptionOrValue& output) noexcept override {
+    state.getResult(output);
+  }
+
+  void ready() {
+    onReadyEvent.arm();
+  }
+
+private:
+  XThreadPafBase& state;
+  OnReadyEvent onReadyEvent;
+};
+
+XThreadPafBase::XThreadPafBase(): executor(getCurrentThreadExecutor().addRef()) {}
+XThreadPafBase::~XThreadPafBase() noexcept(false) {}
+
+Own<PromiseNode> XThreadPafBase::makeNode() {
+  return heapNode<Node>(*this);
+}
+
+bool XThreadPafBase::startFulfill() {
+  return (__atomic_fetch_or(&flags, FULFILLED, __ATOMIC_ACQ_REL) & FULFILLED) == 0;
+}
+
+void XThreadPafBase::finishFulfill() {
+  // The executor queue holds a reference until deliver() or discard().
+  __atomic_add_fetch(&refcount, 1, __ATOMIC_RELAXED);
+  executor->send(*this);
+}
+
+bool XThreadPafBase::isWaitingImpl() const {
+  return __atomic_load_n(&flags, __ATOMIC_ACQUIRE) == 0;
+}
+
+void XThreadPafBase::dropRef() const {
+  if (__atomic_sub_fetch(&refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+    delete this;
+  }
+}
+
+void XThreadPafBase::deliver() {
+  if (node != nullptr) {
+    node->ready();
+  }
+  dropRef();
+}
+
+void XThreadPafBase::discard() {
+  dropRef();
+}
+
 }  // namespace _ (private)
 }  // namespace kj
@@ -26,13 +26,16 @@
 
 #include "async-prelude.h"
 #include "exception.h"
+#include "mutex.h"
 #include "refcount.h"
 #include "tuple.h"
+#include <inttypes.h>
 
 namespace kj {
 
 class EventLoop;
 class WaitScope;
+class Executor;
 
 template <typename T>
 class Promise;
@@ -286,6 +289,8 @@ private:
   template <typename U>
   friend PromiseFulfillerPair<U> newPromiseAndFulfiller();
   template <typename>
+  friend class _::XThreadPaf;
+  template <typename>
   friend class _::ForkHub;
   friend class _::TaskSetImpl;
   friend Promise<void> _::yield();
@@ -464,6 +469,17 @@ PromiseFulfillerPair<T> newPromiseAndFulfiller();
 // fulfiller will be of type `PromiseFulfiller<Promise<U>>`.  Thus you pass a `Promise<U>` to the
 // `fulfill()` callback, and the promises are chained.
 
+template <typename T>
+PromiseFulfillerPair<T> newPromiseAndCrossThreadFulfiller();
+// Like `newPromiseAndFulfiller()`, but the fulfiller may be used -- and destroyed -- from any
+// thread, whereas the promise belongs to the calling thread's `EventLoop` as usual.  The result
+// is handed back through that loop's `Executor`, waking it if it is asleep, so this is the way to
+// deliver results from a worker thread that does not run an event loop of its own.
+//
+// `T` is moved across threads and so must not be a promise type, nor refer to anything owned by
+// either thread's event loop.  If the calling thread's `EventLoop` is destroyed before the
+// fulfiller is used, the result is silently dropped.
+
 // =======================================================================================
 // TaskSet
 
@@ -536,6 +552,40 @@ public:
   // transitions from empty -> runnable or runnable -> empty.  This is typically useful when
   // integrating with an external event loop; if the loop is currently runnable then you should
   // arrange to call run() on it soon.  The default implementation does nothing.
+
+  virtual void wake() const;
+  // Called from some *other* thread when it has queued an event on the loop's `Executor`.  If the
+  // port's thread is sleeping in `wait()`, it should return soon; if it is not, the next call to
+  // `wait()` should return promptly instead of sleeping.  Must be thread-safe.
+  //
+  // The default implementation does nothing, which means cross-thread events are only noticed
+  // the next time the loop runs for some other reason.
+};
+
+class EventLoopProfiler {
+  // Receives timing information from an `EventLoop`, for finding out which callbacks are stalling
+  // the loop.  Install one with `EventLoop::setProfiler()`; while none is installed the loop does
+  // not read the clock at all.
+  //
+  // All methods are called synchronously on the loop's thread, so implementations need no locking
+  // but should be cheap.  `EventLoopStats` (in `kj/async-stats.h`) is a ready-made implementation
+  // which keeps histograms.
+
+public:
+  virtual void eventFired(const char* source, uint64_t nanoseconds, uint queueDepth) = 0;
+  // An event callback took `nanoseconds` to run.  `source` is the mangled type name of the promise
+  // node whose continuation ran -- for `then()` this is a `TransformPromiseNode` instantiated on
+  // the lambda's type, which names the function the lambda was written in.  The pointer is stable
+  // for the life of the program, so it makes a good map key; it is null if RTTI is disabled.
+  // `queueDepth` is the number of events that were still queued behind this one.
+
+  virtual void turnFinished(uint64_t nanoseconds, uint eventCount) = 0;
+  // The loop ran `eventCount` events back-to-back, taking `nanoseconds` in total, before going
+  // back to the `EventPort` (or returning from `run()`).  This is how long a newly-arrived I/O
+  // event could have had to wait.
+
+  virtual void portWaited(uint64_t nanoseconds) = 0;
+  // The loop spent `nanoseconds` blocked in `EventPort::wait()`, e.g. `UnixEventPort::wait()`.
 };
 
 class EventLoop {
@@ -587,6 +637,17 @@ public:
   bool isRunnable();
   // Returns true if run() would currently do anything, or false if the queue is empty.
 
+  const Executor& getExecutor();
+  // Returns the thread-safe handle through which other threads can queue work on this loop.
+
+  void setProfiler(kj::Maybe<EventLoopProfiler&> profiler);
+  // Starts reporting event timings to `profiler`, or stops if null.  May be called at any time
+  // from the loop's thread, including from within an event callback.  The profiler must stay
+  // alive until it is removed or the loop is destroyed.
+
+  inline uint getQueueDepth() { return queueDepth; }
+  // Returns the number of events currently queued.
+
 private:
   EventPort& port;
 
@@ -600,9 +661,28 @@ private:
   _::Event** tail = &head;
   _::Event** depthFirstInsertPoint = &head;
 
+  uint queueDepth = 0;
+  // Number of events in the queue.
+
+  EventLoopProfiler* profiler = nullptr;
+  uint turnEventCount = 0;
+  uint64_t turnStartTime = 0;
+  // Events run, and the clock when the first of them started, since the loop last went back to
+  // the port.  Only maintained while `profiler` is set.
+
   Own<_::TaskSetImpl> daemons;
 
+  Own<Executor> executor;
+
+  static constexpr uint NODE_SIZE_CLASSES = 16;
+  void* freeNodes[NODE_SIZE_CLASSES] = {};
+  uint freeNodeCounts[NODE_SIZE_CLASSES] = {};
+  // Recycled promise node memory, one singly-linked free list per 16-byte size class.  See
+  // `_::allocPromiseNode()`.
+
   bool turn();
+  void finishTurn();
+  void waitOnPort();
   void setRunnable(bool runnable);
   void enterScope();
   void leaveScope();
@@ -610,8 +690,11 @@ private:
   friend void _::detach(kj::Promise<void>&& promise);
   friend void _::waitImpl(Own<_::PromiseNode>&& node, _::ExceptionOrValue& result,
                           WaitScope& waitScope);
+  friend void* _::allocPromiseNode(size_t size);
+  friend void _::freePromiseNode(void* ptr, size_t size);
   friend class _::Event;
   friend class WaitScope;
+  friend class Executor;
 };
 
 class WaitScope {
@@ -635,6 +718,73 @@ private:
                           WaitScope& waitScope);
 };
 
+// =======================================================================================
+// Cross-thread execution
+
+class Executor: public AtomicRefcounted {
+  // A thread-safe handle to an `EventLoop`, through which other threads can queue work on that
+  // loop.  Everything else in this file must be used only from the thread that owns the loop;
+  // `Executor` is the exception.
+  //
+  // Events sent to an executor go onto a lock-free queue which the loop drains between turns,
+  // waking its `EventPort` (see `EventPort::wake()`) if the queue was empty.  The executor object
+  // itself outlives its loop for as long as some other thread holds a reference; once the loop
+  // is gone, anything sent to it is discarded.
+
+public:
+  KJ_DISALLOW_COPY(Executor);
+
+  template <typename Func>
+  PromiseForResult<Func, void> executeAsync(Func&& func) const;
+  // Calls `func()` in the executor's thread, and returns a promise -- in the *calling* thread,
+  // which must have an `EventLoop` of its own -- for its result.  If `func()` returns a promise,
+  // the executor's thread waits for it before sending the result back.
+  //
+  // `func` and its result are moved across threads, so the same caveats as for
+  // `newPromiseAndCrossThreadFulfiller()` apply.  Destroying the returned promise does not cancel
+  // the call; the result is simply dropped when it arrives.  If the executor's loop has already
+  // been destroyed, the returned promise is rejected.
+
+  bool isLive() const;
+  // Returns false if the executor's `EventLoop` has been destroyed.
+
+  Own<const Executor> addRef() const;
+  // Returns a new reference to the executor which may be held by any thread, keeping the
+  // `Executor` object -- though not its loop -- alive.
+
+private:
+  MutexGuarded<EventLoop*> loop;
+  // Shared-locked by senders so that the loop (and its port) can't go away mid-send; the loop
+  // takes it exclusively when shutting down.
+
+  mutable _::XThreadEvent* queueHead = nullptr;
+  // Lock-free stack of pending events, most recently sent first.  Any thread may push; only the
+  // loop's thread pops, and it always takes the whole stack at once.
+
+  explicit Executor(EventLoop& loop);
+
+  void send(_::XThreadEvent& event) const;
+  // Queues `event`, taking ownership of it.  If the loop is gone, `event.discard()` is called
+  // immediately instead.
+
+  bool poll();
+  // Called by the loop's own thread to deliver everything queued so far.  Returns false if there
+  // was nothing to deliver.
+
+  void shutdown();
+  // Called by the loop's destructor.
+
+  friend class EventLoop;
+  friend class _::XThreadPafBase;
+  template <typename T, typename... Params>
+  friend Own<T> atomicRefcounted(Params&&... params);
+  friend void _::waitImpl(Own<_::PromiseNode>&& node, _::ExceptionOrValue& result,
+                          WaitScope& waitScope);
+};
+
+const Executor& getCurrentThreadExecutor();
+// Get the executor for the current thread's event loop.  Throws if the thread has no loop.
+
 }  // namespace kj
 
 #include "async-inl.h"
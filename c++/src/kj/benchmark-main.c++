@@ -0,0 +1,166 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// The main program for running benchmarks defined with KJ_BENCHMARK.  Link it together with the
+// files defining the benchmarks.  It replaces the global operator new in order to count
+// allocations, which is why it isn't part of the library.
+
+#include "benchmark.h"
+#include "main.h"
+#include "string.h"
+#include "vector.h"
+#include "io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <new>
+
+void* operator new(size_t size) {
+  kj::Benchmark::countAllocation();
+  void* result = malloc(size);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+namespace kj {
+namespace {
+
+class BenchmarkMain {
+public:
+  explicit BenchmarkMain(ProcessContext& context): context(context) {}
+
+  MainFunc getMain() {
+    return MainBuilder(context, "KJ benchmarks",
+          "Runs the benchmarks linked into this program, printing the cost of one iteration of "
+          "each:  wall time, time-stamp counter cycles (x86 only) and heap allocations.  If "
+          "<filter>s are given, only runs benchmarks whose names contain one of them.")
+        .addOption({'l', "list"}, KJ_BIND_METHOD(*this, setList),
+                   "List the benchmarks instead of running them.")
+        .addOptionWithArg({'t', "min-time"}, KJ_BIND_METHOD(*this, setMinTime), "<ms>",
+                          "Time each benchmark for at least <ms> milliseconds.  Default: 100.")
+        .addOption({"csv"}, KJ_BIND_METHOD(*this, setCsv),
+                   "Print comma-separated values, for comparing runs over time.")
+        .expectZeroOrMoreArgs("<filter>", KJ_BIND_METHOD(*this, addFilter))
+        .callAfterParsing(KJ_BIND_METHOD(*this, run))
+        .build();
+  }
+
+private:
+  ProcessContext& context;
+  bool list = false;
+  bool csv = false;
+  uint64_t minNanoseconds = Benchmark::DEFAULT_MIN_NANOSECONDS;
+  Vector<StringPtr> filters;
+
+  MainBuilder::Validity setList() {
+    list = true;
+    return true;
+  }
+
+  MainBuilder::Validity setCsv() {
+    csv = true;
+    return true;
+  }
+
+  MainBuilder::Validity setMinTime(StringPtr ms) {
+    char* end;
+    uint64_t value = strtoull(ms.cStr(), &end, 0);
+    if (ms.size() == 0 || *end != '\0') {
+      return "not an integer";
+    }
+    minNanoseconds = value * 1000000;
+    return true;
+  }
+
+  MainBuilder::Validity addFilter(StringPtr filter) {
+    filters.add(filter);
+    return true;
+  }
+
+  bool matches(const Benchmark& benchmark) {
+    if (filters.size() == 0) return true;
+    for (auto& filter: filters) {
+      if (strstr(benchmark.getName(), filter.cStr()) != nullptr) return true;
+    }
+    return false;
+  }
+
+  MainBuilder::Validity run() {
+    FdOutputStream out(STDOUT_FILENO);
+
+    if (!list) {
+      char line[256];
+      if (csv) {
+        snprintf(line, sizeof(line), "name,iterations,ns,cycles,allocations\n");
+      } else {
+        snprintf(line, sizeof(line), "%-40s %12s %12s %12s %10s\n",
+                 "benchmark", "iterations", "ns/iter", "cycles/iter", "allocs");
+      }
+      out.write(line, strlen(line));
+    }
+
+    for (Benchmark* benchmark = Benchmark::getFirst(); benchmark != nullptr;
+         benchmark = benchmark->getNext()) {
+      if (!matches(*benchmark)) continue;
+
+      if (list) {
+        auto text = str(benchmark->getName(), "  (", benchmark->getFile(), ":",
+                        benchmark->getLine(), ")\n");
+        out.write(text.begin(), text.size());
+        continue;
+      }
+
+      auto result = benchmark->measure(minNanoseconds);
+
+      char line[256];
+      if (csv) {
+        snprintf(line, sizeof(line), "%s,%llu,%.3f,%.3f,%.3f\n", benchmark->getName(),
+                 (unsigned long long)result.iterations,
+                 result.perIteration(result.nanoseconds),
+                 result.perIteration(result.cycles),
+                 result.perIteration(result.allocations));
+      } else {
+        snprintf(line, sizeof(line), "%-40s %12llu %12.2f %12.2f %10.2f\n", benchmark->getName(),
+                 (unsigned long long)result.iterations,
+                 result.perIteration(result.nanoseconds),
+                 result.perIteration(result.cycles),
+                 result.perIteration(result.allocations));
+      }
+      out.write(line, strlen(line));
+    }
+
+    return true;
+  }
+};
+
+}  // namespace
+}  // namespace kj
+
+KJ_MAIN(kj::BenchmarkMain);
@@ -0,0 +1,85 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "benchmark.h"
+#include "debug.h"
+#include "string.h"
+#include <gtest/gtest.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace kj {
+namespace {
+
+uint64_t countedIterations = 0;
+
+KJ_BENCHMARK(BenchmarkTest::Counted) {
+  for (uint64_t i = 0; i < iterations; i++) {
+    Benchmark::countAllocation();
+  }
+  countedIterations += iterations;
+}
+
+KJ_BENCHMARK(BenchmarkTest::SlowSetup) {
+  usleep(5000);
+  Benchmark::resetTimer();
+  for (uint64_t i = 0; i < iterations; i++) {
+    doNotOptimize(i);
+  }
+}
+
+Benchmark& find(const char* name) {
+  for (Benchmark* benchmark = Benchmark::getFirst(); benchmark != nullptr;
+       benchmark = benchmark->getNext()) {
+    if (strcmp(benchmark->getName(), name) == 0) {
+      return *benchmark;
+    }
+  }
+  KJ_FAIL_ASSERT("benchmark not registered", name);
+}
+
+TEST(Benchmark, Registered) {
+  Benchmark& benchmark = find("BenchmarkTest::Counted");
+  EXPECT_TRUE(StringPtr(benchmark.getFile()).endsWith("benchmark-test.c++"));
+  EXPECT_EQ(&find("BenchmarkTest::SlowSetup"), benchmark.getNext());
+}
+
+TEST(Benchmark, Calibrates) {
+  countedIterations = 0;
+  auto result = find("BenchmarkTest::Counted").measure(1000000);
+
+  // Something this cheap takes many iterations to reach a millisecond, found over several calls.
+  EXPECT_GT(result.iterations, 1000u);
+  EXPECT_GT(countedIterations, result.iterations);
+  EXPECT_GE(result.nanoseconds, 1000000u);
+  EXPECT_EQ(result.iterations, result.allocations);
+}
+
+TEST(Benchmark, ResetTimer) {
+  // Without resetTimer(), the first call alone would exceed the target time.
+  auto result = find("BenchmarkTest::SlowSetup").measure(1000000);
+  EXPECT_GT(result.iterations, 1u);
+}
+
+}  // namespace
+}  // namespace kj
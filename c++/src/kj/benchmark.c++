@@ -0,0 +1,116 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "benchmark.h"
+#include "debug.h"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace kj {
+
+namespace {
+
+Benchmark* firstBenchmark = nullptr;
+Benchmark** benchmarkTail = &firstBenchmark;
+// Constant-initialized, so safe to use from other static initializers.
+
+uint64_t allocationCount = 0;
+
+constexpr uint64_t MAX_ITERATIONS = 1000000000;
+
+uint64_t readClock() {
+  struct timespec ts;
+  KJ_SYSCALL(clock_gettime(CLOCK_MONOTONIC, &ts));
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+uint64_t readCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Start {
+  uint64_t nanoseconds;
+  uint64_t cycles;
+  uint64_t allocations;
+};
+Start start;
+// Readings taken when the measurement in progress started (or was last reset).
+
+}  // namespace
+
+Benchmark::Benchmark(const char* file, uint line, const char* name)
+    : file(file), line(line), name(name) {
+  *benchmarkTail = this;
+  benchmarkTail = &next;
+}
+
+Benchmark* Benchmark::getFirst() {
+  return firstBenchmark;
+}
+
+constexpr uint64_t Benchmark::DEFAULT_MIN_NANOSECONDS;
+
+Benchmark::Result Benchmark::measure(uint64_t minNanoseconds) {
+  uint64_t iterations = 1;
+
+  for (;;) {
+    resetTimer();
+    run(iterations);
+
+    Result result;
+    result.cycles = readCycleCounter() - start.cycles;
+    result.nanoseconds = readClock() - start.nanoseconds;
+    result.allocations = __atomic_load_n(&allocationCount, __ATOMIC_RELAXED) - start.allocations;
+    result.iterations = iterations;
+
+    if (result.nanoseconds >= minNanoseconds || iterations >= MAX_ITERATIONS) {
+      return result;
+    }
+
+    // Predict the count that reaches the target, with some margin so that we usually get there on
+    // the next try, but don't grow by more than 100x at once in case the first runs were unusually
+    // fast (e.g. everything was in cache).
+    double predicted = result.nanoseconds == 0 ? iterations * 100.0
+        : iterations * 1.2 * minNanoseconds / result.nanoseconds;
+    uint64_t next = predicted > iterations * 100.0 ? iterations * 100 : (uint64_t)predicted;
+    iterations = kj::min(kj::max(next, iterations * 2), MAX_ITERATIONS);
+  }
+}
+
+void Benchmark::resetTimer() {
+  start.allocations = __atomic_load_n(&allocationCount, __ATOMIC_RELAXED);
+  start.nanoseconds = readClock();
+  start.cycles = readCycleCounter();
+}
+
+void Benchmark::countAllocation() {
+  __atomic_add_fetch(&allocationCount, 1, __ATOMIC_RELAXED);
+}
+
+}  // namespace kj
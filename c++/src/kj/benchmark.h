@@ -0,0 +1,120 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KJ_BENCHMARK_H_
+#define KJ_BENCHMARK_H_
+
+#include "common.h"
+#include <inttypes.h>
+
+namespace kj {
+
+class Benchmark {
+  // A micro-benchmark, for tracking the cost of individual primitives.  Define one with
+  // KJ_BENCHMARK, which registers it in a global list at static-initialization time:
+  //
+  //     KJ_BENCHMARK(StrConcat) {
+  //       for (uint64_t i = 0; i < iterations; i++) {
+  //         kj::doNotOptimize(kj::str("foo", i));
+  //       }
+  //     }
+  //
+  // The body runs the operation `iterations` times.  measure() calls it with growing counts until
+  // one call takes long enough to time reliably, then reports that call's cost per iteration.  So
+  // setup done at the top of the body is amortized; call resetTimer() after it to exclude it
+  // entirely.
+  //
+  // Benchmarks are run by the program built from kj/benchmark-main.c++, which also counts heap
+  // allocations.  Elsewhere the allocation counts are zero.
+
+public:
+  Benchmark(const char* file, uint line, const char* name);
+  // Adds this benchmark to the global list.  Only for instances with static storage duration, as
+  // created by KJ_BENCHMARK.
+
+  KJ_DISALLOW_COPY(Benchmark);
+
+  virtual void run(uint64_t iterations) = 0;
+
+  inline const char* getName() const { return name; }
+  inline const char* getFile() const { return file; }
+  inline uint getLine() const { return line; }
+
+  inline Benchmark* getNext() const { return next; }
+  static Benchmark* getFirst();
+  // Iterate over all registered benchmarks, in registration order.
+
+  struct Result {
+    uint64_t iterations;
+    uint64_t nanoseconds;
+    uint64_t cycles;
+    // Time-stamp counter ticks, where the CPU has one (x86); zero elsewhere.  The counter runs at a
+    // fixed rate, so this is "reference cycles", unaffected by frequency scaling.
+    uint64_t allocations;
+
+    double perIteration(uint64_t total) const { return (double)total / iterations; }
+  };
+
+  static constexpr uint64_t DEFAULT_MIN_NANOSECONDS = 100 * 1000 * 1000;
+
+  Result measure(uint64_t minNanoseconds = DEFAULT_MIN_NANOSECONDS);
+  // Calibrates the iteration count and returns the measurement of the first call to run() that
+  // takes at least `minNanoseconds` (or that reaches an iteration count of one billion).  Not
+  // thread-safe:  only one benchmark may be measured at a time.
+
+  static void resetTimer();
+  // Called from run() to restart the clock and counters of the measurement in progress,
+  // excluding whatever setup has been done so far.
+
+  static void countAllocation();
+  // Called by the allocation hook in the benchmark program for each heap allocation.
+
+private:
+  const char* file;
+  uint line;
+  const char* name;
+  Benchmark* next = nullptr;
+};
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+  // Makes the compiler assume `value` is used, so that the computation producing it isn't
+  // optimized away.  The value itself isn't touched at run time.
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+#define KJ_BENCHMARK(name) \
+  class KJ_UNIQUE_NAME(Benchmark_): public ::kj::Benchmark { \
+  public: \
+    KJ_UNIQUE_NAME(Benchmark_)(): ::kj::Benchmark(__FILE__, __LINE__, #name) {} \
+    void run(uint64_t iterations) override; \
+  }; \
+  static KJ_UNIQUE_NAME(Benchmark_) KJ_UNIQUE_NAME(benchmark_); \
+  void KJ_UNIQUE_NAME(Benchmark_)::run(uint64_t iterations)
+// Defines and registers a benchmark.  Follow it with the body of the benchmark, which has a
+// `uint64_t iterations` parameter.  The name need not be unique, but only one KJ_BENCHMARK may
+// appear on a given source line.
+
+}  // namespace kj
+
+#endif  // KJ_BENCHMARK_H_
@@ -39,7 +39,8 @@
 //   `ERROR`, or `FATAL`.  By default, `INFO` logs are not written, but for command-line apps the
 //   user should be able to pass a flag like `--verbose` to enable them.  Other log levels are
 //   enabled by default.  Log messages -- like exceptions -- can be intercepted by registering an
-//   ExceptionCallback.
+//   ExceptionCallback.  kj::BufferedLogSink (log-sink.h) is one that moves the writing to a
+//   background thread.
 //
 // * `KJ_DBG(...)`:  Like `KJ_LOG`, but intended specifically for temporary log lines added while
 //   debugging a particular problem.  Calls to `KJ_DBG` should always be deleted before committing
@@ -129,6 +129,59 @@ TEST(Exception, ScopeSuccessFail) {
 }
 #endif
 
+#if __linux__ || __APPLE__
+// Only these platforms capture stack traces at all.
+
+uint traceCount(Exception::Nature nature) {
+  return Exception(nature, Exception::Durability::PERMANENT, __FILE__, __LINE__)
+      .getStackTrace().size();
+}
+
+TEST(Exception, BacktracePolicy) {
+  EXPECT_TRUE(getBacktracePolicy() == BacktracePolicy::ALWAYS);
+  EXPECT_GT(traceCount(Exception::Nature::PRECONDITION), 0u);
+
+  setBacktracePolicy(BacktracePolicy::NEVER);
+  EXPECT_EQ(0u, traceCount(Exception::Nature::PRECONDITION));
+  EXPECT_EQ(0u, traceCount(Exception::Nature::LOCAL_BUG));
+
+  setBacktracePolicy(BacktracePolicy::LOCAL_BUGS_ONLY);
+  EXPECT_EQ(0u, traceCount(Exception::Nature::PRECONDITION));
+  EXPECT_EQ(0u, traceCount(Exception::Nature::NETWORK_FAILURE));
+  EXPECT_GT(traceCount(Exception::Nature::LOCAL_BUG), 0u);
+
+  setBacktracePolicy(BacktracePolicy::SAMPLED, 4);
+  uint traced = 0;
+  for (uint i = 0; i < 20; i++) {
+    if (traceCount(Exception::Nature::PRECONDITION) > 0) ++traced;
+  }
+  EXPECT_EQ(5u, traced);
+
+  setBacktracePolicy(BacktracePolicy::ALWAYS);
+  EXPECT_GT(traceCount(Exception::Nature::PRECONDITION), 0u);
+}
+
+TEST(Exception, NoTrace) {
+  Exception e(Exception::Nature::LOCAL_BUG, Exception::Durability::PERMANENT, __FILE__, __LINE__,
+              heapString("foo"), Exception::NoTrace());
+  EXPECT_EQ(0u, e.getStackTrace().size());
+  EXPECT_EQ("foo", e.getDescription());
+
+  Exception copy = e;
+  EXPECT_EQ(0u, copy.getStackTrace().size());
+}
+
+TEST(Exception, NonKjExceptionsAreNotTraced) {
+  // runCatchingExceptions() catches these after the throw site has unwound, so it doesn't trace.
+  KJ_IF_MAYBE(e, kj::runCatchingExceptions([]() { throw std::bad_alloc(); })) {
+    EXPECT_EQ(0u, e->getStackTrace().size());
+  } else {
+    ADD_FAILURE() << "Expected exception";
+  }
+}
+
+#endif  // __linux__ || __APPLE__
+
 }  // namespace
 }  // namespace _ (private)
 }  // namespace kj
@@ -175,28 +175,68 @@ String KJ_STRINGIFY(const Exception& e) {
              getStackSymbols(e.getStackTrace()));
 }
 
+namespace {
+
+uint backtracePolicy = static_cast<uint>(BacktracePolicy::ALWAYS);
+uint backtraceSampleInterval = 100;
+// Accessed atomically, since the policy may be changed while other threads are throwing.
+
+static __thread uint backtraceSampleCounter = 0;
+
+uint captureBacktrace(Exception::Nature nature, void** trace, uint maxCount) {
+#ifndef KJ_HAS_BACKTRACE
+  return 0;
+#else
+  switch (static_cast<BacktracePolicy>(__atomic_load_n(&backtracePolicy, __ATOMIC_RELAXED))) {
+    case BacktracePolicy::ALWAYS:
+      break;
+    case BacktracePolicy::LOCAL_BUGS_ONLY:
+      if (nature != Exception::Nature::LOCAL_BUG) return 0;
+      break;
+    case BacktracePolicy::SAMPLED:
+      if (backtraceSampleCounter++ % __atomic_load_n(&backtraceSampleInterval, __ATOMIC_RELAXED)
+          != 0) {
+        return 0;
+      }
+      break;
+    case BacktracePolicy::NEVER:
+      return 0;
+  }
+  return backtrace(trace, maxCount);
+#endif
+}
+
+}  // namespace
+
+void setBacktracePolicy(BacktracePolicy policy, uint sampleInterval) {
+  KJ_REQUIRE(sampleInterval > 0, "sampleInterval must be positive.") { return; }
+  __atomic_store_n(&backtraceSampleInterval, sampleInterval, __ATOMIC_RELAXED);
+  __atomic_store_n(&backtracePolicy, static_cast<uint>(policy), __ATOMIC_RELAXED);
+}
+
+BacktracePolicy getBacktracePolicy() {
+  return static_cast<BacktracePolicy>(__atomic_load_n(&backtracePolicy, __ATOMIC_RELAXED));
+}
+
 Exception::Exception(Nature nature, Durability durability, const char* file, int line,
                      String description) noexcept
     : file(file), line(line), nature(nature), durability(durability),
       description(mv(description)) {
-#ifndef KJ_HAS_BACKTRACE
-  traceCount = 0;
-#else
-  traceCount = backtrace(trace, 16);
-#endif
+  traceCount = captureBacktrace(nature, trace, 16);
 }
 
 Exception::Exception(Nature nature, Durability durability, String file, int line,
                      String description) noexcept
     : ownFile(kj::mv(file)), file(ownFile.cStr()), line(line), nature(nature),
       durability(durability), description(mv(description)) {
-#ifndef KJ_HAS_BACKTRACE
-  traceCount = 0;
-#else
-  traceCount = backtrace(trace, 16);
-#endif
+  traceCount = captureBacktrace(nature, trace, 16);
 }
 
+Exception::Exception(Nature nature, Durability durability, const char* file, int line,
+                     String description, NoTrace) noexcept
+    : file(file), line(line), nature(nature), durability(durability),
+      description(mv(description)), traceCount(0) {}
+
 Exception::Exception(const Exception& other) noexcept
     : file(other.file), line(other.line), nature(other.nature), durability(other.durability),
       description(heapString(other.description)), traceCount(other.traceCount) {
@@ -442,11 +482,13 @@ Maybe<Exception> runCatchingExceptions(Runnable& runnable) noexcept {
   } catch (Exception& e) {
     return kj::mv(e);
   } catch (std::exception& e) {
+    // The throw site is gone by now, so a trace would only show this function's caller.  Skip
+    // it:  the promise machinery runs every callback through here.
     return Exception(Exception::Nature::OTHER, Exception::Durability::PERMANENT,
-                     "(unknown)", -1, str("std::exception: ", e.what()));
+                     "(unknown)", -1, str("std::exception: ", e.what()), Exception::NoTrace());
   } catch (...) {
     return Exception(Exception::Nature::OTHER, Exception::Durability::PERMANENT,
-                     "(unknown)", -1, str("Unknown non-KJ exception."));
+                     "(unknown)", -1, str("Unknown non-KJ exception."), Exception::NoTrace());
   }
 #endif
 }
@@ -74,6 +74,18 @@ public:
             String description = nullptr) noexcept;
   Exception(Nature nature, Durability durability, String file, int line,
             String description = nullptr) noexcept;
+  // Whether these capture a stack trace is decided by setBacktracePolicy().  The trace has to be
+  // captured here, while the stack still exists; only its symbolization (in KJ_STRINGIFY) is
+  // deferred.  Copies and moves keep the original trace, so an exception passed along a promise
+  // chain -- through then(), fork() and the like -- is never traced again.
+
+  struct NoTrace {};
+  Exception(Nature nature, Durability durability, const char* file, int line,
+            String description, NoTrace) noexcept;
+  // Never captures a stack trace.  For exceptions where the local stack says nothing useful --
+  // errors reported by a remote peer, timeouts, broken capabilities -- and which may be created
+  // at a high rate.
+
   Exception(const Exception& other) noexcept;
   Exception(Exception&& other) = default;
   ~Exception() noexcept;
@@ -125,6 +137,23 @@ private:
   friend class ExceptionImpl;
 };
 
+enum class BacktracePolicy {
+  // When a new Exception captures a stack trace.
+
+  ALWAYS,           // Every exception.  The default.
+  LOCAL_BUGS_ONLY,  // Only exceptions whose nature is LOCAL_BUG.
+  SAMPLED,          // One exception in every `sampleInterval`, counted per thread.
+  NEVER
+};
+
+void setBacktracePolicy(BacktracePolicy policy, uint sampleInterval = 100);
+// Sets the process-wide backtrace policy.  Capturing a backtrace costs a few microseconds, which
+// adds up for a server that routinely reports errors (disconnects, overload, validation failures)
+// as exceptions.  Such servers can turn capture down, typically to LOCAL_BUGS_ONLY, since the
+// trace of an expected error is rarely interesting.  May be called at any time from any thread.
+
+BacktracePolicy getBacktracePolicy();
+
 // TODO(soon):  These should return StringPtr.
 ArrayPtr<const char> KJ_STRINGIFY(Exception::Nature nature);
 ArrayPtr<const char> KJ_STRINGIFY(Exception::Durability durability);
@@ -0,0 +1,154 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "hash.h"
+#include "debug.h"
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <map>
+
+namespace kj {
+namespace {
+
+TEST(HashMap, Basic) {
+  HashMap<uint, int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.find(1) == nullptr);
+  EXPECT_TRUE(map.erase(1) == nullptr);
+
+  map[1] = 10;
+  map[2] = 20;
+  EXPECT_TRUE(map.insert(3, 30));
+  EXPECT_FALSE(map.insert(3, 31));
+  EXPECT_EQ(3u, map.size());
+
+  EXPECT_EQ(10, KJ_ASSERT_NONNULL(map.find(1)));
+  EXPECT_EQ(30, KJ_ASSERT_NONNULL(map.find(3)));
+  EXPECT_EQ(20, map[2]);
+  EXPECT_EQ(0, map[4]);
+  EXPECT_EQ(4u, map.size());
+
+  EXPECT_EQ(20, KJ_ASSERT_NONNULL(map.erase(2)));
+  EXPECT_TRUE(map.find(2) == nullptr);
+  EXPECT_EQ(3u, map.size());
+
+  int sum = 0;
+  map.forEach([&](uint key, int& value) { sum += key + value; });
+  EXPECT_EQ(1 + 10 + 3 + 30 + 4, sum);
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.find(1) == nullptr);
+}
+
+TEST(HashMap, FindingDoesNotGrow) {
+  // Six entries is the most a table of eight holds.  Looking up one of them with operator[] or
+  // insert() must not grow the table, as a seventh entry would.
+  HashMap<uint, int> map;
+  for (uint i = 0; i < 6; i++) {
+    map[i] = i;
+  }
+  EXPECT_EQ(8u, map.capacity());
+
+  map[3] = 30;
+  EXPECT_FALSE(map.insert(4, 40));
+  EXPECT_EQ(8u, map.capacity());
+  EXPECT_EQ(30, map[3]);
+  EXPECT_EQ(4, map[4]);
+
+  map[6] = 6;
+  EXPECT_EQ(16u, map.capacity());
+  EXPECT_EQ(7u, map.size());
+  for (uint i = 0; i < 7; i++) {
+    EXPECT_TRUE(map.find(i) != nullptr);
+  }
+}
+
+TEST(HashMap, PointerKeysAndOwnValues) {
+  int objects[64];
+  HashMap<int*, Own<int>> map;
+  for (auto& obj: objects) {
+    map[&obj] = heap<int>(&obj - objects);
+  }
+  EXPECT_EQ(64u, map.size());
+
+  for (auto i: indices(objects)) {
+    EXPECT_EQ(int(i), *KJ_ASSERT_NONNULL(map.find(objects + i)));
+  }
+
+  KJ_IF_MAYBE(released, map.erase(objects + 5)) {
+    EXPECT_EQ(5, **released);
+  } else {
+    ADD_FAILURE() << "erase() should have returned the value.";
+  }
+  EXPECT_TRUE(map.find(objects + 5) == nullptr);
+  EXPECT_EQ(63u, map.size());
+}
+
+TEST(HashMap, Churn) {
+  // Randomly insert and erase against std::map to exercise collisions, growth, and
+  // backward-shift deletion.
+
+  HashMap<uint, uint> map;
+  std::map<uint, uint> reference;
+  srand(1234);
+
+  for (uint i = 0; i < 20000; i++) {
+    // Small key space so that probe runs get long and erasures hit them.
+    uint key = rand() % 512;
+    if (rand() % 3 == 0) {
+      auto iter = reference.find(key);
+      auto erased = map.erase(key);
+      if (iter == reference.end()) {
+        EXPECT_TRUE(erased == nullptr);
+      } else {
+        EXPECT_EQ(iter->second, KJ_ASSERT_NONNULL(erased));
+        reference.erase(iter);
+      }
+    } else {
+      map[key] = i;
+      reference[key] = i;
+    }
+    ASSERT_EQ(reference.size(), map.size());
+  }
+
+  for (uint key = 0; key < 512; key++) {
+    auto iter = reference.find(key);
+    KJ_IF_MAYBE(value, map.find(key)) {
+      ASSERT_TRUE(iter != reference.end());
+      EXPECT_EQ(iter->second, *value);
+    } else {
+      EXPECT_TRUE(iter == reference.end());
+    }
+  }
+
+  size_t visited = 0;
+  map.forEach([&](uint key, uint& value) {
+    ++visited;
+    EXPECT_EQ(reference[key], value);
+  });
+  EXPECT_EQ(reference.size(), visited);
+}
+
+}  // namespace
+}  // namespace kj
@@ -0,0 +1,268 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KJ_HASH_H_
+#define KJ_HASH_H_
+
+#include "array.h"
+
+namespace kj {
+
+namespace _ {  // private
+
+inline uint hashMix(unsigned long long x) {
+  // Finalizer from MurmurHash3.  Scrambles all input bits into the low bits, which is what
+  // matters since HashMap masks the hash down to the table size.  Pointers and small sequential
+  // integers (the common keys) would otherwise collide badly.
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return static_cast<uint>(x);
+}
+
+}  // namespace _ (private)
+
+template <typename Key>
+struct DefaultHasher {
+  // Hashes integers and enums.  Specialize this (or pass your own hasher to `HashMap`) for other
+  // key types.
+
+  inline uint operator()(const Key& key) const {
+    return _::hashMix(static_cast<unsigned long long>(key));
+  }
+};
+
+template <typename T>
+struct DefaultHasher<T*> {
+  inline uint operator()(T* key) const {
+    return _::hashMix(reinterpret_cast<unsigned long long>(key));
+  }
+};
+
+template <typename Key, typename Value, typename Hasher = DefaultHasher<Key>>
+class HashMap {
+  // Hash map using open addressing with linear probing, similar to std::unordered_map but based
+  // on the KJ framework.  All entries live in a single flat array, so inserting does not allocate
+  // (except to grow the table) and lookups touch contiguous memory.
+  //
+  // Unlike std::unordered_map, references to values are invalidated by any insertion or erasure,
+  // because entries move around within the array.  Don't hold a reference across either.
+  //
+  // Key and Value must be default-constructible and movable.  Erased slots are reset to
+  // default-constructed values, so that e.g. an `Own<T>` value does not linger.
+  //
+  // Erasure uses backward-shift deletion rather than tombstones, so lookup cost does not degrade
+  // as entries churn.
+
+public:
+  inline HashMap() = default;
+  inline explicit HashMap(size_t capacity) { rehash(capacityFor(capacity)); }
+
+  KJ_DISALLOW_COPY(HashMap);
+  inline HashMap(HashMap&& other) noexcept
+      : entries(kj::mv(other.entries)), count(other.count) { other.count = 0; }
+  inline HashMap& operator=(HashMap&& other) {
+    entries = kj::mv(other.entries);
+    count = other.count;
+    other.count = 0;
+    return *this;
+  }
+
+  inline size_t size() const { return count; }
+  inline bool empty() const { return count == 0; }
+  inline size_t capacity() const { return entries.size(); }
+
+  Maybe<Value&> find(const Key& key) {
+    KJ_IF_MAYBE(index, findIndex(key)) {
+      return entries[*index].value;
+    } else {
+      return nullptr;
+    }
+  }
+  Maybe<const Value&> find(const Key& key) const {
+    KJ_IF_MAYBE(index, findIndex(key)) {
+      return entries[*index].value;
+    } else {
+      return nullptr;
+    }
+  }
+
+  Value& operator[](const Key& key) {
+    // Returns the value for `key`, inserting a default-constructed value if it is not present.
+
+    return entries[findOrInsert(key)].value;
+  }
+
+  bool insert(const Key& key, Value&& value) {
+    // Inserts the entry if `key` is not already present.  Returns false (and leaves the map
+    // unchanged) if it was.
+
+    size_t oldCount = count;
+    size_t index = findOrInsert(key);
+    if (count == oldCount) return false;
+    entries[index].value = kj::mv(value);
+    return true;
+  }
+
+  Maybe<Value> erase(const Key& key) {
+    // Removes the entry and returns its value, or null if the key was not present.  The value is
+    // returned so that the caller can choose when to destroy it; by the time it is destroyed, the
+    // map is consistent again, so its destructor may safely come back and modify the map.
+
+    KJ_IF_MAYBE(index, findIndex(key)) {
+      Value result = kj::mv(entries[*index].value);
+      eraseAt(*index);
+      return kj::mv(result);
+    } else {
+      return nullptr;
+    }
+  }
+
+  template <typename Func>
+  void forEach(Func&& func) {
+    // Calls func(const Key&, Value&) for each entry, in unspecified order.  `func` must not insert
+    // or erase entries.
+
+    for (auto& entry: entries) {
+      if (entry.occupied) func(static_cast<const Key&>(entry.key), entry.value);
+    }
+  }
+  template <typename Func>
+  void forEach(Func&& func) const {
+    for (auto& entry: entries) {
+      if (entry.occupied) func(entry.key, entry.value);
+    }
+  }
+
+  void clear() {
+    entries = nullptr;
+    count = 0;
+  }
+
+private:
+  struct Entry {
+    Key key;
+    Value value;
+    bool occupied = false;
+  };
+
+  Array<Entry> entries;
+  // Size is always zero or a power of two.
+
+  size_t count = 0;
+
+  static size_t capacityFor(size_t size) {
+    // Smallest power of two which keeps `size` entries below the maximum load factor of 3/4.
+    size_t result = 8;
+    while (result * 3 < size * 4) result *= 2;
+    return result;
+  }
+
+  inline size_t mask() const { return entries.size() - 1; }
+  inline size_t home(const Key& key) const { return Hasher()(key) & mask(); }
+
+  Maybe<size_t> findIndex(const Key& key) const {
+    if (count == 0) return nullptr;
+    for (size_t i = home(key);; i = (i + 1) & mask()) {
+      const Entry& entry = entries[i];
+      if (!entry.occupied) return nullptr;
+      if (entry.key == key) return i;
+    }
+  }
+
+  size_t probe(const Key& key) const {
+    // Returns the slot holding `key`, or else the empty slot where it would go.  The table must
+    // not be empty.
+    for (size_t i = home(key);; i = (i + 1) & mask()) {
+      const Entry& entry = entries[i];
+      if (!entry.occupied || entry.key == key) return i;
+    }
+  }
+
+  size_t findOrInsert(const Key& key) {
+    // Looks the key up before checking the load factor, so that finding an existing key never
+    // grows the table.
+    bool needsGrowth = (count + 1) * 4 > entries.size() * 3;
+    if (entries.size() > 0) {
+      size_t i = probe(key);
+      if (entries[i].occupied) return i;
+      if (!needsGrowth) return claim(i, key);
+    }
+
+    rehash(entries.size() == 0 ? 8 : entries.size() * 2);
+    return claim(probe(key), key);
+  }
+
+  size_t claim(size_t index, const Key& key) {
+    Entry& entry = entries[index];
+    entry.key = key;
+    entry.occupied = true;
+    ++count;
+    return index;
+  }
+
+  void eraseAt(size_t hole) {
+    // Shift back any following entries in the same probe run that would no longer be reachable
+    // with `hole` empty.
+
+    for (size_t i = (hole + 1) & mask(); entries[i].occupied; i = (i + 1) & mask()) {
+      // An entry can fill the hole only if its home slot is cyclically outside (hole, i].
+      size_t h = home(entries[i].key);
+      if (((i - h) & mask()) >= ((i - hole) & mask())) {
+        entries[hole].key = kj::mv(entries[i].key);
+        entries[hole].value = kj::mv(entries[i].value);
+        hole = i;
+      }
+    }
+
+    Entry& entry = entries[hole];
+    entry.key = Key();
+    entry.value = Value();
+    entry.occupied = false;
+    --count;
+  }
+
+  void rehash(size_t newCapacity) {
+    Array<Entry> oldEntries = kj::mv(entries);
+    entries = heapArray<Entry>(newCapacity);
+    for (auto& entry: oldEntries) {
+      if (entry.occupied) {
+        for (size_t i = home(entry.key);; i = (i + 1) & mask()) {
+          Entry& slot = entries[i];
+          if (!slot.occupied) {
+            slot.key = kj::mv(entry.key);
+            slot.value = kj::mv(entry.value);
+            slot.occupied = true;
+            break;
+          }
+        }
+      }
+    }
+  }
+};
+
+}  // namespace kj
+
+#endif  // KJ_HASH_H_
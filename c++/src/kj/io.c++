@@ -25,6 +25,7 @@
 #include "debug.h"
 #include <unistd.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
 #include <algorithm>
 #include <errno.h>
 
@@ -232,6 +233,13 @@ void ArrayOutputStream::write(const void* src, size_t size) {
 
 // =======================================================================================
 
+const MmapDisposer MmapDisposer::instance = MmapDisposer();
+
+void MmapDisposer::disposeImpl(void* firstElement, size_t elementSize, size_t elementCount,
+                               size_t capacity, void (*destroyElement)(void*)) const {
+  munmap(firstElement, elementSize * elementCount);
+}
+
 AutoCloseFd::~AutoCloseFd() noexcept(false) {
   if (fd >= 0) {
     unwindDetector.catchExceptionsIfUnwinding([&]() {
@@ -251,6 +251,18 @@ private:
   UnwindDetector unwindDetector;
 };
 
+class MmapDisposer: public ArrayDisposer {
+  // An ArrayDisposer that munmap()s the array, for wrapping the result of mmap() in an Array.
+  // The array must cover exactly the mapped range.
+
+public:
+  static const MmapDisposer instance;
+
+protected:
+  void disposeImpl(void* firstElement, size_t elementSize, size_t elementCount,
+                   size_t capacity, void (*destroyElement)(void*)) const override;
+};
+
 class FdInputStream: public InputStream {
   // An InputStream wrapping a file descriptor.
 
@@ -0,0 +1,193 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Benchmarks for basic KJ facilities.  Run them with the capnp-bench program.
+
+#include "benchmark.h"
+#include "string.h"
+#include "vector.h"
+#include "async.h"
+#include "hash.h"
+#include <unordered_map>
+
+namespace kj {
+namespace {
+
+KJ_BENCHMARK(kj::str (3 pieces)) {
+  for (uint64_t i = 0; i < iterations; i++) {
+    doNotOptimize(str("foo", i, "bar"));
+  }
+}
+
+KJ_BENCHMARK(Vector::add (growing)) {
+  // A new vector every 4096 adds, so the cost includes reallocating as it grows.
+  Vector<uint64_t> vector;
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    if (i % 4096 == 0) {
+      vector = Vector<uint64_t>();
+    }
+    vector.add(i);
+    doNotOptimize(vector);
+  }
+}
+
+KJ_BENCHMARK(Promise::then (10-link chain)) {
+  // Per iteration: build a chain of ten continuations on a ready promise and wait for it.
+  EventLoop loop;
+  WaitScope waitScope(loop);
+  Benchmark::resetTimer();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    Promise<uint64_t> promise = i;
+    for (uint j = 0; j < 10; j++) {
+      promise = promise.then([](uint64_t value) { return value + 1; });
+    }
+    doNotOptimize(promise.wait(waitScope));
+  }
+}
+
+KJ_BENCHMARK(Promise::then (per link)) {
+  // Per iteration: one continuation, on chains of 64 that are waited on as they fill up.  The
+  // allocation column shows whether promise nodes come from the EventLoop's free lists:  it is
+  // zero when they do, and a little over one (the node, plus the chain's ready promise) when they
+  // don't.
+  constexpr uint CHAIN_LENGTH = 64;
+
+  EventLoop loop;
+  WaitScope waitScope(loop);
+  Benchmark::resetTimer();
+
+  for (uint64_t done = 0; done < iterations; done += CHAIN_LENGTH) {
+    uint count = kj::min(iterations - done, uint64_t(CHAIN_LENGTH));
+    Promise<uint64_t> promise = done;
+    for (uint j = 0; j < count; j++) {
+      promise = promise.then([](uint64_t value) { return value + 1; });
+    }
+    doNotOptimize(promise.wait(waitScope));
+  }
+}
+
+class NullErrorHandler: public TaskSet::ErrorHandler {
+public:
+  void taskFailed(Exception&& exception) override {}
+};
+
+KJ_BENCHMARK(TaskSet::add (out-of-order completion)) {
+  // Per iteration: add a task to a TaskSet and later complete it.  Tasks are added in batches of
+  // 4096, then completed in an order that unlinks from both ends and the middle of the task list:
+  // even-numbered ones first, then the rest in reverse.
+  constexpr uint BATCH_SIZE = 4096;
+
+  EventLoop loop;
+  WaitScope waitScope(loop);
+  NullErrorHandler errorHandler;
+  TaskSet tasks(errorHandler);
+  Benchmark::resetTimer();
+
+  for (uint64_t done = 0; done < iterations; done += BATCH_SIZE) {
+    uint count = kj::min(iterations - done, uint64_t(BATCH_SIZE));
+    auto fulfillers = heapArrayBuilder<Own<PromiseFulfiller<void>>>(count);
+    for (uint i = 0; i < count; i++) {
+      auto paf = newPromiseAndFulfiller<void>();
+      tasks.add(kj::mv(paf.promise));
+      fulfillers.add(kj::mv(paf.fulfiller));
+    }
+
+    for (uint i = 0; i < count; i += 2) {
+      fulfillers[i]->fulfill();
+    }
+    for (uint i = count / 2; i > 0; i--) {
+      fulfillers[2 * i - 1]->fulfill();
+    }
+    evalLater([]() {}).wait(waitScope);
+  }
+}
+
+constexpr uint LIVE_EXPORTS = 4096;
+// The hash map benchmarks model an RPC connection's export table (exportsByCap):  pointer keys,
+// thousands of them live at once.
+
+Array<int> exportTargets() {
+  // Stand-ins for ClientHook objects; only their addresses are used, as keys.
+  return heapArray<int>(LIVE_EXPORTS * 2);
+}
+
+KJ_BENCHMARK(HashMap::find (4096 live)) {
+  auto targets = exportTargets();
+  HashMap<int*, uint> map;
+  for (uint i = 0; i < LIVE_EXPORTS; i++) {
+    map[&targets[i]] = i;
+  }
+  Benchmark::resetTimer();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    doNotOptimize(map.find(&targets[i % LIVE_EXPORTS]));
+  }
+}
+
+KJ_BENCHMARK(unordered_map::find (4096 live)) {
+  // Baseline for the above.
+  auto targets = exportTargets();
+  std::unordered_map<int*, uint> map;
+  for (uint i = 0; i < LIVE_EXPORTS; i++) {
+    map[&targets[i]] = i;
+  }
+  Benchmark::resetTimer();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    doNotOptimize(map.find(&targets[i % LIVE_EXPORTS]));
+  }
+}
+
+KJ_BENCHMARK(HashMap insert+erase (4096 live)) {
+  // Per iteration:  export one capability and release another, keeping the table full.
+  auto targets = exportTargets();
+  HashMap<int*, uint> map;
+  for (uint i = 0; i < LIVE_EXPORTS; i++) {
+    map[&targets[i]] = i;
+  }
+  Benchmark::resetTimer();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    map.insert(&targets[(i + LIVE_EXPORTS) % targets.size()], i);
+    doNotOptimize(map.erase(&targets[i % targets.size()]));
+  }
+}
+
+KJ_BENCHMARK(unordered_map insert+erase (4096 live)) {
+  auto targets = exportTargets();
+  std::unordered_map<int*, uint> map;
+  for (uint i = 0; i < LIVE_EXPORTS; i++) {
+    map[&targets[i]] = i;
+  }
+  Benchmark::resetTimer();
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    map.insert(std::make_pair(&targets[(i + LIVE_EXPORTS) % targets.size()], uint(i)));
+    doNotOptimize(map.erase(&targets[i % targets.size()]));
+  }
+}
+
+}  // namespace
+}  // namespace kj
@@ -0,0 +1,161 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "log-sink.h"
+#include "debug.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+
+namespace kj {
+namespace {
+
+class Pipe {
+public:
+  Pipe() {
+    KJ_SYSCALL(pipe(fds));
+    KJ_SYSCALL(fcntl(fds[0], F_SETFL, O_NONBLOCK));
+  }
+  ~Pipe() {
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  int writeEnd() { return fds[1]; }
+
+  std::string readAll() {
+    std::string result;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) {
+      result.append(buffer, n);
+    }
+    return result;
+  }
+
+private:
+  int fds[2];
+};
+
+uint countLines(const std::string& text, const char* needle) {
+  uint result = 0;
+  for (size_t pos = text.find(needle); pos != std::string::npos;
+       pos = text.find(needle, pos + 1)) {
+    ++result;
+  }
+  return result;
+}
+
+BufferedLogSink::Options manualFlush() {
+  BufferedLogSink::Options options;
+  options.flushIntervalMs = 1000000;
+  return options;
+}
+
+TEST(BufferedLogSink, Basic) {
+  Pipe pipe;
+  std::string text;
+
+  {
+    BufferedLogSink sink(pipe.writeEnd(), manualFlush());
+    BufferedLogSink::Callback callback(sink);
+
+    int i = 123;
+    KJ_LOG(WARNING, "hello", i);
+    sink.flush();
+    text = pipe.readAll();
+    EXPECT_NE(std::string::npos, text.find("warning: hello; i = 123\n")) << text;
+
+    KJ_LOG(ERROR, "written at destruction");
+  }
+
+  text = pipe.readAll();
+  EXPECT_NE(std::string::npos, text.find("error: written at destruction\n")) << text;
+}
+
+TEST(BufferedLogSink, BackgroundFlush) {
+  Pipe pipe;
+  BufferedLogSink::Options options;
+  options.flushIntervalMs = 1;
+  BufferedLogSink sink(pipe.writeEnd(), options);
+
+  {
+    BufferedLogSink::Callback callback(sink);
+    KJ_LOG(WARNING, "background");
+  }
+
+  std::string text;
+  for (uint i = 0; i < 1000 && text.empty(); i++) {
+    usleep(1000);
+    text = pipe.readAll();
+  }
+  EXPECT_NE(std::string::npos, text.find("warning: background\n")) << text;
+}
+
+TEST(BufferedLogSink, Overflow) {
+  Pipe pipe;
+  BufferedLogSink::Options options = manualFlush();
+  options.ringSize = 4;
+  BufferedLogSink sink(pipe.writeEnd(), options);
+
+  {
+    BufferedLogSink::Callback callback(sink);
+    for (uint i = 0; i < 20; i++) {
+      KJ_LOG(WARNING, "overflow", i);
+    }
+  }
+  sink.flush();
+
+  // The flusher may have been woken to drain part of the ring, so how many are dropped depends
+  // on timing, but nothing is lost without being counted.
+  std::string text = pipe.readAll();
+  EXPECT_EQ(20u, countLines(text, "warning: overflow") + sink.getDroppedCount()) << text;
+  if (sink.getDroppedCount() > 0) {
+    EXPECT_NE(std::string::npos, text.find("dropped because the buffer was full")) << text;
+  }
+}
+
+TEST(BufferedLogSink, RateLimit) {
+  Pipe pipe;
+  BufferedLogSink::Options options = manualFlush();
+  options.maxPerSitePerSecond = 3;
+  BufferedLogSink sink(pipe.writeEnd(), options);
+
+  {
+    BufferedLogSink::Callback callback(sink);
+    for (uint i = 0; i < 10; i++) {
+      KJ_LOG(WARNING, "limited");
+    }
+    KJ_LOG(WARNING, "other site");
+  }
+  sink.flush();
+
+  std::string text = pipe.readAll();
+  EXPECT_EQ(3u, countLines(text, "warning: limited")) << text;
+  EXPECT_EQ(1u, countLines(text, "warning: other site")) << text;
+  EXPECT_EQ(0u, sink.getDroppedCount());
+}
+
+}  // namespace
+}  // namespace kj
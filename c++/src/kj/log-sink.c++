@@ -0,0 +1,293 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "log-sink.h"
+#include "debug.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>
+
+namespace kj {
+
+struct BufferedLogSink::Ring {
+  // Single-producer, single-consumer queue of messages.  The producer is the thread that owns the
+  // Callback; the consumer is whoever holds the `state` lock.
+
+  Array<String> slots;
+
+  uint64_t head = 0;
+  // Next slot to fill.  Advanced only by the producer.
+
+  uint64_t tail = 0;
+  // Next slot to write out.  Advanced only by the consumer.
+
+  uint64_t dropped = 0;
+  // Messages dropped because the ring was full.  Advanced only by the producer.
+
+  uint64_t droppedReported = 0;
+  // Consumer only.
+
+  bool closed = false;
+  // Set by the producer when its Callback is destroyed.  The consumer frees the ring once it has
+  // drained it.
+
+  explicit Ring(uint size): slots(heapArray<String>(size)) {}
+};
+
+namespace {
+
+uint roundUpToPowerOfTwo(uint n) {
+  uint result = 1;
+  while (result < n) result <<= 1;
+  return result;
+}
+
+int64_t monotonicMillis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return int64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+void writeAll(int fd, ArrayPtr<const String> messages) {
+  // Writes all of `messages` with one write() where possible.  Errors are ignored: there is
+  // nowhere left to report them.
+
+  size_t size = 0;
+  for (auto& message: messages) size += message.size();
+  if (size == 0) return;
+
+  auto buffer = heapArray<char>(size);
+  char* pos = buffer.begin();
+  for (auto& message: messages) {
+    memcpy(pos, message.begin(), message.size());
+    pos += message.size();
+  }
+
+  ArrayPtr<const char> remaining = buffer;
+  while (remaining.size() > 0) {
+    ssize_t n = write(fd, remaining.begin(), remaining.size());
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return;
+    remaining = remaining.slice(n, remaining.size());
+  }
+}
+
+}  // namespace
+
+BufferedLogSink::BufferedLogSink(int fd): BufferedLogSink(fd, Options()) {}
+
+BufferedLogSink::BufferedLogSink(int fd, Options options)
+    : fd(fd), options(options), ringSize(roundUpToPowerOfTwo(kj::max(options.ringSize, 1u))) {
+  int fds[2];
+#if __linux__
+  KJ_SYSCALL(pipe2(fds, O_NONBLOCK | O_CLOEXEC));
+#else
+  KJ_SYSCALL(pipe(fds));
+#endif
+  wakeRead = fds[0];
+  wakeWrite = fds[1];
+  KJ_ON_SCOPE_FAILURE({
+    close(wakeRead);
+    close(wakeWrite);
+  });
+#if !__linux__
+  KJ_SYSCALL(fcntl(wakeRead, F_SETFL, O_NONBLOCK));
+  KJ_SYSCALL(fcntl(wakeWrite, F_SETFL, O_NONBLOCK));
+#endif
+
+  flusher = heap<Thread>([this]() { run(); });
+}
+
+BufferedLogSink::~BufferedLogSink() noexcept(false) {
+  __atomic_store_n(&shuttingDown, true, __ATOMIC_RELAXED);
+  wake();
+  KJ_DEFER({
+    close(wakeRead);
+    close(wakeWrite);
+  });
+  flusher = nullptr;
+
+  auto lock = state.lockExclusive();
+  drain(*lock);
+  KJ_ASSERT(lock->rings.empty(), "BufferedLogSink destroyed while Callbacks still use it") {
+    break;
+  }
+}
+
+void BufferedLogSink::flush() const {
+  drain(*state.lockExclusive());
+}
+
+uint64_t BufferedLogSink::getDroppedCount() const {
+  auto lock = state.lockExclusive();
+  uint64_t result = lock->dropped;
+  for (auto& ring: lock->rings) {
+    result += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED) - ring->droppedReported;
+  }
+  return result;
+}
+
+BufferedLogSink::Ring& BufferedLogSink::addRing() {
+  auto ring = heap<Ring>(ringSize);
+  Ring& result = *ring;
+  state.lockExclusive()->rings.add(kj::mv(ring));
+  return result;
+}
+
+void BufferedLogSink::wake() {
+  char c = 0;
+  ssize_t n = write(wakeWrite, &c, 1);
+  // If the pipe is full, a wakeup is already pending.
+  (void)n;
+}
+
+void BufferedLogSink::run() {
+  for (;;) {
+    struct pollfd pollfd;
+    memset(&pollfd, 0, sizeof(pollfd));
+    pollfd.fd = wakeRead;
+    pollfd.events = POLLIN;
+    if (poll(&pollfd, 1, options.flushIntervalMs) > 0) {
+      char buffer[64];
+      while (read(wakeRead, buffer, sizeof(buffer)) > 0) {}
+    }
+
+    bool done = __atomic_load_n(&shuttingDown, __ATOMIC_RELAXED);
+    flush();
+    if (done) return;
+  }
+}
+
+void BufferedLogSink::drain(State& state) const {
+  Vector<String> messages;
+  uint mask = ringSize - 1;
+
+  for (size_t i = 0; i < state.rings.size();) {
+    Ring& ring = *state.rings[i];
+
+    // Read `closed` first, so that if it is set we are sure to see everything pushed before it.
+    bool closed = __atomic_load_n(&ring.closed, __ATOMIC_ACQUIRE);
+    uint64_t head = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+    uint64_t dropped = __atomic_load_n(&ring.dropped, __ATOMIC_RELAXED);
+
+    for (uint64_t pos = ring.tail; pos < head; pos++) {
+      messages.add(kj::mv(ring.slots[pos & mask]));
+    }
+    __atomic_store_n(&ring.tail, head, __ATOMIC_RELEASE);
+
+    if (dropped != ring.droppedReported) {
+      messages.add(str("kj::BufferedLogSink: ", dropped - ring.droppedReported,
+                       " log messages dropped because the buffer was full\n"));
+      state.dropped += dropped - ring.droppedReported;
+      ring.droppedReported = dropped;
+    }
+
+    if (closed) {
+      if (i + 1 < state.rings.size()) {
+        state.rings[i] = kj::mv(state.rings.back());
+      }
+      state.rings.removeLast();
+    } else {
+      ++i;
+    }
+  }
+
+  writeAll(fd, messages);
+}
+
+// =======================================================================================
+
+BufferedLogSink::Callback::Callback(BufferedLogSink& sink): sink(sink), ring(sink.addRing()) {}
+
+BufferedLogSink::Callback::~Callback() noexcept(false) {
+  __atomic_store_n(&ring.closed, true, __ATOMIC_RELEASE);
+}
+
+void BufferedLogSink::Callback::onFatalException(Exception&& exception) {
+  // Whatever was logged leading up to a fatal error is likely relevant, and the process may be
+  // about to die.
+  sink.flush();
+  next.onFatalException(kj::mv(exception));
+}
+
+void BufferedLogSink::Callback::logMessage(
+    const char* file, int line, int contextDepth, String&& text) {
+  if (sink.options.maxPerSitePerSecond != 0 && !allowedBySite(file, line, text)) {
+    return;
+  }
+
+  uint64_t head = ring.head;
+  uint64_t tail = __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE);
+  uint64_t size = ring.slots.size();
+  if (head - tail >= size) {
+    __atomic_store_n(&ring.dropped, ring.dropped + 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  ring.slots[head & (size - 1)] = str(kj::repeat('_', contextDepth), file, ":", line, ": ",
+                                      kj::mv(text));
+  __atomic_store_n(&ring.head, head + 1, __ATOMIC_RELEASE);
+
+  // Occupancy only ever rises by one at a time, so it passes through this value exactly when it
+  // crosses three-quarters full.
+  if (head + 1 - tail == size - size / 4) {
+    sink.wake();
+  }
+}
+
+bool BufferedLogSink::Callback::allowedBySite(const char* file, int line, String& text) {
+  uint hash = uint(reinterpret_cast<uintptr_t>(file) >> 4) ^ (uint(line) * 2654435761u);
+  Site& site = sites[hash % SITE_TABLE_SIZE];
+  int64_t now = monotonicMillis();
+
+  if (site.file != file || site.line != line) {
+    // Either a new site or a collision.  Either way, start over; a collision at worst lets a few
+    // extra messages through.
+    site.file = file;
+    site.line = line;
+    site.windowStart = now;
+    site.count = 0;
+    site.suppressed = 0;
+  } else if (now - site.windowStart >= 1000) {
+    if (site.suppressed > 0) {
+      text = str(kj::mv(text), "(", site.suppressed,
+                 " similar messages were suppressed before this one)\n");
+    }
+    site.windowStart = now;
+    site.count = 0;
+    site.suppressed = 0;
+  }
+
+  if (site.count >= sink.options.maxPerSitePerSecond) {
+    ++site.suppressed;
+    return false;
+  }
+  ++site.count;
+  return true;
+}
+
+}  // namespace kj
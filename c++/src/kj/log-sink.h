@@ -0,0 +1,149 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef KJ_LOG_SINK_H_
+#define KJ_LOG_SINK_H_
+
+#include "exception.h"
+#include "memory.h"
+#include "mutex.h"
+#include "vector.h"
+#include "thread.h"
+#include <inttypes.h>
+
+namespace kj {
+
+class BufferedLogSink {
+  // Takes log output off the threads that produce it.  By default, KJ_LOG() and friends write()
+  // to stderr synchronously, which blocks the calling thread whenever the terminal or pipe on the
+  // other end is slow.  With a BufferedLogSink, each thread instead pushes its messages into its
+  // own lock-free ring buffer and a background thread writes them out in batches.  If a ring is
+  // full, messages are dropped (and counted) rather than blocking the producer.
+  //
+  // To use it, create one BufferedLogSink for the process, then put a BufferedLogSink::Callback on
+  // the stack of each thread that should log through it, typically next to its EventLoop.
+  //
+  // Log arguments are still stringified on the logging thread, since they may refer to state that
+  // is gone by the time the message is written.  What moves to the background thread is the
+  // write() itself, which is where the thread could block.
+
+public:
+  struct Options {
+    uint ringSize = 1024;
+    // Number of messages each thread can have outstanding before new ones are dropped.  Rounded
+    // up to a power of two.
+
+    uint flushIntervalMs = 50;
+    // How often the background thread looks for new messages.  It is also woken early when a
+    // ring becomes three-quarters full.
+
+    uint maxPerSitePerSecond = 0;
+    // If non-zero, each thread writes at most this many messages per second from any single
+    // call site (file and line).  Suppressed messages are counted and the count reported once
+    // the site is allowed to log again.  Zero means no limit.
+  };
+
+  explicit BufferedLogSink(int fd = 2);
+  BufferedLogSink(int fd, Options options);
+  // Messages are written to `fd`, which is not closed.
+
+  KJ_DISALLOW_COPY(BufferedLogSink);
+  ~BufferedLogSink() noexcept(false);
+  // Writes out whatever is still buffered.  All Callbacks must have been destroyed already.
+
+  void flush() const;
+  // Writes out all buffered messages now, on the calling thread.
+
+  uint64_t getDroppedCount() const;
+  // Total number of messages dropped so far because a ring was full.
+
+private:
+  struct Ring;
+
+public:
+  class Callback: public ExceptionCallback {
+    // Routes the calling thread's log messages into `sink`.  Like all ExceptionCallbacks, this
+    // must be allocated on the stack, and applies until it goes out of scope.
+
+  public:
+    explicit Callback(BufferedLogSink& sink);
+    KJ_DISALLOW_COPY(Callback);
+    ~Callback() noexcept(false);
+
+    void onFatalException(Exception&& exception) override;
+    void logMessage(const char* file, int line, int contextDepth, String&& text) override;
+
+  private:
+    struct Site {
+      // Per-call-site rate limiting state.  Call sites are identified by their `file` pointer
+      // and line, which is cheap and is exact for KJ_LOG(), where `file` is always __FILE__.
+
+      const char* file = nullptr;
+      int line = 0;
+      int64_t windowStart = 0;
+      uint count = 0;
+      uint suppressed = 0;
+    };
+
+    static constexpr uint SITE_TABLE_SIZE = 64;
+
+    BufferedLogSink& sink;
+    Ring& ring;
+    Site sites[SITE_TABLE_SIZE];
+
+    bool allowedBySite(const char* file, int line, String& text);
+  };
+
+private:
+  int fd;
+  Options options;
+  uint ringSize;
+
+  struct State {
+    Vector<Own<Ring>> rings;
+    uint64_t dropped = 0;
+    // Drops already reported, including those of rings since retired.
+  };
+
+  MutexGuarded<State> state;
+  // Producers take this lock only to register a new ring.  Draining happens with the lock held,
+  // so that the background thread and flush() never consume from the same ring concurrently.
+
+  int wakeRead;
+  int wakeWrite;
+  // Pipe used to wake the background thread early.
+
+  bool shuttingDown = false;
+
+  Own<Thread> flusher;
+
+  Ring& addRing();
+  void wake();
+  void run();
+  void drain(State& state) const;
+};
+
+}  // namespace kj
+
+#endif  // KJ_LOG_SINK_H_
@@ -28,6 +28,21 @@
 
 namespace kj {
 
+class Disposer;
+class Refcounted;
+
+namespace _ {  // private
+
+template <typename T, bool isRefcounted = __is_base_of(Refcounted, T)>
+struct InlineRelease {
+  // Lets Disposer::dispose() drop a reference to a `Refcounted` object without a virtual call.
+  // Specialized for refcounted types in refcount.h, which any code holding an `Own` of a complete
+  // refcounted type has included.
+  static inline bool tryRelease(T* object, const Disposer& disposer) { return false; }
+};
+
+}  // namespace _ (private)
+
 // =======================================================================================
 // Disposer -- Implementation details.
 
@@ -374,8 +389,10 @@ struct Disposer::Dispose_<T, false> {
 };
 
 template <typename T>
-void Disposer::dispose(T* object) const {
-  Dispose_<T>::dispose(object, *this);
+inline void Disposer::dispose(T* object) const {
+  if (!_::InlineRelease<T>::tryRelease(object, *this)) {
+    Dispose_<T>::dispose(object, *this);
+  }
 }
 
 }  // namespace kj
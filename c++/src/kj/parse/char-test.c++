@@ -215,6 +215,21 @@ TEST(CharParsers, CharGroupCombo) {
   }
 }
 
+TEST(CharParsers, CharGroupContains) {
+  constexpr auto group = charRange('0', '9').orAny("-_").orChar(0xff);
+
+  EXPECT_TRUE(group.contains('0'));
+  EXPECT_TRUE(group.contains('9'));
+  EXPECT_TRUE(group.contains('_'));
+  EXPECT_TRUE(group.contains(0xff));
+  EXPECT_FALSE(group.contains('a'));
+  EXPECT_FALSE(group.contains('\0'));
+  EXPECT_FALSE(group.contains(0xfe));
+
+  EXPECT_FALSE(group.invert().contains('5'));
+  EXPECT_TRUE(group.invert().contains('a'));
+}
+
 TEST(CharParsers, Identifier) {
   constexpr auto parser = identifier;
 
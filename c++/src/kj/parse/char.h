@@ -91,7 +91,7 @@ public:
     return CharGroup_(bits[0] | bit(c),
                       bits[1] | bit(c - 64),
                       bits[2] | bit(c - 128),
-                      bits[3] | bit(c - 256));
+                      bits[3] | bit(c - 192));
   }
 
   constexpr inline CharGroup_ orGroup(CharGroup_ other) const {
@@ -105,11 +105,17 @@ public:
     return CharGroup_(~bits[0], ~bits[1], ~bits[2], ~bits[3]);
   }
 
+  constexpr inline bool contains(unsigned char c) const {
+    return (bits[c / 64] & (1ll << (c % 64))) != 0;
+  }
+  // Tests a single character against the group without going through a parser input.  Useful for
+  // hand-written fast paths that must agree with a grammar built from the same groups.
+
   template <typename Input>
   Maybe<char> operator()(Input& input) const {
     if (input.atEnd()) return nullptr;
     unsigned char c = input.current();
-    if ((bits[c / 64] & (1ll << (c % 64))) != 0) {
+    if (contains(c)) {
       input.next();
       return c;
     } else {
@@ -22,6 +22,8 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "refcount.h"
+#include "thread.h"
+#include "vector.h"
 #include <gtest/gtest.h>
 
 namespace kj {
@@ -54,4 +56,82 @@ TEST(Refcount, Basic) {
 #endif
 }
 
+struct Interface {
+  virtual Own<Interface> addRefAsInterface() = 0;
+};
+
+struct Implementation final: public Interface, public Refcounted {
+  Implementation(bool* ptr): ptr(ptr) {}
+  ~Implementation() { *ptr = true; }
+  Own<Interface> addRefAsInterface() override { return kj::addRef(*this); }
+
+  bool* ptr;
+};
+
+TEST(Refcount, InterfaceRefs) {
+  // Drops through `Own<Implementation>` decrement inline; drops through `Own<Interface>` go
+  // through disposeImpl().  Both must see the same count.
+  bool b = false;
+  Own<Implementation> ref1 = kj::refcounted<Implementation>(&b);
+  Own<Interface> ref2 = ref1->addRefAsInterface();
+  Own<Interface> ref3 = ref2->addRefAsInterface();
+  Own<Implementation> ref4 = kj::addRef(*ref1);
+
+  ref1 = nullptr;
+  EXPECT_FALSE(b);
+  ref2 = nullptr;
+  EXPECT_FALSE(b);
+  ref4 = nullptr;
+  EXPECT_FALSE(b);
+  ref3 = nullptr;
+  EXPECT_TRUE(b);
+
+  b = false;
+  ref1 = kj::refcounted<Implementation>(&b);
+  ref2 = ref1->addRefAsInterface();
+  ref2 = nullptr;
+  EXPECT_FALSE(b);
+  ref1 = nullptr;
+  EXPECT_TRUE(b);
+}
+
+struct AtomicSetTrueInDestructor: public AtomicRefcounted {
+  AtomicSetTrueInDestructor(bool* ptr): ptr(ptr) {}
+  ~AtomicSetTrueInDestructor() { *ptr = true; }
+
+  bool* ptr;
+};
+
+TEST(Refcount, Atomic) {
+  bool b = false;
+  Own<AtomicSetTrueInDestructor> ref1 = kj::atomicRefcounted<AtomicSetTrueInDestructor>(&b);
+
+  {
+    // Hammer the count from several threads at once.
+    Vector<Own<Thread>> threads;
+    for (uint i = 0; i < 4; i++) {
+      threads.add(heap<Thread>([&]() {
+        Vector<Own<const AtomicSetTrueInDestructor>> refs;
+        for (uint j = 0; j < 10000; j++) {
+          refs.add(kj::atomicAddRef(implicitCast<const AtomicSetTrueInDestructor&>(*ref1)));
+          if (j % 3 == 0) refs.removeLast();
+        }
+      }));
+    }
+  }
+
+  EXPECT_FALSE(b);
+  Own<AtomicSetTrueInDestructor> ref2 = kj::atomicAddRef(*ref1);
+  ref1 = nullptr;
+  EXPECT_FALSE(b);
+  ref2 = nullptr;
+  EXPECT_TRUE(b);
+
+#if defined(KJ_DEBUG) && !KJ_NO_EXCEPTIONS
+  b = false;
+  AtomicSetTrueInDestructor obj(&b);
+  EXPECT_ANY_THROW(atomicAddRef(obj));
+#endif
+}
+
 }  // namespace kj
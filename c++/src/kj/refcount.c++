@@ -32,9 +32,24 @@ Refcounted::~Refcounted() noexcept(false) {
 }
 
 void Refcounted::disposeImpl(void* pointer) const {
+  // Disposer::dispose() drops other references inline, except through an Own of an interface.
   if (--refcount == 0) {
     delete this;
   }
 }
 
+// =======================================================================================
+
+AtomicRefcounted::~AtomicRefcounted() noexcept(false) {
+  KJ_ASSERT(__atomic_load_n(&refcount, __ATOMIC_RELAXED) == 0,
+            "AtomicRefcounted object deleted with non-zero refcount.");
+}
+
+void AtomicRefcounted::disposeImpl(void* pointer) const {
+  // Release our writes to the object, and acquire everyone else's before destroying it.
+  if (__atomic_sub_fetch(&refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+    delete this;
+  }
+}
+
 }  // namespace kj
@@ -29,7 +29,7 @@
 namespace kj {
 
 class Refcounted: private Disposer {
-  // Subclass this to create a class that contains an atomic reference count.  Then, use
+  // Subclass this to create a class that contains a (non-atomic) reference count.  Then, use
   // `kj::refcounted<T>()` to allocate a new refcounted pointer.
   //
   // Do NOT use this lightly.  Refcounting is a crutch.  Good designs should strive to make object
@@ -39,6 +39,11 @@ class Refcounted: private Disposer {
   //
   // NOT THREADSAFE:  This refcounting implementation assumes that an object's references are
   // manipulated only in one thread, because atomic (thread-safe) refcounting is surprisingly slow.
+  // Use `AtomicRefcounted` for the rare object which really is shared between threads.
+  //
+  // Adding a reference is inlined.  So is dropping any reference but the last, when the `Own`'s
+  // static type is known to be refcounted:  `Own<T>` then checks the count before making its
+  // virtual call.  Through an `Own` of an interface type, every drop goes through `disposeImpl()`.
   //
   // In general, abstract classes should _not_ subclass this.  The concrete class at the bottom
   // of the heirarchy should be the one to decide how it implements refcounting.  Interfaces should
@@ -59,18 +64,42 @@ public:
 
 private:
   mutable uint refcount = 0;
-  // "mutable" because disposeImpl() is const.  Bleh.
 
   void disposeImpl(void* pointer) const override;
   template <typename T>
   static Own<T> addRefInternal(T* object);
 
+  inline bool tryReleaseInline(const Disposer& disposer) const {
+    // Drops a reference without destroying the object, if `disposer` is this object's own (i.e.
+    // the reference came from addRef()) and it isn't the last one.
+    if (&disposer == static_cast<const Disposer*>(this) && refcount > 1) {
+      --refcount;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
   template <typename T>
   friend Own<T> addRef(T& object);
   template <typename T, typename... Params>
   friend Own<T> refcounted(Params&&... params);
+  template <typename T, bool isRefcounted>
+  friend struct _::InlineRelease;
 };
 
+namespace _ {  // private
+
+template <typename T>
+struct InlineRelease<T, true> {
+  static inline bool tryRelease(T* object, const Disposer& disposer) {
+    const Refcounted* refcounted = object;
+    return refcounted->tryReleaseInline(disposer);
+  }
+};
+
+}  // namespace _ (private)
+
 template <typename T, typename... Params>
 inline Own<T> refcounted(Params&&... params) {
   // Allocate a new refcounted instance of T, passing `params` to its constructor.  Returns an
@@ -85,7 +114,8 @@ Own<T> addRef(T& object) {
   // using `kj::refcounted<>()`.  It is suggested that subclasses implement a non-static addRef()
   // method which wraps this and returns the appropriate type.
 
-  KJ_IREQUIRE(object.Refcounted::refcount > 0, "Object not allocated with kj::refcounted().");
+  KJ_IREQUIRE(static_cast<const Refcounted&>(object).refcount > 0,
+              "Object not allocated with kj::refcounted().");
   return Refcounted::addRefInternal(&object);
 }
 
@@ -96,6 +126,62 @@ Own<T> Refcounted::addRefInternal(T* object) {
   return Own<T>(object, *refcounted);
 }
 
+// =======================================================================================
+
+class AtomicRefcounted: private Disposer {
+  // Like `Refcounted`, but the reference count is atomic, so references may be added and dropped
+  // from any thread.  Use `kj::atomicRefcounted<T>()` to allocate and `kj::atomicAddRef()` to add
+  // references.
+  //
+  // This is for objects which are genuinely shared between threads -- every reference operation
+  // is an atomic read-modify-write, and dropping a reference always costs a virtual call.  Making
+  // the object itself thread-safe is still up to the subclass; usually its shared state is
+  // immutable or guarded by a `kj::MutexGuarded`, and references are handed out as `Own<const T>`.
+
+public:
+  virtual ~AtomicRefcounted() noexcept(false);
+
+private:
+  mutable uint refcount = 0;
+
+  void disposeImpl(void* pointer) const override;
+  template <typename T>
+  static Own<T> addRefInternal(T* object);
+
+  template <typename T>
+  friend Own<T> atomicAddRef(T& object);
+  template <typename T, typename... Params>
+  friend Own<T> atomicRefcounted(Params&&... params);
+};
+
+template <typename T, typename... Params>
+inline Own<T> atomicRefcounted(Params&&... params) {
+  // Allocate a new atomically-refcounted instance of T, passing `params` to its constructor.
+  // Returns an initial reference to the object.
+
+  return AtomicRefcounted::addRefInternal(new T(kj::fwd<Params>(params)...));
+}
+
+template <typename T>
+Own<T> atomicAddRef(T& object) {
+  // Return a new reference to `object`, which must subclass AtomicRefcounted and have been
+  // allocated using `kj::atomicRefcounted<>()`.  May be called from any thread which already
+  // holds a reference.  `T` may be const, giving an `Own<const T>`.
+
+  KJ_IREQUIRE(__atomic_load_n(&static_cast<const AtomicRefcounted&>(object).refcount,
+                              __ATOMIC_RELAXED) > 0,
+              "Object not allocated with kj::atomicRefcounted().");
+  return AtomicRefcounted::addRefInternal(&object);
+}
+
+template <typename T>
+Own<T> AtomicRefcounted::addRefInternal(T* object) {
+  const AtomicRefcounted* refcounted = object;
+  // Relaxed is enough: a thread can only add a reference if it already holds one.
+  __atomic_add_fetch(&refcounted->refcount, 1, __ATOMIC_RELAXED);
+  return Own<T>(object, *refcounted);
+}
+
 }  // namespace kj
 
 #endif  // KJ_REFCOUNT_H_
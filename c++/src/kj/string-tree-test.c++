@@ -22,6 +22,7 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "string-tree.h"
+#include "io.h"
 #include <gtest/gtest.h>
 
 namespace kj {
@@ -56,6 +57,35 @@ TEST(StringTree, DelimitedArray) {
   EXPECT_EQ("foo, bar, baz, qux", StringTree(kj::mv(arr), ", ").flatten());
 }
 
+class RecordingOutputStream final: public OutputStream {
+public:
+  String text;
+  uint writeCount = 0;
+
+  void write(const void* buffer, size_t size) override {
+    text = str(text, heapString(reinterpret_cast<const char*>(buffer), size));
+  }
+
+  void write(ArrayPtr<const ArrayPtr<const byte>> pieces) override {
+    ++writeCount;
+    EXPECT_LE(pieces.size(), StringTree::WRITE_BATCH_SIZE);
+    OutputStream::write(pieces);
+  }
+};
+
+TEST(StringTree, WriteTo) {
+  auto pieces = heapArray<StringTree>(3000);
+  for (uint i = 0; i < pieces.size(); i++) {
+    pieces[i] = strTree(i % 10);
+  }
+  StringTree tree(kj::mv(pieces), ",");
+
+  RecordingOutputStream output;
+  tree.writeTo(output);
+  EXPECT_EQ(tree.flatten(), output.text);
+  EXPECT_EQ(6u, output.writeCount);  // 5999 pieces, counting the delimiters.
+}
+
 }  // namespace
 }  // namespace _ (private)
 }  // namespace kj
@@ -22,6 +22,7 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "string-tree.h"
+#include "io.h"
 
 namespace kj {
 
@@ -62,4 +63,23 @@ void StringTree::flattenTo(char* __restrict__ target) const {
   });
 }
 
+constexpr size_t StringTree::WRITE_BATCH_SIZE;
+
+void StringTree::writeTo(OutputStream& output) const {
+  ArrayPtr<const byte> batch[WRITE_BATCH_SIZE];
+  size_t count = 0;
+
+  visit([&](ArrayPtr<const char> text) {
+    batch[count++] = arrayPtr(reinterpret_cast<const byte*>(text.begin()), text.size());
+    if (count == WRITE_BATCH_SIZE) {
+      output.write(arrayPtr(batch, count));
+      count = 0;
+    }
+  });
+
+  if (count > 0) {
+    output.write(arrayPtr(batch, count));
+  }
+}
+
 }  // namespace kj
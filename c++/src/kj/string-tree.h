@@ -28,6 +28,8 @@
 
 namespace kj {
 
+class OutputStream;
+
 class StringTree {
   // A long string, represented internally as a tree of strings.  This data structure is like a
   // String, but optimized for concatenation and iteration at the expense of seek time.  The
@@ -64,6 +66,15 @@ public:
   void flattenTo(char* __restrict__ target) const;
   // Copy the contents to the given character array.  Does not add a NUL terminator.
 
+  void writeTo(OutputStream& output) const;
+  // Write the contents to `output` without flattening them first.  The pieces are passed to the
+  // gathering `OutputStream::write()` in batches of up to WRITE_BATCH_SIZE, which for an
+  // `FdOutputStream` means one writev() per batch.  For async streams, see
+  // `AsyncOutputStream::write(StringTree&&)` in async-io.h.
+
+  static constexpr size_t WRITE_BATCH_SIZE = 1024;
+  // Matches the usual IOV_MAX.
+
 private:
   size_t size_;
   String text;
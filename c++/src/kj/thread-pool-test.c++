@@ -0,0 +1,125 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "thread-pool.h"
+#include "async-unix.h"
+#include "debug.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace kj {
+namespace {
+
+TEST(ThreadPool, Run) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  ThreadPool pool;
+  EXPECT_EQ(0u, pool.getThreadCount());
+
+  EXPECT_EQ(123, pool.run([]() { return 123; }).wait(waitScope));
+  EXPECT_EQ("foo", pool.run([]() { return kj::str("foo"); }).wait(waitScope));
+
+  bool ran = false;
+  pool.run([&]() { ran = true; }).wait(waitScope);
+  EXPECT_TRUE(ran);
+}
+
+TEST(ThreadPool, Exception) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  ThreadPool pool;
+  auto promise = pool.run([]() -> int { KJ_FAIL_ASSERT("job failed"); });
+
+  KJ_IF_MAYBE(e, kj::runCatchingExceptions([&]() { promise.wait(waitScope); })) {
+    EXPECT_TRUE(e->getDescription().endsWith("job failed"));
+  } else {
+    ADD_FAILURE() << "Expected exception.";
+  }
+}
+
+TEST(ThreadPool, Bounded) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  ThreadPool pool(2);
+
+  uint running = 0;
+  uint maxRunning = 0;
+  auto promises = kj::heapArrayBuilder<Promise<void>>(8);
+  for (uint i = 0; i < 8; i++) {
+    promises.add(pool.run([&]() {
+      uint n = __atomic_add_fetch(&running, 1, __ATOMIC_SEQ_CST);
+      uint max = __atomic_load_n(&maxRunning, __ATOMIC_SEQ_CST);
+      while (n > max && !__atomic_compare_exchange_n(&maxRunning, &max, n, false,
+                                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {}
+      usleep(10000);
+      __atomic_sub_fetch(&running, 1, __ATOMIC_SEQ_CST);
+    }));
+  }
+
+  for (auto& promise: promises.finish()) {
+    promise.wait(waitScope);
+  }
+
+  EXPECT_EQ(2u, pool.getThreadCount());
+  EXPECT_EQ(2u, maxRunning);
+}
+
+TEST(ThreadPool, CancelQueued) {
+  UnixEventPort port;
+  EventLoop loop(port);
+  WaitScope waitScope(loop);
+
+  ThreadPool pool(1);
+
+  int pipeFds[2];
+  KJ_SYSCALL(pipe(pipeFds));
+  KJ_DEFER(close(pipeFds[0]));
+  KJ_DEFER(close(pipeFds[1]));
+
+  // Occupy the only worker until we write to the pipe.
+  auto blocker = pool.run([&]() {
+    char c;
+    KJ_SYSCALL(read(pipeFds[0], &c, 1));
+  });
+
+  bool ran = false;
+  {
+    auto canceled = pool.run([&]() { ran = true; });
+  }
+
+  KJ_SYSCALL(write(pipeFds[1], "x", 1));
+  blocker.wait(waitScope);
+
+  // FIFO order means the canceled job has been dequeued (and skipped) by the time this one runs.
+  pool.run([]() {}).wait(waitScope);
+  EXPECT_FALSE(ran);
+}
+
+}  // namespace
+}  // namespace kj
@@ -0,0 +1,140 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "thread-pool.h"
+#include "thread.h"
+#include "vector.h"
+#include "debug.h"
+#include <pthread.h>
+
+namespace kj {
+namespace _ {  // private
+
+class ThreadPoolImpl {
+public:
+  explicit ThreadPoolImpl(uint maxThreads): maxThreads(maxThreads) {
+    KJ_REQUIRE(maxThreads > 0, "ThreadPool needs at least one thread.");
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&cond, nullptr);
+  }
+
+  ~ThreadPoolImpl() noexcept(false) {
+    pthread_mutex_lock(&mutex);
+    shuttingDown = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+
+    // Joins each worker once it has drained the queue.
+    threads.resize(0);
+
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  void queue(Function<void()>&& func) const {
+    auto job = heap<Job>(kj::mv(func));
+
+    pthread_mutex_lock(&mutex);
+    KJ_DEFER(pthread_mutex_unlock(&mutex));
+
+    Job* ptr = job.get();
+    *tail = kj::mv(job);
+    tail = &ptr->next;
+    ++queued;
+
+    if (queued > idle && threads.size() < maxThreads) {
+      threads.add(heap<Thread>([this]() { workerLoop(); }));
+    } else {
+      pthread_cond_signal(&cond);
+    }
+  }
+
+  uint getThreadCount() const {
+    pthread_mutex_lock(&mutex);
+    KJ_DEFER(pthread_mutex_unlock(&mutex));
+    return threads.size();
+  }
+
+private:
+  struct Job {
+    Function<void()> func;
+    Own<Job> next;
+
+    explicit Job(Function<void()>&& func): func(kj::mv(func)) {}
+  };
+
+  uint maxThreads;
+
+  // The pool is used through const references from any thread, so all of its state is mutable
+  // and everything below is protected by `mutex`.
+  mutable pthread_mutex_t mutex;
+  mutable pthread_cond_t cond;
+  mutable Own<Job> head;
+  mutable Own<Job>* tail = &head;
+  mutable uint queued = 0;
+  mutable uint idle = 0;
+  bool shuttingDown = false;
+  mutable Vector<Own<Thread>> threads;
+
+  void workerLoop() const {
+    for (;;) {
+      pthread_mutex_lock(&mutex);
+      while (head.get() == nullptr && !shuttingDown) {
+        ++idle;
+        pthread_cond_wait(&cond, &mutex);
+        --idle;
+      }
+
+      if (head.get() == nullptr) {
+        // Shutting down, and the queue is drained.
+        pthread_mutex_unlock(&mutex);
+        return;
+      }
+
+      Own<Job> job = kj::mv(head);
+      head = kj::mv(job->next);
+      if (head.get() == nullptr) tail = &head;
+      --queued;
+      pthread_mutex_unlock(&mutex);
+
+      // ThreadPoolJob catches exceptions itself.  The job, including the fulfiller it holds, is
+      // destroyed here, outside the lock.
+      job->func();
+    }
+  }
+};
+
+}  // namespace _ (private)
+
+ThreadPool::ThreadPool(uint maxThreads): impl(heap<_::ThreadPoolImpl>(maxThreads)) {}
+ThreadPool::~ThreadPool() noexcept(false) {}
+
+void ThreadPool::queue(Function<void()> job) const {
+  impl->queue(kj::mv(job));
+}
+
+uint ThreadPool::getThreadCount() const {
+  return impl->getThreadCount();
+}
+
+}  // namespace kj
@@ -0,0 +1,110 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KJ_THREAD_POOL_H_
+#define KJ_THREAD_POOL_H_
+
+#include "async.h"
+#include "function.h"
+
+namespace kj {
+
+namespace _ { class ThreadPoolImpl; }
+
+class ThreadPool {
+  // A bounded set of worker threads for running blocking calls (getaddrinfo(), disk I/O, ...)
+  // without stalling an event loop.  Jobs queue up in FIFO order and each one's result comes back
+  // to the submitting thread's `EventLoop` as a promise.
+  //
+  // Workers are started on demand, when a job is queued and no worker is idle, up to `maxThreads`;
+  // after that they stay around until the pool is destroyed.  A pool that is never used costs
+  // nothing but a mutex.
+  //
+  // All methods are thread-safe, so one pool may be shared by several event loops.
+
+public:
+  explicit ThreadPool(uint maxThreads = 4);
+
+  ~ThreadPool() noexcept(false);
+  // Waits for all queued jobs to finish, then joins the workers.
+
+  KJ_DISALLOW_COPY(ThreadPool);
+
+  template <typename Func>
+  Promise<_::ReturnType<Func, void>> run(Func&& func) const;
+  // Calls `func()` on one of the pool's threads and returns a promise for its result in the calling
+  // thread, which must have an `EventLoop`.  Exceptions thrown by `func` reject the promise.
+  //
+  // `func` and its result are moved across threads, so the caveats of
+  // `newPromiseAndCrossThreadFulfiller()` apply; in particular `func` must not return a promise.
+  // Destroying the returned promise does not cancel a job that has already started, but one that
+  // is still queued is skipped.
+
+  uint getThreadCount() const;
+  // Number of worker threads started so far.
+
+private:
+  Own<_::ThreadPoolImpl> impl;
+
+  void queue(Function<void()> job) const;
+};
+
+// =======================================================================================
+// Inline implementation details
+
+namespace _ {  // private
+
+template <typename T, typename Func>
+class ThreadPoolJob {
+public:
+  ThreadPoolJob(Func&& func, Own<PromiseFulfiller<T>>&& fulfiller)
+      : func(kj::fwd<Func>(func)), fulfiller(kj::mv(fulfiller)) {}
+
+  void operator()() {
+    if (!fulfiller->isWaiting()) return;  // Canceled while queued.
+
+    KJ_IF_MAYBE(exception, kj::runCatchingExceptions([this]() {
+      fulfiller->fulfill(MaybeVoidCaller<Void, FixVoid<T>>::apply(func, Void()));
+    })) {
+      fulfiller->reject(kj::mv(*exception));
+    }
+  }
+
+private:
+  Decay<Func> func;
+  Own<PromiseFulfiller<T>> fulfiller;
+};
+
+}  // namespace _ (private)
+
+template <typename Func>
+Promise<_::ReturnType<Func, void>> ThreadPool::run(Func&& func) const {
+  typedef _::ReturnType<Func, void> T;
+  auto paf = newPromiseAndCrossThreadFulfiller<T>();
+  queue(_::ThreadPoolJob<T, Func>(kj::fwd<Func>(func), kj::mv(paf.fulfiller)));
+  return kj::mv(paf.promise);
+}
+
+}  // namespace kj
+
+#endif  // KJ_THREAD_POOL_H_
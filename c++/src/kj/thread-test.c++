@@ -0,0 +1,150 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "thread.h"
+#include "debug.h"
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+#if __linux__
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace kj {
+namespace {
+
+TEST(Thread, Run) {
+  bool ran = false;
+  {
+    Thread thread([&]() { ran = true; });
+  }
+  EXPECT_TRUE(ran);
+}
+
+TEST(Thread, Exception) {
+  KJ_IF_MAYBE(e, kj::runCatchingExceptions([&]() {
+    Thread thread([]() { KJ_FAIL_ASSERT("thread failed"); });
+  })) {
+    EXPECT_TRUE(e->getDescription().endsWith("thread failed"));
+  } else {
+    ADD_FAILURE() << "Expected exception.";
+  }
+}
+
+#if __linux__
+
+TEST(Thread, StackSize) {
+  ThreadOptions options;
+  options.stackSize = 1 << 20;
+
+  size_t stackSize = 0;
+  Thread(options, [&]() {
+    pthread_attr_t attr;
+    KJ_ASSERT(pthread_getattr_np(pthread_self(), &attr) == 0);
+    KJ_ASSERT(pthread_attr_getstacksize(&attr, &stackSize) == 0);
+    pthread_attr_destroy(&attr);
+  });
+
+  EXPECT_EQ(size_t(1 << 20), stackSize);
+}
+
+TEST(Thread, Name) {
+  ThreadOptions options;
+  options.name = "a-rather-long-thread-name";
+
+  char name[32] = {0};
+  Thread(options, [&]() {
+    // The creating thread sets the name just after the thread starts, so poll for it.
+    for (uint i = 0; i < 1000; i++) {
+      KJ_ASSERT(pthread_getname_np(pthread_self(), name, sizeof(name)) == 0);
+      if (name[0] == 'a') break;
+      usleep(1000);
+    }
+  });
+
+  // Linux allows 15 characters.
+  EXPECT_STREQ("a-rather-long-t", name);
+}
+
+TEST(Thread, Affinity) {
+  cpu_set_t allowed;
+  KJ_SYSCALL(sched_getaffinity(0, sizeof(allowed), &allowed));
+  uint cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) ++cpu;
+
+  ThreadOptions options;
+  options.cpus = kj::arrayPtr(&cpu, 1);
+
+  int ranOn = -1;
+  int allowedCount = 0;
+  Thread(options, [&]() {
+    cpu_set_t set;
+    KJ_SYSCALL(sched_getaffinity(0, sizeof(set), &set));
+    allowedCount = CPU_COUNT(&set);
+    ranOn = sched_getcpu();
+  });
+
+  EXPECT_EQ(1, allowedCount);
+  EXPECT_EQ(int(cpu), ranOn);
+}
+
+TEST(Thread, NumaNode) {
+  if (access("/sys/devices/system/node/node0/cpulist", R_OK) != 0) {
+    return;  // No NUMA information available.
+  }
+
+  ThreadOptions options;
+  options.numaNode = 0;
+
+  int allowedCount = 0;
+  KJ_IF_MAYBE(e, kj::runCatchingExceptions([&]() {
+    Thread(options, [&]() {
+      cpu_set_t set;
+      KJ_SYSCALL(sched_getaffinity(0, sizeof(set), &set));
+      allowedCount = CPU_COUNT(&set);
+    });
+  })) {
+    // Node 0's CPUs may all be outside our cgroup's allowed set, in which case pthread_create()
+    // fails.  That's fine; we only want to check that the node's CPU list parses.
+    EXPECT_TRUE(e->getDescription().startsWith("pthread_create")) << e->getDescription().cStr();
+    return;
+  }
+
+  EXPECT_GT(allowedCount, 0);
+}
+
+TEST(Thread, BadNumaNode) {
+  ThreadOptions options;
+  options.numaNode = 100000;
+
+  bool ran = false;
+  EXPECT_ANY_THROW(Thread(options, [&]() { ran = true; }));
+  EXPECT_FALSE(ran);
+}
+
+#endif  // __linux__
+
+}  // namespace
+}  // namespace kj
@@ -25,18 +25,118 @@
 #include "debug.h"
 #include <pthread.h>
 #include <signal.h>
+#include <string.h>
+
+#if __linux__
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#endif
 
 namespace kj {
 
-Thread::Thread(Function<void()> func): func(kj::mv(func)) {
+namespace {
+
+#if __linux__
+void addCpu(cpu_set_t& set, uint cpu) {
+  KJ_REQUIRE(cpu < CPU_SETSIZE, "CPU number out of range.", cpu);
+  CPU_SET(cpu, &set);
+}
+
+void addNumaNodeCpus(cpu_set_t& set, uint node) {
+  // Reads the node's CPU list from sysfs, e.g. "0-3,8-11".  (This avoids depending on libnuma.)
+
+  auto path = kj::str("/sys/devices/system/node/node", node, "/cpulist");
+  int fd;
+  KJ_SYSCALL(fd = open(path.cStr(), O_RDONLY | O_CLOEXEC), "No such NUMA node?", node);
+  KJ_DEFER(close(fd));
+
+  char buffer[4096];
+  ssize_t n;
+  KJ_SYSCALL(n = read(fd, buffer, sizeof(buffer) - 1), path);
+  buffer[n] = '\0';
+
+  char* pos = buffer;
+  while (*pos >= '0' && *pos <= '9') {
+    uint first = strtoul(pos, &pos, 10);
+    uint last = first;
+    if (*pos == '-') {
+      last = strtoul(pos + 1, &pos, 10);
+    }
+    for (uint cpu = first; cpu <= last; cpu++) {
+      addCpu(set, cpu);
+    }
+    if (*pos == ',') ++pos;
+  }
+}
+#endif
+
+}  // namespace
+
+Thread::Thread(Function<void()> func): Thread(ThreadOptions(), kj::mv(func)) {}
+
+Thread::Thread(const ThreadOptions& options, Function<void()> func): func(kj::mv(func)) {
   static_assert(sizeof(threadId) >= sizeof(pthread_t),
                 "pthread_t is larger than a long long on your platform.  Please port.");
 
-  int pthreadResult = pthread_create(reinterpret_cast<pthread_t*>(&threadId),
-                                     nullptr, &runThread, this);
+  pthread_attr_t attr;
+  int pthreadResult = pthread_attr_init(&attr);
+  if (pthreadResult != 0) {
+    KJ_FAIL_SYSCALL("pthread_attr_init", pthreadResult);
+  }
+  KJ_DEFER(pthread_attr_destroy(&attr));
+
+  if (options.stackSize > 0) {
+    pthreadResult = pthread_attr_setstacksize(&attr, options.stackSize);
+    if (pthreadResult != 0) {
+      KJ_FAIL_SYSCALL("pthread_attr_setstacksize", pthreadResult, options.stackSize);
+    }
+  }
+
+  if (options.cpus.size() > 0 || options.numaNode >= 0) {
+#if __linux__
+    KJ_REQUIRE(options.cpus.size() == 0 || options.numaNode < 0,
+               "Specify either `cpus` or `numaNode`, not both.");
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (uint cpu: options.cpus) {
+      addCpu(cpus, cpu);
+    }
+    if (options.numaNode >= 0) {
+      addNumaNodeCpus(cpus, options.numaNode);
+      KJ_REQUIRE(CPU_COUNT(&cpus) > 0, "NUMA node has no CPUs.", options.numaNode);
+    }
+
+    pthreadResult = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    if (pthreadResult != 0) {
+      KJ_FAIL_SYSCALL("pthread_attr_setaffinity_np", pthreadResult);
+    }
+#else
+    KJ_FAIL_REQUIRE("Thread CPU affinity is only supported on Linux.");
+#endif
+  }
+
+  pthreadResult = pthread_create(reinterpret_cast<pthread_t*>(&threadId),
+                                 &attr, &runThread, this);
   if (pthreadResult != 0) {
     KJ_FAIL_SYSCALL("pthread_create", pthreadResult);
   }
+
+#if __linux__
+  if (options.name.size() > 0) {
+    char name[16];
+    size_t length = kj::min(options.name.size(), sizeof(name) - 1);
+    memcpy(name, options.name.begin(), length);
+    name[length] = '\0';
+
+    pthreadResult = pthread_setname_np(*reinterpret_cast<pthread_t*>(&threadId), name);
+    if (pthreadResult != 0) {
+      KJ_FAIL_SYSCALL("pthread_setname_np", pthreadResult, options.name) { break; }
+    }
+  }
+#endif
 }
 
 Thread::~Thread() noexcept(false) {
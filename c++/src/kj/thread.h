@@ -27,9 +27,32 @@
 #include "common.h"
 #include "function.h"
 #include "exception.h"
+#include "string.h"
 
 namespace kj {
 
+struct ThreadOptions {
+  // Options for starting a `Thread`.  The defaults give the same thread as `Thread(func)`.
+
+  StringPtr name;
+  // Name shown by debuggers and by tools like `top -H`.  Linux truncates it to 15 characters.
+  // Only used while the thread is being created, so it needn't outlive the constructor call.
+  // Ignored on platforms other than Linux.
+
+  size_t stackSize = 0;
+  // Stack size in bytes, or zero for the system default (typically 8MB on Linux).  Reduce this
+  // when running thousands of threads which don't recurse deeply.
+
+  ArrayPtr<const uint> cpus;
+  // If non-empty, the thread may only run on these CPUs, numbered as the kernel numbers them.  The
+  // affinity is set before the thread starts, so it never runs anywhere else.  Linux only.
+
+  int numaNode = -1;
+  // If non-negative, the thread may only run on the CPUs of this NUMA node.  The kernel places
+  // memory on the node that first touches it, so memory the thread allocates and initializes
+  // itself stays local.  Can't be combined with `cpus`.  Linux only.
+};
+
 class Thread {
   // A thread!  Pass a lambda to the constructor, and it runs in the thread.  The destructor joins
   // the thread.  If the function throws an exception, it is rethrown from the thread's destructor
@@ -37,6 +60,7 @@ class Thread {
 
 public:
   explicit Thread(Function<void()> func);
+  Thread(const ThreadOptions& options, Function<void()> func);
 
   ~Thread() noexcept(false);
 
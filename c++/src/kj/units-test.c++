@@ -63,5 +63,21 @@ TEST(UnitMeasure, Basics) {
   EXPECT_FALSE(8 * KIB < 4 * KIB);
 }
 
+class Offset;
+typedef Absolute<ByteCount, Offset> ByteOffset;
+
+TEST(UnitMeasure, Absolute) {
+  ByteOffset start = origin<ByteOffset>();
+  ByteOffset end = start + 16 * BYTE;
+
+  EXPECT_EQ(16 * BYTE, end - start);
+  EXPECT_TRUE(start < end);
+  EXPECT_TRUE(end - 16 * BYTE == start);
+
+  end += 4 * BYTE;
+  EXPECT_EQ(20 * BYTE, end - start);
+  EXPECT_EQ(0, origin<int>());
+}
+
 }  // namespace
 }  // namespace kj
@@ -0,0 +1,127 @@
+// Copyright (c) 2013, Kenton Varda <temporal@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "vector.h"
+#include "string.h"
+#include <gtest/gtest.h>
+
+namespace kj {
+namespace {
+
+struct Counted {
+  // Counts live instances so that tests can check every element is destroyed exactly once.
+
+  static int live;
+  int value;
+
+  Counted(int value): value(value) { ++live; }
+  Counted(Counted&& other): value(other.value) { ++live; }
+  Counted& operator=(Counted&& other) { value = other.value; return *this; }
+  ~Counted() { --live; }
+  KJ_DISALLOW_COPY(Counted);
+};
+
+int Counted::live = 0;
+
+TEST(SmallVector, StaysInline) {
+  SmallVector<int, 2> vec;
+  EXPECT_TRUE(vec.empty());
+  EXPECT_TRUE(vec.isInline());
+  EXPECT_EQ(2u, vec.capacity());
+
+  vec.add(12);
+  vec.add(34);
+  EXPECT_TRUE(vec.isInline());
+  EXPECT_EQ(2u, vec.size());
+  EXPECT_EQ(12, vec[0]);
+  EXPECT_EQ(34, vec.back());
+
+  vec.add(56);
+  EXPECT_FALSE(vec.isInline());
+  EXPECT_EQ(4u, vec.capacity());
+  EXPECT_EQ("12, 34, 56", strArray(vec, ", "));
+
+  vec.removeLast();
+  EXPECT_EQ("12, 34", strArray(vec, ", "));
+}
+
+TEST(SmallVector, Move) {
+  {
+    SmallVector<Counted, 2> vec;
+    vec.add(1);
+    EXPECT_EQ(1, Counted::live);
+
+    // Inline elements are moved one by one.
+    SmallVector<Counted, 2> moved = kj::mv(vec);
+    EXPECT_TRUE(vec.empty());
+    EXPECT_TRUE(moved.isInline());
+    EXPECT_EQ(1, moved[0].value);
+    EXPECT_EQ(1, Counted::live);
+
+    // Heap space is transferred.
+    moved.add(2);
+    moved.add(3);
+    const Counted* first = moved.begin();
+    vec = kj::mv(moved);
+    EXPECT_TRUE(moved.empty());
+    EXPECT_TRUE(moved.isInline());
+    EXPECT_EQ(first, vec.begin());
+    EXPECT_EQ(3, vec.back().value);
+    EXPECT_EQ(3, Counted::live);
+  }
+
+  EXPECT_EQ(0, Counted::live);
+}
+
+TEST(SmallVector, Resize) {
+  SmallVector<int, 1> vec;
+  vec.resize(3);
+  EXPECT_EQ("0, 0, 0", strArray(vec, ", "));
+
+  int more[] = {1, 2};
+  vec.addAll(more, more + 2);
+  EXPECT_EQ("0, 0, 0, 1, 2", strArray(vec, ", "));
+
+  vec.resize(1);
+  EXPECT_EQ(1u, vec.size());
+  vec.clear();
+  EXPECT_TRUE(vec.empty());
+}
+
+TEST(SmallVector, OverAligned) {
+  struct alignas(32) Wide {
+    int value;
+  };
+
+  static_assert(alignof(SmallVector<Wide, 2>) == alignof(Wide),
+                "Inline storage must be aligned for its elements.");
+
+  SmallVector<Wide, 2> vec;
+  vec.add(Wide { 1 });
+  EXPECT_TRUE(vec.isInline());
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(vec.begin()) % alignof(Wide));
+}
+
+}  // namespace
+}  // namespace kj
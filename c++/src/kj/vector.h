@@ -117,6 +117,153 @@ private:
   }
 };
 
+template <typename T, size_t inlineCapacity>
+class SmallVector {
+  // Like Vector, but with room for `inlineCapacity` elements inside the object itself, so that no
+  // heap allocation happens until the vector grows past that.  Use this for per-message lists
+  // which are nearly always short (e.g. cap tables), where the allocation would otherwise cost
+  // more than the contents.
+  //
+  // Unlike Vector, moving a SmallVector whose elements are still inline moves each element, so
+  // the move invalidates pointers to them.
+
+  static_assert(inlineCapacity > 0, "Use Vector if you don't want inline storage.");
+
+public:
+  inline SmallVector(): ptr(inlineElements()), count(0), cap(inlineCapacity) {}
+  inline SmallVector(SmallVector&& other): SmallVector() { takeFrom(other); }
+  inline ~SmallVector() noexcept(false) { freeAll(); }
+  KJ_DISALLOW_COPY(SmallVector);
+
+  inline SmallVector& operator=(SmallVector&& other) {
+    if (&other != this) {
+      freeAll();
+      ptr = inlineElements();
+      count = 0;
+      cap = inlineCapacity;
+      takeFrom(other);
+    }
+    return *this;
+  }
+
+  inline operator ArrayPtr<T>() { return asPtr(); }
+  inline operator ArrayPtr<const T>() const { return asPtr(); }
+  inline ArrayPtr<T> asPtr() { return arrayPtr(ptr, count); }
+  inline ArrayPtr<const T> asPtr() const { return arrayPtr(static_cast<const T*>(ptr), count); }
+
+  inline size_t size() const { return count; }
+  inline bool empty() const { return count == 0; }
+  inline size_t capacity() const { return cap; }
+  inline bool isInline() const { return ptr == inlineElements(); }
+  // True if no heap space has been allocated.
+
+  inline T& operator[](size_t index) { return ptr[index]; }
+  inline const T& operator[](size_t index) const { return ptr[index]; }
+
+  inline const T* begin() const { return ptr; }
+  inline const T* end() const { return ptr + count; }
+  inline const T& front() const { return *ptr; }
+  inline const T& back() const { return ptr[count - 1]; }
+  inline T* begin() { return ptr; }
+  inline T* end() { return ptr + count; }
+  inline T& front() { return *ptr; }
+  inline T& back() { return ptr[count - 1]; }
+
+  template <typename... Params>
+  inline T& add(Params&&... params) {
+    if (count == cap) grow();
+    T& result = ptr[count];
+    ctor(result, kj::fwd<Params>(params)...);
+    ++count;
+    return result;
+  }
+
+  template <typename Iterator>
+  inline void addAll(Iterator begin, Iterator end) {
+    size_t needed = count + (end - begin);
+    if (needed > cap) grow(needed);
+    for (Iterator i = begin; i != end; ++i) {
+      ctor(ptr[count], *i);
+      ++count;
+    }
+  }
+
+  template <typename Container>
+  inline void addAll(Container&& container) {
+    addAll(container.begin(), container.end());
+  }
+
+  inline void removeLast() {
+    dtor(ptr[--count]);
+  }
+
+  inline void resize(size_t size) {
+    if (size > cap) grow(size);
+    while (count < size) {
+      ctor(ptr[count]);
+      ++count;
+    }
+    while (count > size) {
+      removeLast();
+    }
+  }
+
+  inline void clear() {
+    while (count > 0) {
+      removeLast();
+    }
+  }
+
+private:
+  T* ptr;
+  size_t count;
+  size_t cap;
+
+  alignas(T) byte space[sizeof(T) * inlineCapacity];
+
+  inline T* inlineElements() { return reinterpret_cast<T*>(space); }
+  inline const T* inlineElements() const { return reinterpret_cast<const T*>(space); }
+
+  void freeAll() {
+    clear();
+    if (!isInline()) {
+      operator delete(ptr);
+    }
+  }
+
+  void takeFrom(SmallVector& other) {
+    // Expects `this` to be empty and inline.
+    if (other.isInline()) {
+      for (T& element: other) {
+        ctor(ptr[count], kj::mv(element));
+        ++count;
+      }
+      other.clear();
+    } else {
+      ptr = other.ptr;
+      count = other.count;
+      cap = other.cap;
+      other.ptr = other.inlineElements();
+      other.count = 0;
+      other.cap = inlineCapacity;
+    }
+  }
+
+  void grow(size_t minCapacity = 0) {
+    size_t newCapacity = kj::max(minCapacity, cap * 2);
+    T* newPtr = reinterpret_cast<T*>(operator new(sizeof(T) * newCapacity));
+    for (size_t i = 0; i < count; i++) {
+      ctor(newPtr[i], kj::mv(ptr[i]));
+      dtor(ptr[i]);
+    }
+    if (!isInline()) {
+      operator delete(ptr);
+    }
+    ptr = newPtr;
+    cap = newCapacity;
+  }
+};
+
 }  // namespace kj
 
 #endif  // KJ_VECTOR_H_